@@ -157,6 +157,14 @@ namespace Microsoft.MixedReality.WebRTC.Interop
             EntryPoint = "mrsForceShutdown")]
         public static unsafe extern void LibraryForceShutdown();
 
+        [DllImport(dllPath, CallingConvention = CallingConvention.StdCall, CharSet = CharSet.Ansi,
+            EntryPoint = "mrsGetFactoryShardCount")]
+        public static unsafe extern uint LibraryGetFactoryShardCount();
+
+        [DllImport(dllPath, CallingConvention = CallingConvention.StdCall, CharSet = CharSet.Ansi,
+            EntryPoint = "mrsSetFactoryShardCount")]
+        public static unsafe extern uint LibrarySetFactoryShardCount(uint count);
+
         [DllImport(dllPath, CallingConvention = CallingConvention.StdCall, CharSet = CharSet.Ansi,
             EntryPoint = "mrsSdpForceCodecs")]
         public static unsafe extern uint SdpForceCodecs(string message, SdpFilter audioFilter, SdpFilter videoFilter,
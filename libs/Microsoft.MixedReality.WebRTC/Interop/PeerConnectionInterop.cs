@@ -196,43 +196,44 @@ namespace Microsoft.MixedReality.WebRTC.Interop
             return tcs.Task;
         }
 
-        [MonoPInvokeCallback(typeof(PeerConnectionSimpleStatsObjectCallback))]
-        public unsafe static void GetStatsObjectCallback(IntPtr userData, IntPtr statsObject)
+        /// <summary>
+        /// Type of simple stats object, matching the native <c>mrsStatsType</c>.
+        /// </summary>
+        internal enum StatsType : int
         {
-            var list = Utils.ToWrapper<object>(userData);
-            if (list is List<PeerConnection.DataChannelStats> dataStatsList)
-            {
-                dataStatsList.Add(*(PeerConnection.DataChannelStats*)statsObject);
-            }
-            else if (list is List<PeerConnection.AudioSenderStats> audioSenderStatsList)
-            {
-                audioSenderStatsList.Add(Marshal.PtrToStructure<PeerConnection.AudioSenderStats>(statsObject));
-            }
-            else if (list is List<PeerConnection.AudioReceiverStats> audioReceiverStatsList)
-            {
-                audioReceiverStatsList.Add(Marshal.PtrToStructure<PeerConnection.AudioReceiverStats>(statsObject));
-            }
-            else if (list is List<PeerConnection.VideoSenderStats> videoSenderStatsList)
-            {
-                videoSenderStatsList.Add(Marshal.PtrToStructure<PeerConnection.VideoSenderStats>(statsObject));
-            }
-            else if (list is List<PeerConnection.VideoReceiverStats> videoReceiverStatsList)
-            {
-                videoReceiverStatsList.Add(Marshal.PtrToStructure<PeerConnection.VideoReceiverStats>(statsObject));
-            }
-            else if (list is List<PeerConnection.TransportStats> transportStatsList)
-            {
-                transportStatsList.Add(*(PeerConnection.TransportStats*)statsObject);
-            }
+            DataChannel = 0,
+            AudioSender = 1,
+            AudioReceiver = 2,
+            VideoSender = 3,
+            VideoReceiver = 4,
+            Transport = 5
+        }
+
+        private static StatsType GetStatsType<T>()
+        {
+            var type = typeof(T);
+            if (type == typeof(PeerConnection.DataChannelStats)) { return StatsType.DataChannel; }
+            if (type == typeof(PeerConnection.AudioSenderStats)) { return StatsType.AudioSender; }
+            if (type == typeof(PeerConnection.AudioReceiverStats)) { return StatsType.AudioReceiver; }
+            if (type == typeof(PeerConnection.VideoSenderStats)) { return StatsType.VideoSender; }
+            if (type == typeof(PeerConnection.VideoReceiverStats)) { return StatsType.VideoReceiver; }
+            if (type == typeof(PeerConnection.TransportStats)) { return StatsType.Transport; }
+            throw new ArgumentException($"Unsupported stats type {type.Name}.");
         }
 
         public static IEnumerable<T> GetStatsObject<T>(PeerConnection.StatsReport.Handle reportHandle)
         {
-            var res = new List<T>();
-            var resHandle = GCHandle.Alloc(res, GCHandleType.Normal);
-            StatsReport_GetObjects(reportHandle, typeof(T).Name, GetStatsObjectCallback, GCHandle.ToIntPtr(resHandle));
-            resHandle.Free();
-            return res;
+            // Read all objects of the given type from the contiguous array owned by the report,
+            // in a single interop call.
+            uint res = StatsReport_GetSimpleStats(reportHandle, GetStatsType<T>(), out IntPtr objects, out ulong count);
+            Utils.ThrowOnErrorCode(res);
+            var list = new List<T>((int)count);
+            int stride = Marshal.SizeOf<T>();
+            for (ulong i = 0; i < count; ++i)
+            {
+                list.Add(Marshal.PtrToStructure<T>(objects + (int)i * stride));
+            }
+            return list;
         }
 
         [StructLayout(LayoutKind.Sequential, CharSet = CharSet.Ansi)]
@@ -243,6 +244,7 @@ namespace Microsoft.MixedReality.WebRTC.Interop
             public IceTransportType IceTransportType;
             public BundlePolicy BundlePolicy;
             public SdpSemantic SdpSemantic;
+            public int FactoryShard;
         }
 
         [StructLayout(LayoutKind.Sequential, CharSet = CharSet.Ansi)]
@@ -549,6 +551,11 @@ namespace Microsoft.MixedReality.WebRTC.Interop
             EntryPoint = "mrsStatsReportGetObjects")]
         public static extern void StatsReport_GetObjects(PeerConnection.StatsReport.Handle reportHandle, string stats_type, PeerConnectionSimpleStatsObjectCallback callback, IntPtr userData);
 
+        [DllImport(Utils.dllPath, CallingConvention = CallingConvention.StdCall, CharSet = CharSet.Ansi,
+            EntryPoint = "mrsStatsReportGetSimpleStats")]
+        public static extern uint StatsReport_GetSimpleStats(PeerConnection.StatsReport.Handle reportHandle,
+            StatsType statsType, out IntPtr objects, out ulong count);
+
         [DllImport(Utils.dllPath, CallingConvention = CallingConvention.StdCall, CharSet = CharSet.Ansi,
             EntryPoint = "mrsStatsReportRemoveRef")]
         public static extern void StatsReport_RemoveRef(IntPtr reportHandle);
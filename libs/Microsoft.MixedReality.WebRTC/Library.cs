@@ -64,6 +64,19 @@ namespace Microsoft.MixedReality.WebRTC
             set { Utils.LibrarySetShutdownOptions(value); }
         }
 
+        /// <summary>
+        /// Number of factory shards, each with its own set of WebRTC threads, over which peer
+        /// connections are spread to scale with many connections. This must be set before the
+        /// library is initialized, that is before creating any object or after all objects were
+        /// disposed.
+        /// </summary>
+        /// <seealso cref="PeerConnectionConfiguration.FactoryShard"/>
+        public static uint FactoryShardCount
+        {
+            get { return Utils.LibraryGetFactoryShardCount(); }
+            set { Utils.ThrowOnErrorCode(Utils.LibrarySetFactoryShardCount(value)); }
+        }
+
         /// <summary>
         /// Forcefully shutdown the MixedReality-WebRTC library. This shall not be used under normal
         /// circumstances, but can be useful e.g. in the Unity editor when a test fails and proper
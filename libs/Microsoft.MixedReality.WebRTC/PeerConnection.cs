@@ -157,6 +157,12 @@ namespace Microsoft.MixedReality.WebRTC
         /// </summary>
         /// <remarks>Plan B is deprecated, do not use it.</remarks>
         public SdpSemantic SdpSemantic = SdpSemantic.UnifiedPlan;
+
+        /// <summary>
+        /// Factory shard running the connection, modulo <see cref="Library.FactoryShardCount"/>,
+        /// or -1 to assign shards round-robin.
+        /// </summary>
+        public int FactoryShard = -1;
     }
 
     /// <summary>
@@ -1087,11 +1093,15 @@ namespace Microsoft.MixedReality.WebRTC
                             IceTransportType = config.IceTransportType,
                             BundlePolicy = config.BundlePolicy,
                             SdpSemantic = config.SdpSemantic,
+                            FactoryShard = config.FactoryShard,
                         };
                     }
                     else
                     {
-                        nativeConfig = new PeerConnectionInterop.PeerConnectionConfiguration();
+                        nativeConfig = new PeerConnectionInterop.PeerConnectionConfiguration
+                        {
+                            FactoryShard = -1,
+                        };
                     }
 
                     uint res = PeerConnectionInterop.PeerConnection_Create(nativeConfig, out _nativePeerhandle);
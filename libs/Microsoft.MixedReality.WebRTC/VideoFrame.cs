@@ -73,6 +73,26 @@ namespace Microsoft.MixedReality.WebRTC
         /// </summary>
         public int strideA;
 
+        /// <summary>
+        /// Capture time of the frame, in milliseconds since the NTP epoch (January 1st, 1900 UTC),
+        /// or zero if unknown. For remote frames this is the capture time on the sender, estimated from
+        /// the RTP timestamp and the RTCP sender reports, and is unknown until the first sender report
+        /// is received. This is ignored when completing a frame request of an external video source.
+        /// </summary>
+        public long captureTimeNtpMs;
+
+        /// <summary>
+        /// Time at which the frame was delivered to the frame callback, in milliseconds since the NTP
+        /// epoch. The difference with <see cref="captureTimeNtpMs"/> is the capture-to-render latency,
+        /// assuming the sender and receiver clocks are synchronized.
+        /// </summary>
+        public long receiveTimeNtpMs;
+
+        /// <summary>
+        /// RTP timestamp of the frame, in units of the 90 kHz video RTP clock, or zero for local frames.
+        /// </summary>
+        public uint rtpTimestamp;
+
         /// <summary>
         /// Copy the frame content to a <xref href="System.Byte"/>[] buffer as a contiguous block of memory
         /// containing the Y, U, and V planes one after another, and the alpha plane at the end if present.
@@ -148,6 +168,26 @@ namespace Microsoft.MixedReality.WebRTC
         /// Stride in bytes between the ARGB rows.
         /// </summary>
         public int stride;
+
+        /// <summary>
+        /// Capture time of the frame, in milliseconds since the NTP epoch (January 1st, 1900 UTC),
+        /// or zero if unknown. For remote frames this is the capture time on the sender, estimated from
+        /// the RTP timestamp and the RTCP sender reports, and is unknown until the first sender report
+        /// is received. This is ignored when completing a frame request of an external video source.
+        /// </summary>
+        public long captureTimeNtpMs;
+
+        /// <summary>
+        /// Time at which the frame was delivered to the frame callback, in milliseconds since the NTP
+        /// epoch. The difference with <see cref="captureTimeNtpMs"/> is the capture-to-render latency,
+        /// assuming the sender and receiver clocks are synchronized.
+        /// </summary>
+        public long receiveTimeNtpMs;
+
+        /// <summary>
+        /// RTP timestamp of the frame, in units of the 90 kHz video RTP clock, or zero for local frames.
+        /// </summary>
+        public uint rtpTimestamp;
     }
 
     /// <summary>
@@ -0,0 +1,72 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include "export.h"
+#include "interop_api.h"
+
+extern "C" {
+
+/// Heap allocations recorded inside a named scope of the library, since
+/// tracking was last started.
+struct mrsAllocScopeStats {
+  /// Name of the scope, with static storage duration. This is the same name as
+  /// the trace span of the scope, if any.
+  const char* name;
+
+  /// Number of times the scope was entered.
+  uint64_t invocation_count;
+
+  /// Number of allocations made inside the scope, excluding the ones made
+  /// inside nested scopes, which are recorded separately.
+  uint64_t alloc_count;
+
+  /// Total size in bytes of the allocations counted in |alloc_count|.
+  uint64_t alloc_bytes;
+};
+
+/// Heap allocations recorded on a single thread, inside or outside any scope,
+/// since tracking was last started.
+struct mrsAllocThreadStats {
+  /// Platform thread identifier.
+  uint64_t thread_id;
+
+  /// Number of allocations made on the thread.
+  uint64_t alloc_count;
+
+  /// Total size in bytes of the allocations counted in |alloc_count|.
+  uint64_t alloc_bytes;
+};
+
+/// Start counting the heap allocations made by the library, per thread and per
+/// scope, resetting all counters. This is used to verify that the media hot
+/// paths do not allocate per frame in steady state.
+///
+/// Returns |mrsResult::kUnsupported| unless the library was compiled with
+/// |MRS_ENABLE_ALLOC_TRACKING|, which replaces the global allocation functions
+/// of the library. When compiled in but not tracking, each allocation costs a
+/// single relaxed atomic load.
+MRS_API mrsResult MRS_CALL mrsAllocTrackingStart() noexcept;
+
+/// Stop counting heap allocations. The counters remain available until the
+/// next start.
+MRS_API mrsResult MRS_CALL mrsAllocTrackingStop() noexcept;
+
+/// Get the allocation counters of all scopes entered since tracking started.
+///
+/// On input |count| contains the capacity of |stats| in elements. On output it
+/// contains the number of scopes. If |stats| is not large enough, the function
+/// returns |mrsResult::kBufferTooSmall| and the caller can retry with a larger
+/// buffer. |stats| can be null if |count| is zero.
+MRS_API mrsResult MRS_CALL
+mrsAllocTrackingGetScopeStats(mrsAllocScopeStats* stats,
+                              uint32_t* count) noexcept;
+
+/// Get the allocation counters of all threads which allocated since tracking
+/// started, with the same buffer semantic as |mrsAllocTrackingGetScopeStats()|.
+MRS_API mrsResult MRS_CALL
+mrsAllocTrackingGetThreadStats(mrsAllocThreadStats* stats,
+                               uint32_t* count) noexcept;
+
+}  // extern "C"
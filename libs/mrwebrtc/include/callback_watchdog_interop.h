@@ -0,0 +1,124 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include "export.h"
+#include "interop_api.h"
+
+extern "C" {
+
+/// Type of a user callback invoked by the library.
+enum class mrsCallbackType : int32_t {
+  /// Callback not identified.
+  kUnknown = 0,
+  kI420AVideoFrame = 1,
+  kArgb32VideoFrame = 2,
+  kAudioFrame = 3,
+  kDataChannelMessage = 4,
+  kDataChannelBuffering = 5,
+  kDataChannelState = 6,
+  kLocalSdpReadyToSend = 7,
+  kIceCandidateReadyToSend = 8,
+  kIceStateChanged = 9,
+  kIceGatheringStateChanged = 10,
+  kRenegotiationNeeded = 11,
+  kConnected = 12,
+  kTransceiverAdded = 13,
+  kAudioTrackAdded = 14,
+  kAudioTrackRemoved = 15,
+  kVideoTrackAdded = 16,
+  kVideoTrackRemoved = 17,
+  kDataChannelAdded = 18,
+  kDataChannelRemoved = 19,
+  kTransceiverAssociated = 20,
+  kTransceiverStateUpdated = 21,
+  kEncodedVideoFrame = 22,
+  kKeyFrameRequested = 23,
+};
+
+/// Configuration of the callback watchdog.
+struct mrsCallbackWatchdogConfig {
+  /// Maximum duration of a single callback invocation, in microseconds. Any
+  /// invocation taking longer produces a warning.
+  int64_t budget_us{5000};
+
+  /// Minimum interval between two warnings for the same callback type, in
+  /// milliseconds. Warnings produced in between are counted but not reported.
+  int32_t warning_interval_ms{1000};
+};
+
+/// Warning produced when a callback invocation exceeds its budget.
+struct mrsCallbackWarningInfo {
+  /// Handle of the object which invoked the callback, or null if unknown. For
+  /// frame callbacks this is the handle of the track.
+  void* object_handle;
+
+  /// Type of the callback which exceeded its budget.
+  mrsCallbackType type;
+
+  /// Duration of the invocation, in microseconds.
+  int64_t duration_us;
+
+  /// Budget at the time of the invocation, in microseconds.
+  int64_t budget_us;
+
+  /// Number of warnings for the same callback type not reported since the
+  /// last reported one, because of rate limiting.
+  uint32_t suppressed_count;
+};
+
+/// Callback invoked when a callback invocation exceeds its budget. This is
+/// invoked synchronously on the thread which invoked the slow callback, right
+/// after it returned, so it must return quickly.
+using mrsCallbackWarningCallback =
+    void(MRS_CALL*)(void* user_data, const mrsCallbackWarningInfo* info);
+
+/// Histogram of the durations of the invocations of a callback type.
+struct mrsCallbackHistogram {
+  /// Number of histogram buckets.
+  static constexpr int kBucketCount = 24;
+
+  /// Number of invocations recorded.
+  uint64_t count;
+
+  /// Sum of all durations, in microseconds, to compute the mean.
+  uint64_t total_us;
+
+  /// Maximum duration, in microseconds.
+  uint64_t max_us;
+
+  /// Number of invocations which exceeded the budget.
+  uint64_t over_budget_count;
+
+  /// Number of invocations per duration bucket, on a logarithmic scale. The
+  /// first bucket counts durations below 1 microsecond, and the bucket at
+  /// index i > 0 counts durations in [2^(i-1) : 2^i[ microseconds, except the
+  /// last bucket which also counts all larger durations.
+  uint64_t buckets[kBucketCount];
+};
+
+/// Start timing all user callback invocations, and reporting those exceeding
+/// the budget of the given configuration. If already started, this updates the
+/// configuration without resetting the histograms. When stopped, each
+/// invocation only costs a relaxed atomic load.
+MRS_API mrsResult MRS_CALL
+mrsCallbackWatchdogStart(const mrsCallbackWatchdogConfig* config) noexcept;
+
+/// Stop timing user callback invocations. The histograms remain available.
+MRS_API mrsResult MRS_CALL mrsCallbackWatchdogStop() noexcept;
+
+/// Register a callback invoked when a callback invocation exceeds its budget,
+/// in addition to the warning logged. Pass a null |callback| to unregister.
+MRS_API void MRS_CALL
+mrsCallbackWatchdogRegisterWarningCallback(mrsCallbackWarningCallback callback,
+                                           void* user_data) noexcept;
+
+/// Get the histogram of the invocation durations of the given callback type,
+/// and optionally reset it.
+MRS_API mrsResult MRS_CALL
+mrsCallbackWatchdogGetHistogram(mrsCallbackType type,
+                                mrsBool reset,
+                                mrsCallbackHistogram* histogram) noexcept;
+
+}  // extern "C"
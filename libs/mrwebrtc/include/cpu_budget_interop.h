@@ -0,0 +1,121 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include "export.h"
+#include "interop_api.h"
+
+extern "C" {
+
+/// Configuration of the CPU budget manager.
+struct mrsCpuBudgetConfig {
+  /// Target CPU usage of the process, in percent of the total capacity of all
+  /// the cores of the machine, in ]0:100].
+  float target_cpu_percent{80.0f};
+
+  /// Interval in milliseconds between two adaptations.
+  int32_t interval_ms{1000};
+
+  /// Lowest quality a peer connection can be degraded to, as a fraction of the
+  /// full quality in ]0:1].
+  float min_quality{0.1f};
+
+  /// Frame rate of the video senders at full quality.
+  int32_t max_framerate{30};
+
+  /// Bitrate of each video sender at full quality, in bits per second, for the
+  /// peer connections without a maximum bitrate set with
+  /// |mrsPeerConnectionSetBitrate()|.
+  int32_t max_bitrate_bps{2000000};
+};
+
+/// Current state of the CPU budget manager.
+struct mrsCpuBudgetStatus {
+  /// Whether the manager is running.
+  mrsBool running;
+
+  /// CPU usage of the process during the last interval, in percent of the
+  /// total capacity of all the cores of the machine, or a negative value if
+  /// not measured yet or not available on this platform.
+  float cpu_percent;
+
+  /// Global quality level, as a fraction of the full quality. This is the
+  /// quality of each peer connection if all have the same weight.
+  float quality;
+
+  /// Number of peer connections sharing the budget.
+  uint32_t peer_connection_count;
+};
+
+/// Share of the CPU budget allocated to a peer connection, and the limits
+/// applied to its video senders as a result.
+struct mrsCpuBudgetAllocation {
+  /// Priority weight of the peer connection.
+  float weight;
+
+  /// Quality allocated to the peer connection, as a fraction of the full
+  /// quality. This is 1 while the manager is not running.
+  float quality;
+
+  /// Factor the resolution of the video senders is scaled down by, or 1 if
+  /// not scaled down.
+  double scale_resolution_down_by;
+
+  /// Maximum frame rate of the video senders, or zero if not limited.
+  int32_t max_framerate;
+
+  /// Maximum bitrate of each video sender, in bits per second, or zero if not
+  /// limited.
+  int32_t max_bitrate_bps;
+
+  /// Number of video senders with a local track the limits were last applied
+  /// to.
+  uint32_t video_sender_count;
+
+  /// Whether the WebRTC implementation accepted the resolution limit. If not,
+  /// the encoder relies on its own CPU overuse detection to adapt the
+  /// resolution, and |scale_resolution_down_by| is 1.
+  mrsBool resolution_scaling_supported;
+
+  /// Whether the WebRTC implementation accepted the frame rate limit. If not,
+  /// only the bitrate is limited, and |max_framerate| is zero.
+  mrsBool framerate_limit_supported;
+};
+
+/// Start the CPU budget manager, or restart it with a new configuration.
+///
+/// While running, the manager measures the CPU usage of the process at a fixed
+/// interval, and adjusts a global quality level to converge on the target
+/// usage: the level decreases proportionally to the overuse, and increases
+/// slowly once the usage is back below the target, so that all streams do not
+/// oscillate together. The global level is shared among peer connections
+/// according to their priority weights, and each share is converted into
+/// resolution, frame rate and bitrate limits on the RTP senders of all the
+/// video transceivers with a local track, with
+/// |webrtc::RtpSenderInterface::SetParameters()|.
+///
+/// The manager is stopped automatically when the library shuts down.
+MRS_API mrsResult MRS_CALL
+mrsCpuBudgetStart(const mrsCpuBudgetConfig* config) noexcept;
+
+/// Stop the CPU budget manager, and remove the limits it applied.
+MRS_API mrsResult MRS_CALL mrsCpuBudgetStop() noexcept;
+
+/// Get the current state of the CPU budget manager.
+MRS_API mrsResult MRS_CALL
+mrsCpuBudgetGetStatus(mrsCpuBudgetStatus* status) noexcept;
+
+/// Set the priority weight of a peer connection, strictly positive. The budget
+/// is shared among peer connections proportionally to their weights; the
+/// default weight is 1.
+MRS_API mrsResult MRS_CALL
+mrsPeerConnectionSetCpuBudgetWeight(mrsPeerConnectionHandle peer_handle,
+                                    float weight) noexcept;
+
+/// Get the share of the CPU budget currently allocated to a peer connection.
+MRS_API mrsResult MRS_CALL mrsPeerConnectionGetCpuBudgetAllocation(
+    mrsPeerConnectionHandle peer_handle,
+    mrsCpuBudgetAllocation* allocation) noexcept;
+
+}  // extern "C"
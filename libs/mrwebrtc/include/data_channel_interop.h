@@ -4,6 +4,7 @@
 #pragma once
 
 #include "interop_api.h"
+#include "object_interop.h"
 
 extern "C" {
 /// Data channel state as marshaled through the public API.
@@ -90,4 +91,11 @@ mrsDataChannelSendMessage(mrsDataChannelHandle data_channel_handle,
                           const void* data,
                           uint64_t size) noexcept;
 
+/// Get the performance counters of the given data channel. Messages are
+/// counted as frames, and a message rejected by |mrsDataChannelSendMessage()|
+/// is counted as dropped.
+MRS_API mrsResult MRS_CALL
+mrsDataChannelGetMetrics(mrsDataChannelHandle data_channel_handle,
+                         mrsObjectMetrics* metrics) noexcept;
+
 }  // extern "C"
@@ -0,0 +1,55 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include "export.h"
+#include "interop_api.h"
+
+extern "C" {
+
+/// Video codec of an encoded video frame.
+enum class mrsVideoCodec : int32_t {
+  kUnknown = 0,
+  kVP8 = 1,
+  kVP9 = 2,
+  kH264 = 3,
+};
+
+/// View over an encoded video frame, as sent over RTP before packetization or
+/// received after depacketization.
+struct mrsEncodedVideoFrame {
+  /// Codec the frame is encoded with.
+  mrsVideoCodec codec;
+
+  /// Whether the frame is a key frame, which can be decoded without any of the
+  /// frames before it.
+  mrsBool is_key_frame;
+
+  /// RTP timestamp of the frame, in units of the 90 kHz video clock.
+  uint32_t rtp_timestamp;
+
+  /// Frame resolution in pixels. This is only known for key frames, and zero
+  /// otherwise.
+  uint32_t width;
+  uint32_t height;
+
+  /// Local time the frame was received at, in milliseconds on the monotonic
+  /// clock of the library. This allows synchronizing the frames of several
+  /// tracks.
+  int64_t receive_time_ms;
+
+  /// Encoded payload, in the bitstream format of the codec. H.264 frames are
+  /// in Annex B format, with start codes before each NAL unit.
+  const void* data;
+
+  /// Size of the encoded payload, in bytes.
+  uint32_t size;
+};
+
+/// Callback invoked when an encoded video frame is available. The frame is
+/// only valid for the duration of the call.
+using mrsEncodedVideoFrameCallback =
+    void(MRS_CALL*)(void* user_data, const mrsEncodedVideoFrame& frame);
+
+}  // extern "C"
@@ -0,0 +1,50 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include "encoded_frame_interop.h"
+#include "export.h"
+#include "interop_api.h"
+
+extern "C" {
+
+/// Handle to a video track source producing already encoded video frames.
+using mrsEncodedVideoTrackSourceHandle = mrsVideoTrackSourceHandle;
+
+/// Callback invoked when the video senders of an encoded video track source
+/// need a key frame, for example when a remote peer joins or lost some frames.
+/// Until the next key frame is pushed, the senders skip the delta frames, and
+/// further requests are not reported again.
+using mrsKeyFrameRequestedCallback = void(MRS_CALL*)(void* user_data);
+
+/// Create a video track source producing already encoded video frames, like
+/// recorded clips or the output of a hardware encoder. Local video tracks
+/// created from the source with |mrsLocalVideoTrackCreateFromSource()| send
+/// the frames pushed with |mrsEncodedVideoTrackSourcePushFrame()| as is,
+/// without running any video encoder.
+///
+/// The codec negotiated by the video senders must be the codec of the frames
+/// pushed, for example by filtering the SDP offers with |mrsSdpForceCodecs()|;
+/// frames of another codec are dropped. The bitrate of the stream is not
+/// adapted to the bandwidth estimation. This is not supported on UWP, where the
+/// codec factories are not under the control of the library.
+///
+/// This returns a handle to a newly allocated object, which must be released
+/// once not used anymore with |mrsRefCountedObjectRemoveRef()|.
+MRS_API mrsResult MRS_CALL mrsEncodedVideoTrackSourceCreate(
+    mrsKeyFrameRequestedCallback callback,
+    void* user_data,
+    mrsEncodedVideoTrackSourceHandle* source_handle_out) noexcept;
+
+/// Push a complete encoded video frame to the video senders of the source. The
+/// frame resolution is required for key frames, and ignored otherwise; its RTP
+/// timestamp and receive time are ignored. |timestamp_ms| is the capture time
+/// of the frame, on the same clock as |mrsEncodedVideoFrame::receive_time_ms|.
+/// The frame data is copied, and can be released once this function returns.
+MRS_API mrsResult MRS_CALL mrsEncodedVideoTrackSourcePushFrame(
+    mrsEncodedVideoTrackSourceHandle source_handle,
+    const mrsEncodedVideoFrame* frame,
+    int64_t timestamp_ms) noexcept;
+
+}  // extern "C"
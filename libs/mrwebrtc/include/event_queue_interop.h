@@ -0,0 +1,138 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include "callback_watchdog_interop.h"
+#include "export.h"
+#include "interop_api.h"
+
+extern "C" {
+
+/// Delivery mode of the events raised by the library to user callbacks.
+enum class mrsEventDeliveryMode : int32_t {
+  /// Callbacks are invoked directly on the WebRTC thread raising the event.
+  /// This is the default.
+  kDirect = 0,
+
+  /// Events are queued, and the application drains them with
+  /// |mrsPollEvents()| from a thread of its choice. Callbacks registered by the
+  /// application are not invoked; their user data is reported in each event.
+  kPolled = 1,
+
+  /// Events are queued, and dispatched to the registered callbacks on a pool
+  /// of threads managed by the library.
+  kDispatched = 2,
+};
+
+/// Configuration of the event queue.
+struct mrsEventQueueConfig {
+  /// Delivery mode of the events.
+  mrsEventDeliveryMode mode{mrsEventDeliveryMode::kDirect};
+
+  /// Number of dispatch threads in |mrsEventDeliveryMode::kDispatched| mode.
+  /// Events raised by a given object are always dispatched on the same thread,
+  /// in the order they were raised.
+  uint32_t dispatch_thread_count{1};
+
+  /// Maximum number of frame events pending delivery per queue. Once reached,
+  /// new frame events are dropped until the queue is drained. Other events are
+  /// never dropped.
+  uint32_t max_pending_frames{64};
+};
+
+/// Event raised by the library, queued instead of invoking the corresponding
+/// user callback directly. The arguments of the callback are reported in the
+/// fields below, depending on |type|:
+/// - |kI420AVideoFrame|: |data| is a |const mrsI420AVideoFrame*|.
+/// - |kArgb32VideoFrame|: |data| is a |const mrsArgb32VideoFrame*|.
+/// - |kAudioFrame|: |data| is a |const mrsAudioFrame*|.
+/// - |kLocalSdpReadyToSend|: |args[0]| is the |mrsSdpMessageType|, and |data|
+///   the null-terminated SDP message.
+/// - |kIceCandidateReadyToSend|: |data| is a |const mrsIceCandidate*|.
+/// - |kIceStateChanged|: |args[0]| is the |mrsIceConnectionState|.
+/// - |kIceGatheringStateChanged|: |args[0]| is the |mrsIceGatheringState|.
+/// - |kRenegotiationNeeded|, |kConnected| and |kKeyFrameRequested|: no
+///   argument.
+/// - |kTransceiverAdded|: |data| is a |const mrsTransceiverAddedInfo*|.
+/// - |kAudioTrackAdded|: |data| is a |const mrsRemoteAudioTrackAddedInfo*|.
+/// - |kVideoTrackAdded|: |data| is a |const mrsRemoteVideoTrackAddedInfo*|.
+/// - |kAudioTrackRemoved| and |kVideoTrackRemoved|: |handles[0]| is the remote
+///   track, and |handles[1]| the transceiver.
+/// - |kDataChannelAdded|: |data| is a |const mrsDataChannelAddedInfo*|.
+/// - |kDataChannelRemoved|: |handles[0]| is the data channel.
+/// - |kTransceiverAssociated|: |args[0]| is the media line index.
+/// - |kTransceiverStateUpdated|: |args[0]| is the
+///   |mrsTransceiverStateUpdatedReason|, |args[1]| the negotiated
+///   |mrsTransceiverOptDirection|, and |args[2]| the desired
+///   |mrsTransceiverDirection|.
+/// Callbacks registered on a data channel itself, like its message callback,
+/// and the encoded frame callbacks, whose frames are only valid during the
+/// call, are always invoked directly.
+struct mrsEvent {
+  /// Type of the callback the event is delivered to.
+  mrsCallbackType type;
+
+  /// Handle of the object which raised the event, like the peer connection
+  /// for connection events, or the track for frame events. This handle is not
+  /// kept alive by the event; it is only valid as long as the application keeps
+  /// its own reference to the object.
+  void* object_handle;
+
+  /// User data registered with the callback.
+  void* user_data;
+
+  /// Integer arguments, as listed above.
+  int64_t args[3];
+
+  /// Object handle arguments, as listed above.
+  void* handles[2];
+
+  /// Pointer to the argument data, as listed above.
+  const void* data;
+};
+
+/// Set the configuration of the event queue. This can only be changed while
+/// the library is not initialized, otherwise the function returns
+/// |mrsResult::kInvalidOperation|. Any event still pending is discarded.
+///
+/// In |mrsEventDeliveryMode::kDispatched| mode the dispatch threads run until
+/// the mode is changed, so the mode must be set back to
+/// |mrsEventDeliveryMode::kDirect| before unloading the library.
+MRS_API mrsResult MRS_CALL
+mrsEventQueueSetConfig(const mrsEventQueueConfig* config) noexcept;
+
+/// Get the current configuration of the event queue.
+MRS_API mrsResult MRS_CALL
+mrsEventQueueGetConfig(mrsEventQueueConfig* config) noexcept;
+
+/// Drain up to |max_count| pending events into |events| in
+/// |mrsEventDeliveryMode::kPolled| mode, and set |count| to the number of
+/// events copied. Events raised by a given object are drained in the order
+/// they were raised. This must not be called concurrently from several threads.
+///
+/// The data pointed to by the events, and the remote tracks and transceivers
+/// they reference, are kept alive until the next call to this function, so
+/// that a whole batch can be processed with a single call. Call with a zero
+/// |max_count| to release the last batch without draining more events. Data
+/// channels are not reference-counted, so their handles are only valid until
+/// they are removed from their peer connection.
+///
+/// Returns |mrsResult::kInvalidOperation| if the queue is not in polled mode.
+MRS_API mrsResult MRS_CALL mrsPollEvents(mrsEvent* events,
+                                         uint32_t max_count,
+                                         uint32_t* count) noexcept;
+
+/// In |mrsEventDeliveryMode::kDispatched| mode, dispatch all the events queued
+/// so far before returning. Events queued before a callback is unregistered
+/// can still be dispatched to it afterward, so call this after unregistering
+/// callbacks and before releasing their user data. This can be called from a
+/// dispatched callback, but not concurrently with |mrsEventQueueSetConfig()|.
+/// This does nothing in other modes.
+MRS_API mrsResult MRS_CALL mrsEventQueueFlush() noexcept;
+
+/// Get the number of frame events dropped since the configuration was last set,
+/// because the application did not drain the queue fast enough.
+MRS_API uint64_t MRS_CALL mrsEventQueueGetDroppedFrameCount() noexcept;
+
+}  // extern "C"
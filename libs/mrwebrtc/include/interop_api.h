@@ -60,6 +60,73 @@ mrsSetShutdownOptions(mrsShutdownOptions options) noexcept;
 /// loss of data is acceptable.
 MRS_API void MRS_CALL mrsForceShutdown() noexcept;
 
+/// Get the number of factory shards the library uses or will use when
+/// initialized. See |mrsSetFactoryShardCount()|.
+MRS_API uint32_t MRS_CALL mrsGetFactoryShardCount() noexcept;
+
+/// Set the number of factory shards, in [1:64], created the next time the
+/// library is initialized. By default the library has a single shard. Each
+/// shard owns a network, a worker and a signaling thread, and a peer connection
+/// factory, so that many peer connections can be processed in parallel instead
+/// of saturating a single set of threads. Peer connections are assigned to
+/// shards on creation, see |mrsPeerConnectionConfiguration::factory_shard|.
+/// Local tracks and sources are always created on the first shard, but can be
+/// used by peer connections of any shard. Each shard also creates its own
+/// audio device module, so devices should only be used with a single shard.
+///
+/// Returns |mrsResult::kInvalidOperation| if the library is initialized with a
+/// different number of shards, and |mrsResult::kUnsupported| for more than one
+/// shard on UWP.
+MRS_API mrsResult MRS_CALL mrsSetFactoryShardCount(uint32_t count) noexcept;
+
+/// Callback invoked when the library finished initializing in the background,
+/// successfully or not.
+using mrsLibraryInitializedCallback = void(MRS_CALL*)(void* user_data,
+                                                      mrsResult result);
+
+/// Initialize the library on a background thread, so that the first peer
+/// connection or track source created does not block on starting the WebRTC
+/// threads and creating the peer connection factories. |callback|, if not
+/// NULL, is invoked on that background thread once done.
+///
+/// The library is normally initialized on demand and shut down automatically
+/// once all objects are released. When initialized by this function, it stays
+/// initialized until the first object is created, after which that automatic
+/// shutdown applies again, or until |mrsForceShutdown()| is called.
+///
+/// Returns |mrsResult::kInvalidOperation| if called from |callback|.
+MRS_API mrsResult MRS_CALL
+mrsLibraryInitializeAsync(mrsLibraryInitializedCallback callback,
+                          void* user_data) noexcept;
+
+/// Time spent in each phase of the last library initializing, summed over all
+/// factory shards. All durations are in microseconds.
+struct mrsLibraryInitStats {
+  /// Creating and starting the WebRTC threads, and applying their scheduling
+  /// configuration.
+  int64_t threads_us{0};
+
+  /// Creating the audio and video codec factories. Codecs themselves are only
+  /// created when a connection starts using them.
+  int64_t codec_factories_us{0};
+
+  /// Creating the peer connection factories, which includes initializing the
+  /// audio device modules and the audio mixers.
+  int64_t peer_connection_factory_us{0};
+
+  /// Total time spent initializing the library.
+  int64_t total_us{0};
+
+  /// Number of factory shards initialized.
+  uint32_t shard_count{0};
+};
+
+/// Get the time spent in each phase of the last library initializing, to
+/// diagnose start-up delays. Returns |mrsResult::kNotFound| if the library was
+/// never initialized.
+MRS_API mrsResult MRS_CALL
+mrsLibraryGetInitStats(mrsLibraryInitStats* stats) noexcept;
+
 /// Opaque enumerator type.
 struct mrsEnumerator;
 
@@ -402,6 +469,9 @@ using mrsArgb32VideoFrame = Microsoft::MixedReality::WebRTC::Argb32VideoFrame;
 using mrsArgb32VideoFrameCallback =
     void(MRS_CALL*)(void* user_data, const mrsArgb32VideoFrame& frame);
 
+using mrsVideoLatencyHistogram =
+    Microsoft::MixedReality::WebRTC::VideoLatencyHistogram;
+
 using mrsAudioFrame = Microsoft::MixedReality::WebRTC::AudioFrame;
 
 /// Callback invoked when a local or remote (depending on use) audio frame is
@@ -470,6 +540,10 @@ struct mrsPeerConnectionConfiguration {
   /// SDP semantic for connection negotiation.
   /// Do not use Plan B unless there is a problem with Unified Plan.
   mrsSdpSemantic sdp_semantic = mrsSdpSemantic::kUnifiedPlan;
+
+  /// Factory shard running the connection, modulo the number of shards, or -1
+  /// to assign shards round-robin. See |mrsSetFactoryShardCount()|.
+  int32_t factory_shard = -1;
 };
 
 /// Create a peer connection and return a handle to it.
@@ -776,6 +850,12 @@ mrsPeerConnectionSetBitrate(mrsPeerConnectionHandle peer_handle,
                             int start_bitrate_bps,
                             int max_bitrate_bps) noexcept;
 
+/// Get the index of the factory shard running a peer connection, selected on
+/// creation. See |mrsPeerConnectionConfiguration::factory_shard|.
+MRS_API mrsResult MRS_CALL
+mrsPeerConnectionGetFactoryShard(mrsPeerConnectionHandle peer_handle,
+                                 uint32_t* shard) noexcept;
+
 /// Callback invoked when |mrsPeerConnectionSetRemoteDescriptionAsync()|
 /// completed, successfully or not. The |error_message| parameter is only
 /// relevant if |result| contains an error code.
@@ -800,6 +880,26 @@ MRS_API mrsResult MRS_CALL mrsPeerConnectionSetRemoteDescriptionAsync(
 MRS_API mrsResult MRS_CALL
 mrsPeerConnectionClose(mrsPeerConnectionHandle peer_handle) noexcept;
 
+/// Callback invoked once all the peer connections passed to
+/// |mrsPeerConnectionCloseMany()| are closed.
+using mrsPeerConnectionsClosedCallback = void(MRS_CALL*)(void* user_data);
+
+/// Close several peer connections at once, like |mrsPeerConnectionClose()|,
+/// and invoke |callback| once all are closed. This is faster than closing them
+/// one by one, in particular with several factory shards, which close their
+/// connections in parallel. The function returns without waiting.
+///
+/// The handles must stay valid until |callback| is invoked. The callback is
+/// invoked on a WebRTC signaling thread, so like other peer connection
+/// callbacks it must not release the last reference to a peer connection;
+/// release the handles from another thread once it was invoked. If |count| is
+/// zero, |callback| is invoked before this function returns.
+MRS_API mrsResult MRS_CALL
+mrsPeerConnectionCloseMany(const mrsPeerConnectionHandle* peer_handles,
+                           uint32_t count,
+                           mrsPeerConnectionsClosedCallback callback,
+                           void* user_data) noexcept;
+
 //
 // SDP utilities
 //
@@ -974,6 +1074,23 @@ struct mrsTransportStats {
   uint64_t bytes_received;
 };
 
+/// Type of simple stats object, used to query all the objects of a given type
+/// from a stats report with |mrsStatsReportGetSimpleStats()|.
+enum class mrsStatsType : int32_t {
+  /// Array of |mrsDataChannelStats|.
+  kDataChannel = 0,
+  /// Array of |mrsAudioSenderStats|.
+  kAudioSender = 1,
+  /// Array of |mrsAudioReceiverStats|.
+  kAudioReceiver = 2,
+  /// Array of |mrsVideoSenderStats|.
+  kVideoSender = 3,
+  /// Array of |mrsVideoReceiverStats|.
+  kVideoReceiver = 4,
+  /// Array of |mrsTransportStats|.
+  kTransport = 5,
+};
+
 /// Handle to a WebRTC stats report.
 using mrsStatsReportHandle = const void*;
 
@@ -989,11 +1106,25 @@ using mrsStatsReportGetObjectCallback =
 /// Get a stats report for the connection.
 /// The report passed to the callback must be released when finished through
 /// mrsStatsReportRemoveRef.
+///
+/// Requests made while another collection is in progress share the report of
+/// that collection. If a maximum age was set with
+/// |mrsPeerConnectionSetStatsMaxAge()|, requests made within that age of the
+/// last report are completed from that cached report. In all cases the
+/// callback is invoked asynchronously on the WebRTC signaling thread.
 MRS_API mrsResult MRS_CALL mrsPeerConnectionGetSimpleStats(
     mrsPeerConnectionHandle peer_handle,
     mrsPeerConnectionGetSimpleStatsCallback callback,
     void* user_data);
 
+/// Set the maximum age in milliseconds of a cached stats report for it to be
+/// reused by |mrsPeerConnectionGetSimpleStats()| instead of starting a new
+/// stats collection. This allows several independent consumers to poll stats
+/// without each triggering a full collection. Zero (default) disables caching.
+MRS_API mrsResult MRS_CALL
+mrsPeerConnectionSetStatsMaxAge(mrsPeerConnectionHandle peer_handle,
+                                int32_t max_age_ms) noexcept;
+
 /// Get all the instances of the requested stats type.
 /// The type must be one of "DataChannelStats", "AudioSenderStats",
 /// "AudioReceiverStats", "VideoSenderStats", "VideoReceiverStats",
@@ -1004,8 +1135,152 @@ mrsStatsReportGetObjects(mrsStatsReportHandle report_handle,
                          mrsStatsReportGetObjectCallback callback,
                          void* user_data);
 
+/// Get all the instances of the requested stats type as a contiguous array.
+///
+/// On success, |objects_out| receives a pointer to an array of |*count_out|
+/// elements of the struct type associated with |stats_type| (for example
+/// |mrsVideoSenderStats| for |mrsStatsType::kVideoSender|). The array is owned
+/// by the report and stays valid until the report is released with
+/// |mrsStatsReportRemoveRef()|. If the report contains no object of that type,
+/// |objects_out| may be null and |*count_out| is zero.
+///
+/// All simple stats types are extracted in a single pass the first time any of
+/// them is queried on a given report; subsequent queries are constant time.
+MRS_API mrsResult MRS_CALL
+mrsStatsReportGetSimpleStats(mrsStatsReportHandle report_handle,
+                             mrsStatsType stats_type,
+                             const void** objects_out,
+                             uint64_t* count_out) noexcept;
+
+/// Serialize a whole stats report to JSON, giving access to all stats types
+/// and members, including the ones not exposed by the simple stats structs
+/// (candidate pairs, codecs, ...).
+///
+/// The output is a JSON array of stats objects, each serialized with all its
+/// defined members, for example:
+///   [{"type":"transport","id":"...","timestamp":123,"bytesSent":456,...},...]
+///
+/// |type_filter| is an optional comma-separated list of stats types, as
+/// defined by https://www.w3.org/TR/webrtc-stats/#rtcstatstype-str* (for
+/// example "candidate-pair,codec"). If not null nor empty, only stats objects
+/// of those types are serialized.
+///
+/// The caller must provide a buffer with a sufficent size to copy the string
+/// to, including a null terminator character. The |buffer| argument points to
+/// the raw buffer, and the |buffer_size| to the capacity of the buffer, in
+/// bytes. On return, if the buffer has enough capacity for the string and its
+/// null terminator, the string is copied to the buffer, and the actual buffer
+/// size consumed (including null terminator) is returned in |buffer_size|. If
+/// not, then the function returns |mrsResult::kBufferTooSmall|, and
+/// |buffer_size| contains the total size that the buffer would need for the
+/// call to succeed, such that the caller can retry with a buffer with that
+/// capacity. The serialized string is cached by the report, so retrying with
+/// the same filter does not serialize the report again.
+MRS_API mrsResult MRS_CALL
+mrsStatsReportToJson(mrsStatsReportHandle report_handle,
+                     const char* type_filter,
+                     char* buffer,
+                     uint64_t* buffer_size) noexcept;
+
 /// Release a stats report.
 MRS_API mrsResult MRS_CALL
 mrsStatsReportRemoveRef(mrsStatsReportHandle stats_report);
 
+//
+// Stats sampling.
+//
+
+/// Configuration of the periodic stats sampler of a peer connection.
+struct mrsStatsSamplerConfig {
+  /// Interval between two consecutive samples, in milliseconds.
+  int32_t interval_ms{1000};
+
+  /// Number of recent samples kept to compute the series summaries.
+  int32_t history_size{60};
+};
+
+/// Summary of a series of sampled values over the sampler history.
+struct mrsStatsSeriesSummary {
+  /// Most recent value.
+  double last;
+  /// Minimum value over the history.
+  double min;
+  /// Maximum value over the history.
+  double max;
+  /// Median value over the history.
+  double p50;
+  /// 95th percentile value over the history.
+  double p95;
+};
+
+/// Aggregated snapshot computed by the periodic stats sampler. Rates are
+/// computed over the last sampling interval and aggregated over all streams
+/// of the peer connection.
+struct mrsStatsSamplerSnapshot {
+  /// Timestamp of the most recent stats report, in microseconds.
+  int64_t timestamp_us;
+
+  /// Number of samples currently in the history, at most the configured
+  /// |mrsStatsSamplerConfig::history_size|. Zero until two reports have been
+  /// collected, in which case all other values are zero too.
+  uint32_t sample_count;
+
+  double bytes_sent_per_sec;
+  double bytes_received_per_sec;
+  double packets_sent_per_sec;
+  double packets_received_per_sec;
+
+  /// Ratio in [0:1] of packets lost over packets expected during the last
+  /// sampling interval, for all received streams.
+  double packet_loss_rate;
+
+  /// Inter-arrival jitter of the worst received stream, in milliseconds.
+  mrsStatsSeriesSummary jitter_ms;
+
+  /// Round-trip time of the nominated ICE candidate pair, in milliseconds.
+  mrsStatsSeriesSummary rtt_ms;
+
+  /// Total frame rate of all local video tracks sent.
+  mrsStatsSeriesSummary video_frames_sent_per_sec;
+
+  /// Total frame rate of all remote video tracks received.
+  mrsStatsSeriesSummary video_frames_received_per_sec;
+
+  /// Total number of on-demand key frame requests of the video tracks of the
+  /// peer connection, with |mrsRemoteVideoTrackRequestKeyFrame()| and
+  /// |mrsLocalVideoTrackForceKeyFrame()|, and number of those completed.
+  uint64_t key_frames_requested;
+  uint64_t key_frames_completed;
+
+  /// Longest delay of the on-demand key frame requests completed during each
+  /// sampling interval, in milliseconds; the intervals without any keep the
+  /// previous value. For remote tracks, this is the delay until the key frame
+  /// is received, typically a round trip. For local tracks, this is the delay
+  /// until the key frame is encoded, or requested from the upstream sender of
+  /// forwarded and encoded video track sources.
+  mrsStatsSeriesSummary key_frame_delay_ms;
+};
+
+/// Start sampling the stats of a peer connection at a fixed interval. The
+/// sampler runs on the WebRTC signaling thread, and does not invoke any user
+/// callback; use |mrsPeerConnectionGetStatsSnapshot()| to read the latest
+/// aggregated values. Starting a sampler while another one is running for the
+/// same peer connection replaces the old one and resets the history. The
+/// sampler stops automatically when the peer connection is closed.
+MRS_API mrsResult MRS_CALL
+mrsPeerConnectionStartStatsSampler(mrsPeerConnectionHandle peer_handle,
+                                   const mrsStatsSamplerConfig* config) noexcept;
+
+/// Stop the periodic stats sampler of a peer connection, if running. The last
+/// snapshot remains available.
+MRS_API mrsResult MRS_CALL
+mrsPeerConnectionStopStatsSampler(mrsPeerConnectionHandle peer_handle) noexcept;
+
+/// Get the latest aggregated snapshot of the periodic stats sampler of a peer
+/// connection. This returns |mrsResult::kInvalidOperation| if the sampler was
+/// never started.
+MRS_API mrsResult MRS_CALL
+mrsPeerConnectionGetStatsSnapshot(mrsPeerConnectionHandle peer_handle,
+                                  mrsStatsSamplerSnapshot* snapshot) noexcept;
+
 }  // extern "C"
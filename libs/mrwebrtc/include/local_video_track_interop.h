@@ -48,4 +48,23 @@ mrsLocalVideoTrackSetEnabled(mrsLocalVideoTrackHandle track_handle,
 MRS_API mrsBool MRS_CALL
 mrsLocalVideoTrackIsEnabled(mrsLocalVideoTrackHandle track_handle) noexcept;
 
+/// Force the encoder of a local video track to encode its next frame as a key
+/// frame, for example when a new remote peer starts rendering it, instead of
+/// waiting for the remote peer to request one. For tracks of forwarded and
+/// encoded video track sources, which are not encoded, a key frame is instead
+/// requested from their upstream sender or application.
+///
+/// The track must be added to a peer connection, otherwise this returns
+/// |mrsResult::kInvalidOperation|. Only the encoder of the sender of the track
+/// produces the key frame, even if other tracks share its source. A request
+/// still pending when the track is removed from its peer connection is
+/// dropped.
+///
+/// The delay until the key frame is encoded is reported by the stats sampler
+/// of the peer connection of the track; see |mrsStatsSamplerSnapshot|. This is
+/// not supported on UWP, where the codec factories are not under the control
+/// of the library.
+MRS_API mrsResult MRS_CALL mrsLocalVideoTrackForceKeyFrame(
+    mrsLocalVideoTrackHandle track_handle) noexcept;
+
 }  // extern "C"
@@ -0,0 +1,107 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include "export.h"
+#include "interop_api.h"
+
+extern "C" {
+
+/// Handle to a media recorder writing remote tracks to disk.
+using mrsMediaRecorderHandle = mrsRefCountedObjectHandle;
+
+/// Container format of a video recording.
+enum class mrsVideoContainer : int32_t {
+  /// IVF, the simple container of the libvpx tools. Supports VP8, VP9 and, with
+  /// most readers, H.264.
+  kIvf = 0,
+
+  /// WebM, with a single video track. Supports VP8 and VP9.
+  kWebM = 1,
+};
+
+/// Configuration of a media recorder.
+struct mrsMediaRecorderConfig {
+  /// Size of the write buffer of each file, in bytes. The recorded data are
+  /// written to disk by the I/O thread of the recorder in chunks of about this
+  /// size.
+  uint32_t write_buffer_size{1024 * 1024};
+
+  /// Interval between two flushes of the files to the storage device, in
+  /// milliseconds, or zero to only flush them when the recording stops. This
+  /// bounds the amount of data lost on power failure, at the expense of
+  /// additional I/O.
+  int32_t sync_interval_ms{0};
+};
+
+/// Statistics of a media recorder.
+struct mrsMediaRecorderStats {
+  /// Number of bytes written to disk so far, for all files.
+  uint64_t bytes_written;
+
+  /// Number of encoded video frames recorded.
+  uint64_t video_frames_recorded;
+
+  /// Number of encoded video frames skipped, because they were received before
+  /// the first key frame of their track, or their codec is not supported by
+  /// the container.
+  uint64_t video_frames_skipped;
+
+  /// Number of audio samples recorded per channel, including the silence
+  /// inserted at the start of each audio track to synchronize it.
+  uint64_t audio_samples_recorded;
+
+  /// Number of failed writes. Once a write fails on a file, nothing more is
+  /// written to that file.
+  uint32_t write_errors;
+};
+
+/// Create a media recorder writing remote tracks to disk, without decoding or
+/// transcoding them. Each track is written to its own file, and the timestamps
+/// of all the files start at the creation time of the recorder, so that the
+/// tracks can be played back in sync.
+///
+/// This returns a handle to a newly allocated object, which must be released
+/// once not used anymore with |mrsRefCountedObjectRemoveRef()|. Releasing the
+/// recorder stops it.
+MRS_API mrsResult MRS_CALL
+mrsMediaRecorderCreate(const mrsMediaRecorderConfig* config,
+                       mrsMediaRecorderHandle* recorder_handle_out) noexcept;
+
+/// Record the encoded frames of a remote video track to a new file, starting
+/// from the first key frame received, which is requested from the remote
+/// sender; see |mrsRemoteVideoTrackRequestKeyFrame()|. Like with an encoded
+/// frame callback, the track is not decoded anymore unless a raw frame callback
+/// is registered on it; see
+/// |mrsRemoteVideoTrackRegisterEncodedFrameCallback()|.
+///
+/// This is not supported on UWP, where the codec factories are not under the
+/// control of the library.
+MRS_API mrsResult MRS_CALL
+mrsMediaRecorderAddVideoTrack(mrsMediaRecorderHandle recorder_handle,
+                              mrsRemoteVideoTrackHandle track_handle,
+                              const char* path,
+                              mrsVideoContainer container) noexcept;
+
+/// Record a remote audio track to a new WAV file, as 16-bit PCM. M71 does not
+/// expose the encoded audio frames, so the audio is recorded as decoded for
+/// playback, without any additional decoding or encoding. The sample rate and
+/// channel count of the file are the ones of the first audio frame; frames
+/// received later in another format are skipped.
+MRS_API mrsResult MRS_CALL
+mrsMediaRecorderAddAudioTrack(mrsMediaRecorderHandle recorder_handle,
+                              mrsRemoteAudioTrackHandle track_handle,
+                              const char* path) noexcept;
+
+/// Stop recording, and finalize and close all the files. The recorder cannot
+/// be restarted once stopped.
+MRS_API mrsResult MRS_CALL
+mrsMediaRecorderStop(mrsMediaRecorderHandle recorder_handle) noexcept;
+
+/// Get the statistics of a media recorder.
+MRS_API mrsResult MRS_CALL
+mrsMediaRecorderGetStats(mrsMediaRecorderHandle recorder_handle,
+                         mrsMediaRecorderStats* stats) noexcept;
+
+}  // extern "C"
@@ -0,0 +1,79 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include "export.h"
+#include "interop_api.h"
+
+extern "C" {
+
+/// Memory currently held by the library's own buffers, in bytes, by category.
+/// This only covers the buffers allocated by the library itself; the buffers
+/// internal to the WebRTC implementation, like the jitter buffers and the SCTP
+/// queues, are not included, except for the amount of data queued for sending
+/// on data channels.
+struct mrsMemoryUsage {
+  /// Scratch buffers of the video frame callbacks, like the ARGB32 conversion
+  /// buffers.
+  uint64_t video_frame_bytes;
+
+  /// Buffers of the audio track read buffers.
+  uint64_t audio_buffer_bytes;
+
+  /// Frame buffers pooled by the external video track sources.
+  uint64_t external_source_bytes;
+
+  /// Data queued for sending on the data channels, and not yet sent.
+  uint64_t data_channel_bytes;
+
+  /// Events pending delivery in the event queue, with their argument data.
+  uint64_t event_queue_bytes;
+
+  /// Sum of all categories above.
+  uint64_t total_bytes;
+};
+
+/// Callback invoked when the memory usage of an account exceeds its soft
+/// budget. |peer_handle| is the peer connection whose budget was exceeded, or
+/// null for the process-wide budget. The callback is invoked once each time the
+/// usage goes from at or below the budget to above it, on a dedicated thread
+/// shortly after the allocation which crossed the budget, unless the budget
+/// was changed meanwhile. Like other callbacks, it must not release the last
+/// reference to a peer connection.
+using mrsMemoryBudgetExceededCallback =
+    void(MRS_CALL*)(void* user_data,
+                    mrsPeerConnectionHandle peer_handle,
+                    uint64_t total_bytes);
+
+/// Get the memory usage of the whole process, including the buffers of the
+/// objects not owned by any peer connection, like local tracks and track
+/// sources.
+MRS_API mrsResult MRS_CALL mrsGetMemoryUsage(mrsMemoryUsage* usage) noexcept;
+
+/// Get the memory usage of a single peer connection, including its remote
+/// tracks, the read buffers of those tracks, and its data channels. Buffers
+/// still alive after the peer connection is destroyed, like the ones of a
+/// remote track still referenced by the application, are only reported by
+/// |mrsGetMemoryUsage()|.
+MRS_API mrsResult MRS_CALL
+mrsPeerConnectionGetMemoryUsage(mrsPeerConnectionHandle peer_handle,
+                                mrsMemoryUsage* usage) noexcept;
+
+/// Set a soft budget on the memory usage of the whole process, in bytes. The
+/// budget does not limit any allocation; it only invokes |callback| when
+/// exceeded. Set a zero budget to disable it.
+MRS_API mrsResult MRS_CALL
+mrsSetMemoryBudget(uint64_t budget_bytes,
+                   mrsMemoryBudgetExceededCallback callback,
+                   void* user_data) noexcept;
+
+/// Set a soft budget on the memory usage of a single peer connection, in bytes,
+/// with the same semantic as |mrsSetMemoryBudget()|.
+MRS_API mrsResult MRS_CALL
+mrsPeerConnectionSetMemoryBudget(mrsPeerConnectionHandle peer_handle,
+                                 uint64_t budget_bytes,
+                                 mrsMemoryBudgetExceededCallback callback,
+                                 void* user_data) noexcept;
+
+}  // extern "C"
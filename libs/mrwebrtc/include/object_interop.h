@@ -7,6 +7,41 @@
 
 extern "C" {
 
+/// Cumulative performance counters of an object since its creation. Objects
+/// only update the counters relevant to them, and leave the others to zero.
+struct mrsObjectMetrics {
+  /// Number of frames (video frames, audio frames, or data channel messages)
+  /// received by the object from its source.
+  uint64_t frames_in;
+
+  /// Number of frames delivered by the object to its consumers, user
+  /// callbacks or peer connection.
+  uint64_t frames_out;
+
+  /// Number of frames discarded by the object.
+  uint64_t frames_dropped;
+
+  /// Total time spent converting frames (pixel format conversion, resampling),
+  /// in microseconds.
+  uint64_t conversion_time_us;
+
+  /// Number of bytes sent.
+  uint64_t bytes_sent;
+
+  /// Number of bytes received.
+  uint64_t bytes_received;
+
+  /// Number of user callbacks invoked.
+  uint64_t callback_count;
+
+  /// Total time spent in user callbacks, in microseconds.
+  uint64_t callback_time_us;
+
+  /// Number of buffer overruns, where the object had to discard data because
+  /// its consumer did not keep up.
+  uint64_t overrun_count;
+};
+
 //
 // Object API
 //
@@ -56,4 +91,13 @@ MRS_API void MRS_CALL mrsObjectSetUserData(mrsObjectHandle handle,
 /// |nullptr|. This is not multithread-safe.
 MRS_API void* MRS_CALL mrsObjectGetUserData(mrsObjectHandle handle) noexcept;
 
+/// Get a snapshot of the performance counters of the object. This is
+/// multithread-safe, and cheap enough to be polled periodically, for example
+/// to find which track is the bottleneck in a production dashboard. Counters
+/// are read individually, so a snapshot taken while the object is in use may
+/// be slightly inconsistent across counters.
+MRS_API mrsResult MRS_CALL
+mrsObjectGetMetrics(mrsObjectHandle handle,
+                    mrsObjectMetrics* metrics) noexcept;
+
 }  // extern "C"
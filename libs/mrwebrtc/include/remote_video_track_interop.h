@@ -3,6 +3,7 @@
 
 #pragma once
 
+#include "encoded_frame_interop.h"
 #include "export.h"
 #include "interop_api.h"
 
@@ -24,6 +25,61 @@ MRS_API void MRS_CALL mrsRemoteVideoTrackRegisterArgb32FrameCallback(
     mrsArgb32VideoFrameCallback callback,
     void* user_data) noexcept;
 
+/// Register a custom callback to be called with the encoded frames received by
+/// the remote video track, before they are decoded, or unregister it if
+/// |callback| is NULL. While this callback is registered and no raw frame
+/// callback is, the frames are not decoded at all, which allows for example
+/// recording the track at no decoding cost.
+///
+/// The callback is invoked on the decoding thread, and must not register or
+/// unregister any encoded frame callback. Once this function returns after
+/// unregistering the callback, it is not invoked anymore.
+///
+/// The track is identified by the SDP stream of its receiver, so the
+/// connection must already be established. This is not supported on UWP,
+/// where the codec factories are not under the control of the library.
+MRS_API mrsResult MRS_CALL mrsRemoteVideoTrackRegisterEncodedFrameCallback(
+    mrsRemoteVideoTrackHandle track_handle,
+    mrsEncodedVideoFrameCallback callback,
+    void* user_data) noexcept;
+
+/// Enable or disable the decoding of a remote video track. While disabled, the
+/// frames received are dropped before being decoded, so no raw frame callback
+/// is invoked, but the encoded frame callback still is. Once enabled again,
+/// decoding resumes from the next key frame, which is requested from the
+/// remote peer. Decoding is enabled by default.
+///
+/// The track is identified by the SDP stream of its receiver, so the
+/// connection must already be established. This is not supported on UWP,
+/// where the codec factories are not under the control of the library.
+MRS_API mrsResult MRS_CALL
+mrsRemoteVideoTrackSetDecodeEnabled(mrsRemoteVideoTrackHandle track_handle,
+                                    mrsBool enabled) noexcept;
+
+/// Enable or disable the automatic decoding of a remote video track. In
+/// automatic mode, the track is only decoded while a raw frame callback is
+/// registered, so that the tracks not displayed cost no decoding. Decoding
+/// resumes from the next key frame when a raw frame callback is registered
+/// again, like with |mrsRemoteVideoTrackSetDecodeEnabled()|, which has
+/// precedence over this mode. Automatic decoding is disabled by default.
+///
+/// The same restrictions as |mrsRemoteVideoTrackSetDecodeEnabled()| apply.
+MRS_API mrsResult MRS_CALL
+mrsRemoteVideoTrackSetAutoDecode(mrsRemoteVideoTrackHandle track_handle,
+                                 mrsBool enabled) noexcept;
+
+/// Request a key frame from the remote sender of a remote video track, for
+/// example when the track starts being rendered or recorded, instead of
+/// waiting for the next periodic key frame. The request is sent as a picture
+/// loss indication by the decoder of the track on its next frame, and repeated
+/// until the key frame is received, which typically takes a round trip.
+///
+/// The delay until the key frame is received is reported by the stats sampler
+/// of the peer connection of the track; see |mrsStatsSamplerSnapshot|. The
+/// same restrictions as |mrsRemoteVideoTrackSetDecodeEnabled()| apply.
+MRS_API mrsResult MRS_CALL mrsRemoteVideoTrackRequestKeyFrame(
+    mrsRemoteVideoTrackHandle track_handle) noexcept;
+
 /// Enable or disable a remote video track. Enabled tracks output their media
 /// content as usual. Disabled tracks output some void media content (black
 /// video frames, silent audio frames). Enabling/disabling a track is a
@@ -37,4 +93,13 @@ mrsRemoteVideoTrackSetEnabled(mrsRemoteVideoTrackHandle track_handle,
 MRS_API mrsBool MRS_CALL
 mrsRemoteVideoTrackIsEnabled(mrsRemoteVideoTrackHandle track_handle) noexcept;
 
+/// Get the histogram of the capture-to-render latency of the frames received
+/// by a remote video track since it was created, or since the histogram was
+/// last reset if |reset| is |mrsBool::kTrue|. Only frames whose capture time is
+/// known are recorded; see |mrsI420AVideoFrame::capture_time_ntp_ms_|.
+MRS_API mrsResult MRS_CALL mrsRemoteVideoTrackGetLatencyHistogram(
+    mrsRemoteVideoTrackHandle track_handle,
+    mrsBool reset,
+    mrsVideoLatencyHistogram* histogram) noexcept;
+
 }  // extern "C"
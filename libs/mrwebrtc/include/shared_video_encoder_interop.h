@@ -0,0 +1,60 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include "export.h"
+#include "interop_api.h"
+
+extern "C" {
+
+/// Statistics of the shared video encoders, see
+/// |mrsSetSharedVideoEncoding()|.
+struct mrsSharedVideoEncoderStats {
+  /// Number of shared encoders currently running, one per bitrate tier of each
+  /// group of senders encoding the same frames.
+  uint32_t encoder_count;
+
+  /// Number of video senders currently fed by the shared encoders.
+  uint32_t sender_count;
+
+  /// Number of frames encoded by the shared encoders.
+  uint64_t frames_encoded;
+
+  /// Number of encoded images forwarded to the video senders. The ratio with
+  /// |frames_encoded| is the number of senders each encode was shared with.
+  uint64_t frames_delivered;
+
+  /// Number of key frames requested by the video senders.
+  uint64_t key_frame_requests;
+
+  /// Number of key frames the shared encoders were asked to produce. This is
+  /// lower than |key_frame_requests| when requests are aggregated.
+  uint64_t key_frames_encoded;
+};
+
+/// Enable or disable shared video encoding for the video senders created from
+/// now on. By default each video sender has its own encoder, so that a local
+/// video track added to N peer connections is encoded N times.
+///
+/// When enabled, the video senders which encode the same frames with the same
+/// codec, resolution and layer configuration share their encoders. Senders
+/// are split into bitrate tiers, each twice the bitrate of the previous one,
+/// and each frame is encoded once per tier, at the lowest bitrate of the
+/// senders of the tier. The encoded frames are packetized independently by
+/// each sender, and the key frames requested by any sender are produced for
+/// all the senders of its tier at once. A sender whose bitrate changes tier
+/// moves to the encoder of the new tier with a key frame. A sender which
+/// misses an encoded frame, for example because it dropped the raw frame,
+/// triggers a key frame to resynchronize.
+///
+/// Returns |mrsResult::kUnsupported| on UWP, where the video encoder factory is
+/// not under the control of the library.
+MRS_API mrsResult MRS_CALL mrsSetSharedVideoEncoding(mrsBool enabled) noexcept;
+
+/// Get the statistics of the shared video encoders, accumulated since the
+/// library was loaded.
+MRS_API mrsResult MRS_CALL
+mrsGetSharedVideoEncoderStats(mrsSharedVideoEncoderStats* stats) noexcept;
+
+}  // extern "C"
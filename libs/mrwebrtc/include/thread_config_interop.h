@@ -0,0 +1,100 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include "export.h"
+#include "interop_api.h"
+
+extern "C" {
+
+/// Role of a thread created by the library, to which a scheduling
+/// configuration applies.
+enum class mrsThreadRole : int32_t {
+  /// WebRTC network thread, one per factory shard.
+  kNetwork = 0,
+
+  /// WebRTC worker thread, one per factory shard, which runs the media engine
+  /// including audio processing and video encoding and decoding.
+  kWorker = 1,
+
+  /// WebRTC signaling thread, one per factory shard.
+  kSignaling = 2,
+
+  /// Capture thread of an external video track source, one per source.
+  kCapture = 3,
+};
+
+/// Scheduling configuration of the threads of a given role.
+struct mrsThreadConfig {
+  /// CPU affinity mask, with one bit per logical processor, or zero to keep
+  /// the default affinity of the process. Only the first 64 processors can be
+  /// selected. Not supported on UWP.
+  uint64_t affinity_mask{0};
+
+  /// Nice value of the thread, from -20 (highest priority) to 19 (lowest
+  /// priority). On Android and Linux this is applied with |setpriority()| on
+  /// the thread; negative values generally require elevated privileges. On
+  /// Windows this is mapped to the closest thread priority level. Ignored if
+  /// |realtime_priority| is not zero.
+  int32_t nice{0};
+
+  /// Real-time priority of the thread, from 1 to 99, or zero to keep the
+  /// default time-sharing policy. On Android and Linux the thread is moved to
+  /// the |SCHED_FIFO| policy with that priority, which requires elevated
+  /// privileges. On Windows this maps to |THREAD_PRIORITY_TIME_CRITICAL|.
+  int32_t realtime_priority{0};
+};
+
+/// Scheduling state of a thread, read back from the operating system right
+/// after the library applied the configuration of its role.
+struct mrsAppliedThreadConfig {
+  /// Thread name, truncated and always null-terminated.
+  char name[64];
+
+  /// Platform thread identifier.
+  uint64_t thread_id;
+
+  /// Result of applying the configuration. This is |mrsResult::kSuccess| only
+  /// if all settings were applied; otherwise the fields below show which
+  /// settings are actually in effect.
+  mrsResult result;
+
+  /// CPU affinity mask in effect, or zero if it cannot be read on this
+  /// platform and was not changed.
+  uint64_t affinity_mask;
+
+  /// Nice value in effect. On Windows this is the nice value corresponding to
+  /// the thread priority level.
+  int32_t nice;
+
+  /// Real-time priority in effect, or zero if the thread uses a time-sharing
+  /// policy.
+  int32_t realtime_priority;
+};
+
+/// Set the scheduling configuration of the threads of the given role. The
+/// configuration is applied on each thread of that role when it starts, that
+/// is on library initialization for the WebRTC threads, and when capture starts
+/// for external video track sources. Threads already running are not affected,
+/// so this is typically called before the library initializes.
+///
+/// The default configuration leaves the default scheduling of the platform.
+/// Thread stack sizes cannot be configured, since WebRTC threads are always
+/// created with the platform default stack size.
+MRS_API mrsResult MRS_CALL
+mrsThreadConfigSet(mrsThreadRole role, const mrsThreadConfig* config) noexcept;
+
+/// Get the scheduling configuration of the threads of the given role, as last
+/// set with |mrsThreadConfigSet()|.
+MRS_API mrsResult MRS_CALL mrsThreadConfigGet(mrsThreadRole role,
+                                              mrsThreadConfig* config) noexcept;
+
+/// Get the scheduling state of the last thread of the given role which started,
+/// to verify that the configuration was effectively applied. Returns
+/// |mrsResult::kNotFound| if no thread of that role started yet.
+MRS_API mrsResult MRS_CALL
+mrsThreadConfigGetApplied(mrsThreadRole role,
+                          mrsAppliedThreadConfig* applied) noexcept;
+
+}  // extern "C"
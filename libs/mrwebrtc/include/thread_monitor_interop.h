@@ -0,0 +1,78 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include "export.h"
+#include "interop_api.h"
+
+extern "C" {
+
+/// Load statistics of a single monitored thread, accumulated since the monitor
+/// was last started.
+struct mrsThreadStats {
+  /// Thread name, truncated and always null-terminated.
+  char name[64];
+
+  /// Platform thread identifier, or zero if no probe ran yet on the thread.
+  uint64_t thread_id;
+
+  /// Number of messages in the thread queue at the last sample, including
+  /// delayed messages not due yet.
+  uint64_t queue_depth;
+
+  /// Maximum of |queue_depth| over all samples.
+  uint64_t max_queue_depth;
+
+  /// Number of probe messages which ran on the thread.
+  uint64_t probe_count;
+
+  /// Delay in microseconds between posting the last probe message and its
+  /// execution on the thread. A saturated thread shows a high latency.
+  int64_t last_latency_us;
+
+  /// Maximum of |last_latency_us| over all probes.
+  int64_t max_latency_us;
+
+  /// Sum of the latencies of all probes, to compute an average with
+  /// |probe_count|.
+  int64_t total_latency_us;
+
+  /// Cumulative CPU time in microseconds spent by the thread since its
+  /// creation, or -1 if not available on this platform or not known yet.
+  int64_t cpu_time_us;
+
+  /// Fraction of a single core used by the thread during the last sampling
+  /// interval, or -1 if not available.
+  double cpu_usage;
+};
+
+/// Start sampling the load of the WebRTC threads (network, worker, signaling)
+/// and of the capture threads of external video track sources, every
+/// |interval_ms| milliseconds. If the monitor is already running, it restarts
+/// with the new interval. All statistics are reset.
+///
+/// Each sample reads the queue depth and CPU time of each thread, and posts a
+/// probe message to measure the latency between posting a message and its
+/// execution. While a trace capture is in progress (see |mrsTracingStart()|),
+/// probes also record a span covering that latency, and counter samples for the
+/// queue depth and CPU usage, on the probed thread.
+///
+/// The monitor keeps running when the library shuts down, and samples the
+/// threads of the library again once it is initialized anew. It must be
+/// stopped with |mrsThreadMonitorStop()| before unloading the library.
+MRS_API mrsResult MRS_CALL mrsThreadMonitorStart(int32_t interval_ms) noexcept;
+
+/// Stop sampling. The last statistics remain available.
+MRS_API mrsResult MRS_CALL mrsThreadMonitorStop() noexcept;
+
+/// Get the statistics of all currently monitored threads.
+///
+/// On input |count| contains the capacity of the |stats| array. On output it
+/// contains the number of monitored threads. If the array is not large enough,
+/// the function returns |mrsResult::kBufferTooSmall| and the caller can retry
+/// with an array of the returned size. |stats| can be null if |count| is zero.
+MRS_API mrsResult MRS_CALL mrsThreadMonitorGetStats(mrsThreadStats* stats,
+                                                    uint32_t* count) noexcept;
+
+}  // extern "C"
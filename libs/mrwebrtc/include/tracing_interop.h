@@ -0,0 +1,39 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include "export.h"
+#include "interop_api.h"
+
+extern "C" {
+
+/// Start capturing trace spans around the native hot paths (frame callbacks,
+/// audio mixing and buffering, data channel messages, SDP and stats helpers),
+/// discarding any previous capture. Spans are recorded into per-thread buffers
+/// of fixed capacity; spans recorded once a buffer is full are dropped.
+///
+/// Returns |mrsResult::kUnsupported| if the library was compiled with
+/// |MRS_DISABLE_TRACING|, which compiles out all spans.
+MRS_API mrsResult MRS_CALL mrsTracingStart() noexcept;
+
+/// Stop capturing trace spans. The captured spans remain available until the
+/// next capture starts.
+MRS_API mrsResult MRS_CALL mrsTracingStop() noexcept;
+
+/// Serialize the last capture in the Chrome trace event JSON format, which can
+/// be loaded in chrome://tracing or https://ui.perfetto.dev. Timestamps are in
+/// microseconds, from the same monotonic clock as the one used by WebRTC.
+///
+/// The caller must provide a buffer with a sufficent size to copy the string
+/// to, including a null terminator character. On input |buffer_size| contains
+/// the capacity of |buffer| in bytes. On output it contains the size of the
+/// string including its null terminator. If the buffer is not large enough,
+/// the function returns |mrsResult::kBufferTooSmall| and the caller can retry
+/// with a buffer of the returned size; the serialized string is cached until
+/// the next capture starts. Returns |mrsResult::kInvalidOperation| while a
+/// capture is in progress.
+MRS_API mrsResult MRS_CALL mrsTracingGetJson(char* buffer,
+                                             uint64_t* buffer_size) noexcept;
+
+}  // extern "C"
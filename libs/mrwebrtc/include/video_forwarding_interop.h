@@ -0,0 +1,84 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include "export.h"
+#include "interop_api.h"
+
+extern "C" {
+
+/// Handle to a video track source forwarding the encoded frames of a remote
+/// video track.
+using mrsForwardedVideoTrackSourceHandle = mrsVideoTrackSourceHandle;
+
+/// Configuration of a forwarded video track source.
+struct mrsVideoForwardingConfig {
+  /// Keep decoding the remote video track while it is forwarded, so that its
+  /// frame callbacks are still invoked. By default the forwarded track is not
+  /// decoded at all.
+  mrsBool decode_locally{mrsBool::kFalse};
+
+  /// Highest temporal layer forwarded, or a negative value to forward all
+  /// layers. Only VP8 and VP9 streams encoded with temporal layers can be
+  /// thinned out this way.
+  int32_t max_temporal_layer{-1};
+};
+
+/// Statistics of a forwarded video track source.
+struct mrsVideoForwardingStats {
+  /// Number of encoded frames received from the remote video track.
+  uint64_t frames_received;
+
+  /// Number of encoded frames sent by the video senders of the local video
+  /// tracks using the source, counted once per sender.
+  uint64_t frames_sent;
+
+  /// Number of encoded frames not forwarded, because they belong to a temporal
+  /// layer above |mrsVideoForwardingConfig::max_temporal_layer|, or because
+  /// their resolution is not known yet.
+  uint64_t frames_dropped;
+
+  /// Number of key frame requests relayed to the remote sender. Requests from
+  /// several senders are aggregated until the next frame is received.
+  uint64_t key_frame_requests;
+};
+
+/// Create a video track source forwarding the encoded frames of a remote video
+/// track, without decoding them. Local video tracks created from the source
+/// with |mrsLocalVideoTrackCreateFromSource()| can be added to transceivers of
+/// any peer connection, whose video senders then packetize the forwarded
+/// frames with their own SSRC and payload type instead of encoding raw frames.
+/// This allows acting as a lightweight selective forwarding unit.
+///
+/// Key frames requested by the remote peers receiving the forwarded frames,
+/// or needed after a sender skipped a frame, are relayed to the sender of the
+/// remote track. The codec negotiated by the forwarding senders must be the
+/// same as the codec of the remote track, for example by filtering the SDP
+/// offers with |mrsSdpForceCodecs()|; frames of another codec are dropped.
+/// Only VP8, VP9 and H.264 are supported.
+///
+/// The remote track is identified by its peer connection and the SDP stream of
+/// its receiver when the source is created, so the connection of the remote
+/// track must already be established. This is not supported on UWP, where the
+/// codec factories are not under the control of the library.
+///
+/// This returns a handle to a newly allocated object, which must be released
+/// once not used anymore with |mrsRefCountedObjectRemoveRef()|.
+MRS_API mrsResult MRS_CALL mrsForwardedVideoTrackSourceCreate(
+    mrsRemoteVideoTrackHandle remote_track_handle,
+    const mrsVideoForwardingConfig* config,
+    mrsForwardedVideoTrackSourceHandle* source_handle_out) noexcept;
+
+/// Change the highest temporal layer forwarded, or forward all layers if
+/// negative. See |mrsVideoForwardingConfig::max_temporal_layer|.
+MRS_API mrsResult MRS_CALL mrsForwardedVideoTrackSourceSetMaxTemporalLayer(
+    mrsForwardedVideoTrackSourceHandle source_handle,
+    int32_t max_temporal_layer) noexcept;
+
+/// Get the statistics of a forwarded video track source.
+MRS_API mrsResult MRS_CALL mrsForwardedVideoTrackSourceGetStats(
+    mrsForwardedVideoTrackSourceHandle source_handle,
+    mrsVideoForwardingStats* stats) noexcept;
+
+}  // extern "C"
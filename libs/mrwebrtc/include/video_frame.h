@@ -54,6 +54,25 @@ struct I420AVideoFrame {
   /// This is ignored if there is no A plane (|adata_| is NULL).
   /// Otherwise, this is always greater than or equal to |width_|.
   std::int32_t astride_;
+
+  /// Capture time of the frame, in milliseconds since the NTP epoch (Jan 1st,
+  /// 1900 UTC), or zero if unknown. For remote frames this is the capture time
+  /// on the sender, estimated from the RTP timestamp and the RTCP sender
+  /// reports, and is unknown until the first sender report is received. This
+  /// is ignored when completing a frame request of an external source, which
+  /// stamps frames itself.
+  std::int64_t capture_time_ntp_ms_;
+
+  /// Time at which the frame was delivered to the frame callback, in
+  /// milliseconds since the NTP epoch. The difference with
+  /// |capture_time_ntp_ms_| is the capture-to-render latency, assuming the
+  /// sender and receiver clocks are synchronized (always the case for two
+  /// peers in the same process).
+  std::int64_t receive_time_ntp_ms_;
+
+  /// RTP timestamp of the frame, in units of the 90 kHz video RTP clock, or
+  /// zero for local frames.
+  std::uint32_t rtp_timestamp_;
 };
 
 /// View over an existing buffer representing a video frame encoded in ARGB
@@ -72,6 +91,45 @@ struct Argb32VideoFrame {
   /// Stride in bytes between two consecutive rows in the ARGB buffer.
   /// This is always greater than or equal to |width_|.
   std::int32_t stride_;
+
+  /// Capture time of the frame, in milliseconds since the NTP epoch, or zero if
+  /// unknown. See |I420AVideoFrame::capture_time_ntp_ms_|.
+  std::int64_t capture_time_ntp_ms_;
+
+  /// Time at which the frame was delivered to the frame callback, in
+  /// milliseconds since the NTP epoch. See
+  /// |I420AVideoFrame::receive_time_ntp_ms_|.
+  std::int64_t receive_time_ntp_ms_;
+
+  /// RTP timestamp of the frame, or zero for local frames.
+  std::uint32_t rtp_timestamp_;
+};
+
+/// Histogram of the capture-to-render latency of the frames of a video track,
+/// for the frames whose capture time is known.
+struct VideoLatencyHistogram {
+  /// Width of a histogram bucket, in milliseconds.
+  static constexpr int kBucketWidthMs = 10;
+
+  /// Number of histogram buckets.
+  static constexpr int kBucketCount = 50;
+
+  /// Number of frames recorded.
+  std::uint64_t count_;
+
+  /// Minimum latency recorded, in milliseconds.
+  std::int64_t min_ms_;
+
+  /// Maximum latency recorded, in milliseconds.
+  std::int64_t max_ms_;
+
+  /// Sum of all latencies recorded, in milliseconds, to compute the mean.
+  std::int64_t sum_ms_;
+
+  /// Number of frames per latency bucket. The bucket at index i counts frames
+  /// with a latency in [i * |kBucketWidthMs| : (i + 1) * |kBucketWidthMs|[,
+  /// except the last bucket which also counts all frames with a larger latency.
+  std::uint32_t buckets_[kBucketCount];
 };
 
 }  // namespace WebRTC
@@ -0,0 +1,322 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+// This is a precompiled header, it must be on its own, followed by a blank
+// line, to prevent clang-format from reordering it with other headers.
+#include "pch.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#include "alloc_tracker.h"
+
+#include "rtc_base/platform_thread_types.h"
+
+#if MRS_ALLOC_TRACKING_ENABLED
+
+namespace {
+
+/// Maximum number of distinct allocation scopes. Scopes entered once the table
+/// is full are not tracked, and their allocations are attributed to the
+/// enclosing scope.
+constexpr int kMaxScopeCount = 256;
+
+/// Token returned by |AllocTracker::EnterScope()| when no scope was entered.
+constexpr int kNoScopeEntered = -2;
+
+/// Index of the current scope of a thread outside any scope.
+constexpr int kNoScope = -1;
+
+/// Allocation counters of a single scope, identified by its name.
+struct ScopeEntry {
+  /// Name of the scope, or null if the entry is free. Entries are never freed
+  /// once used, since names have static storage duration.
+  std::atomic<const char*> name{nullptr};
+  std::atomic<uint64_t> invocation_count{0};
+  std::atomic<uint64_t> alloc_count{0};
+  std::atomic<uint64_t> alloc_bytes{0};
+};
+
+/// Allocation counters of a single thread. Records are allocated with
+/// |malloc()| on the first allocation of the thread, and intentionally leaked
+/// so that the counters of exited threads remain available.
+struct ThreadRecord {
+  rtc::PlatformThreadId thread_id{};
+  ThreadRecord* next{nullptr};
+  std::atomic<uint64_t> alloc_count{0};
+  std::atomic<uint64_t> alloc_bytes{0};
+};
+
+/// Open-addressing hash table of scopes, and lock-free list of thread records.
+/// Neither is ever shrunk, so lookups and insertions need no lock.
+struct AllocRegistry {
+  ScopeEntry scopes_[kMaxScopeCount];
+  std::atomic<ThreadRecord*> threads_{nullptr};
+};
+
+AllocRegistry& GetRegistry() {
+  // Intentionally leaked, and allocated with the regular allocation functions
+  // before tracking can start, so that allocations made during static
+  // destruction can still be counted.
+  static AllocRegistry* const registry = new AllocRegistry();
+  return *registry;
+}
+
+/// Index of the innermost scope entered on the current thread.
+thread_local int t_scope_index = kNoScope;
+
+/// Record of the current thread, if created.
+thread_local ThreadRecord* t_thread_record = nullptr;
+
+/// FNV-1a hash of a scope name. Names are hashed by content rather than by
+/// address, since the same literal can have different addresses in different
+/// translation units.
+uint32_t HashName(const char* name) noexcept {
+  uint32_t hash = 2166136261u;
+  for (const char* c = name; *c != '\0'; ++c) {
+    hash = (hash ^ static_cast<uint8_t>(*c)) * 16777619u;
+  }
+  return hash;
+}
+
+/// Find the index of the entry of the given scope, inserting it if needed, or
+/// return |kNoScope| if the table is full.
+int FindOrInsertScope(const char* name) noexcept {
+  ScopeEntry* const scopes = GetRegistry().scopes_;
+  const uint32_t hash = HashName(name);
+  for (int probe = 0; probe < kMaxScopeCount; ++probe) {
+    const int index = static_cast<int>((hash + probe) % kMaxScopeCount);
+    ScopeEntry& entry = scopes[index];
+    const char* entry_name = entry.name.load(std::memory_order_acquire);
+    if (!entry_name) {
+      if (entry.name.compare_exchange_strong(entry_name, name,
+                                             std::memory_order_acq_rel)) {
+        return index;
+      }
+      // Lost the race against another thread; |entry_name| now holds the
+      // name it inserted.
+    }
+    if ((entry_name == name) || (strcmp(entry_name, name) == 0)) {
+      return index;
+    }
+  }
+  return kNoScope;
+}
+
+ThreadRecord* GetThreadRecord() noexcept {
+  ThreadRecord* record = t_thread_record;
+  if (record) {
+    return record;
+  }
+  void* const storage = malloc(sizeof(ThreadRecord));
+  if (!storage) {
+    return nullptr;
+  }
+  record = new (storage) ThreadRecord();
+  record->thread_id = rtc::CurrentThreadId();
+  std::atomic<ThreadRecord*>& head = GetRegistry().threads_;
+  ThreadRecord* next = head.load(std::memory_order_relaxed);
+  do {
+    record->next = next;
+  } while (!head.compare_exchange_weak(next, record, std::memory_order_release,
+                                       std::memory_order_relaxed));
+  t_thread_record = record;
+  return record;
+}
+
+}  // namespace
+
+/// Replacement of the global allocation functions of the library. Sized and
+/// aligned variants are left to their default implementation, which forwards
+/// to those ones or pairs with the default aligned deallocation functions.
+void* operator new(size_t size) {
+  if (Microsoft::MixedReality::WebRTC::AllocTracker::IsTracking()) {
+    Microsoft::MixedReality::WebRTC::AllocTracker::RecordAlloc(size);
+  }
+  void* const ptr = malloc(size > 0 ? size : 1);
+  if (!ptr) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+void* operator new[](size_t size) {
+  return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+  if (Microsoft::MixedReality::WebRTC::AllocTracker::IsTracking()) {
+    Microsoft::MixedReality::WebRTC::AllocTracker::RecordAlloc(size);
+  }
+  return malloc(size > 0 ? size : 1);
+}
+
+void* operator new[](size_t size, const std::nothrow_t& tag) noexcept {
+  return operator new(size, tag);
+}
+
+void operator delete(void* ptr) noexcept {
+  free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+  free(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept {
+  free(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept {
+  free(ptr);
+}
+
+#endif  // MRS_ALLOC_TRACKING_ENABLED
+
+namespace Microsoft {
+namespace MixedReality {
+namespace WebRTC {
+
+std::atomic_bool AllocTracker::tracking_{false};
+
+Result AllocTracker::Start() noexcept {
+#if MRS_ALLOC_TRACKING_ENABLED
+  // Counters are reset one by one without stopping the allocating threads, so
+  // allocations made concurrently with a restart may or may not be counted.
+  AllocRegistry& registry = GetRegistry();
+  for (ScopeEntry& entry : registry.scopes_) {
+    entry.invocation_count.store(0, std::memory_order_relaxed);
+    entry.alloc_count.store(0, std::memory_order_relaxed);
+    entry.alloc_bytes.store(0, std::memory_order_relaxed);
+  }
+  for (ThreadRecord* record = registry.threads_.load(std::memory_order_acquire);
+       record; record = record->next) {
+    record->alloc_count.store(0, std::memory_order_relaxed);
+    record->alloc_bytes.store(0, std::memory_order_relaxed);
+  }
+  tracking_.store(true, std::memory_order_release);
+  return Result::kSuccess;
+#else
+  return Result::kUnsupported;
+#endif
+}
+
+Result AllocTracker::Stop() noexcept {
+  tracking_.store(false, std::memory_order_release);
+  return Result::kSuccess;
+}
+
+void AllocTracker::RecordAlloc(size_t size) noexcept {
+#if MRS_ALLOC_TRACKING_ENABLED
+  if (ThreadRecord* const record = GetThreadRecord()) {
+    record->alloc_count.fetch_add(1, std::memory_order_relaxed);
+    record->alloc_bytes.fetch_add(size, std::memory_order_relaxed);
+  }
+  const int index = t_scope_index;
+  if (index >= 0) {
+    ScopeEntry& entry = GetRegistry().scopes_[index];
+    entry.alloc_count.fetch_add(1, std::memory_order_relaxed);
+    entry.alloc_bytes.fetch_add(size, std::memory_order_relaxed);
+  }
+#else
+  (void)size;
+#endif
+}
+
+int AllocTracker::EnterScope(const char* name) noexcept {
+#if MRS_ALLOC_TRACKING_ENABLED
+  if (!IsTracking()) {
+    return kNoScopeEntered;
+  }
+  const int index = FindOrInsertScope(name);
+  if (index < 0) {
+    return kNoScopeEntered;
+  }
+  GetRegistry().scopes_[index].invocation_count.fetch_add(
+      1, std::memory_order_relaxed);
+  const int previous = t_scope_index;
+  t_scope_index = index;
+  return previous;
+#else
+  (void)name;
+  return 0;
+#endif
+}
+
+void AllocTracker::ExitScope(int token) noexcept {
+#if MRS_ALLOC_TRACKING_ENABLED
+  // Restore the previous scope even if tracking stopped in between.
+  if (token != kNoScopeEntered) {
+    t_scope_index = token;
+  }
+#else
+  (void)token;
+#endif
+}
+
+Result AllocTracker::GetScopeStats(mrsAllocScopeStats* stats,
+                                   uint32_t& count) noexcept {
+#if MRS_ALLOC_TRACKING_ENABLED
+  // Report only the scopes entered since the last start.
+  const uint32_t capacity = count;
+  uint32_t size = 0;
+  for (ScopeEntry& entry : GetRegistry().scopes_) {
+    const char* const name = entry.name.load(std::memory_order_acquire);
+    const uint64_t invocation_count =
+        entry.invocation_count.load(std::memory_order_relaxed);
+    if (!name || (invocation_count == 0)) {
+      continue;
+    }
+    if (size < capacity) {
+      mrsAllocScopeStats& out = stats[size];
+      out.name = name;
+      out.invocation_count = invocation_count;
+      out.alloc_count = entry.alloc_count.load(std::memory_order_relaxed);
+      out.alloc_bytes = entry.alloc_bytes.load(std::memory_order_relaxed);
+    }
+    ++size;
+  }
+  count = size;
+  return (size <= capacity ? Result::kSuccess : Result::kBufferTooSmall);
+#else
+  (void)stats;
+  count = 0;
+  return Result::kUnsupported;
+#endif
+}
+
+Result AllocTracker::GetThreadStats(mrsAllocThreadStats* stats,
+                                    uint32_t& count) noexcept {
+#if MRS_ALLOC_TRACKING_ENABLED
+  // Report only the threads which allocated since the last start.
+  const uint32_t capacity = count;
+  uint32_t size = 0;
+  for (ThreadRecord* record =
+           GetRegistry().threads_.load(std::memory_order_acquire);
+       record; record = record->next) {
+    const uint64_t alloc_count =
+        record->alloc_count.load(std::memory_order_relaxed);
+    if (alloc_count == 0) {
+      continue;
+    }
+    if (size < capacity) {
+      mrsAllocThreadStats& out = stats[size];
+      out.thread_id = static_cast<uint64_t>(record->thread_id);
+      out.alloc_count = alloc_count;
+      out.alloc_bytes = record->alloc_bytes.load(std::memory_order_relaxed);
+    }
+    ++size;
+  }
+  count = size;
+  return (size <= capacity ? Result::kSuccess : Result::kBufferTooSmall);
+#else
+  (void)stats;
+  count = 0;
+  return Result::kUnsupported;
+#endif
+}
+
+}  // namespace WebRTC
+}  // namespace MixedReality
+}  // namespace Microsoft
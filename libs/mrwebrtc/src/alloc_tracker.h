@@ -0,0 +1,100 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <atomic>
+
+#include "alloc_tracking_interop.h"
+#include "mrs_errors.h"
+
+/// Allocation tracking is compiled in only if |MRS_ENABLE_ALLOC_TRACKING| is
+/// defined, since it replaces the global allocation functions of the library.
+#if defined(MRS_ENABLE_ALLOC_TRACKING)
+#define MRS_ALLOC_TRACKING_ENABLED 1
+#else
+#define MRS_ALLOC_TRACKING_ENABLED 0
+#endif
+
+#if MRS_ALLOC_TRACKING_ENABLED
+#define MRS_ALLOC_CONCAT_IMPL(a, b) a##b
+#define MRS_ALLOC_CONCAT(a, b) MRS_ALLOC_CONCAT_IMPL(a, b)
+
+/// Attribute the allocations made in the remainder of the current scope, and
+/// outside any nested scope, to |name|. |name| must be a string literal, or any
+/// string with static storage duration. Trace spans from |MRS_TRACE_SCOPE()|
+/// are also allocation scopes.
+#define MRS_ALLOC_SCOPE(name)                                              \
+  ::Microsoft::MixedReality::WebRTC::ScopedAllocTracking MRS_ALLOC_CONCAT( \
+      mrs_alloc_scope_, __LINE__)(name)
+#else
+#define MRS_ALLOC_SCOPE(name) (void)0
+#endif
+
+namespace Microsoft {
+namespace MixedReality {
+namespace WebRTC {
+
+/// Process-wide counter of the heap allocations made by the library.
+///
+/// Allocations are counted per thread, and per innermost scope entered on the
+/// allocating thread. Counters are lock-free atomics stored in a fixed-size
+/// scope table and in per-thread records, themselves allocated with |malloc()|
+/// so that tracking never allocates through the functions it replaces.
+class AllocTracker {
+ public:
+  /// Start counting allocations, resetting all counters.
+  static Result Start() noexcept;
+
+  /// Stop counting allocations. The counters remain available until the next
+  /// start.
+  static Result Stop() noexcept;
+
+  /// Check if allocations are being counted.
+  static bool IsTracking() noexcept {
+    return tracking_.load(std::memory_order_relaxed);
+  }
+
+  /// Record an allocation of |size| bytes made on the current thread.
+  static void RecordAlloc(size_t size) noexcept;
+
+  /// Enter the scope with the given name on the current thread, and return a
+  /// token to pass to |ExitScope()| to restore the previous scope.
+  static int EnterScope(const char* name) noexcept;
+
+  /// Exit the scope entered by the call to |EnterScope()| which returned
+  /// |token|.
+  static void ExitScope(int token) noexcept;
+
+  /// Copy the counters of all scopes entered since tracking started. See
+  /// |mrsAllocTrackingGetScopeStats()|.
+  static Result GetScopeStats(mrsAllocScopeStats* stats,
+                              uint32_t& count) noexcept;
+
+  /// Copy the counters of all threads which allocated since tracking started.
+  /// See |mrsAllocTrackingGetThreadStats()|.
+  static Result GetThreadStats(mrsAllocThreadStats* stats,
+                               uint32_t& count) noexcept;
+
+ private:
+  static std::atomic_bool tracking_;
+};
+
+/// RAII helper attributing the allocations made on the current thread to a
+/// scope, from its construction to its destruction. Use |MRS_ALLOC_SCOPE()|
+/// instead of using this class directly, so that scopes can be compiled out.
+class ScopedAllocTracking {
+ public:
+  explicit ScopedAllocTracking(const char* name) noexcept
+      : token_(AllocTracker::EnterScope(name)) {}
+  ~ScopedAllocTracking() noexcept { AllocTracker::ExitScope(token_); }
+  ScopedAllocTracking(const ScopedAllocTracking&) = delete;
+  ScopedAllocTracking& operator=(const ScopedAllocTracking&) = delete;
+
+ private:
+  const int token_;
+};
+
+}  // namespace WebRTC
+}  // namespace MixedReality
+}  // namespace Microsoft
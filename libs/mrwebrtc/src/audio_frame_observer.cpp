@@ -14,6 +14,7 @@ void AudioFrameObserver::SetCallback(
     AudioFrameReadyCallback callback) noexcept {
   std::lock_guard<std::mutex> lock(mutex_);
   callback_ = std::move(callback);
+  callback_.SetSite(owner_, mrsCallbackType::kAudioFrame);
 }
 
 void AudioFrameObserver::OnData(const void* audio_data,
@@ -21,17 +22,21 @@ void AudioFrameObserver::OnData(const void* audio_data,
                                 int sample_rate,
                                 size_t number_of_channels,
                                 size_t number_of_frames) noexcept {
+  ObjectMetrics::Add(observer_metrics_.frames_in, 1);
   std::lock_guard<std::mutex> lock(mutex_);
   if (!callback_) {
     return;
   }
+  ObjectMetrics::Add(observer_metrics_.frames_out, 1);
   AudioFrame frame;
   frame.data_ = audio_data;
   frame.bits_per_sample_ = static_cast<uint32_t>(bits_per_sample);
   frame.sampling_rate_hz_ = static_cast<uint32_t>(sample_rate);
   frame.channel_count_ = static_cast<uint32_t>(number_of_channels);
   frame.sample_count_ = static_cast<uint32_t>(number_of_frames);
+  const int64_t callback_start_us = rtc::TimeMicros();
   callback_(frame);
+  observer_metrics_.AddCallback(callback_start_us);
 }
 
 }  // namespace WebRTC
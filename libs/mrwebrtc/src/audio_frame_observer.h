@@ -9,6 +9,7 @@
 
 #include "audio_frame.h"
 #include "callback.h"
+#include "tracked_object.h"
 
 namespace Microsoft {
 namespace MixedReality {
@@ -20,6 +21,13 @@ using AudioFrameReadyCallback = Callback<const AudioFrame&>;
 /// Audio frame observer to get notified of newly available audio frames.
 class AudioFrameObserver : public webrtc::AudioTrackSinkInterface {
  public:
+  /// Create an observer updating the performance counters of the given
+  /// owner, or its own counters if |owner| is null. The owner also identifies
+  /// the callbacks reported by the callback watchdog.
+  explicit AudioFrameObserver(TrackedObject* owner = nullptr) noexcept
+      : owner_(owner),
+        observer_metrics_(owner ? owner->GetMetrics() : own_metrics_) {}
+
   void SetCallback(AudioFrameReadyCallback callback) noexcept;
 
  protected:
@@ -33,6 +41,15 @@ class AudioFrameObserver : public webrtc::AudioTrackSinkInterface {
  private:
   AudioFrameReadyCallback callback_ RTC_GUARDED_BY(mutex_);
   std::mutex mutex_;
+
+  /// Object owning this observer, if any.
+  TrackedObject* const owner_;
+
+  /// Fallback counters if no owner is provided on construction.
+  ObjectMetrics own_metrics_;
+
+  /// Performance counters of the object owning this observer.
+  ObjectMetrics& observer_metrics_;
 };
 
 }  // namespace WebRTC
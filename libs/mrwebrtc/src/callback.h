@@ -4,6 +4,8 @@
 
 #pragma once
 
+#include "callback_watchdog.h"
+#include "event_queue.h"
 #include "export.h"
 
 namespace Microsoft {
@@ -17,6 +19,10 @@ namespace WebRTC {
 ///   cb(42); // -> func_ptr(user_data, 42)
 ///   Callback<float> cb2;
 ///   cb2(3.4f); // -> safe, does nothing
+/// Each invocation is timed by the |CallbackWatchdog| if enabled, and reported
+/// with the identity set by |SetSite()|. If the |EventQueue| is enabled, the
+/// invocation is instead queued with a copy of its arguments, for the callbacks
+/// which support it.
 template <typename... Args>
 struct Callback {
   /// Type of the raw callback function.
@@ -29,14 +35,28 @@ struct Callback {
   /// User-provided opaque pointer passed as first argument to the raw function.
   void* user_data_{};
 
+  /// Identity of the callback reported by the callback watchdog.
+  CallbackSite site_{};
+
   /// Check if the callback has a valid function pointer.
   constexpr explicit operator bool() const noexcept {
     return (callback_ != nullptr);
   }
 
+  /// Set the identity of the callback reported by the callback watchdog.
+  void SetSite(void* object, mrsCallbackType type) noexcept {
+    site_ = CallbackSite{object, type};
+  }
+
   /// Invoke the callback with the given arguments |args|.
-  constexpr void operator()(Args... args) const noexcept {
+  void operator()(Args... args) const noexcept {
     if (callback_ != nullptr) {
+      if (EventQueue::IsQueueing() &&
+          EventQueue::Post(site_, reinterpret_cast<void*>(callback_),
+                           user_data_, args...)) {
+        return;
+      }
+      CallbackWatchdogScope scope(site_);
       (*callback_)(user_data_, std::forward<Args>(args)...);
     }
   }
@@ -58,14 +78,23 @@ struct RetCallback {
   /// User-provided opaque pointer passed as first argument to the raw function.
   void* user_data_{};
 
+  /// Identity of the callback reported by the callback watchdog.
+  CallbackSite site_{};
+
   /// Check if the callback has a valid function pointer.
   constexpr explicit operator bool() const noexcept {
     return (callback_ != nullptr);
   }
 
+  /// Set the identity of the callback reported by the callback watchdog.
+  void SetSite(void* object, mrsCallbackType type) noexcept {
+    site_ = CallbackSite{object, type};
+  }
+
   /// Invoke the callback with the given arguments |args|.
-  constexpr return_type operator()(Args... args) const noexcept {
+  return_type operator()(Args... args) const noexcept {
     if (callback_ != nullptr) {
+      CallbackWatchdogScope scope(site_);
       return (*callback_)(user_data_, std::forward<Args>(args)...);
     }
     return return_type{};
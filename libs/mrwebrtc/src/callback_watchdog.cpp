@@ -0,0 +1,219 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+// This is a precompiled header, it must be on its own, followed by a blank
+// line, to prevent clang-format from reordering it with other headers.
+#include "pch.h"
+
+#include <algorithm>
+
+#include "callback_watchdog.h"
+
+#include "rtc_base/arraysize.h"
+
+namespace {
+
+/// Number of values of |mrsCallbackType|.
+constexpr size_t kTypeCount =
+    static_cast<size_t>(mrsCallbackType::kKeyFrameRequested) + 1;
+
+constexpr int kBucketCount = mrsCallbackHistogram::kBucketCount;
+
+/// Statistics of a single callback type.
+struct TypeStats {
+  std::atomic<uint64_t> count{0};
+  std::atomic<uint64_t> total_us{0};
+  std::atomic<uint64_t> max_us{0};
+  std::atomic<uint64_t> over_budget_count{0};
+  std::atomic<uint64_t> buckets[kBucketCount]{};
+
+  /// Time of the last warning reported, or zero if none.
+  std::atomic<int64_t> last_warning_us{0};
+
+  /// Number of warnings not reported since the last reported one.
+  std::atomic<uint32_t> suppressed_count{0};
+};
+
+struct WatchdogState {
+  std::atomic<int64_t> budget_us_{5000};
+  std::atomic<int64_t> warning_interval_us_{1000000};
+  TypeStats stats_[kTypeCount];
+
+  std::mutex warning_mutex_;
+  mrsCallbackWarningCallback warning_callback_ RTC_GUARDED_BY(
+      warning_mutex_){nullptr};
+  void* warning_user_data_ RTC_GUARDED_BY(warning_mutex_){nullptr};
+};
+
+WatchdogState& GetState() {
+  // Intentionally leaked, so that callbacks invoked during static destruction
+  // can still be recorded.
+  static WatchdogState* const state = new WatchdogState();
+  return *state;
+}
+
+const char* ToString(mrsCallbackType type) {
+  static const char* const kNames[] = {"Unknown",
+                                       "I420AVideoFrame",
+                                       "Argb32VideoFrame",
+                                       "AudioFrame",
+                                       "DataChannelMessage",
+                                       "DataChannelBuffering",
+                                       "DataChannelState",
+                                       "LocalSdpReadyToSend",
+                                       "IceCandidateReadyToSend",
+                                       "IceStateChanged",
+                                       "IceGatheringStateChanged",
+                                       "RenegotiationNeeded",
+                                       "Connected",
+                                       "TransceiverAdded",
+                                       "AudioTrackAdded",
+                                       "AudioTrackRemoved",
+                                       "VideoTrackAdded",
+                                       "VideoTrackRemoved",
+                                       "DataChannelAdded",
+                                       "DataChannelRemoved",
+                                       "TransceiverAssociated",
+                                       "TransceiverStateUpdated",
+                                       "EncodedVideoFrame",
+                                       "KeyFrameRequested"};
+  static_assert(arraysize(kNames) == kTypeCount,
+                "Missing name of some callback type.");
+  const size_t index = static_cast<size_t>(type);
+  return (index < kTypeCount ? kNames[index] : "Invalid");
+}
+
+/// Get the index of the histogram bucket for the given duration.
+int BucketIndex(int64_t duration_us) {
+  uint64_t value = static_cast<uint64_t>(std::max<int64_t>(duration_us, 0));
+  int index = 0;
+  while ((value > 0) && (index < kBucketCount - 1)) {
+    value >>= 1;
+    ++index;
+  }
+  return index;
+}
+
+}  // namespace
+
+namespace Microsoft {
+namespace MixedReality {
+namespace WebRTC {
+
+std::atomic_bool CallbackWatchdog::enabled_{false};
+
+Result CallbackWatchdog::Start(
+    const mrsCallbackWatchdogConfig& config) noexcept {
+  if ((config.budget_us < 0) || (config.warning_interval_ms < 0)) {
+    return Result::kInvalidParameter;
+  }
+  WatchdogState& state = GetState();
+  state.budget_us_.store(config.budget_us, std::memory_order_relaxed);
+  state.warning_interval_us_.store(
+      config.warning_interval_ms * rtc::kNumMicrosecsPerMillisec,
+      std::memory_order_relaxed);
+  enabled_.store(true, std::memory_order_release);
+  return Result::kSuccess;
+}
+
+Result CallbackWatchdog::Stop() noexcept {
+  enabled_.store(false, std::memory_order_release);
+  return Result::kSuccess;
+}
+
+void CallbackWatchdog::SetWarningCallback(mrsCallbackWarningCallback callback,
+                                          void* user_data) noexcept {
+  WatchdogState& state = GetState();
+  std::lock_guard<std::mutex> lock(state.warning_mutex_);
+  state.warning_callback_ = callback;
+  state.warning_user_data_ = user_data;
+}
+
+void CallbackWatchdog::Record(const CallbackSite& site,
+                              int64_t duration_us) noexcept {
+  const size_t index = static_cast<size_t>(site.type_);
+  if (index >= kTypeCount) {
+    return;
+  }
+  WatchdogState& state = GetState();
+  TypeStats& stats = state.stats_[index];
+  const uint64_t duration =
+      static_cast<uint64_t>(std::max<int64_t>(duration_us, 0));
+  stats.count.fetch_add(1, std::memory_order_relaxed);
+  stats.total_us.fetch_add(duration, std::memory_order_relaxed);
+  uint64_t max_us = stats.max_us.load(std::memory_order_relaxed);
+  while ((duration > max_us) &&
+         !stats.max_us.compare_exchange_weak(max_us, duration,
+                                             std::memory_order_relaxed)) {
+  }
+  stats.buckets[BucketIndex(duration_us)].fetch_add(1,
+                                                    std::memory_order_relaxed);
+
+  const int64_t budget_us = state.budget_us_.load(std::memory_order_relaxed);
+  if (duration_us <= budget_us) {
+    return;
+  }
+  stats.over_budget_count.fetch_add(1, std::memory_order_relaxed);
+
+  // Rate-limit warnings per callback type. Only the thread winning the update
+  // of the last warning time reports it.
+  const int64_t now_us = rtc::TimeMicros();
+  const int64_t interval_us =
+      state.warning_interval_us_.load(std::memory_order_relaxed);
+  int64_t last_us = stats.last_warning_us.load(std::memory_order_relaxed);
+  if (((last_us != 0) && (now_us - last_us < interval_us)) ||
+      !stats.last_warning_us.compare_exchange_strong(
+          last_us, now_us, std::memory_order_relaxed)) {
+    stats.suppressed_count.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  const uint32_t suppressed_count =
+      stats.suppressed_count.exchange(0, std::memory_order_relaxed);
+  RTC_LOG(LS_WARNING) << "Callback " << ToString(site.type_) << " of object "
+                      << site.object_ << " took " << duration_us
+                      << " us, exceeding its budget of " << budget_us
+                      << " us (" << suppressed_count
+                      << " previous warnings suppressed).";
+
+  mrsCallbackWarningCallback callback;
+  void* user_data;
+  {
+    std::lock_guard<std::mutex> lock(state.warning_mutex_);
+    callback = state.warning_callback_;
+    user_data = state.warning_user_data_;
+  }
+  if (callback) {
+    const mrsCallbackWarningInfo info{site.object_, site.type_, duration_us,
+                                      budget_us, suppressed_count};
+    (*callback)(user_data, &info);
+  }
+}
+
+Result CallbackWatchdog::GetHistogram(
+    mrsCallbackType type,
+    bool reset,
+    mrsCallbackHistogram& histogram) noexcept {
+  const size_t index = static_cast<size_t>(type);
+  if (index >= kTypeCount) {
+    return Result::kInvalidParameter;
+  }
+  TypeStats& stats = GetState().stats_[index];
+  // Each counter is read atomically, but not the histogram as a whole, so it
+  // can be slightly inconsistent if callbacks are invoked concurrently.
+  auto read = [reset](std::atomic<uint64_t>& counter) {
+    return (reset ? counter.exchange(0, std::memory_order_relaxed)
+                  : counter.load(std::memory_order_relaxed));
+  };
+  histogram.count = read(stats.count);
+  histogram.total_us = read(stats.total_us);
+  histogram.max_us = read(stats.max_us);
+  histogram.over_budget_count = read(stats.over_budget_count);
+  for (int i = 0; i < kBucketCount; ++i) {
+    histogram.buckets[i] = read(stats.buckets[i]);
+  }
+  return Result::kSuccess;
+}
+
+}  // namespace WebRTC
+}  // namespace MixedReality
+}  // namespace Microsoft
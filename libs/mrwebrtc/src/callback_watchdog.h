@@ -0,0 +1,82 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <atomic>
+
+#include "callback_watchdog_interop.h"
+#include "mrs_errors.h"
+
+#include "rtc_base/timeutils.h"
+
+namespace Microsoft {
+namespace MixedReality {
+namespace WebRTC {
+
+/// Identity of a user callback, reported by the callback watchdog.
+struct CallbackSite {
+  /// Handle of the object invoking the callback, if known.
+  void* object_{nullptr};
+
+  /// Type of the callback.
+  mrsCallbackType type_{mrsCallbackType::kUnknown};
+};
+
+/// Process-wide watchdog timing the invocations of user callbacks.
+///
+/// Durations are recorded into lock-free per-type histograms. Invocations
+/// exceeding the configured budget are logged and reported to the warning
+/// callback, if any, at most once per warning interval and per callback type.
+class CallbackWatchdog {
+ public:
+  /// Start or reconfigure the watchdog.
+  static Result Start(const mrsCallbackWatchdogConfig& config) noexcept;
+
+  /// Stop the watchdog.
+  static Result Stop() noexcept;
+
+  /// Check if the watchdog is started.
+  static bool IsEnabled() noexcept {
+    return enabled_.load(std::memory_order_relaxed);
+  }
+
+  /// Set the callback invoked on warnings, or clear it with a null |callback|.
+  static void SetWarningCallback(mrsCallbackWarningCallback callback,
+                                 void* user_data) noexcept;
+
+  /// Record an invocation of the given callback.
+  static void Record(const CallbackSite& site, int64_t duration_us) noexcept;
+
+  /// Copy the histogram of the given callback type, and optionally reset it.
+  static Result GetHistogram(mrsCallbackType type,
+                             bool reset,
+                             mrsCallbackHistogram& histogram) noexcept;
+
+ private:
+  static std::atomic_bool enabled_;
+};
+
+/// RAII helper timing a callback invocation from its construction to its
+/// destruction, if the watchdog is enabled on construction.
+class CallbackWatchdogScope {
+ public:
+  explicit CallbackWatchdogScope(const CallbackSite& site) noexcept
+      : site_(site),
+        begin_us_(CallbackWatchdog::IsEnabled() ? rtc::TimeMicros() : -1) {}
+  ~CallbackWatchdogScope() noexcept {
+    if (begin_us_ >= 0) {
+      CallbackWatchdog::Record(site_, rtc::TimeMicros() - begin_us_);
+    }
+  }
+  CallbackWatchdogScope(const CallbackWatchdogScope&) = delete;
+  CallbackWatchdogScope& operator=(const CallbackWatchdogScope&) = delete;
+
+ private:
+  const CallbackSite site_;
+  const int64_t begin_us_;
+};
+
+}  // namespace WebRTC
+}  // namespace MixedReality
+}  // namespace Microsoft
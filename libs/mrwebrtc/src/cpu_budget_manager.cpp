@@ -0,0 +1,425 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+// This is a precompiled header, it must be on its own, followed by a blank
+// line, to prevent clang-format from reordering it with other headers.
+#include "pch.h"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+#if defined(MR_SHARING_ANDROID)
+#include <time.h>
+#endif
+
+#include "cpu_budget_manager.h"
+#include "peer_connection.h"
+
+namespace {
+
+using namespace Microsoft::MixedReality::WebRTC;
+
+enum {
+  /// Measure the CPU usage and update the allocations.
+  MSG_SAMPLE,
+  /// Apply the allocations on a signaling thread.
+  MSG_APPLY
+};
+
+/// Fraction of the target below which the usage must fall before the quality
+/// increases again, to avoid oscillating around the target.
+constexpr float kIncreaseThreshold = 0.9f;
+
+/// Quality increase per interval while under the threshold. Increases are
+/// slow compared to decreases, which are proportional to the overuse.
+constexpr float kQualityStep = 0.05f;
+
+/// Largest decrease factor of the quality in a single interval.
+constexpr float kMaxDecreaseFactor = 0.5f;
+
+/// Get the cumulative CPU time of all the threads of the current process, in
+/// microseconds, or -1 if not available.
+int64_t GetProcessCpuTimeUs() {
+#if defined(MR_SHARING_ANDROID)
+  timespec ts{};
+  if (clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts) != 0) {
+    return -1;
+  }
+  return static_cast<int64_t>(ts.tv_sec) * rtc::kNumMicrosecsPerSec +
+         ts.tv_nsec / rtc::kNumNanosecsPerMicrosec;
+#elif defined(MR_SHARING_WIN)
+  FILETIME creation_time, exit_time, kernel_time, user_time;
+  if (!GetProcessTimes(GetCurrentProcess(), &creation_time, &exit_time,
+                       &kernel_time, &user_time)) {
+    return -1;
+  }
+  auto to_100ns = [](const FILETIME& ft) {
+    return (static_cast<uint64_t>(ft.dwHighDateTime) << 32) | ft.dwLowDateTime;
+  };
+  return static_cast<int64_t>((to_100ns(kernel_time) + to_100ns(user_time)) /
+                              10);
+#else
+  return -1;
+#endif
+}
+
+}  // namespace
+
+namespace Microsoft {
+namespace MixedReality {
+namespace WebRTC {
+
+CpuBudgetManager& CpuBudgetManager::Instance() noexcept {
+  // Intentionally leaked, so that messages still pending in the queue of a
+  // thread destroyed during static destruction can be safely discarded.
+  static CpuBudgetManager* const instance = new CpuBudgetManager();
+  return *instance;
+}
+
+void CpuBudgetManager::Register(PeerConnection* peer,
+                                rtc::Thread* signaling_thread) noexcept {
+  RTC_DCHECK(peer);
+  RTC_DCHECK(signaling_thread);
+  std::lock_guard<std::mutex> lock(mutex_);
+  Entry entry;
+  entry.peer = peer;
+  entry.signaling_thread = signaling_thread;
+  entries_.push_back(entry);
+  if (running_) {
+    AllocateNoLock();
+  }
+}
+
+void CpuBudgetManager::Unregister(PeerConnection* peer) noexcept {
+  std::unique_lock<std::mutex> lock(mutex_);
+  auto find_entry = [this, peer]() {
+    return std::find_if(
+        entries_.begin(), entries_.end(),
+        [peer](const Entry& entry) { return (entry.peer == peer); });
+  };
+  auto it = find_entry();
+  // Limits are applied without |mutex_| held, so wait for any application in
+  // progress on another thread before the peer connection is destroyed.
+  while ((it != entries_.end()) && it->applying &&
+         !it->signaling_thread->IsCurrent()) {
+    apply_done_.wait(lock);
+    it = find_entry();
+  }
+  if (it == entries_.end()) {
+    return;
+  }
+  entries_.erase(it);
+  if (running_) {
+    AllocateNoLock();
+  }
+}
+
+void CpuBudgetManager::UnregisterThread(
+    rtc::Thread* signaling_thread) noexcept {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.erase(std::remove_if(entries_.begin(), entries_.end(),
+                                  [signaling_thread](const Entry& entry) {
+                                    return (entry.signaling_thread ==
+                                            signaling_thread);
+                                  }),
+                   entries_.end());
+  }
+  // Limits are only posted with |mutex_| held and for registered peer
+  // connections, so no new message can be posted to the thread.
+  signaling_thread->Clear(this, MSG_APPLY);
+}
+
+Result CpuBudgetManager::Start(const mrsCpuBudgetConfig& config) noexcept {
+  if (!(config.target_cpu_percent > 0.0f) ||
+      (config.target_cpu_percent > 100.0f)) {
+    RTC_LOG(LS_ERROR) << "Invalid CPU budget target "
+                      << config.target_cpu_percent
+                      << "%, must be in ]0:100].";
+    return Result::kInvalidParameter;
+  }
+  if (config.interval_ms <= 0) {
+    RTC_LOG(LS_ERROR) << "Invalid CPU budget interval " << config.interval_ms
+                      << " ms.";
+    return Result::kInvalidParameter;
+  }
+  if (!(config.min_quality > 0.0f) || (config.min_quality > 1.0f)) {
+    RTC_LOG(LS_ERROR) << "Invalid CPU budget minimum quality "
+                      << config.min_quality << ", must be in ]0:1].";
+    return Result::kInvalidParameter;
+  }
+  if ((config.max_framerate <= 0) || (config.max_bitrate_bps <= 0)) {
+    RTC_LOG(LS_ERROR) << "Invalid CPU budget full quality frame rate "
+                      << config.max_framerate << " or bitrate "
+                      << config.max_bitrate_bps << " bps.";
+    return Result::kInvalidParameter;
+  }
+  std::lock_guard<std::mutex> control_lock(control_mutex_);
+  if (sampling_thread_) {
+    sampling_thread_->Stop();
+    sampling_thread_.reset();
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    config_ = config;
+    running_ = true;
+    quality_ = 1.0f;
+    cpu_percent_ = -1.0f;
+    cpu_time_us_ = -1;
+    AllocateNoLock();
+  }
+  sampling_thread_ = rtc::Thread::Create();
+  sampling_thread_->SetName("MR-WebRTC CPU budget manager",
+                            sampling_thread_.get());
+  sampling_thread_->Start();
+  sampling_thread_->Post(RTC_FROM_HERE, this, MSG_SAMPLE);
+  return Result::kSuccess;
+}
+
+Result CpuBudgetManager::Stop() noexcept {
+  std::lock_guard<std::mutex> control_lock(control_mutex_);
+  if (!sampling_thread_) {
+    return Result::kSuccess;
+  }
+  // This discards the next scheduled sample
+  sampling_thread_->Stop();
+  sampling_thread_.reset();
+  std::lock_guard<std::mutex> lock(mutex_);
+  running_ = false;
+  quality_ = 1.0f;
+  cpu_percent_ = -1.0f;
+  AllocateNoLock();
+  // Remove the limits applied so far
+  PostApplyNoLock();
+  return Result::kSuccess;
+}
+
+void CpuBudgetManager::GetStatus(mrsCpuBudgetStatus& status) const noexcept {
+  std::lock_guard<std::mutex> lock(mutex_);
+  status.running = (running_ ? mrsBool::kTrue : mrsBool::kFalse);
+  status.cpu_percent = cpu_percent_;
+  status.quality = quality_;
+  status.peer_connection_count = static_cast<uint32_t>(entries_.size());
+}
+
+Result CpuBudgetManager::SetWeight(PeerConnection* peer,
+                                   float weight) noexcept {
+  if (!(weight > 0.0f)) {
+    RTC_LOG(LS_ERROR) << "Invalid CPU budget weight " << weight
+                      << ", must be strictly positive.";
+    return Result::kInvalidParameter;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = std::find_if(
+      entries_.begin(), entries_.end(),
+      [peer](const Entry& entry) { return (entry.peer == peer); });
+  if (it == entries_.end()) {
+    return Result::kNotFound;
+  }
+  it->weight = weight;
+  if (running_) {
+    AllocateNoLock();
+  }
+  return Result::kSuccess;
+}
+
+Result CpuBudgetManager::GetAllocation(
+    PeerConnection* peer,
+    mrsCpuBudgetAllocation& allocation) const noexcept {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = std::find_if(
+      entries_.begin(), entries_.end(),
+      [peer](const Entry& entry) { return (entry.peer == peer); });
+  if (it == entries_.end()) {
+    return Result::kNotFound;
+  }
+  allocation.weight = it->weight;
+  allocation.quality = it->quality;
+  allocation.scale_resolution_down_by = it->scale_resolution_down_by;
+  allocation.max_framerate = it->max_framerate;
+  allocation.max_bitrate_bps = it->max_bitrate_bps;
+  allocation.video_sender_count = it->video_sender_count;
+  allocation.resolution_scaling_supported =
+      (it->resolution_supported ? mrsBool::kTrue : mrsBool::kFalse);
+  allocation.framerate_limit_supported =
+      (it->framerate_supported ? mrsBool::kTrue : mrsBool::kFalse);
+  return Result::kSuccess;
+}
+
+void CpuBudgetManager::OnMessage(rtc::Message* message) {
+  switch (message->message_id) {
+    case MSG_SAMPLE:
+      Sample();
+      break;
+    case MSG_APPLY:
+      Apply();
+      break;
+  }
+}
+
+void CpuBudgetManager::Sample() {
+  const int64_t cpu_time_us = GetProcessCpuTimeUs();
+  const int64_t now_us = rtc::TimeMicros();
+  const unsigned int core_count =
+      std::max(std::thread::hardware_concurrency(), 1u);
+  int interval_ms;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    interval_ms = config_.interval_ms;
+    if ((cpu_time_us >= 0) && (cpu_time_us_ >= 0) &&
+        (now_us > sample_time_us_)) {
+      cpu_percent_ = static_cast<float>(
+          100.0 * (cpu_time_us - cpu_time_us_) /
+          (static_cast<double>(now_us - sample_time_us_) * core_count));
+      const float target = config_.target_cpu_percent;
+      if (cpu_percent_ > target) {
+        // Decrease proportionally to the overuse
+        const float factor =
+            std::max(target / cpu_percent_, kMaxDecreaseFactor);
+        quality_ = std::max(quality_ * factor, config_.min_quality);
+      } else if (cpu_percent_ < target * kIncreaseThreshold) {
+        quality_ = std::min(quality_ + kQualityStep, 1.0f);
+      }
+    }
+    cpu_time_us_ = cpu_time_us;
+    sample_time_us_ = now_us;
+    AllocateNoLock();
+    PostApplyNoLock();
+  }
+
+  rtc::Thread::Current()->PostDelayed(RTC_FROM_HERE, interval_ms, this,
+                                      MSG_SAMPLE);
+}
+
+void CpuBudgetManager::AllocateNoLock() {
+  // Share a total of |quality_| times the number of peer connections in
+  // proportion to the weights, capping each share at full quality and
+  // redistributing the excess to the others.
+  std::vector<Entry*> uncapped;
+  uncapped.reserve(entries_.size());
+  float total_weight = 0.0f;
+  for (auto&& entry : entries_) {
+    uncapped.push_back(&entry);
+    total_weight += entry.weight;
+  }
+  float budget = quality_ * entries_.size();
+  bool capped = true;
+  while (capped && !uncapped.empty()) {
+    capped = false;
+    for (auto it = uncapped.begin(); it != uncapped.end(); ++it) {
+      if (budget * (*it)->weight >= total_weight) {
+        (*it)->quality = 1.0f;
+        budget -= 1.0f;
+        total_weight -= (*it)->weight;
+        uncapped.erase(it);
+        capped = true;
+        break;
+      }
+    }
+  }
+  const float min_quality = (running_ ? config_.min_quality : 1.0f);
+  for (Entry* entry : uncapped) {
+    entry->quality =
+        std::max(budget * entry->weight / total_weight, min_quality);
+  }
+}
+
+void CpuBudgetManager::PostApplyNoLock() {
+  std::vector<rtc::Thread*> threads;
+  for (auto&& entry : entries_) {
+    if (std::find(threads.begin(), threads.end(), entry.signaling_thread) ==
+        threads.end()) {
+      threads.push_back(entry.signaling_thread);
+      // Registered peer connections keep their signaling thread alive
+      entry.signaling_thread->Post(RTC_FROM_HERE, this, MSG_APPLY);
+    }
+  }
+}
+
+void CpuBudgetManager::Apply() {
+  // Compute the limits of the peer connections running on this thread, and
+  // apply them without |mutex_| held, since this blocks on the worker thread
+  // and updating the allocations must not wait for it.
+  struct Update {
+    PeerConnection* peer;
+    VideoSendLimits limits;
+    uint32_t sender_count;
+    bool resolution_supported;
+    bool framerate_supported;
+  };
+  std::vector<Update> updates;
+  rtc::Thread* const current = rtc::Thread::Current();
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto&& entry : entries_) {
+      if ((entry.signaling_thread != current) || entry.applying) {
+        continue;
+      }
+      updates.push_back(Update{entry.peer, GetLimitsNoLock(entry), 0,
+                               entry.resolution_supported,
+                               entry.framerate_supported});
+      entry.applying = true;
+    }
+  }
+  for (Update& update : updates) {
+    update.peer->SetVideoSendLimits(update.limits, update.sender_count,
+                                    update.resolution_supported,
+                                    update.framerate_supported);
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const Update& update : updates) {
+      auto it = std::find_if(entries_.begin(), entries_.end(),
+                             [&update](const Entry& entry) {
+                               return (entry.peer == update.peer);
+                             });
+      if (it == entries_.end()) {
+        continue;
+      }
+      Entry& entry = *it;
+      entry.applying = false;
+      entry.resolution_supported = update.resolution_supported;
+      entry.framerate_supported = update.framerate_supported;
+      entry.scale_resolution_down_by =
+          (entry.resolution_supported
+               ? update.limits.scale_resolution_down_by.value_or(1.0)
+               : 1.0);
+      entry.max_framerate =
+          (entry.framerate_supported ? update.limits.max_framerate.value_or(0)
+                                     : 0);
+      entry.max_bitrate_bps = update.limits.max_bitrate_bps.value_or(0);
+      entry.video_sender_count = update.sender_count;
+    }
+  }
+  apply_done_.notify_all();
+}
+
+VideoSendLimits CpuBudgetManager::GetLimitsNoLock(const Entry& entry) const {
+  // Split the quality evenly between the number of pixels and the frame rate,
+  // so that the encoding cost scales roughly with the quality.
+  VideoSendLimits limits;
+  if (entry.quality < 1.0f) {
+    const double pixel_rate_factor = std::sqrt(entry.quality);
+    limits.scale_resolution_down_by = 1.0 / std::sqrt(pixel_rate_factor);
+    limits.max_framerate = std::max(
+        static_cast<int>(config_.max_framerate * pixel_rate_factor + 0.5), 1);
+    const int full_bitrate_bps = (entry.peer->GetMaxBitrate() > 0
+                                      ? entry.peer->GetMaxBitrate()
+                                      : config_.max_bitrate_bps);
+    limits.max_bitrate_bps =
+        static_cast<int>(full_bitrate_bps * entry.quality);
+  }
+  // Don't try again the limits rejected by a previous attempt
+  if (!entry.resolution_supported) {
+    limits.scale_resolution_down_by.reset();
+  }
+  if (!entry.framerate_supported) {
+    limits.max_framerate.reset();
+  }
+  return limits;
+}
+
+}  // namespace WebRTC
+}  // namespace MixedReality
+}  // namespace Microsoft
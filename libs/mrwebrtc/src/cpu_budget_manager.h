@@ -0,0 +1,152 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "cpu_budget_interop.h"
+#include "mrs_errors.h"
+
+namespace Microsoft {
+namespace MixedReality {
+namespace WebRTC {
+
+class PeerConnection;
+struct VideoSendLimits;
+
+/// Process-wide manager sharing a CPU budget among all peer connections, by
+/// limiting the resolution, frame rate and bitrate of their video senders.
+///
+/// Peer connections are registered by their constructor for their whole
+/// lifetime, whether or not the manager is running. Once started, the manager
+/// measures the CPU usage of the process from its own thread at a fixed
+/// interval, updates a global quality level, and shares it among the peer
+/// connections according to their weights. The resulting limits are applied
+/// to each peer connection on its signaling thread, where its RTP senders
+/// live.
+class CpuBudgetManager : public rtc::MessageHandler {
+ public:
+  /// Get the singleton instance, which is never destroyed.
+  static CpuBudgetManager& Instance() noexcept;
+
+  /// Register a peer connection and the signaling thread it runs on. The
+  /// signaling thread must outlive the registration. This is
+  /// multithread-safe.
+  void Register(PeerConnection* peer, rtc::Thread* signaling_thread) noexcept;
+
+  /// Unregister a peer connection. Once this returns, no limit is being
+  /// applied to it. This is multithread-safe.
+  void Unregister(PeerConnection* peer) noexcept;
+
+  /// Unregister all the peer connections still running on a signaling thread
+  /// about to be destroyed, which were leaked by a forced shutdown. This is
+  /// multithread-safe.
+  void UnregisterThread(rtc::Thread* signaling_thread) noexcept;
+
+  /// Start or restart the manager. See |mrsCpuBudgetStart()|.
+  Result Start(const mrsCpuBudgetConfig& config) noexcept;
+
+  /// Stop the manager and remove all limits. See |mrsCpuBudgetStop()|.
+  Result Stop() noexcept;
+
+  /// Get the current state of the manager.
+  void GetStatus(mrsCpuBudgetStatus& status) const noexcept;
+
+  /// Set the priority weight of a registered peer connection.
+  Result SetWeight(PeerConnection* peer, float weight) noexcept;
+
+  /// Get the share of the budget allocated to a registered peer connection.
+  Result GetAllocation(PeerConnection* peer,
+                       mrsCpuBudgetAllocation& allocation) const noexcept;
+
+ protected:
+  //
+  // MessageHandler interface
+  //
+
+  void OnMessage(rtc::Message* message) override;
+
+ private:
+  struct Entry {
+    PeerConnection* peer{nullptr};
+    rtc::Thread* signaling_thread{nullptr};
+    float weight{1.0f};
+
+    /// Quality allocated by the last adaptation.
+    float quality{1.0f};
+
+    /// Limits last applied to the video senders, and their result.
+    double scale_resolution_down_by{1.0};
+    int max_framerate{0};
+    int max_bitrate_bps{0};
+    uint32_t video_sender_count{0};
+    bool resolution_supported{true};
+    bool framerate_supported{true};
+
+    /// Whether limits are being applied to the peer connection, without
+    /// |mutex_| held.
+    bool applying{false};
+  };
+
+  CpuBudgetManager() = default;
+
+  /// Measure the CPU usage and update the allocations. Called on the sampling
+  /// thread.
+  void Sample();
+
+  /// Share the global quality level among the registered peer connections.
+  /// |mutex_| must be held.
+  void AllocateNoLock();
+
+  /// Post a message to each signaling thread to apply the current allocations.
+  /// |mutex_| must be held.
+  void PostApplyNoLock();
+
+  /// Get the limits to apply to the video senders of a peer connection for its
+  /// current allocation. |mutex_| must be held.
+  VideoSendLimits GetLimitsNoLock(const Entry& entry) const;
+
+  /// Apply the current allocations to the peer connections running on the
+  /// current signaling thread.
+  void Apply();
+
+  /// Mutex serializing |Start()| and |Stop()|. This is never held while
+  /// acquiring |mutex_|, so that stopping can wait for the sampling thread.
+  std::mutex control_mutex_;
+
+  /// Thread on which sampling is scheduled, while running.
+  std::unique_ptr<rtc::Thread> sampling_thread_ RTC_GUARDED_BY(control_mutex_);
+
+  mutable std::mutex mutex_;
+
+  /// Current configuration, only valid while running.
+  mrsCpuBudgetConfig config_ RTC_GUARDED_BY(mutex_);
+  bool running_ RTC_GUARDED_BY(mutex_) = false;
+
+  /// Global quality level, in [min_quality:1].
+  float quality_ RTC_GUARDED_BY(mutex_) = 1.0f;
+
+  /// CPU usage measured during the last interval, in percent, or negative if
+  /// not available.
+  float cpu_percent_ RTC_GUARDED_BY(mutex_) = -1.0f;
+
+  /// CPU time of the process and wall clock time at the last sample, in
+  /// microseconds, or negative if not sampled yet.
+  int64_t cpu_time_us_ RTC_GUARDED_BY(mutex_) = -1;
+  int64_t sample_time_us_ RTC_GUARDED_BY(mutex_) = 0;
+
+  /// Registered peer connections. This is small, so a vector is enough.
+  std::vector<Entry> entries_ RTC_GUARDED_BY(mutex_);
+
+  /// Signaled when limits were applied to a peer connection, for unregistering
+  /// it only once they are.
+  std::condition_variable apply_done_;
+};
+
+}  // namespace WebRTC
+}  // namespace MixedReality
+}  // namespace Microsoft
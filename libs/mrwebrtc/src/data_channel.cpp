@@ -4,8 +4,10 @@
 
 #include "pch.h"
 
+#include "alloc_tracker.h"
 #include "data_channel.h"
 #include "peer_connection.h"
+#include "tracing.h"
 
 namespace {
 
@@ -31,7 +33,10 @@ namespace WebRTC {
 DataChannel::DataChannel(
     PeerConnection* owner,
     rtc::scoped_refptr<webrtc::DataChannelInterface> data_channel) noexcept
-    : owner_(owner), data_channel_(std::move(data_channel)) {
+    : owner_(owner),
+      data_channel_(std::move(data_channel)),
+      buffered_memory_(owner->GetMemoryAccount(),
+                       MemoryCategory::kDataChannel) {
   RTC_CHECK(owner_);
   data_channel_->RegisterObserver(this);
 }
@@ -51,16 +56,19 @@ std::string DataChannel::label() const {
 void DataChannel::SetMessageCallback(MessageCallback callback) noexcept {
   std::lock_guard<std::mutex> lock(mutex_);
   message_callback_ = callback;
+  message_callback_.SetSite(this, mrsCallbackType::kDataChannelMessage);
 }
 
 void DataChannel::SetBufferingCallback(BufferingCallback callback) noexcept {
   std::lock_guard<std::mutex> lock(mutex_);
   buffering_callback_ = callback;
+  buffering_callback_.SetSite(this, mrsCallbackType::kDataChannelBuffering);
 }
 
 void DataChannel::SetStateCallback(StateCallback callback) noexcept {
   std::lock_guard<std::mutex> lock(mutex_);
   state_callback_ = callback;
+  state_callback_.SetSite(this, mrsCallbackType::kDataChannelState);
 }
 
 size_t DataChannel::GetMaxBufferingSize() const noexcept {
@@ -71,13 +79,36 @@ size_t DataChannel::GetMaxBufferingSize() const noexcept {
 }
 
 bool DataChannel::Send(const void* data, size_t size) noexcept {
+  MRS_TRACE_SCOPE("DataChannel::Send");
   if (data_channel_->buffered_amount() + size > GetMaxBufferingSize()) {
+    ObjectMetrics::Add(metrics_.frames_dropped, 1);
     return false;
   }
 
-  rtc::CopyOnWriteBuffer bufferStorage((const char*)data, size);
-  webrtc::DataBuffer buffer(bufferStorage, /* binary = */ true);
-  return data_channel_->Send(buffer);
+  rtc::CopyOnWriteBuffer message;
+  {
+    std::lock_guard<std::mutex> lock(send_mutex_);
+    // This only reallocates if the previous message is still referenced, or if
+    // the new message is larger.
+    send_buffer_.SetData((const uint8_t*)data, size);
+    message = send_buffer_;
+  }
+  // Send without the lock, since this can synchronously invoke the callbacks
+  // of the channel, which can send another message. The reference taken on the
+  // buffer keeps a concurrent call from overwriting the message.
+  webrtc::DataBuffer buffer(message, /* binary = */ true);
+  bool sent;
+  {
+    MRS_ALLOC_SCOPE("webrtc::DataChannelInterface::Send");
+    sent = data_channel_->Send(buffer);
+  }
+  if (!sent) {
+    ObjectMetrics::Add(metrics_.frames_dropped, 1);
+    return false;
+  }
+  ObjectMetrics::Add(metrics_.frames_out, 1);
+  ObjectMetrics::Add(metrics_.bytes_sent, size);
+  return true;
 }
 
 void DataChannel::InvokeOnStateChange() const noexcept {
@@ -95,16 +126,22 @@ void DataChannel::OnStateChange() noexcept {
 }
 
 void DataChannel::OnMessage(const webrtc::DataBuffer& buffer) noexcept {
+  MRS_TRACE_SCOPE("DataChannel::OnMessage");
+  ObjectMetrics::Add(metrics_.frames_in, 1);
+  ObjectMetrics::Add(metrics_.bytes_received, buffer.data.size());
   std::lock_guard<std::mutex> lock(mutex_);
   if (message_callback_) {
+    const int64_t start_us = rtc::TimeMicros();
     message_callback_(buffer.data.data(), buffer.data.size());
+    metrics_.AddCallback(start_us);
   }
 }
 
 void DataChannel::OnBufferedAmountChange(uint64_t previous_amount) noexcept {
   std::lock_guard<std::mutex> lock(mutex_);
+  const uint64_t current_amount = data_channel_->buffered_amount();
+  buffered_memory_.Set(static_cast<size_t>(current_amount));
   if (buffering_callback_) {
-    uint64_t current_amount = data_channel_->buffered_amount();
     constexpr uint64_t max_capacity =
         0x1000000;  // 16MB, see DataChannelInterface
     buffering_callback_(previous_amount, current_amount, max_capacity);
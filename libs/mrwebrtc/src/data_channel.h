@@ -12,6 +12,8 @@
 #include "data_channel.h"
 #include "data_channel_interop.h"
 #include "interop_api.h"
+#include "memory_account.h"
+#include "tracked_object.h"
 
 namespace Microsoft {
 namespace MixedReality {
@@ -91,6 +93,10 @@ class DataChannel : public webrtc::DataChannelObserver {
   /// Send a blob of data through the data channel.
   bool Send(const void* data, size_t size) noexcept;
 
+  /// Get the performance counters of the data channel. Data channels are not
+  /// tracked objects, so they hold their own counters.
+  MRS_NODISCARD ObjectMetrics& GetMetrics() const noexcept { return metrics_; }
+
   //
   // Advanced use
   //
@@ -131,6 +137,18 @@ class DataChannel : public webrtc::DataChannelObserver {
   StateCallback state_callback_ RTC_GUARDED_BY(mutex_);
   mutable std::mutex mutex_;
 
+  /// Storage of the last message sent, reused by the next call to |Send()| to
+  /// avoid an allocation per message once no longer referenced by WebRTC.
+  rtc::CopyOnWriteBuffer send_buffer_ RTC_GUARDED_BY(send_mutex_);
+  std::mutex send_mutex_;
+
+  /// Performance counters.
+  mutable ObjectMetrics metrics_;
+
+  /// Memory charged for the data queued for sending, charged to the account of
+  /// the owning peer connection.
+  MemoryCharge buffered_memory_ RTC_GUARDED_BY(mutex_);
+
   /// Opaque user data.
   void* user_data_{nullptr};
 };
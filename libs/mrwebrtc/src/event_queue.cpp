@@ -0,0 +1,773 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+// This is a precompiled header, it must be on its own, followed by a blank
+// line, to prevent clang-format from reordering it with other headers.
+#include "pch.h"
+
+#include <cstring>
+#include <functional>
+#include <vector>
+
+#include "callback.h"
+#include "event_queue.h"
+#include "interop/global_factory.h"
+#include "memory_account.h"
+#include "thread_monitor.h"
+#include "tracked_object.h"
+
+namespace {
+
+using namespace Microsoft::MixedReality::WebRTC;
+
+/// Maximum number of dispatch threads.
+constexpr uint32_t kMaxDispatchThreadCount = 64;
+
+/// Node of an intrusive lock-free queue.
+struct QueueNode {
+  std::atomic<QueueNode*> next_{nullptr};
+};
+
+/// Queued event, with the storage of its arguments. Only the members needed by
+/// the event type are used.
+struct EventRecord : public QueueNode {
+  mrsEvent event_{};
+  void* callback_{nullptr};
+  bool is_frame_{false};
+  std::string text_;
+  std::string text2_;
+  std::vector<uint8_t> frame_data_;
+  mrsIceCandidate candidate_{};
+  mrsTransceiverAddedInfo transceiver_info_{};
+  mrsRemoteAudioTrackAddedInfo audio_track_info_{};
+  mrsRemoteVideoTrackAddedInfo video_track_info_{};
+  mrsDataChannelAddedInfo data_channel_info_{};
+  I420AVideoFrame i420a_frame_{};
+  Argb32VideoFrame argb32_frame_{};
+  AudioFrame audio_frame_{};
+
+  /// References keeping alive the objects whose handles are reported in the
+  /// event, until the event is delivered.
+  RefPtr<TrackedObject> refs_[2];
+
+  /// Memory charged for the record while pending, released on destruction.
+  MemoryCharge memory_{MemoryAccount::Global(), MemoryCategory::kEventQueue};
+};
+
+/// Intrusive multiple-producer single-consumer queue. Pushing is wait-free and
+/// never allocates. Popping may transiently return null while a producer is
+/// in the middle of a push; the node is returned by a later pop.
+class MpscQueue {
+ public:
+  MpscQueue() noexcept : head_(&stub_), tail_(&stub_) {}
+
+  void Push(QueueNode* node) noexcept {
+    node->next_.store(nullptr, std::memory_order_relaxed);
+    QueueNode* const prev = head_.exchange(node, std::memory_order_acq_rel);
+    prev->next_.store(node, std::memory_order_release);
+  }
+
+  /// Pop the oldest node. Must be called by a single consumer at a time.
+  QueueNode* Pop() noexcept {
+    QueueNode* tail = tail_;
+    QueueNode* next = tail->next_.load(std::memory_order_acquire);
+    if (tail == &stub_) {
+      if (!next) {
+        return nullptr;
+      }
+      tail_ = next;
+      tail = next;
+      next = next->next_.load(std::memory_order_acquire);
+    }
+    if (next) {
+      tail_ = next;
+      return tail;
+    }
+    if (tail != head_.load(std::memory_order_acquire)) {
+      return nullptr;  // push in progress
+    }
+    Push(&stub_);
+    next = tail->next_.load(std::memory_order_acquire);
+    if (next) {
+      tail_ = next;
+      return tail;
+    }
+    return nullptr;
+  }
+
+ private:
+  std::atomic<QueueNode*> head_;
+  QueueNode* tail_;
+  QueueNode stub_;
+};
+
+/// Queue of the events of a subset of the objects, and its dispatch thread if
+/// any.
+struct Partition {
+  uint32_t index_{0};
+  MpscQueue queue_;
+  std::atomic_uint32_t pending_frames_{0};
+  std::atomic_bool wake_pending_{false};
+  std::unique_ptr<rtc::Thread> thread_;
+};
+
+/// Invoke the callback of a record, with the signature of its event type.
+template <typename... Args>
+void InvokeAs(const EventRecord& record, Args... args) {
+  const auto callback =
+      reinterpret_cast<typename Callback<Args...>::callback_type>(
+          record.callback_);
+  (*callback)(record.event_.user_data, args...);
+}
+
+void Invoke(const EventRecord& record) {
+  const mrsEvent& event = record.event_;
+  switch (event.type) {
+    case mrsCallbackType::kI420AVideoFrame:
+      InvokeAs<const I420AVideoFrame&>(record, record.i420a_frame_);
+      break;
+    case mrsCallbackType::kArgb32VideoFrame:
+      InvokeAs<const Argb32VideoFrame&>(record, record.argb32_frame_);
+      break;
+    case mrsCallbackType::kAudioFrame:
+      InvokeAs<const AudioFrame&>(record, record.audio_frame_);
+      break;
+    case mrsCallbackType::kLocalSdpReadyToSend:
+      InvokeAs<mrsSdpMessageType, const char*>(
+          record, static_cast<mrsSdpMessageType>(event.args[0]),
+          record.text_.c_str());
+      break;
+    case mrsCallbackType::kIceCandidateReadyToSend:
+      InvokeAs<const mrsIceCandidate*>(record, &record.candidate_);
+      break;
+    case mrsCallbackType::kIceStateChanged:
+      InvokeAs<mrsIceConnectionState>(
+          record, static_cast<mrsIceConnectionState>(event.args[0]));
+      break;
+    case mrsCallbackType::kIceGatheringStateChanged:
+      InvokeAs<mrsIceGatheringState>(
+          record, static_cast<mrsIceGatheringState>(event.args[0]));
+      break;
+    case mrsCallbackType::kRenegotiationNeeded:
+    case mrsCallbackType::kConnected:
+    case mrsCallbackType::kKeyFrameRequested:
+      InvokeAs<>(record);
+      break;
+    case mrsCallbackType::kTransceiverAdded:
+      InvokeAs<const mrsTransceiverAddedInfo*>(record,
+                                               &record.transceiver_info_);
+      break;
+    case mrsCallbackType::kAudioTrackAdded:
+      InvokeAs<const mrsRemoteAudioTrackAddedInfo*>(record,
+                                                    &record.audio_track_info_);
+      break;
+    case mrsCallbackType::kVideoTrackAdded:
+      InvokeAs<const mrsRemoteVideoTrackAddedInfo*>(record,
+                                                    &record.video_track_info_);
+      break;
+    case mrsCallbackType::kAudioTrackRemoved:
+    case mrsCallbackType::kVideoTrackRemoved:
+      InvokeAs<void*, void*>(record, event.handles[0], event.handles[1]);
+      break;
+    case mrsCallbackType::kDataChannelAdded:
+      InvokeAs<const mrsDataChannelAddedInfo*>(record,
+                                               &record.data_channel_info_);
+      break;
+    case mrsCallbackType::kDataChannelRemoved:
+      InvokeAs<void*>(record, event.handles[0]);
+      break;
+    case mrsCallbackType::kTransceiverAssociated:
+      InvokeAs<int>(record, static_cast<int>(event.args[0]));
+      break;
+    case mrsCallbackType::kTransceiverStateUpdated:
+      InvokeAs<mrsTransceiverStateUpdatedReason, mrsTransceiverOptDirection,
+               mrsTransceiverDirection>(
+          record, static_cast<mrsTransceiverStateUpdatedReason>(event.args[0]),
+          static_cast<mrsTransceiverOptDirection>(event.args[1]),
+          static_cast<mrsTransceiverDirection>(event.args[2]));
+      break;
+    default:
+      RTC_NOTREACHED();
+      break;
+  }
+}
+
+/// Copy a string argument into |storage|, preserving null pointers.
+const char* CopyString(const char* str, std::string& storage) {
+  if (!str) {
+    return nullptr;
+  }
+  storage.assign(str);
+  return storage.c_str();
+}
+
+/// Configuration and queues of the event queue, and message handler of the
+/// dispatch threads.
+class EventQueueState : public rtc::MessageHandler {
+ public:
+  /// Serializes configuration changes.
+  std::mutex config_mutex_;
+  mrsEventQueueConfig config_ RTC_GUARDED_BY(config_mutex_);
+
+  /// Serializes polling, and protects the partitions against configuration
+  /// changes while polling.
+  std::mutex poll_mutex_;
+
+  /// Records of the last batch returned by |EventQueue::Poll()|, kept alive
+  /// until the next call.
+  std::vector<EventRecord*> polled_ RTC_GUARDED_BY(poll_mutex_);
+
+  /// Queues, modified only while not queueing. Since the configuration can
+  /// only change while the library is not initialized, no WebRTC object exists
+  /// which could post an event at that time.
+  std::vector<std::unique_ptr<Partition>> partitions_;
+
+  /// Copy of |config_.max_pending_frames| readable without lock.
+  std::atomic_uint32_t max_pending_frames_{0};
+
+  std::atomic_uint64_t dropped_frames_{0};
+
+  /// Get the partition of the events raised by the given object.
+  Partition& GetPartition(void* object) noexcept {
+    const size_t index =
+        std::hash<void*>()(object) % static_cast<size_t>(partitions_.size());
+    return *partitions_[index];
+  }
+
+  /// Push a record and wake up the dispatch thread of its partition if needed.
+  void Push(Partition& partition, EventRecord* record) noexcept {
+    partition.queue_.Push(record);
+    if (partition.thread_ && !partition.wake_pending_.exchange(true)) {
+      partition.thread_->Post(RTC_FROM_HERE, this, partition.index_);
+    }
+  }
+
+  /// Pop the next record of a partition, or return null if none.
+  static EventRecord* Pop(Partition& partition) noexcept {
+    QueueNode* const node = partition.queue_.Pop();
+    if (!node) {
+      return nullptr;
+    }
+    EventRecord* const record = static_cast<EventRecord*>(node);
+    if (record->is_frame_) {
+      partition.pending_frames_.fetch_sub(1, std::memory_order_relaxed);
+    }
+    return record;
+  }
+
+  /// Destroy all partitions, stopping their threads and discarding their
+  /// pending events.
+  void DestroyPartitions() noexcept {
+    for (auto&& partition : partitions_) {
+      if (partition->thread_) {
+        ThreadMonitor::Instance().Unregister(partition->thread_.get());
+        partition->thread_->Stop();
+        partition->thread_.reset();
+      }
+      while (EventRecord* const record = Pop(*partition)) {
+        delete record;
+      }
+    }
+    partitions_.clear();
+  }
+
+  /// Dispatch all pending events of a partition. Called on its thread only.
+  static void Drain(Partition& partition) noexcept {
+    while (EventRecord* const record = Pop(partition)) {
+      {
+        CallbackWatchdogScope scope(
+            CallbackSite{record->event_.object_handle, record->event_.type});
+        Invoke(*record);
+      }
+      delete record;
+    }
+  }
+
+  /// Release the records of the last polled batch. |poll_mutex_| must be
+  /// held.
+  void ReleasePolled() noexcept {
+    for (EventRecord* record : polled_) {
+      delete record;
+    }
+    polled_.clear();
+  }
+
+ protected:
+  /// Dispatch all pending events of a partition. Called on its thread.
+  void OnMessage(rtc::Message* message) override {
+    Partition& partition = *partitions_[message->message_id];
+    // Clear the flag before draining, so that any event pushed after the last
+    // pop wakes the thread again.
+    partition.wake_pending_.store(false);
+    Drain(partition);
+  }
+};
+
+EventQueueState& GetState() {
+  // Intentionally leaked, like other process-wide singletons.
+  static EventQueueState* const state = new EventQueueState();
+  return *state;
+}
+
+/// Check if an event of the given site can be queued, and return the record to
+/// fill and push, or null if the callback must be invoked directly.
+EventRecord* NewRecord(const CallbackSite& site,
+                       void* callback,
+                       void* user_data) noexcept {
+  if (!EventQueue::IsQueueing() || (site.type_ == mrsCallbackType::kUnknown)) {
+    return nullptr;
+  }
+  EventRecord* const record = new EventRecord();
+  record->event_.type = site.type_;
+  record->event_.object_handle = site.object_;
+  record->event_.user_data = user_data;
+  record->callback_ = callback;
+  return record;
+}
+
+/// Push a filled record to the partition of its object.
+bool Push(EventRecord* record) noexcept {
+  record->memory_.Set(sizeof(EventRecord) + record->text_.capacity() +
+                      record->text2_.capacity() +
+                      record->frame_data_.capacity());
+  EventQueueState& state = GetState();
+  state.Push(state.GetPartition(record->event_.object_handle), record);
+  return true;
+}
+
+/// Reserve a slot for a frame event in the partition of the given object.
+/// Return false and count a dropped frame if too many frames are pending.
+bool ReserveFrame(const CallbackSite& site) noexcept {
+  EventQueueState& state = GetState();
+  Partition& partition = state.GetPartition(site.object_);
+  const uint32_t max_frames =
+      state.max_pending_frames_.load(std::memory_order_relaxed);
+  if (partition.pending_frames_.fetch_add(1, std::memory_order_relaxed) >=
+      max_frames) {
+    partition.pending_frames_.fetch_sub(1, std::memory_order_relaxed);
+    state.dropped_frames_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  return true;
+}
+
+/// Release a slot reserved by |ReserveFrame()| for a frame event which is not
+/// queued after all.
+void ReleaseFrame(const CallbackSite& site) noexcept {
+  Partition& partition = GetState().GetPartition(site.object_);
+  partition.pending_frames_.fetch_sub(1, std::memory_order_relaxed);
+}
+
+/// Reserve a slot and create the record of a frame event. Return null if the
+/// callback must be invoked directly, or if the frame is dropped because too
+/// many frames are pending, in which case |dropped| is set.
+EventRecord* NewFrameRecord(const CallbackSite& site,
+                            void* callback,
+                            void* user_data,
+                            bool& dropped) noexcept {
+  dropped = false;
+  if (!EventQueue::IsQueueing() || (site.type_ == mrsCallbackType::kUnknown)) {
+    return nullptr;
+  }
+  if (!ReserveFrame(site)) {
+    dropped = true;
+    return nullptr;
+  }
+  EventRecord* const record = NewRecord(site, callback, user_data);
+  if (!record) {
+    // Queueing stopped since the check above
+    ReleaseFrame(site);
+    return nullptr;
+  }
+  record->is_frame_ = true;
+  return record;
+}
+
+}  // namespace
+
+namespace Microsoft {
+namespace MixedReality {
+namespace WebRTC {
+
+std::atomic_bool EventQueue::queueing_{false};
+
+Result EventQueue::SetConfig(const mrsEventQueueConfig& config) noexcept {
+  uint32_t partition_count = 0;
+  switch (config.mode) {
+    case mrsEventDeliveryMode::kDirect:
+      break;
+    case mrsEventDeliveryMode::kPolled:
+      partition_count = 1;
+      break;
+    case mrsEventDeliveryMode::kDispatched:
+      partition_count = config.dispatch_thread_count;
+      if ((partition_count == 0) ||
+          (partition_count > kMaxDispatchThreadCount)) {
+        RTC_LOG(LS_ERROR) << "Invalid event dispatch thread count "
+                          << partition_count << ", must be in [1:"
+                          << kMaxDispatchThreadCount << "].";
+        return Result::kInvalidParameter;
+      }
+      break;
+    default:
+      RTC_LOG(LS_ERROR) << "Invalid event delivery mode "
+                        << static_cast<int>(config.mode);
+      return Result::kInvalidParameter;
+  }
+  if (config.max_pending_frames == 0) {
+    RTC_LOG(LS_ERROR) << "Invalid zero maximum number of pending frames.";
+    return Result::kInvalidParameter;
+  }
+  if (GlobalFactory::InstancePtrIfExist()) {
+    RTC_LOG(LS_ERROR) << "Cannot change the event queue configuration while "
+                         "the library is initialized.";
+    return Result::kInvalidOperation;
+  }
+
+  EventQueueState& state = GetState();
+  std::lock_guard<std::mutex> config_lock(state.config_mutex_);
+  std::lock_guard<std::mutex> poll_lock(state.poll_mutex_);
+  queueing_.store(false, std::memory_order_release);
+  state.ReleasePolled();
+  state.DestroyPartitions();
+  state.config_ = config;
+  state.max_pending_frames_.store(config.max_pending_frames,
+                                  std::memory_order_relaxed);
+  state.dropped_frames_.store(0, std::memory_order_relaxed);
+  for (uint32_t index = 0; index < partition_count; ++index) {
+    auto partition = std::make_unique<Partition>();
+    partition->index_ = index;
+    if (config.mode == mrsEventDeliveryMode::kDispatched) {
+      partition->thread_ = rtc::Thread::Create();
+      RTC_CHECK(partition->thread_.get());
+      partition->thread_->SetName(
+          "Event dispatch thread" +
+              (index > 0 ? " #" + std::to_string(index) : std::string()),
+          partition->thread_.get());
+      partition->thread_->Start();
+      ThreadMonitor::Instance().Register(partition->thread_.get());
+    }
+    state.partitions_.push_back(std::move(partition));
+  }
+  queueing_.store(partition_count > 0, std::memory_order_release);
+  return Result::kSuccess;
+}
+
+void EventQueue::GetConfig(mrsEventQueueConfig& config) noexcept {
+  EventQueueState& state = GetState();
+  std::lock_guard<std::mutex> lock(state.config_mutex_);
+  config = state.config_;
+}
+
+Result EventQueue::Poll(mrsEvent* events,
+                        uint32_t max_count,
+                        uint32_t& count) noexcept {
+  count = 0;
+  EventQueueState& state = GetState();
+  std::lock_guard<std::mutex> lock(state.poll_mutex_);
+  state.ReleasePolled();
+  if (!IsQueueing() || state.partitions_.front()->thread_) {
+    RTC_LOG(LS_ERROR) << "Cannot poll events when not in polled mode.";
+    return Result::kInvalidOperation;
+  }
+  Partition& partition = *state.partitions_.front();
+  while (count < max_count) {
+    EventRecord* const record = EventQueueState::Pop(partition);
+    if (!record) {
+      break;
+    }
+    events[count++] = record->event_;
+    state.polled_.push_back(record);
+  }
+  return Result::kSuccess;
+}
+
+Result EventQueue::Flush() noexcept {
+  // Drain each partition on its own thread, to keep a single consumer. If
+  // called from a dispatch thread, its own partition is drained inline.
+  for (auto&& partition : GetState().partitions_) {
+    if (rtc::Thread* const thread = partition->thread_.get()) {
+      Partition& drained = *partition;
+      thread->Invoke<void>(RTC_FROM_HERE,
+                           [&drained]() { EventQueueState::Drain(drained); });
+    }
+  }
+  return Result::kSuccess;
+}
+
+uint64_t EventQueue::GetDroppedFrameCount() noexcept {
+  return GetState().dropped_frames_.load(std::memory_order_relaxed);
+}
+
+bool EventQueue::Post(const CallbackSite& site,
+                      void* callback,
+                      void* user_data) noexcept {
+  EventRecord* const record = NewRecord(site, callback, user_data);
+  return (record && Push(record));
+}
+
+bool EventQueue::Post(const CallbackSite& site,
+                      void* callback,
+                      void* user_data,
+                      mrsSdpMessageType type,
+                      const char* sdp) noexcept {
+  EventRecord* const record = NewRecord(site, callback, user_data);
+  if (!record) {
+    return false;
+  }
+  record->event_.args[0] = static_cast<int64_t>(type);
+  record->event_.data = CopyString(sdp, record->text_);
+  return Push(record);
+}
+
+bool EventQueue::Post(const CallbackSite& site,
+                      void* callback,
+                      void* user_data,
+                      const mrsIceCandidate* candidate) noexcept {
+  EventRecord* const record = NewRecord(site, callback, user_data);
+  if (!record) {
+    return false;
+  }
+  record->candidate_.sdp_mid = CopyString(candidate->sdp_mid, record->text_);
+  record->candidate_.content =
+      CopyString(candidate->content, record->text2_);
+  record->candidate_.sdp_mline_index = candidate->sdp_mline_index;
+  record->event_.data = &record->candidate_;
+  return Push(record);
+}
+
+bool EventQueue::Post(const CallbackSite& site,
+                      void* callback,
+                      void* user_data,
+                      mrsIceConnectionState state) noexcept {
+  EventRecord* const record = NewRecord(site, callback, user_data);
+  if (!record) {
+    return false;
+  }
+  record->event_.args[0] = static_cast<int64_t>(state);
+  return Push(record);
+}
+
+bool EventQueue::Post(const CallbackSite& site,
+                      void* callback,
+                      void* user_data,
+                      mrsIceGatheringState state) noexcept {
+  EventRecord* const record = NewRecord(site, callback, user_data);
+  if (!record) {
+    return false;
+  }
+  record->event_.args[0] = static_cast<int64_t>(state);
+  return Push(record);
+}
+
+bool EventQueue::Post(const CallbackSite& site,
+                      void* callback,
+                      void* user_data,
+                      const mrsTransceiverAddedInfo* info) noexcept {
+  EventRecord* const record = NewRecord(site, callback, user_data);
+  if (!record) {
+    return false;
+  }
+  mrsTransceiverAddedInfo& copy = record->transceiver_info_;
+  copy = *info;
+  copy.transceiver_name = CopyString(info->transceiver_name, record->text_);
+  copy.encoded_stream_ids_ =
+      CopyString(info->encoded_stream_ids_, record->text2_);
+  record->refs_[0] = static_cast<TrackedObject*>(info->transceiver_handle);
+  record->event_.data = &copy;
+  return Push(record);
+}
+
+bool EventQueue::Post(const CallbackSite& site,
+                      void* callback,
+                      void* user_data,
+                      const mrsRemoteAudioTrackAddedInfo* info) noexcept {
+  EventRecord* const record = NewRecord(site, callback, user_data);
+  if (!record) {
+    return false;
+  }
+  mrsRemoteAudioTrackAddedInfo& copy = record->audio_track_info_;
+  copy = *info;
+  copy.track_name = CopyString(info->track_name, record->text_);
+  record->refs_[0] = static_cast<TrackedObject*>(info->track_handle);
+  record->refs_[1] =
+      static_cast<TrackedObject*>(info->audio_transceiver_handle);
+  record->event_.data = &copy;
+  return Push(record);
+}
+
+bool EventQueue::Post(const CallbackSite& site,
+                      void* callback,
+                      void* user_data,
+                      const mrsRemoteVideoTrackAddedInfo* info) noexcept {
+  EventRecord* const record = NewRecord(site, callback, user_data);
+  if (!record) {
+    return false;
+  }
+  mrsRemoteVideoTrackAddedInfo& copy = record->video_track_info_;
+  copy = *info;
+  copy.track_name = CopyString(info->track_name, record->text_);
+  record->refs_[0] = static_cast<TrackedObject*>(info->track_handle);
+  record->refs_[1] =
+      static_cast<TrackedObject*>(info->audio_transceiver_handle);
+  record->event_.data = &copy;
+  return Push(record);
+}
+
+bool EventQueue::Post(const CallbackSite& site,
+                      void* callback,
+                      void* user_data,
+                      const mrsDataChannelAddedInfo* info) noexcept {
+  EventRecord* const record = NewRecord(site, callback, user_data);
+  if (!record) {
+    return false;
+  }
+  mrsDataChannelAddedInfo& copy = record->data_channel_info_;
+  copy = *info;
+  copy.label = CopyString(info->label, record->text_);
+  record->event_.data = &copy;
+  return Push(record);
+}
+
+bool EventQueue::Post(const CallbackSite& site,
+                      void* callback,
+                      void* user_data,
+                      void* handle) noexcept {
+  EventRecord* const record = NewRecord(site, callback, user_data);
+  if (!record) {
+    return false;
+  }
+  // This is the data channel handle of a |kDataChannelRemoved| event, which is
+  // not reference-counted.
+  record->event_.handles[0] = handle;
+  return Push(record);
+}
+
+bool EventQueue::Post(const CallbackSite& site,
+                      void* callback,
+                      void* user_data,
+                      void* track,
+                      void* transceiver) noexcept {
+  EventRecord* const record = NewRecord(site, callback, user_data);
+  if (!record) {
+    return false;
+  }
+  record->event_.handles[0] = track;
+  record->event_.handles[1] = transceiver;
+  record->refs_[0] = static_cast<TrackedObject*>(track);
+  record->refs_[1] = static_cast<TrackedObject*>(transceiver);
+  return Push(record);
+}
+
+bool EventQueue::Post(const CallbackSite& site,
+                      void* callback,
+                      void* user_data,
+                      int mline_index) noexcept {
+  EventRecord* const record = NewRecord(site, callback, user_data);
+  if (!record) {
+    return false;
+  }
+  record->event_.args[0] = mline_index;
+  return Push(record);
+}
+
+bool EventQueue::Post(const CallbackSite& site,
+                      void* callback,
+                      void* user_data,
+                      mrsTransceiverStateUpdatedReason reason,
+                      mrsTransceiverOptDirection negotiated_direction,
+                      mrsTransceiverDirection desired_direction) noexcept {
+  EventRecord* const record = NewRecord(site, callback, user_data);
+  if (!record) {
+    return false;
+  }
+  record->event_.args[0] = static_cast<int64_t>(reason);
+  record->event_.args[1] = static_cast<int64_t>(negotiated_direction);
+  record->event_.args[2] = static_cast<int64_t>(desired_direction);
+  return Push(record);
+}
+
+bool EventQueue::Post(const CallbackSite& site,
+                      void* callback,
+                      void* user_data,
+                      const I420AVideoFrame& frame) noexcept {
+  bool dropped = false;
+  EventRecord* const record =
+      NewFrameRecord(site, callback, user_data, dropped);
+  if (!record) {
+    return dropped;
+  }
+  // Copy the planes into a single buffer, keeping their strides.
+  const size_t luma_height = frame.height_;
+  const size_t chroma_height = (frame.height_ + 1) / 2;
+  const size_t y_size = static_cast<size_t>(frame.ystride_) * luma_height;
+  const size_t u_size = static_cast<size_t>(frame.ustride_) * chroma_height;
+  const size_t v_size = static_cast<size_t>(frame.vstride_) * chroma_height;
+  const size_t a_size =
+      (frame.adata_ ? static_cast<size_t>(frame.astride_) * luma_height : 0);
+  record->frame_data_.resize(y_size + u_size + v_size + a_size);
+  uint8_t* dst = record->frame_data_.data();
+  I420AVideoFrame& copy = record->i420a_frame_;
+  copy = frame;
+  memcpy(dst, frame.ydata_, y_size);
+  copy.ydata_ = dst;
+  dst += y_size;
+  memcpy(dst, frame.udata_, u_size);
+  copy.udata_ = dst;
+  dst += u_size;
+  memcpy(dst, frame.vdata_, v_size);
+  copy.vdata_ = dst;
+  dst += v_size;
+  if (frame.adata_) {
+    memcpy(dst, frame.adata_, a_size);
+    copy.adata_ = dst;
+  }
+  record->event_.data = &copy;
+  return Push(record);
+}
+
+bool EventQueue::Post(const CallbackSite& site,
+                      void* callback,
+                      void* user_data,
+                      const Argb32VideoFrame& frame) noexcept {
+  bool dropped = false;
+  EventRecord* const record =
+      NewFrameRecord(site, callback, user_data, dropped);
+  if (!record) {
+    return dropped;
+  }
+  const size_t size = static_cast<size_t>(frame.stride_) * frame.height_;
+  record->frame_data_.assign(
+      static_cast<const uint8_t*>(frame.argb32_data_),
+      static_cast<const uint8_t*>(frame.argb32_data_) + size);
+  Argb32VideoFrame& copy = record->argb32_frame_;
+  copy = frame;
+  copy.argb32_data_ = record->frame_data_.data();
+  record->event_.data = &copy;
+  return Push(record);
+}
+
+bool EventQueue::Post(const CallbackSite& site,
+                      void* callback,
+                      void* user_data,
+                      const AudioFrame& frame) noexcept {
+  bool dropped = false;
+  EventRecord* const record =
+      NewFrameRecord(site, callback, user_data, dropped);
+  if (!record) {
+    return dropped;
+  }
+  const size_t size = static_cast<size_t>(frame.bits_per_sample_ / 8) *
+                      frame.channel_count_ * frame.sample_count_;
+  record->frame_data_.assign(static_cast<const uint8_t*>(frame.data_),
+                             static_cast<const uint8_t*>(frame.data_) + size);
+  AudioFrame& copy = record->audio_frame_;
+  copy = frame;
+  copy.data_ = record->frame_data_.data();
+  record->event_.data = &copy;
+  return Push(record);
+}
+
+}  // namespace WebRTC
+}  // namespace MixedReality
+}  // namespace Microsoft
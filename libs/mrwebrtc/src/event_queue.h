@@ -0,0 +1,145 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <atomic>
+
+#include "callback_watchdog.h"
+#include "event_queue_interop.h"
+#include "mrs_errors.h"
+#include "peer_connection_interop.h"
+
+namespace Microsoft {
+namespace MixedReality {
+namespace WebRTC {
+
+/// Process-wide queue of the events raised to user callbacks, used instead of
+/// invoking the callbacks directly when the delivery mode is not
+/// |mrsEventDeliveryMode::kDirect|.
+///
+/// Events are copied with their arguments into records pushed to lock-free
+/// multiple-producer single-consumer queues, so that raising an event never
+/// blocks the WebRTC thread on the consumer. In polled mode there is a single
+/// queue drained by the application; in dispatched mode there is one queue per
+/// dispatch thread, and events are assigned to a queue by the object raising
+/// them to preserve their order.
+///
+/// |Callback<>| calls one of the |Post()| overloads before any invocation; the
+/// overload is selected by the callback arguments, and the event type by the
+/// callback site.
+class EventQueue {
+ public:
+  /// Set the configuration. See |mrsEventQueueSetConfig()|.
+  static Result SetConfig(const mrsEventQueueConfig& config) noexcept;
+
+  /// Get the current configuration.
+  static void GetConfig(mrsEventQueueConfig& config) noexcept;
+
+  /// Drain pending events in polled mode. See |mrsPollEvents()|.
+  static Result Poll(mrsEvent* events,
+                     uint32_t max_count,
+                     uint32_t& count) noexcept;
+
+  /// Dispatch all events queued so far. See |mrsEventQueueFlush()|.
+  static Result Flush() noexcept;
+
+  /// Get the number of frame events dropped since the configuration was set.
+  static uint64_t GetDroppedFrameCount() noexcept;
+
+  /// Check if events are queued instead of being delivered directly.
+  static bool IsQueueing() noexcept {
+    return queueing_.load(std::memory_order_relaxed);
+  }
+
+  //
+  // Event posting, one overload per callback signature. Each returns true if
+  // the event was queued, or dropped because too many frames are pending, and
+  // false if the callback must be invoked directly.
+  //
+
+  static bool Post(const CallbackSite& site,
+                   void* callback,
+                   void* user_data) noexcept;
+  static bool Post(const CallbackSite& site,
+                   void* callback,
+                   void* user_data,
+                   mrsSdpMessageType type,
+                   const char* sdp) noexcept;
+  static bool Post(const CallbackSite& site,
+                   void* callback,
+                   void* user_data,
+                   const mrsIceCandidate* candidate) noexcept;
+  static bool Post(const CallbackSite& site,
+                   void* callback,
+                   void* user_data,
+                   mrsIceConnectionState state) noexcept;
+  static bool Post(const CallbackSite& site,
+                   void* callback,
+                   void* user_data,
+                   mrsIceGatheringState state) noexcept;
+  static bool Post(const CallbackSite& site,
+                   void* callback,
+                   void* user_data,
+                   const mrsTransceiverAddedInfo* info) noexcept;
+  static bool Post(const CallbackSite& site,
+                   void* callback,
+                   void* user_data,
+                   const mrsRemoteAudioTrackAddedInfo* info) noexcept;
+  static bool Post(const CallbackSite& site,
+                   void* callback,
+                   void* user_data,
+                   const mrsRemoteVideoTrackAddedInfo* info) noexcept;
+  static bool Post(const CallbackSite& site,
+                   void* callback,
+                   void* user_data,
+                   const mrsDataChannelAddedInfo* info) noexcept;
+  static bool Post(const CallbackSite& site,
+                   void* callback,
+                   void* user_data,
+                   void* handle) noexcept;
+  static bool Post(const CallbackSite& site,
+                   void* callback,
+                   void* user_data,
+                   void* track,
+                   void* transceiver) noexcept;
+  static bool Post(const CallbackSite& site,
+                   void* callback,
+                   void* user_data,
+                   int mline_index) noexcept;
+  static bool Post(const CallbackSite& site,
+                   void* callback,
+                   void* user_data,
+                   mrsTransceiverStateUpdatedReason reason,
+                   mrsTransceiverOptDirection negotiated_direction,
+                   mrsTransceiverDirection desired_direction) noexcept;
+  static bool Post(const CallbackSite& site,
+                   void* callback,
+                   void* user_data,
+                   const I420AVideoFrame& frame) noexcept;
+  static bool Post(const CallbackSite& site,
+                   void* callback,
+                   void* user_data,
+                   const Argb32VideoFrame& frame) noexcept;
+  static bool Post(const CallbackSite& site,
+                   void* callback,
+                   void* user_data,
+                   const AudioFrame& frame) noexcept;
+
+  /// Fallback for the callbacks which are always invoked directly, like the
+  /// callbacks of a data channel.
+  template <typename... Args>
+  static bool Post(const CallbackSite& /*site*/,
+                   void* /*callback*/,
+                   void* /*user_data*/,
+                   const Args&... /*args*/) noexcept {
+    return false;
+  }
+
+ private:
+  static std::atomic_bool queueing_;
+};
+
+}  // namespace WebRTC
+}  // namespace MixedReality
+}  // namespace Microsoft
@@ -0,0 +1,45 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+// This is a precompiled header, it must be on its own, followed by a blank
+// line, to prevent clang-format from reordering it with other headers.
+#include "pch.h"
+
+#include "alloc_tracker.h"
+#include "alloc_tracking_interop.h"
+
+using namespace Microsoft::MixedReality::WebRTC;
+
+mrsResult MRS_CALL mrsAllocTrackingStart() noexcept {
+  return AllocTracker::Start();
+}
+
+mrsResult MRS_CALL mrsAllocTrackingStop() noexcept {
+  return AllocTracker::Stop();
+}
+
+mrsResult MRS_CALL mrsAllocTrackingGetScopeStats(mrsAllocScopeStats* stats,
+                                                 uint32_t* count) noexcept {
+  if (!count) {
+    RTC_LOG(LS_ERROR) << "Invalid NULL scope stats count reference.";
+    return Result::kInvalidParameter;
+  }
+  if (!stats && (*count > 0)) {
+    RTC_LOG(LS_ERROR) << "Invalid NULL scope stats array.";
+    return Result::kInvalidParameter;
+  }
+  return AllocTracker::GetScopeStats(stats, *count);
+}
+
+mrsResult MRS_CALL mrsAllocTrackingGetThreadStats(mrsAllocThreadStats* stats,
+                                                  uint32_t* count) noexcept {
+  if (!count) {
+    RTC_LOG(LS_ERROR) << "Invalid NULL thread stats count reference.";
+    return Result::kInvalidParameter;
+  }
+  if (!stats && (*count > 0)) {
+    RTC_LOG(LS_ERROR) << "Invalid NULL thread stats array.";
+    return Result::kInvalidParameter;
+  }
+  return AllocTracker::GetThreadStats(stats, *count);
+}
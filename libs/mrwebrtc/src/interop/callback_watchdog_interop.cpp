@@ -0,0 +1,47 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+// This is a precompiled header, it must be on its own, followed by a blank
+// line, to prevent clang-format from reordering it with other headers.
+#include "pch.h"
+
+#include "callback_watchdog.h"
+#include "callback_watchdog_interop.h"
+
+using namespace Microsoft::MixedReality::WebRTC;
+
+mrsResult MRS_CALL
+mrsCallbackWatchdogStart(const mrsCallbackWatchdogConfig* config) noexcept {
+  if (!config) {
+    RTC_LOG(LS_ERROR) << "Invalid NULL callback watchdog configuration.";
+    return Result::kInvalidParameter;
+  }
+  if ((config->budget_us < 0) || (config->warning_interval_ms < 0)) {
+    RTC_LOG(LS_ERROR) << "Invalid negative callback watchdog budget or "
+                         "warning interval.";
+    return Result::kInvalidParameter;
+  }
+  return CallbackWatchdog::Start(*config);
+}
+
+mrsResult MRS_CALL mrsCallbackWatchdogStop() noexcept {
+  return CallbackWatchdog::Stop();
+}
+
+void MRS_CALL
+mrsCallbackWatchdogRegisterWarningCallback(mrsCallbackWarningCallback callback,
+                                           void* user_data) noexcept {
+  CallbackWatchdog::SetWarningCallback(callback, user_data);
+}
+
+mrsResult MRS_CALL
+mrsCallbackWatchdogGetHistogram(mrsCallbackType type,
+                                mrsBool reset,
+                                mrsCallbackHistogram* histogram) noexcept {
+  if (!histogram) {
+    RTC_LOG(LS_ERROR) << "Invalid NULL callback histogram reference.";
+    return Result::kInvalidParameter;
+  }
+  return CallbackWatchdog::GetHistogram(type, (reset != mrsBool::kFalse),
+                                        *histogram);
+}
@@ -0,0 +1,56 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+// This is a precompiled header, it must be on its own, followed by a blank
+// line, to prevent clang-format from reordering it with other headers.
+#include "pch.h"
+
+#include "cpu_budget_interop.h"
+#include "cpu_budget_manager.h"
+#include "peer_connection.h"
+
+using namespace Microsoft::MixedReality::WebRTC;
+
+mrsResult MRS_CALL
+mrsCpuBudgetStart(const mrsCpuBudgetConfig* config) noexcept {
+  if (!config) {
+    RTC_LOG(LS_ERROR) << "Invalid NULL CPU budget configuration.";
+    return Result::kInvalidParameter;
+  }
+  return CpuBudgetManager::Instance().Start(*config);
+}
+
+mrsResult MRS_CALL mrsCpuBudgetStop() noexcept {
+  return CpuBudgetManager::Instance().Stop();
+}
+
+mrsResult MRS_CALL mrsCpuBudgetGetStatus(mrsCpuBudgetStatus* status) noexcept {
+  if (!status) {
+    RTC_LOG(LS_ERROR) << "Invalid NULL CPU budget status reference.";
+    return Result::kInvalidParameter;
+  }
+  CpuBudgetManager::Instance().GetStatus(*status);
+  return Result::kSuccess;
+}
+
+mrsResult MRS_CALL
+mrsPeerConnectionSetCpuBudgetWeight(mrsPeerConnectionHandle peer_handle,
+                                    float weight) noexcept {
+  if (auto peer = static_cast<PeerConnection*>(peer_handle)) {
+    return CpuBudgetManager::Instance().SetWeight(peer, weight);
+  }
+  return Result::kInvalidNativeHandle;
+}
+
+mrsResult MRS_CALL mrsPeerConnectionGetCpuBudgetAllocation(
+    mrsPeerConnectionHandle peer_handle,
+    mrsCpuBudgetAllocation* allocation) noexcept {
+  if (!allocation) {
+    RTC_LOG(LS_ERROR) << "Invalid NULL CPU budget allocation reference.";
+    return Result::kInvalidParameter;
+  }
+  if (auto peer = static_cast<PeerConnection*>(peer_handle)) {
+    return CpuBudgetManager::Instance().GetAllocation(peer, *allocation);
+  }
+  return Result::kInvalidNativeHandle;
+}
@@ -51,3 +51,17 @@ mrsDataChannelSendMessage(mrsDataChannelHandle dataChannelHandle,
   return (data_channel->Send(data, (size_t)size) ? Result::kSuccess
                                                  : Result::kUnknownError);
 }
+
+mrsResult MRS_CALL
+mrsDataChannelGetMetrics(mrsDataChannelHandle data_channel_handle,
+                         mrsObjectMetrics* metrics) noexcept {
+  auto data_channel = static_cast<DataChannel*>(data_channel_handle);
+  if (!data_channel) {
+    return Result::kInvalidNativeHandle;
+  }
+  if (!metrics) {
+    return Result::kInvalidParameter;
+  }
+  data_channel->GetMetrics().CopyTo(*metrics);
+  return Result::kSuccess;
+}
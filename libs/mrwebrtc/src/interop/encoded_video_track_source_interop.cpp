@@ -0,0 +1,53 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+// This is a precompiled header, it must be on its own, followed by a blank
+// line, to prevent clang-format from reordering it with other headers.
+#include "pch.h"
+
+#include "encoded_video_track_source_interop.h"
+#include "interop/global_factory.h"
+#include "media/encoded_video_track_source.h"
+
+using namespace Microsoft::MixedReality::WebRTC;
+
+mrsResult MRS_CALL mrsEncodedVideoTrackSourceCreate(
+    mrsKeyFrameRequestedCallback callback,
+    void* user_data,
+    mrsEncodedVideoTrackSourceHandle* source_handle_out) noexcept {
+  if (!source_handle_out) {
+    RTC_LOG(LS_ERROR) << "Invalid NULL encoded video track source handle "
+                         "reference.";
+    return Result::kInvalidParameter;
+  }
+  *source_handle_out = nullptr;
+#if defined(WINUWP)
+  (void)callback;
+  (void)user_data;
+  RTC_LOG(LS_ERROR) << "Encoded video track sources are not supported on UWP.";
+  return Result::kUnsupported;
+#else   // defined(WINUWP)
+  RefPtr<EncodedVideoTrackSource> source = EncodedVideoTrackSource::create(
+      GlobalFactory::InstancePtr(),
+      KeyFrameRequestedCallback{callback, user_data});
+  if (!source) {
+    return Result::kUnknownError;
+  }
+  *source_handle_out = source.release();
+  return Result::kSuccess;
+#endif  // defined(WINUWP)
+}
+
+mrsResult MRS_CALL
+mrsEncodedVideoTrackSourcePushFrame(mrsEncodedVideoTrackSourceHandle handle,
+                                    const mrsEncodedVideoFrame* frame,
+                                    int64_t timestamp_ms) noexcept {
+  if (!frame) {
+    RTC_LOG(LS_ERROR) << "Invalid NULL encoded video frame reference.";
+    return Result::kInvalidParameter;
+  }
+  if (auto source = static_cast<EncodedVideoTrackSource*>(handle)) {
+    return source->PushFrame(*frame, timestamp_ms);
+  }
+  return Result::kInvalidNativeHandle;
+}
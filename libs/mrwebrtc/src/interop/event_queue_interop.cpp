@@ -0,0 +1,52 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+// This is a precompiled header, it must be on its own, followed by a blank
+// line, to prevent clang-format from reordering it with other headers.
+#include "pch.h"
+
+#include "event_queue.h"
+#include "event_queue_interop.h"
+
+using namespace Microsoft::MixedReality::WebRTC;
+
+mrsResult MRS_CALL
+mrsEventQueueSetConfig(const mrsEventQueueConfig* config) noexcept {
+  if (!config) {
+    RTC_LOG(LS_ERROR) << "Invalid NULL event queue configuration.";
+    return Result::kInvalidParameter;
+  }
+  return EventQueue::SetConfig(*config);
+}
+
+mrsResult MRS_CALL
+mrsEventQueueGetConfig(mrsEventQueueConfig* config) noexcept {
+  if (!config) {
+    RTC_LOG(LS_ERROR) << "Invalid NULL event queue configuration.";
+    return Result::kInvalidParameter;
+  }
+  EventQueue::GetConfig(*config);
+  return Result::kSuccess;
+}
+
+mrsResult MRS_CALL mrsPollEvents(mrsEvent* events,
+                                 uint32_t max_count,
+                                 uint32_t* count) noexcept {
+  if (!count) {
+    RTC_LOG(LS_ERROR) << "Invalid NULL event count reference.";
+    return Result::kInvalidParameter;
+  }
+  if (!events && (max_count > 0)) {
+    RTC_LOG(LS_ERROR) << "Invalid NULL event array.";
+    return Result::kInvalidParameter;
+  }
+  return EventQueue::Poll(events, max_count, *count);
+}
+
+mrsResult MRS_CALL mrsEventQueueFlush() noexcept {
+  return EventQueue::Flush();
+}
+
+uint64_t MRS_CALL mrsEventQueueGetDroppedFrameCount() noexcept {
+  return EventQueue::GetDroppedFrameCount();
+}
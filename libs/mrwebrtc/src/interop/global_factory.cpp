@@ -5,13 +5,42 @@
 // line, to prevent clang-format from reordering it with other headers.
 #include "pch.h"
 
+#include "cpu_budget_manager.h"
 #include "interop/global_factory.h"
+#include "media/forwarding_codec_factory.h"
 #include "media/local_video_track.h"
+#include "media/shared_video_encoder.h"
+#include "memory_account.h"
 #include "peer_connection.h"
+#include "rtc_base/event.h"
+#include "rtc_base/platform_thread_types.h"
 #include "rtc_base/refcountedobject.h"
+#include "rtc_base/timeutils.h"
+#include "thread_config.h"
+#include "thread_monitor.h"
 #include "utils.h"
 
 #include <exception>
+#include <system_error>
+
+namespace {
+
+/// Maximum number of factory shards, each running 3 threads.
+constexpr uint32_t kMaxShardCount = 64;
+
+/// Message handler signaling an event, posted to a thread to wait for the
+/// messages posted to it before.
+class DrainMessageHandler : public rtc::MessageHandler {
+ public:
+  void OnMessage(rtc::Message* /*message*/) override { drained_.Set(); }
+  void Wait() { drained_.Wait(rtc::Event::kForever); }
+
+ private:
+  rtc::Event drained_{/* manual_reset = */ true,
+                      /* initially_signaled = */ false};
+};
+
+}  // namespace
 
 namespace Microsoft {
 namespace MixedReality {
@@ -42,8 +71,87 @@ void GlobalFactory::SetShutdownOptions(mrsShutdownOptions options) noexcept {
   factory->shutdown_options_ = options;
 }
 
+uint32_t GlobalFactory::GetShardCount() noexcept {
+  GlobalFactory* const factory = GetInstance();
+  std::lock_guard<std::mutex> lock(factory->init_mutex_);
+  return factory->shard_count_;
+}
+
+Result GlobalFactory::SetShardCount(uint32_t count) noexcept {
+  if ((count == 0) || (count > kMaxShardCount)) {
+    RTC_LOG(LS_ERROR) << "Invalid factory shard count " << count
+                      << ", must be in [1:" << kMaxShardCount << "].";
+    return Result::kInvalidParameter;
+  }
+#if defined(WINUWP)
+  // The UWP factory creates its own threads, so cannot be sharded.
+  if (count > 1) {
+    return Result::kUnsupported;
+  }
+#endif  // defined(WINUWP)
+  GlobalFactory* const factory = GetInstance();
+  std::lock_guard<std::mutex> lock(factory->init_mutex_);
+  if (factory->peer_factory_ && (count != factory->shard_count_)) {
+    RTC_LOG(LS_ERROR) << "Cannot change the factory shard count while the "
+                         "library is initialized.";
+    return Result::kInvalidOperation;
+  }
+  factory->shard_count_ = count;
+  return Result::kSuccess;
+}
+
+Result GlobalFactory::InitializeAsync(Callback<mrsResult> callback) noexcept {
+  GlobalFactory* const factory = GetInstance();
+  std::unique_lock<std::mutex> lock(factory->init_thread_mutex_);
+  // Wait for any previous initializing to complete, without holding the lock
+  // in case its callback starts another one.
+  while (factory->init_thread_.joinable()) {
+    if (factory->init_thread_.get_id() == std::this_thread::get_id()) {
+      RTC_LOG(LS_ERROR) << "Cannot initialize the library asynchronously from "
+                           "the callback of a previous initializing.";
+      return Result::kInvalidOperation;
+    }
+    std::thread previous = std::move(factory->init_thread_);
+    lock.unlock();
+    previous.join();
+    lock.lock();
+  }
+  try {
+    factory->init_thread_ = std::thread([callback]() {
+      rtc::SetCurrentThreadName("MR-WebRTC init thread");
+      mrsResult result = Result::kUnknownError;
+      {
+        RefPtr<GlobalFactory> factory = InstancePtr();
+        if (factory) {
+          factory->HoldUntilFirstObject();
+          result = Result::kSuccess;
+        }
+      }
+      callback(result);
+    });
+  } catch (const std::system_error& e) {
+    RTC_LOG(LS_ERROR) << "Failed to start the library initializing thread: "
+                      << e.what();
+    return Result::kUnknownError;
+  }
+  return Result::kSuccess;
+}
+
+Result GlobalFactory::GetInitStats(mrsLibraryInitStats& stats) noexcept {
+  GlobalFactory* const factory = GetInstance();
+  std::lock_guard<std::mutex> lock(factory->init_mutex_);
+  if (!factory->has_init_stats_) {
+    return Result::kNotFound;
+  }
+  stats = factory->init_stats_;
+  return Result::kSuccess;
+}
+
 void GlobalFactory::ForceShutdown() noexcept {
   GlobalFactory* const factory = GetInstance();
+  // Let a background initializing complete first, so that it does not resume
+  // on a shut down library.
+  factory->JoinInitThread();
   std::lock_guard<std::mutex> lock(factory->init_mutex_);
   if (!factory->peer_factory_) {
     return;
@@ -107,62 +215,146 @@ RefPtr<GlobalFactory> GlobalFactory::GetInstancePtrImpl(
 }
 
 GlobalFactory::~GlobalFactory() {
+  JoinInitThread();
   std::lock_guard<std::mutex> lock(init_mutex_);
   ShutdownImplNoLock(ShutdownAction::kFromObjectDestructor);
 }
 
+void GlobalFactory::JoinInitThread() noexcept {
+  std::thread thread;
+  {
+    std::lock_guard<std::mutex> lock(init_thread_mutex_);
+    if (init_thread_.joinable() &&
+        (init_thread_.get_id() != std::this_thread::get_id())) {
+      thread = std::move(init_thread_);
+    }
+  }
+  if (thread.joinable()) {
+    thread.join();
+  }
+}
+
+void GlobalFactory::HoldUntilFirstObject() noexcept {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  if (hold_until_first_object_) {
+    return;
+  }
+  // Publish the request before checking for live objects; |AddObject()| does
+  // the converse, so that either this sees an object added concurrently, or
+  // |AddObject()| sees the request and waits on the lock to release the hold.
+  hold_requested_.store(true);
+  if (live_objects_.Count() > 0) {
+    hold_requested_.store(false);
+    return;
+  }
+  // The caller holds a reference, so the library is initialized.
+  AddRef();
+  hold_until_first_object_ = true;
+}
+
+uint32_t GlobalFactory::SelectShard(int32_t hint) noexcept {
+  // This only requires init_mutex_ read lock, which must be acquired to access
+  // the singleton instance.
+#if defined(WINUWP)
+  (void)hint;
+  return 0;
+#else   // defined(WINUWP)
+  const uint32_t count = static_cast<uint32_t>(shards_.size());
+  if (count <= 1) {
+    return 0;
+  }
+  if (hint >= 0) {
+    return static_cast<uint32_t>(hint) % count;
+  }
+  return next_shard_.fetch_add(1, std::memory_order_relaxed) % count;
+#endif  // defined(WINUWP)
+}
+
 rtc::scoped_refptr<webrtc::PeerConnectionFactoryInterface>
-GlobalFactory::GetPeerConnectionFactory() noexcept {
+GlobalFactory::GetPeerConnectionFactory(uint32_t shard) noexcept {
   // This only requires init_mutex_ read lock, which must be acquired to access
   // the singleton instance.
+#if defined(WINUWP)
+  RTC_DCHECK_EQ(0u, shard);
   return peer_factory_;
+#else   // defined(WINUWP)
+  return (shard < shards_.size() ? shards_[shard]->peer_factory_ : nullptr);
+#endif  // defined(WINUWP)
 }
 
-rtc::Thread* GlobalFactory::GetWorkerThread() const noexcept {
+rtc::Thread* GlobalFactory::GetWorkerThread(uint32_t shard) const noexcept {
   // This only requires init_mutex_ read lock, which must be acquired to access
   // the singleton instance.
 #if defined(WINUWP)
+  RTC_DCHECK_EQ(0u, shard);
   return impl_ ? impl_->workerThread.get() : nullptr;
 #else   // defined(WINUWP)
-  return worker_thread_.get();
+  return (shard < shards_.size() ? shards_[shard]->worker_thread_.get()
+                                 : nullptr);
 #endif  // defined(WINUWP)
 }
 
-rtc::Thread* GlobalFactory::GetSignalingThread() const noexcept {
+rtc::Thread* GlobalFactory::GetSignalingThread(uint32_t shard) const noexcept {
   // This only requires init_mutex_ read lock, which must be acquired to access
   // the singleton instance.
 #if defined(WINUWP)
+  RTC_DCHECK_EQ(0u, shard);
   return impl_ ? impl_->signalingThread.get() : nullptr;
 #else   // defined(WINUWP)
-  return signaling_thread_.get();
+  return (shard < shards_.size() ? shards_[shard]->signaling_thread_.get()
+                                 : nullptr);
+#endif  // defined(WINUWP)
+}
+
+ForwardingVideoDecoderFactory* GlobalFactory::GetVideoDecoderFactory(
+    uint32_t shard) const noexcept {
+  // This only requires init_mutex_ read lock, like |GetSignalingThread()|.
+#if defined(WINUWP)
+  (void)shard;
+  return nullptr;
+#else   // defined(WINUWP)
+  return (shard < shards_.size() ? shards_[shard]->video_decoder_factory_
+                                 : nullptr);
+#endif  // defined(WINUWP)
+}
+
+rtc::scoped_refptr<ToggleAudioMixer> GlobalFactory::audio_mixer(
+    uint32_t shard) const {
+#if defined(WINUWP)
+  (void)shard;
+  return nullptr;
+#else   // defined(WINUWP)
+  return (shard < shards_.size() ? shards_[shard]->audio_mixer_ : nullptr);
 #endif  // defined(WINUWP)
 }
 
 void GlobalFactory::AddObject(TrackedObject* obj) noexcept {
+  live_objects_.Add(obj);
+  if (!hold_requested_.load()) {
+    return;
+  }
+  bool release_hold = false;
   try {
     std::lock_guard<std::recursive_mutex> lock(mutex_);
-    RTC_DCHECK(std::find(alive_objects_.begin(), alive_objects_.end(), obj) ==
-               alive_objects_.end());
-    alive_objects_.push_back(obj);
+    release_hold = hold_until_first_object_;
+    hold_until_first_object_ = false;
+    hold_requested_.store(false);
   } catch (...) {
   }
+  if (release_hold) {
+    // The object holds its own reference, so this never shuts down the
+    // library. This acquires |init_mutex_|, so is done without |mutex_|.
+    RemoveRef();
+  }
 }
 
 void GlobalFactory::RemoveObject(TrackedObject* obj) noexcept {
-  try {
-    std::lock_guard<std::recursive_mutex> lock(mutex_);
-    auto it = std::find(alive_objects_.begin(), alive_objects_.end(), obj);
-    if (it != alive_objects_.end()) {
-      alive_objects_.erase(it);
-    }
-  } catch (...) {
-  }
+  live_objects_.Remove(obj);
 }
 
 uint32_t GlobalFactory::ReportLiveObjects() {
-  std::lock_guard<std::recursive_mutex> lock(mutex_);
   ReportLiveObjectsNoLock();
-  return static_cast<uint32_t>(alive_objects_.size());
+  return live_objects_.Count();
 }
 
 #if defined(WINUWP)
@@ -193,12 +385,116 @@ mrsResult GlobalFactory::GetOrCreateWebRtcFactory(WebRtcFactoryPtr& factory) {
   return (factory ? Result::kSuccess : Result::kUnknownError);
 }
 
+#else  // defined(WINUWP)
+
+std::unique_ptr<GlobalFactory::FactoryShard> GlobalFactory::CreateShard(
+    uint32_t index,
+    mrsLibraryInitStats& stats) {
+  const int64_t threads_start_us = rtc::TimeMicros();
+  auto shard = std::make_unique<FactoryShard>();
+  // Keep the historical thread names for the first shard.
+  const std::string suffix =
+      (index > 0 ? " #" + std::to_string(index) : std::string());
+  shard->audio_mixer_ = new rtc::RefCountedObject<ToggleAudioMixer>();
+  shard->network_thread_ = rtc::Thread::CreateWithSocketServer();
+  RTC_CHECK(shard->network_thread_.get());
+  shard->network_thread_->SetName("WebRTC network thread" + suffix,
+                                  shard->network_thread_.get());
+  shard->network_thread_->Start();
+  ThreadConfig::Apply(mrsThreadRole::kNetwork, shard->network_thread_.get());
+  shard->worker_thread_ = rtc::Thread::Create();
+  RTC_CHECK(shard->worker_thread_.get());
+  shard->worker_thread_->SetName("WebRTC worker thread" + suffix,
+                                 shard->worker_thread_.get());
+  shard->worker_thread_->Start();
+  ThreadConfig::Apply(mrsThreadRole::kWorker, shard->worker_thread_.get());
+  shard->signaling_thread_ = rtc::Thread::Create();
+  RTC_CHECK(shard->signaling_thread_.get());
+  shard->signaling_thread_->SetName("WebRTC signaling thread" + suffix,
+                                    shard->signaling_thread_.get());
+  shard->signaling_thread_->Start();
+  ThreadConfig::Apply(mrsThreadRole::kSignaling,
+                      shard->signaling_thread_.get());
+  ThreadMonitor& monitor = ThreadMonitor::Instance();
+  monitor.Register(shard->network_thread_.get());
+  monitor.Register(shard->worker_thread_.get());
+  monitor.Register(shard->signaling_thread_.get());
+
+  const int64_t codecs_start_us = rtc::TimeMicros();
+  stats.threads_us += codecs_start_us - threads_start_us;
+  rtc::scoped_refptr<webrtc::AudioEncoderFactory> audio_encoder_factory =
+      webrtc::CreateBuiltinAudioEncoderFactory();
+  rtc::scoped_refptr<webrtc::AudioDecoderFactory> audio_decoder_factory =
+      webrtc::CreateBuiltinAudioDecoderFactory();
+  // Encoders are shared among senders only when enabled, see
+  // |mrsSetSharedVideoEncoding()|. The forwarding wrappers only act on the
+  // frames of forwarded video track sources, see
+  // |mrsForwardedVideoTrackSourceCreate()|.
+  std::unique_ptr<webrtc::VideoEncoderFactory> video_encoder_factory(
+      new ForwardingVideoEncoderFactory(
+          absl::make_unique<SharedVideoEncoderFactory>(
+              absl::make_unique<webrtc::MultiplexEncoderFactory>(
+                  absl::make_unique<webrtc::InternalEncoderFactory>()))));
+  auto forwarding_decoder_factory = new ForwardingVideoDecoderFactory(
+      absl::make_unique<webrtc::MultiplexDecoderFactory>(
+          absl::make_unique<webrtc::InternalDecoderFactory>()));
+  shard->video_decoder_factory_ = forwarding_decoder_factory;
+  std::unique_ptr<webrtc::VideoDecoderFactory> video_decoder_factory(
+      forwarding_decoder_factory);
+
+  const int64_t factory_start_us = rtc::TimeMicros();
+  stats.codec_factories_us += factory_start_us - codecs_start_us;
+  shard->peer_factory_ = webrtc::CreatePeerConnectionFactory(
+      shard->network_thread_.get(), shard->worker_thread_.get(),
+      shard->signaling_thread_.get(), nullptr,
+      std::move(audio_encoder_factory), std::move(audio_decoder_factory),
+      std::move(video_encoder_factory), std::move(video_decoder_factory),
+      shard->audio_mixer_, nullptr);
+  stats.peer_connection_factory_us += rtc::TimeMicros() - factory_start_us;
+  return shard;
+}
+
+void GlobalFactory::DestroyShards(
+    std::vector<std::unique_ptr<FactoryShard>>& shards) {
+  // Release the factories first, which dispatches their destruction to the
+  // signaling threads, before stopping the threads.
+  ThreadMonitor& monitor = ThreadMonitor::Instance();
+  for (auto&& shard : shards) {
+    shard->peer_factory_ = nullptr;
+    shard->audio_mixer_ = nullptr;
+    monitor.Unregister(shard->network_thread_.get());
+    monitor.Unregister(shard->worker_thread_.get());
+    monitor.Unregister(shard->signaling_thread_.get());
+    CpuBudgetManager::Instance().UnregisterThread(
+        shard->signaling_thread_.get());
+  }
+  // Run the tasks already posted to the signaling threads, like the bulk close
+  // operations which invoke a callback once completed, since quitting a thread
+  // discards its pending messages. The shards are drained concurrently.
+  std::vector<DrainMessageHandler> drains(shards.size());
+  for (size_t i = 0; i < shards.size(); ++i) {
+    shards[i]->signaling_thread_->Post(RTC_FROM_HERE, &drains[i]);
+  }
+  for (DrainMessageHandler& drain : drains) {
+    drain.Wait();
+  }
+  // Stop all threads concurrently. Destroying a thread then only joins it.
+  for (auto&& shard : shards) {
+    shard->network_thread_->Quit();
+    shard->worker_thread_->Quit();
+    shard->signaling_thread_->Quit();
+  }
+  shards.clear();
+}
+
 #endif  // defined(WINUWP)
 
 mrsResult GlobalFactory::InitializeImplNoLock() {
   if (peer_factory_) {
     return Result::kSuccess;
   }
+  const int64_t start_us = rtc::TimeMicros();
+  mrsLibraryInitStats stats{};
 
 #if defined(WINUWP)
   RTC_CHECK(!impl_);
@@ -238,36 +534,33 @@ mrsResult GlobalFactory::InitializeImplNoLock() {
 
   // Cache the peer connection factory
   peer_factory_ = impl_->peerConnectionFactory();
+  stats.shard_count = 1;
 #else  // defined(WINUWP)
-  custom_audio_mixer_ = new rtc::RefCountedObject<ToggleAudioMixer>();
-  network_thread_ = rtc::Thread::CreateWithSocketServer();
-  RTC_CHECK(network_thread_.get());
-  network_thread_->SetName("WebRTC network thread", network_thread_.get());
-  network_thread_->Start();
-  worker_thread_ = rtc::Thread::Create();
-  RTC_CHECK(worker_thread_.get());
-  worker_thread_->SetName("WebRTC worker thread", worker_thread_.get());
-  worker_thread_->Start();
-  signaling_thread_ = rtc::Thread::Create();
-  RTC_CHECK(signaling_thread_.get());
-  signaling_thread_->SetName("WebRTC signaling thread",
-                             signaling_thread_.get());
-  signaling_thread_->Start();
-
-  peer_factory_ = webrtc::CreatePeerConnectionFactory(
-      network_thread_.get(), worker_thread_.get(), signaling_thread_.get(),
-      nullptr, webrtc::CreateBuiltinAudioEncoderFactory(),
-      webrtc::CreateBuiltinAudioDecoderFactory(),
-      std::unique_ptr<webrtc::VideoEncoderFactory>(
-          new webrtc::MultiplexEncoderFactory(
-              absl::make_unique<webrtc::InternalEncoderFactory>())),
-      std::unique_ptr<webrtc::VideoDecoderFactory>(
-          new webrtc::MultiplexDecoderFactory(
-              absl::make_unique<webrtc::InternalDecoderFactory>())),
-      custom_audio_mixer_, nullptr);
+  // Each shard has its own threads, and its own factory with its own audio
+  // device module, since factories cannot share threads.
+  RTC_DCHECK(shards_.empty());
+  shards_.reserve(shard_count_);
+  for (uint32_t index = 0; index < shard_count_; ++index) {
+    std::unique_ptr<FactoryShard> shard = CreateShard(index, stats);
+    if (!shard->peer_factory_) {
+      shards_.push_back(std::move(shard));
+      DestroyShards(shards_);
+      return Result::kUnknownError;
+    }
+    shards_.push_back(std::move(shard));
+  }
+  next_shard_.store(0, std::memory_order_relaxed);
+  peer_factory_ = shards_[0]->peer_factory_;
+  stats.shard_count = shard_count_;
 #endif  // defined(WINUWP)
-  return (peer_factory_.get() != nullptr ? Result::kSuccess
-                                         : Result::kUnknownError);
+  if (!peer_factory_) {
+    return Result::kUnknownError;
+  }
+  // The UWP factory initializes as a whole, so only its total is reported.
+  stats.total_us = rtc::TimeMicros() - start_us;
+  init_stats_ = stats;
+  has_init_stats_ = true;
+  return Result::kSuccess;
 }
 
 bool GlobalFactory::ShutdownImplNoLock(ShutdownAction shutdown_action) {
@@ -275,7 +568,16 @@ bool GlobalFactory::ShutdownImplNoLock(ShutdownAction shutdown_action) {
     return true;  // already shut down
   }
 
-  custom_audio_mixer_ = nullptr;
+  // Release the reference held after initializing asynchronously, which is
+  // not owned by any object so is not a leak.
+  if (shutdown_action != ShutdownAction::kTryShutdownIfSafe) {
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+    hold_requested_.store(false);
+    if (hold_until_first_object_) {
+      hold_until_first_object_ = false;
+      ref_count_.fetch_sub(1, std::memory_order_relaxed);
+    }
+  }
 
   // This is read under the init mutex lock so can be relaxed, as it cannot
   // decrease during that time. However we should test the value before it's
@@ -305,31 +607,34 @@ bool GlobalFactory::ShutdownImplNoLock(ShutdownAction shutdown_action) {
 
     // Clear debug infos and references. This leaks objects, but at least won't
     // interact with future uses.
-    alive_objects_.clear();
+    live_objects_.Clear();
     ref_count_.store(0, std::memory_order_release);  // see "load acquire" above
   }
 
-  // Shutdown
+  // Shutdown. Stop the CPU budget manager and the memory budget notifications
+  // so that the library can be unloaded once shut down. The thread monitor is
+  // started by the application, and only stops sampling the threads of the
+  // library, which are unregistered when destroyed.
+  CpuBudgetManager::Instance().Stop();
+  MemoryAccount::StopNotifications();
   peer_factory_ = nullptr;
 #if defined(WINUWP)
   impl_ = nullptr;
 #else   // defined(WINUWP)
-  network_thread_.reset();
-  worker_thread_.reset();
-  signaling_thread_.reset();
+  DestroyShards(shards_);
 #endif  // defined(WINUWP)
   return true;
 }
 
 void GlobalFactory::ReportLiveObjectsNoLock() {
   RTC_LOG(LS_INFO) << "mr-webrtc alive objects report for "
-                   << alive_objects_.size() << " objects:";
+                   << live_objects_.Count() << " objects:";
   int i = 0;
-  for (auto&& obj : alive_objects_) {
+  live_objects_.ForEach([&i](TrackedObject* obj) {
     RTC_LOG(LS_INFO) << "[" << i << "] " << ObjectToString(obj) << " [~"
                      << obj->GetApproxRefCount() << " ref(s)]";
     ++i;
-  }
+  });
 }
 
 }  // namespace WebRTC
@@ -3,7 +3,10 @@
 
 #pragma once
 
+#include <thread>
+
 #include "export.h"
+#include "live_object_registry.h"
 #include "peer_connection.h"
 #include "utils.h"
 
@@ -11,6 +14,8 @@ namespace Microsoft {
 namespace MixedReality {
 namespace WebRTC {
 
+class ForwardingVideoDecoderFactory;
+
 /// The global factory is a helper class used to initialize and shutdown the
 /// internal WebRTC library, which adds extra functionalities over a classical
 /// init/shutdown pair of functions:
@@ -42,6 +47,27 @@ class GlobalFactory {
   /// immediately. This is multithread-safe.
   static void SetShutdownOptions(mrsShutdownOptions options) noexcept;
 
+  /// Get the number of factory shards, each with its own set of WebRTC threads
+  /// and peer connection factory. This does not initialize the library. This is
+  /// multithread-safe.
+  static uint32_t GetShardCount() noexcept;
+
+  /// Set the number of factory shards used the next time the library is
+  /// initialized. Return |Result::kInvalidOperation| if the library is already
+  /// initialized with a different number of shards. This is multithread-safe.
+  static Result SetShardCount(uint32_t count) noexcept;
+
+  /// Initialize the library on a background thread, and invoke |callback| on
+  /// that thread once done. The library is then kept initialized until the
+  /// first tracked object is added. See |mrsLibraryInitializeAsync()|. This is
+  /// multithread-safe.
+  static Result InitializeAsync(Callback<mrsResult> callback) noexcept;
+
+  /// Get the time spent in each phase of the last library initializing, or
+  /// return |Result::kNotFound| if the library was never initialized. This
+  /// does not initialize the library. This is multithread-safe.
+  static Result GetInitStats(mrsLibraryInitStats& stats) noexcept;
+
   /// Force-shutdown the library if it is initialized, or does nothing
   /// otherwise. This call will terminate the WebRTC threads, therefore will
   /// prevent any dispatched call to a WebRTC object from completing. However,
@@ -101,18 +127,30 @@ class GlobalFactory {
     }
   }
 
-  /// Get the existing peer connection factory, or NULL if the library is not
-  /// initialized.
+  /// Select the shard of a new peer connection. A non-negative |hint| selects
+  /// the shard of index |hint| modulo the number of shards, while a negative
+  /// one assigns shards round-robin.
+  uint32_t SelectShard(int32_t hint) noexcept;
+
+  /// Get the existing peer connection factory of the given shard, or NULL if
+  /// the library is not initialized. Local tracks and sources are created on
+  /// the first shard, and can be added to peer connections of any shard.
   rtc::scoped_refptr<webrtc::PeerConnectionFactoryInterface>
-  GetPeerConnectionFactory() noexcept;
+  GetPeerConnectionFactory(uint32_t shard = 0) noexcept;
+
+  /// Get the WebRTC background worker thread of the given shard, or NULL if
+  /// the library is not initialized.
+  rtc::Thread* GetWorkerThread(uint32_t shard = 0) const noexcept;
 
-  /// Get the WebRTC background worker thread, or NULL if the library is not
-  /// initialized.
-  rtc::Thread* GetWorkerThread() const noexcept;
+  /// Get the WebRTC signaling thread of the given shard, or NULL if the
+  /// library is not initialized.
+  rtc::Thread* GetSignalingThread(uint32_t shard = 0) const noexcept;
 
-  /// Get the WebRTC signaling thread, or NULL if the library is not
-  /// initialized.
-  rtc::Thread* GetSignalingThread() const noexcept;
+  /// Get the video decoder factory of the given shard, or NULL if the library
+  /// is not initialized or on UWP, where the codec factories are not under the
+  /// control of the library.
+  ForwardingVideoDecoderFactory* GetVideoDecoderFactory(
+      uint32_t shard = 0) const noexcept;
 
   /// Add to the global factory collection a tracked object whose lifetime is
   /// monitored (via the library reference count) to know when it is safe to
@@ -138,9 +176,8 @@ class GlobalFactory {
   mrsResult GetOrCreateWebRtcFactory(WebRtcFactoryPtr& factory);
 #endif  // defined(WINUWP)
 
-  rtc::scoped_refptr<ToggleAudioMixer> audio_mixer() const {
-    return custom_audio_mixer_;
-  }
+  /// Get the audio mixer of the given shard.
+  rtc::scoped_refptr<ToggleAudioMixer> audio_mixer(uint32_t shard = 0) const;
 
  private:
   friend struct std::default_delete<GlobalFactory>;
@@ -160,6 +197,15 @@ class GlobalFactory {
 
   mrsResult InitializeImplNoLock();
 
+  /// Wait for the background initializing thread started by
+  /// |InitializeAsync()| to terminate, if any. Does nothing if called from
+  /// that thread itself.
+  void JoinInitThread() noexcept;
+
+  /// Keep the library initialized until the first tracked object is added, by
+  /// holding an extra reference. Does nothing if an object is already alive.
+  void HoldUntilFirstObject() noexcept;
+
   enum class ShutdownAction {
     /// Try to safely shutdown, only if no tracked object is alive.
     kTryShutdownIfSafe,
@@ -198,23 +244,66 @@ class GlobalFactory {
 
 #else  // defined(WINUWP)
 
-  /// WebRTC networking thread. This is initialized only while the library
-  /// is initialized, and is immutable between init and shutdown, so do not
-  /// require |mutex_| for access, but |init_mutex_| instead.
-  std::unique_ptr<rtc::Thread> network_thread_ RTC_GUARDED_BY(init_mutex_);
+  /// Independent set of WebRTC threads and peer connection factory. Spreading
+  /// peer connections over several shards allows scaling the media processing
+  /// of many connections over several cores.
+  struct FactoryShard {
+    /// WebRTC networking thread.
+    std::unique_ptr<rtc::Thread> network_thread_;
 
-  /// WebRTC background worker thread. This is initialized only while the
-  /// library is initialized, and is immutable between init and shutdown, so do
-  /// not require |mutex_| for access, but |init_mutex_| instead.
-  std::unique_ptr<rtc::Thread> worker_thread_ RTC_GUARDED_BY(init_mutex_);
+    /// WebRTC background worker thread.
+    std::unique_ptr<rtc::Thread> worker_thread_;
 
-  /// WebRTC signaling thread. This is initialized only while the library
-  /// is initialized, and is immutable between init and shutdown, so do not
+    /// WebRTC signaling thread.
+    std::unique_ptr<rtc::Thread> signaling_thread_;
+
+    /// Audio mixer passed to the peer connection factory of the shard.
+    rtc::scoped_refptr<ToggleAudioMixer> audio_mixer_;
+
+    /// Peer connection factory of the shard.
+    rtc::scoped_refptr<webrtc::PeerConnectionFactoryInterface> peer_factory_;
+
+    /// Video decoder factory of the shard, owned by |peer_factory_|.
+    ForwardingVideoDecoderFactory* video_decoder_factory_{nullptr};
+  };
+
+  /// Create and start the threads and the peer connection factory of a shard,
+  /// and add the time spent in each phase to |stats|.
+  static std::unique_ptr<FactoryShard> CreateShard(uint32_t index,
+                                                   mrsLibraryInitStats& stats);
+
+  /// Stop the threads of all shards, after releasing their peer connection
+  /// factories, and clear |shards|. The threads of all shards are asked to
+  /// quit before any is joined, so that they wind down concurrently.
+  static void DestroyShards(std::vector<std::unique_ptr<FactoryShard>>& shards);
+
+  /// Factory shards. The peer connection factory of the first shard is also
+  /// |peer_factory_|. This is initialized only while the library is
+  /// initialized, and is immutable between init and shutdown, so do not
   /// require |mutex_| for access, but |init_mutex_| instead.
-  std::unique_ptr<rtc::Thread> signaling_thread_ RTC_GUARDED_BY(init_mutex_);
+  std::vector<std::unique_ptr<FactoryShard>> shards_
+      RTC_GUARDED_BY(init_mutex_);
 
 #endif  // defined(WINUWP)
 
+  /// Number of factory shards to create on initializing.
+  uint32_t shard_count_ RTC_GUARDED_BY(init_mutex_){1};
+
+  /// Timing of the last initializing, valid if |has_init_stats_| is set.
+  mrsLibraryInitStats init_stats_ RTC_GUARDED_BY(init_mutex_);
+  bool has_init_stats_ RTC_GUARDED_BY(init_mutex_){false};
+
+  /// Mutex protecting |init_thread_|. This is never acquired while holding
+  /// |init_mutex_|, since the thread acquires it.
+  std::mutex init_thread_mutex_;
+
+  /// Background initializing thread started by |InitializeAsync()|, joined on
+  /// the next call or on shutdown.
+  std::thread init_thread_ RTC_GUARDED_BY(init_thread_mutex_);
+
+  /// Index of the next shard assigned round-robin.
+  std::atomic_uint32_t next_shard_{0};
+
   /// Reference count to the library, for automated shutdown.
   mutable std::atomic_uint32_t ref_count_{0};
 
@@ -227,11 +316,18 @@ class GlobalFactory {
   mrsShutdownOptions shutdown_options_ RTC_GUARDED_BY(mutex_) =
       mrsShutdownOptions::kDefault;
 
-  /// Collection of all tracked objects alive. This is solely used to display a
-  /// debugging report with |ReportLiveObjects()|.
-  std::vector<TrackedObject*> alive_objects_ RTC_GUARDED_BY(mutex_);
+  /// Registry of all tracked objects alive. This is used to display a debugging
+  /// report with |ReportLiveObjects()|, and to detect the first object added
+  /// after initializing asynchronously.
+  LiveObjectRegistry live_objects_;
+
+  /// Set while |HoldUntilFirstObject()| may hold an extra reference, so that
+  /// |AddObject()| only acquires |mutex_| in that case.
+  std::atomic_bool hold_requested_{false};
 
-  rtc::scoped_refptr<ToggleAudioMixer> custom_audio_mixer_;
+  /// Whether an extra reference is held until the first tracked object is
+  /// added. See |HoldUntilFirstObject()|.
+  bool hold_until_first_object_ RTC_GUARDED_BY(mutex_){false};
 };
 
 }  // namespace WebRTC
@@ -23,6 +23,7 @@
 #include "peer_connection.h"
 #include "peer_connection_interop.h"
 #include "sdp_utils.h"
+#include "stats_report.h"
 #include "utils.h"
 
 using namespace Microsoft::MixedReality::WebRTC;
@@ -77,6 +78,30 @@ void MRS_CALL mrsForceShutdown() noexcept {
   GlobalFactory::ForceShutdown();
 }
 
+uint32_t MRS_CALL mrsGetFactoryShardCount() noexcept {
+  return GlobalFactory::GetShardCount();
+}
+
+mrsResult MRS_CALL mrsSetFactoryShardCount(uint32_t count) noexcept {
+  return GlobalFactory::SetShardCount(count);
+}
+
+mrsResult MRS_CALL
+mrsLibraryInitializeAsync(mrsLibraryInitializedCallback callback,
+                          void* user_data) noexcept {
+  return GlobalFactory::InitializeAsync(
+      Callback<mrsResult>{callback, user_data});
+}
+
+mrsResult MRS_CALL
+mrsLibraryGetInitStats(mrsLibraryInitStats* stats) noexcept {
+  if (!stats) {
+    RTC_LOG(LS_ERROR) << "Invalid NULL library init stats.";
+    return Result::kInvalidParameter;
+  }
+  return GlobalFactory::GetInitStats(*stats);
+}
+
 void MRS_CALL mrsCloseEnum(mrsEnumHandle* handleRef) noexcept {
   if (handleRef) {
     if (auto& handle = *handleRef) {
@@ -355,6 +380,20 @@ mrsPeerConnectionSetBitrate(mrsPeerConnectionHandle peer_handle,
   return Result::kInvalidNativeHandle;
 }
 
+mrsResult MRS_CALL
+mrsPeerConnectionGetFactoryShard(mrsPeerConnectionHandle peer_handle,
+                                 uint32_t* shard) noexcept {
+  if (!shard) {
+    RTC_LOG(LS_ERROR) << "Invalid NULL factory shard reference.";
+    return Result::kInvalidParameter;
+  }
+  if (auto peer = static_cast<PeerConnection*>(peer_handle)) {
+    *shard = peer->GetShard();
+    return Result::kSuccess;
+  }
+  return Result::kInvalidNativeHandle;
+}
+
 mrsResult MRS_CALL mrsPeerConnectionSetRemoteDescriptionAsync(
     mrsPeerConnectionHandle peer_handle,
     mrsSdpMessageType type,
@@ -386,6 +425,30 @@ mrsPeerConnectionClose(mrsPeerConnectionHandle peer_handle) noexcept {
   return Result::kInvalidNativeHandle;
 }
 
+mrsResult MRS_CALL
+mrsPeerConnectionCloseMany(const mrsPeerConnectionHandle* peer_handles,
+                           uint32_t count,
+                           mrsPeerConnectionsClosedCallback callback,
+                           void* user_data) noexcept {
+  if (!peer_handles && (count > 0)) {
+    RTC_LOG(LS_ERROR) << "Invalid NULL peer connection handle array.";
+    return Result::kInvalidParameter;
+  }
+  std::vector<PeerConnection*> peers;
+  peers.reserve(count);
+  for (uint32_t i = 0; i < count; ++i) {
+    auto peer = static_cast<PeerConnection*>(peer_handles[i]);
+    if (!peer) {
+      RTC_LOG(LS_ERROR) << "Invalid NULL peer connection handle at index "
+                        << i << ".";
+      return Result::kInvalidNativeHandle;
+    }
+    peers.push_back(peer);
+  }
+  PeerConnection::CloseMany(std::move(peers), Callback<>{callback, user_data});
+  return Result::kSuccess;
+}
+
 mrsResult MRS_CALL mrsSdpForceCodecs(const char* message,
                                      SdpFilter audio_filter,
                                      SdpFilter video_filter,
@@ -464,21 +527,6 @@ void MRS_CALL mrsMemCpyStride(void* dst,
   }
 }
 
-namespace {
-template <class T>
-T& FindOrInsert(std::vector<std::pair<std::string, T>>& vec,
-                absl::string_view id) {
-  auto it = std::find_if(vec.begin(), vec.end(),
-                         [&](auto&& pair) { return pair.first == id; });
-  if (it != vec.end()) {
-    return it->second;
-  }
-  vec.emplace_back(id, T{});
-  return vec.back().second;
-}
-
-}  // namespace
-
 mrsResult MRS_CALL mrsPeerConnectionGetSimpleStats(
     mrsPeerConnectionHandle peer_handle,
     mrsPeerConnectionGetSimpleStatsCallback callback,
@@ -496,40 +544,33 @@ mrsResult MRS_CALL mrsPeerConnectionGetSimpleStats(
           override {
         // Return a wrapper for the RTCStatsReport.
         // mrsStatsReportRemoveRef removes the reference.
-        report->AddRef();
-        (*callback_)(user_data_, report.get());
+        auto wrapper = new StatsReport(report);
+        wrapper->AddRef();
+        (*callback_)(user_data_, wrapper);
       }
     };
     rtc::scoped_refptr<Collector> collector =
         new rtc::RefCountedObject<Collector>(callback, user_data);
 
-    peer->GetStats(collector);
-    return Result::kSuccess;
+    return peer->GetStats(collector).result();
   }
   return Result::kInvalidNativeHandle;
 }
 
-namespace {
-template <class T>
-void GetCommonValues(T& lhs, const webrtc::RTCOutboundRTPStreamStats& rhs) {
-  lhs.rtp_stats_timestamp_us = rhs.timestamp_us();
-  lhs.packets_sent = *rhs.packets_sent;
-  lhs.bytes_sent = *rhs.bytes_sent;
-}
-template <class T>
-void GetCommonValues(T& lhs, const webrtc::RTCInboundRTPStreamStats& rhs) {
-  lhs.rtp_stats_timestamp_us = rhs.timestamp_us();
-  lhs.packets_received = *rhs.packets_received;
-  lhs.bytes_received = *rhs.bytes_received;
-}
-
-template <class T>
-T GetValueIfDefined(const webrtc::RTCStatsMember<T>& member) {
-  return member.is_defined() ? *member : 0;
+mrsResult MRS_CALL
+mrsPeerConnectionSetStatsMaxAge(mrsPeerConnectionHandle peer_handle,
+                                int32_t max_age_ms) noexcept {
+  auto peer = static_cast<PeerConnection*>(peer_handle);
+  if (!peer) {
+    return Result::kInvalidNativeHandle;
+  }
+  if (max_age_ms < 0) {
+    return Result::kInvalidParameter;
+  }
+  peer->SetStatsMaxAge(max_age_ms);
+  return Result::kSuccess;
 }
 
-}  // namespace
-
 mrsResult MRS_CALL
 mrsStatsReportGetObjects(mrsStatsReportHandle report_handle,
                          const char* stats_type,
@@ -538,169 +579,115 @@ mrsStatsReportGetObjects(mrsStatsReportHandle report_handle,
   if (!report_handle) {
     return Result::kInvalidNativeHandle;
   }
-  auto report = static_cast<const webrtc::RTCStatsReport*>(report_handle);
-
+  if (!stats_type || !callback) {
+    return Result::kInvalidParameter;
+  }
+  mrsStatsType type;
   if (!strcmp(stats_type, "DataChannelStats")) {
-    for (auto&& stats : *report) {
-      if (!strcmp(stats.type(), "data-channel")) {
-        const auto& dc_stats = stats.cast_to<webrtc::RTCDataChannelStats>();
-        mrsDataChannelStats simple_stats{
-            dc_stats.timestamp_us(),     *dc_stats.datachannelid,
-            *dc_stats.messages_sent,     *dc_stats.bytes_sent,
-            *dc_stats.messages_received, *dc_stats.bytes_received};
-        (*callback)(user_data, &simple_stats);
-      }
-    }
+    type = mrsStatsType::kDataChannel;
   } else if (!strcmp(stats_type, "AudioSenderStats")) {
-    std::vector<std::pair<std::string, mrsAudioSenderStats>> pending_stats;
-    // Get values from both RTCOutboundRTPStreamStats and
-    // RTCMediaStreamTrackStats objects. Match them together by track ID.
-    for (auto&& stats : *report) {
-      if (!strcmp(stats.type(), "outbound-rtp")) {
-        const auto& ortp_stats =
-            stats.cast_to<webrtc::RTCOutboundRTPStreamStats>();
-        if (*ortp_stats.kind == "audio" &&
-            // Removing a track will leave a "trackless" RTP stream. Ignore it.
-            ortp_stats.track_id.is_defined()) {
-          auto& dest_stats = FindOrInsert(pending_stats, *ortp_stats.track_id);
-          GetCommonValues(dest_stats, ortp_stats);
-        }
-      } else if (!strcmp(stats.type(), "track")) {
-        const auto& track_stats =
-            stats.cast_to<webrtc::RTCMediaStreamTrackStats>();
-        if (*track_stats.kind == "audio") {
-          if (!(*track_stats.remote_source)) {
-            auto& dest_stats = FindOrInsert(pending_stats, track_stats.id());
-            dest_stats.track_stats_timestamp_us = track_stats.timestamp_us();
-            dest_stats.track_identifier = track_stats.track_identifier->c_str();
-            dest_stats.audio_level = GetValueIfDefined(track_stats.audio_level);
-            dest_stats.total_audio_energy = *track_stats.total_audio_energy;
-            dest_stats.total_samples_duration =
-                *track_stats.total_samples_duration;
-          }
-        }
-      }
-    }
-    for (auto&& stats : pending_stats) {
-      (*callback)(user_data, &stats.second);
-    }
+    type = mrsStatsType::kAudioSender;
   } else if (!strcmp(stats_type, "AudioReceiverStats")) {
-    std::vector<std::pair<std::string, mrsAudioReceiverStats>> pending_stats;
-    // Get values from both RTCInboundRTPStreamStats and
-    // RTCMediaStreamTrackStats objects. Match them together by track ID.
-    for (auto&& stats : *report) {
-      if (!strcmp(stats.type(), "inbound-rtp")) {
-        const auto& irtp_stats =
-            stats.cast_to<webrtc::RTCInboundRTPStreamStats>();
-        if (*irtp_stats.kind == "audio") {
-          auto& dest_stats = FindOrInsert(pending_stats, *irtp_stats.track_id);
-          GetCommonValues(dest_stats, irtp_stats);
-        }
-      } else if (!strcmp(stats.type(), "track")) {
-        const auto& track_stats =
-            stats.cast_to<webrtc::RTCMediaStreamTrackStats>();
-        if (*track_stats.kind == "audio") {
-          if (*track_stats.remote_source) {
-            auto& dest_stats = FindOrInsert(pending_stats, track_stats.id());
-            dest_stats.track_stats_timestamp_us = track_stats.timestamp_us();
-            dest_stats.track_identifier = track_stats.track_identifier->c_str();
-            // This seems to be undefined in some not well specified cases.
-            dest_stats.audio_level = GetValueIfDefined(track_stats.audio_level);
-            dest_stats.total_audio_energy = *track_stats.total_audio_energy;
-            dest_stats.total_samples_received =
-                GetValueIfDefined(track_stats.total_samples_received);
-            dest_stats.total_samples_duration =
-                *track_stats.total_samples_duration;
-          }
-        }
-      }
-    }
-    for (auto&& stats : pending_stats) {
-      (*callback)(user_data, &stats.second);
-    }
+    type = mrsStatsType::kAudioReceiver;
   } else if (!strcmp(stats_type, "VideoSenderStats")) {
-    std::vector<std::pair<std::string, mrsVideoSenderStats>> pending_stats;
-    // Get values from both RTCOutboundRTPStreamStats and
-    // RTCMediaStreamTrackStats objects. Match them together by track ID.
-    for (auto&& stats : *report) {
-      if (!strcmp(stats.type(), "outbound-rtp")) {
-        const auto& ortp_stats =
-            stats.cast_to<webrtc::RTCOutboundRTPStreamStats>();
-        if (*ortp_stats.kind == "video" &&
-            // Removing a track will leave a "trackless" RTP stream. Ignore it.
-            ortp_stats.track_id.is_defined()) {
-          auto& dest_stats = FindOrInsert(pending_stats, *ortp_stats.track_id);
-          GetCommonValues(dest_stats, ortp_stats);
-          dest_stats.frames_encoded = *ortp_stats.frames_encoded;
-        }
-      } else if (!strcmp(stats.type(), "track")) {
-        const auto& track_stats =
-            stats.cast_to<webrtc::RTCMediaStreamTrackStats>();
-        if (*track_stats.kind == "video") {
-          if (!(*track_stats.remote_source)) {
-            auto& dest_stats = FindOrInsert(pending_stats, track_stats.id());
-            dest_stats.track_stats_timestamp_us = track_stats.timestamp_us();
-            dest_stats.track_identifier = track_stats.track_identifier->c_str();
-            dest_stats.frames_sent = GetValueIfDefined(track_stats.frames_sent);
-            dest_stats.huge_frames_sent =
-                GetValueIfDefined(track_stats.huge_frames_sent);
-          }
-        }
-      }
-    }
-    for (auto&& stats : pending_stats) {
-      (*callback)(user_data, &stats.second);
-    }
+    type = mrsStatsType::kVideoSender;
   } else if (!strcmp(stats_type, "VideoReceiverStats")) {
-    std::vector<std::pair<std::string, mrsVideoReceiverStats>> pending_stats;
-    // Get values from both RTCInboundRTPStreamStats and
-    // RTCMediaStreamTrackStats objects. Match them together by track ID.
-    for (auto&& stats : *report) {
-      if (!strcmp(stats.type(), "inbound-rtp")) {
-        const auto& irtp_stats =
-            stats.cast_to<webrtc::RTCInboundRTPStreamStats>();
-        if (*irtp_stats.kind == "video") {
-          auto& dest_stats = FindOrInsert(pending_stats, *irtp_stats.track_id);
-          GetCommonValues(dest_stats, irtp_stats);
-          dest_stats.frames_decoded = *irtp_stats.frames_decoded;
-        }
-      } else if (!strcmp(stats.type(), "track")) {
-        const auto& track_stats =
-            stats.cast_to<webrtc::RTCMediaStreamTrackStats>();
-        if (*track_stats.kind == "video") {
-          if (*track_stats.remote_source) {
-            auto& dest_stats = FindOrInsert(pending_stats, track_stats.id());
-            dest_stats.track_stats_timestamp_us = track_stats.timestamp_us();
-            dest_stats.track_identifier = track_stats.track_identifier->c_str();
-            dest_stats.frames_received =
-                GetValueIfDefined(track_stats.frames_received);
-            dest_stats.frames_dropped =
-                GetValueIfDefined(track_stats.frames_dropped);
-          }
-        }
-      }
-    }
-    for (auto&& stats : pending_stats) {
-      (*callback)(user_data, &stats.second);
-    }
+    type = mrsStatsType::kVideoReceiver;
   } else if (!strcmp(stats_type, "TransportStats")) {
-    for (auto&& stats : *report) {
-      if (!strcmp(stats.type(), "transport")) {
-        const auto& dc_stats = stats.cast_to<webrtc::RTCTransportStats>();
-        mrsTransportStats simple_stats{dc_stats.timestamp_us(),
-                                       *dc_stats.bytes_sent,
-                                       *dc_stats.bytes_received};
-        (*callback)(user_data, &simple_stats);
-      }
-    }
+    type = mrsStatsType::kTransport;
+  } else {
+    return Result::kSuccess;
+  }
+  auto report = static_cast<const StatsReport*>(report_handle);
+  uint64_t count = 0;
+  auto objects = static_cast<const uint8_t*>(
+      report->GetSimpleStats().GetArray(type, &count));
+  const size_t object_size = SimpleStats::GetObjectSize(type);
+  for (uint64_t i = 0; i < count; ++i) {
+    (*callback)(user_data, objects + i * object_size);
+  }
+  return Result::kSuccess;
+}
+
+mrsResult MRS_CALL
+mrsStatsReportGetSimpleStats(mrsStatsReportHandle report_handle,
+                             mrsStatsType stats_type,
+                             const void** objects_out,
+                             uint64_t* count_out) noexcept {
+  if (!report_handle) {
+    return Result::kInvalidNativeHandle;
+  }
+  if (!objects_out || !count_out) {
+    return Result::kInvalidParameter;
   }
+  if (SimpleStats::GetObjectSize(stats_type) == 0) {
+    return Result::kInvalidParameter;
+  }
+  auto report = static_cast<const StatsReport*>(report_handle);
+  *objects_out = report->GetSimpleStats().GetArray(stats_type, count_out);
   return Result::kSuccess;
 }
 
+mrsResult MRS_CALL mrsStatsReportToJson(mrsStatsReportHandle report_handle,
+                                        const char* type_filter,
+                                        char* buffer,
+                                        uint64_t* buffer_size) noexcept {
+  if (!report_handle) {
+    return Result::kInvalidNativeHandle;
+  }
+  if (!buffer_size) {
+    RTC_LOG(LS_ERROR) << "Invalid NULL string buffer size reference.";
+    return Result::kInvalidParameter;
+  }
+  if (!buffer && (*buffer_size > 0)) {
+    RTC_LOG(LS_ERROR) << "Invalid NULL string buffer.";
+    return Result::kInvalidParameter;
+  }
+  auto report = static_cast<const StatsReport*>(report_handle);
+  return report->CopyJson(type_filter ? type_filter : "", buffer,
+                          *buffer_size);
+}
+
 mrsResult MRS_CALL mrsStatsReportRemoveRef(mrsStatsReportHandle stats_report) {
-  if (auto rep = static_cast<const webrtc::RTCStatsReport*>(stats_report)) {
-    rep->Release();
+  if (auto rep = static_cast<const StatsReport*>(stats_report)) {
+    rep->RemoveRef();
     return Result::kSuccess;
   }
   return Result::kInvalidNativeHandle;
 }
+
+mrsResult MRS_CALL
+mrsPeerConnectionStartStatsSampler(mrsPeerConnectionHandle peer_handle,
+                                   const mrsStatsSamplerConfig* config) noexcept {
+  auto peer = static_cast<PeerConnection*>(peer_handle);
+  if (!peer) {
+    return Result::kInvalidNativeHandle;
+  }
+  if (!config) {
+    return Result::kInvalidParameter;
+  }
+  return peer->StartStatsSampler(*config).result();
+}
+
+mrsResult MRS_CALL
+mrsPeerConnectionStopStatsSampler(mrsPeerConnectionHandle peer_handle) noexcept {
+  auto peer = static_cast<PeerConnection*>(peer_handle);
+  if (!peer) {
+    return Result::kInvalidNativeHandle;
+  }
+  peer->StopStatsSampler();
+  return Result::kSuccess;
+}
+
+mrsResult MRS_CALL
+mrsPeerConnectionGetStatsSnapshot(mrsPeerConnectionHandle peer_handle,
+                                  mrsStatsSamplerSnapshot* snapshot) noexcept {
+  auto peer = static_cast<PeerConnection*>(peer_handle);
+  if (!peer) {
+    return Result::kInvalidNativeHandle;
+  }
+  if (!snapshot) {
+    return Result::kInvalidParameter;
+  }
+  return peer->GetStatsSnapshot(*snapshot).result();
+}
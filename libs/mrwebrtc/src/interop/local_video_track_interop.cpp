@@ -8,6 +8,7 @@
 #include "global_factory.h"
 #include "local_video_track_interop.h"
 #include "media/external_video_track_source.h"
+#include "media/key_frame_track_source.h"
 #include "media/local_video_track.h"
 #include "media/video_track_source.h"
 #include "utils.h"
@@ -44,10 +45,14 @@ mrsResult MRS_CALL mrsLocalVideoTrackCreateFromSource(
   }
 
   // Create the audio track
+  // Each track has its own view of the source, so that key frames can be
+  // forced on its encoder only.
   auto source = static_cast<VideoTrackSource*>(source_handle);
+  rtc::scoped_refptr<KeyFrameTrackSource> key_frame_source =
+      KeyFrameTrackSource::Create(source->impl());
   rtc::scoped_refptr<webrtc::VideoTrackInterface> video_track =
       pc_factory->CreateVideoTrack(init_settings->track_name,
-                                   source->impl().get());
+                                   key_frame_source.get());
   if (!video_track) {
     RTC_LOG(LS_ERROR) << "Failed to create local video track from source.";
     return Result::kUnknownError;
@@ -55,7 +60,8 @@ mrsResult MRS_CALL mrsLocalVideoTrackCreateFromSource(
 
   // Create the audio track wrapper
   RefPtr<LocalVideoTrack> track =
-      new LocalVideoTrack(std::move(global_factory), std::move(video_track));
+      new LocalVideoTrack(std::move(global_factory), std::move(video_track),
+                          std::move(key_frame_source));
   *track_handle_out = track.release();
   return Result::kSuccess;
 }
@@ -89,6 +95,20 @@ mrsLocalVideoTrackSetEnabled(mrsLocalVideoTrackHandle track_handle,
   return Result::kSuccess;
 }
 
+mrsResult MRS_CALL mrsLocalVideoTrackForceKeyFrame(
+    mrsLocalVideoTrackHandle track_handle) noexcept {
+  auto track = static_cast<LocalVideoTrack*>(track_handle);
+  if (!track) {
+    return Result::kInvalidNativeHandle;
+  }
+#if defined(WINUWP)
+  RTC_LOG(LS_ERROR) << "Forcing key frames is not supported on UWP.";
+  return Result::kUnsupported;
+#else   // defined(WINUWP)
+  return track->ForceKeyFrame();
+#endif  // defined(WINUWP)
+}
+
 mrsBool MRS_CALL
 mrsLocalVideoTrackIsEnabled(mrsLocalVideoTrackHandle track_handle) noexcept {
   auto track = static_cast<LocalVideoTrack*>(track_handle);
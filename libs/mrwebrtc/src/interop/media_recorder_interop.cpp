@@ -0,0 +1,97 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+// This is a precompiled header, it must be on its own, followed by a blank
+// line, to prevent clang-format from reordering it with other headers.
+#include "pch.h"
+
+#include "interop/global_factory.h"
+#include "media/media_recorder.h"
+#include "media/remote_audio_track.h"
+#include "media/remote_video_track.h"
+#include "media_recorder_interop.h"
+
+using namespace Microsoft::MixedReality::WebRTC;
+
+mrsResult MRS_CALL
+mrsMediaRecorderCreate(const mrsMediaRecorderConfig* config,
+                       mrsMediaRecorderHandle* recorder_handle_out) noexcept {
+  if (!config) {
+    RTC_LOG(LS_ERROR) << "Invalid NULL media recorder config.";
+    return Result::kInvalidParameter;
+  }
+  if (!recorder_handle_out) {
+    RTC_LOG(LS_ERROR) << "Invalid NULL media recorder handle reference.";
+    return Result::kInvalidParameter;
+  }
+  *recorder_handle_out = nullptr;
+  RefPtr<MediaRecorder> recorder =
+      MediaRecorder::create(GlobalFactory::InstancePtr(), *config);
+  if (!recorder) {
+    return Result::kUnknownError;
+  }
+  *recorder_handle_out = recorder.release();
+  return Result::kSuccess;
+}
+
+mrsResult MRS_CALL
+mrsMediaRecorderAddVideoTrack(mrsMediaRecorderHandle recorder_handle,
+                              mrsRemoteVideoTrackHandle track_handle,
+                              const char* path,
+                              mrsVideoContainer container) noexcept {
+  if (IsStringNullOrEmpty(path)) {
+    RTC_LOG(LS_ERROR) << "Invalid NULL or empty recording file path.";
+    return Result::kInvalidParameter;
+  }
+  auto recorder = static_cast<MediaRecorder*>(recorder_handle);
+  auto track = static_cast<RemoteVideoTrack*>(track_handle);
+  if (!recorder || !track) {
+    return Result::kInvalidNativeHandle;
+  }
+#if defined(WINUWP)
+  (void)container;
+  RTC_LOG(LS_ERROR) << "Video recording is not supported on UWP.";
+  return Result::kUnsupported;
+#else   // defined(WINUWP)
+  return recorder->AddVideoTrack(*track, path, container);
+#endif  // defined(WINUWP)
+}
+
+mrsResult MRS_CALL
+mrsMediaRecorderAddAudioTrack(mrsMediaRecorderHandle recorder_handle,
+                              mrsRemoteAudioTrackHandle track_handle,
+                              const char* path) noexcept {
+  if (IsStringNullOrEmpty(path)) {
+    RTC_LOG(LS_ERROR) << "Invalid NULL or empty recording file path.";
+    return Result::kInvalidParameter;
+  }
+  auto recorder = static_cast<MediaRecorder*>(recorder_handle);
+  auto track = static_cast<RemoteAudioTrack*>(track_handle);
+  if (!recorder || !track) {
+    return Result::kInvalidNativeHandle;
+  }
+  return recorder->AddAudioTrack(*track, path);
+}
+
+mrsResult MRS_CALL
+mrsMediaRecorderStop(mrsMediaRecorderHandle recorder_handle) noexcept {
+  if (auto recorder = static_cast<MediaRecorder*>(recorder_handle)) {
+    recorder->Stop();
+    return Result::kSuccess;
+  }
+  return Result::kInvalidNativeHandle;
+}
+
+mrsResult MRS_CALL
+mrsMediaRecorderGetStats(mrsMediaRecorderHandle recorder_handle,
+                         mrsMediaRecorderStats* stats) noexcept {
+  if (!stats) {
+    RTC_LOG(LS_ERROR) << "Invalid NULL media recorder stats reference.";
+    return Result::kInvalidParameter;
+  }
+  if (auto recorder = static_cast<MediaRecorder*>(recorder_handle)) {
+    recorder->GetStats(*stats);
+    return Result::kSuccess;
+  }
+  return Result::kInvalidNativeHandle;
+}
@@ -0,0 +1,57 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+// This is a precompiled header, it must be on its own, followed by a blank
+// line, to prevent clang-format from reordering it with other headers.
+#include "pch.h"
+
+#include "memory_account.h"
+#include "memory_usage_interop.h"
+#include "peer_connection.h"
+
+using namespace Microsoft::MixedReality::WebRTC;
+
+mrsResult MRS_CALL mrsGetMemoryUsage(mrsMemoryUsage* usage) noexcept {
+  if (!usage) {
+    RTC_LOG(LS_ERROR) << "Invalid NULL memory usage reference.";
+    return Result::kInvalidParameter;
+  }
+  MemoryAccount::Global()->GetUsage(*usage);
+  return Result::kSuccess;
+}
+
+mrsResult MRS_CALL
+mrsPeerConnectionGetMemoryUsage(mrsPeerConnectionHandle peer_handle,
+                                mrsMemoryUsage* usage) noexcept {
+  if (!usage) {
+    RTC_LOG(LS_ERROR) << "Invalid NULL memory usage reference.";
+    return Result::kInvalidParameter;
+  }
+  if (auto peer = static_cast<PeerConnection*>(peer_handle)) {
+    peer->GetMemoryAccount()->GetUsage(*usage);
+    return Result::kSuccess;
+  }
+  return Result::kInvalidNativeHandle;
+}
+
+mrsResult MRS_CALL
+mrsSetMemoryBudget(uint64_t budget_bytes,
+                   mrsMemoryBudgetExceededCallback callback,
+                   void* user_data) noexcept {
+  MemoryAccount::Global()->SetBudget(
+      budget_bytes, MemoryBudgetExceededCallback{callback, user_data});
+  return Result::kSuccess;
+}
+
+mrsResult MRS_CALL
+mrsPeerConnectionSetMemoryBudget(mrsPeerConnectionHandle peer_handle,
+                                 uint64_t budget_bytes,
+                                 mrsMemoryBudgetExceededCallback callback,
+                                 void* user_data) noexcept {
+  if (auto peer = static_cast<PeerConnection*>(peer_handle)) {
+    peer->GetMemoryAccount()->SetBudget(
+        budget_bytes, MemoryBudgetExceededCallback{callback, user_data});
+    return Result::kSuccess;
+  }
+  return Result::kInvalidNativeHandle;
+}
@@ -63,3 +63,18 @@ void* MRS_CALL mrsObjectGetUserData(mrsObjectHandle handle) noexcept {
   }
   return nullptr;
 }
+
+mrsResult MRS_CALL mrsObjectGetMetrics(mrsObjectHandle handle,
+                                       mrsObjectMetrics* metrics) noexcept {
+  auto obj = static_cast<TrackedObject*>(handle);
+  if (!obj) {
+    RTC_LOG(LS_ERROR) << "Invalid handle to object.";
+    return mrsResult::kInvalidNativeHandle;
+  }
+  if (!metrics) {
+    RTC_LOG(LS_ERROR) << "Invalid NULL metrics reference.";
+    return mrsResult::kInvalidParameter;
+  }
+  obj->GetMetrics().CopyTo(*metrics);
+  return mrsResult::kSuccess;
+}
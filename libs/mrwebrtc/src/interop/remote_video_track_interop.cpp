@@ -28,6 +28,75 @@ void MRS_CALL mrsRemoteVideoTrackRegisterArgb32FrameCallback(
   }
 }
 
+mrsResult MRS_CALL mrsRemoteVideoTrackRegisterEncodedFrameCallback(
+    mrsRemoteVideoTrackHandle track_handle,
+    mrsEncodedVideoFrameCallback callback,
+    void* user_data) noexcept {
+  auto track = static_cast<RemoteVideoTrack*>(track_handle);
+  if (!track) {
+    return Result::kInvalidNativeHandle;
+  }
+#if defined(WINUWP)
+  (void)callback;
+  (void)user_data;
+  RTC_LOG(LS_ERROR) << "Encoded frame callbacks are not supported on UWP.";
+  return Result::kUnsupported;
+#else   // defined(WINUWP)
+  track->SetEncodedFrameCallback(
+      EncodedVideoFrameCallback{callback, user_data});
+  return Result::kSuccess;
+#endif  // defined(WINUWP)
+}
+
+mrsResult MRS_CALL
+mrsRemoteVideoTrackSetDecodeEnabled(mrsRemoteVideoTrackHandle track_handle,
+                                    mrsBool enabled) noexcept {
+  auto track = static_cast<RemoteVideoTrack*>(track_handle);
+  if (!track) {
+    return Result::kInvalidNativeHandle;
+  }
+#if defined(WINUWP)
+  (void)enabled;
+  RTC_LOG(LS_ERROR) << "Decoding control is not supported on UWP.";
+  return Result::kUnsupported;
+#else   // defined(WINUWP)
+  track->SetDecodeEnabled(enabled != mrsBool::kFalse);
+  return Result::kSuccess;
+#endif  // defined(WINUWP)
+}
+
+mrsResult MRS_CALL
+mrsRemoteVideoTrackSetAutoDecode(mrsRemoteVideoTrackHandle track_handle,
+                                 mrsBool enabled) noexcept {
+  auto track = static_cast<RemoteVideoTrack*>(track_handle);
+  if (!track) {
+    return Result::kInvalidNativeHandle;
+  }
+#if defined(WINUWP)
+  (void)enabled;
+  RTC_LOG(LS_ERROR) << "Decoding control is not supported on UWP.";
+  return Result::kUnsupported;
+#else   // defined(WINUWP)
+  track->SetAutoDecode(enabled != mrsBool::kFalse);
+  return Result::kSuccess;
+#endif  // defined(WINUWP)
+}
+
+mrsResult MRS_CALL mrsRemoteVideoTrackRequestKeyFrame(
+    mrsRemoteVideoTrackHandle track_handle) noexcept {
+  auto track = static_cast<RemoteVideoTrack*>(track_handle);
+  if (!track) {
+    return Result::kInvalidNativeHandle;
+  }
+#if defined(WINUWP)
+  RTC_LOG(LS_ERROR) << "Key frame requests are not supported on UWP.";
+  return Result::kUnsupported;
+#else   // defined(WINUWP)
+  track->RequestKeyFrame();
+  return Result::kSuccess;
+#endif  // defined(WINUWP)
+}
+
 mrsResult MRS_CALL
 mrsRemoteVideoTrackSetEnabled(mrsRemoteVideoTrackHandle track_handle,
                               mrsBool enabled) noexcept {
@@ -47,3 +116,18 @@ mrsRemoteVideoTrackIsEnabled(mrsRemoteVideoTrackHandle track_handle) noexcept {
   }
   return (track->IsEnabled() ? mrsBool::kTrue : mrsBool::kFalse);
 }
+
+mrsResult MRS_CALL mrsRemoteVideoTrackGetLatencyHistogram(
+    mrsRemoteVideoTrackHandle track_handle,
+    mrsBool reset,
+    mrsVideoLatencyHistogram* histogram) noexcept {
+  auto track = static_cast<RemoteVideoTrack*>(track_handle);
+  if (!track) {
+    return Result::kInvalidNativeHandle;
+  }
+  if (!histogram) {
+    return Result::kInvalidParameter;
+  }
+  track->GetLatencyHistogram(*histogram, reset != mrsBool::kFalse);
+  return Result::kSuccess;
+}
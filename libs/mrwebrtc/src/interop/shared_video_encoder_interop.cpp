@@ -0,0 +1,32 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+// This is a precompiled header, it must be on its own, followed by a blank
+// line, to prevent clang-format from reordering it with other headers.
+#include "pch.h"
+
+#include "media/shared_video_encoder.h"
+#include "shared_video_encoder_interop.h"
+
+using namespace Microsoft::MixedReality::WebRTC;
+
+mrsResult MRS_CALL mrsSetSharedVideoEncoding(mrsBool enabled) noexcept {
+#if defined(WINUWP)
+  (void)enabled;
+  RTC_LOG(LS_ERROR) << "Shared video encoding is not supported on UWP.";
+  return Result::kUnsupported;
+#else   // defined(WINUWP)
+  SharedVideoEncoderFactory::SetEnabled(enabled != mrsBool::kFalse);
+  return Result::kSuccess;
+#endif  // defined(WINUWP)
+}
+
+mrsResult MRS_CALL
+mrsGetSharedVideoEncoderStats(mrsSharedVideoEncoderStats* stats) noexcept {
+  if (!stats) {
+    RTC_LOG(LS_ERROR) << "Invalid NULL shared video encoder stats reference.";
+    return Result::kInvalidParameter;
+  }
+  SharedVideoEncoderFactory::GetStats(*stats);
+  return Result::kSuccess;
+}
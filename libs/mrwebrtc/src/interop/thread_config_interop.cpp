@@ -0,0 +1,39 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+// This is a precompiled header, it must be on its own, followed by a blank
+// line, to prevent clang-format from reordering it with other headers.
+#include "pch.h"
+
+#include "thread_config.h"
+#include "thread_config_interop.h"
+
+using namespace Microsoft::MixedReality::WebRTC;
+
+mrsResult MRS_CALL mrsThreadConfigSet(mrsThreadRole role,
+                                      const mrsThreadConfig* config) noexcept {
+  if (!config) {
+    RTC_LOG(LS_ERROR) << "Invalid NULL thread configuration.";
+    return Result::kInvalidParameter;
+  }
+  return ThreadConfig::Set(role, *config);
+}
+
+mrsResult MRS_CALL mrsThreadConfigGet(mrsThreadRole role,
+                                      mrsThreadConfig* config) noexcept {
+  if (!config) {
+    RTC_LOG(LS_ERROR) << "Invalid NULL thread configuration.";
+    return Result::kInvalidParameter;
+  }
+  return ThreadConfig::Get(role, *config);
+}
+
+mrsResult MRS_CALL
+mrsThreadConfigGetApplied(mrsThreadRole role,
+                          mrsAppliedThreadConfig* applied) noexcept {
+  if (!applied) {
+    RTC_LOG(LS_ERROR) << "Invalid NULL applied thread configuration.";
+    return Result::kInvalidParameter;
+  }
+  return ThreadConfig::GetApplied(role, *applied);
+}
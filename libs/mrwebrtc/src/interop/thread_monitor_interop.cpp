@@ -0,0 +1,37 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+// This is a precompiled header, it must be on its own, followed by a blank
+// line, to prevent clang-format from reordering it with other headers.
+#include "pch.h"
+
+#include "thread_monitor.h"
+#include "thread_monitor_interop.h"
+
+using namespace Microsoft::MixedReality::WebRTC;
+
+mrsResult MRS_CALL mrsThreadMonitorStart(int32_t interval_ms) noexcept {
+  if (interval_ms <= 0) {
+    RTC_LOG(LS_ERROR) << "Invalid thread monitor interval " << interval_ms
+                      << " ms.";
+    return Result::kInvalidParameter;
+  }
+  return ThreadMonitor::Instance().Start(interval_ms);
+}
+
+mrsResult MRS_CALL mrsThreadMonitorStop() noexcept {
+  return ThreadMonitor::Instance().Stop();
+}
+
+mrsResult MRS_CALL mrsThreadMonitorGetStats(mrsThreadStats* stats,
+                                            uint32_t* count) noexcept {
+  if (!count) {
+    RTC_LOG(LS_ERROR) << "Invalid NULL thread stats count reference.";
+    return Result::kInvalidParameter;
+  }
+  if (!stats && (*count > 0)) {
+    RTC_LOG(LS_ERROR) << "Invalid NULL thread stats array.";
+    return Result::kInvalidParameter;
+  }
+  return ThreadMonitor::Instance().GetStats(stats, *count);
+}
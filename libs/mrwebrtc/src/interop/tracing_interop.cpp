@@ -0,0 +1,32 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+// This is a precompiled header, it must be on its own, followed by a blank
+// line, to prevent clang-format from reordering it with other headers.
+#include "pch.h"
+
+#include "tracing.h"
+#include "tracing_interop.h"
+
+using namespace Microsoft::MixedReality::WebRTC;
+
+mrsResult MRS_CALL mrsTracingStart() noexcept {
+  return TraceRecorder::Start();
+}
+
+mrsResult MRS_CALL mrsTracingStop() noexcept {
+  return TraceRecorder::Stop();
+}
+
+mrsResult MRS_CALL mrsTracingGetJson(char* buffer,
+                                     uint64_t* buffer_size) noexcept {
+  if (!buffer_size) {
+    RTC_LOG(LS_ERROR) << "Invalid NULL string buffer size reference.";
+    return Result::kInvalidParameter;
+  }
+  if (!buffer && (*buffer_size > 0)) {
+    RTC_LOG(LS_ERROR) << "Invalid NULL string buffer.";
+    return Result::kInvalidParameter;
+  }
+  return TraceRecorder::CopyJson(buffer, *buffer_size);
+}
@@ -0,0 +1,71 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+// This is a precompiled header, it must be on its own, followed by a blank
+// line, to prevent clang-format from reordering it with other headers.
+#include "pch.h"
+
+#include "interop/global_factory.h"
+#include "media/forwarded_video_track_source.h"
+#include "media/remote_video_track.h"
+#include "video_forwarding_interop.h"
+
+using namespace Microsoft::MixedReality::WebRTC;
+
+mrsResult MRS_CALL mrsForwardedVideoTrackSourceCreate(
+    mrsRemoteVideoTrackHandle remote_track_handle,
+    const mrsVideoForwardingConfig* config,
+    mrsForwardedVideoTrackSourceHandle* source_handle_out) noexcept {
+  if (!config) {
+    RTC_LOG(LS_ERROR) << "Invalid NULL video forwarding config reference.";
+    return Result::kInvalidParameter;
+  }
+  if (!source_handle_out) {
+    RTC_LOG(LS_ERROR) << "Invalid NULL forwarded video track source handle "
+                         "reference.";
+    return Result::kInvalidParameter;
+  }
+  *source_handle_out = nullptr;
+  auto track = static_cast<RemoteVideoTrack*>(remote_track_handle);
+  if (!track) {
+    RTC_LOG(LS_ERROR) << "Invalid NULL remote video track handle.";
+    return Result::kInvalidNativeHandle;
+  }
+#if defined(WINUWP)
+  RTC_LOG(LS_ERROR) << "Video forwarding is not supported on UWP.";
+  return Result::kUnsupported;
+#else   // defined(WINUWP)
+  RefPtr<ForwardedVideoTrackSource> source = ForwardedVideoTrackSource::create(
+      GlobalFactory::InstancePtr(), *track, *config);
+  if (!source) {
+    // The track was removed from its peer connection
+    return Result::kInvalidOperation;
+  }
+  *source_handle_out = source.release();
+  return Result::kSuccess;
+#endif  // defined(WINUWP)
+}
+
+mrsResult MRS_CALL mrsForwardedVideoTrackSourceSetMaxTemporalLayer(
+    mrsForwardedVideoTrackSourceHandle source_handle,
+    int32_t max_temporal_layer) noexcept {
+  if (auto source = static_cast<ForwardedVideoTrackSource*>(source_handle)) {
+    source->SetMaxTemporalLayer(max_temporal_layer);
+    return Result::kSuccess;
+  }
+  return Result::kInvalidNativeHandle;
+}
+
+mrsResult MRS_CALL mrsForwardedVideoTrackSourceGetStats(
+    mrsForwardedVideoTrackSourceHandle source_handle,
+    mrsVideoForwardingStats* stats) noexcept {
+  if (!stats) {
+    RTC_LOG(LS_ERROR) << "Invalid NULL video forwarding stats reference.";
+    return Result::kInvalidParameter;
+  }
+  if (auto source = static_cast<ForwardedVideoTrackSource*>(source_handle)) {
+    source->GetStats(*stats);
+    return Result::kSuccess;
+  }
+  return Result::kInvalidNativeHandle;
+}
@@ -0,0 +1,89 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+// This is a precompiled header, it must be on its own, followed by a blank
+// line, to prevent clang-format from reordering it with other headers.
+#include "pch.h"
+
+#include "live_object_registry.h"
+#include "tracked_object.h"
+
+namespace Microsoft {
+namespace MixedReality {
+namespace WebRTC {
+
+LiveObjectRegistry::Shard& LiveObjectRegistry::GetShard(
+    const TrackedObject* obj) noexcept {
+  // Discard the low bits, which are the same for all objects due to alignment.
+  const uintptr_t address = reinterpret_cast<uintptr_t>(obj);
+  return shards_[(address >> 4) % kShardCount];
+}
+
+void LiveObjectRegistry::Add(TrackedObject* obj) noexcept {
+  Shard& shard = GetShard(obj);
+  {
+    std::lock_guard<std::mutex> lock(shard.mutex_);
+    RTC_DCHECK(!obj->live_registered_);
+    obj->live_prev_ = nullptr;
+    obj->live_next_ = shard.head_;
+    if (shard.head_) {
+      shard.head_->live_prev_ = obj;
+    }
+    shard.head_ = obj;
+    obj->live_registered_ = true;
+  }
+  count_.fetch_add(1);
+}
+
+void LiveObjectRegistry::Remove(TrackedObject* obj) noexcept {
+  Shard& shard = GetShard(obj);
+  {
+    std::lock_guard<std::mutex> lock(shard.mutex_);
+    if (!obj->live_registered_) {
+      return;
+    }
+    if (obj->live_prev_) {
+      obj->live_prev_->live_next_ = obj->live_next_;
+    } else {
+      RTC_DCHECK_EQ(shard.head_, obj);
+      shard.head_ = obj->live_next_;
+    }
+    if (obj->live_next_) {
+      obj->live_next_->live_prev_ = obj->live_prev_;
+    }
+    obj->live_prev_ = nullptr;
+    obj->live_next_ = nullptr;
+    obj->live_registered_ = false;
+  }
+  count_.fetch_sub(1);
+}
+
+void LiveObjectRegistry::ForEach(
+    const std::function<void(TrackedObject*)>& func) const {
+  for (const Shard& shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard.mutex_);
+    for (TrackedObject* obj = shard.head_; obj; obj = obj->live_next_) {
+      func(obj);
+    }
+  }
+}
+
+void LiveObjectRegistry::Clear() noexcept {
+  for (Shard& shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard.mutex_);
+    TrackedObject* obj = shard.head_;
+    while (obj) {
+      TrackedObject* const next = obj->live_next_;
+      obj->live_prev_ = nullptr;
+      obj->live_next_ = nullptr;
+      obj->live_registered_ = false;
+      count_.fetch_sub(1);
+      obj = next;
+    }
+    shard.head_ = nullptr;
+  }
+}
+
+}  // namespace WebRTC
+}  // namespace MixedReality
+}  // namespace Microsoft
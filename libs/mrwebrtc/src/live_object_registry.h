@@ -0,0 +1,61 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <functional>
+#include <mutex>
+
+namespace Microsoft {
+namespace MixedReality {
+namespace WebRTC {
+
+class TrackedObject;
+
+/// Registry of the tracked objects alive, with constant-time insertion and
+/// removal.
+///
+/// Objects are linked into intrusive doubly-linked lists through pointers
+/// stored in |TrackedObject| itself, so registering never allocates. The lists
+/// are sharded by object address, each with its own lock, so that objects
+/// created and destroyed concurrently on different threads rarely contend.
+class LiveObjectRegistry {
+ public:
+  /// Add an object. It must not be already registered.
+  void Add(TrackedObject* obj) noexcept;
+
+  /// Remove an object, if registered. Objects are no longer registered once
+  /// |Clear()| was called.
+  void Remove(TrackedObject* obj) noexcept;
+
+  /// Get the number of objects registered.
+  uint32_t Count() const noexcept {
+    return count_.load();
+  }
+
+  /// Invoke |func| for each object registered. Each shard is locked while its
+  /// objects are enumerated, so |func| must not add or remove objects.
+  void ForEach(const std::function<void(TrackedObject*)>& func) const;
+
+  /// Unregister all objects, without destroying them.
+  void Clear() noexcept;
+
+ private:
+  static constexpr size_t kShardCount = 16;
+
+  struct Shard {
+    mutable std::mutex mutex_;
+    TrackedObject* head_{nullptr};
+  };
+
+  Shard& GetShard(const TrackedObject* obj) noexcept;
+
+  std::array<Shard, kShardCount> shards_;
+  std::atomic_uint32_t count_{0};
+};
+
+}  // namespace WebRTC
+}  // namespace MixedReality
+}  // namespace Microsoft
@@ -9,6 +9,7 @@
 #include "interop/global_factory.h"
 #include "peer_connection.h"
 #include "remote_audio_track_interop.h"
+#include "tracing.h"
 
 namespace Microsoft {
 namespace MixedReality {
@@ -19,16 +20,20 @@ void AudioTrackReadBuffer::OnData(const void* audio_data,
                                   int sample_rate,
                                   size_t number_of_channels,
                                   size_t number_of_frames) {
+  MRS_TRACE_SCOPE("AudioTrackReadBuffer::OnData");
+  ObjectMetrics::Add(metrics_.frames_in, 1);
   std::lock_guard<std::mutex> lock(frames_mutex_);
   // maintain buffering limits, after adding this frame
-  const size_t maxFrames = std::max(buffer_size_ms_ / 10, 1);
-  while (frames_.size() > maxFrames) {
-    frames_.pop_front();
+  if (frames_count_ == frames_.size()) {
+    ObjectMetrics::Add(metrics_.overrun_count, 1);
+    ObjectMetrics::Add(metrics_.frames_dropped, 1);
+    frames_head_ = (frames_head_ + 1) % frames_.size();
+    --frames_count_;
     has_overrun_ = true;
   }
-  // add the new frame
-  frames_.emplace_back();
-  auto& frame = frames_.back();
+  // add the new frame, reusing the storage of the ring slot
+  auto& frame = frames_[(frames_head_ + frames_count_) % frames_.size()];
+  ++frames_count_;
   frame.bits_per_sample = bits_per_sample;
   frame.sample_rate = sample_rate;
   frame.number_of_channels = rtc::checked_cast<uint32_t>(number_of_channels);
@@ -36,18 +41,30 @@ void AudioTrackReadBuffer::OnData(const void* audio_data,
   size_t size =
       (size_t)(bits_per_sample / 8) * number_of_channels * number_of_frames;
   auto src_bytes = static_cast<const std::uint8_t*>(audio_data);
-  frame.audio_data.insert(frame.audio_data.begin(), src_bytes,
-                          src_bytes + size);
+  const size_t old_capacity = frame.audio_data.capacity();
+  frame.audio_data.assign(src_bytes, src_bytes + size);
+  const size_t new_capacity = frame.audio_data.capacity();
+  if (new_capacity != old_capacity) {
+    frames_memory_.Set(frames_memory_.Get() + new_capacity - old_capacity);
+  }
 }
 
 AudioTrackReadBuffer::AudioTrackReadBuffer(
     RefPtr<GlobalFactory> global_factory,
     rtc::scoped_refptr<webrtc::AudioTrackInterface> track,
+    std::shared_ptr<MemoryAccount> memory_account,
     int bufferMs)
     : TrackedObject(std::move(global_factory),
                     ObjectType::kAudioTrackReadBuffer),
       track_(std::move(track)),
-      buffer_size_ms_(bufferMs >= 10 ? bufferMs : 500) {
+      buffer_size_ms_(bufferMs >= 10 ? bufferMs : 500),
+      frames_memory_(memory_account, MemoryCategory::kAudioBuffer),
+      buffer_memory_(memory_account, MemoryCategory::kAudioBuffer) {
+  memory_account_ = std::move(memory_account);
+  // Keep up to maxFrames frames, plus the one being added
+  const size_t maxFrames = std::max(buffer_size_ms_ / 10, 1);
+  frames_.resize(maxFrames + 1);
+  frames_memory_.Set(frames_.capacity() * sizeof(Frame));
   track_->AddSink(this);
 }
 
@@ -63,13 +80,14 @@ AudioTrackReadBuffer::Buffer::~Buffer() {}
 void AudioTrackReadBuffer::Buffer::addFrame(const Frame& frame,
                                             int dst_sample_rate,
                                             int dst_channels) {
+  MRS_TRACE_SCOPE("AudioTrackReadBuffer::addFrame");
   assert(frame.number_of_channels == 1 || frame.number_of_channels == 2);
   assert(dst_channels == 1 || dst_channels == 2);
 
   // We may require up to 2 intermediate buffers
-  // We always write into buffer_next and then swap front/back buffers
-  std::vector<short> buffer_front;
-  std::vector<short> buffer_back;
+  // We always write into buffer_front_ and then swap front/back buffers
+  auto& buffer_front = buffer_front_;
+  auto& buffer_back = buffer_back_;
 
   const short* curr_data; //< Current version of the processed data.
   size_t src_count;  //< Includes samples from *all* channels.
@@ -98,7 +116,7 @@ void AudioTrackReadBuffer::Buffer::addFrame(const Frame& frame,
     // average L&R
     buffer_front.resize(src_count / 2);
     short* data = buffer_front.data();
-    for (int i = 0; i < (int)src_count; ++i) {
+    for (int i = 0; i < (int)buffer_front.size(); ++i) {
       data[i] = (curr_data[2 * i] + curr_data[2 * i + 1]) / 2;
     }
 
@@ -149,6 +167,7 @@ void AudioTrackReadBuffer::Read(int sample_rate,
                                 int num_samples_max,
                                 int* num_samples_read_out,
                                 bool* has_overrun_out) noexcept {
+  MRS_TRACE_SCOPE("AudioTrackReadBuffer::Read");
   float* dst = samples_out;
   int dst_len = num_samples_max;  // number of points remaining
 
@@ -167,7 +186,7 @@ void AudioTrackReadBuffer::Read(int sample_rate,
       // ensure the next frame matches. This may drop some data but will only
       // happen when the output sample rate/channels change (i.e. rarely)
 
-      absl::optional<Frame> frame;
+      bool has_frame = false;
       {
         std::unique_lock<std::mutex> lock(frames_mutex_);
 
@@ -175,15 +194,23 @@ void AudioTrackReadBuffer::Read(int sample_rate,
         *has_overrun_out = *has_overrun_out || has_overrun_;
         has_overrun_ = false;
 
-        // Pop the next frame.
-        if (!frames_.empty()) {
-          frame = std::move(frames_.front());
-          frames_.pop_front();
+        // Pop the next frame, swapping storage with the ring slot so that
+        // both keep their capacity.
+        if (frames_count_ > 0) {
+          std::swap(read_frame_, frames_[frames_head_]);
+          frames_head_ = (frames_head_ + 1) % frames_.size();
+          --frames_count_;
+          has_frame = true;
         }
       }
 
-      if (frame) {
-        buffer_.addFrame(*frame, sample_rate, num_channels);
+      if (has_frame) {
+        ObjectMetrics::Add(metrics_.frames_out, 1);
+        const int64_t convert_start_us = rtc::TimeMicros();
+        buffer_.addFrame(read_frame_, sample_rate, num_channels);
+        buffer_memory_.Set(buffer_.capacityBytes());
+        ObjectMetrics::Add(metrics_.conversion_time_us,
+                           rtc::TimeMicros() - convert_start_us);
       } else {
         // no more input! fill with sin wave
         constexpr float freq = 2 * 222 * float(M_PI);
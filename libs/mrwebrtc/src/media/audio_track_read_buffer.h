@@ -7,6 +7,7 @@
 #include "common_audio/resampler/include/resampler.h"
 
 #include "export.h"
+#include "memory_account.h"
 #include "refptr.h"
 #include "tracked_object.h"
 
@@ -23,9 +24,11 @@ class PeerConnection;
 class AudioTrackReadBuffer : public TrackedObject, webrtc::AudioTrackSinkInterface {
  public:
   /// Create a new stream which buffers |bufferMs| milliseconds of audio.
-  /// WebRTC delivers audio at 10ms intervals so pass a multiple of 10.
+  /// WebRTC delivers audio at 10ms intervals so pass a multiple of 10. The
+  /// memory of the buffers is charged to |memory_account|.
   AudioTrackReadBuffer(RefPtr<GlobalFactory> global_factory,
                        rtc::scoped_refptr<webrtc::AudioTrackInterface> track,
+                       std::shared_ptr<MemoryAccount> memory_account,
                        int bufferMs = 500);
 
   /// Destructs the stream.
@@ -57,16 +60,28 @@ class AudioTrackReadBuffer : public TrackedObject, webrtc::AudioTrackSinkInterfa
     uint32_t number_of_channels;
     uint32_t number_of_frames;
   };
-  // Incoming frames received from webrtc - see also buffer_
-  std::deque<Frame> frames_;
+  // Incoming frames received from webrtc - see also buffer_. This is a ring
+  // buffer allocated once on construction, whose frames keep their storage
+  // once used, so that no allocation occurs per frame in steady state.
+  std::vector<Frame> frames_;
+  // Index of the oldest frame in frames_.
+  size_t frames_head_{};
+  // Number of frames currently stored in frames_.
+  size_t frames_count_{};
   // protects frames_ and has_overrun_ in Read() and audioFrameCallback()
   std::mutex frames_mutex_;
+  // Frame popped from frames_ by Read(), swapped with the ring slot to reuse
+  // its storage. Only accessed from callers of Read - no locking needed.
+  Frame read_frame_{};
   // max ms of audio data stored in frames_
   int buffer_size_ms_{};
   // for debugging, we emit a sin on underrun.
   int sinwave_iter_{};
   // Have frames been dropped due to overrun after last call to Read()?
   bool has_overrun_{};
+  // Memory charged for frames_ and read_frame_, protected by frames_mutex_.
+  // Their storage only moves between them, so it only changes in OnData().
+  MemoryCharge frames_memory_;
 
   // Outgoing data resamples to f32 format
   struct Buffer {
@@ -87,9 +102,22 @@ class AudioTrackReadBuffer : public TrackedObject, webrtc::AudioTrackSinkInterfa
     }
     // Extract/resample data from frame and add it to our buffer.
     void addFrame(const Frame& frame, int dstSampleRate, int dstChannels);
+    // Size in bytes of the storage of the buffers.
+    size_t capacityBytes() const {
+      return data_.capacity() * sizeof(float) +
+             (buffer_front_.capacity() + buffer_back_.capacity()) *
+                 sizeof(short);
+    }
+
+   private:
+    // Intermediate buffers of addFrame(), kept to reuse their storage.
+    std::vector<short> buffer_front_;
+    std::vector<short> buffer_back_;
   };
   // Only accessed from callers of Read - no locking needed.
   Buffer buffer_;
+  // Memory charged for buffer_. Only accessed from callers of Read.
+  MemoryCharge buffer_memory_;
 };
 }  // namespace WebRTC
 }  // namespace MixedReality
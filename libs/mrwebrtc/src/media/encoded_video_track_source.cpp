@@ -0,0 +1,168 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+// This is a precompiled header, it must be on its own, followed by a blank
+// line, to prevent clang-format from reordering it with other headers.
+#include "pch.h"
+
+#include "interop/global_factory.h"
+#include "media/encoded_video_track_source.h"
+#include "utils.h"
+
+namespace {
+
+using namespace Microsoft::MixedReality::WebRTC;
+
+bool ToCodecType(mrsVideoCodec codec, webrtc::VideoCodecType& codec_type) {
+  switch (codec) {
+    case mrsVideoCodec::kVP8:
+      codec_type = webrtc::kVideoCodecVP8;
+      return true;
+    case mrsVideoCodec::kVP9:
+      codec_type = webrtc::kVideoCodecVP9;
+      return true;
+    case mrsVideoCodec::kH264:
+      codec_type = webrtc::kVideoCodecH264;
+      return true;
+    default:
+      return false;
+  }
+}
+
+/// Get the codec-specific information of a frame without any layer, as an
+/// encoder would report it.
+webrtc::CodecSpecificInfo MakeCodecSpecificInfo(
+    webrtc::VideoCodecType codec_type,
+    bool is_key_frame) {
+  webrtc::CodecSpecificInfo info;
+  info.codecType = codec_type;
+  switch (codec_type) {
+    case webrtc::kVideoCodecVP8:
+      info.codecSpecific.VP8.nonReference = false;
+      info.codecSpecific.VP8.temporalIdx = webrtc::kNoTemporalIdx;
+      info.codecSpecific.VP8.layerSync = false;
+      info.codecSpecific.VP8.keyIdx = webrtc::kNoKeyIdx;
+      break;
+    case webrtc::kVideoCodecVP9:
+      info.codecSpecific.VP9.first_frame_in_picture = true;
+      info.codecSpecific.VP9.inter_pic_predicted = !is_key_frame;
+      info.codecSpecific.VP9.flexible_mode = false;
+      info.codecSpecific.VP9.ss_data_available = false;
+      info.codecSpecific.VP9.temporal_idx = webrtc::kNoTemporalIdx;
+      info.codecSpecific.VP9.spatial_idx = webrtc::kNoSpatialIdx;
+      info.codecSpecific.VP9.temporal_up_switch = false;
+      info.codecSpecific.VP9.inter_layer_predicted = false;
+      info.codecSpecific.VP9.gof_idx = webrtc::kNoGofIdx;
+      info.codecSpecific.VP9.num_spatial_layers = 1;
+      info.codecSpecific.VP9.end_of_picture = true;
+      break;
+    default:
+      break;
+  }
+  return info;
+}
+
+}  // namespace
+
+namespace Microsoft {
+namespace MixedReality {
+namespace WebRTC {
+
+RefPtr<EncodedVideoTrackSource> EncodedVideoTrackSource::create(
+    RefPtr<GlobalFactory> global_factory,
+    KeyFrameRequestedCallback callback) noexcept {
+  return new EncodedVideoTrackSource(
+      std::move(global_factory),
+      new rtc::RefCountedObject<detail::CustomTrackSourceAdapter>(),
+      std::move(callback));
+}
+
+EncodedVideoTrackSource::EncodedVideoTrackSource(
+    RefPtr<GlobalFactory> global_factory,
+    rtc::scoped_refptr<detail::CustomTrackSourceAdapter> source,
+    KeyFrameRequestedCallback callback) noexcept
+    : VideoTrackSource(std::move(global_factory),
+                       ObjectType::kEncodedVideoTrackSource,
+                       source),
+      state_(std::make_shared<detail::ForwardingState>()) {
+  callback.SetSite(this, mrsCallbackType::kKeyFrameRequested);
+  state_->key_frame_requested_callback = std::move(callback);
+  source->state_ = webrtc::MediaSourceInterface::kLive;
+}
+
+EncodedVideoTrackSource::~EncodedVideoTrackSource() {
+  // The state can outlive the source with the frames in flight
+  {
+    std::lock_guard<std::mutex> lock(state_->callback_mutex);
+    state_->key_frame_requested_callback = {};
+  }
+  GetSourceImpl()->state_ = webrtc::MediaSourceInterface::kEnded;
+}
+
+Result EncodedVideoTrackSource::PushFrame(const mrsEncodedVideoFrame& frame,
+                                          int64_t timestamp_ms) noexcept {
+  webrtc::VideoCodecType codec_type;
+  if (!ToCodecType(frame.codec, codec_type)) {
+    RTC_LOG(LS_ERROR) << "Unsupported codec for encoded video frame.";
+    return Result::kInvalidParameter;
+  }
+  if (!frame.data || (frame.size == 0)) {
+    RTC_LOG(LS_ERROR) << "Invalid empty encoded video frame.";
+    return Result::kInvalidParameter;
+  }
+  const bool is_key_frame = (frame.is_key_frame != mrsBool::kFalse);
+  if (is_key_frame && ((frame.width == 0) || (frame.height == 0))) {
+    RTC_LOG(LS_ERROR) << "Missing resolution of encoded video key frame.";
+    return Result::kInvalidParameter;
+  }
+
+  rtc::scoped_refptr<webrtc::VideoFrameBuffer> buffer;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (is_key_frame) {
+      width_ = static_cast<int>(frame.width);
+      height_ = static_cast<int>(frame.height);
+      state_->key_frame_requested.store(false, std::memory_order_relaxed);
+    }
+    if ((width_ <= 0) || (height_ <= 0)) {
+      // Delta frames cannot be decoded without the key frame before them
+      state_->frames_dropped.fetch_add(1, std::memory_order_relaxed);
+    } else {
+      state_->frames_received.fetch_add(1, std::memory_order_relaxed);
+
+      // The frame buffer takes a copy of the data
+      webrtc::EncodedImage image(
+          static_cast<uint8_t*>(const_cast<void*>(frame.data)), frame.size,
+          frame.size);
+      image._frameType = (is_key_frame ? webrtc::kVideoFrameKey
+                                       : webrtc::kVideoFrameDelta);
+      image._encodedWidth = static_cast<uint32_t>(width_);
+      image._encodedHeight = static_cast<uint32_t>(height_);
+      image._completeFrame = true;
+      const webrtc::CodecSpecificInfo info =
+          MakeCodecSpecificInfo(codec_type, is_key_frame);
+      buffer = new rtc::RefCountedObject<detail::EncodedFrameBuffer>(
+          state_, codec_type, image, &info, width_, height_, next_seq_++);
+    }
+  }
+
+  // The key frame requested callback, also invoked by the video senders while
+  // the frame is delivered, can push frames again, so is never invoked with
+  // the lock held.
+  if (!buffer) {
+    state_->RequestKeyFrame();
+    return Result::kSuccess;
+  }
+  webrtc::VideoFrame video_frame{
+      webrtc::VideoFrame::Builder()
+          .set_video_frame_buffer(std::move(buffer))
+          .set_timestamp_ms(timestamp_ms)
+          .set_ntp_time_ms(RtcTimeToNtpMs(timestamp_ms))
+          .build()};
+  GetSourceImpl()->DispatchFrame(video_frame);
+  return Result::kSuccess;
+}
+
+}  // namespace WebRTC
+}  // namespace MixedReality
+}  // namespace Microsoft
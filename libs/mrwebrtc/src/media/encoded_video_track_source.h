@@ -0,0 +1,69 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <memory>
+#include <mutex>
+
+#include "encoded_video_track_source_interop.h"
+#include "forwarded_video_track_source.h"
+#include "mrs_errors.h"
+#include "refptr.h"
+#include "video_track_source.h"
+
+namespace Microsoft {
+namespace MixedReality {
+namespace WebRTC {
+
+/// Callback fired when the video senders of an encoded video track source need
+/// a key frame.
+using KeyFrameRequestedCallback = Callback<>;
+
+/// Video track source producing frames already encoded by the application.
+///
+/// Like |ForwardedVideoTrackSource|, each frame is wrapped into a native frame
+/// buffer which goes through the regular video track pipeline down to the
+/// encoders created by |ForwardingVideoEncoderFactory|, which send it as is.
+class EncodedVideoTrackSource : public VideoTrackSource {
+ public:
+  static RefPtr<EncodedVideoTrackSource> create(
+      RefPtr<GlobalFactory> global_factory,
+      KeyFrameRequestedCallback callback) noexcept;
+
+  ~EncodedVideoTrackSource() override;
+
+  /// Push an encoded frame to the video senders of the source. See
+  /// |mrsEncodedVideoTrackSourcePushFrame()|.
+  Result PushFrame(const mrsEncodedVideoFrame& frame,
+                   int64_t timestamp_ms) noexcept;
+
+ protected:
+  EncodedVideoTrackSource(
+      RefPtr<GlobalFactory> global_factory,
+      rtc::scoped_refptr<detail::CustomTrackSourceAdapter> source,
+      KeyFrameRequestedCallback callback) noexcept;
+
+  detail::CustomTrackSourceAdapter* GetSourceImpl() const {
+    return (detail::CustomTrackSourceAdapter*)source_.get();
+  }
+
+  const std::shared_ptr<detail::ForwardingState> state_;
+
+  /// Lock for the state of the stream of frames pushed. It is not held while
+  /// delivering the frames nor while requesting key frames, which can invoke
+  /// the callback of the application, so frames pushed concurrently are
+  /// delivered in an unspecified order.
+  std::mutex mutex_;
+
+  /// Resolution of the stream, known from the last key frame.
+  int width_ RTC_GUARDED_BY(mutex_) = 0;
+  int height_ RTC_GUARDED_BY(mutex_) = 0;
+
+  /// Sequence number of the next frame pushed.
+  int64_t next_seq_ RTC_GUARDED_BY(mutex_) = 0;
+};
+
+}  // namespace WebRTC
+}  // namespace MixedReality
+}  // namespace Microsoft
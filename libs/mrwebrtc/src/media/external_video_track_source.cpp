@@ -3,8 +3,18 @@
 
 #include "pch.h"
 
+#include <algorithm>
+
+#include "common_video/include/i420_buffer_pool.h"
+
+#include "alloc_tracker.h"
 #include "interop/global_factory.h"
 #include "media/external_video_track_source.h"
+#include "memory_account.h"
+#include "thread_config.h"
+#include "thread_monitor.h"
+#include "tracing.h"
+#include "utils.h"
 
 namespace {
 
@@ -15,6 +25,68 @@ enum {
   MSG_REQUEST_FRAME
 };
 
+/// Maximum number of I420 buffers pooled by a buffer adapter.
+constexpr const size_t kMaxPooledBufferCount = 16;
+
+/// Pool of I420 buffers reused across frames, to avoid allocating a new buffer
+/// per frame in steady state. A buffer returns to the pool once all references
+/// to it are released by the sinks and the encoder.
+class I420BufferCache {
+ public:
+  rtc::scoped_refptr<webrtc::I420Buffer> CreateBuffer(int width, int height) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      rtc::scoped_refptr<webrtc::I420Buffer> buffer =
+          pool_.CreateBuffer(width, height);
+      if (buffer) {
+        ChargePooledBuffer(buffer.get());
+        return buffer;
+      }
+    }
+    // All pooled buffers are in use, e.g. because some sink holds onto frames.
+    return webrtc::I420Buffer::Create(width, height);
+  }
+
+ private:
+  /// Serialize accesses to the pool, since frames can be completed from any
+  /// thread.
+  std::mutex mutex_;
+  webrtc::I420BufferPool pool_{/* zero_initialize = */ false,
+                               kMaxPooledBufferCount};
+
+  /// Buffers allocated by the pool so far. The pool does not expose its
+  /// content, so it is mirrored here to charge its memory. The pool holds a
+  /// reference to each of those buffers, so their addresses are not reused
+  /// while listed.
+  std::vector<const webrtc::I420Buffer*> pooled_buffers_;
+
+  /// Memory charged for the pooled buffers. External sources are not owned by
+  /// a peer connection, so this is charged to the process-wide account.
+  MemoryCharge pooled_memory_{MemoryAccount::Global(),
+                              MemoryCategory::kExternalSource};
+
+  /// Charge the memory of a buffer returned by the pool, if new.
+  void ChargePooledBuffer(const webrtc::I420Buffer* buffer) {
+    if (!pooled_buffers_.empty() &&
+        ((pooled_buffers_[0]->width() != buffer->width()) ||
+         (pooled_buffers_[0]->height() != buffer->height()))) {
+      // The pool releases all its buffers when the resolution changes
+      pooled_buffers_.clear();
+    }
+    if (std::find(pooled_buffers_.begin(), pooled_buffers_.end(), buffer) !=
+        pooled_buffers_.end()) {
+      return;
+    }
+    pooled_buffers_.push_back(buffer);
+    const int chroma_height = (buffer->height() + 1) / 2;
+    const size_t buffer_size =
+        static_cast<size_t>(buffer->StrideY()) * buffer->height() +
+        static_cast<size_t>(buffer->StrideU() + buffer->StrideV()) *
+            chroma_height;
+    pooled_memory_.Set(pooled_buffers_.size() * buffer_size);
+  }
+};
+
 /// Buffer adapter for an I420 video frame.
 class I420ABufferAdapter : public detail::BufferAdapter {
  public:
@@ -29,11 +101,17 @@ class I420ABufferAdapter : public detail::BufferAdapter {
   }
   rtc::scoped_refptr<webrtc::VideoFrameBuffer> FillBuffer(
       const I420AVideoFrame& frame_view) override {
-    return webrtc::I420Buffer::Copy(
-        (int)frame_view.width_, (int)frame_view.height_,
-        (const uint8_t*)frame_view.ydata_, frame_view.ystride_,
-        (const uint8_t*)frame_view.udata_, frame_view.ustride_,
-        (const uint8_t*)frame_view.vdata_, frame_view.vstride_);
+    const int width = (int)frame_view.width_;
+    const int height = (int)frame_view.height_;
+    rtc::scoped_refptr<webrtc::I420Buffer> buffer =
+        buffer_cache_.CreateBuffer(width, height);
+    libyuv::I420Copy((const uint8_t*)frame_view.ydata_, frame_view.ystride_,
+                     (const uint8_t*)frame_view.udata_, frame_view.ustride_,
+                     (const uint8_t*)frame_view.vdata_, frame_view.vstride_,
+                     buffer->MutableDataY(), buffer->StrideY(),
+                     buffer->MutableDataU(), buffer->StrideU(),
+                     buffer->MutableDataV(), buffer->StrideV(), width, height);
+    return buffer;
   }
   rtc::scoped_refptr<webrtc::VideoFrameBuffer> FillBuffer(
       const Argb32VideoFrame& /*frame_view*/) override {
@@ -42,6 +120,7 @@ class I420ABufferAdapter : public detail::BufferAdapter {
 
  private:
   RefPtr<I420AExternalVideoSource> video_source_;
+  I420BufferCache buffer_cache_;
 };
 
 /// Buffer adapter for a 32-bit ARGB video frame.
@@ -91,7 +170,7 @@ class Argb32BufferAdapter : public detail::BufferAdapter {
 
     // Create I420 buffer
     rtc::scoped_refptr<webrtc::I420Buffer> buffer =
-        webrtc::I420Buffer::Create(width, height);
+        buffer_cache_.CreateBuffer(width, height);
 
     // Convert to I420 and copy to buffer
     libyuv::ARGBToI420((const uint8_t*)frame_view.argb32_data_,
@@ -105,6 +184,7 @@ class Argb32BufferAdapter : public detail::BufferAdapter {
 
  private:
   RefPtr<Argb32ExternalVideoSource> video_source_;
+  I420BufferCache buffer_cache_;
   bool has_warned_ = false;
 };
 
@@ -162,6 +242,8 @@ void ExternalVideoTrackSource::StartCapture() {
   GetSourceImpl()->state_ = SourceState::kLive;
   pending_requests_.clear();
   capture_thread_->Start();
+  ThreadConfig::Apply(mrsThreadRole::kCapture, capture_thread_.get());
+  ThreadMonitor::Instance().Register(capture_thread_.get());
 
   // Schedule first frame request for 10ms from now
   int64_t now = rtc::TimeMillis();
@@ -172,6 +254,7 @@ Result ExternalVideoTrackSource::CompleteRequest(
     uint32_t request_id,
     int64_t timestamp_ms,
     const I420AVideoFrame& frame_view) {
+  MRS_TRACE_SCOPE("ExternalVideoTrackSource::CompleteRequest");
   // Validate pending request ID and retrieve frame timestamp
   int64_t timestamp_ms_original = -1;
   {
@@ -180,7 +263,11 @@ Result ExternalVideoTrackSource::CompleteRequest(
          ++it) {
       if (it->first == request_id) {
         timestamp_ms_original = it->second;
-        // Remove outdated requests, including current one
+        // Remove outdated requests, including current one. Outdated requests
+        // will never be completed, so count them as dropped frames.
+        ObjectMetrics::Add(metrics_.frames_dropped,
+                           static_cast<uint64_t>(
+                               std::distance(pending_requests_.begin(), it)));
         ++it;
         pending_requests_.erase(pending_requests_.begin(), it);
         break;
@@ -190,19 +277,34 @@ Result ExternalVideoTrackSource::CompleteRequest(
       return Result::kInvalidParameter;
     }
   }
+  ObjectMetrics::Add(metrics_.frames_in, 1);
 
   // Apply user override if any
   if (timestamp_ms != timestamp_ms_original) {
     timestamp_ms = timestamp_ms_original;
   }
 
-  // Create and dispatch the video frame
+  // Create and dispatch the video frame. The NTP capture time is propagated to
+  // the remote peer via the RTP timestamp and RTCP sender reports.
+  const int64_t convert_start_us = rtc::TimeMicros();
+  rtc::scoped_refptr<webrtc::VideoFrameBuffer> buffer;
+  {
+    MRS_TRACE_SCOPE("ExternalVideoTrackSource::FillBuffer");
+    buffer = adapter_->FillBuffer(frame_view);
+  }
+  ObjectMetrics::Add(metrics_.conversion_time_us,
+                     rtc::TimeMicros() - convert_start_us);
   webrtc::VideoFrame frame{
       webrtc::VideoFrame::Builder()
-          .set_video_frame_buffer(adapter_->FillBuffer(frame_view))
+          .set_video_frame_buffer(std::move(buffer))
           .set_timestamp_ms(timestamp_ms)
+          .set_ntp_time_ms(RtcTimeToNtpMs(timestamp_ms))
           .build()};
-  GetSourceImpl()->DispatchFrame(frame);
+  {
+    MRS_ALLOC_SCOPE("ExternalVideoTrackSource::DispatchFrame");
+    GetSourceImpl()->DispatchFrame(frame);
+  }
+  ObjectMetrics::Add(metrics_.frames_out, 1);
   return Result::kSuccess;
 }
 
@@ -210,6 +312,7 @@ Result ExternalVideoTrackSource::CompleteRequest(
     uint32_t request_id,
     int64_t timestamp_ms,
     const Argb32VideoFrame& frame_view) {
+  MRS_TRACE_SCOPE("ExternalVideoTrackSource::CompleteRequest");
   // Validate pending request ID and retrieve frame timestamp
   int64_t timestamp_ms_original = -1;
   {
@@ -218,7 +321,11 @@ Result ExternalVideoTrackSource::CompleteRequest(
          ++it) {
       if (it->first == request_id) {
         timestamp_ms_original = it->second;
-        // Remove outdated requests, including current one
+        // Remove outdated requests, including current one. Outdated requests
+        // will never be completed, so count them as dropped frames.
+        ObjectMetrics::Add(metrics_.frames_dropped,
+                           static_cast<uint64_t>(
+                               std::distance(pending_requests_.begin(), it)));
         ++it;
         pending_requests_.erase(pending_requests_.begin(), it);
         break;
@@ -228,19 +335,34 @@ Result ExternalVideoTrackSource::CompleteRequest(
       return Result::kInvalidParameter;
     }
   }
+  ObjectMetrics::Add(metrics_.frames_in, 1);
 
   // Apply user override if any
   if (timestamp_ms != timestamp_ms_original) {
     timestamp_ms = timestamp_ms_original;
   }
 
-  // Create and dispatch the video frame
+  // Create and dispatch the video frame. The NTP capture time is propagated to
+  // the remote peer via the RTP timestamp and RTCP sender reports.
+  const int64_t convert_start_us = rtc::TimeMicros();
+  rtc::scoped_refptr<webrtc::VideoFrameBuffer> buffer;
+  {
+    MRS_TRACE_SCOPE("ExternalVideoTrackSource::FillBuffer");
+    buffer = adapter_->FillBuffer(frame_view);
+  }
+  ObjectMetrics::Add(metrics_.conversion_time_us,
+                     rtc::TimeMicros() - convert_start_us);
   webrtc::VideoFrame frame{
       webrtc::VideoFrame::Builder()
-          .set_video_frame_buffer(adapter_->FillBuffer(frame_view))
+          .set_video_frame_buffer(std::move(buffer))
           .set_timestamp_ms(timestamp_ms)
+          .set_ntp_time_ms(RtcTimeToNtpMs(timestamp_ms))
           .build()};
-  GetSourceImpl()->DispatchFrame(frame);
+  {
+    MRS_ALLOC_SCOPE("ExternalVideoTrackSource::DispatchFrame");
+    GetSourceImpl()->DispatchFrame(frame);
+  }
+  ObjectMetrics::Add(metrics_.frames_out, 1);
   return Result::kSuccess;
 }
 
@@ -249,6 +371,7 @@ void ExternalVideoTrackSource::StopCapture() {
   if (src->state_ != SourceState::kEnded) {
     RTC_LOG(LS_INFO) << "Stopping capture for external video track source "
                      << GetName().c_str();
+    ThreadMonitor::Instance().Unregister(capture_thread_.get());
     capture_thread_->Stop();
     src->state_ = SourceState::kEnded;
   }
@@ -276,6 +399,7 @@ void ExternalVideoTrackSource::OnMessage(rtc::Message* message) {
         // more. The queue is still useful for just-in-time or short delays.
         if (pending_requests_.size() >= kMaxPendingRequestCount) {
           pending_requests_.erase(pending_requests_.begin());
+          ObjectMetrics::Add(metrics_.frames_dropped, 1);
         }
         request_id = next_request_id_++;
         pending_requests_.emplace_back(request_id, now);
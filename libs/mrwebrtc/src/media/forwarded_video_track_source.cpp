@@ -0,0 +1,278 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+// This is a precompiled header, it must be on its own, followed by a blank
+// line, to prevent clang-format from reordering it with other headers.
+#include "pch.h"
+
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "common_video/h264/h264_common.h"
+
+#include "interop/global_factory.h"
+#include "media/forwarded_video_track_source.h"
+#include "media/remote_video_track.h"
+
+namespace {
+
+using namespace Microsoft::MixedReality::WebRTC;
+
+/// Process-wide registry of the forwarded video track sources and of the
+/// encoded frame buffers alive.
+struct ForwardingRegistry {
+  static ForwardingRegistry& Instance() {
+    // Intentionally leaked, since frames can be released during static
+    // destruction.
+    static ForwardingRegistry* const instance = new ForwardingRegistry();
+    return *instance;
+  }
+
+  /// Lock for |sources_|, held while dispatching frames so that a source is
+  /// not destroyed while forwarding a frame.
+  std::mutex sources_mutex_;
+  std::unordered_multimap<ReceiveStreamKey,
+                          ForwardedVideoTrackSource*,
+                          ReceiveStreamKeyHash>
+      sources_;
+
+  std::mutex buffers_mutex_;
+  std::unordered_set<const webrtc::VideoFrameBuffer*> buffers_;
+};
+
+/// Get the temporal layer of an encoded frame, or -1 if unknown.
+int GetTemporalLayer(webrtc::VideoCodecType codec_type,
+                     const webrtc::CodecSpecificInfo* codec_specific_info) {
+  if (!codec_specific_info) {
+    return -1;
+  }
+  uint8_t temporal_idx = webrtc::kNoTemporalIdx;
+  switch (codec_type) {
+    case webrtc::kVideoCodecVP8:
+      temporal_idx = codec_specific_info->codecSpecific.VP8.temporalIdx;
+      break;
+    case webrtc::kVideoCodecVP9:
+      temporal_idx = codec_specific_info->codecSpecific.VP9.temporal_idx;
+      break;
+    default:
+      break;
+  }
+  return (temporal_idx != webrtc::kNoTemporalIdx ? temporal_idx : -1);
+}
+
+}  // namespace
+
+namespace Microsoft {
+namespace MixedReality {
+namespace WebRTC {
+
+namespace detail {
+
+EncodedFrameBuffer::EncodedFrameBuffer(
+    std::shared_ptr<ForwardingState> state,
+    webrtc::VideoCodecType codec_type,
+    const webrtc::EncodedImage& image,
+    const webrtc::CodecSpecificInfo* codec_specific_info,
+    int width,
+    int height,
+    int64_t seq)
+    : state_(std::move(state)),
+      codec_type_(codec_type),
+      data_(image._buffer, image._buffer + image._length),
+      image_(image),
+      width_(width),
+      height_(height),
+      seq_(seq) {
+  image_._buffer = data_.data();
+  image_._size = data_.size();
+  if (codec_specific_info) {
+    has_codec_specific_info_ = true;
+    codec_specific_info_ = *codec_specific_info;
+  }
+  // The H.264 packetizer needs the NAL units, which the receiver reassembled
+  // with start codes.
+  if (codec_type_ == webrtc::kVideoCodecH264) {
+    const std::vector<webrtc::H264::NaluIndex> nalus =
+        webrtc::H264::FindNaluIndices(data_.data(), data_.size());
+    fragmentation_ = std::make_unique<webrtc::RTPFragmentationHeader>();
+    fragmentation_->VerifyAndAllocateFragmentationHeader(nalus.size());
+    for (size_t i = 0; i < nalus.size(); ++i) {
+      fragmentation_->fragmentationOffset[i] = nalus[i].payload_start_offset;
+      fragmentation_->fragmentationLength[i] = nalus[i].payload_size;
+    }
+  }
+  ForwardingRegistry& registry = ForwardingRegistry::Instance();
+  std::lock_guard<std::mutex> lock(registry.buffers_mutex_);
+  registry.buffers_.insert(this);
+}
+
+EncodedFrameBuffer::~EncodedFrameBuffer() {
+  ForwardingRegistry& registry = ForwardingRegistry::Instance();
+  std::lock_guard<std::mutex> lock(registry.buffers_mutex_);
+  registry.buffers_.erase(this);
+}
+
+EncodedFrameBuffer* EncodedFrameBuffer::FromBuffer(
+    webrtc::VideoFrameBuffer* buffer) {
+  // Other native buffers, like Android textures, cannot be told apart without
+  // RTTI, so look the buffer up among the live encoded frame buffers.
+  if (!buffer || (buffer->type() != Type::kNative)) {
+    return nullptr;
+  }
+  ForwardingRegistry& registry = ForwardingRegistry::Instance();
+  std::lock_guard<std::mutex> lock(registry.buffers_mutex_);
+  if (registry.buffers_.find(buffer) == registry.buffers_.end()) {
+    return nullptr;
+  }
+  return static_cast<EncodedFrameBuffer*>(buffer);
+}
+
+rtc::scoped_refptr<webrtc::I420BufferInterface> EncodedFrameBuffer::ToI420() {
+  rtc::scoped_refptr<webrtc::I420Buffer> buffer =
+      webrtc::I420Buffer::Create(width_, height_);
+  webrtc::I420Buffer::SetBlack(buffer.get());
+  return buffer;
+}
+
+webrtc::EncodedImage EncodedFrameBuffer::GetEncodedImage() const {
+  webrtc::EncodedImage image = image_;
+  // The image only references the data, which is never written to
+  image._buffer = const_cast<uint8_t*>(data_.data());
+  return image;
+}
+
+}  // namespace detail
+
+RefPtr<ForwardedVideoTrackSource> ForwardedVideoTrackSource::create(
+    RefPtr<GlobalFactory> global_factory,
+    RemoteVideoTrack& track,
+    const mrsVideoForwardingConfig& config) noexcept {
+  // The decoder of the track is created for the SDP stream of its receiver
+  ReceiveStreamKey key = track.GetReceiveStreamKey();
+  if (key.empty()) {
+    RTC_LOG(LS_ERROR) << "Cannot forward remote video track '"
+                      << track.GetName()
+                      << "' removed from its peer connection.";
+    return nullptr;
+  }
+  auto source = new ForwardedVideoTrackSource(
+      std::move(global_factory),
+      new rtc::RefCountedObject<detail::CustomTrackSourceAdapter>(), key,
+      config);
+  ForwardingRegistry& registry = ForwardingRegistry::Instance();
+  {
+    std::lock_guard<std::mutex> lock(registry.sources_mutex_);
+    registry.sources_.emplace(std::move(key), source);
+  }
+  return source;
+}
+
+ForwardedVideoTrackSource::ForwardedVideoTrackSource(
+    RefPtr<GlobalFactory> global_factory,
+    rtc::scoped_refptr<detail::CustomTrackSourceAdapter> source,
+    ReceiveStreamKey key,
+    const mrsVideoForwardingConfig& config) noexcept
+    : VideoTrackSource(std::move(global_factory),
+                       ObjectType::kForwardedVideoTrackSource,
+                       source),
+      key_(std::move(key)),
+      decode_locally_(config.decode_locally != mrsBool::kFalse),
+      max_temporal_layer_(config.max_temporal_layer),
+      state_(std::make_shared<detail::ForwardingState>()) {
+  source->state_ = webrtc::MediaSourceInterface::kLive;
+}
+
+ForwardedVideoTrackSource::~ForwardedVideoTrackSource() {
+  ForwardingRegistry& registry = ForwardingRegistry::Instance();
+  std::lock_guard<std::mutex> lock(registry.sources_mutex_);
+  auto range = registry.sources_.equal_range(key_);
+  for (auto it = range.first; it != range.second; ++it) {
+    if (it->second == this) {
+      registry.sources_.erase(it);
+      break;
+    }
+  }
+  GetSourceImpl()->state_ = webrtc::MediaSourceInterface::kEnded;
+}
+
+void ForwardedVideoTrackSource::GetStats(
+    mrsVideoForwardingStats& stats) const noexcept {
+  stats.frames_received =
+      state_->frames_received.load(std::memory_order_relaxed);
+  stats.frames_sent = state_->frames_sent.load(std::memory_order_relaxed);
+  stats.frames_dropped = state_->frames_dropped.load(std::memory_order_relaxed);
+  stats.key_frame_requests =
+      state_->key_frame_requests.load(std::memory_order_relaxed);
+}
+
+ForwardedVideoTrackSource::DispatchResult ForwardedVideoTrackSource::Dispatch(
+    const ReceiveStreamKey& key,
+    webrtc::VideoCodecType codec_type,
+    const webrtc::EncodedImage& image,
+    const webrtc::CodecSpecificInfo* codec_specific_info) noexcept {
+  DispatchResult result;
+  if (key.empty()) {
+    return result;
+  }
+  ForwardingRegistry& registry = ForwardingRegistry::Instance();
+  std::lock_guard<std::mutex> lock(registry.sources_mutex_);
+  auto range = registry.sources_.equal_range(key);
+  if (range.first == range.second) {
+    return result;
+  }
+  result.forwarded = true;
+  result.decode = false;
+  for (auto it = range.first; it != range.second; ++it) {
+    ForwardedVideoTrackSource* const source = it->second;
+    // Consume the request now, since the next frame is the earliest the remote
+    // sender can produce a key frame for.
+    if (source->state_->key_frame_requested.exchange(
+            false, std::memory_order_relaxed)) {
+      result.key_frame_requested = true;
+    }
+    result.decode |= source->decode_locally_;
+    source->OnEncodedFrame(codec_type, image, codec_specific_info);
+  }
+  return result;
+}
+
+void ForwardedVideoTrackSource::OnEncodedFrame(
+    webrtc::VideoCodecType codec_type,
+    const webrtc::EncodedImage& image,
+    const webrtc::CodecSpecificInfo* codec_specific_info) {
+  state_->frames_received.fetch_add(1, std::memory_order_relaxed);
+
+  // Frames of the upper temporal layers are not referenced by the lower ones,
+  // so can be dropped without breaking the stream.
+  const int32_t max_temporal_layer =
+      max_temporal_layer_.load(std::memory_order_relaxed);
+  if ((max_temporal_layer >= 0) &&
+      (GetTemporalLayer(codec_type, codec_specific_info) >
+       max_temporal_layer)) {
+    state_->frames_dropped.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  // Only key frames carry the resolution of the stream
+  if ((image._encodedWidth > 0) && (image._encodedHeight > 0)) {
+    width_ = static_cast<int>(image._encodedWidth);
+    height_ = static_cast<int>(image._encodedHeight);
+  }
+  if ((width_ <= 0) || (height_ <= 0)) {
+    state_->frames_dropped.fetch_add(1, std::memory_order_relaxed);
+    state_->RequestKeyFrame();
+    return;
+  }
+
+  rtc::scoped_refptr<webrtc::VideoFrameBuffer> buffer(
+      new rtc::RefCountedObject<detail::EncodedFrameBuffer>(
+          state_, codec_type, image, codec_specific_info, width_, height_,
+          next_seq_++));
+  webrtc::VideoFrame frame(buffer, image.rotation_, rtc::TimeMicros());
+  GetSourceImpl()->DispatchFrame(frame);
+}
+
+}  // namespace WebRTC
+}  // namespace MixedReality
+}  // namespace Microsoft
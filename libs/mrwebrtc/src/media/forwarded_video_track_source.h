@@ -0,0 +1,209 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "callback.h"
+#include "external_video_track_source.h"
+#include "media/receive_stream_key.h"
+#include "mrs_errors.h"
+#include "refptr.h"
+#include "video_forwarding_interop.h"
+#include "video_track_source.h"
+
+#include "modules/include/module_common_types.h"
+#include "modules/video_coding/include/video_codec_interface.h"
+
+namespace Microsoft {
+namespace MixedReality {
+namespace WebRTC {
+
+class RemoteVideoTrack;
+
+namespace detail {
+
+/// State of a video track source of encoded frames shared with the frames in
+/// flight, which can outlive the source.
+struct ForwardingState {
+  /// Key frame requested by a video sender, and not produced yet by the source.
+  std::atomic_bool key_frame_requested{false};
+
+  std::atomic<uint64_t> frames_received{0};
+  std::atomic<uint64_t> frames_sent{0};
+  std::atomic<uint64_t> frames_dropped{0};
+  std::atomic<uint64_t> key_frame_requests{0};
+
+  /// Lock for |key_frame_requested_callback|, held while invoking it so that
+  /// the source can safely clear it.
+  std::mutex callback_mutex;
+
+  /// Optional callback invoked when a key frame is newly requested.
+  Callback<> key_frame_requested_callback;
+
+  /// Request a key frame from the source. Requests are aggregated until the
+  /// source clears |key_frame_requested|. This is multithread-safe.
+  void RequestKeyFrame() noexcept {
+    if (!key_frame_requested.exchange(true, std::memory_order_relaxed)) {
+      key_frame_requests.fetch_add(1, std::memory_order_relaxed);
+      std::lock_guard<std::mutex> lock(callback_mutex);
+      key_frame_requested_callback();
+    }
+  }
+};
+
+/// Native video frame buffer carrying an encoded frame from a remote video
+/// track to the video senders of a forwarded video track source. The encoders
+/// created by |ForwardingVideoEncoderFactory| send the encoded frame as is,
+/// instead of encoding the buffer.
+class EncodedFrameBuffer : public webrtc::VideoFrameBuffer {
+ public:
+  EncodedFrameBuffer(std::shared_ptr<ForwardingState> state,
+                     webrtc::VideoCodecType codec_type,
+                     const webrtc::EncodedImage& image,
+                     const webrtc::CodecSpecificInfo* codec_specific_info,
+                     int width,
+                     int height,
+                     int64_t seq);
+  ~EncodedFrameBuffer() override;
+
+  /// Get the encoded frame carried by a video frame buffer, or NULL if the
+  /// buffer is not an encoded frame buffer. This is multithread-safe.
+  static EncodedFrameBuffer* FromBuffer(webrtc::VideoFrameBuffer* buffer);
+
+  //
+  // VideoFrameBuffer interface
+  //
+
+  Type type() const override { return Type::kNative; }
+  int width() const override { return width_; }
+  int height() const override { return height_; }
+
+  /// Convert to a black frame, for the encoders which do not support encoded
+  /// frames.
+  rtc::scoped_refptr<webrtc::I420BufferInterface> ToI420() override;
+
+  /// Get an encoded image referencing the data of this buffer, which must
+  /// outlive it.
+  webrtc::EncodedImage GetEncodedImage() const;
+
+  webrtc::VideoCodecType codec_type() const { return codec_type_; }
+  const webrtc::CodecSpecificInfo* codec_specific_info() const {
+    return (has_codec_specific_info_ ? &codec_specific_info_ : nullptr);
+  }
+  const webrtc::RTPFragmentationHeader* fragmentation() const {
+    return fragmentation_.get();
+  }
+
+  /// Sequence number of the frame in the forwarded stream, without gap unless
+  /// the frame before was lost.
+  int64_t seq() const { return seq_; }
+  bool is_key_frame() const {
+    return (image_._frameType == webrtc::kVideoFrameKey);
+  }
+  ForwardingState& state() const { return *state_; }
+
+ private:
+  const std::shared_ptr<ForwardingState> state_;
+  const webrtc::VideoCodecType codec_type_;
+  std::vector<uint8_t> data_;
+  webrtc::EncodedImage image_;
+  bool has_codec_specific_info_{false};
+  webrtc::CodecSpecificInfo codec_specific_info_;
+  std::unique_ptr<webrtc::RTPFragmentationHeader> fragmentation_;
+  const int width_;
+  const int height_;
+  const int64_t seq_;
+};
+
+}  // namespace detail
+
+/// Video track source forwarding the encoded frames of a remote video track to
+/// the video senders of its local video tracks, without decoding nor encoding
+/// them.
+///
+/// The decoders created by |ForwardingVideoDecoderFactory| dispatch the
+/// encoded frames received to the sources registered for their receive stream.
+/// The source wraps each encoded frame into a native frame buffer, which goes
+/// through the regular video track pipeline down to the encoders created by
+/// |ForwardingVideoEncoderFactory|, which send it as is.
+class ForwardedVideoTrackSource : public VideoTrackSource {
+ public:
+  /// Result of dispatching an encoded frame to the forwarding sources.
+  struct DispatchResult {
+    /// Whether any source forwarded the frame.
+    bool forwarded{false};
+
+    /// Whether the frame still needs to be decoded.
+    bool decode{true};
+
+    /// Whether a key frame was requested by any forwarding sender.
+    bool key_frame_requested{false};
+  };
+
+  /// Create a source forwarding the frames of a remote video track.
+  static RefPtr<ForwardedVideoTrackSource> create(
+      RefPtr<GlobalFactory> global_factory,
+      RemoteVideoTrack& track,
+      const mrsVideoForwardingConfig& config) noexcept;
+
+  ~ForwardedVideoTrackSource() override;
+
+  /// Change the highest temporal layer forwarded, or forward all layers if
+  /// negative.
+  void SetMaxTemporalLayer(int32_t max_temporal_layer) noexcept {
+    max_temporal_layer_.store(max_temporal_layer, std::memory_order_relaxed);
+  }
+
+  void GetStats(mrsVideoForwardingStats& stats) const noexcept;
+
+  /// Dispatch an encoded frame received on a stream to all the sources
+  /// forwarding that stream. Called from the decoder thread of the stream.
+  static DispatchResult Dispatch(
+      const ReceiveStreamKey& key,
+      webrtc::VideoCodecType codec_type,
+      const webrtc::EncodedImage& image,
+      const webrtc::CodecSpecificInfo* codec_specific_info) noexcept;
+
+ protected:
+  ForwardedVideoTrackSource(
+      RefPtr<GlobalFactory> global_factory,
+      rtc::scoped_refptr<detail::CustomTrackSourceAdapter> source,
+      ReceiveStreamKey key,
+      const mrsVideoForwardingConfig& config) noexcept;
+
+  detail::CustomTrackSourceAdapter* GetSourceImpl() const {
+    return (detail::CustomTrackSourceAdapter*)source_.get();
+  }
+
+  /// Forward an encoded frame to the local video tracks. Called under the
+  /// lock of the registry of sources.
+  void OnEncodedFrame(webrtc::VideoCodecType codec_type,
+                      const webrtc::EncodedImage& image,
+                      const webrtc::CodecSpecificInfo* codec_specific_info);
+
+  /// Receive stream the source is registered for.
+  const ReceiveStreamKey key_;
+
+  const bool decode_locally_;
+  std::atomic<int32_t> max_temporal_layer_;
+  const std::shared_ptr<detail::ForwardingState> state_;
+
+  /// Resolution of the stream, known from the last key frame. Only accessed
+  /// under the lock of the registry of sources.
+  int width_{0};
+  int height_{0};
+
+  /// Sequence number of the next frame forwarded. Only accessed under the lock
+  /// of the registry of sources.
+  int64_t next_seq_{0};
+};
+
+}  // namespace WebRTC
+}  // namespace MixedReality
+}  // namespace Microsoft
@@ -0,0 +1,367 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+// This is a precompiled header, it must be on its own, followed by a blank
+// line, to prevent clang-format from reordering it with other headers.
+#include "pch.h"
+
+#include <algorithm>
+
+#include "media/forwarded_video_track_source.h"
+#include "media/forwarding_codec_factory.h"
+#include "media/key_frame_track_source.h"
+#include "media/remote_video_track.h"
+
+namespace {
+
+using namespace Microsoft::MixedReality::WebRTC;
+
+/// Encoder sending the encoded frames of a forwarded or encoded video track
+/// source as is, and encoding raw frames with the wrapped encoder. The wrapped
+/// encoder is initialized like for any other sender, since the source of the
+/// frames is not known yet, and released once encoded frames are sent so that
+/// senders of encoded frames only do not keep running an encoder.
+class ForwardingVideoEncoder : public webrtc::VideoEncoder {
+ public:
+  explicit ForwardingVideoEncoder(std::unique_ptr<webrtc::VideoEncoder> encoder)
+      : encoder_(std::move(encoder)) {}
+
+  int32_t InitEncode(const webrtc::VideoCodec* codec_settings,
+                     int32_t number_of_cores,
+                     size_t max_payload_size) override {
+    if (!codec_settings) {
+      return WEBRTC_VIDEO_CODEC_ERR_PARAMETER;
+    }
+    int32_t ret = ReleaseEncoder();
+    if (ret != WEBRTC_VIDEO_CODEC_OK) {
+      return ret;
+    }
+    settings_ = *codec_settings;
+    number_of_cores_ = number_of_cores;
+    max_payload_size_ = max_payload_size;
+    // The receivers need a key frame to start decoding
+    last_seq_ = -1;
+    // Report initialization errors, on which the caller can fall back to
+    // another encoder, and make the scaling settings of the encoder valid.
+    return InitEncoder();
+  }
+
+  int32_t RegisterEncodeCompleteCallback(
+      webrtc::EncodedImageCallback* callback) override {
+    callback_ = callback;
+    return encoder_->RegisterEncodeCompleteCallback(callback);
+  }
+
+  int32_t Release() override { return ReleaseEncoder(); }
+
+  int32_t Encode(const webrtc::VideoFrame& frame,
+                 const webrtc::CodecSpecificInfo* codec_specific_info,
+                 const std::vector<webrtc::FrameType>* frame_types) override {
+    rtc::scoped_refptr<webrtc::VideoFrameBuffer> buffer =
+        frame.video_frame_buffer();
+
+    // Key frames forced on demand by the application on the local track,
+    // whose frames are tagged until this encoder takes the request.
+    std::vector<webrtc::FrameType> forced_frame_types;
+    if (KeyFrameTrackSource::TakeForcedKeyFrame(buffer)) {
+      forced_frame_types.assign(
+          std::max<size_t>(frame_types ? frame_types->size() : 0, 1),
+          webrtc::kVideoFrameKey);
+      frame_types = &forced_frame_types;
+    }
+    if (detail::EncodedFrameBuffer* const encoded =
+            detail::EncodedFrameBuffer::FromBuffer(buffer.get())) {
+      // Initialized again if raw frames follow
+      ReleaseEncoder();
+      return SendEncodedFrame(*encoded, frame, frame_types);
+    }
+    if (!encoder_initialized_) {
+      const int32_t ret = InitEncoder();
+      if (ret != WEBRTC_VIDEO_CODEC_OK) {
+        return ret;
+      }
+    }
+    // This encoder claims to support native buffers for the encoded frames,
+    // so convert the other native buffers if the wrapped encoder does not.
+    if ((buffer->type() == webrtc::VideoFrameBuffer::Type::kNative) &&
+        !encoder_->SupportsNativeHandle()) {
+      buffer = buffer->ToI420();
+    }
+    if (buffer != frame.video_frame_buffer()) {
+      // Keep the exact capture time, which the shared video encoders use to
+      // match the frames of the senders of a same source.
+      webrtc::VideoFrame converted(buffer, frame.rotation(),
+                                   frame.timestamp_us());
+      converted.set_timestamp(frame.timestamp());
+      converted.set_ntp_time_ms(frame.ntp_time_ms());
+      return encoder_->Encode(converted, codec_specific_info, frame_types);
+    }
+    return encoder_->Encode(frame, codec_specific_info, frame_types);
+  }
+
+  int32_t SetChannelParameters(uint32_t packet_loss, int64_t rtt) override {
+    packet_loss_ = packet_loss;
+    rtt_ = rtt;
+    if (!encoder_initialized_) {
+      return WEBRTC_VIDEO_CODEC_OK;
+    }
+    return encoder_->SetChannelParameters(packet_loss, rtt);
+  }
+
+  int32_t SetRateAllocation(const webrtc::VideoBitrateAllocation& allocation,
+                            uint32_t framerate) override {
+    allocation_ = allocation;
+    framerate_ = framerate;
+    if (!encoder_initialized_) {
+      return WEBRTC_VIDEO_CODEC_OK;
+    }
+    return encoder_->SetRateAllocation(allocation, framerate);
+  }
+
+  ScalingSettings GetScalingSettings() const override {
+    return encoder_->GetScalingSettings();
+  }
+
+  bool SupportsNativeHandle() const override { return true; }
+
+  const char* ImplementationName() const override {
+    return encoder_->ImplementationName();
+  }
+
+ private:
+  /// Initialize the wrapped encoder with the last settings and rates.
+  int32_t InitEncoder() {
+    int32_t ret =
+        encoder_->InitEncode(&settings_, number_of_cores_, max_payload_size_);
+    if (ret != WEBRTC_VIDEO_CODEC_OK) {
+      return ret;
+    }
+    encoder_initialized_ = true;
+    encoder_->SetChannelParameters(packet_loss_, rtt_);
+    if (allocation_.get_sum_bps() > 0) {
+      encoder_->SetRateAllocation(allocation_, framerate_);
+    }
+    return WEBRTC_VIDEO_CODEC_OK;
+  }
+
+  int32_t ReleaseEncoder() {
+    if (!encoder_initialized_) {
+      return WEBRTC_VIDEO_CODEC_OK;
+    }
+    encoder_initialized_ = false;
+    return encoder_->Release();
+  }
+
+  /// Send an encoded frame as is, unless the receivers cannot decode it.
+  int32_t SendEncodedFrame(detail::EncodedFrameBuffer& encoded,
+                           const webrtc::VideoFrame& frame,
+                           const std::vector<webrtc::FrameType>* frame_types) {
+    detail::ForwardingState& state = encoded.state();
+    if (!encoded.is_key_frame() && frame_types &&
+        (std::find(frame_types->begin(), frame_types->end(),
+                   webrtc::kVideoFrameKey) != frame_types->end())) {
+      state.RequestKeyFrame();
+    }
+    if (encoded.codec_type() != settings_.codecType) {
+      if (!codec_mismatch_logged_) {
+        RTC_LOG(LS_WARNING) << "Cannot forward encoded frames of codec type "
+                            << encoded.codec_type()
+                            << " to a sender negotiated for codec type "
+                            << settings_.codecType << ".";
+        codec_mismatch_logged_ = true;
+      }
+      return WEBRTC_VIDEO_CODEC_OK;
+    }
+    // After a frame was skipped, for example dropped before reaching the
+    // encoder, delta frames cannot be decoded until the next key frame.
+    if (!encoded.is_key_frame() &&
+        ((last_seq_ < 0) || (encoded.seq() != last_seq_ + 1))) {
+      state.RequestKeyFrame();
+      return WEBRTC_VIDEO_CODEC_OK;
+    }
+    if (!callback_) {
+      return WEBRTC_VIDEO_CODEC_UNINITIALIZED;
+    }
+    last_seq_ = encoded.seq();
+
+    // Stamp the image like an encoder would, so that the sender packetizes it
+    // with its own timestamps.
+    webrtc::EncodedImage image = encoded.GetEncodedImage();
+    image.SetTimestamp(frame.timestamp());
+    image.capture_time_ms_ = frame.render_time_ms();
+    webrtc::CodecSpecificInfo info;
+    if (const webrtc::CodecSpecificInfo* received =
+            encoded.codec_specific_info()) {
+      info = *received;
+    }
+    info.codecType = settings_.codecType;
+    if (settings_.codecType == webrtc::kVideoCodecH264) {
+      info.codecSpecific.H264.packetization_mode =
+          settings_.H264().packetizationMode;
+    }
+    callback_->OnEncodedImage(image, &info, encoded.fragmentation());
+    state.frames_sent.fetch_add(1, std::memory_order_relaxed);
+    return WEBRTC_VIDEO_CODEC_OK;
+  }
+
+  std::unique_ptr<webrtc::VideoEncoder> encoder_;
+  bool encoder_initialized_{false};
+
+  /// Last settings and rates, applied to the wrapped encoder when initialized.
+  webrtc::VideoCodec settings_{};
+  int32_t number_of_cores_{1};
+  size_t max_payload_size_{0};
+  uint32_t packet_loss_{0};
+  int64_t rtt_{0};
+  webrtc::VideoBitrateAllocation allocation_;
+  uint32_t framerate_{0};
+
+  webrtc::EncodedImageCallback* callback_{nullptr};
+
+  /// Sequence number of the last encoded frame sent, or -1 if none.
+  int64_t last_seq_{-1};
+
+  bool codec_mismatch_logged_{false};
+};
+
+/// Minimum interval between two key frame requests sent by a decoder, in
+/// milliseconds.
+constexpr int64_t kKeyFrameRequestIntervalMs = 500;
+
+/// Decoder dispatching the encoded frames of a receive stream to the forwarded
+/// video track sources and the encoded frame callbacks registered for it, and
+/// decoding them only if needed.
+class ForwardingVideoDecoder : public webrtc::VideoDecoder {
+ public:
+  ForwardingVideoDecoder(std::unique_ptr<webrtc::VideoDecoder> decoder,
+                         ReceiveStreamKey key)
+      : decoder_(std::move(decoder)), key_(std::move(key)) {}
+
+  int32_t InitDecode(const webrtc::VideoCodec* codec_settings,
+                     int32_t number_of_cores) override {
+    if (codec_settings) {
+      codec_type_ = codec_settings->codecType;
+    }
+    return decoder_->InitDecode(codec_settings, number_of_cores);
+  }
+
+  int32_t Decode(const webrtc::EncodedImage& input_image,
+                 bool missing_frames,
+                 const webrtc::CodecSpecificInfo* codec_specific_info,
+                 int64_t render_time_ms) override {
+    const ForwardedVideoTrackSource::DispatchResult result =
+        ForwardedVideoTrackSource::Dispatch(key_, codec_type_, input_image,
+                                            codec_specific_info);
+    bool key_frame_requested = result.key_frame_requested;
+    bool decode = RemoteVideoTrack::DispatchEncodedFrame(key_, codec_type_,
+                                                         input_image) &&
+                  result.decode;
+    const bool is_key_frame =
+        (input_image._frameType == webrtc::kVideoFrameKey);
+
+    // Key frames requested on demand by the application
+    bool need_key_frame =
+        RemoteVideoTrack::ProcessKeyFrameRequest(key_, is_key_frame);
+
+    // Once frames were skipped, decoding can only resume on a key frame
+    if (decode && skipped_frames_) {
+      if (is_key_frame) {
+        skipped_frames_ = false;
+      } else {
+        decode = false;
+        need_key_frame = true;
+      }
+    }
+    if (need_key_frame) {
+      const int64_t now_ms = rtc::TimeMillis();
+      if (now_ms - last_key_frame_request_ms_ >= kKeyFrameRequestIntervalMs) {
+        last_key_frame_request_ms_ = now_ms;
+        key_frame_requested = true;
+      }
+    }
+
+    int32_t ret = WEBRTC_VIDEO_CODEC_OK;
+    if (decode) {
+      ret = decoder_->Decode(input_image, missing_frames, codec_specific_info,
+                             render_time_ms);
+    } else {
+      skipped_frames_ = true;
+    }
+    // Relay the key frame requests to the remote sender, the same way a
+    // decoder asks for a key frame.
+    if (key_frame_requested && (ret == WEBRTC_VIDEO_CODEC_OK)) {
+      ret = WEBRTC_VIDEO_CODEC_OK_REQUEST_KEYFRAME;
+    }
+    return ret;
+  }
+
+  int32_t RegisterDecodeCompleteCallback(
+      webrtc::DecodedImageCallback* callback) override {
+    return decoder_->RegisterDecodeCompleteCallback(callback);
+  }
+
+  int32_t Release() override { return decoder_->Release(); }
+
+  bool PrefersLateDecoding() const override {
+    return decoder_->PrefersLateDecoding();
+  }
+
+  const char* ImplementationName() const override {
+    return decoder_->ImplementationName();
+  }
+
+ private:
+  std::unique_ptr<webrtc::VideoDecoder> decoder_;
+  const ReceiveStreamKey key_;
+  webrtc::VideoCodecType codec_type_{webrtc::kVideoCodecGeneric};
+
+  /// Whether some frames were not decoded since the last key frame decoded.
+  bool skipped_frames_{false};
+
+  /// Time of the last key frame request, to resume decoding or on demand.
+  int64_t last_key_frame_request_ms_{0};
+};
+
+}  // namespace
+
+namespace Microsoft {
+namespace MixedReality {
+namespace WebRTC {
+
+std::unique_ptr<webrtc::VideoEncoder>
+ForwardingVideoEncoderFactory::CreateVideoEncoder(
+    const webrtc::SdpVideoFormat& format) {
+  std::unique_ptr<webrtc::VideoEncoder> encoder =
+      factory_->CreateVideoEncoder(format);
+  if (!encoder) {
+    return nullptr;
+  }
+  return std::make_unique<ForwardingVideoEncoder>(std::move(encoder));
+}
+
+std::unique_ptr<webrtc::VideoDecoder>
+ForwardingVideoDecoderFactory::LegacyCreateVideoDecoder(
+    const webrtc::SdpVideoFormat& format,
+    const std::string& receive_stream_id) {
+  std::unique_ptr<webrtc::VideoDecoder> decoder =
+      factory_->CreateVideoDecoder(format);
+  if (!decoder || receive_stream_id.empty()) {
+    return decoder;
+  }
+  ReceiveStreamKey key{peer_id_.load(std::memory_order_relaxed),
+                       receive_stream_id};
+  if (key.empty()) {
+    // Without its peer connection the stream cannot be told apart from the
+    // streams of the same ID of the other peer connections.
+    RTC_LOG(LS_WARNING) << "Video decoder for stream '" << receive_stream_id
+                        << "' created outside of a session description; its "
+                           "encoded frames are not forwarded.";
+    return decoder;
+  }
+  return std::make_unique<ForwardingVideoDecoder>(std::move(decoder),
+                                                  std::move(key));
+}
+
+}  // namespace WebRTC
+}  // namespace MixedReality
+}  // namespace Microsoft
@@ -0,0 +1,101 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "api/video_codecs/video_decoder_factory.h"
+#include "api/video_codecs/video_encoder_factory.h"
+
+#include "media/receive_stream_key.h"
+
+namespace Microsoft {
+namespace MixedReality {
+namespace WebRTC {
+
+/// Video encoder factory wrapping the encoders of another factory, so that the
+/// encoded frames of a |ForwardedVideoTrackSource| or |EncodedVideoTrackSource|
+/// are sent as is instead of being encoded. Raw frames are encoded by the
+/// wrapped encoder as usual, which is only initialized for the first of them.
+/// The encoders also apply the key frames forced on the local video tracks.
+class ForwardingVideoEncoderFactory : public webrtc::VideoEncoderFactory {
+ public:
+  explicit ForwardingVideoEncoderFactory(
+      std::unique_ptr<webrtc::VideoEncoderFactory> factory) noexcept
+      : factory_(std::move(factory)) {}
+
+  //
+  // VideoEncoderFactory interface
+  //
+
+  std::vector<webrtc::SdpVideoFormat> GetSupportedFormats() const override {
+    return factory_->GetSupportedFormats();
+  }
+  CodecInfo QueryVideoEncoder(
+      const webrtc::SdpVideoFormat& format) const override {
+    return factory_->QueryVideoEncoder(format);
+  }
+  std::unique_ptr<webrtc::VideoEncoder> CreateVideoEncoder(
+      const webrtc::SdpVideoFormat& format) override;
+
+ private:
+  std::unique_ptr<webrtc::VideoEncoderFactory> factory_;
+};
+
+/// Video decoder factory wrapping the decoders of another factory, so that the
+/// encoded frames received are dispatched to the |ForwardedVideoTrackSource|
+/// and to the encoded frame callback of the |RemoteVideoTrack| registered for
+/// their stream, and are only decoded if needed.
+///
+/// A factory is shared by all the peer connections of a factory shard, and the
+/// decoders only know the SDP stream ID of their receiver. So each peer
+/// connection sets itself as the receive context of the factory while applying
+/// a session description, which is when the decoders are created; see
+/// |PeerConnection::InvokeWithReceiveContext()|.
+class ForwardingVideoDecoderFactory : public webrtc::VideoDecoderFactory {
+ public:
+  explicit ForwardingVideoDecoderFactory(
+      std::unique_ptr<webrtc::VideoDecoderFactory> factory) noexcept
+      : factory_(std::move(factory)) {}
+
+  //
+  // VideoDecoderFactory interface
+  //
+
+  std::vector<webrtc::SdpVideoFormat> GetSupportedFormats() const override {
+    return factory_->GetSupportedFormats();
+  }
+  std::unique_ptr<webrtc::VideoDecoder> CreateVideoDecoder(
+      const webrtc::SdpVideoFormat& format) override {
+    // Without a stream ID there is nothing to forward
+    return factory_->CreateVideoDecoder(format);
+  }
+
+  /// Create a decoder for a given receive stream. This is the only way in M71
+  /// to know which stream a decoder is created for, which WebRTC uses instead
+  /// of |CreateVideoDecoder()| when available.
+  std::unique_ptr<webrtc::VideoDecoder> LegacyCreateVideoDecoder(
+      const webrtc::SdpVideoFormat& format,
+      const std::string& receive_stream_id) override;
+
+  /// Set the unique ID of the peer connection the decoders created from now on
+  /// are for, or 0 to clear it. Called on the signaling thread of the shard,
+  /// which serializes the session descriptions of all its peer connections.
+  void SetReceiveContext(uint64_t peer_id) noexcept {
+    peer_id_.store(peer_id, std::memory_order_relaxed);
+  }
+
+ private:
+  std::unique_ptr<webrtc::VideoDecoderFactory> factory_;
+
+  /// Receive context set by |SetReceiveContext()|.
+  std::atomic<uint64_t> peer_id_{0};
+};
+
+}  // namespace WebRTC
+}  // namespace MixedReality
+}  // namespace Microsoft
@@ -0,0 +1,278 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+// This is a precompiled header, it must be on its own, followed by a blank
+// line, to prevent clang-format from reordering it with other headers.
+#include "pch.h"
+
+#include "media/forwarded_video_track_source.h"
+#include "media/key_frame_track_source.h"
+#include "stats_sampler.h"
+
+namespace {
+
+using namespace Microsoft::MixedReality::WebRTC;
+
+/// Buffer of a frame tagged for a forced key frame by the source of a track,
+/// wrapping the buffer of the frame without copying it.
+class ForcedKeyFrameBuffer : public webrtc::I420BufferInterface {
+ public:
+  ForcedKeyFrameBuffer(rtc::scoped_refptr<KeyFrameTrackSource> source,
+                       rtc::scoped_refptr<webrtc::I420BufferInterface> buffer);
+  ~ForcedKeyFrameBuffer() override;
+
+  KeyFrameTrackSource* source() const { return source_.get(); }
+  const rtc::scoped_refptr<webrtc::I420BufferInterface>& buffer() const {
+    return buffer_;
+  }
+
+  //
+  // I420BufferInterface
+  //
+
+  int width() const override { return buffer_->width(); }
+  int height() const override { return buffer_->height(); }
+  const uint8_t* DataY() const override { return buffer_->DataY(); }
+  const uint8_t* DataU() const override { return buffer_->DataU(); }
+  const uint8_t* DataV() const override { return buffer_->DataV(); }
+  int StrideY() const override { return buffer_->StrideY(); }
+  int StrideU() const override { return buffer_->StrideU(); }
+  int StrideV() const override { return buffer_->StrideV(); }
+
+ private:
+  const rtc::scoped_refptr<KeyFrameTrackSource> source_;
+  const rtc::scoped_refptr<webrtc::I420BufferInterface> buffer_;
+};
+
+/// Process-wide registry of the tagged frame buffers alive, which cannot be
+/// told apart from other buffers without RTTI.
+struct ForcedKeyFrameRegistry {
+  static ForcedKeyFrameRegistry& Instance() {
+    // Intentionally leaked, like the other process-wide registries.
+    static ForcedKeyFrameRegistry* const instance =
+        new ForcedKeyFrameRegistry();
+    return *instance;
+  }
+
+  std::mutex mutex_;
+  std::unordered_map<const webrtc::VideoFrameBuffer*, ForcedKeyFrameBuffer*>
+      buffers_;
+
+  /// Size of |buffers_|, read without the lock on each frame.
+  std::atomic<size_t> buffer_count_{0};
+};
+
+ForcedKeyFrameBuffer::ForcedKeyFrameBuffer(
+    rtc::scoped_refptr<KeyFrameTrackSource> source,
+    rtc::scoped_refptr<webrtc::I420BufferInterface> buffer)
+    : source_(std::move(source)), buffer_(std::move(buffer)) {
+  ForcedKeyFrameRegistry& registry = ForcedKeyFrameRegistry::Instance();
+  std::lock_guard<std::mutex> lock(registry.mutex_);
+  registry.buffers_.emplace(static_cast<const webrtc::VideoFrameBuffer*>(this),
+                            this);
+  registry.buffer_count_.store(registry.buffers_.size(),
+                               std::memory_order_relaxed);
+}
+
+ForcedKeyFrameBuffer::~ForcedKeyFrameBuffer() {
+  ForcedKeyFrameRegistry& registry = ForcedKeyFrameRegistry::Instance();
+  std::lock_guard<std::mutex> lock(registry.mutex_);
+  registry.buffers_.erase(static_cast<const webrtc::VideoFrameBuffer*>(this));
+  registry.buffer_count_.store(registry.buffers_.size(),
+                               std::memory_order_relaxed);
+}
+
+}  // namespace
+
+namespace Microsoft {
+namespace MixedReality {
+namespace WebRTC {
+
+/// Sink registered with the shared source in place of a sink of the track.
+class KeyFrameTrackSource::TrackSink
+    : public rtc::VideoSinkInterface<webrtc::VideoFrame> {
+ public:
+  TrackSink(KeyFrameTrackSource& owner,
+            rtc::VideoSinkInterface<webrtc::VideoFrame>* sink)
+      : owner_(owner), sink_(sink) {}
+
+  void OnFrame(const webrtc::VideoFrame& frame) override {
+    if (owner_.key_frame_forced_.load(std::memory_order_relaxed)) {
+      owner_.OnForcedFrame(*sink_, frame);
+    } else {
+      sink_->OnFrame(frame);
+    }
+  }
+
+  void OnDiscardedFrame() override { sink_->OnDiscardedFrame(); }
+
+ private:
+  KeyFrameTrackSource& owner_;
+  rtc::VideoSinkInterface<webrtc::VideoFrame>* const sink_;
+};
+
+rtc::scoped_refptr<KeyFrameTrackSource> KeyFrameTrackSource::Create(
+    rtc::scoped_refptr<webrtc::VideoTrackSourceInterface> source) noexcept {
+  return new rtc::RefCountedObject<KeyFrameTrackSource>(std::move(source));
+}
+
+KeyFrameTrackSource::KeyFrameTrackSource(
+    rtc::scoped_refptr<webrtc::VideoTrackSourceInterface> source) noexcept
+    : source_(std::move(source)) {
+  RTC_CHECK(source_);
+}
+
+KeyFrameTrackSource::~KeyFrameTrackSource() {
+  // The video track removes its sinks before releasing its source, so this is
+  // only a safety net.
+  for (auto&& pair : sinks_) {
+    source_->RemoveSink(pair.second.get());
+  }
+}
+
+void KeyFrameTrackSource::ForceKeyFrame(
+    std::shared_ptr<KeyFrameRequestStats> stats) noexcept {
+  std::lock_guard<std::mutex> lock(request_mutex_);
+  if (key_frame_forced_.load(std::memory_order_relaxed)) {
+    return;
+  }
+  requested_us_ = rtc::TimeMicros();
+  stats_ = std::move(stats);
+  if (stats_) {
+    stats_->OnRequested();
+  }
+  key_frame_forced_.store(true, std::memory_order_relaxed);
+}
+
+void KeyFrameTrackSource::CancelKeyFrame() noexcept {
+  std::lock_guard<std::mutex> lock(request_mutex_);
+  key_frame_forced_.store(false, std::memory_order_relaxed);
+  stats_.reset();
+}
+
+bool KeyFrameTrackSource::TakeForcedKeyFrame(
+    rtc::scoped_refptr<webrtc::VideoFrameBuffer>& buffer) noexcept {
+  ForcedKeyFrameRegistry& registry = ForcedKeyFrameRegistry::Instance();
+  if (registry.buffer_count_.load(std::memory_order_relaxed) == 0) {
+    return false;
+  }
+  rtc::scoped_refptr<KeyFrameTrackSource> source;
+  {
+    std::lock_guard<std::mutex> lock(registry.mutex_);
+    auto it = registry.buffers_.find(buffer.get());
+    if (it == registry.buffers_.end()) {
+      return false;
+    }
+    // The buffer is kept alive by the frame being encoded
+    source = it->second->source();
+    buffer = it->second->buffer();
+  }
+  // Several frames can be tagged before the first one is encoded
+  return source->CompleteKeyFrame();
+}
+
+bool KeyFrameTrackSource::is_screencast() const {
+  return source_->is_screencast();
+}
+
+absl::optional<bool> KeyFrameTrackSource::needs_denoising() const {
+  return source_->needs_denoising();
+}
+
+bool KeyFrameTrackSource::GetStats(Stats* stats) {
+  return source_->GetStats(stats);
+}
+
+void KeyFrameTrackSource::AddOrUpdateSink(
+    rtc::VideoSinkInterface<webrtc::VideoFrame>* sink,
+    const rtc::VideoSinkWants& wants) {
+  std::lock_guard<std::mutex> lock(sinks_mutex_);
+  std::unique_ptr<TrackSink>& track_sink = sinks_[sink];
+  if (!track_sink) {
+    track_sink = std::make_unique<TrackSink>(*this, sink);
+  }
+  source_->AddOrUpdateSink(track_sink.get(), wants);
+}
+
+void KeyFrameTrackSource::RemoveSink(
+    rtc::VideoSinkInterface<webrtc::VideoFrame>* sink) {
+  std::unique_ptr<TrackSink> track_sink;
+  {
+    std::lock_guard<std::mutex> lock(sinks_mutex_);
+    auto it = sinks_.find(sink);
+    if (it == sinks_.end()) {
+      return;
+    }
+    track_sink = std::move(it->second);
+    sinks_.erase(it);
+  }
+  // Once removed the source does not deliver frames to the wrapper anymore
+  source_->RemoveSink(track_sink.get());
+}
+
+webrtc::MediaSourceInterface::SourceState KeyFrameTrackSource::state() const {
+  return source_->state();
+}
+
+bool KeyFrameTrackSource::remote() const {
+  return source_->remote();
+}
+
+void KeyFrameTrackSource::RegisterObserver(
+    webrtc::ObserverInterface* observer) {
+  source_->RegisterObserver(observer);
+}
+
+void KeyFrameTrackSource::UnregisterObserver(
+    webrtc::ObserverInterface* observer) {
+  source_->UnregisterObserver(observer);
+}
+
+void KeyFrameTrackSource::OnForcedFrame(
+    rtc::VideoSinkInterface<webrtc::VideoFrame>& sink,
+    const webrtc::VideoFrame& frame) {
+  rtc::scoped_refptr<webrtc::VideoFrameBuffer> buffer =
+      frame.video_frame_buffer();
+
+  // Encoded frames are sent as is, so only their upstream sender or
+  // application can produce the key frame. All the tracks of the source share
+  // it, so this does not need to reach the encoder of this track.
+  if (detail::EncodedFrameBuffer* const encoded =
+          detail::EncodedFrameBuffer::FromBuffer(buffer.get())) {
+    if (!encoded->is_key_frame()) {
+      encoded->state().RequestKeyFrame();
+    }
+    CompleteKeyFrame();
+    sink.OnFrame(frame);
+    return;
+  }
+
+  rtc::scoped_refptr<webrtc::I420BufferInterface> i420 = buffer->ToI420();
+  if (!i420) {
+    sink.OnFrame(frame);
+    return;
+  }
+  webrtc::VideoFrame tagged(
+      new rtc::RefCountedObject<ForcedKeyFrameBuffer>(this, std::move(i420)),
+      frame.rotation(), frame.timestamp_us());
+  tagged.set_timestamp(frame.timestamp());
+  tagged.set_ntp_time_ms(frame.ntp_time_ms());
+  sink.OnFrame(tagged);
+}
+
+bool KeyFrameTrackSource::CompleteKeyFrame() noexcept {
+  std::lock_guard<std::mutex> lock(request_mutex_);
+  if (!key_frame_forced_.load(std::memory_order_relaxed)) {
+    return false;
+  }
+  key_frame_forced_.store(false, std::memory_order_relaxed);
+  if (stats_) {
+    stats_->OnCompleted(rtc::TimeMicros() - requested_us_);
+    stats_.reset();
+  }
+  return true;
+}
+
+}  // namespace WebRTC
+}  // namespace MixedReality
+}  // namespace Microsoft
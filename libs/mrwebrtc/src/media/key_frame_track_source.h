@@ -0,0 +1,114 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include "api/mediastreaminterface.h"
+
+namespace Microsoft {
+namespace MixedReality {
+namespace WebRTC {
+
+struct KeyFrameRequestStats;
+
+/// Video track source giving a single local video track its own view of a
+/// video track source shared with other tracks, so that a key frame can be
+/// forced on the encoder of that track only.
+///
+/// All the local video tracks of a source receive the very same frames, which
+/// the encoders cannot tell apart. While a key frame is forced, the frames
+/// delivered to the sinks of the track are tagged by wrapping their buffer,
+/// without copying it, and only the encoder receiving a tagged frame produces
+/// the key frame. The frames of forwarded and encoded video track sources are
+/// not encoded, so the key frame is requested from their upstream sender or
+/// application instead.
+class KeyFrameTrackSource : public webrtc::VideoTrackSourceInterface {
+ public:
+  /// Create a view of the given source for a new local video track.
+  static rtc::scoped_refptr<KeyFrameTrackSource> Create(
+      rtc::scoped_refptr<webrtc::VideoTrackSourceInterface> source) noexcept;
+
+  ~KeyFrameTrackSource() override;
+
+  /// Force the encoder of the track to encode its next frame as a key frame.
+  /// Requests are aggregated until the key frame is encoded.
+  void ForceKeyFrame(std::shared_ptr<KeyFrameRequestStats> stats) noexcept;
+
+  /// Drop the pending forced key frame, if any, once the track has no encoder
+  /// to produce it anymore.
+  void CancelKeyFrame() noexcept;
+
+  /// Check if a frame buffer reaching an encoder was tagged by the source of a
+  /// track with a forced key frame, and if so restore the untagged buffer and
+  /// complete the request. Return true if the frame must be encoded as a key
+  /// frame. This is multithread-safe, and only takes a lock while tagged
+  /// frames are in flight.
+  static bool TakeForcedKeyFrame(
+      rtc::scoped_refptr<webrtc::VideoFrameBuffer>& buffer) noexcept;
+
+  //
+  // VideoTrackSourceInterface
+  //
+
+  bool is_screencast() const override;
+  absl::optional<bool> needs_denoising() const override;
+  bool GetStats(Stats* stats) override;
+  void AddOrUpdateSink(rtc::VideoSinkInterface<webrtc::VideoFrame>* sink,
+                       const rtc::VideoSinkWants& wants) override;
+  void RemoveSink(rtc::VideoSinkInterface<webrtc::VideoFrame>* sink) override;
+
+  //
+  // MediaSourceInterface
+  //
+
+  SourceState state() const override;
+  bool remote() const override;
+
+  //
+  // NotifierInterface
+  //
+
+  void RegisterObserver(webrtc::ObserverInterface* observer) override;
+  void UnregisterObserver(webrtc::ObserverInterface* observer) override;
+
+ protected:
+  explicit KeyFrameTrackSource(
+      rtc::scoped_refptr<webrtc::VideoTrackSourceInterface> source) noexcept;
+
+ private:
+  class TrackSink;
+
+  /// Deliver a frame of the source to a sink of the track while a key frame is
+  /// forced.
+  void OnForcedFrame(rtc::VideoSinkInterface<webrtc::VideoFrame>& sink,
+                     const webrtc::VideoFrame& frame);
+
+  /// Complete the pending forced key frame, and return true if there was one.
+  bool CompleteKeyFrame() noexcept;
+
+  /// Shared source the frames come from.
+  const rtc::scoped_refptr<webrtc::VideoTrackSourceInterface> source_;
+
+  /// Wrappers registered with the source for the sinks of the track.
+  std::mutex sinks_mutex_;
+  std::unordered_map<rtc::VideoSinkInterface<webrtc::VideoFrame>*,
+                     std::unique_ptr<TrackSink>>
+      sinks_;
+
+  /// Pending forced key frame, read without the lock on each frame.
+  std::atomic_bool key_frame_forced_{false};
+
+  /// Lock for the pending forced key frame.
+  std::mutex request_mutex_;
+  int64_t requested_us_{0};
+  std::shared_ptr<KeyFrameRequestStats> stats_;
+};
+
+}  // namespace WebRTC
+}  // namespace MixedReality
+}  // namespace Microsoft
@@ -15,6 +15,7 @@ LocalAudioTrack::LocalAudioTrack(
     RefPtr<GlobalFactory> global_factory,
     rtc::scoped_refptr<webrtc::AudioTrackInterface> track) noexcept
     : MediaTrack(std::move(global_factory), ObjectType::kLocalAudioTrack),
+      AudioFrameObserver(this),
       track_(std::move(track)) {
   RTC_CHECK(track_);
   name_ = track_->id();
@@ -31,6 +32,7 @@ LocalAudioTrack::LocalAudioTrack(
     : MediaTrack(std::move(global_factory),
                  ObjectType::kLocalAudioTrack,
                  owner),
+      AudioFrameObserver(this),
       track_(std::move(track)),
       sender_(std::move(sender)),
       transceiver_(transceiver) {
@@ -13,10 +13,14 @@ namespace WebRTC {
 
 LocalVideoTrack::LocalVideoTrack(
     RefPtr<GlobalFactory> global_factory,
-    rtc::scoped_refptr<webrtc::VideoTrackInterface> track) noexcept
+    rtc::scoped_refptr<webrtc::VideoTrackInterface> track,
+    rtc::scoped_refptr<KeyFrameTrackSource> key_frame_source) noexcept
     : MediaTrack(std::move(global_factory), ObjectType::kLocalVideoTrack),
-      track_(std::move(track)) {
+      VideoFrameObserver(this),
+      track_(std::move(track)),
+      key_frame_source_(std::move(key_frame_source)) {
   RTC_CHECK(track_);
+  RTC_CHECK(key_frame_source_);
   name_ = track_->id();
   kind_ = mrsTrackKind::kVideoTrack;
   rtc::VideoSinkWants sink_settings{};
@@ -29,17 +33,21 @@ LocalVideoTrack::LocalVideoTrack(
     PeerConnection& owner,
     Transceiver* transceiver,
     rtc::scoped_refptr<webrtc::VideoTrackInterface> track,
+    rtc::scoped_refptr<KeyFrameTrackSource> key_frame_source,
     rtc::scoped_refptr<webrtc::RtpSenderInterface> sender) noexcept
     : MediaTrack(std::move(global_factory),
                  ObjectType::kLocalVideoTrack,
                  owner),
+      VideoFrameObserver(this),
       track_(std::move(track)),
+      key_frame_source_(std::move(key_frame_source)),
       sender_(std::move(sender)),
       transceiver_(transceiver) {
   RTC_CHECK(owner_);
   RTC_CHECK(transceiver_);
   RTC_CHECK(transceiver_->GetMediaKind() == mrsMediaKind::kVideo);
   RTC_CHECK(track_);
+  RTC_CHECK(key_frame_source_);
   RTC_CHECK(sender_);
   name_ = track_->id();
   kind_ = mrsTrackKind::kVideoTrack;
@@ -66,6 +74,18 @@ bool LocalVideoTrack::IsEnabled() const noexcept {
   return track_->enabled();
 }
 
+Result LocalVideoTrack::ForceKeyFrame() noexcept {
+  // Only the encoder of the sender of the track can produce the key frame
+  PeerConnection* const owner = owner_;
+  if (!owner) {
+    RTC_LOG(LS_ERROR) << "Cannot force a key frame on local video track "
+                      << name_ << " not added to any peer connection.";
+    return Result::kInvalidOperation;
+  }
+  key_frame_source_->ForceKeyFrame(owner->GetKeyFrameRequestStats());
+  return Result::kSuccess;
+}
+
 webrtc::VideoTrackInterface* LocalVideoTrack::impl() const {
   return track_.get();
 }
@@ -105,6 +125,7 @@ void LocalVideoTrack::OnRemovedFromPeerConnection(
   RTC_CHECK(old_transceiver->IsPlanB() || (sender_ == old_sender.get()));
   owner_ = nullptr;
   sender_ = nullptr;
+  key_frame_source_->CancelKeyFrame();
   transceiver_->OnLocalTrackRemoved(this);
   transceiver_ = nullptr;
 }
@@ -116,6 +137,7 @@ void LocalVideoTrack::RemoveFromPeerConnection(
       peer.RemoveTrack(sender_);
       sender_ = nullptr;
       owner_ = nullptr;
+      key_frame_source_->CancelKeyFrame();
       transceiver_->OnLocalTrackRemoved(this);
       transceiver_ = nullptr;
     }
@@ -123,6 +145,7 @@ void LocalVideoTrack::RemoveFromPeerConnection(
     transceiver_->SetTrackPlanB(nullptr);
     transceiver_->SyncSenderPlanB(false, &peer, nullptr, nullptr);
     owner_ = nullptr;
+    key_frame_source_->CancelKeyFrame();
     transceiver_->OnLocalTrackRemoved(this);
     transceiver_ = nullptr;
   }
@@ -5,7 +5,9 @@
 
 #include "callback.h"
 #include "interop_api.h"
+#include "media/key_frame_track_source.h"
 #include "media/media_track.h"
+#include "mrs_errors.h"
 #include "refptr.h"
 #include "tracked_object.h"
 #include "video_frame_observer.h"
@@ -41,15 +43,19 @@ class Transceiver;
 /// has no knowledge about how the source produces the frames.
 class LocalVideoTrack : public MediaTrack, public VideoFrameObserver {
  public:
-  /// Constructor for a track not added to any peer connection.
-  LocalVideoTrack(RefPtr<GlobalFactory> global_factory,
-                  rtc::scoped_refptr<webrtc::VideoTrackInterface> track) noexcept;
+  /// Constructor for a track not added to any peer connection. The track must
+  /// be created for its own |KeyFrameTrackSource| view of its source.
+  LocalVideoTrack(
+      RefPtr<GlobalFactory> global_factory,
+      rtc::scoped_refptr<webrtc::VideoTrackInterface> track,
+      rtc::scoped_refptr<KeyFrameTrackSource> key_frame_source) noexcept;
 
   /// Constructor for a track added to a peer connection.
   LocalVideoTrack(RefPtr<GlobalFactory> global_factory,
                   PeerConnection& owner,
                   Transceiver* transceiver,
                   rtc::scoped_refptr<webrtc::VideoTrackInterface> track,
+                  rtc::scoped_refptr<KeyFrameTrackSource> key_frame_source,
                   rtc::scoped_refptr<webrtc::RtpSenderInterface> sender) noexcept;
 
   ~LocalVideoTrack() override;
@@ -63,6 +69,12 @@ class LocalVideoTrack : public MediaTrack, public VideoFrameObserver {
   /// See |SetEnabled(bool)|.
   MRS_NODISCARD bool IsEnabled() const noexcept;
 
+  /// Force the encoder of the track to encode its next frame as a key frame.
+  /// This fails if the track is not added to a peer connection, and the
+  /// request is dropped if it is removed before the key frame is encoded. See
+  /// |mrsLocalVideoTrackForceKeyFrame()|.
+  Result ForceKeyFrame() noexcept;
+
   MRS_NODISCARD Transceiver* GetTransceiver() const noexcept {
     return transceiver_;
   }
@@ -99,6 +111,9 @@ class LocalVideoTrack : public MediaTrack, public VideoFrameObserver {
   /// Underlying core implementation.
   rtc::scoped_refptr<webrtc::VideoTrackInterface> track_;
 
+  /// Source of the track, forcing key frames on its encoder only.
+  rtc::scoped_refptr<KeyFrameTrackSource> key_frame_source_;
+
   /// RTP sender this track is associated with.
   rtc::scoped_refptr<webrtc::RtpSenderInterface> sender_;
 
@@ -0,0 +1,752 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+// This is a precompiled header, it must be on its own, followed by a blank
+// line, to prevent clang-format from reordering it with other headers.
+#include "pch.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#if defined(MR_SHARING_WIN)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "interop/global_factory.h"
+#include "media/media_recorder.h"
+#include "media/remote_audio_track.h"
+#include "media/remote_video_track.h"
+#include "thread_monitor.h"
+
+#include "api/mediastreaminterface.h"
+#include "rtc_base/stringutils.h"
+
+namespace {
+
+using namespace Microsoft::MixedReality::WebRTC;
+
+enum {
+  /// Write the pending data of all files.
+  MSG_WRITE,
+  /// Write the pending data of all files and flush them to the device.
+  MSG_SYNC
+};
+
+/// Maximum duration of a WebM cluster, in milliseconds. The timestamps of the
+/// blocks are 16-bit signed offsets from the timestamp of their cluster.
+constexpr int64_t kMaxClusterDurationMs = 30000;
+
+/// Value of an EBML element size meaning that the size is unknown, for the
+/// elements written before their content is known.
+constexpr uint64_t kEbmlUnknownSize = 0x00FFFFFFFFFFFFFFull;
+
+/// Offset of the frame count in the IVF header.
+constexpr uint64_t kIvfFrameCountOffset = 24;
+
+/// Offsets of the RIFF chunk size and of the data chunk size in the WAV
+/// header.
+constexpr uint64_t kWavRiffSizeOffset = 4;
+constexpr uint64_t kWavDataSizeOffset = 40;
+constexpr uint32_t kWavHeaderSize = 44;
+
+void PutLE(std::vector<uint8_t>& out, uint64_t value, int size) {
+  for (int i = 0; i < size; ++i) {
+    out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+  }
+}
+
+void PutBE(std::vector<uint8_t>& out, uint64_t value, int size) {
+  for (int i = size - 1; i >= 0; --i) {
+    out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+  }
+}
+
+void PutFourCC(std::vector<uint8_t>& out, const char* fourcc) {
+  out.insert(out.end(), fourcc, fourcc + 4);
+}
+
+void PutEbmlId(std::vector<uint8_t>& out, uint32_t id) {
+  // The IDs include their length marker
+  const int size = (id > 0xFFFFFF ? 4 : id > 0xFFFF ? 3 : id > 0xFF ? 2 : 1);
+  PutBE(out, id, size);
+}
+
+/// Write an element size as an 8-byte variable-size integer, which allows
+/// writing any size, and patching it later if needed.
+void PutEbmlSize(std::vector<uint8_t>& out, uint64_t size) {
+  out.push_back(0x01);
+  PutBE(out, size, 7);
+}
+
+void PutEbmlUInt(std::vector<uint8_t>& out, uint32_t id, uint64_t value) {
+  int size = 1;
+  while ((size < 8) && (value >> (8 * size))) {
+    ++size;
+  }
+  PutEbmlId(out, id);
+  out.push_back(static_cast<uint8_t>(0x80 | size));
+  PutBE(out, value, size);
+}
+
+void PutEbmlString(std::vector<uint8_t>& out, uint32_t id, const char* str) {
+  const size_t size = strlen(str);
+  PutEbmlId(out, id);
+  PutEbmlSize(out, size);
+  out.insert(out.end(), str, str + size);
+}
+
+void PutEbmlFloat(std::vector<uint8_t>& out, uint32_t id, double value) {
+  uint64_t bits;
+  static_assert(sizeof(bits) == sizeof(value), "Unexpected double size.");
+  memcpy(&bits, &value, sizeof(bits));
+  PutEbmlId(out, id);
+  out.push_back(0x88);
+  PutBE(out, bits, 8);
+}
+
+/// Write a master element, and return the offset of its content in |out|.
+size_t PutEbmlMaster(std::vector<uint8_t>& out,
+                     uint32_t id,
+                     const std::vector<uint8_t>& content) {
+  PutEbmlId(out, id);
+  PutEbmlSize(out, content.size());
+  const size_t offset = out.size();
+  out.insert(out.end(), content.begin(), content.end());
+  return offset;
+}
+
+/// Flush the data of a file from the system cache to the storage device.
+bool SyncToDevice(FILE* handle) {
+#if defined(MR_SHARING_WIN)
+  return (_commit(_fileno(handle)) == 0);
+#else
+  return (fsync(fileno(handle)) == 0);
+#endif
+}
+
+}  // namespace
+
+namespace Microsoft {
+namespace MixedReality {
+namespace WebRTC {
+namespace detail {
+
+/// File written by the I/O thread of a recorder.
+struct RecordingFile {
+  /// Header field written at the end of the recording.
+  struct Patch {
+    uint64_t offset;
+    std::vector<uint8_t> data;
+  };
+
+  RecordingFile(FILE* handle, uint32_t buffer_size) : handle_(handle) {
+    pending_.reserve(buffer_size);
+    writing_.reserve(buffer_size);
+  }
+
+  /// Append some data at the end of the file. Called with the recorder lock.
+  void Append(const void* data, size_t size) {
+    const uint8_t* const bytes = static_cast<const uint8_t*>(data);
+    pending_.insert(pending_.end(), bytes, bytes + size);
+    size_ += size;
+  }
+
+  void Append(const std::vector<uint8_t>& data) {
+    Append(data.data(), data.size());
+  }
+
+  /// Data appended and not written yet. Guarded by the recorder lock.
+  std::vector<uint8_t> pending_;
+
+  /// Size of the file once all the data appended are written. Guarded by the
+  /// recorder lock.
+  uint64_t size_ = 0;
+
+  /// Patches applied when closing the file. Guarded by the recorder lock.
+  std::vector<Patch> patches_;
+
+  /// Data being written, swapped with |pending_| by the I/O thread so that
+  /// both buffers keep their capacity. Only used by the I/O thread.
+  std::vector<uint8_t> writing_;
+
+  /// File handle. Only used by the I/O thread, after opening.
+  FILE* const handle_;
+
+  /// Whether a write failed, after which the file is not written anymore.
+  /// Only used by the I/O thread.
+  bool failed_ = false;
+};
+
+/// Recording of a single track into its own file.
+class MediaRecording {
+ public:
+  MediaRecording(MediaRecorder& recorder, std::shared_ptr<RecordingFile> file)
+      : recorder_(recorder), file_(std::move(file)) {}
+  virtual ~MediaRecording() = default;
+
+  /// Start receiving the media of the track. Called without the recorder lock.
+  virtual void Attach() noexcept = 0;
+
+  /// Stop receiving the media of the track. Called without the recorder lock.
+  virtual void Detach() noexcept = 0;
+
+  /// Add the patches completing the file. Called with the recorder lock, once
+  /// detached.
+  virtual void Finish() noexcept = 0;
+
+ protected:
+  /// Append some data to the file, and notify the recorder. Called with the
+  /// recorder lock.
+  void Append(const void* data, size_t size) {
+    file_->Append(data, size);
+    recorder_.OnDataAppended(*file_);
+  }
+
+  void Append(const std::vector<uint8_t>& data) {
+    Append(data.data(), data.size());
+  }
+
+  MediaRecorder& recorder_;
+  const std::shared_ptr<RecordingFile> file_;
+};
+
+/// Recording of the encoded frames of a remote video track into an IVF or
+/// WebM file, starting from the first key frame.
+class VideoRecording : public MediaRecording, public EncodedVideoFrameSink {
+ public:
+  VideoRecording(MediaRecorder& recorder,
+                 std::shared_ptr<RecordingFile> file,
+                 RefPtr<RemoteVideoTrack> track,
+                 mrsVideoContainer container)
+      : MediaRecording(recorder, std::move(file)),
+        track_(std::move(track)),
+        container_(container) {}
+
+  void Attach() noexcept override { track_->AddEncodedFrameSink(this); }
+  void Detach() noexcept override { track_->RemoveEncodedFrameSink(this); }
+
+  void Finish() noexcept override {
+    if (!started_) {
+      return;
+    }
+    std::vector<uint8_t> data;
+    if (container_ == mrsVideoContainer::kIvf) {
+      PutLE(data, static_cast<uint32_t>(frame_count_), 4);
+      file_->patches_.push_back({kIvfFrameCountOffset, std::move(data)});
+    } else {
+      uint64_t bits;
+      const double duration = static_cast<double>(last_time_ms_);
+      memcpy(&bits, &duration, sizeof(bits));
+      PutBE(data, bits, 8);
+      file_->patches_.push_back({duration_offset_, std::move(data)});
+    }
+  }
+
+  void OnEncodedFrame(const mrsEncodedVideoFrame& frame) noexcept override {
+    std::lock_guard<std::mutex> lock(recorder_.mutex());
+    if (!started_) {
+      if ((frame.is_key_frame == mrsBool::kFalse) || !IsSupported(frame)) {
+        recorder_.video_frames_skipped_.fetch_add(1, std::memory_order_relaxed);
+        return;
+      }
+      started_ = true;
+      codec_ = frame.codec;
+      start_time_ms_ = frame.receive_time_ms - recorder_.origin_ms();
+      last_rtp_timestamp_ = frame.rtp_timestamp;
+      WriteHeader(frame);
+    } else if (frame.codec != codec_) {
+      // The codec was renegotiated, which the file cannot record.
+      recorder_.video_frames_skipped_.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+
+    // Derive the timestamps from the RTP timestamps, which are not affected by
+    // the network jitter, using the 90 kHz clock of all video codecs.
+    rtp_elapsed_ +=
+        static_cast<int32_t>(frame.rtp_timestamp - last_rtp_timestamp_);
+    last_rtp_timestamp_ = frame.rtp_timestamp;
+    const int64_t time_ms =
+        std::max(start_time_ms_ + rtp_elapsed_ / 90, last_time_ms_);
+    last_time_ms_ = time_ms;
+
+    if (container_ == mrsVideoContainer::kIvf) {
+      WriteIvfFrame(frame, time_ms);
+    } else {
+      WriteWebMFrame(frame, time_ms);
+    }
+    ++frame_count_;
+    recorder_.video_frames_recorded_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+ private:
+  bool IsSupported(const mrsEncodedVideoFrame& frame) const noexcept {
+    switch (frame.codec) {
+      case mrsVideoCodec::kVP8:
+      case mrsVideoCodec::kVP9:
+        return true;
+      case mrsVideoCodec::kH264:
+        // WebM only supports the VPx codecs
+        return (container_ == mrsVideoContainer::kIvf);
+      default:
+        return false;
+    }
+  }
+
+  void WriteHeader(const mrsEncodedVideoFrame& frame) {
+    std::vector<uint8_t> header;
+    if (container_ == mrsVideoContainer::kIvf) {
+      PutFourCC(header, "DKIF");
+      PutLE(header, 0, 2);   // version
+      PutLE(header, 32, 2);  // header size
+      PutFourCC(header, (frame.codec == mrsVideoCodec::kVP8
+                             ? "VP80"
+                             : frame.codec == mrsVideoCodec::kVP9 ? "VP90"
+                                                                  : "H264"));
+      PutLE(header, frame.width, 2);
+      PutLE(header, frame.height, 2);
+      PutLE(header, 1000, 4);  // timebase denominator
+      PutLE(header, 1, 4);     // timebase numerator
+      PutLE(header, 0, 4);     // frame count, patched at the end
+      PutLE(header, 0, 4);     // unused
+    } else {
+      std::vector<uint8_t> ebml;
+      PutEbmlUInt(ebml, 0x4286, 1);  // EBMLVersion
+      PutEbmlUInt(ebml, 0x42F7, 1);  // EBMLReadVersion
+      PutEbmlUInt(ebml, 0x42F2, 4);  // EBMLMaxIDLength
+      PutEbmlUInt(ebml, 0x42F3, 8);  // EBMLMaxSizeLength
+      PutEbmlString(ebml, 0x4282, "webm");  // DocType
+      PutEbmlUInt(ebml, 0x4287, 2);         // DocTypeVersion
+      PutEbmlUInt(ebml, 0x4285, 2);         // DocTypeReadVersion
+      PutEbmlMaster(header, 0x1A45DFA3, ebml);
+
+      // Segment, of unknown size since written live
+      PutEbmlId(header, 0x18538067);
+      PutEbmlSize(header, kEbmlUnknownSize);
+
+      std::vector<uint8_t> info;
+      PutEbmlUInt(info, 0x2AD7B1, 1000000);  // TimecodeScale, in ns
+      const size_t duration_pos = info.size() + 3;
+      PutEbmlFloat(info, 0x4489, 0.0);  // Duration, patched at the end
+      PutEbmlString(info, 0x4D80, "mrwebrtc");  // MuxingApp
+      PutEbmlString(info, 0x5741, "mrwebrtc");  // WritingApp
+      const size_t info_pos = PutEbmlMaster(header, 0x1549A966, info);
+      duration_offset_ = file_->size_ + info_pos + duration_pos;
+
+      std::vector<uint8_t> video;
+      PutEbmlUInt(video, 0xB0, frame.width);   // PixelWidth
+      PutEbmlUInt(video, 0xBA, frame.height);  // PixelHeight
+      std::vector<uint8_t> entry;
+      PutEbmlUInt(entry, 0xD7, 1);  // TrackNumber
+      PutEbmlUInt(entry, 0x73C5, 1);  // TrackUID
+      PutEbmlUInt(entry, 0x83, 1);  // TrackType, video
+      PutEbmlString(entry, 0x86,
+                    frame.codec == mrsVideoCodec::kVP8 ? "V_VP8" : "V_VP9");
+      PutEbmlMaster(entry, 0xE0, video);
+      std::vector<uint8_t> tracks;
+      PutEbmlMaster(tracks, 0xAE, entry);
+      PutEbmlMaster(header, 0x1654AE6B, tracks);
+    }
+    Append(header);
+  }
+
+  void WriteIvfFrame(const mrsEncodedVideoFrame& frame, int64_t time_ms) {
+    std::vector<uint8_t> header;
+    PutLE(header, frame.size, 4);
+    PutLE(header, static_cast<uint64_t>(time_ms), 8);
+    Append(header);
+    Append(frame.data, frame.size);
+  }
+
+  void WriteWebMFrame(const mrsEncodedVideoFrame& frame, int64_t time_ms) {
+    const bool is_key_frame = (frame.is_key_frame != mrsBool::kFalse);
+    std::vector<uint8_t> header;
+    // Start the clusters on key frames, for seeking
+    if (!has_cluster_ || is_key_frame ||
+        (time_ms - cluster_time_ms_ > kMaxClusterDurationMs)) {
+      PutEbmlId(header, 0x1F43B675);  // Cluster
+      PutEbmlSize(header, kEbmlUnknownSize);
+      PutEbmlUInt(header, 0xE7, static_cast<uint64_t>(time_ms));  // Timecode
+      has_cluster_ = true;
+      cluster_time_ms_ = time_ms;
+    }
+    PutEbmlId(header, 0xA3);  // SimpleBlock
+    PutEbmlSize(header, frame.size + 4);
+    header.push_back(0x81);  // track number
+    PutBE(header, static_cast<uint16_t>(time_ms - cluster_time_ms_), 2);
+    header.push_back(is_key_frame ? 0x80 : 0x00);
+    Append(header);
+    Append(frame.data, frame.size);
+  }
+
+  const RefPtr<RemoteVideoTrack> track_;
+  const mrsVideoContainer container_;
+
+  //
+  // Guarded by the recorder lock
+  //
+
+  bool started_ = false;
+  mrsVideoCodec codec_ = mrsVideoCodec::kUnknown;
+  int64_t start_time_ms_ = 0;
+  uint32_t last_rtp_timestamp_ = 0;
+  int64_t rtp_elapsed_ = 0;
+  int64_t last_time_ms_ = 0;
+  uint64_t frame_count_ = 0;
+  uint64_t duration_offset_ = 0;
+  bool has_cluster_ = false;
+  int64_t cluster_time_ms_ = 0;
+};
+
+/// Recording of the decoded audio of a remote audio track into a 16-bit PCM
+/// WAV file.
+class AudioRecording : public MediaRecording,
+                       public webrtc::AudioTrackSinkInterface {
+ public:
+  AudioRecording(MediaRecorder& recorder,
+                 std::shared_ptr<RecordingFile> file,
+                 RefPtr<RemoteAudioTrack> track)
+      : MediaRecording(recorder, std::move(file)), track_(std::move(track)) {}
+
+  void Attach() noexcept override { track_->impl()->AddSink(this); }
+  void Detach() noexcept override { track_->impl()->RemoveSink(this); }
+
+  void Finish() noexcept override {
+    if (!started_) {
+      return;
+    }
+    // The sizes saturate past 4 GB, which most readers handle as unknown.
+    const uint64_t data_size =
+        std::min<uint64_t>(file_->size_ - kWavHeaderSize, 0xFFFFFFFF - 36);
+    std::vector<uint8_t> riff_size;
+    PutLE(riff_size, data_size + 36, 4);
+    file_->patches_.push_back({kWavRiffSizeOffset, std::move(riff_size)});
+    std::vector<uint8_t> chunk_size;
+    PutLE(chunk_size, data_size, 4);
+    file_->patches_.push_back({kWavDataSizeOffset, std::move(chunk_size)});
+  }
+
+  void OnData(const void* audio_data,
+              int bits_per_sample,
+              int sample_rate,
+              size_t number_of_channels,
+              size_t number_of_frames) override {
+    std::lock_guard<std::mutex> lock(recorder_.mutex());
+    if (!started_) {
+      if ((bits_per_sample != 16) || (sample_rate <= 0) ||
+          (number_of_channels == 0)) {
+        return;
+      }
+      started_ = true;
+      sample_rate_ = sample_rate;
+      channel_count_ = number_of_channels;
+      WriteHeader();
+      WriteSilence(rtc::TimeMillis() - recorder_.origin_ms());
+    } else if ((bits_per_sample != 16) || (sample_rate != sample_rate_) ||
+               (number_of_channels != channel_count_)) {
+      if (!format_changed_) {
+        RTC_LOG(LS_WARNING) << "Audio format changed while recording track "
+                            << track_->GetName() << "; skipping frames.";
+        format_changed_ = true;
+      }
+      return;
+    }
+    Append(audio_data, number_of_frames * number_of_channels * 2);
+    recorder_.audio_samples_recorded_.fetch_add(number_of_frames,
+                                                std::memory_order_relaxed);
+  }
+
+ private:
+  void WriteHeader() {
+    const uint32_t block_align = static_cast<uint32_t>(channel_count_ * 2);
+    std::vector<uint8_t> header;
+    PutFourCC(header, "RIFF");
+    PutLE(header, 0, 4);  // patched at the end
+    PutFourCC(header, "WAVE");
+    PutFourCC(header, "fmt ");
+    PutLE(header, 16, 4);
+    PutLE(header, 1, 2);  // PCM
+    PutLE(header, channel_count_, 2);
+    PutLE(header, static_cast<uint32_t>(sample_rate_), 4);
+    PutLE(header, static_cast<uint32_t>(sample_rate_) * block_align, 4);
+    PutLE(header, block_align, 2);
+    PutLE(header, 16, 2);
+    PutFourCC(header, "data");
+    PutLE(header, 0, 4);  // patched at the end
+    Append(header);
+  }
+
+  /// Write the silence from the start of the recorder up to the first frame,
+  /// so that the track plays in sync with the other ones.
+  void WriteSilence(int64_t duration_ms) {
+    const uint64_t frame_count =
+        static_cast<uint64_t>(std::max<int64_t>(duration_ms, 0)) *
+        sample_rate_ / 1000;
+    const std::vector<uint8_t> zeros(channel_count_ * 2 * 480);
+    uint64_t remaining = frame_count * channel_count_ * 2;
+    while (remaining > 0) {
+      const size_t size =
+          static_cast<size_t>(std::min<uint64_t>(remaining, zeros.size()));
+      Append(zeros.data(), size);
+      remaining -= size;
+    }
+    recorder_.audio_samples_recorded_.fetch_add(frame_count,
+                                                std::memory_order_relaxed);
+  }
+
+  const RefPtr<RemoteAudioTrack> track_;
+
+  //
+  // Guarded by the recorder lock
+  //
+
+  bool started_ = false;
+  bool format_changed_ = false;
+  int sample_rate_ = 0;
+  size_t channel_count_ = 0;
+};
+
+}  // namespace detail
+
+RefPtr<MediaRecorder> MediaRecorder::create(
+    RefPtr<GlobalFactory> global_factory,
+    const mrsMediaRecorderConfig& config) noexcept {
+  std::unique_ptr<rtc::Thread> io_thread = rtc::Thread::Create();
+  if (!io_thread) {
+    return nullptr;
+  }
+  io_thread->SetName("Media recorder I/O thread", io_thread.get());
+  if (!io_thread->Start()) {
+    RTC_LOG(LS_ERROR) << "Failed to start the I/O thread of a media recorder.";
+    return nullptr;
+  }
+  ThreadMonitor::Instance().Register(io_thread.get());
+  RefPtr<MediaRecorder> recorder = new MediaRecorder(
+      std::move(global_factory), config, std::move(io_thread));
+  if (config.sync_interval_ms > 0) {
+    recorder->io_thread_->PostDelayed(RTC_FROM_HERE, config.sync_interval_ms,
+                                      recorder.get(), MSG_SYNC);
+  }
+  return recorder;
+}
+
+MediaRecorder::MediaRecorder(RefPtr<GlobalFactory> global_factory,
+                             const mrsMediaRecorderConfig& config,
+                             std::unique_ptr<rtc::Thread> io_thread) noexcept
+    : TrackedObject(std::move(global_factory), ObjectType::kMediaRecorder),
+      write_buffer_size_(std::max<uint32_t>(config.write_buffer_size, 4096)),
+      sync_interval_ms_(config.sync_interval_ms),
+      origin_ms_(rtc::TimeMillis()),
+      io_thread_(std::move(io_thread)) {}
+
+MediaRecorder::~MediaRecorder() {
+  Stop();
+}
+
+Result MediaRecorder::AddVideoTrack(RemoteVideoTrack& track,
+                                    const std::string& path,
+                                    mrsVideoContainer container) noexcept {
+  if ((container != mrsVideoContainer::kIvf) &&
+      (container != mrsVideoContainer::kWebM)) {
+    RTC_LOG(LS_ERROR) << "Unknown video container.";
+    return Result::kInvalidParameter;
+  }
+  std::lock_guard<std::mutex> control_lock(control_mutex_);
+  if (IsStopped()) {
+    RTC_LOG(LS_ERROR) << "Cannot add a track to a stopped media recorder.";
+    return Result::kInvalidOperation;
+  }
+  std::shared_ptr<detail::RecordingFile> file = OpenFile(path);
+  if (!file) {
+    return Result::kInvalidParameter;
+  }
+  StartRecording(std::make_unique<detail::VideoRecording>(
+      *this, std::move(file), &track, container));
+  // Start from a key frame right away instead of the next periodic one
+  track.RequestKeyFrame();
+  return Result::kSuccess;
+}
+
+Result MediaRecorder::AddAudioTrack(RemoteAudioTrack& track,
+                                    const std::string& path) noexcept {
+  std::lock_guard<std::mutex> control_lock(control_mutex_);
+  if (IsStopped()) {
+    RTC_LOG(LS_ERROR) << "Cannot add a track to a stopped media recorder.";
+    return Result::kInvalidOperation;
+  }
+  std::shared_ptr<detail::RecordingFile> file = OpenFile(path);
+  if (!file) {
+    return Result::kInvalidParameter;
+  }
+  StartRecording(
+      std::make_unique<detail::AudioRecording>(*this, std::move(file), &track));
+  return Result::kSuccess;
+}
+
+void MediaRecorder::Stop() noexcept {
+  std::lock_guard<std::mutex> control_lock(control_mutex_);
+  std::vector<std::unique_ptr<detail::MediaRecording>> recordings;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stopped_) {
+      return;
+    }
+    stopped_ = true;
+    recordings = std::move(recordings_);
+  }
+  for (auto&& recording : recordings) {
+    recording->Detach();
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto&& recording : recordings) {
+      recording->Finish();
+    }
+  }
+  io_thread_->Invoke<void>(RTC_FROM_HERE, [this]() { CloseFiles(); });
+  ThreadMonitor::Instance().Unregister(io_thread_.get());
+  io_thread_->Stop();
+}
+
+void MediaRecorder::GetStats(mrsMediaRecorderStats& stats) const noexcept {
+  stats.bytes_written = bytes_written_.load(std::memory_order_relaxed);
+  stats.video_frames_recorded =
+      video_frames_recorded_.load(std::memory_order_relaxed);
+  stats.video_frames_skipped =
+      video_frames_skipped_.load(std::memory_order_relaxed);
+  stats.audio_samples_recorded =
+      audio_samples_recorded_.load(std::memory_order_relaxed);
+  stats.write_errors = write_errors_.load(std::memory_order_relaxed);
+}
+
+void MediaRecorder::OnDataAppended(detail::RecordingFile& file) noexcept {
+  if ((file.pending_.size() >= write_buffer_size_) &&
+      !write_pending_.exchange(true)) {
+    io_thread_->Post(RTC_FROM_HERE, this, MSG_WRITE);
+  }
+}
+
+bool MediaRecorder::IsStopped() const noexcept {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stopped_;
+}
+
+std::shared_ptr<detail::RecordingFile> MediaRecorder::OpenFile(
+    const std::string& path) noexcept {
+#if defined(MR_SHARING_WIN)
+  FILE* const handle = _wfopen(rtc::ToUtf16(path).c_str(), L"wb");
+#else
+  FILE* const handle = fopen(path.c_str(), "wb");
+#endif
+  if (!handle) {
+    RTC_LOG(LS_ERROR) << "Failed to open file '" << path
+                      << "' for recording.";
+    return nullptr;
+  }
+  auto file = std::make_shared<detail::RecordingFile>(handle,
+                                                      write_buffer_size_);
+  std::lock_guard<std::mutex> lock(mutex_);
+  files_.push_back(file);
+  return file;
+}
+
+void MediaRecorder::StartRecording(
+    std::unique_ptr<detail::MediaRecording> recording) noexcept {
+  recording->Attach();
+  std::lock_guard<std::mutex> lock(mutex_);
+  recordings_.push_back(std::move(recording));
+}
+
+void MediaRecorder::OnMessage(rtc::Message* msg) {
+  switch (msg->message_id) {
+    case MSG_WRITE:
+      WriteFiles();
+      break;
+    case MSG_SYNC:
+      SyncFiles();
+      io_thread_->PostDelayed(RTC_FROM_HERE, sync_interval_ms_, this,
+                              MSG_SYNC);
+      break;
+  }
+}
+
+void MediaRecorder::WriteFiles() noexcept {
+  write_pending_.store(false);
+  std::vector<std::shared_ptr<detail::RecordingFile>> files;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto&& file : files_) {
+      if (!file->pending_.empty()) {
+        std::swap(file->pending_, file->writing_);
+        files.push_back(file);
+      }
+    }
+  }
+  // Write outside of the lock, to never block the recordings on the disk
+  for (auto&& file : files) {
+    const size_t size = file->writing_.size();
+    if (!file->failed_) {
+      if (fwrite(file->writing_.data(), 1, size, file->handle_) == size) {
+        bytes_written_.fetch_add(size, std::memory_order_relaxed);
+      } else {
+        RTC_LOG(LS_ERROR) << "Failed to write recording file.";
+        file->failed_ = true;
+        write_errors_.fetch_add(1, std::memory_order_relaxed);
+      }
+    }
+    file->writing_.clear();
+  }
+}
+
+void MediaRecorder::SyncFiles() noexcept {
+  WriteFiles();
+  std::vector<std::shared_ptr<detail::RecordingFile>> files;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    files = files_;
+  }
+  for (auto&& file : files) {
+    if (!file->failed_ && ((fflush(file->handle_) != 0) ||
+                           !SyncToDevice(file->handle_))) {
+      RTC_LOG(LS_ERROR) << "Failed to flush recording file.";
+      file->failed_ = true;
+      write_errors_.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+}
+
+void MediaRecorder::CloseFiles() noexcept {
+  // Discard the periodic flush, which would otherwise run on closed files
+  io_thread_->Clear(this);
+  WriteFiles();
+  std::vector<std::shared_ptr<detail::RecordingFile>> files;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    files = std::move(files_);
+  }
+  for (auto&& file : files) {
+    if (!file->failed_) {
+      for (auto&& patch : file->patches_) {
+        if ((fseek(file->handle_, static_cast<long>(patch.offset),
+                   SEEK_SET) != 0) ||
+            (fwrite(patch.data.data(), 1, patch.data.size(), file->handle_) !=
+             patch.data.size())) {
+          file->failed_ = true;
+          break;
+        }
+      }
+      if (file->failed_ || (fflush(file->handle_) != 0) ||
+          !SyncToDevice(file->handle_)) {
+        RTC_LOG(LS_ERROR) << "Failed to finalize recording file.";
+        write_errors_.fetch_add(1, std::memory_order_relaxed);
+      }
+    }
+    fclose(file->handle_);
+  }
+}
+
+}  // namespace WebRTC
+}  // namespace MixedReality
+}  // namespace Microsoft
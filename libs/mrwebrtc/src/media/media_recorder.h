@@ -0,0 +1,148 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "media_recorder_interop.h"
+#include "mrs_errors.h"
+#include "refptr.h"
+#include "tracked_object.h"
+
+#include "rtc_base/messagehandler.h"
+#include "rtc_base/thread.h"
+#include "rtc_base/thread_annotations.h"
+
+namespace Microsoft {
+namespace MixedReality {
+namespace WebRTC {
+
+class RemoteAudioTrack;
+class RemoteVideoTrack;
+
+namespace detail {
+struct RecordingFile;
+class MediaRecording;
+}  // namespace detail
+
+/// Recorder writing remote tracks to disk, one file per track.
+///
+/// The recordings format their data on the threads delivering the media into
+/// per-file buffers, which a dedicated I/O thread writes to disk in large
+/// chunks, so that the decoding and audio threads never block on the disk. The
+/// headers which can only be completed at the end of the recording, like the
+/// frame count or the duration, are patched when the recorder stops.
+class MediaRecorder : public TrackedObject, public rtc::MessageHandler {
+ public:
+  static RefPtr<MediaRecorder> create(
+      RefPtr<GlobalFactory> global_factory,
+      const mrsMediaRecorderConfig& config) noexcept;
+
+  ~MediaRecorder() override;
+
+  /// Record the encoded frames of a remote video track to a new file. See
+  /// |mrsMediaRecorderAddVideoTrack()|.
+  Result AddVideoTrack(RemoteVideoTrack& track,
+                       const std::string& path,
+                       mrsVideoContainer container) noexcept;
+
+  /// Record a remote audio track to a new WAV file. See
+  /// |mrsMediaRecorderAddAudioTrack()|.
+  Result AddAudioTrack(RemoteAudioTrack& track,
+                       const std::string& path) noexcept;
+
+  /// Stop recording, and finalize and close all files. This blocks until all
+  /// the data are written.
+  void Stop() noexcept;
+
+  /// Get the statistics of the recorder.
+  void GetStats(mrsMediaRecorderStats& stats) const noexcept;
+
+  //
+  // Internal, used by the recordings
+  //
+
+  /// Time origin of all the recordings, from |rtc::TimeMillis()|.
+  MRS_NODISCARD int64_t origin_ms() const noexcept { return origin_ms_; }
+
+  /// Lock held by the recordings while formatting their data.
+  MRS_NODISCARD std::mutex& mutex() const noexcept { return mutex_; }
+
+  /// Notify that some data were appended to a file, to wake up the I/O thread
+  /// once its buffer is large enough. Must be called with |mutex()| held.
+  void OnDataAppended(detail::RecordingFile& file) noexcept;
+
+  /// Counters updated by the recordings.
+  std::atomic<uint64_t> video_frames_recorded_{0};
+  std::atomic<uint64_t> video_frames_skipped_{0};
+  std::atomic<uint64_t> audio_samples_recorded_{0};
+
+ protected:
+  MediaRecorder(RefPtr<GlobalFactory> global_factory,
+                const mrsMediaRecorderConfig& config,
+                std::unique_ptr<rtc::Thread> io_thread) noexcept;
+
+  /// Check if the recorder was stopped.
+  bool IsStopped() const noexcept;
+
+  /// Open a new file and add it to the files written by the I/O thread, or
+  /// return null on error.
+  std::shared_ptr<detail::RecordingFile> OpenFile(
+      const std::string& path) noexcept;
+
+  /// Attach a recording to its track.
+  void StartRecording(
+      std::unique_ptr<detail::MediaRecording> recording) noexcept;
+
+  /// rtc::MessageHandler implementation, on the I/O thread.
+  void OnMessage(rtc::Message* msg) override;
+
+  /// Write the pending data of all files to disk. On the I/O thread.
+  void WriteFiles() noexcept;
+
+  /// Flush all files to the storage device. On the I/O thread.
+  void SyncFiles() noexcept;
+
+  /// Write the pending data and the patches of all files, and close them. On
+  /// the I/O thread.
+  void CloseFiles() noexcept;
+
+  const uint32_t write_buffer_size_;
+  const int32_t sync_interval_ms_;
+  const int64_t origin_ms_;
+
+  /// Thread writing the files.
+  std::unique_ptr<rtc::Thread> io_thread_;
+
+  /// Lock serializing the addition of recordings and the stopping of the
+  /// recorder, which attach and detach the recordings from their tracks. This
+  /// cannot be done under |mutex_|, which the recordings take while invoked
+  /// by their track.
+  std::mutex control_mutex_;
+
+  /// Lock for the recordings and the buffers of the files.
+  mutable std::mutex mutex_;
+
+  bool stopped_ RTC_GUARDED_BY(mutex_) = false;
+
+  std::vector<std::unique_ptr<detail::MediaRecording>> recordings_
+      RTC_GUARDED_BY(mutex_);
+
+  std::vector<std::shared_ptr<detail::RecordingFile>> files_
+      RTC_GUARDED_BY(mutex_);
+
+  /// Whether a write message is already posted to the I/O thread.
+  std::atomic_bool write_pending_{false};
+
+  std::atomic<uint64_t> bytes_written_{0};
+  std::atomic<uint32_t> write_errors_{0};
+};
+
+}  // namespace WebRTC
+}  // namespace MixedReality
+}  // namespace Microsoft
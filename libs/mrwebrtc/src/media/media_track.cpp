@@ -20,6 +20,7 @@ MediaTrack::MediaTrack(RefPtr<GlobalFactory> global_factory,
                        PeerConnection& owner) noexcept
     : TrackedObject(std::move(global_factory), object_type), owner_(&owner) {
   RTC_CHECK(owner_);
+  memory_account_ = owner.GetMemoryAccount();
 }
 
 MediaTrack::~MediaTrack() {
@@ -0,0 +1,46 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+
+namespace Microsoft {
+namespace MixedReality {
+namespace WebRTC {
+
+/// Identity of a video receive stream in the process. The decoders are created
+/// for the SDP stream ID of their receiver, which is only unique within its
+/// peer connection, and often is just the ID of the remote track, so it is
+/// combined with the unique ID of the peer connection receiving the stream.
+struct ReceiveStreamKey {
+  /// Unique ID of the peer connection; see |PeerConnection::GetUniqueId()|.
+  uint64_t peer_id{0};
+
+  /// SDP stream ID of the receiver.
+  std::string stream_id;
+
+  /// Check if the key does not identify any stream.
+  bool empty() const noexcept { return (peer_id == 0) || stream_id.empty(); }
+
+  bool operator==(const ReceiveStreamKey& other) const noexcept {
+    return (peer_id == other.peer_id) && (stream_id == other.stream_id);
+  }
+  bool operator!=(const ReceiveStreamKey& other) const noexcept {
+    return !(*this == other);
+  }
+};
+
+/// Hash of a |ReceiveStreamKey|, for unordered containers.
+struct ReceiveStreamKeyHash {
+  size_t operator()(const ReceiveStreamKey& key) const noexcept {
+    return std::hash<std::string>()(key.stream_id) ^
+           (std::hash<uint64_t>()(key.peer_id) * 31);
+  }
+};
+
+}  // namespace WebRTC
+}  // namespace MixedReality
+}  // namespace Microsoft
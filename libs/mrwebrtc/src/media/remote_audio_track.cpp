@@ -22,9 +22,11 @@ RemoteAudioTrack::RemoteAudioTrack(
     : MediaTrack(std::move(global_factory),
                  ObjectType::kRemoteAudioTrack,
                  owner),
+      AudioFrameObserver(this),
       track_(std::move(track)),
       receiver_(std::move(receiver)),
-      transceiver_(transceiver) {
+      transceiver_(transceiver),
+      audio_mixer_(owner.GetAudioMixer()) {
   RTC_CHECK(owner_);
   RTC_CHECK(track_);
   RTC_CHECK(receiver_);
@@ -62,7 +64,7 @@ void RemoteAudioTrack::OnTrackRemoved(PeerConnection& owner) {
 void RemoteAudioTrack::OutputToDevice(bool output) noexcept {
   output_to_device_ = output;
   if (ssrc_) {
-    global_factory_->audio_mixer()->OutputSource(*ssrc_, output);
+    audio_mixer_->OutputSource(*ssrc_, output);
   }
   // else SSRC is unknown and we can't change the output state now. InitSsrc
   // will do it when called.
@@ -75,12 +77,13 @@ void RemoteAudioTrack::InitSsrc(int ssrc) {
   // Now that we know the SSRC id, we can initialize the output state.
   // Note that the value is true by default but might have been changed
   // if OutputToDevice has been called in the track creation callback.
-  global_factory_->audio_mixer()->OutputSource(ssrc, output_to_device_);
+  audio_mixer_->OutputSource(ssrc, output_to_device_);
 }
 
 std::unique_ptr<AudioTrackReadBuffer> RemoteAudioTrack::CreateReadBuffer() const
     noexcept {
-  return std::make_unique<AudioTrackReadBuffer>(global_factory_, track_);
+  return std::make_unique<AudioTrackReadBuffer>(global_factory_, track_,
+                                                memory_account_);
 }
 
 }  // namespace WebRTC
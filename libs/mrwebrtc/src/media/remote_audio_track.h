@@ -107,6 +107,9 @@ class RemoteAudioTrack : public MediaTrack, public AudioFrameObserver {
   /// gets destroyed when detached from the transceiver.
   Transceiver* transceiver_{nullptr};
 
+  /// Audio mixer of the factory shard running the owning peer connection.
+  const rtc::scoped_refptr<ToggleAudioMixer> audio_mixer_;
+
   /// SSRC id of the corresponding RtpReceiver.
   absl::optional<int> ssrc_;
 
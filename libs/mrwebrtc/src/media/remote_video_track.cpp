@@ -3,10 +3,83 @@
 
 #include "pch.h"
 
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <unordered_map>
+
 #include "interop/global_factory.h"
 #include "peer_connection.h"
 #include "remote_video_track.h"
 
+namespace {
+
+using namespace Microsoft::MixedReality::WebRTC;
+
+/// Process-wide registry of the remote video tracks with an encoded frame
+/// callback, by receive stream.
+struct EncodedFrameRegistry {
+  static EncodedFrameRegistry& Instance() {
+    // Intentionally leaked, like the other process-wide registries.
+    static EncodedFrameRegistry* const instance = new EncodedFrameRegistry();
+    return *instance;
+  }
+
+  /// Pending key frame request of a receive stream, until the next key frame
+  /// or the removal of its track.
+  struct KeyFrameRequest {
+    int64_t requested_us;
+    std::shared_ptr<KeyFrameRequestStats> stats;
+  };
+
+  /// Lock for the registry and the callbacks of the tracks. The callbacks are
+  /// invoked without it, so that they can call back into the track, and a
+  /// slow callback does not stall the decoding of the other streams.
+  std::mutex mutex_;
+
+  /// Signaled when the dispatch of an encoded frame completes, for the changes
+  /// of consumers waiting for the frames dispatched to the previous ones.
+  std::condition_variable dispatch_done_;
+  std::unordered_multimap<ReceiveStreamKey,
+                          RemoteVideoTrack*,
+                          ReceiveStreamKeyHash>
+      tracks_;
+  std::unordered_map<ReceiveStreamKey, KeyFrameRequest, ReceiveStreamKeyHash>
+      key_frame_requests_;
+
+  /// Size of |key_frame_requests_|, read without the lock on each frame.
+  std::atomic<size_t> key_frame_request_count_{0};
+};
+
+/// Receive stream whose encoded frame is being dispatched by the current
+/// thread, if any. The frames of a stream are all dispatched by its decoding
+/// thread.
+thread_local const ReceiveStreamKey* t_dispatching_stream = nullptr;
+
+/// Consumers of the encoded frames of a track, copied under the lock of the
+/// registry to be invoked after releasing it.
+struct EncodedFrameConsumers {
+  RemoteVideoTrack* track;
+  EncodedVideoFrameCallback callback;
+  std::vector<EncodedVideoFrameSink*> sinks;
+};
+
+mrsVideoCodec ToVideoCodec(webrtc::VideoCodecType codec_type) {
+  switch (codec_type) {
+    case webrtc::kVideoCodecVP8:
+      return mrsVideoCodec::kVP8;
+    case webrtc::kVideoCodecVP9:
+      return mrsVideoCodec::kVP9;
+    case webrtc::kVideoCodecH264:
+      return mrsVideoCodec::kH264;
+    default:
+      return mrsVideoCodec::kUnknown;
+  }
+}
+
+}  // namespace
+
 namespace Microsoft {
 namespace MixedReality {
 namespace WebRTC {
@@ -20,6 +93,7 @@ RemoteVideoTrack::RemoteVideoTrack(
     : MediaTrack(std::move(global_factory),
                  ObjectType::kRemoteVideoTrack,
                  owner),
+      VideoFrameObserver(this),
       track_(std::move(track)),
       receiver_(std::move(receiver)),
       transceiver_(transceiver) {
@@ -37,6 +111,12 @@ RemoteVideoTrack::RemoteVideoTrack(
 }
 
 RemoteVideoTrack::~RemoteVideoTrack() {
+  UpdateRegistration([this]() {
+    encoded_callback_ = {};
+    encoded_sinks_.clear();
+    decode_enabled_ = true;
+    auto_decode_ = false;
+  });
   track_->RemoveSink(this);
   RTC_CHECK(!owner_);
 }
@@ -49,6 +129,208 @@ void RemoteVideoTrack::SetEnabled(bool enabled) const noexcept {
   track_->set_enabled(enabled);
 }
 
+void RemoteVideoTrack::SetEncodedFrameCallback(
+    EncodedVideoFrameCallback callback) noexcept {
+  callback.SetSite(this, mrsCallbackType::kEncodedVideoFrame);
+  UpdateRegistration([&]() { encoded_callback_ = std::move(callback); });
+}
+
+void RemoteVideoTrack::AddEncodedFrameSink(
+    EncodedVideoFrameSink* sink) noexcept {
+  UpdateRegistration([&]() { encoded_sinks_.push_back(sink); });
+}
+
+void RemoteVideoTrack::RemoveEncodedFrameSink(
+    EncodedVideoFrameSink* sink) noexcept {
+  UpdateRegistration([&]() {
+    auto it = std::find(encoded_sinks_.begin(), encoded_sinks_.end(), sink);
+    if (it != encoded_sinks_.end()) {
+      encoded_sinks_.erase(it);
+    }
+  });
+}
+
+void RemoteVideoTrack::SetDecodeEnabled(bool enabled) noexcept {
+  UpdateRegistration([&]() { decode_enabled_ = enabled; });
+}
+
+void RemoteVideoTrack::SetAutoDecode(bool enabled) noexcept {
+  UpdateRegistration([&]() { auto_decode_ = enabled; });
+}
+
+void RemoteVideoTrack::UpdateRegistration(
+    const std::function<void()>& update) noexcept {
+  // Resolve the stream outside of the lock, since this waits for the
+  // signaling thread.
+  ReceiveStreamKey key = GetReceiveStreamKey();
+  EncodedFrameRegistry& registry = EncodedFrameRegistry::Instance();
+  std::unique_lock<std::mutex> lock(registry.mutex_);
+  // Wait for the frames being dispatched to the current consumers, so that a
+  // consumer is never invoked once removed. When called from a consumer of the
+  // track, the frame it is invoked for is already dispatched to the others.
+  const int dispatching = ((t_dispatching_stream != nullptr) &&
+                           (*t_dispatching_stream == encoded_stream_key_))
+                              ? 1
+                              : 0;
+  registry.dispatch_done_.wait(
+      lock, [&]() { return (dispatch_count_ <= dispatching); });
+  if (!encoded_stream_key_.empty()) {
+    auto range = registry.tracks_.equal_range(encoded_stream_key_);
+    for (auto it = range.first; it != range.second; ++it) {
+      if (it->second == this) {
+        registry.tracks_.erase(it);
+        break;
+      }
+    }
+    encoded_stream_key_ = {};
+  }
+  update();
+  // Tracks with the default settings and no encoded frame consumer are always
+  // decoded, which the decoder assumes for the streams not registered.
+  const bool needs_registration = (encoded_callback_ ||
+                                   !encoded_sinks_.empty() ||
+                                   !decode_enabled_ || auto_decode_);
+  if (needs_registration && !key.empty()) {
+    encoded_stream_key_ = std::move(key);
+    registry.tracks_.emplace(encoded_stream_key_, this);
+  }
+}
+
+void RemoteVideoTrack::RequestKeyFrame() noexcept {
+  // The request is sent by the decoder of the stream on its next frame, the
+  // same way a decoder asks for a key frame after a decoding error.
+  PeerConnection* const owner = owner_;
+  ReceiveStreamKey key = GetReceiveStreamKey();
+  if (!owner || key.empty()) {
+    return;
+  }
+  std::shared_ptr<KeyFrameRequestStats> stats =
+      owner->GetKeyFrameRequestStats();
+  EncodedFrameRegistry& registry = EncodedFrameRegistry::Instance();
+  std::lock_guard<std::mutex> lock(registry.mutex_);
+  auto result = registry.key_frame_requests_.emplace(
+      std::move(key),
+      EncodedFrameRegistry::KeyFrameRequest{rtc::TimeMicros(), stats});
+  if (result.second) {
+    registry.key_frame_request_count_.store(
+        registry.key_frame_requests_.size(), std::memory_order_relaxed);
+    if (stats) {
+      stats->OnRequested();
+    }
+  }
+}
+
+std::string RemoteVideoTrack::GetReceiveStreamId() const noexcept {
+  // With Plan B the stream of the track is also named after the track.
+  std::string stream_id;
+  if (owner_ && receiver_) {
+    stream_id = owner_->GetReceiveStreamId(receiver_.get());
+  }
+  if (stream_id.empty()) {
+    stream_id = track_->id();
+  }
+  return stream_id;
+}
+
+ReceiveStreamKey RemoteVideoTrack::GetReceiveStreamKey() const noexcept {
+  ReceiveStreamKey key;
+  if (PeerConnection* const owner = owner_) {
+    key.peer_id = owner->GetUniqueId();
+    key.stream_id = GetReceiveStreamId();
+  }
+  return key;
+}
+
+bool RemoteVideoTrack::DispatchEncodedFrame(
+    const ReceiveStreamKey& key,
+    webrtc::VideoCodecType codec_type,
+    const webrtc::EncodedImage& image) noexcept {
+  if (key.empty()) {
+    return true;
+  }
+  EncodedFrameRegistry& registry = EncodedFrameRegistry::Instance();
+  std::vector<EncodedFrameConsumers> consumers;
+  bool decode = false;
+  {
+    std::lock_guard<std::mutex> lock(registry.mutex_);
+    auto range = registry.tracks_.equal_range(key);
+    if (range.first == range.second) {
+      return true;
+    }
+    for (auto it = range.first; it != range.second; ++it) {
+      RemoteVideoTrack* const track = it->second;
+      ++track->dispatch_count_;
+      consumers.push_back(EncodedFrameConsumers{
+          track, track->encoded_callback_, track->encoded_sinks_});
+      decode |= track->NeedsDecoding();
+    }
+  }
+  mrsEncodedVideoFrame frame{};
+  frame.codec = ToVideoCodec(codec_type);
+  frame.is_key_frame = (image._frameType == webrtc::kVideoFrameKey
+                            ? mrsBool::kTrue
+                            : mrsBool::kFalse);
+  frame.rtp_timestamp = image.Timestamp();
+  frame.width = image._encodedWidth;
+  frame.height = image._encodedHeight;
+  frame.receive_time_ms = rtc::TimeMillis();
+  frame.data = image._buffer;
+  frame.size = static_cast<uint32_t>(image._length);
+  t_dispatching_stream = &key;
+  for (const EncodedFrameConsumers& consumer : consumers) {
+    consumer.callback(frame);
+    for (EncodedVideoFrameSink* sink : consumer.sinks) {
+      sink->OnEncodedFrame(frame);
+    }
+  }
+  t_dispatching_stream = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(registry.mutex_);
+    for (const EncodedFrameConsumers& consumer : consumers) {
+      --consumer.track->dispatch_count_;
+    }
+  }
+  registry.dispatch_done_.notify_all();
+  return decode;
+}
+
+bool RemoteVideoTrack::ProcessKeyFrameRequest(const ReceiveStreamKey& key,
+                                              bool is_key_frame) noexcept {
+  EncodedFrameRegistry& registry = EncodedFrameRegistry::Instance();
+  if (registry.key_frame_request_count_.load(std::memory_order_relaxed) ==
+      0) {
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(registry.mutex_);
+  auto it = registry.key_frame_requests_.find(key);
+  if (it == registry.key_frame_requests_.end()) {
+    return false;
+  }
+  if (!is_key_frame) {
+    return true;
+  }
+  if (it->second.stats) {
+    it->second.stats->OnCompleted(rtc::TimeMicros() - it->second.requested_us);
+  }
+  registry.key_frame_requests_.erase(it);
+  registry.key_frame_request_count_.store(registry.key_frame_requests_.size(),
+                                          std::memory_order_relaxed);
+  return false;
+}
+
+bool RemoteVideoTrack::NeedsDecoding() const noexcept {
+  if (!decode_enabled_) {
+    return false;
+  }
+  // The decoded frames are only consumed by the raw frame callback. Tracks in
+  // automatic mode or whose encoded frames are consumed are only decoded while
+  // it is registered, and the other ones always are.
+  if (auto_decode_ || encoded_callback_ || !encoded_sinks_.empty()) {
+    return HasCallback();
+  }
+  return true;
+}
+
 webrtc::VideoTrackInterface* RemoteVideoTrack::impl() const {
   return track_.get();
 }
@@ -61,6 +343,17 @@ void RemoteVideoTrack::OnTrackRemoved(PeerConnection& owner) {
   RTC_DCHECK(owner_ == &owner);
   RTC_DCHECK(receiver_ != nullptr);
   RTC_DCHECK(transceiver_ != nullptr);
+  {
+    // Drop the pending key frame request, which a later stream reusing the
+    // same ID must not inherit.
+    const ReceiveStreamKey key = GetReceiveStreamKey();
+    EncodedFrameRegistry& registry = EncodedFrameRegistry::Instance();
+    std::lock_guard<std::mutex> lock(registry.mutex_);
+    if (registry.key_frame_requests_.erase(key) > 0) {
+      registry.key_frame_request_count_.store(
+          registry.key_frame_requests_.size(), std::memory_order_relaxed);
+    }
+  }
   owner_ = nullptr;
   receiver_ = nullptr;
   transceiver_->OnRemoteTrackRemoved(this);
@@ -3,13 +3,21 @@
 
 #pragma once
 
+#include <functional>
+#include <string>
+#include <vector>
+
 #include "callback.h"
+#include "encoded_frame_interop.h"
 #include "interop_api.h"
+#include "media/receive_stream_key.h"
 #include "media_track.h"
 #include "refptr.h"
 #include "tracked_object.h"
 #include "video_frame_observer.h"
 
+#include "modules/video_coding/include/video_codec_interface.h"
+
 namespace rtc {
 template <typename T>
 class scoped_refptr;
@@ -27,6 +35,19 @@ namespace WebRTC {
 class PeerConnection;
 class Transceiver;
 
+/// Callback fired on newly received encoded video frame, before decoding.
+using EncodedVideoFrameCallback = Callback<const mrsEncodedVideoFrame&>;
+
+/// Internal sink of the encoded frames received by a remote video track.
+class EncodedVideoFrameSink {
+ public:
+  virtual ~EncodedVideoFrameSink() = default;
+
+  /// Called on the decoding thread with each encoded frame received. The frame
+  /// is only valid for the duration of the call.
+  virtual void OnEncodedFrame(const mrsEncodedVideoFrame& frame) noexcept = 0;
+};
+
 /// A remote video track is a media track for a peer connection backed by a
 /// remote video stream received from the remote peer.
 ///
@@ -52,6 +73,34 @@ class RemoteVideoTrack : public MediaTrack, public VideoFrameObserver {
   /// See |SetEnabled(bool)|.
   MRS_NODISCARD bool IsEnabled() const noexcept;
 
+  /// Register a callback invoked with the encoded frames received, before they
+  /// are decoded. While this callback is registered and no raw frame callback
+  /// is, the frames are not decoded at all. The callback is invoked on the
+  /// decoding thread; it must not register or unregister itself.
+  void SetEncodedFrameCallback(EncodedVideoFrameCallback callback) noexcept;
+
+  /// Add an internal sink of the encoded frames received, which behaves like
+  /// an encoded frame callback. The sink must be removed before being
+  /// destroyed.
+  void AddEncodedFrameSink(EncodedVideoFrameSink* sink) noexcept;
+
+  /// Remove a sink added with |AddEncodedFrameSink()|. Once this returns, the
+  /// sink is not invoked anymore.
+  void RemoveEncodedFrameSink(EncodedVideoFrameSink* sink) noexcept;
+
+  /// Enable or disable the decoding of the frames received. See
+  /// |mrsRemoteVideoTrackSetDecodeEnabled()|.
+  void SetDecodeEnabled(bool enabled) noexcept;
+
+  /// Enable or disable the automatic decoding of the frames received, only
+  /// while a raw frame callback is registered. See
+  /// |mrsRemoteVideoTrackSetAutoDecode()|.
+  void SetAutoDecode(bool enabled) noexcept;
+
+  /// Request a key frame from the remote sender of the track. See
+  /// |mrsRemoteVideoTrackRequestKeyFrame()|.
+  void RequestKeyFrame() noexcept;
+
   //
   // Advanced use
   //
@@ -75,10 +124,45 @@ class RemoteVideoTrack : public MediaTrack, public VideoFrameObserver {
     return impl();
   }
 
+  /// Get the ID of the receive stream of the track, which its decoder is
+  /// created for.
+  MRS_NODISCARD std::string GetReceiveStreamId() const noexcept;
+
+  /// Get the key of the receive stream of the track, which is empty once the
+  /// track is removed from its peer connection.
+  MRS_NODISCARD ReceiveStreamKey GetReceiveStreamKey() const noexcept;
+
+  /// Dispatch an encoded frame received on a stream to the encoded frame
+  /// callback of its remote video track, if any. Called from the decoding
+  /// thread of the stream. Return false if the frame does not need to be
+  /// decoded, because the encoded frames are the only ones consumed or the
+  /// decoding of the track is paused.
+  static bool DispatchEncodedFrame(const ReceiveStreamKey& key,
+                                   webrtc::VideoCodecType codec_type,
+                                   const webrtc::EncodedImage& image) noexcept;
+
+  /// Process the pending key frame request of the track of a stream, if any,
+  /// on reception of a frame. Requests are dropped when their track is removed
+  /// from its peer connection. Called from the decoding thread of the stream.
+  /// This completes the request on key frames, and returns true on delta
+  /// frames received while a request is pending, for which the decoder must
+  /// ask the sender for a key frame.
+  static bool ProcessKeyFrameRequest(const ReceiveStreamKey& key,
+                                     bool is_key_frame) noexcept;
+
   // Automatically called - do not use.
   void OnTrackRemoved(PeerConnection& owner);
 
  private:
+  /// Apply a change to the consumers of the encoded frames or to the decoding
+  /// settings, and register or unregister the track for its receive stream
+  /// accordingly.
+  void UpdateRegistration(const std::function<void()>& update) noexcept;
+
+  /// Check if the frames received need to be decoded. Called with the lock of
+  /// the registry of encoded frame callbacks.
+  bool NeedsDecoding() const noexcept;
+
   /// Underlying core implementation.
   rtc::scoped_refptr<webrtc::VideoTrackInterface> track_;
 
@@ -90,6 +174,29 @@ class RemoteVideoTrack : public MediaTrack, public VideoFrameObserver {
   /// Note that unlike local tracks, this is never NULL since the remote track
   /// gets destroyed when detached from the transceiver.
   Transceiver* transceiver_{nullptr};
+
+  /// Callback for the encoded frames received. Guarded by the lock of the
+  /// registry of encoded frame callbacks.
+  EncodedVideoFrameCallback encoded_callback_;
+
+  /// Internal sinks of the encoded frames received. Guarded by the lock of the
+  /// registry of encoded frame callbacks.
+  std::vector<EncodedVideoFrameSink*> encoded_sinks_;
+
+  /// Decoding settings. Guarded by the lock of the registry of encoded frame
+  /// callbacks.
+  bool decode_enabled_ = true;
+  bool auto_decode_ = false;
+
+  /// Receive stream the track is registered for, or empty if not
+  /// registered. Guarded by the lock of the registry of encoded frame
+  /// callbacks.
+  ReceiveStreamKey encoded_stream_key_;
+
+  /// Number of encoded frames being dispatched to the consumers of the track
+  /// outside of the lock of the registry of encoded frame callbacks, which
+  /// guards it.
+  int dispatch_count_ = 0;
 };
 
 }  // namespace WebRTC
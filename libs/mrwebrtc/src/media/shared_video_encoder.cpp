@@ -0,0 +1,961 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+// This is a precompiled header, it must be on its own, followed by a blank
+// line, to prevent clang-format from reordering it with other headers.
+#include "pch.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <deque>
+#include <limits>
+
+#include "shared_video_encoder.h"
+
+#include "api/video/video_bitrate_allocation.h"
+#include "modules/include/module_common_types.h"
+#include "modules/video_coding/include/video_codec_interface.h"
+#include "rtc_base/timeutils.h"
+
+namespace {
+
+/// Number of encoded frames kept by an encoder for the senders lagging behind
+/// the one which triggered the encoding.
+constexpr size_t kMaxCachedFrames = 8;
+
+/// Bitrate of the lowest tier, and ratio between the bitrates of consecutive
+/// tiers. The senders of a group whose bitrates are in the same tier share an
+/// encoder, so that a single constrained sender does not lower the quality of
+/// all the others.
+constexpr double kMinTierBps = 50000.0;
+constexpr double kTierRatio = 2.0;
+
+/// Ratio by which the bitrate of a sender can go past the bounds of a tier and
+/// still be encoded in that tier, so that the continuous adaptation of the
+/// bitrate does not move senders back and forth between encoders, with a key
+/// frame each time.
+constexpr double kTierHysteresis = 1.25;
+
+/// Delay after the creation of a group during which the proxies alone in their
+/// group try to merge with another group on each frame. Frames are broadcast
+/// to all senders at the same time, but each sender encodes on its own thread,
+/// so the first frames of new senders of the same track can reach the registry
+/// in any order, and create separate groups.
+constexpr int64_t kMergeWindowMs = 1000;
+
+/// Get the bitrate tier of a bitrate in bits per second.
+int GetBitrateTier(double bps) {
+  if (bps <= kMinTierBps) {
+    return 0;
+  }
+  return static_cast<int>(std::log(bps / kMinTierBps) / std::log(kTierRatio));
+}
+
+/// Check whether a bitrate in bits per second can be encoded in a tier.
+bool IsInTier(double bps, int tier) {
+  return (GetBitrateTier(bps / kTierHysteresis) <= tier) &&
+         (tier <= GetBitrateTier(bps * kTierHysteresis));
+}
+
+/// Identity of a raw video frame, shared by all the senders of a track.
+struct FrameKey {
+  const webrtc::VideoFrameBuffer* buffer{nullptr};
+  int64_t timestamp_us{0};
+
+  bool operator==(const FrameKey& other) const {
+    return (buffer == other.buffer) && (timestamp_us == other.timestamp_us);
+  }
+};
+
+FrameKey GetFrameKey(const webrtc::VideoFrame& frame) {
+  return FrameKey{frame.video_frame_buffer().get(), frame.timestamp_us()};
+}
+
+/// Check whether two encoder configurations produce the same bitstream, all
+/// other things being equal. Bitrates are not compared, since they are adapted
+/// continuously.
+bool IsSameConfig(const webrtc::SdpVideoFormat& format1,
+                  const webrtc::VideoCodec& settings1,
+                  const webrtc::SdpVideoFormat& format2,
+                  const webrtc::VideoCodec& settings2) {
+  if ((format1.name != format2.name) ||
+      (format1.parameters != format2.parameters) ||
+      (settings1.codecType != settings2.codecType) ||
+      (settings1.width != settings2.width) ||
+      (settings1.height != settings2.height) ||
+      (settings1.maxFramerate != settings2.maxFramerate) ||
+      (settings1.qpMax != settings2.qpMax) ||
+      (settings1.mode != settings2.mode) ||
+      (settings1.numberOfSimulcastStreams !=
+       settings2.numberOfSimulcastStreams)) {
+    return false;
+  }
+  for (int i = 0; i < settings1.numberOfSimulcastStreams; ++i) {
+    const webrtc::SimulcastStream& stream1 = settings1.simulcastStream[i];
+    const webrtc::SimulcastStream& stream2 = settings2.simulcastStream[i];
+    if ((stream1.width != stream2.width) ||
+        (stream1.height != stream2.height) ||
+        (stream1.numberOfTemporalLayers != stream2.numberOfTemporalLayers)) {
+      return false;
+    }
+  }
+  switch (settings1.codecType) {
+    case webrtc::kVideoCodecVP8: {
+      const webrtc::VideoCodecVP8& vp8_1 = settings1.VP8();
+      const webrtc::VideoCodecVP8& vp8_2 = settings2.VP8();
+      return (vp8_1.numberOfTemporalLayers == vp8_2.numberOfTemporalLayers) &&
+             (vp8_1.automaticResizeOn == vp8_2.automaticResizeOn) &&
+             (vp8_1.frameDroppingOn == vp8_2.frameDroppingOn) &&
+             (vp8_1.keyFrameInterval == vp8_2.keyFrameInterval);
+    }
+    case webrtc::kVideoCodecVP9: {
+      const webrtc::VideoCodecVP9& vp9_1 = settings1.VP9();
+      const webrtc::VideoCodecVP9& vp9_2 = settings2.VP9();
+      return (vp9_1.numberOfTemporalLayers == vp9_2.numberOfTemporalLayers) &&
+             (vp9_1.numberOfSpatialLayers == vp9_2.numberOfSpatialLayers) &&
+             (vp9_1.frameDroppingOn == vp9_2.frameDroppingOn) &&
+             (vp9_1.keyFrameInterval == vp9_2.keyFrameInterval) &&
+             (vp9_1.flexibleMode == vp9_2.flexibleMode);
+    }
+    case webrtc::kVideoCodecH264: {
+      const webrtc::VideoCodecH264& h264_1 = settings1.H264();
+      const webrtc::VideoCodecH264& h264_2 = settings2.H264();
+      return (h264_1.frameDroppingOn == h264_2.frameDroppingOn) &&
+             (h264_1.keyFrameInterval == h264_2.keyFrameInterval);
+    }
+    default:
+      return true;
+  }
+}
+
+class SharedEncoderGroup;
+
+/// Encoder handed out to a single video sender, forwarding its frames to the
+/// shared encoder of its group.
+class SharedEncoderProxy : public webrtc::VideoEncoder {
+ public:
+  SharedEncoderProxy(std::shared_ptr<webrtc::VideoEncoderFactory> factory,
+                     const webrtc::SdpVideoFormat& format)
+      : factory_(std::move(factory)), format_(format) {}
+  ~SharedEncoderProxy() override { Release(); }
+
+  int32_t InitEncode(const webrtc::VideoCodec* codec_settings,
+                     int32_t number_of_cores,
+                     size_t max_payload_size) override;
+  int32_t RegisterEncodeCompleteCallback(
+      webrtc::EncodedImageCallback* callback) override;
+  int32_t Release() override;
+  int32_t Encode(const webrtc::VideoFrame& frame,
+                 const webrtc::CodecSpecificInfo* codec_specific_info,
+                 const std::vector<webrtc::FrameType>* frame_types) override;
+  int32_t SetChannelParameters(uint32_t packet_loss, int64_t rtt) override;
+  int32_t SetRateAllocation(const webrtc::VideoBitrateAllocation& allocation,
+                            uint32_t framerate) override;
+  const char* ImplementationName() const override { return "SharedEncoder"; }
+
+ private:
+  std::shared_ptr<webrtc::VideoEncoderFactory> factory_;
+  const webrtc::SdpVideoFormat format_;
+  webrtc::VideoCodec settings_{};
+  int32_t number_of_cores_{1};
+  size_t max_payload_size_{0};
+  bool initialized_{false};
+  webrtc::EncodedImageCallback* callback_{nullptr};
+  webrtc::VideoBitrateAllocation allocation_;
+  uint32_t framerate_{0};
+
+  /// Group this proxy belongs to, once it encoded its first frame.
+  std::shared_ptr<SharedEncoderGroup> group_;
+};
+
+/// Group of proxies encoding the same frames with the same configuration.
+///
+/// The proxies are split by bitrate tier, and the group runs one encoder per
+/// tier, so each frame is encoded once per distinct tier instead of once per
+/// proxy.
+///
+/// All accesses to the encoders are serialized by a recursive mutex, since
+/// synchronous encoders invoke |OnEncodedImage()| from inside |Encode()|, while
+/// hardware encoders may invoke it from their own thread.
+class SharedEncoderGroup {
+ public:
+  SharedEncoderGroup(std::shared_ptr<webrtc::VideoEncoderFactory> factory,
+                     const webrtc::SdpVideoFormat& format,
+                     const webrtc::VideoCodec& settings,
+                     int32_t number_of_cores,
+                     size_t max_payload_size,
+                     const webrtc::VideoFrame& first_frame)
+      : factory_(std::move(factory)),
+        format_(format),
+        settings_(settings),
+        number_of_cores_(number_of_cores),
+        max_payload_size_(max_payload_size),
+        first_frame_(GetFrameKey(first_frame)) {}
+
+  /// Check whether a proxy can join this group to encode a frame.
+  bool Accepts(const webrtc::SdpVideoFormat& format,
+               const webrtc::VideoCodec& settings,
+               const webrtc::VideoFrame& frame) {
+    if (!IsSameConfig(format_, settings_, format, settings)) {
+      return false;
+    }
+    const FrameKey key = GetFrameKey(frame);
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+    if (key == first_frame_) {
+      return true;
+    }
+    return std::any_of(layers_.begin(), layers_.end(),
+                       [&key](const std::unique_ptr<Layer>& layer) {
+                         return (layer->FindEntry(key) != nullptr);
+                       });
+  }
+
+  /// Add a proxy to the encoder of the tier of its bitrate, and return false
+  /// if that encoder could not be created.
+  bool AddMember(SharedEncoderProxy* proxy,
+                 webrtc::EncodedImageCallback* callback,
+                 const webrtc::VideoBitrateAllocation& allocation,
+                 uint32_t framerate) {
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+    Member member;
+    member.proxy = proxy;
+    member.callback = callback;
+    member.allocation = allocation;
+    member.framerate = framerate;
+    Layer* const layer = GetLayerNoLock(ChooseTierNoLock(member));
+    if (!layer) {
+      return false;
+    }
+    member.layer = layer;
+    layer->rates_dirty_ = true;
+    members_.push_back(member);
+    return true;
+  }
+
+  /// Remove a proxy from the group, and return the number of proxies left.
+  /// Once this returns, no encoded frame is delivered to the proxy anymore.
+  size_t RemoveMember(SharedEncoderProxy* proxy) {
+    std::vector<std::unique_ptr<Layer>> released;
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+    auto it = std::find_if(
+        members_.begin(), members_.end(),
+        [proxy](const Member& member) { return (member.proxy == proxy); });
+    if (it != members_.end()) {
+      UnsubscribeNoLock(*it->layer, proxy);
+      it->layer->rates_dirty_ = true;
+      members_.erase(it);
+      released = TakeUnusedLayersNoLock();
+    }
+    return members_.size();
+  }
+
+  size_t GetMemberCount() const {
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+    return members_.size();
+  }
+
+  /// Get the number of encoders the group is running.
+  size_t GetEncoderCount() const {
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+    return layers_.size();
+  }
+
+  void SetCallback(SharedEncoderProxy* proxy,
+                   webrtc::EncodedImageCallback* callback) {
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+    if (Member* member = FindMemberNoLock(proxy)) {
+      member->callback = callback;
+    }
+  }
+
+  /// Update the rates of a proxy, moving it to the encoder of another tier if
+  /// its bitrate left the tier of its current encoder.
+  void SetRates(SharedEncoderProxy* proxy,
+                const webrtc::VideoBitrateAllocation& allocation,
+                uint32_t framerate);
+
+  /// Encode a frame for a proxy, or forward the frame already encoded for
+  /// another proxy of the same tier.
+  int32_t Encode(SharedEncoderProxy* proxy,
+                 const webrtc::VideoFrame& frame,
+                 bool key_frame_requested);
+
+ private:
+  class Layer;
+
+  struct Member {
+    SharedEncoderProxy* proxy{nullptr};
+    webrtc::EncodedImageCallback* callback{nullptr};
+    webrtc::VideoBitrateAllocation allocation;
+    uint32_t framerate{0};
+
+    /// Encoder of the tier of the proxy.
+    Layer* layer{nullptr};
+
+    /// Sequence number of the last frame delivered to the proxy by its
+    /// encoder, or -1 if none. Delta frames are only delivered in sequence.
+    int64_t last_seq{-1};
+  };
+
+  /// Proxy a frame is delivered to, with the RTP timestamp and capture time of
+  /// its own copy of the raw frame.
+  struct Subscriber {
+    SharedEncoderProxy* proxy{nullptr};
+    uint32_t rtp_timestamp{0};
+    int64_t capture_time_ms{0};
+  };
+
+  /// Encoded image copied out of an encoder.
+  struct Output {
+    std::vector<uint8_t> data;
+    webrtc::EncodedImage image;
+    bool has_codec_specific_info{false};
+    webrtc::CodecSpecificInfo codec_specific_info;
+    std::unique_ptr<webrtc::RTPFragmentationHeader> fragmentation;
+  };
+
+  /// Raw frame encoded by an encoder, and its encoded images. A frame has
+  /// several encoded images with simulcast.
+  struct Entry {
+    FrameKey key;
+    uint32_t rtp_timestamp{0};
+    int64_t seq{0};
+    bool key_frame{false};
+    std::vector<std::unique_ptr<Output>> outputs;
+    std::vector<Subscriber> subscribers;
+  };
+
+  /// Encoder of the proxies of a single bitrate tier, with the frames it
+  /// encoded last.
+  class Layer : public webrtc::EncodedImageCallback {
+   public:
+    Layer(SharedEncoderGroup& group, int tier) : group_(group), tier_(tier) {}
+    ~Layer() override {
+      if (encoder_) {
+        encoder_->Release();
+      }
+    }
+
+    Entry* FindEntry(const FrameKey& key) {
+      auto it = std::find_if(
+          entries_.begin(), entries_.end(),
+          [&key](const Entry& entry) { return (entry.key == key); });
+      return (it != entries_.end() ? &*it : nullptr);
+    }
+
+    //
+    // EncodedImageCallback interface
+    //
+
+    Result OnEncodedImage(
+        const webrtc::EncodedImage& encoded_image,
+        const webrtc::CodecSpecificInfo* codec_specific_info,
+        const webrtc::RTPFragmentationHeader* fragmentation) override {
+      std::lock_guard<std::recursive_mutex> lock(group_.mutex_);
+      return group_.OnEncodedImageNoLock(*this, encoded_image,
+                                         codec_specific_info, fragmentation);
+    }
+    void OnDroppedFrame(DropReason reason) override {
+      std::lock_guard<std::recursive_mutex> lock(group_.mutex_);
+      group_.OnDroppedFrameNoLock(*this, reason);
+    }
+
+    SharedEncoderGroup& group_;
+    const int tier_;
+    std::unique_ptr<webrtc::VideoEncoder> encoder_;
+    std::deque<Entry> entries_;
+    int64_t next_seq_{0};
+    bool key_frame_pending_{true};
+    bool rates_dirty_{true};
+  };
+
+  Member* FindMemberNoLock(SharedEncoderProxy* proxy) {
+    auto it = std::find_if(
+        members_.begin(), members_.end(),
+        [proxy](const Member& member) { return (member.proxy == proxy); });
+    return (it != members_.end() ? &*it : nullptr);
+  }
+
+  /// Get the tier a member is encoded in. Members stay in the tier of their
+  /// current encoder, or join the encoder of an existing tier, as long as
+  /// their bitrate allows it.
+  int ChooseTierNoLock(const Member& member) const;
+
+  /// Find the encoder of a tier, or create it.
+  Layer* GetLayerNoLock(int tier);
+
+  /// Remove the encoders without members, to be destroyed by the caller once
+  /// the mutex is released, since some encoders wait for their own thread.
+  std::vector<std::unique_ptr<Layer>> TakeUnusedLayersNoLock();
+
+  /// Stop delivering the frames of an encoder to a proxy.
+  void UnsubscribeNoLock(Layer& layer, SharedEncoderProxy* proxy);
+
+  /// Apply the lowest bitrate allocation of the members of a tier to its
+  /// encoder, so that the encoded frames fit the most constrained sender.
+  void ApplyRatesNoLock(Layer& layer);
+
+  /// Register a proxy for the encoded images of an entry, and deliver the ones
+  /// already available.
+  void SubscribeNoLock(Member& member,
+                       Entry& entry,
+                       const webrtc::VideoFrame& frame);
+
+  void DeliverNoLock(const Subscriber& subscriber, const Output& output);
+
+  webrtc::EncodedImageCallback::Result OnEncodedImageNoLock(
+      Layer& layer,
+      const webrtc::EncodedImage& encoded_image,
+      const webrtc::CodecSpecificInfo* codec_specific_info,
+      const webrtc::RTPFragmentationHeader* fragmentation);
+  void OnDroppedFrameNoLock(Layer& layer,
+                            webrtc::EncodedImageCallback::DropReason reason);
+
+  const std::shared_ptr<webrtc::VideoEncoderFactory> factory_;
+  const webrtc::SdpVideoFormat format_;
+  const webrtc::VideoCodec settings_;
+  const int32_t number_of_cores_;
+  const size_t max_payload_size_;
+
+  /// First frame of the proxy which created the group, so that the other
+  /// proxies can join before it is encoded.
+  const FrameKey first_frame_;
+
+  mutable std::recursive_mutex mutex_;
+  std::vector<Member> members_;
+  std::vector<std::unique_ptr<Layer>> layers_;
+};
+
+/// Process-wide registry of the encoder groups.
+struct SharedEncoderRegistry {
+  static SharedEncoderRegistry& Instance() {
+    // Intentionally leaked, like the other process-wide singletons, since
+    // encoders can be destroyed during static destruction.
+    static SharedEncoderRegistry* const instance = new SharedEncoderRegistry();
+    return *instance;
+  }
+
+  /// Find or create the group a proxy encodes a frame with.
+  std::shared_ptr<SharedEncoderGroup> Join(
+      SharedEncoderProxy* proxy,
+      webrtc::EncodedImageCallback* callback,
+      const std::shared_ptr<webrtc::VideoEncoderFactory>& factory,
+      const webrtc::SdpVideoFormat& format,
+      const webrtc::VideoCodec& settings,
+      int32_t number_of_cores,
+      size_t max_payload_size,
+      const webrtc::VideoBitrateAllocation& allocation,
+      uint32_t framerate,
+      const webrtc::VideoFrame& frame) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto&& group : groups_) {
+      if (group->Accepts(format, settings, frame)) {
+        if (!group->AddMember(proxy, callback, allocation, framerate)) {
+          RTC_LOG(LS_ERROR) << "Failed to initialize shared " << format.name
+                            << " encoder.";
+          return nullptr;
+        }
+        return group;
+      }
+    }
+    auto group = std::make_shared<SharedEncoderGroup>(
+        factory, format, settings, number_of_cores, max_payload_size, frame);
+    if (!group->AddMember(proxy, callback, allocation, framerate)) {
+      RTC_LOG(LS_ERROR) << "Failed to initialize shared " << format.name
+                        << " encoder.";
+      return nullptr;
+    }
+    groups_.push_back(group);
+    last_group_created_ms_.store(rtc::TimeMillis(), std::memory_order_relaxed);
+    return group;
+  }
+
+  /// Check whether a group was created recently enough that it may be encoding
+  /// the same frames as another group.
+  bool IsMergePending() const {
+    return (rtc::TimeMillis() <
+            last_group_created_ms_.load(std::memory_order_relaxed) +
+                kMergeWindowMs);
+  }
+
+  /// Move a proxy alone in its group to another group already encoding the
+  /// given frame, and return that group, or null if there is none. This merges
+  /// the groups created by senders of the same frames whose first frames were
+  /// not encoded yet by the others when they joined.
+  std::shared_ptr<SharedEncoderGroup> Merge(
+      SharedEncoderProxy* proxy,
+      webrtc::EncodedImageCallback* callback,
+      const std::shared_ptr<SharedEncoderGroup>& current,
+      const webrtc::SdpVideoFormat& format,
+      const webrtc::VideoCodec& settings,
+      const webrtc::VideoBitrateAllocation& allocation,
+      uint32_t framerate,
+      const webrtc::VideoFrame& frame) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (current->GetMemberCount() != 1) {
+      return nullptr;
+    }
+    for (auto&& group : groups_) {
+      if ((group != current) && group->Accepts(format, settings, frame) &&
+          group->AddMember(proxy, callback, allocation, framerate)) {
+        current->RemoveMember(proxy);
+        groups_.erase(std::remove(groups_.begin(), groups_.end(), current),
+                      groups_.end());
+        return group;
+      }
+    }
+    return nullptr;
+  }
+
+  void Leave(SharedEncoderProxy* proxy,
+             const std::shared_ptr<SharedEncoderGroup>& group) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (group->RemoveMember(proxy) == 0) {
+      groups_.erase(std::remove(groups_.begin(), groups_.end(), group),
+                    groups_.end());
+    }
+  }
+
+  void GetStats(mrsSharedVideoEncoderStats& stats) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats.encoder_count = 0;
+    stats.sender_count = 0;
+    for (auto&& group : groups_) {
+      stats.encoder_count += static_cast<uint32_t>(group->GetEncoderCount());
+      stats.sender_count += static_cast<uint32_t>(group->GetMemberCount());
+    }
+    stats.frames_encoded = frames_encoded_.load(std::memory_order_relaxed);
+    stats.frames_delivered = frames_delivered_.load(std::memory_order_relaxed);
+    stats.key_frame_requests =
+        key_frame_requests_.load(std::memory_order_relaxed);
+    stats.key_frames_encoded =
+        key_frames_encoded_.load(std::memory_order_relaxed);
+  }
+
+  std::atomic_bool enabled_{false};
+  std::atomic<uint64_t> frames_encoded_{0};
+  std::atomic<uint64_t> frames_delivered_{0};
+  std::atomic<uint64_t> key_frame_requests_{0};
+  std::atomic<uint64_t> key_frames_encoded_{0};
+
+ private:
+  std::mutex mutex_;
+  std::vector<std::shared_ptr<SharedEncoderGroup>> groups_;
+
+  /// Time of the creation of the last group, in milliseconds.
+  std::atomic<int64_t> last_group_created_ms_{
+      std::numeric_limits<int64_t>::min() / 2};
+};
+
+int32_t SharedEncoderProxy::InitEncode(const webrtc::VideoCodec* codec_settings,
+                                       int32_t number_of_cores,
+                                       size_t max_payload_size) {
+  if (!codec_settings) {
+    return WEBRTC_VIDEO_CODEC_ERR_PARAMETER;
+  }
+  // Settings changed, the proxy joins a new group on its next frame
+  Release();
+  settings_ = *codec_settings;
+  number_of_cores_ = number_of_cores;
+  max_payload_size_ = max_payload_size;
+  initialized_ = true;
+  return WEBRTC_VIDEO_CODEC_OK;
+}
+
+int32_t SharedEncoderProxy::RegisterEncodeCompleteCallback(
+    webrtc::EncodedImageCallback* callback) {
+  callback_ = callback;
+  if (group_) {
+    group_->SetCallback(this, callback);
+  }
+  return WEBRTC_VIDEO_CODEC_OK;
+}
+
+int32_t SharedEncoderProxy::Release() {
+  if (group_) {
+    SharedEncoderRegistry::Instance().Leave(this, group_);
+    group_.reset();
+  }
+  return WEBRTC_VIDEO_CODEC_OK;
+}
+
+int32_t SharedEncoderProxy::Encode(
+    const webrtc::VideoFrame& frame,
+    const webrtc::CodecSpecificInfo* /*codec_specific_info*/,
+    const std::vector<webrtc::FrameType>* frame_types) {
+  if (!initialized_) {
+    return WEBRTC_VIDEO_CODEC_UNINITIALIZED;
+  }
+  SharedEncoderRegistry& registry = SharedEncoderRegistry::Instance();
+  if (!group_) {
+    group_ = registry.Join(this, callback_, factory_, format_, settings_,
+                           number_of_cores_, max_payload_size_, allocation_,
+                           framerate_, frame);
+    if (!group_) {
+      return WEBRTC_VIDEO_CODEC_ERROR;
+    }
+  } else if (registry.IsMergePending() && (group_->GetMemberCount() == 1)) {
+    if (auto group = registry.Merge(this, callback_, group_, format_,
+                                    settings_, allocation_, framerate_,
+                                    frame)) {
+      group_ = std::move(group);
+    }
+  }
+  const bool key_frame_requested =
+      frame_types && (std::find(frame_types->begin(), frame_types->end(),
+                                webrtc::kVideoFrameKey) != frame_types->end());
+  return group_->Encode(this, frame, key_frame_requested);
+}
+
+int32_t SharedEncoderProxy::SetChannelParameters(uint32_t /*packet_loss*/,
+                                                 int64_t /*rtt*/) {
+  // Loss and RTT differ per sender, and are not used by the built-in
+  // encoders anyway.
+  return WEBRTC_VIDEO_CODEC_OK;
+}
+
+int32_t SharedEncoderProxy::SetRateAllocation(
+    const webrtc::VideoBitrateAllocation& allocation,
+    uint32_t framerate) {
+  allocation_ = allocation;
+  framerate_ = framerate;
+  if (group_) {
+    group_->SetRates(this, allocation, framerate);
+  }
+  return WEBRTC_VIDEO_CODEC_OK;
+}
+
+void SharedEncoderGroup::SetRates(
+    SharedEncoderProxy* proxy,
+    const webrtc::VideoBitrateAllocation& allocation,
+    uint32_t framerate) {
+  std::vector<std::unique_ptr<Layer>> released;
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  Member* const member = FindMemberNoLock(proxy);
+  if (!member) {
+    return;
+  }
+  member->allocation = allocation;
+  member->framerate = framerate;
+  member->layer->rates_dirty_ = true;
+  const int tier = ChooseTierNoLock(*member);
+  if (tier == member->layer->tier_) {
+    return;
+  }
+  // Keep the current encoder if the one of the new tier cannot be created
+  Layer* const layer = GetLayerNoLock(tier);
+  if (!layer) {
+    return;
+  }
+  UnsubscribeNoLock(*member->layer, proxy);
+  member->layer = layer;
+  // The proxy cannot decode the delta frames of another encoder
+  member->last_seq = -1;
+  layer->rates_dirty_ = true;
+  released = TakeUnusedLayersNoLock();
+}
+
+int32_t SharedEncoderGroup::Encode(SharedEncoderProxy* proxy,
+                                   const webrtc::VideoFrame& frame,
+                                   bool key_frame_requested) {
+  SharedEncoderRegistry& registry = SharedEncoderRegistry::Instance();
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  Member* const member = FindMemberNoLock(proxy);
+  if (!member) {
+    return WEBRTC_VIDEO_CODEC_UNINITIALIZED;
+  }
+  Layer& layer = *member->layer;
+  if (key_frame_requested) {
+    registry.key_frame_requests_.fetch_add(1, std::memory_order_relaxed);
+    layer.key_frame_pending_ = true;
+  }
+
+  // Frame already encoded for another proxy; forward it if the proxy can
+  // decode it, otherwise resynchronize with a key frame on the next one.
+  const FrameKey key = GetFrameKey(frame);
+  if (Entry* entry = layer.FindEntry(key)) {
+    if (entry->key_frame || (member->last_seq == entry->seq - 1)) {
+      SubscribeNoLock(*member, *entry, frame);
+    } else {
+      layer.key_frame_pending_ = true;
+    }
+    return WEBRTC_VIDEO_CODEC_OK;
+  }
+
+  // Frames older than the last one encoded were skipped by the other proxies,
+  // so are dropped for this one too.
+  if (!layer.entries_.empty() &&
+      (frame.timestamp_us() <= layer.entries_.back().key.timestamp_us)) {
+    return WEBRTC_VIDEO_CODEC_OK;
+  }
+
+  // A proxy which missed the previous frame cannot decode a delta frame
+  if (member->last_seq != layer.next_seq_ - 1) {
+    layer.key_frame_pending_ = true;
+  }
+  if (layer.rates_dirty_) {
+    ApplyRatesNoLock(layer);
+  }
+  const bool key_frame = layer.key_frame_pending_;
+  layer.key_frame_pending_ = false;
+  layer.entries_.emplace_back();
+  Entry& entry = layer.entries_.back();
+  entry.key = key;
+  entry.rtp_timestamp = frame.timestamp();
+  entry.seq = layer.next_seq_++;
+  entry.key_frame = key_frame;
+  if (layer.entries_.size() > kMaxCachedFrames) {
+    layer.entries_.pop_front();
+  }
+  SubscribeNoLock(*member, entry, frame);
+
+  const size_t stream_count =
+      std::max<size_t>(settings_.numberOfSimulcastStreams, 1);
+  const std::vector<webrtc::FrameType> frame_types(
+      stream_count,
+      key_frame ? webrtc::kVideoFrameKey : webrtc::kVideoFrameDelta);
+  registry.frames_encoded_.fetch_add(1, std::memory_order_relaxed);
+  if (key_frame) {
+    registry.key_frames_encoded_.fetch_add(1, std::memory_order_relaxed);
+  }
+  const int32_t ret = layer.encoder_->Encode(frame, nullptr, &frame_types);
+  if (ret != WEBRTC_VIDEO_CODEC_OK) {
+    // The proxies expecting this frame will miss it
+    layer.key_frame_pending_ = true;
+  }
+  return ret;
+}
+
+int SharedEncoderGroup::ChooseTierNoLock(const Member& member) const {
+  const double bps = member.allocation.get_sum_bps();
+  if (bps <= 0.0) {
+    // Paused senders, and senders without allocation yet, don't need an
+    // encoder of their own.
+    if (member.layer) {
+      return member.layer->tier_;
+    }
+    return (layers_.empty() ? 0 : layers_.front()->tier_);
+  }
+  if (member.layer && IsInTier(bps, member.layer->tier_)) {
+    return member.layer->tier_;
+  }
+  for (auto&& layer : layers_) {
+    if (IsInTier(bps, layer->tier_)) {
+      return layer->tier_;
+    }
+  }
+  return GetBitrateTier(bps);
+}
+
+SharedEncoderGroup::Layer* SharedEncoderGroup::GetLayerNoLock(int tier) {
+  for (auto&& layer : layers_) {
+    if (layer->tier_ == tier) {
+      return layer.get();
+    }
+  }
+  auto layer = std::make_unique<Layer>(*this, tier);
+  layer->encoder_ = factory_->CreateVideoEncoder(format_);
+  if (!layer->encoder_) {
+    return nullptr;
+  }
+  layer->encoder_->RegisterEncodeCompleteCallback(layer.get());
+  if (layer->encoder_->InitEncode(&settings_, number_of_cores_,
+                                  max_payload_size_) != WEBRTC_VIDEO_CODEC_OK) {
+    return nullptr;
+  }
+  layers_.push_back(std::move(layer));
+  return layers_.back().get();
+}
+
+std::vector<std::unique_ptr<SharedEncoderGroup::Layer>>
+SharedEncoderGroup::TakeUnusedLayersNoLock() {
+  std::vector<std::unique_ptr<Layer>> unused;
+  for (auto it = layers_.begin(); it != layers_.end();) {
+    Layer* const layer = it->get();
+    const bool used = std::any_of(
+        members_.begin(), members_.end(),
+        [layer](const Member& member) { return (member.layer == layer); });
+    if (!used) {
+      unused.push_back(std::move(*it));
+      it = layers_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  return unused;
+}
+
+void SharedEncoderGroup::UnsubscribeNoLock(Layer& layer,
+                                           SharedEncoderProxy* proxy) {
+  for (auto&& entry : layer.entries_) {
+    auto& subscribers = entry.subscribers;
+    subscribers.erase(std::remove_if(subscribers.begin(), subscribers.end(),
+                                     [proxy](const Subscriber& subscriber) {
+                                       return (subscriber.proxy == proxy);
+                                     }),
+                      subscribers.end());
+  }
+}
+
+webrtc::EncodedImageCallback::Result SharedEncoderGroup::OnEncodedImageNoLock(
+    Layer& layer,
+    const webrtc::EncodedImage& encoded_image,
+    const webrtc::CodecSpecificInfo* codec_specific_info,
+    const webrtc::RTPFragmentationHeader* fragmentation) {
+  using Result = webrtc::EncodedImageCallback::Result;
+  auto it = std::find_if(layer.entries_.rbegin(), layer.entries_.rend(),
+                         [&encoded_image](const Entry& entry) {
+                           return (entry.rtp_timestamp ==
+                                   encoded_image.Timestamp());
+                         });
+  if (it == layer.entries_.rend()) {
+    // Frame evicted from the cache before the encoder produced it
+    return Result(Result::OK, encoded_image.Timestamp());
+  }
+  Entry& entry = *it;
+  auto output = std::make_unique<Output>();
+  output->data.assign(encoded_image._buffer,
+                      encoded_image._buffer + encoded_image._length);
+  output->image = encoded_image;
+  output->image._buffer = output->data.data();
+  output->image._size = output->data.size();
+  if (codec_specific_info) {
+    output->has_codec_specific_info = true;
+    output->codec_specific_info = *codec_specific_info;
+  }
+  if (fragmentation) {
+    output->fragmentation = std::make_unique<webrtc::RTPFragmentationHeader>();
+    output->fragmentation->CopyFrom(*fragmentation);
+  }
+  if (encoded_image._frameType == webrtc::kVideoFrameKey) {
+    entry.key_frame = true;
+  }
+  for (auto&& subscriber : entry.subscribers) {
+    DeliverNoLock(subscriber, *output);
+  }
+  entry.outputs.push_back(std::move(output));
+  return Result(Result::OK, encoded_image.Timestamp());
+}
+
+void SharedEncoderGroup::OnDroppedFrameNoLock(
+    Layer& layer,
+    webrtc::EncodedImageCallback::DropReason reason) {
+  if (layer.entries_.empty()) {
+    return;
+  }
+  for (auto&& subscriber : layer.entries_.back().subscribers) {
+    if (Member* member = FindMemberNoLock(subscriber.proxy)) {
+      if (member->callback) {
+        member->callback->OnDroppedFrame(reason);
+      }
+    }
+  }
+}
+
+void SharedEncoderGroup::ApplyRatesNoLock(Layer& layer) {
+  layer.rates_dirty_ = false;
+  const Member* lowest = nullptr;
+  const Member* first = nullptr;
+  for (auto&& member : members_) {
+    if (member.layer != &layer) {
+      continue;
+    }
+    if (!first) {
+      first = &member;
+    }
+    // Paused senders have a zero allocation, and don't constrain the others
+    const uint32_t bps = member.allocation.get_sum_bps();
+    if ((bps > 0) &&
+        (!lowest || (bps < lowest->allocation.get_sum_bps()) ||
+         ((bps == lowest->allocation.get_sum_bps()) &&
+          (member.framerate < lowest->framerate)))) {
+      lowest = &member;
+    }
+  }
+  if (lowest) {
+    layer.encoder_->SetRateAllocation(lowest->allocation, lowest->framerate);
+  } else if (first) {
+    layer.encoder_->SetRateAllocation(webrtc::VideoBitrateAllocation(),
+                                      first->framerate);
+  }
+}
+
+void SharedEncoderGroup::SubscribeNoLock(Member& member,
+                                         Entry& entry,
+                                         const webrtc::VideoFrame& frame) {
+  Subscriber subscriber;
+  subscriber.proxy = member.proxy;
+  subscriber.rtp_timestamp = frame.timestamp();
+  subscriber.capture_time_ms = frame.render_time_ms();
+  entry.subscribers.push_back(subscriber);
+  member.last_seq = entry.seq;
+  for (auto&& output : entry.outputs) {
+    DeliverNoLock(subscriber, *output);
+  }
+}
+
+void SharedEncoderGroup::DeliverNoLock(const Subscriber& subscriber,
+                                       const Output& output) {
+  Member* const member = FindMemberNoLock(subscriber.proxy);
+  if (!member || !member->callback) {
+    return;
+  }
+  // Each sender stamps its own copy of the raw frame
+  webrtc::EncodedImage image = output.image;
+  image.SetTimestamp(subscriber.rtp_timestamp);
+  image.capture_time_ms_ = subscriber.capture_time_ms;
+  member->callback->OnEncodedImage(
+      image,
+      output.has_codec_specific_info ? &output.codec_specific_info : nullptr,
+      output.fragmentation.get());
+  SharedEncoderRegistry::Instance().frames_delivered_.fetch_add(
+      1, std::memory_order_relaxed);
+}
+
+}  // namespace
+
+namespace Microsoft {
+namespace MixedReality {
+namespace WebRTC {
+
+SharedVideoEncoderFactory::SharedVideoEncoderFactory(
+    std::unique_ptr<webrtc::VideoEncoderFactory> factory) noexcept
+    : factory_(std::move(factory)) {}
+
+void SharedVideoEncoderFactory::SetEnabled(bool enabled) noexcept {
+  SharedEncoderRegistry::Instance().enabled_.store(enabled,
+                                                   std::memory_order_relaxed);
+}
+
+void SharedVideoEncoderFactory::GetStats(
+    mrsSharedVideoEncoderStats& stats) noexcept {
+  SharedEncoderRegistry::Instance().GetStats(stats);
+}
+
+std::vector<webrtc::SdpVideoFormat>
+SharedVideoEncoderFactory::GetSupportedFormats() const {
+  return factory_->GetSupportedFormats();
+}
+
+webrtc::VideoEncoderFactory::CodecInfo
+SharedVideoEncoderFactory::QueryVideoEncoder(
+    const webrtc::SdpVideoFormat& format) const {
+  return factory_->QueryVideoEncoder(format);
+}
+
+std::unique_ptr<webrtc::VideoEncoder>
+SharedVideoEncoderFactory::CreateVideoEncoder(
+    const webrtc::SdpVideoFormat& format) {
+  // Encoders capturing their own frames have nothing to share
+  if (!SharedEncoderRegistry::Instance().enabled_.load(
+          std::memory_order_relaxed) ||
+      factory_->QueryVideoEncoder(format).has_internal_source) {
+    return factory_->CreateVideoEncoder(format);
+  }
+  return std::make_unique<SharedEncoderProxy>(factory_, format);
+}
+
+}  // namespace WebRTC
+}  // namespace MixedReality
+}  // namespace Microsoft
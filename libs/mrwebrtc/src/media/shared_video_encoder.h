@@ -0,0 +1,60 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "shared_video_encoder_interop.h"
+
+#include "api/video_codecs/video_encoder_factory.h"
+
+namespace Microsoft {
+namespace MixedReality {
+namespace WebRTC {
+
+/// Video encoder factory sharing encoders among the video senders of all peer
+/// connections, so that a local video track sent to several peer connections
+/// is encoded once per distinct codec configuration instead of once per
+/// sender.
+///
+/// While shared encoding is enabled, each encoder created is a proxy which
+/// joins a process-wide encoder group on its first frame. Groups are matched by
+/// codec format and settings, and by the identity of the frames, which the
+/// video track broadcasts to all its senders as the same buffer. The group
+/// encodes each frame once per bitrate tier of its proxies, with encoders
+/// created by the wrapped factory, and forwards the encoded frames to all the
+/// proxies of each tier.
+class SharedVideoEncoderFactory : public webrtc::VideoEncoderFactory {
+ public:
+  explicit SharedVideoEncoderFactory(
+      std::unique_ptr<webrtc::VideoEncoderFactory> factory) noexcept;
+
+  /// Enable or disable shared encoding for the encoders created from now on.
+  /// This is multithread-safe.
+  static void SetEnabled(bool enabled) noexcept;
+
+  /// Get the statistics of all the shared encoders. This is multithread-safe.
+  static void GetStats(mrsSharedVideoEncoderStats& stats) noexcept;
+
+  //
+  // VideoEncoderFactory interface
+  //
+
+  std::vector<webrtc::SdpVideoFormat> GetSupportedFormats() const override;
+  CodecInfo QueryVideoEncoder(
+      const webrtc::SdpVideoFormat& format) const override;
+  std::unique_ptr<webrtc::VideoEncoder> CreateVideoEncoder(
+      const webrtc::SdpVideoFormat& format) override;
+
+ private:
+  /// Wrapped factory creating the actual encoders. This is shared with the
+  /// encoder groups, which can outlive this factory when they are shared with
+  /// the peer connections of another factory shard.
+  std::shared_ptr<webrtc::VideoEncoderFactory> factory_;
+};
+
+}  // namespace WebRTC
+}  // namespace MixedReality
+}  // namespace Microsoft
@@ -183,6 +183,15 @@ bool Transceiver::HasSender(webrtc::RtpSenderInterface* sender) const {
   }
 }
 
+rtc::scoped_refptr<webrtc::RtpSenderInterface> Transceiver::GetSender()
+    const {
+  if (transceiver_) {
+    return transceiver_->sender();
+  } else {
+    return plan_b_->rtp_sender_;
+  }
+}
+
 bool Transceiver::HasReceiver(webrtc::RtpReceiverInterface* receiver) const {
   if (transceiver_) {
     return (transceiver_->receiver() == receiver);
@@ -91,6 +91,12 @@ class Transceiver : public TrackedObject {
   MRS_NODISCARD bool IsPlanB() const { return !IsUnifiedPlan(); }
 
   MRS_NODISCARD bool HasSender(webrtc::RtpSenderInterface* sender) const;
+
+  /// Get the RTP sender of the transceiver, if any. With Plan B, the RTP sender
+  /// only exists while the transceiver is sending.
+  MRS_NODISCARD rtc::scoped_refptr<webrtc::RtpSenderInterface> GetSender()
+      const;
+
   MRS_NODISCARD bool HasReceiver(webrtc::RtpReceiverInterface* receiver) const;
 
   Result SetLocalTrack(std::nullptr_t) noexcept {
@@ -157,6 +163,7 @@ class Transceiver : public TrackedObject {
   void RegisterAssociatedCallback(AssociatedCallback&& callback) noexcept {
     std::lock_guard<std::mutex> lock(cb_mutex_);
     associated_callback_ = std::move(callback);
+    associated_callback_.SetSite(this, mrsCallbackType::kTransceiverAssociated);
   }
 
   /// Callback invoked when the internal state of the transceiver has
@@ -167,6 +174,8 @@ class Transceiver : public TrackedObject {
   void RegisterStateUpdatedCallback(StateUpdatedCallback&& callback) noexcept {
     std::lock_guard<std::mutex> lock(cb_mutex_);
     state_updated_callback_ = std::move(callback);
+    state_updated_callback_.SetSite(this,
+                                    mrsCallbackType::kTransceiverStateUpdated);
   }
 
   //
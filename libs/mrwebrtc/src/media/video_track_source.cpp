@@ -42,8 +42,11 @@ VideoTrackSource::VideoTrackSource(
     : TrackedObject(std::move(global_factory), video_track_source_type),
       source_(std::move(source)) {
   RTC_CHECK(source_);
-  RTC_CHECK((video_track_source_type == ObjectType::kDeviceVideoTrackSource) ||
-            (video_track_source_type == ObjectType::kExternalVideoTrackSource));
+  RTC_CHECK(
+      (video_track_source_type == ObjectType::kDeviceVideoTrackSource) ||
+      (video_track_source_type == ObjectType::kExternalVideoTrackSource) ||
+      (video_track_source_type == ObjectType::kForwardedVideoTrackSource) ||
+      (video_track_source_type == ObjectType::kEncodedVideoTrackSource));
 }
 
 VideoTrackSource::~VideoTrackSource() {
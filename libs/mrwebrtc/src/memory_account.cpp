@@ -0,0 +1,157 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+// This is a precompiled header, it must be on its own, followed by a blank
+// line, to prevent clang-format from reordering it with other headers.
+#include "pch.h"
+
+#include "memory_account.h"
+
+namespace {
+
+using namespace Microsoft::MixedReality::WebRTC;
+
+uint64_t LoadBytes(const std::atomic<int64_t>& counter) noexcept {
+  // Charges and releases of different buffers can be observed out of order,
+  // so a counter can transiently read negative.
+  const int64_t value = counter.load(std::memory_order_relaxed);
+  return (value > 0 ? static_cast<uint64_t>(value) : 0);
+}
+
+/// Budget exceeded notification pending on the notification thread.
+struct BudgetNotification : public rtc::MessageData {
+  BudgetNotification(std::shared_ptr<MemoryAccount> account, uint64_t total)
+      : account_(std::move(account)), total_(total) {}
+  std::shared_ptr<MemoryAccount> account_;
+  uint64_t total_;
+};
+
+/// Thread invoking the callbacks of the exceeded budgets, outside of the locks
+/// held by the callers charging memory.
+class BudgetNotifier : public rtc::MessageHandler {
+ public:
+  static BudgetNotifier& Instance() noexcept {
+    // Intentionally leaked, like the other process-wide singletons.
+    static BudgetNotifier* const instance = new BudgetNotifier();
+    return *instance;
+  }
+
+  /// Post a notification, starting the thread if needed.
+  void Post(std::unique_ptr<BudgetNotification> notification) noexcept {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!thread_) {
+      thread_ = rtc::Thread::Create();
+      thread_->SetName("MR-WebRTC memory budget", thread_.get());
+      thread_->Start();
+    }
+    thread_->Post(RTC_FROM_HERE, this, 0, notification.release());
+  }
+
+  /// Stop the thread, discarding the pending notifications.
+  void Stop() noexcept {
+    std::unique_ptr<rtc::Thread> thread;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      thread = std::move(thread_);
+    }
+    if (thread) {
+      thread->Stop();
+    }
+  }
+
+ protected:
+  void OnMessage(rtc::Message* message) override {
+    std::unique_ptr<BudgetNotification> notification(
+        static_cast<BudgetNotification*>(message->pdata));
+    notification->account_->NotifyBudgetExceeded(notification->total_);
+  }
+
+ private:
+  std::mutex mutex_;
+  std::unique_ptr<rtc::Thread> thread_ RTC_GUARDED_BY(mutex_);
+};
+
+}  // namespace
+
+namespace Microsoft {
+namespace MixedReality {
+namespace WebRTC {
+
+const std::shared_ptr<MemoryAccount>& MemoryAccount::Global() noexcept {
+  // Intentionally leaked, like other process-wide singletons, so that buffers
+  // released during static destruction can still be uncharged.
+  static std::shared_ptr<MemoryAccount>* const global =
+      new std::shared_ptr<MemoryAccount>(new MemoryAccount());
+  return *global;
+}
+
+void MemoryAccount::Add(MemoryCategory category, int64_t delta) noexcept {
+  bytes_[static_cast<int>(category)].fetch_add(delta,
+                                               std::memory_order_relaxed);
+  const int64_t total =
+      total_.fetch_add(delta, std::memory_order_relaxed) + delta;
+  if (budget_.load(std::memory_order_relaxed) != 0) {
+    CheckBudget(total);
+  }
+  if (parent_) {
+    parent_->Add(category, delta);
+  }
+}
+
+void MemoryAccount::GetUsage(mrsMemoryUsage& usage) const noexcept {
+  usage.video_frame_bytes =
+      LoadBytes(bytes_[static_cast<int>(MemoryCategory::kVideoFrame)]);
+  usage.audio_buffer_bytes =
+      LoadBytes(bytes_[static_cast<int>(MemoryCategory::kAudioBuffer)]);
+  usage.external_source_bytes =
+      LoadBytes(bytes_[static_cast<int>(MemoryCategory::kExternalSource)]);
+  usage.data_channel_bytes =
+      LoadBytes(bytes_[static_cast<int>(MemoryCategory::kDataChannel)]);
+  usage.event_queue_bytes =
+      LoadBytes(bytes_[static_cast<int>(MemoryCategory::kEventQueue)]);
+  usage.total_bytes = LoadBytes(total_);
+}
+
+void MemoryAccount::SetBudget(uint64_t budget_bytes,
+                              MemoryBudgetExceededCallback callback) noexcept {
+  std::lock_guard<std::mutex> lock(budget_mutex_);
+  budget_callback_ = callback;
+  budget_.store(budget_bytes, std::memory_order_relaxed);
+  // Report a budget already exceeded on the next change
+  over_budget_.store(false, std::memory_order_relaxed);
+}
+
+void MemoryAccount::StopNotifications() noexcept {
+  BudgetNotifier::Instance().Stop();
+}
+
+void MemoryAccount::NotifyBudgetExceeded(uint64_t total) noexcept {
+  MemoryBudgetExceededCallback callback;
+  {
+    std::lock_guard<std::mutex> lock(budget_mutex_);
+    const uint64_t budget = budget_.load(std::memory_order_relaxed);
+    if ((budget == 0) || (total <= budget)) {
+      return;
+    }
+    callback = budget_callback_;
+  }
+  callback(owner_, total);
+}
+
+void MemoryAccount::CheckBudget(int64_t total) noexcept {
+  const uint64_t budget = budget_.load(std::memory_order_relaxed);
+  if ((total > 0) && (static_cast<uint64_t>(total) > budget)) {
+    if (!over_budget_.exchange(true, std::memory_order_relaxed)) {
+      // This is usually called under the lock of the buffer being charged, so
+      // the callback is invoked from another thread.
+      BudgetNotifier::Instance().Post(std::make_unique<BudgetNotification>(
+          shared_from_this(), static_cast<uint64_t>(total)));
+    }
+  } else if (over_budget_.load(std::memory_order_relaxed)) {
+    over_budget_.store(false, std::memory_order_relaxed);
+  }
+}
+
+}  // namespace WebRTC
+}  // namespace MixedReality
+}  // namespace Microsoft
@@ -0,0 +1,136 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+
+#include "callback.h"
+#include "memory_usage_interop.h"
+
+namespace Microsoft {
+namespace MixedReality {
+namespace WebRTC {
+
+/// Category of the memory charged to a |MemoryAccount|. See |mrsMemoryUsage|
+/// for the meaning of each category.
+enum class MemoryCategory : int {
+  kVideoFrame,
+  kAudioBuffer,
+  kExternalSource,
+  kDataChannel,
+  kEventQueue,
+};
+
+/// Callback invoked when the soft budget of an account is exceeded.
+using MemoryBudgetExceededCallback =
+    Callback<mrsPeerConnectionHandle, uint64_t>;
+
+/// Byte counters of the memory held by the library's own buffers, for a peer
+/// connection or for the whole process.
+///
+/// Each peer connection owns an account, shared with the objects it owns so
+/// that their buffers can outlive it. Every change to an account is also
+/// applied to the process-wide account, which is the parent of all others, so
+/// that reading any usage never iterates over objects. Counters are atomics,
+/// so charging memory is lock-free unless a budget is exceeded. The callback of
+/// an exceeded budget is invoked asynchronously on a dedicated thread, since
+/// memory is usually charged under the lock of the buffers.
+class MemoryAccount : public std::enable_shared_from_this<MemoryAccount> {
+ public:
+  /// Get the process-wide account.
+  static const std::shared_ptr<MemoryAccount>& Global() noexcept;
+
+  /// Create a child account of the process-wide account for the peer
+  /// connection with the given handle.
+  explicit MemoryAccount(mrsPeerConnectionHandle owner) noexcept
+      : parent_(Global().get()), owner_(owner) {}
+
+  /// Add |delta| bytes, which can be negative, to a category.
+  void Add(MemoryCategory category, int64_t delta) noexcept;
+
+  /// Get the current usage of the account.
+  void GetUsage(mrsMemoryUsage& usage) const noexcept;
+
+  /// Set the soft budget of the account, or disable it with a zero budget.
+  void SetBudget(uint64_t budget_bytes,
+                 MemoryBudgetExceededCallback callback) noexcept;
+
+  /// Stop the thread invoking the callbacks of the exceeded budgets, discarding
+  /// the pending notifications, so that the library can be unloaded. The
+  /// thread is started again by the next notification.
+  static void StopNotifications() noexcept;
+
+  /// Invoke the callback for a budget exceeded with a total usage of |total|
+  /// bytes, unless the budget changed since. Called on the notification
+  /// thread, without any lock held.
+  void NotifyBudgetExceeded(uint64_t total) noexcept;
+
+ private:
+  static constexpr int kCategoryCount = 5;
+
+  /// Constructor of the process-wide account.
+  MemoryAccount() noexcept = default;
+
+  /// Check the budget after the total usage changed to |total|.
+  void CheckBudget(int64_t total) noexcept;
+
+  std::atomic<int64_t> bytes_[kCategoryCount]{};
+  std::atomic<int64_t> total_{0};
+
+  /// Parent account, or null for the process-wide account. The process-wide
+  /// account is never destroyed.
+  MemoryAccount* const parent_{nullptr};
+
+  /// Handle of the peer connection owning the account, or null for the
+  /// process-wide account.
+  const mrsPeerConnectionHandle owner_{nullptr};
+
+  /// Soft budget in bytes, or zero if disabled.
+  std::atomic<uint64_t> budget_{0};
+
+  /// Whether the total usage was above the budget when last checked, to invoke
+  /// the callback only when the budget is crossed.
+  std::atomic_bool over_budget_{false};
+
+  std::mutex budget_mutex_;
+  MemoryBudgetExceededCallback budget_callback_ RTC_GUARDED_BY(budget_mutex_);
+};
+
+/// Amount of memory charged to an account for a single buffer or group of
+/// buffers, released on destruction. Updates are not synchronized; the owner
+/// of the charge must serialize them, usually with the lock protecting the
+/// buffers themselves.
+class MemoryCharge {
+ public:
+  MemoryCharge(std::shared_ptr<MemoryAccount> account,
+               MemoryCategory category) noexcept
+      : account_(std::move(account)), category_(category) {}
+  ~MemoryCharge() noexcept { Set(0); }
+  MemoryCharge(const MemoryCharge&) = delete;
+  MemoryCharge& operator=(const MemoryCharge&) = delete;
+
+  /// Set the amount of memory charged, in bytes.
+  void Set(size_t bytes) noexcept {
+    const int64_t delta =
+        static_cast<int64_t>(bytes) - static_cast<int64_t>(bytes_);
+    if (delta != 0) {
+      bytes_ = bytes;
+      account_->Add(category_, delta);
+    }
+  }
+
+  /// Get the amount of memory charged, in bytes.
+  size_t Get() const noexcept { return bytes_; }
+
+ private:
+  const std::shared_ptr<MemoryAccount> account_;
+  const MemoryCategory category_;
+  size_t bytes_{0};
+};
+
+}  // namespace WebRTC
+}  // namespace MixedReality
+}  // namespace Microsoft
@@ -10,6 +10,7 @@
 #include "data_channel.h"
 #include "interop/global_factory.h"
 #include "interop_api.h"
+#include "media/forwarding_codec_factory.h"
 #include "media/local_audio_track.h"
 #include "media/local_video_track.h"
 #include "media/remote_audio_track.h"
@@ -19,6 +20,8 @@
 #include "utils.h"
 #include "video_frame_observer.h"
 
+#include <algorithm>
+#include <atomic>
 #include <functional>
 
 // Include implementation because we cannot access the mline index from the
@@ -29,6 +32,8 @@
 #include "pc/rtptransceiver.h"
 #pragma warning(pop)
 
+#include "pc/sessiondescription.h"
+
 #if defined(_M_IX86) /* x86 */ && defined(WINAPI_FAMILY) && \
     (WINAPI_FAMILY == WINAPI_FAMILY_APP) /* UWP app */ &&   \
     defined(_WIN32_WINNT_WIN10) &&                          \
@@ -132,6 +137,9 @@ namespace {
 
 using namespace Microsoft::MixedReality::WebRTC;
 
+/// Next unique ID of a peer connection, starting from 1 since 0 means none.
+std::atomic<uint64_t> next_unique_id{1};
+
 class CreateSessionDescObserver
     : public webrtc::CreateSessionDescriptionObserver {
  public:
@@ -215,6 +223,39 @@ struct SetRemoteSessionDescObserver
   std::function<void(mrsResult, const char*)> callback_;
 };
 
+/// Connections of a single factory shard to close with
+/// |PeerConnection::CloseMany()|.
+struct CloseManyData : public rtc::MessageData {
+  std::vector<PeerConnection*> peers_;
+};
+
+/// Bulk close operation of |PeerConnection::CloseMany()|, running one task per
+/// factory shard on the signaling thread of that shard. Deletes itself once
+/// the last task completed.
+class CloseManyOperation : public rtc::MessageHandler {
+ public:
+  CloseManyOperation(uint32_t task_count, Callback<> callback)
+      : remaining_(task_count), callback_(std::move(callback)) {}
+
+ protected:
+  void OnMessage(rtc::Message* message) override {
+    std::unique_ptr<CloseManyData> data(
+        static_cast<CloseManyData*>(message->pdata));
+    // Already on the signaling thread, so the calls to the WebRTC peer
+    // connection are not proxied.
+    for (PeerConnection* peer : data->peers_) {
+      peer->Close();
+    }
+    if (remaining_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      callback_();
+      delete this;
+    }
+  }
+
+  std::atomic_uint32_t remaining_;
+  Callback<> callback_;
+};
+
 /// Convert an implementation value to a native API value of the ICE connection
 /// state. This ensures API stability if the implementation changes, although
 /// currently API values are mapped 1:1 with the implementation.
@@ -260,6 +301,28 @@ webrtc::PeerConnectionInterface::IceTransportsType ICETransportTypeToNative(
   return static_cast<Native>(value);
 }
 
+/// Apply encoding limits to all the encodings of RTP parameters, and return
+/// true if any value changed.
+bool ApplyVideoSendLimits(const VideoSendLimits& limits,
+                          webrtc::RtpParameters& parameters) {
+  bool changed = false;
+  for (auto&& encoding : parameters.encodings) {
+    if (encoding.scale_resolution_down_by != limits.scale_resolution_down_by) {
+      encoding.scale_resolution_down_by = limits.scale_resolution_down_by;
+      changed = true;
+    }
+    if (encoding.max_framerate != limits.max_framerate) {
+      encoding.max_framerate = limits.max_framerate;
+      changed = true;
+    }
+    if (encoding.max_bitrate_bps != limits.max_bitrate_bps) {
+      encoding.max_bitrate_bps = limits.max_bitrate_bps;
+      changed = true;
+    }
+  }
+  return changed;
+}
+
 webrtc::PeerConnectionInterface::BundlePolicy BundlePolicyToNative(
     mrsBundlePolicy value) {
   using Native = webrtc::PeerConnectionInterface::BundlePolicy;
@@ -329,9 +392,8 @@ ErrorOr<std::shared_ptr<DataChannel>> PeerConnection::AddDataChannel(
     // Call from the signaling thread so that user callbacks can access the
     // channel state (e.g. register channel callbacks) without it being changed
     // concurrently by WebRTC.
-    global_factory_->GetSignalingThread()->Invoke<void>(RTC_FROM_HERE, [&]() {
-      OnDataChannelAdded(*data_channel.get());
-    });
+    global_factory_->GetSignalingThread(shard_)->Invoke<void>(
+        RTC_FROM_HERE, [&]() { OnDataChannelAdded(*data_channel.get()); });
 
     return data_channel;
   }
@@ -574,6 +636,11 @@ void PeerConnection::Close() noexcept {
   // transceivers.
   rtc::scoped_refptr<webrtc::PeerConnectionInterface> pc(std::move(peer_));
 
+  // Stop sampling stats, which otherwise keeps a reference to the connection,
+  // and release any cached report.
+  StopStatsSampler();
+  stats_collector_->ClearCache();
+
   // Close the connection
   pc->Close();
 
@@ -622,10 +689,134 @@ void PeerConnection::Close() noexcept {
   pc = nullptr;
 }
 
+void PeerConnection::CloseMany(std::vector<PeerConnection*> peers,
+                               Callback<> callback) noexcept {
+  // Group the connections by signaling thread, keeping their order.
+  std::vector<std::pair<rtc::Thread*, std::unique_ptr<CloseManyData>>> tasks;
+  for (PeerConnection* peer : peers) {
+    rtc::Thread* const thread =
+        peer->global_factory_->GetSignalingThread(peer->shard_);
+    auto it = std::find_if(tasks.begin(), tasks.end(),
+                           [thread](const auto& task) {
+                             return (task.first == thread);
+                           });
+    if (it == tasks.end()) {
+      tasks.emplace_back(thread, std::make_unique<CloseManyData>());
+      it = tasks.end() - 1;
+    }
+    it->second->peers_.push_back(peer);
+  }
+  if (tasks.empty()) {
+    callback();
+    return;
+  }
+  auto operation = new CloseManyOperation(static_cast<uint32_t>(tasks.size()),
+                                          std::move(callback));
+  for (auto&& task : tasks) {
+    task.first->Post(RTC_FROM_HERE, operation, 0, task.second.release());
+  }
+}
+
 bool PeerConnection::IsClosed() const noexcept {
   return (peer_ == nullptr);
 }
 
+Result PeerConnection::SetVideoSendLimits(const VideoSendLimits& limits,
+                                          uint32_t& sender_count,
+                                          bool& resolution_supported,
+                                          bool& framerate_supported) noexcept {
+  RTC_DCHECK(global_factory_->GetSignalingThread(shard_)->IsCurrent());
+  sender_count = 0;
+  std::vector<rtc::scoped_refptr<webrtc::RtpSenderInterface>> senders;
+  {
+    rtc::CritScope lock(&transceivers_mutex_);
+    for (auto&& transceiver : transceivers_) {
+      if (!transceiver->GetLocalVideoTrack()) {
+        continue;
+      }
+      if (auto sender = transceiver->GetSender()) {
+        senders.push_back(std::move(sender));
+      }
+    }
+  }
+  Result result = Result::kSuccess;
+  for (auto&& sender : senders) {
+    webrtc::RtpParameters parameters = sender->GetParameters();
+    if (parameters.encodings.empty()) {
+      continue;
+    }
+    VideoSendLimits applied_limits = limits;
+    if (!resolution_supported) {
+      applied_limits.scale_resolution_down_by.reset();
+    }
+    if (!framerate_supported) {
+      applied_limits.max_framerate.reset();
+    }
+    if (!ApplyVideoSendLimits(applied_limits, parameters)) {
+      ++sender_count;  // already applied
+      continue;
+    }
+    webrtc::RTCError error = sender->SetParameters(parameters);
+    if ((error.type() == webrtc::RTCErrorType::UNSUPPORTED_PARAMETER) &&
+        applied_limits.scale_resolution_down_by.has_value()) {
+      // Some implementations, like this version of WebRTC, reject the
+      // resolution limit but accept the frame rate one.
+      resolution_supported = false;
+      applied_limits.scale_resolution_down_by.reset();
+      parameters = sender->GetParameters();
+      ApplyVideoSendLimits(applied_limits, parameters);
+      error = sender->SetParameters(parameters);
+    }
+    if ((error.type() == webrtc::RTCErrorType::UNSUPPORTED_PARAMETER) &&
+        applied_limits.max_framerate.has_value()) {
+      // Fall back to limiting the bitrate only
+      framerate_supported = false;
+      applied_limits.max_framerate.reset();
+      parameters = sender->GetParameters();
+      ApplyVideoSendLimits(applied_limits, parameters);
+      error = sender->SetParameters(parameters);
+    }
+    if (!error.ok()) {
+      RTC_LOG(LS_WARNING) << "Failed to apply video send limits to RTP sender "
+                          << sender->id() << ": " << error.message();
+      result = ResultFromRTCErrorType(error.type());
+      continue;
+    }
+    ++sender_count;
+  }
+  return result;
+}
+
+std::string PeerConnection::GetReceiveStreamId(
+    webrtc::RtpReceiverInterface* receiver) noexcept {
+  // Access the remote description on the signaling thread, where it changes
+  return global_factory_->GetSignalingThread(shard_)->Invoke<std::string>(
+      RTC_FROM_HERE, [this, receiver]() -> std::string {
+        const webrtc::RtpParameters parameters = receiver->GetParameters();
+        const webrtc::SessionDescriptionInterface* const remote_desc =
+            peer_->remote_description();
+        if (parameters.encodings.empty() ||
+            !parameters.encodings[0].ssrc.has_value() || !remote_desc) {
+          return {};
+        }
+        const uint32_t ssrc = parameters.encodings[0].ssrc.value();
+        for (auto&& content : remote_desc->description()->contents()) {
+          const cricket::MediaContentDescription* const media_desc =
+              content.description;
+          if (!media_desc ||
+              (media_desc->type() != cricket::MediaType::MEDIA_TYPE_VIDEO)) {
+            continue;
+          }
+          for (auto&& stream : media_desc->streams()) {
+            if (stream.has_ssrc(ssrc)) {
+              return stream.id;
+            }
+          }
+        }
+        return {};
+      });
+}
+
 ErrorOr<Transceiver*> PeerConnection::AddTransceiver(
     const mrsTransceiverInitConfig& config) noexcept {
   if (IsClosed()) {
@@ -749,8 +940,10 @@ Error PeerConnection::SetRemoteDescriptionAsync(
             // Fire completed callback to signal remote description was applied.
             callback(result, error_message);
           });
-  peer_->SetRemoteDescription(std::move(session_description),
-                              std::move(observer));
+  InvokeWithReceiveContext([&]() {
+    peer_->SetRemoteDescription(std::move(session_description),
+                                std::move(observer));
+  });
   return Error(mrsResult::kSuccess);
 }
 
@@ -1037,7 +1230,28 @@ void PeerConnection::OnLocalDescCreated(
   // SetLocalDescription will invoke observer.OnSuccess() once done, which
   // will in turn invoke the |local_sdp_ready_to_send_callback_| registered if
   // any, or do nothing otherwise. The observer is a mandatory parameter.
-  peer_->SetLocalDescription(observer, desc);
+  InvokeWithReceiveContext(
+      [&]() { peer_->SetLocalDescription(observer, desc); });
+}
+
+void PeerConnection::InvokeWithReceiveContext(
+    const std::function<void()>& apply) noexcept {
+  ForwardingVideoDecoderFactory* const factory =
+      global_factory_->GetVideoDecoderFactory(shard_);
+  if (!factory) {
+    apply();
+    return;
+  }
+  // The description is applied synchronously on the signaling thread, which
+  // creates the decoders on the worker thread while blocking. Running the call
+  // from the signaling thread ensures no other peer connection of the shard
+  // applies a description meanwhile.
+  global_factory_->GetSignalingThread(shard_)->Invoke<void>(
+      RTC_FROM_HERE, [this, factory, &apply]() {
+        factory->SetReceiveContext(unique_id_);
+        apply();
+        factory->SetReceiveContext(0);
+      });
 }
 
 RefPtr<Transceiver> PeerConnection::FindWrapperFromRtpTransceiver(
@@ -1327,8 +1541,12 @@ ErrorOr<RefPtr<PeerConnection>> PeerConnection::create(
 
   // Ensure the factory exists
   RefPtr<GlobalFactory> global_factory(GlobalFactory::InstancePtr());
+  if (!global_factory) {
+    return Error(Result::kUnknownError);
+  }
+  const uint32_t shard = global_factory->SelectShard(config.factory_shard);
   rtc::scoped_refptr<webrtc::PeerConnectionFactoryInterface> pc_factory =
-      global_factory->GetPeerConnectionFactory();
+      global_factory->GetPeerConnectionFactory(shard);
   if (!pc_factory) {
     return Error(Result::kUnknownError);
   }
@@ -1347,7 +1565,7 @@ ErrorOr<RefPtr<PeerConnection>> PeerConnection::create(
       (config.sdp_semantic == mrsSdpSemantic::kUnifiedPlan
            ? webrtc::SdpSemantics::kUnifiedPlan
            : webrtc::SdpSemantics::kPlanB);
-  auto peer = new PeerConnection(std::move(global_factory));
+  auto peer = new PeerConnection(std::move(global_factory), shard);
   webrtc::PeerConnectionDependencies dependencies(peer);
   rtc::scoped_refptr<webrtc::PeerConnectionInterface> impl =
       pc_factory->CreatePeerConnection(rtc_config, std::move(dependencies));
@@ -1358,17 +1576,72 @@ ErrorOr<RefPtr<PeerConnection>> PeerConnection::create(
   return RefPtr<PeerConnection>(peer);
 }
 
-void PeerConnection::GetStats(webrtc::RTCStatsCollectorCallback* callback) {
-  peer_->GetStats(callback);
+Error PeerConnection::StartStatsSampler(
+    const mrsStatsSamplerConfig& config) noexcept {
+  if (IsClosed()) {
+    return Error(Result::kInvalidOperation, "The peer connection is closed.");
+  }
+  if ((config.interval_ms <= 0) || (config.history_size <= 0)) {
+    return Error(Result::kInvalidParameter);
+  }
+  auto sampler = StatsSampler::Create(
+      peer_, stats_collector_, global_factory_->GetSignalingThread(shard_),
+      config, key_frame_stats_);
+  rtc::scoped_refptr<StatsSampler> old_sampler;
+  {
+    std::lock_guard<std::mutex> lock(stats_sampler_mutex_);
+    old_sampler = std::move(stats_sampler_);
+    stats_sampler_ = std::move(sampler);
+  }
+  if (old_sampler) {
+    old_sampler->Stop();
+  }
+  return Error::OK();
+}
+
+void PeerConnection::StopStatsSampler() noexcept {
+  std::lock_guard<std::mutex> lock(stats_sampler_mutex_);
+  if (stats_sampler_) {
+    stats_sampler_->Stop();
+  }
+}
+
+Error PeerConnection::GetStatsSnapshot(
+    mrsStatsSamplerSnapshot& snapshot) const noexcept {
+  std::lock_guard<std::mutex> lock(stats_sampler_mutex_);
+  if (!stats_sampler_) {
+    return Error(Result::kInvalidOperation,
+                 "The stats sampler was never started.");
+  }
+  stats_sampler_->GetSnapshot(snapshot);
+  return Error::OK();
+}
+
+Error PeerConnection::GetStats(
+    webrtc::RTCStatsCollectorCallback* callback) noexcept {
+  if (!peer_) {
+    return Error(Result::kPeerConnectionClosed);
+  }
+  stats_collector_->GetStats(peer_, callback);
+  return Error::OK();
 }
 
 void PeerConnection::InvokeRenegotiationNeeded() {
   OnRenegotiationNeeded();
 }
 
-PeerConnection::PeerConnection(RefPtr<GlobalFactory> global_factory)
+PeerConnection::PeerConnection(RefPtr<GlobalFactory> global_factory,
+                               uint32_t shard)
     : TrackedObject(std::move(global_factory), ObjectType::kPeerConnection),
-      audio_mixer_(global_factory_->audio_mixer()) {}
+      shard_(shard),
+      unique_id_(next_unique_id.fetch_add(1, std::memory_order_relaxed)),
+      audio_mixer_(global_factory_->audio_mixer(shard)),
+      stats_collector_(CoalescingStatsCollector::Create(
+          global_factory_->GetSignalingThread(shard))) {
+  memory_account_ = std::make_shared<MemoryAccount>(this);
+  CpuBudgetManager::Instance().Register(
+      this, global_factory_->GetSignalingThread(shard));
+}
 
 }  // namespace WebRTC
 }  // namespace MixedReality
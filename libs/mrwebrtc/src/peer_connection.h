@@ -5,11 +5,14 @@
 
 #include "audio_frame_observer.h"
 #include "callback.h"
+#include "cpu_budget_manager.h"
 #include "data_channel.h"
 #include "media/transceiver.h"
 #include "mrs_errors.h"
 #include "peer_connection_interop.h"
 #include "refptr.h"
+#include "stats_report.h"
+#include "stats_sampler.h"
 #include "toggle_audio_mixer.h"
 #include "tracked_object.h"
 #include "utils.h"
@@ -39,6 +42,19 @@ struct BitrateSettings {
   absl::optional<int> max_bitrate_bps;
 };
 
+/// Encoding limits of the RTP senders of the video transceivers with a local
+/// track. Unset limits are removed from the senders.
+struct VideoSendLimits {
+  /// Factor the resolution of the encoded frames is scaled down by.
+  absl::optional<double> scale_resolution_down_by;
+
+  /// Maximum frame rate of the encoded stream.
+  absl::optional<int> max_framerate;
+
+  /// Maximum bitrate of the encoded stream, in bits per second.
+  absl::optional<int> max_bitrate_bps;
+};
+
 /// The PeerConnection class is the entry point to most of WebRTC.
 /// It encapsulates a single connection between a local peer and a remote peer,
 /// and hosts some critical events for signaling.
@@ -79,6 +95,15 @@ class PeerConnection : public TrackedObject,
   static ErrorOr<RefPtr<PeerConnection>> create(
       const mrsPeerConnectionConfiguration& config);
 
+  /// Get the index of the factory shard running this peer connection.
+  MRS_NODISCARD uint32_t GetShard() const noexcept { return shard_; }
+
+  /// Get the audio mixer of the factory shard running this peer connection.
+  MRS_NODISCARD const rtc::scoped_refptr<ToggleAudioMixer>& GetAudioMixer()
+      const noexcept {
+    return audio_mixer_;
+  }
+
   //
   // Signaling
   //
@@ -102,6 +127,8 @@ class PeerConnection : public TrackedObject,
       LocalSdpReadytoSendCallback&& callback) noexcept {
     std::lock_guard<std::mutex> lock(local_sdp_ready_to_send_callback_mutex_);
     local_sdp_ready_to_send_callback_ = std::move(callback);
+    local_sdp_ready_to_send_callback_.SetSite(
+        this, mrsCallbackType::kLocalSdpReadyToSend);
   }
 
   /// Callback invoked when a local ICE candidate message is ready to be sent to
@@ -119,6 +146,8 @@ class PeerConnection : public TrackedObject,
     std::lock_guard<std::mutex> lock(
         ice_candidate_ready_to_send_callback_mutex_);
     ice_candidate_ready_to_send_callback_ = std::move(callback);
+    ice_candidate_ready_to_send_callback_.SetSite(
+        this, mrsCallbackType::kIceCandidateReadyToSend);
   }
 
   /// Callback invoked when the state of the ICE connection changed.
@@ -133,6 +162,8 @@ class PeerConnection : public TrackedObject,
       IceStateChangedCallback&& callback) noexcept {
     std::lock_guard<std::mutex> lock(ice_state_changed_callback_mutex_);
     ice_state_changed_callback_ = std::move(callback);
+    ice_state_changed_callback_.SetSite(this,
+                                        mrsCallbackType::kIceStateChanged);
   }
 
   /// Callback invoked when the state of the ICE gathering changed.
@@ -146,6 +177,8 @@ class PeerConnection : public TrackedObject,
     std::lock_guard<std::mutex> lock(
         ice_gathering_state_changed_callback_mutex_);
     ice_gathering_state_changed_callback_ = std::move(callback);
+    ice_gathering_state_changed_callback_.SetSite(
+        this, mrsCallbackType::kIceGatheringStateChanged);
   }
 
   /// Callback invoked when some SDP negotiation needs to be initiated, often
@@ -165,6 +198,8 @@ class PeerConnection : public TrackedObject,
       RenegotiationNeededCallback&& callback) noexcept {
     std::lock_guard<std::mutex> lock(renegotiation_needed_callback_mutex_);
     renegotiation_needed_callback_ = std::move(callback);
+    renegotiation_needed_callback_.SetSite(
+        this, mrsCallbackType::kRenegotiationNeeded);
   }
 
   /// Notify the WebRTC engine that an ICE candidate has been received from the
@@ -202,11 +237,14 @@ class PeerConnection : public TrackedObject,
   void RegisterConnectedCallback(ConnectedCallback&& callback) noexcept {
     std::lock_guard<std::mutex> lock(connected_callback_mutex_);
     connected_callback_ = std::move(callback);
+    connected_callback_.SetSite(this, mrsCallbackType::kConnected);
   }
 
   /// Set the connection bitrate limits. These settings limit the network
   /// bandwidth use of the peer connection.
   mrsResult SetBitrate(const BitrateSettings& settings) noexcept {
+    max_bitrate_bps_.store(settings.max_bitrate_bps.value_or(0),
+                           std::memory_order_relaxed);
     webrtc::BitrateSettings bitrate;
     bitrate.start_bitrate_bps = settings.start_bitrate_bps;
     bitrate.min_bitrate_bps = settings.min_bitrate_bps;
@@ -214,6 +252,38 @@ class PeerConnection : public TrackedObject,
     return ResultFromRTCErrorType(peer_->SetBitrate(bitrate).type());
   }
 
+  /// Get the maximum bitrate last set with |SetBitrate()|, in bits per second,
+  /// or zero if none.
+  MRS_NODISCARD int GetMaxBitrate() const noexcept {
+    return max_bitrate_bps_.load(std::memory_order_relaxed);
+  }
+
+  /// Apply encoding limits to the RTP senders of all the video transceivers
+  /// with a local track, and set |sender_count| to the number of senders the
+  /// limits were applied to. Senders without encoding yet are skipped. The
+  /// resolution and frame rate limits are only applied while
+  /// |resolution_supported| and |framerate_supported| respectively are true.
+  /// If the WebRTC implementation rejects the resolution limit, the frame rate
+  /// and bitrate limits are applied alone and |resolution_supported| is set to
+  /// false; if it rejects the frame rate limit too, only the bitrate is
+  /// limited and |framerate_supported| is set to false. This must be called on
+  /// the signaling thread.
+  Result SetVideoSendLimits(const VideoSendLimits& limits,
+                            uint32_t& sender_count,
+                            bool& resolution_supported,
+                            bool& framerate_supported) noexcept;
+
+  /// Get the ID of the SDP stream received by an RTP receiver, which WebRTC
+  /// passes to the video decoder factory when creating its decoder, or an
+  /// empty string if not found in the remote description.
+  std::string GetReceiveStreamId(
+      webrtc::RtpReceiverInterface* receiver) noexcept;
+
+  /// Get the ID of the peer connection, unique in the process and never reused
+  /// unlike its address, which identifies its receive streams together with
+  /// their SDP stream ID; see |ReceiveStreamKey|.
+  MRS_NODISCARD uint64_t GetUniqueId() const noexcept { return unique_id_; }
+
   /// Create an SDP offer to attempt to establish a connection with the remote
   /// peer. Once the offer message is ready, the |LocalSdpReadytoSendCallback|
   /// callback is invoked to deliver the message.
@@ -229,6 +299,15 @@ class PeerConnection : public TrackedObject,
   /// object instead to create a new connection. No-op if already closed.
   void Close() noexcept;
 
+  /// Close several peer connections concurrently, and invoke |callback| once
+  /// all are closed. The connections of each factory shard are closed in a
+  /// single task on the signaling thread of that shard, avoiding a round trip
+  /// per connection, and the shards proceed in parallel. The connections must
+  /// stay alive until |callback| is invoked, on the WebRTC signaling thread of
+  /// the last shard to complete. See |mrsPeerConnectionCloseMany()|.
+  static void CloseMany(std::vector<PeerConnection*> peers,
+                        Callback<> callback) noexcept;
+
   /// Check if the connection is closed. This returns |true| once |Close()| has
   /// been called.
   bool IsClosed() const noexcept;
@@ -247,6 +326,8 @@ class PeerConnection : public TrackedObject,
       TransceiverAddedCallback&& callback) noexcept {
     std::lock_guard<std::mutex> lock(callbacks_mutex_);
     transceiver_added_callback_ = std::move(callback);
+    transceiver_added_callback_.SetSite(this,
+                                        mrsCallbackType::kTransceiverAdded);
   }
 
   /// Add a new audio or video transceiver to the peer connection.
@@ -270,6 +351,8 @@ class PeerConnection : public TrackedObject,
       VideoTrackAddedCallback&& callback) noexcept {
     std::lock_guard<std::mutex> lock(media_track_callback_mutex_);
     video_track_added_callback_ = std::move(callback);
+    video_track_added_callback_.SetSite(this,
+                                        mrsCallbackType::kVideoTrackAdded);
   }
 
   /// Callback invoked when a remote video track is removed from the peer
@@ -284,6 +367,8 @@ class PeerConnection : public TrackedObject,
       VideoTrackRemovedCallback&& callback) noexcept {
     std::lock_guard<std::mutex> lock(media_track_callback_mutex_);
     video_track_removed_callback_ = std::move(callback);
+    video_track_removed_callback_.SetSite(this,
+                                          mrsCallbackType::kVideoTrackRemoved);
   }
 
   /// Rounding mode of video frame height for |SetFrameHeightRoundMode()|.
@@ -329,6 +414,8 @@ class PeerConnection : public TrackedObject,
       AudioTrackAddedCallback&& callback) noexcept {
     std::lock_guard<std::mutex> lock(media_track_callback_mutex_);
     audio_track_added_callback_ = std::move(callback);
+    audio_track_added_callback_.SetSite(this,
+                                        mrsCallbackType::kAudioTrackAdded);
   }
 
   /// Callback invoked when a remote audio track is removed from the peer
@@ -343,6 +430,8 @@ class PeerConnection : public TrackedObject,
       AudioTrackRemovedCallback&& callback) noexcept {
     std::lock_guard<std::mutex> lock(media_track_callback_mutex_);
     audio_track_removed_callback_ = std::move(callback);
+    audio_track_removed_callback_.SetSite(this,
+                                          mrsCallbackType::kAudioTrackRemoved);
   }
 
   //
@@ -364,6 +453,8 @@ class PeerConnection : public TrackedObject,
       DataChannelAddedCallback callback) noexcept {
     std::lock_guard<std::mutex> lock(data_channel_added_callback_mutex_);
     data_channel_added_callback_ = std::move(callback);
+    data_channel_added_callback_.SetSite(this,
+                                         mrsCallbackType::kDataChannelAdded);
   }
 
   /// Register a custom callback invoked when a data channel is removed by the
@@ -373,6 +464,8 @@ class PeerConnection : public TrackedObject,
       DataChannelRemovedCallback callback) noexcept {
     std::lock_guard<std::mutex> lock(data_channel_removed_callback_mutex_);
     data_channel_removed_callback_ = std::move(callback);
+    data_channel_removed_callback_.SetSite(
+        this, mrsCallbackType::kDataChannelRemoved);
   }
 
   /// Create a new data channel and add it to the peer connection.
@@ -398,8 +491,42 @@ class PeerConnection : public TrackedObject,
   void OnStreamChanged(
       rtc::scoped_refptr<webrtc::MediaStreamInterface> stream) noexcept;
 
+  //
+  // Stats
+  //
+
+  /// Start the periodic stats sampler, replacing any sampler already running.
+  /// Sampling stops automatically when the connection is closed.
+  Error StartStatsSampler(const mrsStatsSamplerConfig& config) noexcept;
+
+  /// Stop the periodic stats sampler if running. The last snapshot remains
+  /// available through |GetStatsSnapshot()|.
+  void StopStatsSampler() noexcept;
+
+  /// Get the latest aggregated snapshot of the stats sampler. Fails if the
+  /// sampler was never started.
+  Error GetStatsSnapshot(mrsStatsSamplerSnapshot& snapshot) const noexcept;
+
+  /// Get the counters of the on-demand key frame requests of the video tracks
+  /// of the peer connection, reported by the stats sampler.
+  MRS_NODISCARD const std::shared_ptr<KeyFrameRequestStats>&
+  GetKeyFrameRequestStats() const noexcept {
+    return key_frame_stats_;
+  }
+
+  /// Set the maximum age in milliseconds of a cached stats report for it to be
+  /// reused by |GetStats()| instead of starting a new collection. Zero disables
+  /// caching; concurrent requests are coalesced regardless.
+  void SetStatsMaxAge(int max_age_ms) noexcept {
+    stats_collector_->SetMaxAge(max_age_ms * rtc::kNumMicrosecsPerMillisec);
+  }
+
+  /// Request a stats report, delivered asynchronously to |callback| on the
+  /// signaling thread. Requests are coalesced and possibly completed from a
+  /// cached report; see |SetStatsMaxAge()|.
+  Error GetStats(webrtc::RTCStatsCollectorCallback* callback) noexcept;
+
   // Internal use.
-  void GetStats(webrtc::RTCStatsCollectorCallback* callback);
   void InvokeRenegotiationNeeded();
 
   //
@@ -596,12 +723,51 @@ class PeerConnection : public TrackedObject,
   /// looks like this is only a problem for negotiated (out-of-band) channels.
   bool sctp_negotiated_ = true;
 
+  /// Index of the factory shard whose threads run this peer connection.
+  const uint32_t shard_;
+
+  /// Unique ID of the peer connection; see |GetUniqueId()|.
+  const uint64_t unique_id_;
+
+  /// Maximum bitrate last set with |SetBitrate()|, or zero if none.
+  std::atomic_int max_bitrate_bps_{0};
+
   rtc::scoped_refptr<ToggleAudioMixer> audio_mixer_;
 
+  /// Periodic stats sampler, if ever started. This is kept after being stopped
+  /// to allow reading the last snapshot.
+  rtc::scoped_refptr<StatsSampler> stats_sampler_
+      RTC_GUARDED_BY(stats_sampler_mutex_);
+
+  /// Mutex for the stats sampler.
+  mutable std::mutex stats_sampler_mutex_;
+
+  /// Counters of the on-demand key frame requests, shared with the stats
+  /// sampler and the tracks which can outlive the peer connection.
+  const std::shared_ptr<KeyFrameRequestStats> key_frame_stats_ =
+      std::make_shared<KeyFrameRequestStats>();
+
+  /// Collector coalescing stats requests from |GetStats()|.
+  rtc::scoped_refptr<CoalescingStatsCollector> stats_collector_;
+
  private:
-  PeerConnection(RefPtr<GlobalFactory> global_factory);
+  PeerConnection(RefPtr<GlobalFactory> global_factory, uint32_t shard);
   PeerConnection(const PeerConnection&) = delete;
-  ~PeerConnection() noexcept { Close(); }
+
+  /// Run a call applying a session description on the signaling thread, with
+  /// this peer connection as the receive context of the video decoder factory
+  /// of its shard, so that the decoders created meanwhile know their receive
+  /// stream; see |ForwardingVideoDecoderFactory::SetReceiveContext()|.
+  void InvokeWithReceiveContext(const std::function<void()>& apply) noexcept;
+  ~PeerConnection() noexcept {
+    // Unregister first, so that the budget manager can't apply limits while
+    // the connection closes.
+    CpuBudgetManager::Instance().Unregister(this);
+    Close();
+    // The account can outlive the peer connection, shared with remote tracks
+    // still referenced by the application; stop reporting this handle.
+    memory_account_->SetBudget(0, {});
+  }
   PeerConnection& operator=(const PeerConnection&) = delete;
 
   bool IsPlanB() const {
@@ -5,6 +5,7 @@
 #include "pch.h"
 
 #include "sdp_utils.h"
+#include "tracing.h"
 
 #include "api/jsepsessiondescription.h"
 #include "pc/sessiondescription.h"
@@ -100,6 +101,7 @@ std::string SdpForceCodecs(
     const std::map<std::string, std::string>& extra_audio_codec_params,
     const std::string& video_codec_name,
     const std::map<std::string, std::string>& extra_video_codec_params) {
+  MRS_TRACE_SCOPE("SdpForceCodecs");
   // Deserialize the SDP message
   webrtc::JsepSessionDescription jdesc(webrtc::SdpType::kOffer);
   webrtc::SdpParseError error;
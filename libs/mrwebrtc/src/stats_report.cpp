@@ -0,0 +1,386 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+// This is a precompiled header, it must be on its own, followed by a blank
+// line, to prevent clang-format from reordering it with other headers.
+#include "pch.h"
+
+#include <algorithm>
+#include <unordered_map>
+
+#include "stats_report.h"
+#include "tracing.h"
+
+namespace {
+
+using namespace Microsoft::MixedReality::WebRTC;
+
+template <class T>
+void GetCommonValues(T& lhs, const webrtc::RTCOutboundRTPStreamStats& rhs) {
+  lhs.rtp_stats_timestamp_us = rhs.timestamp_us();
+  lhs.packets_sent = *rhs.packets_sent;
+  lhs.bytes_sent = *rhs.bytes_sent;
+}
+template <class T>
+void GetCommonValues(T& lhs, const webrtc::RTCInboundRTPStreamStats& rhs) {
+  lhs.rtp_stats_timestamp_us = rhs.timestamp_us();
+  lhs.packets_received = *rhs.packets_received;
+  lhs.bytes_received = *rhs.bytes_received;
+}
+
+template <class T>
+T GetValueIfDefined(const webrtc::RTCStatsMember<T>& member) {
+  return member.is_defined() ? *member : 0;
+}
+
+template <class T>
+void GetTrackValues(T& lhs, const webrtc::RTCMediaStreamTrackStats& rhs) {
+  lhs.track_stats_timestamp_us = rhs.timestamp_us();
+  lhs.track_identifier = rhs.track_identifier->c_str();
+}
+
+/// Index of a pending sender/receiver stats object, keyed by the ID of the
+/// track stats object the RTP stats are associated with.
+struct PendingEntry {
+  mrsStatsType type;
+  size_t index;
+};
+
+/// Helper to pair RTP stream stats with track stats in a single pass,
+/// regardless of the order in which they appear in the report.
+class TrackIndex {
+ public:
+  explicit TrackIndex(size_t capacity) { index_.reserve(capacity); }
+
+  template <class T>
+  T& FindOrInsert(std::vector<T>& vec,
+                  mrsStatsType type,
+                  const std::string& track_id) {
+    auto it = index_.find(track_id);
+    if (it != index_.end()) {
+      RTC_DCHECK(it->second.type == type);
+      return vec[it->second.index];
+    }
+    index_.emplace(track_id, PendingEntry{type, vec.size()});
+    vec.emplace_back();
+    return vec.back();
+  }
+
+ private:
+  std::unordered_map<std::string, PendingEntry> index_;
+};
+
+}  // namespace
+
+namespace Microsoft {
+namespace MixedReality {
+namespace WebRTC {
+
+void SimpleStats::Extract(const webrtc::RTCStatsReport& report) {
+  MRS_TRACE_SCOPE("SimpleStats::Extract");
+  data_channels_.clear();
+  audio_senders_.clear();
+  audio_receivers_.clear();
+  video_senders_.clear();
+  video_receivers_.clear();
+  transports_.clear();
+
+  // Get values from both RTC{Outbound|Inbound}RTPStreamStats and
+  // RTCMediaStreamTrackStats objects, and match them together by track ID.
+  TrackIndex index(report.size());
+  for (auto&& stats : report) {
+    // The type string of a stats object is the static |kType| member of its
+    // class, so comparing pointers is enough (this is also what cast_to()
+    // checks) and avoids a string comparison per object per type.
+    const char* const type = stats.type();
+    if (type == webrtc::RTCOutboundRTPStreamStats::kType) {
+      const auto& ortp_stats =
+          stats.cast_to<webrtc::RTCOutboundRTPStreamStats>();
+      // Removing a track will leave a "trackless" RTP stream. Ignore it.
+      if (!ortp_stats.track_id.is_defined()) {
+        continue;
+      }
+      if (*ortp_stats.kind == "audio") {
+        auto& dest_stats =
+            index.FindOrInsert(audio_senders_, mrsStatsType::kAudioSender,
+                               *ortp_stats.track_id);
+        GetCommonValues(dest_stats, ortp_stats);
+      } else if (*ortp_stats.kind == "video") {
+        auto& dest_stats =
+            index.FindOrInsert(video_senders_, mrsStatsType::kVideoSender,
+                               *ortp_stats.track_id);
+        GetCommonValues(dest_stats, ortp_stats);
+        dest_stats.frames_encoded = *ortp_stats.frames_encoded;
+      }
+    } else if (type == webrtc::RTCInboundRTPStreamStats::kType) {
+      const auto& irtp_stats =
+          stats.cast_to<webrtc::RTCInboundRTPStreamStats>();
+      if (!irtp_stats.track_id.is_defined()) {
+        continue;
+      }
+      if (*irtp_stats.kind == "audio") {
+        auto& dest_stats =
+            index.FindOrInsert(audio_receivers_, mrsStatsType::kAudioReceiver,
+                               *irtp_stats.track_id);
+        GetCommonValues(dest_stats, irtp_stats);
+      } else if (*irtp_stats.kind == "video") {
+        auto& dest_stats =
+            index.FindOrInsert(video_receivers_, mrsStatsType::kVideoReceiver,
+                               *irtp_stats.track_id);
+        GetCommonValues(dest_stats, irtp_stats);
+        dest_stats.frames_decoded = *irtp_stats.frames_decoded;
+      }
+    } else if (type == webrtc::RTCMediaStreamTrackStats::kType) {
+      const auto& track_stats =
+          stats.cast_to<webrtc::RTCMediaStreamTrackStats>();
+      const bool is_remote = *track_stats.remote_source;
+      if (*track_stats.kind == "audio") {
+        if (is_remote) {
+          auto& dest_stats = index.FindOrInsert(
+              audio_receivers_, mrsStatsType::kAudioReceiver, track_stats.id());
+          GetTrackValues(dest_stats, track_stats);
+          // This seems to be undefined in some not well specified cases.
+          dest_stats.audio_level = GetValueIfDefined(track_stats.audio_level);
+          dest_stats.total_audio_energy = *track_stats.total_audio_energy;
+          dest_stats.total_samples_received =
+              GetValueIfDefined(track_stats.total_samples_received);
+          dest_stats.total_samples_duration =
+              *track_stats.total_samples_duration;
+        } else {
+          auto& dest_stats = index.FindOrInsert(
+              audio_senders_, mrsStatsType::kAudioSender, track_stats.id());
+          GetTrackValues(dest_stats, track_stats);
+          dest_stats.audio_level = GetValueIfDefined(track_stats.audio_level);
+          dest_stats.total_audio_energy = *track_stats.total_audio_energy;
+          dest_stats.total_samples_duration =
+              *track_stats.total_samples_duration;
+        }
+      } else if (*track_stats.kind == "video") {
+        if (is_remote) {
+          auto& dest_stats = index.FindOrInsert(
+              video_receivers_, mrsStatsType::kVideoReceiver, track_stats.id());
+          GetTrackValues(dest_stats, track_stats);
+          dest_stats.frames_received =
+              GetValueIfDefined(track_stats.frames_received);
+          dest_stats.frames_dropped =
+              GetValueIfDefined(track_stats.frames_dropped);
+        } else {
+          auto& dest_stats = index.FindOrInsert(
+              video_senders_, mrsStatsType::kVideoSender, track_stats.id());
+          GetTrackValues(dest_stats, track_stats);
+          dest_stats.frames_sent = GetValueIfDefined(track_stats.frames_sent);
+          dest_stats.huge_frames_sent =
+              GetValueIfDefined(track_stats.huge_frames_sent);
+        }
+      }
+    } else if (type == webrtc::RTCDataChannelStats::kType) {
+      const auto& dc_stats = stats.cast_to<webrtc::RTCDataChannelStats>();
+      data_channels_.push_back(mrsDataChannelStats{
+          dc_stats.timestamp_us(), *dc_stats.datachannelid,
+          *dc_stats.messages_sent, *dc_stats.bytes_sent,
+          *dc_stats.messages_received, *dc_stats.bytes_received});
+    } else if (type == webrtc::RTCTransportStats::kType) {
+      const auto& tr_stats = stats.cast_to<webrtc::RTCTransportStats>();
+      transports_.push_back(mrsTransportStats{tr_stats.timestamp_us(),
+                                              *tr_stats.bytes_sent,
+                                              *tr_stats.bytes_received});
+    }
+  }
+}
+
+const void* SimpleStats::GetArray(mrsStatsType type, uint64_t* count) const
+    noexcept {
+  switch (type) {
+    case mrsStatsType::kDataChannel:
+      *count = data_channels_.size();
+      return data_channels_.data();
+    case mrsStatsType::kAudioSender:
+      *count = audio_senders_.size();
+      return audio_senders_.data();
+    case mrsStatsType::kAudioReceiver:
+      *count = audio_receivers_.size();
+      return audio_receivers_.data();
+    case mrsStatsType::kVideoSender:
+      *count = video_senders_.size();
+      return video_senders_.data();
+    case mrsStatsType::kVideoReceiver:
+      *count = video_receivers_.size();
+      return video_receivers_.data();
+    case mrsStatsType::kTransport:
+      *count = transports_.size();
+      return transports_.data();
+    default:
+      *count = 0;
+      return nullptr;
+  }
+}
+
+size_t SimpleStats::GetObjectSize(mrsStatsType type) noexcept {
+  switch (type) {
+    case mrsStatsType::kDataChannel:
+      return sizeof(mrsDataChannelStats);
+    case mrsStatsType::kAudioSender:
+      return sizeof(mrsAudioSenderStats);
+    case mrsStatsType::kAudioReceiver:
+      return sizeof(mrsAudioReceiverStats);
+    case mrsStatsType::kVideoSender:
+      return sizeof(mrsVideoSenderStats);
+    case mrsStatsType::kVideoReceiver:
+      return sizeof(mrsVideoReceiverStats);
+    case mrsStatsType::kTransport:
+      return sizeof(mrsTransportStats);
+    default:
+      return 0;
+  }
+}
+
+const SimpleStats& StatsReport::GetSimpleStats() const {
+  std::call_once(simple_stats_once_,
+                 [this]() { simple_stats_.Extract(*report_); });
+  return simple_stats_;
+}
+
+Result StatsReport::CopyJson(absl::string_view type_filter,
+                             char* buffer,
+                             uint64_t& buffer_size) const {
+  MRS_TRACE_SCOPE("StatsReport::CopyJson");
+  std::lock_guard<std::mutex> lock(json_mutex_);
+  if (!json_.has_value() || (absl::string_view(json_filter_) != type_filter)) {
+    // Split the filter once, so that each stats object is matched with a
+    // handful of string comparisons.
+    std::vector<absl::string_view> types;
+    for (absl::string_view filter = type_filter; !filter.empty();) {
+      const size_t pos = filter.find(',');
+      absl::string_view type = filter.substr(0, pos);
+      if (!type.empty()) {
+        types.push_back(type);
+      }
+      if (pos == absl::string_view::npos) {
+        break;
+      }
+      filter.remove_prefix(pos + 1);
+    }
+
+    std::string json;
+    json.reserve(report_->size() * 256);
+    json.push_back('[');
+    bool first = true;
+    for (auto&& stats : *report_) {
+      if (!types.empty() &&
+          (std::find(types.begin(), types.end(),
+                     absl::string_view(stats.type())) == types.end())) {
+        continue;
+      }
+      if (!first) {
+        json.push_back(',');
+      }
+      first = false;
+      json.append(stats.ToJson());
+    }
+    json.push_back(']');
+    json_filter_.assign(type_filter.data(), type_filter.size());
+    json_ = std::move(json);
+  }
+
+  const std::string& json = *json_;
+  const uint64_t capacity = buffer_size;
+  const uint64_t size_with_terminator = json.size() + 1;
+  // Always assign size, even if buffer too small
+  buffer_size = size_with_terminator;
+  if (size_with_terminator > capacity) {
+    return Result::kBufferTooSmall;
+  }
+  memcpy(buffer, json.c_str(), static_cast<size_t>(size_with_terminator));
+  return Result::kSuccess;
+}
+
+namespace {
+
+enum {
+  /// Deliver a cached report to a single callback.
+  MSG_DELIVER_CACHED
+};
+
+/// Message data for delivering a cached report. This holds a reference to the
+/// collector to keep it alive until the message is dispatched.
+struct DeliverCachedData : public rtc::MessageData {
+  rtc::scoped_refptr<CoalescingStatsCollector> collector_;
+  rtc::scoped_refptr<webrtc::RTCStatsCollectorCallback> callback_;
+  rtc::scoped_refptr<const webrtc::RTCStatsReport> report_;
+};
+
+}  // namespace
+
+rtc::scoped_refptr<CoalescingStatsCollector> CoalescingStatsCollector::Create(
+    rtc::Thread* signaling_thread) {
+  return new rtc::RefCountedObject<CoalescingStatsCollector>(signaling_thread);
+}
+
+void CoalescingStatsCollector::SetMaxAge(int64_t max_age_us) noexcept {
+  std::lock_guard<std::mutex> lock(mutex_);
+  max_age_us_ = std::max<int64_t>(max_age_us, 0);
+  if (max_age_us_ == 0) {
+    cached_report_ = nullptr;
+  }
+}
+
+void CoalescingStatsCollector::GetStats(
+    webrtc::PeerConnectionInterface* peer,
+    rtc::scoped_refptr<webrtc::RTCStatsCollectorCallback> callback) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (cached_report_ &&
+        (rtc::TimeMicros() - cached_time_us_ <= max_age_us_)) {
+      auto data = new DeliverCachedData();
+      data->collector_ = this;
+      data->callback_ = std::move(callback);
+      data->report_ = cached_report_;
+      signaling_thread_->Post(RTC_FROM_HERE, this, MSG_DELIVER_CACHED, data);
+      return;
+    }
+    const bool in_flight = !pending_.empty();
+    pending_.push_back(std::move(callback));
+    if (in_flight) {
+      return;
+    }
+  }
+  // Start a new collection. This holds a reference to this collector until the
+  // report is delivered.
+  peer->GetStats(this);
+}
+
+void CoalescingStatsCollector::ClearCache() noexcept {
+  std::lock_guard<std::mutex> lock(mutex_);
+  cached_report_ = nullptr;
+}
+
+void CoalescingStatsCollector::OnStatsDelivered(
+    const rtc::scoped_refptr<const webrtc::RTCStatsReport>& report) {
+  std::vector<rtc::scoped_refptr<webrtc::RTCStatsCollectorCallback>> callbacks;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    callbacks.swap(pending_);
+    if (max_age_us_ > 0) {
+      cached_report_ = report;
+      cached_time_us_ = rtc::TimeMicros();
+    }
+  }
+  // Invoke callbacks outside the lock, as they may issue new requests.
+  for (auto&& callback : callbacks) {
+    callback->OnStatsDelivered(report);
+  }
+}
+
+void CoalescingStatsCollector::OnMessage(rtc::Message* message) {
+  switch (message->message_id) {
+    case MSG_DELIVER_CACHED: {
+      std::unique_ptr<DeliverCachedData> data(
+          static_cast<DeliverCachedData*>(message->pdata));
+      data->callback_->OnStatsDelivered(data->report_);
+    } break;
+  }
+}
+
+}  // namespace WebRTC
+}  // namespace MixedReality
+}  // namespace Microsoft
@@ -0,0 +1,148 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include "interop_api.h"
+#include "ref_counted_base.h"
+
+#include "absl/strings/string_view.h"
+
+namespace Microsoft {
+namespace MixedReality {
+namespace WebRTC {
+
+/// Simple stats objects extracted from a WebRTC stats report, grouped by type
+/// into contiguous arrays.
+///
+/// All arrays are filled in a single pass over the source report. Strings
+/// referenced by the extracted objects (the |track_identifier| fields) point
+/// into the source report, which must outlive this object.
+struct SimpleStats {
+  std::vector<mrsDataChannelStats> data_channels_;
+  std::vector<mrsAudioSenderStats> audio_senders_;
+  std::vector<mrsAudioReceiverStats> audio_receivers_;
+  std::vector<mrsVideoSenderStats> video_senders_;
+  std::vector<mrsVideoReceiverStats> video_receivers_;
+  std::vector<mrsTransportStats> transports_;
+
+  /// Extract all simple stats from the given report.
+  void Extract(const webrtc::RTCStatsReport& report);
+
+  /// Get a pointer to the contiguous array of objects of the given type, and
+  /// the number of elements in that array. Return a null pointer for an unknown
+  /// type.
+  const void* GetArray(mrsStatsType type, uint64_t* count) const noexcept;
+
+  /// Size in bytes of a single object of the given type, or zero if the type is
+  /// unknown.
+  static size_t GetObjectSize(mrsStatsType type) noexcept;
+};
+
+/// Stats report delivered to the interop layer. This keeps a reference to the
+/// underlying WebRTC report and lazily extracts the simple stats objects on
+/// first access, so that repeated queries on the same report don't re-parse it.
+class StatsReport : public RefCountedBase {
+ public:
+  explicit StatsReport(
+      rtc::scoped_refptr<const webrtc::RTCStatsReport> report) noexcept
+      : report_(std::move(report)) {}
+
+  const webrtc::RTCStatsReport& report() const noexcept { return *report_; }
+
+  /// Get the simple stats extracted from the report. This is thread-safe;
+  /// extraction is done at most once.
+  const SimpleStats& GetSimpleStats() const;
+
+  /// Serialize the report as a JSON array of stats objects into |buffer|, and
+  /// set |buffer_size| to the size of the string including its null terminator.
+  /// If |type_filter| is not empty, only the stats objects whose type is one of
+  /// the comma-separated types in the filter are serialized. Return
+  /// |Result::kBufferTooSmall| if |buffer| is not large enough, in which case
+  /// |buffer_size| is set to the required size. The last serialized string is
+  /// cached so that retrying with a larger buffer doesn't serialize again. This
+  /// is thread-safe.
+  Result CopyJson(absl::string_view type_filter,
+                  char* buffer,
+                  uint64_t& buffer_size) const;
+
+ private:
+  rtc::scoped_refptr<const webrtc::RTCStatsReport> report_;
+  mutable std::once_flag simple_stats_once_;
+  mutable SimpleStats simple_stats_;
+
+  /// Mutex for the JSON cache.
+  mutable std::mutex json_mutex_;
+
+  /// Filter used to produce |json_|.
+  mutable std::string json_filter_ RTC_GUARDED_BY(json_mutex_);
+
+  /// Last serialized JSON string, if any.
+  mutable absl::optional<std::string> json_ RTC_GUARDED_BY(json_mutex_);
+};
+
+/// Stats collector coalescing concurrent requests on a single peer connection.
+///
+/// Requests made while a collection is in flight are queued and completed with
+/// the same report as the in-flight one. Once delivered, the report is cached,
+/// and requests made within a configurable maximum age of the last delivery are
+/// completed from that cached report without starting a new collection. Cached
+/// deliveries are posted to the signaling thread, so that callbacks are always
+/// invoked on that thread like for a regular collection.
+class CoalescingStatsCollector : public rtc::MessageHandler,
+                                 public webrtc::RTCStatsCollectorCallback {
+ public:
+  static rtc::scoped_refptr<CoalescingStatsCollector> Create(
+      rtc::Thread* signaling_thread);
+
+  /// Set the maximum age of a cached report in microseconds. A value of zero
+  /// disables caching; concurrent requests are still coalesced.
+  void SetMaxAge(int64_t max_age_us) noexcept;
+
+  /// Request a stats report from |peer|, delivered to |callback|.
+  void GetStats(webrtc::PeerConnectionInterface* peer,
+                rtc::scoped_refptr<webrtc::RTCStatsCollectorCallback> callback);
+
+  /// Discard the cached report, if any.
+  void ClearCache() noexcept;
+
+  //
+  // RTCStatsCollectorCallback interface
+  //
+
+  void OnStatsDelivered(
+      const rtc::scoped_refptr<const webrtc::RTCStatsReport>& report) override;
+
+ protected:
+  explicit CoalescingStatsCollector(rtc::Thread* signaling_thread)
+      : signaling_thread_(signaling_thread) {}
+
+  //
+  // MessageHandler interface
+  //
+
+  void OnMessage(rtc::Message* message) override;
+
+  rtc::Thread* const signaling_thread_;
+
+  std::mutex mutex_;
+
+  /// Maximum age of |cached_report_| for it to be used.
+  int64_t max_age_us_ RTC_GUARDED_BY(mutex_) = 0;
+
+  /// Last report delivered, if caching is enabled.
+  rtc::scoped_refptr<const webrtc::RTCStatsReport> cached_report_
+      RTC_GUARDED_BY(mutex_);
+
+  /// Time at which |cached_report_| was delivered, from |rtc::TimeMicros()|.
+  int64_t cached_time_us_ RTC_GUARDED_BY(mutex_) = 0;
+
+  /// Callbacks waiting for the in-flight collection. A collection is in flight
+  /// if and only if this is not empty.
+  std::vector<rtc::scoped_refptr<webrtc::RTCStatsCollectorCallback>> pending_
+      RTC_GUARDED_BY(mutex_);
+};
+
+}  // namespace WebRTC
+}  // namespace MixedReality
+}  // namespace Microsoft
@@ -0,0 +1,257 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+// This is a precompiled header, it must be on its own, followed by a blank
+// line, to prevent clang-format from reordering it with other headers.
+#include "pch.h"
+
+#include <algorithm>
+
+#include "stats_sampler.h"
+#include "tracing.h"
+
+namespace {
+
+enum {
+  /// Request a new stats report.
+  MSG_SAMPLE
+};
+
+/// Get the value at the given percentile in [0:1] of a non-empty array. This
+/// reorders the array.
+double Percentile(std::vector<double>& values, double percentile) {
+  RTC_DCHECK(!values.empty());
+  const size_t rank = std::min(
+      values.size() - 1, static_cast<size_t>(percentile * values.size()));
+  std::nth_element(values.begin(), values.begin() + rank, values.end());
+  return values[rank];
+}
+
+double Rate(uint64_t current, uint64_t previous, double elapsed_sec) {
+  // Counters can go backward when a stream is removed; clamp to zero.
+  return (current > previous ? (current - previous) / elapsed_sec : 0.0);
+}
+
+}  // namespace
+
+namespace Microsoft {
+namespace MixedReality {
+namespace WebRTC {
+
+rtc::scoped_refptr<StatsSampler> StatsSampler::Create(
+    rtc::scoped_refptr<webrtc::PeerConnectionInterface> peer,
+    rtc::scoped_refptr<CoalescingStatsCollector> collector,
+    rtc::Thread* thread,
+    const mrsStatsSamplerConfig& config,
+    std::shared_ptr<KeyFrameRequestStats> key_frame_stats) {
+  rtc::scoped_refptr<StatsSampler> sampler =
+      new rtc::RefCountedObject<StatsSampler>(
+          std::move(peer), std::move(collector), thread, config,
+          std::move(key_frame_stats));
+  thread->Post(RTC_FROM_HERE, sampler.get(), MSG_SAMPLE);
+  return sampler;
+}
+
+StatsSampler::StatsSampler(
+    rtc::scoped_refptr<webrtc::PeerConnectionInterface> peer,
+    rtc::scoped_refptr<CoalescingStatsCollector> collector,
+    rtc::Thread* thread,
+    const mrsStatsSamplerConfig& config,
+    std::shared_ptr<KeyFrameRequestStats> key_frame_stats)
+    : thread_(thread),
+      interval_ms_(std::max(config.interval_ms, 10)),
+      collector_(std::move(collector)),
+      key_frame_stats_(std::move(key_frame_stats)),
+      peer_(std::move(peer)) {
+  RTC_DCHECK(key_frame_stats_);
+  const size_t history_size =
+      static_cast<size_t>(std::max(config.history_size, 1));
+  ring_.resize(history_size);
+  scratch_.reserve(history_size);
+}
+
+void StatsSampler::Stop() noexcept {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    peer_ = nullptr;
+  }
+  thread_->Clear(this);
+}
+
+void StatsSampler::GetSnapshot(mrsStatsSamplerSnapshot& snapshot) const
+    noexcept {
+  std::lock_guard<std::mutex> lock(mutex_);
+  snapshot = snapshot_;
+}
+
+void StatsSampler::OnMessage(rtc::Message* message) {
+  switch (message->message_id) {
+    case MSG_SAMPLE: {
+      rtc::scoped_refptr<webrtc::PeerConnectionInterface> peer;
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        peer = peer_;
+      }
+      if (peer) {
+        // The next sample is scheduled once this one is delivered, so that a
+        // slow collection doesn't pile up requests. A report cached by the
+        // collector for another request can be delivered again; it has the
+        // same timestamp as the previous sample, so no rate is computed.
+        collector_->GetStats(peer, this);
+      }
+    } break;
+  }
+}
+
+void StatsSampler::OnStatsDelivered(
+    const rtc::scoped_refptr<const webrtc::RTCStatsReport>& report) {
+  MRS_TRACE_SCOPE("StatsSampler::OnStatsDelivered");
+  RawSample raw = ExtractRawSample(*report);
+  raw.key_frames_requested =
+      key_frame_stats_->requested.load(std::memory_order_relaxed);
+  raw.key_frames_completed =
+      key_frame_stats_->completed.load(std::memory_order_relaxed);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!peer_) {
+      // Stopped while the collection was pending
+      return;
+    }
+    const int64_t max_delay_us =
+        key_frame_stats_->max_delay_us.exchange(0, std::memory_order_relaxed);
+    if (max_delay_us > 0) {
+      last_key_frame_delay_ms_ = max_delay_us / 1000.0;
+    }
+    if (last_raw_.has_value()) {
+      const double elapsed_sec =
+          (raw.timestamp_us - last_raw_->timestamp_us) / 1e6;
+      if (elapsed_sec > 0.0) {
+        UpdateSnapshotNoLock(raw, elapsed_sec);
+      }
+    }
+    last_raw_ = raw;
+  }
+  thread_->PostDelayed(RTC_FROM_HERE, interval_ms_, this, MSG_SAMPLE);
+}
+
+StatsSampler::RawSample StatsSampler::ExtractRawSample(
+    const webrtc::RTCStatsReport& report) {
+  RawSample raw;
+  raw.timestamp_us = report.timestamp_us();
+  for (auto&& stats : report) {
+    // See SimpleStats::Extract() about comparing type pointers.
+    const char* const type = stats.type();
+    if (type == webrtc::RTCTransportStats::kType) {
+      const auto& tr_stats = stats.cast_to<webrtc::RTCTransportStats>();
+      raw.bytes_sent += *tr_stats.bytes_sent;
+      raw.bytes_received += *tr_stats.bytes_received;
+    } else if (type == webrtc::RTCOutboundRTPStreamStats::kType) {
+      const auto& ortp_stats =
+          stats.cast_to<webrtc::RTCOutboundRTPStreamStats>();
+      raw.packets_sent += *ortp_stats.packets_sent;
+    } else if (type == webrtc::RTCInboundRTPStreamStats::kType) {
+      const auto& irtp_stats =
+          stats.cast_to<webrtc::RTCInboundRTPStreamStats>();
+      raw.packets_received += *irtp_stats.packets_received;
+      if (irtp_stats.packets_lost.is_defined()) {
+        raw.packets_lost += *irtp_stats.packets_lost;
+      }
+      if (irtp_stats.jitter.is_defined()) {
+        // Report the worst stream; jitter is in seconds.
+        raw.jitter_ms = std::max(raw.jitter_ms, *irtp_stats.jitter * 1000.0);
+      }
+    } else if (type == webrtc::RTCIceCandidatePairStats::kType) {
+      const auto& pair_stats =
+          stats.cast_to<webrtc::RTCIceCandidatePairStats>();
+      if (pair_stats.nominated.is_defined() && *pair_stats.nominated &&
+          pair_stats.current_round_trip_time.is_defined()) {
+        // RTT is in seconds.
+        raw.rtt_ms = std::max(raw.rtt_ms,
+                              *pair_stats.current_round_trip_time * 1000.0);
+      }
+    } else if (type == webrtc::RTCMediaStreamTrackStats::kType) {
+      const auto& track_stats =
+          stats.cast_to<webrtc::RTCMediaStreamTrackStats>();
+      if (*track_stats.kind == "video") {
+        if (*track_stats.remote_source) {
+          if (track_stats.frames_received.is_defined()) {
+            raw.video_frames_received += *track_stats.frames_received;
+          }
+        } else if (track_stats.frames_sent.is_defined()) {
+          raw.video_frames_sent += *track_stats.frames_sent;
+        }
+      }
+    }
+  }
+  return raw;
+}
+
+void StatsSampler::UpdateSnapshotNoLock(const RawSample& raw,
+                                        double elapsed_sec) {
+  const RawSample& prev = *last_raw_;
+
+  // Push the new sample into the ring buffer
+  Sample& sample = ring_[ring_head_];
+  sample.jitter_ms = raw.jitter_ms;
+  sample.rtt_ms = raw.rtt_ms;
+  sample.video_frames_sent_per_sec =
+      Rate(raw.video_frames_sent, prev.video_frames_sent, elapsed_sec);
+  sample.video_frames_received_per_sec =
+      Rate(raw.video_frames_received, prev.video_frames_received, elapsed_sec);
+  sample.key_frame_delay_ms = last_key_frame_delay_ms_;
+  ring_head_ = (ring_head_ + 1) % ring_.size();
+  ring_size_ = std::min(ring_size_ + 1, ring_.size());
+
+  // Rates over the last interval
+  snapshot_.timestamp_us = raw.timestamp_us;
+  snapshot_.sample_count = static_cast<uint32_t>(ring_size_);
+  snapshot_.bytes_sent_per_sec =
+      Rate(raw.bytes_sent, prev.bytes_sent, elapsed_sec);
+  snapshot_.bytes_received_per_sec =
+      Rate(raw.bytes_received, prev.bytes_received, elapsed_sec);
+  snapshot_.packets_sent_per_sec =
+      Rate(raw.packets_sent, prev.packets_sent, elapsed_sec);
+  snapshot_.packets_received_per_sec =
+      Rate(raw.packets_received, prev.packets_received, elapsed_sec);
+  const int64_t lost = std::max<int64_t>(raw.packets_lost - prev.packets_lost,
+                                         0);
+  const int64_t received =
+      (raw.packets_received > prev.packets_received
+           ? static_cast<int64_t>(raw.packets_received - prev.packets_received)
+           : 0);
+  snapshot_.packet_loss_rate =
+      (lost + received > 0 ? static_cast<double>(lost) / (lost + received)
+                           : 0.0);
+  snapshot_.key_frames_requested = raw.key_frames_requested;
+  snapshot_.key_frames_completed = raw.key_frames_completed;
+
+  // Summaries over the ring buffer
+  SummarizeNoLock(&Sample::jitter_ms, snapshot_.jitter_ms);
+  SummarizeNoLock(&Sample::rtt_ms, snapshot_.rtt_ms);
+  SummarizeNoLock(&Sample::video_frames_sent_per_sec,
+                  snapshot_.video_frames_sent_per_sec);
+  SummarizeNoLock(&Sample::video_frames_received_per_sec,
+                  snapshot_.video_frames_received_per_sec);
+  SummarizeNoLock(&Sample::key_frame_delay_ms, snapshot_.key_frame_delay_ms);
+}
+
+void StatsSampler::SummarizeNoLock(double Sample::*member,
+                                   mrsStatsSeriesSummary& summary) {
+  RTC_DCHECK(ring_size_ > 0);
+  // The ring is either full, or filled from index 0 to |ring_size_| - 1.
+  scratch_.clear();
+  for (size_t i = 0; i < ring_size_; ++i) {
+    scratch_.push_back(ring_[i].*member);
+  }
+  const size_t last = (ring_head_ + ring_.size() - 1) % ring_.size();
+  summary.last = ring_[last].*member;
+  const auto minmax = std::minmax_element(scratch_.begin(), scratch_.end());
+  summary.min = *minmax.first;
+  summary.max = *minmax.second;
+  summary.p50 = Percentile(scratch_, 0.50);
+  summary.p95 = Percentile(scratch_, 0.95);
+}
+
+}  // namespace WebRTC
+}  // namespace MixedReality
+}  // namespace Microsoft
@@ -0,0 +1,169 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+
+#include "interop_api.h"
+#include "stats_report.h"
+
+namespace Microsoft {
+namespace MixedReality {
+namespace WebRTC {
+
+/// Counters of the on-demand key frame requests of the video tracks of a
+/// peer connection, read by its stats sampler. This is multithread-safe.
+struct KeyFrameRequestStats {
+  std::atomic<uint64_t> requested{0};
+  std::atomic<uint64_t> completed{0};
+
+  /// Longest delay of the requests completed since the last sample, in
+  /// microseconds, or zero if none.
+  std::atomic<int64_t> max_delay_us{0};
+
+  void OnRequested() noexcept {
+    requested.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  void OnCompleted(int64_t delay_us) noexcept {
+    completed.fetch_add(1, std::memory_order_relaxed);
+    int64_t max_us = max_delay_us.load(std::memory_order_relaxed);
+    while ((delay_us > max_us) &&
+           !max_delay_us.compare_exchange_weak(max_us, delay_us,
+                                               std::memory_order_relaxed)) {
+    }
+  }
+};
+
+/// Periodic stats sampler for a single peer connection.
+///
+/// The sampler collects a stats report at a fixed interval on the WebRTC
+/// signaling thread, through the stats collector of the peer connection so
+/// that its collections are coalesced with the ones requested by the user,
+/// computes per-second rates from the cumulative counters of
+/// consecutive reports, and keeps the last N samples in a fixed-size ring
+/// buffer from which min/max/percentile summaries are computed. The latest
+/// aggregated snapshot is kept ready so that reading it is a simple copy.
+///
+/// The sampler is reference-counted because pending stats collections hold a
+/// reference to it until they complete, which can happen after |Stop()|.
+class StatsSampler : public rtc::MessageHandler,
+                     public webrtc::RTCStatsCollectorCallback {
+ public:
+  static rtc::scoped_refptr<StatsSampler> Create(
+      rtc::scoped_refptr<webrtc::PeerConnectionInterface> peer,
+      rtc::scoped_refptr<CoalescingStatsCollector> collector,
+      rtc::Thread* thread,
+      const mrsStatsSamplerConfig& config,
+      std::shared_ptr<KeyFrameRequestStats> key_frame_stats);
+
+  /// Stop sampling and release the reference to the peer connection. Pending
+  /// stats collections complete but are discarded. The last snapshot remains
+  /// available. This is multithread-safe.
+  void Stop() noexcept;
+
+  /// Get the latest aggregated snapshot. This is multithread-safe.
+  void GetSnapshot(mrsStatsSamplerSnapshot& snapshot) const noexcept;
+
+  //
+  // RTCStatsCollectorCallback interface
+  //
+
+  void OnStatsDelivered(
+      const rtc::scoped_refptr<const webrtc::RTCStatsReport>& report) override;
+
+ protected:
+  StatsSampler(rtc::scoped_refptr<webrtc::PeerConnectionInterface> peer,
+               rtc::scoped_refptr<CoalescingStatsCollector> collector,
+               rtc::Thread* thread,
+               const mrsStatsSamplerConfig& config,
+               std::shared_ptr<KeyFrameRequestStats> key_frame_stats);
+
+  //
+  // MessageHandler interface
+  //
+
+  void OnMessage(rtc::Message* message) override;
+
+  /// Cumulative counters and instantaneous values extracted from one report.
+  struct RawSample {
+    int64_t timestamp_us{0};
+    uint64_t bytes_sent{0};
+    uint64_t bytes_received{0};
+    uint64_t packets_sent{0};
+    uint64_t packets_received{0};
+    int64_t packets_lost{0};
+    uint64_t video_frames_sent{0};
+    uint64_t video_frames_received{0};
+    double jitter_ms{0.0};
+    double rtt_ms{0.0};
+    uint64_t key_frames_requested{0};
+    uint64_t key_frames_completed{0};
+  };
+
+  /// Derived values for one sampling interval, stored in the ring buffer.
+  struct Sample {
+    double jitter_ms{0.0};
+    double rtt_ms{0.0};
+    double video_frames_sent_per_sec{0.0};
+    double video_frames_received_per_sec{0.0};
+    double key_frame_delay_ms{0.0};
+  };
+
+  static RawSample ExtractRawSample(const webrtc::RTCStatsReport& report);
+
+  /// Update |snapshot_| from the ring buffer. Called with |mutex_| held.
+  void UpdateSnapshotNoLock(const RawSample& raw, double elapsed_sec);
+
+  /// Compute min/max/percentiles over one series of the ring buffer. Called
+  /// with |mutex_| held.
+  void SummarizeNoLock(double Sample::*member,
+                       mrsStatsSeriesSummary& summary);
+
+  /// Thread on which sampling is scheduled. Stats are delivered on the
+  /// signaling thread too, so this is also where samples are processed.
+  rtc::Thread* const thread_;
+
+  /// Sampling interval.
+  const int interval_ms_;
+
+  /// Stats collector of the peer connection, shared with |GetStats()|.
+  const rtc::scoped_refptr<CoalescingStatsCollector> collector_;
+
+  /// Key frame requests of the tracks of the peer connection.
+  const std::shared_ptr<KeyFrameRequestStats> key_frame_stats_;
+
+  mutable std::mutex mutex_;
+
+  /// Peer connection being sampled, or null once stopped.
+  rtc::scoped_refptr<webrtc::PeerConnectionInterface> peer_
+      RTC_GUARDED_BY(mutex_);
+
+  /// Longest delay of the key frame requests completed during the last
+  /// interval with any, in milliseconds.
+  double last_key_frame_delay_ms_ RTC_GUARDED_BY(mutex_) = 0.0;
+
+  /// Previous raw sample, for computing rates.
+  absl::optional<RawSample> last_raw_ RTC_GUARDED_BY(mutex_);
+
+  /// Ring buffer of the most recent samples.
+  std::vector<Sample> ring_ RTC_GUARDED_BY(mutex_);
+
+  /// Index of the next slot to write in |ring_|.
+  size_t ring_head_ RTC_GUARDED_BY(mutex_) = 0;
+
+  /// Number of valid samples in |ring_|.
+  size_t ring_size_ RTC_GUARDED_BY(mutex_) = 0;
+
+  /// Scratch buffer for computing percentiles, to avoid per-sample allocations.
+  std::vector<double> scratch_ RTC_GUARDED_BY(mutex_);
+
+  /// Latest aggregated snapshot.
+  mrsStatsSamplerSnapshot snapshot_ RTC_GUARDED_BY(mutex_) = {};
+};
+
+}  // namespace WebRTC
+}  // namespace MixedReality
+}  // namespace Microsoft
@@ -0,0 +1,281 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+// This is a precompiled header, it must be on its own, followed by a blank
+// line, to prevent clang-format from reordering it with other headers.
+#include "pch.h"
+
+#include <algorithm>
+#include <cerrno>
+
+#if defined(MR_SHARING_ANDROID)
+#include <sched.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+#include "thread_config.h"
+
+#include "rtc_base/platform_thread_types.h"
+#include "rtc_base/stringutils.h"
+
+namespace {
+
+using namespace Microsoft::MixedReality::WebRTC;
+
+constexpr int kRoleCount = 4;
+constexpr int kMinNice = -20;
+constexpr int kMaxNice = 19;
+constexpr int kMaxRealtimePriority = 99;
+
+/// Configuration and last applied state of all roles. Value-initialized, so
+/// that no state is applied yet.
+struct ThreadConfigRegistry {
+  std::mutex mutex_;
+  mrsThreadConfig configs_[kRoleCount] RTC_GUARDED_BY(mutex_);
+  mrsAppliedThreadConfig applied_[kRoleCount] RTC_GUARDED_BY(mutex_);
+  bool has_applied_[kRoleCount] RTC_GUARDED_BY(mutex_);
+};
+
+ThreadConfigRegistry& GetRegistry() {
+  // Intentionally leaked, like other process-wide singletons, so that it can
+  // be used during static destruction.
+  static ThreadConfigRegistry* const registry = new ThreadConfigRegistry();
+  return *registry;
+}
+
+bool IsValidRole(mrsThreadRole role) {
+  const int index = static_cast<int>(role);
+  return ((index >= 0) && (index < kRoleCount));
+}
+
+#if defined(MR_SHARING_WIN)
+
+/// Map a nice value to the closest Windows thread priority level.
+int NiceToPriorityLevel(int32_t nice) {
+  if (nice <= -15) {
+    return THREAD_PRIORITY_HIGHEST;
+  }
+  if (nice <= -5) {
+    return THREAD_PRIORITY_ABOVE_NORMAL;
+  }
+  if (nice < 5) {
+    return THREAD_PRIORITY_NORMAL;
+  }
+  if (nice < 15) {
+    return THREAD_PRIORITY_BELOW_NORMAL;
+  }
+  return THREAD_PRIORITY_LOWEST;
+}
+
+/// Map a Windows thread priority level to a representative nice value, which
+/// maps back to the same level.
+int32_t PriorityLevelToNice(int level) {
+  switch (level) {
+    case THREAD_PRIORITY_TIME_CRITICAL:
+      return kMinNice;
+    case THREAD_PRIORITY_HIGHEST:
+      return -15;
+    case THREAD_PRIORITY_ABOVE_NORMAL:
+      return -5;
+    case THREAD_PRIORITY_BELOW_NORMAL:
+      return 5;
+    case THREAD_PRIORITY_LOWEST:
+      return 15;
+    case THREAD_PRIORITY_IDLE:
+      return kMaxNice;
+    default:
+      return 0;
+  }
+}
+
+#endif  // defined(MR_SHARING_WIN)
+
+/// Apply a configuration to the current thread, and read back the scheduling
+/// state in effect.
+void ApplyToCurrentThread(const mrsThreadConfig& config,
+                          mrsAppliedThreadConfig& applied) {
+  Result result = Result::kSuccess;
+#if defined(MR_SHARING_WIN)
+  HANDLE const thread = GetCurrentThread();
+  if (config.affinity_mask != 0) {
+#if defined(WINUWP)
+    RTC_LOG(LS_WARNING) << "Thread affinity is not supported on UWP.";
+    result = Result::kUnsupported;
+#else
+    const DWORD_PTR mask = static_cast<DWORD_PTR>(config.affinity_mask);
+    if (SetThreadAffinityMask(thread, mask) != 0) {
+      // The current mask cannot be queried, so only report the one set.
+      applied.affinity_mask = mask;
+    } else {
+      RTC_LOG(LS_WARNING) << "Failed to set thread affinity mask "
+                          << config.affinity_mask << ": error "
+                          << GetLastError();
+      result = Result::kUnknownError;
+    }
+#endif
+  }
+  if ((config.realtime_priority > 0) || (config.nice != 0)) {
+    const int level = (config.realtime_priority > 0
+                           ? THREAD_PRIORITY_TIME_CRITICAL
+                           : NiceToPriorityLevel(config.nice));
+    if (!SetThreadPriority(thread, level)) {
+      RTC_LOG(LS_WARNING) << "Failed to set thread priority level " << level
+                          << ": error " << GetLastError();
+      result = Result::kUnknownError;
+    }
+  }
+  const int level = GetThreadPriority(thread);
+  applied.nice = PriorityLevelToNice(level);
+  applied.realtime_priority =
+      (level == THREAD_PRIORITY_TIME_CRITICAL
+           ? std::max<int32_t>(config.realtime_priority, 1)
+           : 0);
+#elif defined(MR_SHARING_ANDROID)
+  const pid_t tid = gettid();
+  if (config.affinity_mask != 0) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu = 0; cpu < 64; ++cpu) {
+      if ((config.affinity_mask & (1ull << cpu)) != 0) {
+        CPU_SET(cpu, &set);
+      }
+    }
+    if (sched_setaffinity(tid, sizeof(set), &set) != 0) {
+      RTC_LOG(LS_WARNING) << "Failed to set thread affinity mask "
+                          << config.affinity_mask << ": errno " << errno;
+      result = Result::kUnknownError;
+    }
+  }
+  if (config.realtime_priority > 0) {
+    sched_param param{};
+    param.sched_priority = config.realtime_priority;
+    if (sched_setscheduler(tid, SCHED_FIFO, &param) != 0) {
+      RTC_LOG(LS_WARNING) << "Failed to set SCHED_FIFO priority "
+                          << config.realtime_priority << ": errno " << errno;
+      result = Result::kUnknownError;
+    }
+  } else if (config.nice != 0) {
+    if (setpriority(PRIO_PROCESS, tid, config.nice) != 0) {
+      RTC_LOG(LS_WARNING) << "Failed to set nice value " << config.nice
+                          << ": errno " << errno;
+      result = Result::kUnknownError;
+    }
+  }
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  if (sched_getaffinity(tid, sizeof(set), &set) == 0) {
+    for (int cpu = 0; cpu < 64; ++cpu) {
+      if (CPU_ISSET(cpu, &set)) {
+        applied.affinity_mask |= (1ull << cpu);
+      }
+    }
+  }
+  // -1 is a valid nice value, so errors can only be detected with |errno|.
+  errno = 0;
+  const int nice = getpriority(PRIO_PROCESS, tid);
+  if (errno == 0) {
+    applied.nice = nice;
+  }
+  if (sched_getscheduler(tid) == SCHED_FIFO) {
+    sched_param param{};
+    if (sched_getparam(tid, &param) == 0) {
+      applied.realtime_priority = param.sched_priority;
+    }
+  }
+#endif
+  applied.result = result;
+}
+
+}  // namespace
+
+namespace Microsoft {
+namespace MixedReality {
+namespace WebRTC {
+
+Result ThreadConfig::Set(mrsThreadRole role,
+                         const mrsThreadConfig& config) noexcept {
+  if (!IsValidRole(role)) {
+    RTC_LOG(LS_ERROR) << "Invalid thread role " << static_cast<int>(role);
+    return Result::kInvalidParameter;
+  }
+  if ((config.nice < kMinNice) || (config.nice > kMaxNice)) {
+    RTC_LOG(LS_ERROR) << "Invalid nice value " << config.nice
+                      << ", must be in [" << kMinNice << ", " << kMaxNice
+                      << "].";
+    return Result::kInvalidParameter;
+  }
+  if ((config.realtime_priority < 0) ||
+      (config.realtime_priority > kMaxRealtimePriority)) {
+    RTC_LOG(LS_ERROR) << "Invalid real-time priority "
+                      << config.realtime_priority << ", must be in [0, "
+                      << kMaxRealtimePriority << "].";
+    return Result::kInvalidParameter;
+  }
+#if defined(WINUWP)
+  if (config.affinity_mask != 0) {
+    RTC_LOG(LS_ERROR) << "Thread affinity is not supported on UWP.";
+    return Result::kUnsupported;
+  }
+#endif
+  ThreadConfigRegistry& registry = GetRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex_);
+  registry.configs_[static_cast<int>(role)] = config;
+  return Result::kSuccess;
+}
+
+Result ThreadConfig::Get(mrsThreadRole role, mrsThreadConfig& config) noexcept {
+  if (!IsValidRole(role)) {
+    RTC_LOG(LS_ERROR) << "Invalid thread role " << static_cast<int>(role);
+    return Result::kInvalidParameter;
+  }
+  ThreadConfigRegistry& registry = GetRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex_);
+  config = registry.configs_[static_cast<int>(role)];
+  return Result::kSuccess;
+}
+
+Result ThreadConfig::GetApplied(mrsThreadRole role,
+                                mrsAppliedThreadConfig& applied) noexcept {
+  if (!IsValidRole(role)) {
+    RTC_LOG(LS_ERROR) << "Invalid thread role " << static_cast<int>(role);
+    return Result::kInvalidParameter;
+  }
+  ThreadConfigRegistry& registry = GetRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex_);
+  const int index = static_cast<int>(role);
+  if (!registry.has_applied_[index]) {
+    return Result::kNotFound;
+  }
+  applied = registry.applied_[index];
+  return Result::kSuccess;
+}
+
+void ThreadConfig::Apply(mrsThreadRole role, rtc::Thread* thread) noexcept {
+  RTC_DCHECK(IsValidRole(role));
+  RTC_DCHECK(thread);
+  ThreadConfigRegistry& registry = GetRegistry();
+  const int index = static_cast<int>(role);
+  mrsThreadConfig config;
+  {
+    std::lock_guard<std::mutex> lock(registry.mutex_);
+    config = registry.configs_[index];
+  }
+
+  // Scheduling settings are applied by the thread itself, before it processes
+  // any other message, since not all of them can target another thread.
+  mrsAppliedThreadConfig applied{};
+  rtc::strcpyn(applied.name, sizeof(applied.name), thread->name().c_str());
+  thread->Invoke<void>(RTC_FROM_HERE, [&config, &applied]() {
+    applied.thread_id = static_cast<uint64_t>(rtc::CurrentThreadId());
+    ApplyToCurrentThread(config, applied);
+  });
+
+  std::lock_guard<std::mutex> lock(registry.mutex_);
+  registry.applied_[index] = applied;
+  registry.has_applied_[index] = true;
+}
+
+}  // namespace WebRTC
+}  // namespace MixedReality
+}  // namespace Microsoft
@@ -0,0 +1,45 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include "mrs_errors.h"
+#include "thread_config_interop.h"
+
+namespace rtc {
+class Thread;
+}
+
+namespace Microsoft {
+namespace MixedReality {
+namespace WebRTC {
+
+/// Process-wide scheduling configuration of the threads created by the
+/// library, per thread role.
+///
+/// The configuration is stored independently of the library initialization,
+/// like the factory shard count, so that it can be set before the threads are
+/// created. Owners of a thread call |Apply()| right after starting it.
+class ThreadConfig {
+ public:
+  /// Set the configuration of the threads of the given role. See
+  /// |mrsThreadConfigSet()|.
+  static Result Set(mrsThreadRole role, const mrsThreadConfig& config) noexcept;
+
+  /// Get the configuration of the threads of the given role.
+  static Result Get(mrsThreadRole role, mrsThreadConfig& config) noexcept;
+
+  /// Get the scheduling state of the last thread of the given role to which
+  /// the configuration was applied. See |mrsThreadConfigGetApplied()|.
+  static Result GetApplied(mrsThreadRole role,
+                           mrsAppliedThreadConfig& applied) noexcept;
+
+  /// Apply the configuration of the given role to a started thread, blocking
+  /// until the thread applied it to itself. Failures are logged and recorded
+  /// in the applied state, but don't prevent the thread from running.
+  static void Apply(mrsThreadRole role, rtc::Thread* thread) noexcept;
+};
+
+}  // namespace WebRTC
+}  // namespace MixedReality
+}  // namespace Microsoft
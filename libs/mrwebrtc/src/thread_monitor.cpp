@@ -0,0 +1,316 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+// This is a precompiled header, it must be on its own, followed by a blank
+// line, to prevent clang-format from reordering it with other headers.
+#include "pch.h"
+
+#include <algorithm>
+#include <cstdio>
+
+#if defined(MR_SHARING_ANDROID)
+#include <unistd.h>
+#endif
+
+#include "thread_monitor.h"
+#include "tracing.h"
+
+#include "rtc_base/stringutils.h"
+
+namespace {
+
+enum {
+  /// Sample all registered threads.
+  MSG_SAMPLE,
+  /// Probe the latency of a single thread.
+  MSG_PROBE
+};
+
+/// Message data for a probe, posted to the probed thread.
+struct ProbeData : public rtc::MessageData {
+  uint64_t serial_{0};
+  int64_t posted_us_{0};
+  uint64_t queue_depth_{0};
+};
+
+/// Get the cumulative CPU time of the given thread of the current process, in
+/// microseconds, or -1 if not available.
+int64_t GetThreadCpuTimeUs(rtc::PlatformThreadId thread_id) {
+#if defined(MR_SHARING_ANDROID)
+  char path[64];
+  snprintf(path, sizeof(path), "/proc/self/task/%d/stat",
+           static_cast<int>(thread_id));
+  FILE* const file = fopen(path, "r");
+  if (!file) {
+    return -1;
+  }
+  char buffer[512];
+  const size_t size = fread(buffer, 1, sizeof(buffer) - 1, file);
+  fclose(file);
+  buffer[size] = '\0';
+  // The thread name in the second field is in parentheses and can contain
+  // spaces, so parse from the last closing parenthesis. The user and system
+  // times are the 14th and 15th fields, in clock ticks.
+  const char* const fields = strrchr(buffer, ')');
+  if (!fields) {
+    return -1;
+  }
+  unsigned long long utime = 0;
+  unsigned long long stime = 0;
+  if (sscanf(fields + 1,
+             " %*c %*d %*d %*d %*d %*d %*u %*lu %*lu %*lu %*lu %llu %llu",
+             &utime, &stime) != 2) {
+    return -1;
+  }
+  static const long ticks_per_sec = sysconf(_SC_CLK_TCK);
+  if (ticks_per_sec <= 0) {
+    return -1;
+  }
+  return static_cast<int64_t>((utime + stime) * rtc::kNumMicrosecsPerSec /
+                              ticks_per_sec);
+#elif defined(MR_SHARING_WIN)
+  HANDLE const handle =
+      OpenThread(THREAD_QUERY_LIMITED_INFORMATION, FALSE, thread_id);
+  if (!handle) {
+    return -1;
+  }
+  FILETIME creation_time, exit_time, kernel_time, user_time;
+  const BOOL success = GetThreadTimes(handle, &creation_time, &exit_time,
+                                      &kernel_time, &user_time);
+  CloseHandle(handle);
+  if (!success) {
+    return -1;
+  }
+  auto to_100ns = [](const FILETIME& ft) {
+    return (static_cast<uint64_t>(ft.dwHighDateTime) << 32) | ft.dwLowDateTime;
+  };
+  return static_cast<int64_t>((to_100ns(kernel_time) + to_100ns(user_time)) /
+                              10);
+#else
+  (void)thread_id;
+  return -1;
+#endif
+}
+
+}  // namespace
+
+namespace Microsoft {
+namespace MixedReality {
+namespace WebRTC {
+
+ThreadMonitor& ThreadMonitor::Instance() noexcept {
+  // Intentionally leaked, so that probes still pending in the queue of a
+  // thread destroyed during static destruction can be safely discarded.
+  static ThreadMonitor* const instance = new ThreadMonitor();
+  return *instance;
+}
+
+void ThreadMonitor::Register(rtc::Thread* thread) noexcept {
+  RTC_DCHECK(thread);
+  std::lock_guard<std::mutex> lock(mutex_);
+  Entry entry;
+  entry.serial = ++last_serial_;
+  entry.thread = thread;
+  entry.name = thread->name();
+  entries_.push_back(std::move(entry));
+}
+
+void ThreadMonitor::Unregister(rtc::Thread* thread) noexcept {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = std::find_if(
+        entries_.begin(), entries_.end(),
+        [thread](const Entry& entry) { return (entry.thread == thread); });
+    if (it == entries_.end()) {
+      return;
+    }
+    entries_.erase(it);
+  }
+  // Probes are only posted with |mutex_| held and for registered threads, so
+  // no new probe can be posted once the entry is removed.
+  thread->Clear(this, MSG_PROBE);
+}
+
+Result ThreadMonitor::Start(int interval_ms) noexcept {
+  if (interval_ms <= 0) {
+    return Result::kInvalidParameter;
+  }
+  std::lock_guard<std::mutex> control_lock(control_mutex_);
+  if (sampling_thread_) {
+    sampling_thread_->Stop();
+    sampling_thread_.reset();
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    interval_ms_ = interval_ms;
+    for (auto&& entry : entries_) {
+      entry.queue_depth = 0;
+      entry.max_queue_depth = 0;
+      entry.probe_count = 0;
+      entry.last_latency_us = 0;
+      entry.max_latency_us = 0;
+      entry.total_latency_us = 0;
+      entry.cpu_time_us = -1;
+      entry.cpu_sample_time_us = 0;
+      entry.cpu_usage = -1.0;
+    }
+  }
+  sampling_thread_ = rtc::Thread::Create();
+  sampling_thread_->SetName("MR-WebRTC thread monitor", sampling_thread_.get());
+  sampling_thread_->Start();
+  sampling_thread_->Post(RTC_FROM_HERE, this, MSG_SAMPLE);
+  return Result::kSuccess;
+}
+
+Result ThreadMonitor::Stop() noexcept {
+  std::lock_guard<std::mutex> control_lock(control_mutex_);
+  if (sampling_thread_) {
+    // This discards the next scheduled sample
+    sampling_thread_->Stop();
+    sampling_thread_.reset();
+  }
+  return Result::kSuccess;
+}
+
+Result ThreadMonitor::GetStats(mrsThreadStats* stats, uint32_t& count) const
+    noexcept {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const uint32_t capacity = count;
+  count = static_cast<uint32_t>(entries_.size());
+  if (capacity < count) {
+    return Result::kBufferTooSmall;
+  }
+  for (auto&& entry : entries_) {
+    mrsThreadStats& out = *stats++;
+    rtc::strcpyn(out.name, sizeof(out.name), entry.name.c_str());
+    out.thread_id =
+        (entry.has_thread_id ? static_cast<uint64_t>(entry.thread_id) : 0);
+    out.queue_depth = entry.queue_depth;
+    out.max_queue_depth = entry.max_queue_depth;
+    out.probe_count = entry.probe_count;
+    out.last_latency_us = entry.last_latency_us;
+    out.max_latency_us = entry.max_latency_us;
+    out.total_latency_us = entry.total_latency_us;
+    out.cpu_time_us = entry.cpu_time_us;
+    out.cpu_usage = entry.cpu_usage;
+  }
+  return Result::kSuccess;
+}
+
+void ThreadMonitor::OnMessage(rtc::Message* message) {
+  switch (message->message_id) {
+    case MSG_SAMPLE:
+      Sample();
+      break;
+    case MSG_PROBE: {
+      std::unique_ptr<ProbeData> data(static_cast<ProbeData*>(message->pdata));
+      OnProbe(data->serial_, data->posted_us_, data->queue_depth_);
+    } break;
+  }
+}
+
+void ThreadMonitor::Sample() {
+  // Read the CPU times without holding the lock, as this may require some file
+  // I/O, and probes completing on the monitored threads need the lock.
+  struct CpuTime {
+    uint64_t serial;
+    rtc::PlatformThreadId thread_id;
+    int64_t cpu_time_us;
+  };
+  std::vector<CpuTime> cpu_times;
+  int interval_ms;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    interval_ms = interval_ms_;
+    cpu_times.reserve(entries_.size());
+    for (auto&& entry : entries_) {
+      // The platform thread ID is only known once a first probe ran
+      if (entry.has_thread_id) {
+        cpu_times.push_back(CpuTime{entry.serial, entry.thread_id, -1});
+      }
+    }
+  }
+  for (auto&& cpu_time : cpu_times) {
+    cpu_time.cpu_time_us = GetThreadCpuTimeUs(cpu_time.thread_id);
+  }
+  const int64_t now_us = rtc::TimeMicros();
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto&& entry : entries_) {
+      auto it = std::find_if(cpu_times.begin(), cpu_times.end(),
+                             [&entry](const CpuTime& cpu_time) {
+                               return (cpu_time.serial == entry.serial);
+                             });
+      if ((it != cpu_times.end()) && (it->cpu_time_us >= 0)) {
+        if ((entry.cpu_time_us >= 0) && (now_us > entry.cpu_sample_time_us)) {
+          entry.cpu_usage =
+              static_cast<double>(it->cpu_time_us - entry.cpu_time_us) /
+              (now_us - entry.cpu_sample_time_us);
+        }
+        entry.cpu_time_us = it->cpu_time_us;
+        entry.cpu_sample_time_us = now_us;
+      }
+
+      entry.queue_depth = entry.thread->size();
+      entry.max_queue_depth =
+          std::max(entry.max_queue_depth, entry.queue_depth);
+
+      if (!entry.probe_pending) {
+        entry.probe_pending = true;
+        auto data = new ProbeData();
+        data->serial_ = entry.serial;
+        data->posted_us_ = rtc::TimeMicros();
+        data->queue_depth_ = entry.queue_depth;
+        entry.thread->Post(RTC_FROM_HERE, this, MSG_PROBE, data);
+      }
+    }
+  }
+
+  rtc::Thread::Current()->PostDelayed(RTC_FROM_HERE, interval_ms, this,
+                                      MSG_SAMPLE);
+}
+
+void ThreadMonitor::OnProbe(uint64_t serial,
+                            int64_t posted_us,
+                            uint64_t queue_depth) {
+  const int64_t now_us = rtc::TimeMicros();
+  const int64_t latency_us = now_us - posted_us;
+  double cpu_usage = -1.0;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = std::find_if(
+        entries_.begin(), entries_.end(),
+        [serial](const Entry& entry) { return (entry.serial == serial); });
+    if (it == entries_.end()) {
+      return;  // unregistered while the probe was running
+    }
+    Entry& entry = *it;
+    entry.probe_pending = false;
+    if (!entry.has_thread_id) {
+      entry.thread_id = rtc::CurrentThreadId();
+      entry.has_thread_id = true;
+    }
+    ++entry.probe_count;
+    entry.last_latency_us = latency_us;
+    entry.max_latency_us = std::max(entry.max_latency_us, latency_us);
+    entry.total_latency_us += latency_us;
+    cpu_usage = entry.cpu_usage;
+  }
+
+  // Record the probe on the probed thread, so that the trace shows the latency
+  // and load alongside the other spans of that thread.
+  if (TraceRecorder::IsCapturing()) {
+    TraceRecorder::AddSpan("ThreadMonitor::Probe", posted_us, now_us);
+    TraceRecorder::AddCounter("Thread queue depth", posted_us,
+                              static_cast<int64_t>(queue_depth));
+    if (cpu_usage >= 0.0) {
+      TraceRecorder::AddCounter("Thread CPU usage (%)", posted_us,
+                                static_cast<int64_t>(cpu_usage * 100.0 + 0.5));
+    }
+  }
+}
+
+}  // namespace WebRTC
+}  // namespace MixedReality
+}  // namespace Microsoft
@@ -0,0 +1,104 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include "mrs_errors.h"
+#include "thread_monitor_interop.h"
+
+#include "rtc_base/platform_thread_types.h"
+
+namespace Microsoft {
+namespace MixedReality {
+namespace WebRTC {
+
+/// Process-wide monitor of the load of the WebRTC threads.
+///
+/// Threads are registered by their owner for their whole lifetime, whether or
+/// not the monitor is running. Once started, the monitor samples all registered
+/// threads from its own thread at a fixed interval: it reads their queue depth
+/// and CPU time, and posts them a probe message measuring the latency between
+/// posting and execution. Only one probe is in flight per thread, so that a
+/// stalled thread doesn't accumulate probes.
+class ThreadMonitor : public rtc::MessageHandler {
+ public:
+  /// Get the singleton instance, which is never destroyed.
+  static ThreadMonitor& Instance() noexcept;
+
+  /// Register a thread to monitor. The thread must be unregistered before it
+  /// is destroyed or stopped. This is multithread-safe.
+  void Register(rtc::Thread* thread) noexcept;
+
+  /// Unregister a thread, discarding its pending probe if any. This is
+  /// multithread-safe.
+  void Unregister(rtc::Thread* thread) noexcept;
+
+  /// Start or restart sampling, resetting all statistics.
+  Result Start(int interval_ms) noexcept;
+
+  /// Stop sampling, waiting for the sampling thread to exit.
+  Result Stop() noexcept;
+
+  /// Copy the statistics of all registered threads into |stats|, and set
+  /// |count| to the number of registered threads. Return
+  /// |Result::kBufferTooSmall| if |count| is too small on input.
+  Result GetStats(mrsThreadStats* stats, uint32_t& count) const noexcept;
+
+ protected:
+  //
+  // MessageHandler interface
+  //
+
+  void OnMessage(rtc::Message* message) override;
+
+ private:
+  struct Entry {
+    /// Unique identifier of the registration, to detect an entry replaced
+    /// while the mutex was released.
+    uint64_t serial{0};
+    rtc::Thread* thread{nullptr};
+    std::string name;
+    rtc::PlatformThreadId thread_id{};
+    bool has_thread_id{false};
+    bool probe_pending{false};
+    uint64_t queue_depth{0};
+    uint64_t max_queue_depth{0};
+    uint64_t probe_count{0};
+    int64_t last_latency_us{0};
+    int64_t max_latency_us{0};
+    int64_t total_latency_us{0};
+    int64_t cpu_time_us{-1};
+    int64_t cpu_sample_time_us{0};
+    double cpu_usage{-1.0};
+  };
+
+  ThreadMonitor() = default;
+
+  /// Sample all registered threads. Called on the sampling thread.
+  void Sample();
+
+  /// Complete a probe. Called on the probed thread.
+  void OnProbe(uint64_t serial, int64_t posted_us, uint64_t queue_depth);
+
+  /// Mutex serializing |Start()| and |Stop()|. This is never held while
+  /// acquiring |mutex_|, so that stopping can wait for the sampling thread.
+  std::mutex control_mutex_;
+
+  /// Thread on which sampling is scheduled, while running.
+  std::unique_ptr<rtc::Thread> sampling_thread_ RTC_GUARDED_BY(control_mutex_);
+
+  mutable std::mutex mutex_;
+
+  /// Sampling interval.
+  int interval_ms_ RTC_GUARDED_BY(mutex_) = 0;
+
+  /// Last serial assigned to a registration.
+  uint64_t last_serial_ RTC_GUARDED_BY(mutex_) = 0;
+
+  /// Registered threads. This is small, so a vector is enough.
+  std::vector<Entry> entries_ RTC_GUARDED_BY(mutex_);
+};
+
+}  // namespace WebRTC
+}  // namespace MixedReality
+}  // namespace Microsoft
@@ -5,7 +5,9 @@
 // line, to prevent clang-format from reordering it with other headers.
 #include "pch.h"
 
+#include "alloc_tracker.h"
 #include "toggle_audio_mixer.h"
+#include "tracing.h"
 
 namespace Microsoft {
 namespace MixedReality {
@@ -68,7 +70,8 @@ static const int16_t zerobuf[200]{};
 
 void ToggleAudioMixer::Mix(size_t number_of_channels,
                            webrtc::AudioFrame* audio_frame_for_mixing) {
-  std::vector<Source*> redirected_sources;
+  MRS_TRACE_SCOPE("ToggleAudioMixer::Mix");
+  redirected_sources_.clear();
   bool some_source_is_output = false;
   {
     rtc::CritScope lock(&crit_);
@@ -76,7 +79,7 @@ void ToggleAudioMixer::Mix(size_t number_of_channels,
     // Collect the redirected sources.
     for (auto&& pair : source_from_id_) {
       if (pair.second.source && !pair.second.is_output) {
-        redirected_sources.push_back(pair.second.source);
+        redirected_sources_.push_back(pair.second.source);
       } else {
         some_source_is_output = true;
       }
@@ -85,13 +88,15 @@ void ToggleAudioMixer::Mix(size_t number_of_channels,
     if (some_source_is_output) {
       // Mix output sources using the base impl. Do inside the lock in case
       // sources are added/removed by OutputSource on a different thread.
+      MRS_ALLOC_SCOPE("webrtc::AudioMixerImpl::Mix");
       base_impl_->Mix(number_of_channels, audio_frame_for_mixing);
     }
   }
 
-  for (auto& source : redirected_sources) {
+  for (auto& source : redirected_sources_) {
     // This pumps the source and fires the frame observer callbacks
     // which in turn fill the AudioTrackReadBuffer buffers
+    MRS_ALLOC_SCOPE("webrtc::AudioMixer::Source::GetAudioFrameWithInfo");
     webrtc::AudioFrame unused;
     const auto audio_frame_info = source->GetAudioFrameWithInfo(
         source->PreferredSampleRate(), &unused);
@@ -32,6 +32,11 @@ class ToggleAudioMixer : public webrtc::AudioMixer {
   rtc::CriticalSection crit_;
   rtc::scoped_refptr<webrtc::AudioMixerImpl> base_impl_;
   std::map<int, KnownSource> source_from_id_;
+
+  /// Sources pumped without being mixed, collected by |Mix()|. Only accessed
+  /// from the audio thread calling |Mix()|, and kept as a member to reuse its
+  /// storage across calls.
+  std::vector<Source*> redirected_sources_;
 };
 
 }  // namespace WebRTC
@@ -0,0 +1,271 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+// This is a precompiled header, it must be on its own, followed by a blank
+// line, to prevent clang-format from reordering it with other headers.
+#include "pch.h"
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include "tracing.h"
+
+#include "rtc_base/platform_thread_types.h"
+
+namespace {
+
+/// Maximum number of spans recorded per thread and per capture.
+constexpr uint32_t kMaxSpansPerThread = 16384;
+
+/// Single trace event, either a span recorded as a Chrome "complete" event, or
+/// a counter sample.
+struct TraceSpan {
+  const char* name;
+  int64_t begin_us;
+  /// Duration of a span, or value of a counter sample.
+  int64_t value;
+  bool is_counter;
+};
+
+/// Span buffer of a single thread. Only the owning thread writes to it; other
+/// threads only read the spans published by |size|.
+struct ThreadBuffer {
+  ThreadBuffer(rtc::PlatformThreadId thread_id, std::string thread_name)
+      : thread_id(thread_id),
+        thread_name(std::move(thread_name)),
+        spans(new TraceSpan[kMaxSpansPerThread]) {}
+
+  const rtc::PlatformThreadId thread_id;
+  const std::string thread_name;
+  const std::unique_ptr<TraceSpan[]> spans;
+
+  /// Capture generation the spans belong to. The owning thread resets the
+  /// buffer when recording the first span of a new capture.
+  std::atomic<uint32_t> generation{0};
+
+  /// Number of spans published in |spans|.
+  std::atomic<uint32_t> size{0};
+
+  /// Number of spans dropped because the buffer was full.
+  std::atomic<uint32_t> dropped{0};
+
+  /// Set once the owning thread exited, so that the buffer can be released.
+  std::atomic_bool retired{false};
+};
+
+/// Registry of all thread buffers, and state of the current capture.
+struct TraceRegistry {
+  std::mutex mutex_;
+  std::vector<std::unique_ptr<ThreadBuffer>> buffers_ RTC_GUARDED_BY(mutex_);
+
+  /// Current capture generation, incremented on each start.
+  std::atomic<uint32_t> generation_{0};
+
+  /// Cached serialization of the last capture, if any.
+  absl::optional<std::string> json_ RTC_GUARDED_BY(mutex_);
+};
+
+TraceRegistry& GetRegistry() {
+  // Intentionally leaked, so that exiting threads can still access their
+  // buffer during static destruction.
+  static TraceRegistry* const registry = new TraceRegistry();
+  return *registry;
+}
+
+/// Per-thread handle to the buffer of the current thread, which retires the
+/// buffer when the thread exits.
+struct ThreadBufferHolder {
+  ~ThreadBufferHolder() {
+    if (buffer) {
+      buffer->retired.store(true, std::memory_order_release);
+    }
+  }
+  ThreadBuffer* buffer{nullptr};
+};
+
+thread_local ThreadBufferHolder t_buffer_holder;
+
+ThreadBuffer* CreateThreadBuffer() {
+  std::string thread_name;
+  if (rtc::Thread* const thread = rtc::Thread::Current()) {
+    thread_name = thread->name();
+  }
+  auto buffer = std::make_unique<ThreadBuffer>(rtc::CurrentThreadId(),
+                                               std::move(thread_name));
+  ThreadBuffer* const ptr = buffer.get();
+  TraceRegistry& registry = GetRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex_);
+  registry.buffers_.push_back(std::move(buffer));
+  return ptr;
+}
+
+/// Record an event into the buffer of the current thread.
+void AddEvent(const TraceSpan& event) noexcept {
+  ThreadBuffer* buffer = t_buffer_holder.buffer;
+  if (!buffer) {
+    buffer = CreateThreadBuffer();
+    t_buffer_holder.buffer = buffer;
+  }
+  const uint32_t generation =
+      GetRegistry().generation_.load(std::memory_order_acquire);
+  if (buffer->generation.load(std::memory_order_relaxed) != generation) {
+    buffer->size.store(0, std::memory_order_relaxed);
+    buffer->dropped.store(0, std::memory_order_relaxed);
+    buffer->generation.store(generation, std::memory_order_release);
+  }
+  const uint32_t size = buffer->size.load(std::memory_order_relaxed);
+  if (size >= kMaxSpansPerThread) {
+    buffer->dropped.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  buffer->spans[size] = event;
+  buffer->size.store(size + 1, std::memory_order_release);
+}
+
+void AppendJsonString(std::string& json, absl::string_view str) {
+  json.push_back('"');
+  for (char c : str) {
+    if ((c == '"') || (c == '\\')) {
+      json.push_back('\\');
+      json.push_back(c);
+    } else if (static_cast<unsigned char>(c) >= 0x20) {
+      json.push_back(c);
+    }
+  }
+  json.push_back('"');
+}
+
+std::string SerializeNoLock(TraceRegistry& registry, uint32_t generation) {
+  std::string json;
+  json.reserve(4096);
+  json.append("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+  bool first = true;
+  uint64_t dropped = 0;
+  for (auto&& buffer : registry.buffers_) {
+    if (buffer->generation.load(std::memory_order_acquire) != generation) {
+      // No span recorded during the last capture
+      continue;
+    }
+    const uint32_t size = buffer->size.load(std::memory_order_acquire);
+    dropped += buffer->dropped.load(std::memory_order_relaxed);
+    const std::string tid = std::to_string(buffer->thread_id);
+    if (!buffer->thread_name.empty()) {
+      json.append(first ? "" : ",");
+      json.append("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":");
+      json.append(tid);
+      json.append(",\"args\":{\"name\":");
+      AppendJsonString(json, buffer->thread_name);
+      json.append("}}");
+      first = false;
+    }
+    json.reserve(json.size() + size * 96);
+    for (uint32_t i = 0; i < size; ++i) {
+      const TraceSpan& span = buffer->spans[i];
+      json.append(first ? "{\"name\":" : ",{\"name\":");
+      AppendJsonString(json, span.name);
+      json.append(span.is_counter ? ",\"ph\":\"C\",\"pid\":1,\"tid\":"
+                                  : ",\"ph\":\"X\",\"pid\":1,\"tid\":");
+      json.append(tid);
+      json.append(",\"ts\":");
+      json.append(std::to_string(span.begin_us));
+      if (span.is_counter) {
+        // Counters are grouped by name and id, so use the thread ID to get a
+        // separate series per thread.
+        json.append(",\"id\":");
+        json.append(tid);
+        json.append(",\"args\":{\"value\":");
+        json.append(std::to_string(span.value));
+        json.append("}}");
+      } else {
+        json.append(",\"dur\":");
+        json.append(std::to_string(span.value));
+        json.push_back('}');
+      }
+      first = false;
+    }
+  }
+  json.append("]}");
+  if (dropped > 0) {
+    RTC_LOG(LS_WARNING) << "Dropped " << dropped
+                        << " trace spans because per-thread buffers were full.";
+  }
+  return json;
+}
+
+}  // namespace
+
+namespace Microsoft {
+namespace MixedReality {
+namespace WebRTC {
+
+std::atomic_bool TraceRecorder::capturing_{false};
+
+Result TraceRecorder::Start() noexcept {
+#if MRS_TRACING_ENABLED
+  TraceRegistry& registry = GetRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex_);
+  registry.json_.reset();
+
+  // Release the buffers of exited threads. Their owner cannot write to them
+  // anymore, and the previous capture is discarded anyway.
+  auto& buffers = registry.buffers_;
+  buffers.erase(std::remove_if(buffers.begin(), buffers.end(),
+                               [](const std::unique_ptr<ThreadBuffer>& buffer) {
+                                 return buffer->retired.load(
+                                     std::memory_order_acquire);
+                               }),
+                buffers.end());
+
+  // Each thread lazily resets its own buffer when it notices the new
+  // generation, so that resetting doesn't race with writing.
+  registry.generation_.fetch_add(1, std::memory_order_release);
+  capturing_.store(true, std::memory_order_release);
+  return Result::kSuccess;
+#else
+  return Result::kUnsupported;
+#endif
+}
+
+Result TraceRecorder::Stop() noexcept {
+  capturing_.store(false, std::memory_order_release);
+  return Result::kSuccess;
+}
+
+Result TraceRecorder::CopyJson(char* buffer, uint64_t& buffer_size) noexcept {
+  if (IsCapturing()) {
+    return Result::kInvalidOperation;
+  }
+  TraceRegistry& registry = GetRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex_);
+  if (!registry.json_.has_value()) {
+    registry.json_ = SerializeNoLock(
+        registry, registry.generation_.load(std::memory_order_acquire));
+  }
+  const std::string& json = *registry.json_;
+  const uint64_t capacity = buffer_size;
+  const uint64_t size_with_terminator = json.size() + 1;
+  // Always assign size, even if buffer too small
+  buffer_size = size_with_terminator;
+  if (size_with_terminator > capacity) {
+    return Result::kBufferTooSmall;
+  }
+  memcpy(buffer, json.c_str(), static_cast<size_t>(size_with_terminator));
+  return Result::kSuccess;
+}
+
+void TraceRecorder::AddSpan(const char* name,
+                            int64_t begin_us,
+                            int64_t end_us) noexcept {
+  AddEvent(TraceSpan{name, begin_us, end_us - begin_us, false});
+}
+
+void TraceRecorder::AddCounter(const char* name,
+                               int64_t timestamp_us,
+                               int64_t value) noexcept {
+  AddEvent(TraceSpan{name, timestamp_us, value, true});
+}
+
+}  // namespace WebRTC
+}  // namespace MixedReality
+}  // namespace Microsoft
@@ -0,0 +1,112 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <atomic>
+
+#include "alloc_tracker.h"
+#include "mrs_errors.h"
+
+#include "rtc_base/timeutils.h"
+
+/// Trace spans are compiled in unless |MRS_DISABLE_TRACING| is defined. When
+/// compiled in but not capturing, a span costs a single relaxed atomic load.
+#if defined(MRS_DISABLE_TRACING)
+#define MRS_TRACING_ENABLED 0
+#else
+#define MRS_TRACING_ENABLED 1
+#endif
+
+#if MRS_TRACING_ENABLED
+#define MRS_TRACE_CONCAT_IMPL(a, b) a##b
+#define MRS_TRACE_CONCAT(a, b) MRS_TRACE_CONCAT_IMPL(a, b)
+
+/// Record a trace span covering the remainder of the current scope. |name| must
+/// be a string literal, or any string with static storage duration. The span
+/// is also an allocation scope if allocation tracking is compiled in; it is
+/// declared last so that recording the span is not attributed to the scope.
+#define MRS_TRACE_SCOPE(name)                                          \
+  ::Microsoft::MixedReality::WebRTC::ScopedTraceSpan MRS_TRACE_CONCAT( \
+      mrs_trace_span_, __LINE__)(name);                                \
+  MRS_ALLOC_SCOPE(name)
+#else
+#define MRS_TRACE_SCOPE(name) MRS_ALLOC_SCOPE(name)
+#endif
+
+namespace Microsoft {
+namespace MixedReality {
+namespace WebRTC {
+
+/// Process-wide recorder of trace spans.
+///
+/// Each thread records its spans into its own fixed-capacity buffer, with a
+/// single writer and no lock on the recording path. A lock is only taken once
+/// per thread, to register its buffer on its first span, and to start a capture
+/// or serialize it. Spans recorded once a thread buffer is full are dropped.
+///
+/// Captured spans are serialized in the Chrome trace event JSON format, which
+/// can be loaded in chrome://tracing or https://ui.perfetto.dev.
+class TraceRecorder {
+ public:
+  /// Start a new capture, discarding any previously captured span.
+  static Result Start() noexcept;
+
+  /// Stop the current capture, if any. Captured spans remain available for
+  /// serialization until the next capture starts.
+  static Result Stop() noexcept;
+
+  /// Serialize the last capture as a JSON string into |buffer|, and set
+  /// |buffer_size| to the size of the string including its null terminator.
+  /// Return |Result::kBufferTooSmall| if |buffer| is not large enough, in which
+  /// case |buffer_size| is set to the required size. The serialized string is
+  /// cached until the next capture starts. Return |Result::kInvalidOperation|
+  /// while capturing.
+  static Result CopyJson(char* buffer, uint64_t& buffer_size) noexcept;
+
+  /// Check if a capture is in progress.
+  static bool IsCapturing() noexcept {
+    return capturing_.load(std::memory_order_relaxed);
+  }
+
+  /// Record a span on the current thread. |name| must have static storage
+  /// duration.
+  static void AddSpan(const char* name,
+                      int64_t begin_us,
+                      int64_t end_us) noexcept;
+
+  /// Record a counter sample on the current thread. Samples of the same
+  /// counter recorded on different threads are exported as separate series.
+  /// |name| must have static storage duration.
+  static void AddCounter(const char* name,
+                         int64_t timestamp_us,
+                         int64_t value) noexcept;
+
+ private:
+  static std::atomic_bool capturing_;
+};
+
+/// RAII helper recording a span from its construction to its destruction, if a
+/// capture is in progress on construction. Use |MRS_TRACE_SCOPE()| instead of
+/// using this class directly, so that spans can be compiled out.
+class ScopedTraceSpan {
+ public:
+  explicit ScopedTraceSpan(const char* name) noexcept
+      : name_(TraceRecorder::IsCapturing() ? name : nullptr),
+        begin_us_(name_ ? rtc::TimeMicros() : 0) {}
+  ~ScopedTraceSpan() noexcept {
+    if (name_) {
+      TraceRecorder::AddSpan(name_, begin_us_, rtc::TimeMicros());
+    }
+  }
+  ScopedTraceSpan(const ScopedTraceSpan&) = delete;
+  ScopedTraceSpan& operator=(const ScopedTraceSpan&) = delete;
+
+ private:
+  const char* const name_;
+  const int64_t begin_us_;
+};
+
+}  // namespace WebRTC
+}  // namespace MixedReality
+}  // namespace Microsoft
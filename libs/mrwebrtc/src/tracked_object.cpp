@@ -10,9 +10,24 @@ namespace Microsoft {
 namespace MixedReality {
 namespace WebRTC {
 
+void ObjectMetrics::CopyTo(mrsObjectMetrics& metrics) const noexcept {
+  metrics.frames_in = frames_in.load(std::memory_order_relaxed);
+  metrics.frames_out = frames_out.load(std::memory_order_relaxed);
+  metrics.frames_dropped = frames_dropped.load(std::memory_order_relaxed);
+  metrics.conversion_time_us =
+      conversion_time_us.load(std::memory_order_relaxed);
+  metrics.bytes_sent = bytes_sent.load(std::memory_order_relaxed);
+  metrics.bytes_received = bytes_received.load(std::memory_order_relaxed);
+  metrics.callback_count = callback_count.load(std::memory_order_relaxed);
+  metrics.callback_time_us = callback_time_us.load(std::memory_order_relaxed);
+  metrics.overrun_count = overrun_count.load(std::memory_order_relaxed);
+}
+
 TrackedObject::TrackedObject(RefPtr<GlobalFactory> global_factory,
                              ObjectType object_type)
-    : global_factory_(std::move(global_factory)), object_type_(object_type) {
+    : global_factory_(std::move(global_factory)),
+      object_type_(object_type),
+      memory_account_(MemoryAccount::Global()) {
   global_factory_->AddObject(this);
 }
 
@@ -3,16 +3,23 @@
 
 #pragma once
 
+#include <atomic>
+#include <memory>
 #include <string>
 
+#include "memory_account.h"
+#include "object_interop.h"
 #include "ref_counted_base.h"
 #include "refptr.h"
 
+#include "rtc_base/timeutils.h"
+
 namespace Microsoft {
 namespace MixedReality {
 namespace WebRTC {
 
 class GlobalFactory;
+class LiveObjectRegistry;
 
 /// Enumeration of all object types that the global factory keeps track of for
 /// the purpose of keeping itself alive. Each value correspond to a type of
@@ -32,6 +39,39 @@ enum class ObjectType : int {
   kDeviceVideoTrackSource,
   kExternalVideoTrackSource,
   kAudioTrackReadBuffer,
+  kForwardedVideoTrackSource,
+  kEncodedVideoTrackSource,
+  kMediaRecorder,
+};
+
+/// Cheap performance counters of an object, updated with relaxed atomic
+/// operations so that they can be read from any thread at any time. See
+/// |mrsObjectMetrics| for the meaning of each counter.
+struct ObjectMetrics {
+  std::atomic<uint64_t> frames_in{0};
+  std::atomic<uint64_t> frames_out{0};
+  std::atomic<uint64_t> frames_dropped{0};
+  std::atomic<uint64_t> conversion_time_us{0};
+  std::atomic<uint64_t> bytes_sent{0};
+  std::atomic<uint64_t> bytes_received{0};
+  std::atomic<uint64_t> callback_count{0};
+  std::atomic<uint64_t> callback_time_us{0};
+  std::atomic<uint64_t> overrun_count{0};
+
+  /// Add a value to a counter.
+  static void Add(std::atomic<uint64_t>& counter, uint64_t value) noexcept {
+    counter.fetch_add(value, std::memory_order_relaxed);
+  }
+
+  /// Record a single user callback invocation which started at |start_us|,
+  /// from |rtc::TimeMicros()|.
+  void AddCallback(int64_t start_us) noexcept {
+    Add(callback_count, 1);
+    Add(callback_time_us, static_cast<uint64_t>(rtc::TimeMicros() - start_us));
+  }
+
+  /// Copy all counters into the interop struct.
+  void CopyTo(mrsObjectMetrics& metrics) const noexcept;
 };
 
 /// Object tracked for interop, exposing helper methods for debugging purpose.
@@ -62,11 +102,36 @@ class TrackedObject : public RefCountedBase {
     user_data_ = user_data;
   }
 
+  /// Get the performance counters of the object.
+  MRS_NODISCARD ObjectMetrics& GetMetrics() const noexcept { return metrics_; }
+
+  /// Get the account the memory of the object's buffers is charged to. This is
+  /// the account of the peer connection owning the object, if any, or the
+  /// process-wide account otherwise.
+  MRS_NODISCARD const std::shared_ptr<MemoryAccount>& GetMemoryAccount() const
+      noexcept {
+    return memory_account_;
+  }
+
  protected:
   RefPtr<GlobalFactory> global_factory_;
   const ObjectType object_type_;
   void* user_data_{nullptr};
   std::string name_;
+  mutable ObjectMetrics metrics_;
+
+  /// Account of the object's buffers. Derived classes owned by a peer
+  /// connection replace it on construction, before allocating any buffer.
+  std::shared_ptr<MemoryAccount> memory_account_;
+
+ private:
+  friend class LiveObjectRegistry;
+
+  /// Links of the intrusive list of live objects of |LiveObjectRegistry|,
+  /// protected by the lock of the registry shard of the object.
+  TrackedObject* live_prev_{nullptr};
+  TrackedObject* live_next_{nullptr};
+  bool live_registered_{false};
 };
 
 }  // namespace WebRTC
@@ -9,6 +9,8 @@
 #include "remote_audio_track_interop.h"
 #include "utils.h"
 
+#include "system_wrappers/include/clock.h"
+
 namespace Microsoft {
 namespace MixedReality {
 namespace WebRTC {
@@ -100,6 +102,16 @@ const char* ToString(webrtc::RtpTransceiverDirection dir) {
   }
 }
 
+int64_t CurrentNtpTimeMs() noexcept {
+  return webrtc::Clock::GetRealTimeClock()->CurrentNtpInMilliseconds();
+}
+
+int64_t RtcTimeToNtpMs(int64_t rtc_time_ms) noexcept {
+  // Same conversion as the one done by the video encoder when stamping frames
+  // without NTP time, so that both agree.
+  return rtc_time_ms + (CurrentNtpTimeMs() - rtc::TimeMillis());
+}
+
 const char* ToString(bool value) {
   return (value ? "true" : "false");
 }
@@ -128,6 +140,12 @@ absl::string_view ObjectTypeToString(ObjectType type) {
       return "DeviceVideoTrackSource";
     case ObjectType::kExternalVideoTrackSource:
       return "ExternalVideoTrackSource";
+    case ObjectType::kForwardedVideoTrackSource:
+      return "ForwardedVideoTrackSource";
+    case ObjectType::kEncodedVideoTrackSource:
+      return "EncodedVideoTrackSource";
+    case ObjectType::kMediaRecorder:
+      return "MediaRecorder";
     default:
       RTC_NOTREACHED();
       return "<UnknownObjectType>";
@@ -68,6 +68,14 @@ std::string ObjectToString(TrackedObject* obj);
 bool IsValidAudioTrackBufferPadBehavior(
     mrsAudioTrackReadBufferPadBehavior pad_behavior);
 
+/// Get the current wall-clock time in milliseconds since the NTP epoch, in the
+/// same time base as the one used by RTCP sender reports.
+int64_t CurrentNtpTimeMs() noexcept;
+
+/// Convert a time obtained from |rtc::TimeMillis()| into milliseconds since the
+/// NTP epoch.
+int64_t RtcTimeToNtpMs(int64_t rtc_time_ms) noexcept;
+
 /// Callback-based asynchronous enumerator utility.
 ///
 /// The utility takes a mandatory enumeration callback, which is called each time
@@ -4,6 +4,8 @@
 
 #include "pch.h"
 
+#include "tracing.h"
+#include "utils.h"
 #include "video_frame_observer.h"
 
 namespace {
@@ -44,12 +46,27 @@ void VideoFrameObserver::SetCallback(
     I420AFrameReadyCallback callback) noexcept {
   std::lock_guard<std::mutex> lock(mutex_);
   i420a_callback_ = std::move(callback);
+  i420a_callback_.SetSite(owner_, mrsCallbackType::kI420AVideoFrame);
+  has_callback_.store(i420a_callback_ || argb_callback_,
+                      std::memory_order_relaxed);
 }
 
 void VideoFrameObserver::SetCallback(
     Argb32FrameReadyCallback callback) noexcept {
   std::lock_guard<std::mutex> lock(mutex_);
   argb_callback_ = std::move(callback);
+  argb_callback_.SetSite(owner_, mrsCallbackType::kArgb32VideoFrame);
+  has_callback_.store(i420a_callback_ || argb_callback_,
+                      std::memory_order_relaxed);
+}
+
+void VideoFrameObserver::GetLatencyHistogram(VideoLatencyHistogram& histogram,
+                                             bool reset) noexcept {
+  std::lock_guard<std::mutex> lock(mutex_);
+  histogram = latency_histogram_;
+  if (reset) {
+    latency_histogram_ = {};
+  }
 }
 
 ArgbBuffer* VideoFrameObserver::GetArgbScratchBuffer(int width, int height) {
@@ -61,14 +78,34 @@ ArgbBuffer* VideoFrameObserver::GetArgbScratchBuffer(int width, int height) {
     }
   }
   argb_scratch_buffer_ = ArgbBuffer::Create(width, height);
+  scratch_memory_.Set(needed_size);
   return argb_scratch_buffer_.get();
 }
 
 void VideoFrameObserver::OnFrame(const webrtc::VideoFrame& frame) noexcept {
+  MRS_TRACE_SCOPE("VideoFrameObserver::OnFrame");
+  // Local frames have no RTP timestamp yet, and their capture time is either
+  // stamped by the source, or derived from their render time like the video
+  // encoder does. Remote frames carry the sender capture time estimated from
+  // RTCP sender reports, or a non-positive value if not available yet.
+  const uint32_t rtp_timestamp = frame.timestamp();
+  int64_t capture_time_ntp_ms = frame.ntp_time_ms();
+  if ((capture_time_ntp_ms <= 0) && (rtp_timestamp == 0)) {
+    capture_time_ntp_ms = RtcTimeToNtpMs(frame.render_time_ms());
+  }
+  capture_time_ntp_ms = std::max<int64_t>(capture_time_ntp_ms, 0);
+  const int64_t receive_time_ntp_ms = CurrentNtpTimeMs();
+
+  ObjectMetrics::Add(observer_metrics_.frames_in, 1);
+
   std::lock_guard<std::mutex> lock(mutex_);
+  if (capture_time_ntp_ms > 0) {
+    RecordLatencyNoLock(receive_time_ntp_ms - capture_time_ntp_ms);
+  }
   if (!i420a_callback_ && !argb_callback_) {
     return;
   }
+  ObjectMetrics::Add(observer_metrics_.frames_out, 1);
 
   rtc::scoped_refptr<webrtc::VideoFrameBuffer> buffer(
       frame.video_frame_buffer());
@@ -80,8 +117,11 @@ void VideoFrameObserver::OnFrame(const webrtc::VideoFrame& frame) noexcept {
     // The buffer is not encoded in I420 with alpha channel; use I420 without
     // alpha channel as interchange format for the callback, and convert the
     // buffer to that (or do nothing if already in I420).
+    const int64_t convert_start_us = rtc::TimeMicros();
     rtc::scoped_refptr<webrtc::I420BufferInterface> i420_buffer =
         buffer->ToI420();
+    ObjectMetrics::Add(observer_metrics_.conversion_time_us,
+                       rtc::TimeMicros() - convert_start_us);
     const uint8_t* const yptr = i420_buffer->DataY();
     const uint8_t* const uptr = i420_buffer->DataU();
     const uint8_t* const vptr = i420_buffer->DataV();
@@ -98,21 +138,34 @@ void VideoFrameObserver::OnFrame(const webrtc::VideoFrame& frame) noexcept {
       i420a_frame.astride_ = 0;
       i420a_frame.width_ = width;
       i420a_frame.height_ = height;
+      i420a_frame.capture_time_ntp_ms_ = capture_time_ntp_ms;
+      i420a_frame.receive_time_ntp_ms_ = receive_time_ntp_ms;
+      i420a_frame.rtp_timestamp_ = rtp_timestamp;
+      const int64_t callback_start_us = rtc::TimeMicros();
       i420a_callback_(i420a_frame);
+      observer_metrics_.AddCallback(callback_start_us);
     }
 
     if (argb_callback_) {
+      const int64_t convert_start_us = rtc::TimeMicros();
       ArgbBuffer* const argb_buffer = GetArgbScratchBuffer(width, height);
       libyuv::I420ToARGB(yptr, i420_buffer->StrideY(), uptr,
                          i420_buffer->StrideU(), vptr, i420_buffer->StrideV(),
                          argb_buffer->Data(), argb_buffer->Stride(), width,
                          height);
+      ObjectMetrics::Add(observer_metrics_.conversion_time_us,
+                         rtc::TimeMicros() - convert_start_us);
       Argb32VideoFrame argb32_frame;
       argb32_frame.argb32_data_ = argb_buffer->Data();
       argb32_frame.stride_ = argb_buffer->Stride();
       argb32_frame.width_ = width;
       argb32_frame.height_ = height;
+      argb32_frame.capture_time_ntp_ms_ = capture_time_ntp_ms;
+      argb32_frame.receive_time_ntp_ms_ = receive_time_ntp_ms;
+      argb32_frame.rtp_timestamp_ = rtp_timestamp;
+      const int64_t callback_start_us = rtc::TimeMicros();
       argb_callback_(argb32_frame);
+      observer_metrics_.AddCallback(callback_start_us);
     }
 
   } else {
@@ -135,25 +188,57 @@ void VideoFrameObserver::OnFrame(const webrtc::VideoFrame& frame) noexcept {
       i420a_frame.astride_ = i420a_buffer->StrideA();
       i420a_frame.width_ = width;
       i420a_frame.height_ = height;
+      i420a_frame.capture_time_ntp_ms_ = capture_time_ntp_ms;
+      i420a_frame.receive_time_ntp_ms_ = receive_time_ntp_ms;
+      i420a_frame.rtp_timestamp_ = rtp_timestamp;
+      const int64_t callback_start_us = rtc::TimeMicros();
       i420a_callback_(i420a_frame);
+      observer_metrics_.AddCallback(callback_start_us);
     }
 
     if (argb_callback_) {
+      const int64_t convert_start_us = rtc::TimeMicros();
       ArgbBuffer* const argb_buffer = GetArgbScratchBuffer(width, height);
       libyuv::I420AlphaToARGB(
           yptr, i420a_buffer->StrideY(), uptr, i420a_buffer->StrideU(), vptr,
           i420a_buffer->StrideV(), aptr, i420a_buffer->StrideA(),
           argb_buffer->Data(), argb_buffer->Stride(), width, height, 0);
+      ObjectMetrics::Add(observer_metrics_.conversion_time_us,
+                         rtc::TimeMicros() - convert_start_us);
       Argb32VideoFrame argb32_frame;
       argb32_frame.argb32_data_ = argb_buffer->Data();
       argb32_frame.stride_ = argb_buffer->Stride();
       argb32_frame.width_ = width;
       argb32_frame.height_ = height;
+      argb32_frame.capture_time_ntp_ms_ = capture_time_ntp_ms;
+      argb32_frame.receive_time_ntp_ms_ = receive_time_ntp_ms;
+      argb32_frame.rtp_timestamp_ = rtp_timestamp;
+      const int64_t callback_start_us = rtc::TimeMicros();
       argb_callback_(argb32_frame);
+      observer_metrics_.AddCallback(callback_start_us);
     }
   }
 }
 
+void VideoFrameObserver::RecordLatencyNoLock(int64_t latency_ms) noexcept {
+  // Clamp negative values caused by clock adjustments or estimation errors.
+  latency_ms = std::max<int64_t>(latency_ms, 0);
+  VideoLatencyHistogram& histogram = latency_histogram_;
+  if (histogram.count_ == 0) {
+    histogram.min_ms_ = latency_ms;
+    histogram.max_ms_ = latency_ms;
+  } else {
+    histogram.min_ms_ = std::min(histogram.min_ms_, latency_ms);
+    histogram.max_ms_ = std::max(histogram.max_ms_, latency_ms);
+  }
+  ++histogram.count_;
+  histogram.sum_ms_ += latency_ms;
+  const int64_t bucket =
+      std::min<int64_t>(latency_ms / VideoLatencyHistogram::kBucketWidthMs,
+                        VideoLatencyHistogram::kBucketCount - 1);
+  ++histogram.buckets_[bucket];
+}
+
 }  // namespace WebRTC
 }  // namespace MixedReality
 }  // namespace Microsoft
@@ -3,12 +3,15 @@
 
 #pragma once
 
+#include <atomic>
 #include <mutex>
 
 #include "api/video/video_frame.h"
 #include "api/video/video_sink_interface.h"
 
 #include "callback.h"
+#include "memory_account.h"
+#include "tracked_object.h"
 #include "video_frame.h"
 
 #include "rtc_base/memory/aligned_malloc.h"
@@ -117,6 +120,16 @@ class ArgbBuffer : public webrtc::VideoFrameBuffer {
 /// Video frame observer to get notified of newly available video frames.
 class VideoFrameObserver : public rtc::VideoSinkInterface<webrtc::VideoFrame> {
  public:
+  /// Create an observer updating the performance counters of the given
+  /// owner, or its own counters if |owner| is null. The owner also identifies
+  /// the callbacks reported by the callback watchdog.
+  explicit VideoFrameObserver(TrackedObject* owner = nullptr) noexcept
+      : owner_(owner),
+        observer_metrics_(owner ? owner->GetMetrics() : own_metrics_),
+        scratch_memory_(owner ? owner->GetMemoryAccount()
+                              : MemoryAccount::Global(),
+                        MemoryCategory::kVideoFrame) {}
+
   /// Register a callback to get notified on frame available,
   /// and received that frame as a I420-encoded buffer.
   /// This is not exclusive and can be used along another ARGB callback.
@@ -127,6 +140,17 @@ class VideoFrameObserver : public rtc::VideoSinkInterface<webrtc::VideoFrame> {
   /// This is not exclusive and can be used along another I420 callback.
   void SetCallback(Argb32FrameReadyCallback callback) noexcept;
 
+  /// Check if any frame callback is registered. This does not lock the
+  /// callbacks, so can be called from any thread.
+  bool HasCallback() const noexcept {
+    return has_callback_.load(std::memory_order_relaxed);
+  }
+
+  /// Get the histogram of the capture-to-render latency of the frames observed
+  /// so far, and optionally reset it.
+  void GetLatencyHistogram(VideoLatencyHistogram& histogram,
+                           bool reset) noexcept;
+
  protected:
   /// Get a temporary scratch buffer for an ARGB32 frame of the given
   /// dimensions. The returned buffer does not need to be deallocated, but can
@@ -135,6 +159,10 @@ class VideoFrameObserver : public rtc::VideoSinkInterface<webrtc::VideoFrame> {
   /// it for the duration of its access.
   ArgbBuffer* GetArgbScratchBuffer(int width, int height);
 
+  /// Record the capture-to-render latency of a frame. Before calling this
+  /// method the caller needs to acquire |mutex_|.
+  void RecordLatencyNoLock(int64_t latency_ms) noexcept;
+
   // VideoSinkInterface interface
   void OnFrame(const webrtc::VideoFrame& frame) noexcept override;
 
@@ -145,11 +173,29 @@ class VideoFrameObserver : public rtc::VideoSinkInterface<webrtc::VideoFrame> {
   /// Registered callback for receiving raw decoded ARGB frame.
   Argb32FrameReadyCallback argb_callback_ RTC_GUARDED_BY(mutex_);
 
+  /// Whether any of the callbacks above is registered.
+  std::atomic_bool has_callback_{false};
+
+  /// Object owning this observer, if any.
+  TrackedObject* const owner_;
+
+  /// Fallback counters if no owner is provided on construction.
+  ObjectMetrics own_metrics_;
+
+  /// Performance counters of the object owning this observer.
+  ObjectMetrics& observer_metrics_;
+
   /// Mutex protecting all callbacks as well as the ARGB32 scratch buffer.
   std::mutex mutex_;
 
   /// Reusable ARGB scratch buffer to avoid per-frame allocation.
   rtc::scoped_refptr<ArgbBuffer> argb_scratch_buffer_ RTC_GUARDED_BY(mutex_);
+
+  /// Memory charged for |argb_scratch_buffer_|.
+  MemoryCharge scratch_memory_ RTC_GUARDED_BY(mutex_);
+
+  /// Histogram of the capture-to-render latency of observed frames.
+  VideoLatencyHistogram latency_histogram_ RTC_GUARDED_BY(mutex_) = {};
 };
 
 }  // namespace WebRTC
@@ -0,0 +1,279 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+#include "pch.h"
+
+#include "alloc_tracking_interop.h"
+#include "data_channel_interop.h"
+#include "device_audio_track_source_interop.h"
+#include "external_video_track_source_interop.h"
+#include "interop_api.h"
+#include "local_audio_track_interop.h"
+#include "remote_audio_track_interop.h"
+#include "transceiver_interop.h"
+
+#include "test_utils.h"
+#include "video_test_utils.h"
+
+namespace {
+
+class AllocTrackingTests : public TestUtils::TestBase {};
+
+}  // namespace
+
+#if defined(MRS_ENABLE_ALLOC_TRACKING)
+
+namespace {
+
+/// Get the allocation counters of all scopes entered since tracking started.
+std::vector<mrsAllocScopeStats> GetScopeStats() {
+  uint32_t count = 0;
+  mrsResult res = mrsAllocTrackingGetScopeStats(nullptr, &count);
+  EXPECT_TRUE((res == Result::kSuccess) || (res == Result::kBufferTooSmall));
+  std::vector<mrsAllocScopeStats> stats(count);
+  EXPECT_EQ(Result::kSuccess,
+            mrsAllocTrackingGetScopeStats(stats.data(), &count));
+  stats.resize(count);
+  return stats;
+}
+
+/// Find the counters of the scope with the given name, or null if the scope
+/// was not entered.
+const mrsAllocScopeStats* FindScope(
+    const std::vector<mrsAllocScopeStats>& stats,
+    const char* name) {
+  for (auto&& scope : stats) {
+    if (strcmp(scope.name, name) == 0) {
+      return &scope;
+    }
+  }
+  return nullptr;
+}
+
+/// Check that the scope with the given name was entered while tracking, and
+/// never allocated outside of its nested scopes.
+void CheckNoAlloc(const std::vector<mrsAllocScopeStats>& stats,
+                  const char* name) {
+  const mrsAllocScopeStats* const scope = FindScope(stats, name);
+  ASSERT_NE(nullptr, scope) << name;
+  ASSERT_LT(0u, scope->invocation_count) << name;
+  ASSERT_EQ(0u, scope->alloc_count) << name;
+  ASSERT_EQ(0u, scope->alloc_bytes) << name;
+}
+
+using DataMessageCallback = InteropCallback<const void*, const uint64_t>;
+using DataStateCallback = InteropCallback<mrsDataChannelState, int32_t>;
+
+}  // namespace
+
+TEST_F(AllocTrackingTests, ExternalVideoSteadyState) {
+  mrsExternalVideoTrackSourceHandle source_handle = nullptr;
+  ASSERT_EQ(Result::kSuccess,
+            mrsExternalVideoTrackSourceCreateFromI420ACallback(
+                &VideoTestUtils::MakeTestFrame, nullptr, &source_handle));
+  ASSERT_NE(nullptr, source_handle);
+  mrsExternalVideoTrackSourceFinishCreation(source_handle);
+
+  // Warm up, letting the buffer pool reach its steady-state size
+  std::this_thread::sleep_for(200ms);
+
+  ASSERT_EQ(Result::kSuccess, mrsAllocTrackingStart());
+  std::this_thread::sleep_for(500ms);
+  ASSERT_EQ(Result::kSuccess, mrsAllocTrackingStop());
+
+  const std::vector<mrsAllocScopeStats> stats = GetScopeStats();
+  const mrsAllocScopeStats* const fill =
+      FindScope(stats, "ExternalVideoTrackSource::FillBuffer");
+  ASSERT_NE(nullptr, fill);
+  ASSERT_LT(0u, fill->invocation_count);
+  ASSERT_EQ(0u, fill->alloc_count);
+  ASSERT_EQ(0u, fill->alloc_bytes);
+
+  // Some threads allocated, if only to post the frame requests
+  uint32_t count = 0;
+  ASSERT_EQ(Result::kBufferTooSmall,
+            mrsAllocTrackingGetThreadStats(nullptr, &count));
+  ASSERT_LT(0u, count);
+
+  mrsRefCountedObjectRemoveRef(source_handle);
+}
+
+TEST_F(AllocTrackingTests, DataChannelSteadyState) {
+  LocalPeerPairRaii pair;
+
+  Event ev_open1, ev_open2;
+  DataStateCallback state1_cb = [&](mrsDataChannelState state, int32_t) {
+    if (state == mrsDataChannelState::kOpen) {
+      ev_open1.Set();
+    }
+  };
+  DataStateCallback state2_cb = [&](mrsDataChannelState state, int32_t) {
+    if (state == mrsDataChannelState::kOpen) {
+      ev_open2.Set();
+    }
+  };
+  Event ev_msg;
+  DataMessageCallback message2_cb = [&](const void*, const uint64_t) {
+    ev_msg.Set();
+  };
+  mrsDataChannelCallbacks callbacks1{};
+  callbacks1.state_callback = &DataStateCallback::StaticExec;
+  callbacks1.state_user_data = &state1_cb;
+  mrsDataChannelCallbacks callbacks2{};
+  callbacks2.message_callback = &DataMessageCallback::StaticExec;
+  callbacks2.message_user_data = &message2_cb;
+  callbacks2.state_callback = &DataStateCallback::StaticExec;
+  callbacks2.state_user_data = &state2_cb;
+
+  mrsDataChannelConfig config{};
+  config.id = 42;
+  config.label = "alloc";
+  config.flags = mrsDataChannelConfigFlags::kOrdered |
+                 mrsDataChannelConfigFlags::kReliable;
+  mrsDataChannelHandle handle1{};
+  ASSERT_EQ(Result::kSuccess,
+            mrsPeerConnectionAddDataChannel(pair.pc1(), &config, &handle1));
+  mrsDataChannelRegisterCallbacks(handle1, &callbacks1);
+  mrsDataChannelHandle handle2{};
+  ASSERT_EQ(Result::kSuccess,
+            mrsPeerConnectionAddDataChannel(pair.pc2(), &config, &handle2));
+  mrsDataChannelRegisterCallbacks(handle2, &callbacks2);
+  pair.ConnectAndWait();
+  ASSERT_TRUE(ev_open1.WaitFor(60s));
+  ASSERT_TRUE(ev_open2.WaitFor(60s));
+
+  // Send messages of the same size one at a time, so that the previous message
+  // is not referenced anymore and its send buffer is reused.
+  const uint8_t message[256]{};
+  auto send_messages = [&](int count) {
+    for (int i = 0; i < count; ++i) {
+      ev_msg.Reset();
+      ASSERT_EQ(Result::kSuccess,
+                mrsDataChannelSendMessage(handle1, message, sizeof(message)));
+      ASSERT_TRUE(ev_msg.WaitFor(5s));
+    }
+  };
+  send_messages(10);  // warm up
+
+  ASSERT_EQ(Result::kSuccess, mrsAllocTrackingStart());
+  send_messages(50);
+  ASSERT_EQ(Result::kSuccess, mrsAllocTrackingStop());
+
+  // WebRTC itself allocates in its nested scope, which is not checked.
+  CheckNoAlloc(GetScopeStats(), "DataChannel::Send");
+
+  const mrsDataChannelCallbacks no_callbacks{};
+  mrsDataChannelRegisterCallbacks(handle1, &no_callbacks);
+  mrsDataChannelRegisterCallbacks(handle2, &no_callbacks);
+  ASSERT_EQ(Result::kSuccess,
+            mrsPeerConnectionRemoveDataChannel(pair.pc1(), handle1));
+  ASSERT_EQ(Result::kSuccess,
+            mrsPeerConnectionRemoveDataChannel(pair.pc2(), handle2));
+}
+
+#if !defined(MRSW_EXCLUDE_DEVICE_TESTS)
+
+TEST_F(AllocTrackingTests, RemoteAudioSteadyState) {
+  LocalPeerPairRaii pair;
+
+  // The tree has no external audio source, so send the microphone instead
+  mrsLocalAudioDeviceInitConfig device_config{};
+  mrsDeviceAudioTrackSourceHandle audio_source{};
+  ASSERT_EQ(Result::kSuccess,
+            mrsDeviceAudioTrackSourceCreate(&device_config, &audio_source));
+  mrsLocalAudioTrackInitSettings init_settings{};
+  init_settings.track_name = "alloc_audio_track";
+  mrsLocalAudioTrackHandle local_track{};
+  ASSERT_EQ(Result::kSuccess,
+            mrsLocalAudioTrackCreateFromSource(&init_settings, audio_source,
+                                               &local_track));
+  mrsTransceiverInitConfig transceiver_config{};
+  transceiver_config.name = "alloc_audio";
+  transceiver_config.media_kind = mrsMediaKind::kAudio;
+  mrsTransceiverHandle transceiver{};
+  ASSERT_EQ(Result::kSuccess,
+            mrsPeerConnectionAddTransceiver(pair.pc1(), &transceiver_config,
+                                            &transceiver));
+  ASSERT_EQ(Result::kSuccess,
+            mrsTransceiverSetLocalAudioTrack(transceiver, local_track));
+
+  mrsRemoteAudioTrackHandle remote_track{};
+  Event track_added;
+  InteropCallback<const mrsRemoteAudioTrackAddedInfo*> track_added_cb =
+      [&](const mrsRemoteAudioTrackAddedInfo* info) {
+        remote_track = info->track_handle;
+        track_added.Set();
+      };
+  mrsPeerConnectionRegisterAudioTrackAddedCallback(pair.pc2(),
+                                                   CB(track_added_cb));
+  pair.ConnectAndWait();
+  ASSERT_TRUE(track_added.WaitFor(5s));
+  mrsPeerConnectionRegisterAudioTrackAddedCallback(pair.pc2(), nullptr,
+                                                   nullptr);
+
+  // Redirect the remote track to the read buffer, which makes the toggle audio
+  // mixer pump it instead of mixing it to the audio device.
+  mrsRemoteAudioTrackOutputToDevice(remote_track, false);
+  mrsAudioTrackReadBufferHandle read_buffer{};
+  ASSERT_EQ(Result::kSuccess,
+            mrsRemoteAudioTrackCreateReadBuffer(remote_track, &read_buffer));
+
+  // Read 10ms chunks at the rate they are produced, with a fixed format
+  std::vector<float> samples(480 * 2);
+  auto read_audio = [&](int count) {
+    for (int i = 0; i < count; ++i) {
+      int num_read = 0;
+      mrsBool has_overrun = mrsBool::kFalse;
+      ASSERT_EQ(Result::kSuccess,
+                mrsAudioTrackReadBufferRead(
+                    read_buffer, 48000, 2,
+                    mrsAudioTrackReadBufferPadBehavior::kPadWithZero,
+                    samples.data(), static_cast<int>(samples.size()),
+                    &num_read, &has_overrun));
+      std::this_thread::sleep_for(10ms);
+    }
+  };
+  read_audio(50);  // warm up, letting the ring buffer reach its steady size
+
+  ASSERT_EQ(Result::kSuccess, mrsAllocTrackingStart());
+  read_audio(100);
+  ASSERT_EQ(Result::kSuccess, mrsAllocTrackingStop());
+
+  const std::vector<mrsAllocScopeStats> stats = GetScopeStats();
+  CheckNoAlloc(stats, "ToggleAudioMixer::Mix");
+  CheckNoAlloc(stats, "AudioTrackReadBuffer::OnData");
+  CheckNoAlloc(stats, "AudioTrackReadBuffer::Read");
+  if (FindScope(stats, "AudioTrackReadBuffer::addFrame")) {
+    CheckNoAlloc(stats, "AudioTrackReadBuffer::addFrame");
+  }
+
+  mrsAudioTrackReadBufferDestroy(read_buffer);
+  mrsRefCountedObjectRemoveRef(local_track);
+  mrsRefCountedObjectRemoveRef(audio_source);
+}
+
+#endif  // !defined(MRSW_EXCLUDE_DEVICE_TESTS)
+
+#else  // defined(MRS_ENABLE_ALLOC_TRACKING)
+
+TEST_F(AllocTrackingTests, Unsupported) {
+  ASSERT_EQ(Result::kUnsupported, mrsAllocTrackingStart());
+  uint32_t count = 0;
+  ASSERT_EQ(Result::kUnsupported,
+            mrsAllocTrackingGetScopeStats(nullptr, &count));
+  ASSERT_EQ(0u, count);
+}
+
+#endif  // defined(MRS_ENABLE_ALLOC_TRACKING)
+
+TEST_F(AllocTrackingTests, InvalidParameters) {
+  ASSERT_EQ(Result::kInvalidParameter,
+            mrsAllocTrackingGetScopeStats(nullptr, nullptr));
+  uint32_t count = 4;
+  ASSERT_EQ(Result::kInvalidParameter,
+            mrsAllocTrackingGetScopeStats(nullptr, &count));
+  ASSERT_EQ(Result::kInvalidParameter,
+            mrsAllocTrackingGetThreadStats(nullptr, nullptr));
+  ASSERT_EQ(Result::kInvalidParameter,
+            mrsAllocTrackingGetThreadStats(nullptr, &count));
+}
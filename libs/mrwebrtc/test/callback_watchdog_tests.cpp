@@ -0,0 +1,98 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+#include "pch.h"
+
+#include "callback_watchdog_interop.h"
+#include "interop_api.h"
+
+#include "test_utils.h"
+
+namespace {
+
+class CallbackWatchdogTests : public TestUtils::TestBase {};
+
+/// Warnings received by |StaticWarningCallback()|.
+struct WarningRecorder {
+  std::mutex mutex_;
+  std::vector<mrsCallbackWarningInfo> warnings_;
+};
+
+void MRS_CALL StaticWarningCallback(void* user_data,
+                                    const mrsCallbackWarningInfo* info) {
+  auto recorder = static_cast<WarningRecorder*>(user_data);
+  std::lock_guard<std::mutex> lock(recorder->mutex_);
+  recorder->warnings_.push_back(*info);
+}
+
+}  // namespace
+
+TEST_F(CallbackWatchdogTests, SlowCallback) {
+  mrsCallbackHistogram histogram{};
+  ASSERT_EQ(Result::kSuccess, mrsCallbackWatchdogGetHistogram(
+                                  mrsCallbackType::kIceGatheringStateChanged,
+                                  mrsBool::kTrue, &histogram));
+
+  WarningRecorder recorder;
+  mrsCallbackWatchdogRegisterWarningCallback(&StaticWarningCallback,
+                                             &recorder);
+  mrsCallbackWatchdogConfig config{};
+  config.budget_us = 1000;
+  config.warning_interval_ms = 0;
+  ASSERT_EQ(Result::kSuccess, mrsCallbackWatchdogStart(&config));
+
+  {
+    mrsPeerConnectionConfiguration pc_config{};
+    LocalPeerPairRaii pair(pc_config);
+
+    // Slow down a callback invoked while connecting
+    InteropCallback<mrsIceGatheringState> gathering_cb(
+        [](mrsIceGatheringState /*state*/) {
+          std::this_thread::sleep_for(5ms);
+        });
+    mrsPeerConnectionRegisterIceGatheringStateChangedCallback(
+        pair.pc1(), CB(gathering_cb));
+    pair.ConnectAndWait();
+    mrsPeerConnectionRegisterIceGatheringStateChangedCallback(pair.pc1(),
+                                                              nullptr, nullptr);
+
+    ASSERT_EQ(Result::kSuccess, mrsCallbackWatchdogStop());
+    mrsCallbackWatchdogRegisterWarningCallback(nullptr, nullptr);
+
+    std::lock_guard<std::mutex> lock(recorder.mutex_);
+    ASSERT_FALSE(recorder.warnings_.empty());
+    for (auto&& warning : recorder.warnings_) {
+      ASSERT_EQ(mrsCallbackType::kIceGatheringStateChanged, warning.type);
+      ASSERT_EQ(pair.pc1(), warning.object_handle);
+      ASSERT_LT(1000, warning.duration_us);
+      ASSERT_EQ(1000, warning.budget_us);
+    }
+  }
+
+  ASSERT_EQ(Result::kSuccess, mrsCallbackWatchdogGetHistogram(
+                                  mrsCallbackType::kIceGatheringStateChanged,
+                                  mrsBool::kFalse, &histogram));
+  ASSERT_LE(1u, histogram.count);
+  ASSERT_LE(1u, histogram.over_budget_count);
+  ASSERT_LE(5000u, histogram.max_us);
+  ASSERT_LE(histogram.max_us, histogram.total_us);
+  uint64_t total_count = 0;
+  for (int i = 0; i < mrsCallbackHistogram::kBucketCount; ++i) {
+    total_count += histogram.buckets[i];
+  }
+  ASSERT_EQ(histogram.count, total_count);
+}
+
+TEST_F(CallbackWatchdogTests, InvalidParameters) {
+  ASSERT_EQ(Result::kInvalidParameter, mrsCallbackWatchdogStart(nullptr));
+  mrsCallbackWatchdogConfig config{};
+  config.budget_us = -1;
+  ASSERT_EQ(Result::kInvalidParameter, mrsCallbackWatchdogStart(&config));
+  ASSERT_EQ(Result::kInvalidParameter,
+            mrsCallbackWatchdogGetHistogram(mrsCallbackType::kConnected,
+                                            mrsBool::kFalse, nullptr));
+  mrsCallbackHistogram histogram{};
+  ASSERT_EQ(Result::kInvalidParameter,
+            mrsCallbackWatchdogGetHistogram((mrsCallbackType)1000,
+                                            mrsBool::kFalse, &histogram));
+}
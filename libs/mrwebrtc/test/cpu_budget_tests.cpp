@@ -0,0 +1,174 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+#include "pch.h"
+
+#include "cpu_budget_interop.h"
+#include "external_video_track_source_interop.h"
+#include "interop_api.h"
+#include "local_video_track_interop.h"
+#include "transceiver_interop.h"
+
+#include "peer_connection_test_helpers.h"
+#include "test_utils.h"
+#include "video_test_utils.h"
+
+namespace {
+
+class CpuBudgetTests : public TestUtils::TestBase {
+ public:
+  void TearDown() override {
+    ASSERT_EQ(Result::kSuccess, mrsCpuBudgetStop());
+    TestUtils::TestBase::TearDown();
+  }
+};
+
+}  // namespace
+
+TEST_F(CpuBudgetTests, InvalidParameters) {
+  ASSERT_EQ(Result::kInvalidParameter, mrsCpuBudgetStart(nullptr));
+  mrsCpuBudgetConfig config{};
+  config.target_cpu_percent = 0.0f;
+  ASSERT_EQ(Result::kInvalidParameter, mrsCpuBudgetStart(&config));
+  config.target_cpu_percent = 101.0f;
+  ASSERT_EQ(Result::kInvalidParameter, mrsCpuBudgetStart(&config));
+  config = mrsCpuBudgetConfig{};
+  config.interval_ms = 0;
+  ASSERT_EQ(Result::kInvalidParameter, mrsCpuBudgetStart(&config));
+  config = mrsCpuBudgetConfig{};
+  config.min_quality = 0.0f;
+  ASSERT_EQ(Result::kInvalidParameter, mrsCpuBudgetStart(&config));
+  config = mrsCpuBudgetConfig{};
+  config.max_framerate = 0;
+  ASSERT_EQ(Result::kInvalidParameter, mrsCpuBudgetStart(&config));
+  ASSERT_EQ(Result::kInvalidParameter, mrsCpuBudgetGetStatus(nullptr));
+
+  mrsCpuBudgetAllocation allocation{};
+  ASSERT_EQ(Result::kInvalidNativeHandle,
+            mrsPeerConnectionSetCpuBudgetWeight(nullptr, 1.0f));
+  ASSERT_EQ(Result::kInvalidNativeHandle,
+            mrsPeerConnectionGetCpuBudgetAllocation(nullptr, &allocation));
+  PCRaii pc;
+  ASSERT_EQ(Result::kInvalidParameter,
+            mrsPeerConnectionSetCpuBudgetWeight(pc.handle(), 0.0f));
+  ASSERT_EQ(Result::kInvalidParameter,
+            mrsPeerConnectionGetCpuBudgetAllocation(pc.handle(), nullptr));
+}
+
+TEST_F(CpuBudgetTests, Allocation) {
+  PCRaii pc1, pc2;
+  ASSERT_EQ(Result::kSuccess,
+            mrsPeerConnectionSetCpuBudgetWeight(pc2.handle(), 3.0f));
+  mrsCpuBudgetAllocation allocation1{}, allocation2{};
+  ASSERT_EQ(Result::kSuccess, mrsPeerConnectionGetCpuBudgetAllocation(
+                                  pc1.handle(), &allocation1));
+  ASSERT_EQ(1.0f, allocation1.weight);
+  ASSERT_EQ(1.0f, allocation1.quality);
+
+  // Any measurable usage exceeds the target, so the quality drops until the
+  // minimum. Keep this thread busy so that the usage is never zero.
+  mrsCpuBudgetConfig config{};
+  config.target_cpu_percent = 0.001f;
+  config.interval_ms = 50;
+  config.min_quality = 0.2f;
+  ASSERT_EQ(Result::kSuccess, mrsCpuBudgetStart(&config));
+  mrsCpuBudgetStatus status{};
+  const auto deadline = std::chrono::steady_clock::now() + 30s;
+  do {
+    ASSERT_LT(std::chrono::steady_clock::now(), deadline);
+    const auto spin_end = std::chrono::steady_clock::now() + 20ms;
+    while (std::chrono::steady_clock::now() < spin_end) {
+    }
+    ASSERT_EQ(Result::kSuccess, mrsCpuBudgetGetStatus(&status));
+  } while (status.quality > config.min_quality);
+  ASSERT_EQ(mrsBool::kTrue, status.running);
+  ASSERT_LT(0.0f, status.cpu_percent);
+  ASSERT_LE(2u, status.peer_connection_count);
+
+  // The budget is shared according to the weights
+  ASSERT_EQ(Result::kSuccess, mrsPeerConnectionGetCpuBudgetAllocation(
+                                  pc1.handle(), &allocation1));
+  ASSERT_EQ(Result::kSuccess, mrsPeerConnectionGetCpuBudgetAllocation(
+                                  pc2.handle(), &allocation2));
+  ASSERT_EQ(3.0f, allocation2.weight);
+  ASSERT_LE(config.min_quality, allocation1.quality);
+  ASSERT_LT(allocation1.quality, allocation2.quality);
+  ASSERT_GT(1.0f, allocation2.quality);
+
+  // Stopping restores full quality
+  ASSERT_EQ(Result::kSuccess, mrsCpuBudgetStop());
+  ASSERT_EQ(Result::kSuccess, mrsCpuBudgetGetStatus(&status));
+  ASSERT_EQ(mrsBool::kFalse, status.running);
+  ASSERT_EQ(Result::kSuccess, mrsPeerConnectionGetCpuBudgetAllocation(
+                                  pc2.handle(), &allocation2));
+  ASSERT_EQ(1.0f, allocation2.quality);
+}
+
+TEST_F(CpuBudgetTests, VideoSendLimits) {
+  LocalPeerPairRaii pair;
+
+  mrsExternalVideoTrackSourceHandle source_handle{};
+  ASSERT_EQ(Result::kSuccess,
+            mrsExternalVideoTrackSourceCreateFromI420ACallback(
+                &VideoTestUtils::MakeTestFrame, nullptr, &source_handle));
+  mrsExternalVideoTrackSourceFinishCreation(source_handle);
+  mrsLocalVideoTrackInitSettings settings{};
+  settings.track_name = "cpu_budget_video_track";
+  mrsLocalVideoTrackHandle track_handle{};
+  ASSERT_EQ(Result::kSuccess, mrsLocalVideoTrackCreateFromSource(
+                                  &settings, source_handle, &track_handle));
+  mrsTransceiverInitConfig transceiver_config{};
+  transceiver_config.name = "cpu_budget_video";
+  transceiver_config.media_kind = mrsMediaKind::kVideo;
+  mrsTransceiverHandle transceiver{};
+  ASSERT_EQ(Result::kSuccess,
+            mrsPeerConnectionAddTransceiver(pair.pc1(), &transceiver_config,
+                                            &transceiver));
+  ASSERT_EQ(Result::kSuccess,
+            mrsTransceiverSetLocalVideoTrack(transceiver, track_handle));
+  pair.ConnectAndWait();
+
+  // Degrade the quality until the limits are applied to the video sender
+  mrsCpuBudgetConfig config{};
+  config.target_cpu_percent = 0.001f;
+  config.interval_ms = 50;
+  config.min_quality = 0.2f;
+  ASSERT_EQ(Result::kSuccess, mrsCpuBudgetStart(&config));
+  mrsCpuBudgetAllocation allocation1{};
+  const auto deadline = std::chrono::steady_clock::now() + 30s;
+  do {
+    ASSERT_LT(std::chrono::steady_clock::now(), deadline);
+    const auto spin_end = std::chrono::steady_clock::now() + 20ms;
+    while (std::chrono::steady_clock::now() < spin_end) {
+    }
+    ASSERT_EQ(Result::kSuccess, mrsPeerConnectionGetCpuBudgetAllocation(
+                                    pair.pc1(), &allocation1));
+  } while (allocation1.quality > config.min_quality);
+  // Let the signaling thread apply the last allocation
+  std::this_thread::sleep_for(200ms);
+  ASSERT_EQ(Result::kSuccess, mrsPeerConnectionGetCpuBudgetAllocation(
+                                  pair.pc1(), &allocation1));
+  ASSERT_EQ(1u, allocation1.video_sender_count);
+  ASSERT_GT(1.0f, allocation1.quality);
+  ASSERT_LT(0, allocation1.max_bitrate_bps);
+  ASSERT_GT(config.max_bitrate_bps, allocation1.max_bitrate_bps);
+
+  // This version of WebRTC rejects the resolution limit with
+  // UNSUPPORTED_PARAMETER, but still applies the frame rate limit.
+  ASSERT_EQ(mrsBool::kFalse, allocation1.resolution_scaling_supported);
+  ASSERT_EQ(1.0, allocation1.scale_resolution_down_by);
+  ASSERT_EQ(mrsBool::kTrue, allocation1.framerate_limit_supported);
+  ASSERT_LT(0, allocation1.max_framerate);
+  ASSERT_GT(config.max_framerate, allocation1.max_framerate);
+
+  // The receiving peer has no video sender to limit
+  mrsCpuBudgetAllocation allocation2{};
+  ASSERT_EQ(Result::kSuccess, mrsPeerConnectionGetCpuBudgetAllocation(
+                                  pair.pc2(), &allocation2));
+  ASSERT_EQ(0u, allocation2.video_sender_count);
+
+  ASSERT_EQ(Result::kSuccess, mrsCpuBudgetStop());
+  mrsRefCountedObjectRemoveRef(track_handle);
+  mrsExternalVideoTrackSourceShutdown(source_handle);
+  mrsRefCountedObjectRemoveRef(source_handle);
+}
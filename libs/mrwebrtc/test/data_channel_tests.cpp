@@ -294,6 +294,24 @@ TEST_P(DataChannelTests, Send) {
               mrsDataChannelSendMessage(handle2, msg2_data, msg2_size));
     ASSERT_TRUE(ev_msg1.WaitFor(60s));
 
+    // Check performance counters
+    mrsObjectMetrics metrics1{};
+    ASSERT_EQ(Result::kSuccess, mrsDataChannelGetMetrics(handle1, &metrics1));
+    ASSERT_EQ(1u, metrics1.frames_out);
+    ASSERT_EQ(msg1_size, metrics1.bytes_sent);
+    ASSERT_EQ(1u, metrics1.frames_in);
+    ASSERT_EQ(msg2_size, metrics1.bytes_received);
+    ASSERT_EQ(1u, metrics1.callback_count);
+    ASSERT_EQ(0u, metrics1.frames_dropped);
+    mrsObjectMetrics metrics2{};
+    ASSERT_EQ(Result::kSuccess, mrsDataChannelGetMetrics(handle2, &metrics2));
+    ASSERT_EQ(1u, metrics2.frames_out);
+    ASSERT_EQ(msg2_size, metrics2.bytes_sent);
+    ASSERT_EQ(1u, metrics2.frames_in);
+    ASSERT_EQ(msg1_size, metrics2.bytes_received);
+    ASSERT_EQ(Result::kInvalidParameter,
+              mrsDataChannelGetMetrics(handle1, nullptr));
+
     ASSERT_EQ(Result::kSuccess,
               mrsPeerConnectionRemoveDataChannel(pair.pc1(), handle1));
     ASSERT_EQ(Result::kSuccess,
@@ -380,6 +398,9 @@ TEST_F(DataChannelTests, Send_InvalidHandle) {
   const uint64_t size = sizeof(msg);
   ASSERT_EQ(Result::kInvalidNativeHandle,
             mrsDataChannelSendMessage(nullptr, msg, size));
+  mrsObjectMetrics metrics{};
+  ASSERT_EQ(Result::kInvalidNativeHandle,
+            mrsDataChannelGetMetrics(nullptr, &metrics));
 }
 
 // NOTE - This test is flaky, relies on the send loop being faster than what the
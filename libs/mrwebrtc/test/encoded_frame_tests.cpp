@@ -0,0 +1,218 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+#include "pch.h"
+
+#include "encoded_frame_interop.h"
+#include "external_video_track_source_interop.h"
+#include "interop_api.h"
+#include "local_video_track_interop.h"
+#include "remote_video_track_interop.h"
+#include "transceiver_interop.h"
+
+#include "peer_connection_test_helpers.h"
+#include "test_utils.h"
+#include "video_test_utils.h"
+
+namespace {
+
+class EncodedFrameTests : public TestUtils::TestBase {};
+
+using VideoTrackAddedCallback =
+    InteropCallback<const mrsRemoteVideoTrackAddedInfo*>;
+using I420VideoFrameCallback = InteropCallback<const I420AVideoFrame&>;
+using EncodedVideoFrameCallback = InteropCallback<const mrsEncodedVideoFrame&>;
+
+/// Pair of connected peers sending a video track of a given name from the
+/// first peer to the second one.
+struct NamedVideoPair {
+  LocalPeerPairRaii pair;
+  mrsLocalVideoTrackHandle track_handle{};
+  mrsRemoteVideoTrackHandle remote_track{};
+  Event track_added;
+  VideoTrackAddedCallback track_added_cb;
+
+  void Connect(mrsExternalVideoTrackSourceHandle source_handle,
+               const char* track_name) {
+    mrsLocalVideoTrackInitSettings settings{};
+    settings.track_name = track_name;
+    ASSERT_EQ(mrsResult::kSuccess,
+              mrsLocalVideoTrackCreateFromSource(&settings, source_handle,
+                                                 &track_handle));
+    mrsTransceiverInitConfig transceiver_config{};
+    transceiver_config.name = "encoded_video";
+    transceiver_config.media_kind = mrsMediaKind::kVideo;
+    mrsTransceiverHandle transceiver{};
+    ASSERT_EQ(Result::kSuccess,
+              mrsPeerConnectionAddTransceiver(pair.pc1(), &transceiver_config,
+                                              &transceiver));
+    ASSERT_EQ(Result::kSuccess,
+              mrsTransceiverSetLocalVideoTrack(transceiver, track_handle));
+    track_added_cb = [this](const mrsRemoteVideoTrackAddedInfo* info) {
+      remote_track = info->track_handle;
+      track_added.Set();
+    };
+    mrsPeerConnectionRegisterVideoTrackAddedCallback(pair.pc2(),
+                                                     CB(track_added_cb));
+    pair.ConnectAndWait();
+    ASSERT_TRUE(track_added.WaitFor(5s));
+  }
+
+  ~NamedVideoPair() {
+    mrsPeerConnectionRegisterVideoTrackAddedCallback(pair.pc2(), nullptr,
+                                                     nullptr);
+    if (track_handle) {
+      mrsRefCountedObjectRemoveRef(track_handle);
+    }
+  }
+};
+
+}  // namespace
+
+TEST_F(EncodedFrameTests, InvalidParameters) {
+  ASSERT_EQ(Result::kInvalidNativeHandle,
+            mrsRemoteVideoTrackRegisterEncodedFrameCallback(nullptr, nullptr,
+                                                            nullptr));
+}
+
+TEST_F(EncodedFrameTests, ReceiveEncoded) {
+  LocalPeerPairRaii pair;
+
+  mrsExternalVideoTrackSourceHandle source_handle = nullptr;
+  ASSERT_EQ(mrsResult::kSuccess,
+            mrsExternalVideoTrackSourceCreateFromI420ACallback(
+                &VideoTestUtils::MakeTestFrame, nullptr, &source_handle));
+  mrsExternalVideoTrackSourceFinishCreation(source_handle);
+  mrsLocalVideoTrackHandle track_handle{};
+  mrsLocalVideoTrackInitSettings settings{};
+  settings.track_name = "encoded_video_track";
+  ASSERT_EQ(mrsResult::kSuccess, mrsLocalVideoTrackCreateFromSource(
+                                     &settings, source_handle, &track_handle));
+  mrsTransceiverInitConfig transceiver_config{};
+  transceiver_config.name = "encoded_video";
+  transceiver_config.media_kind = mrsMediaKind::kVideo;
+  mrsTransceiverHandle transceiver{};
+  ASSERT_EQ(Result::kSuccess,
+            mrsPeerConnectionAddTransceiver(pair.pc1(), &transceiver_config,
+                                            &transceiver));
+  ASSERT_EQ(Result::kSuccess,
+            mrsTransceiverSetLocalVideoTrack(transceiver, track_handle));
+
+  mrsRemoteVideoTrackHandle remote_track{};
+  Event track_added;
+  VideoTrackAddedCallback track_added_cb =
+      [&](const mrsRemoteVideoTrackAddedInfo* info) {
+        remote_track = info->track_handle;
+        track_added.Set();
+      };
+  mrsPeerConnectionRegisterVideoTrackAddedCallback(pair.pc2(),
+                                                   CB(track_added_cb));
+  pair.ConnectAndWait();
+  ASSERT_TRUE(track_added.WaitFor(5s));
+
+  // Receive the encoded frames only
+  std::atomic<uint32_t> encoded_count{0};
+  std::atomic<uint32_t> bad_frame_count{0};
+  uint32_t last_timestamp = 0;
+  EncodedVideoFrameCallback encoded_cb =
+      [&](const mrsEncodedVideoFrame& frame) {
+        if ((frame.codec != mrsVideoCodec::kVP8) || !frame.data ||
+            (frame.size == 0) ||
+            ((encoded_count > 0) && (frame.rtp_timestamp == last_timestamp))) {
+          ++bad_frame_count;
+        }
+        last_timestamp = frame.rtp_timestamp;
+        ++encoded_count;
+      };
+  ASSERT_EQ(Result::kSuccess, mrsRemoteVideoTrackRegisterEncodedFrameCallback(
+                                  remote_track, CB(encoded_cb)));
+  Event ev;
+  ev.WaitFor(2s);
+  ASSERT_LT(10u, encoded_count.load()) << "Expected at least 5 FPS";
+  ASSERT_EQ(0u, bad_frame_count.load());
+
+  // Decoding resumes when a raw frame callback is registered
+  std::atomic<uint32_t> decoded_count{0};
+  I420VideoFrameCallback frame_cb = [&](const I420AVideoFrame& frame) {
+    VideoTestUtils::CheckIsTestFrame(frame);
+    ++decoded_count;
+  };
+  mrsRemoteVideoTrackRegisterI420AFrameCallback(remote_track, CB(frame_cb));
+  ev.WaitFor(2s);
+  ASSERT_LT(5u, decoded_count.load());
+
+  // No callback is invoked once unregistered
+  ASSERT_EQ(Result::kSuccess, mrsRemoteVideoTrackRegisterEncodedFrameCallback(
+                                  remote_track, nullptr, nullptr));
+  const uint32_t count = encoded_count.load();
+  ev.WaitFor(500ms);
+  ASSERT_EQ(count, encoded_count.load());
+
+  mrsRemoteVideoTrackRegisterI420AFrameCallback(remote_track, nullptr,
+                                                nullptr);
+  mrsPeerConnectionRegisterVideoTrackAddedCallback(pair.pc2(), nullptr,
+                                                   nullptr);
+  mrsRefCountedObjectRemoveRef(track_handle);
+  mrsExternalVideoTrackSourceShutdown(source_handle);
+  mrsRefCountedObjectRemoveRef(source_handle);
+}
+
+TEST_F(EncodedFrameTests, SameTrackName) {
+  mrsExternalVideoTrackSourceHandle source_handle = nullptr;
+  ASSERT_EQ(mrsResult::kSuccess,
+            mrsExternalVideoTrackSourceCreateFromI420ACallback(
+                &VideoTestUtils::MakeTestFrame, nullptr, &source_handle));
+  mrsExternalVideoTrackSourceFinishCreation(source_handle);
+
+  {
+    // The remote tracks of both pairs have the same ID, which is usually the
+    // ID of the SDP stream their decoder is created for.
+    NamedVideoPair encoded_pair;
+    encoded_pair.Connect(source_handle, "camera");
+    NamedVideoPair decoded_pair;
+    decoded_pair.Connect(source_handle, "camera");
+
+    // The encoded frame callback only receives the frames of its own stream,
+    // whose RTP timestamps increase, unlike with the frames of both streams
+    // interleaved.
+    std::atomic<uint32_t> encoded_count{0};
+    std::atomic<uint32_t> bad_frame_count{0};
+    uint32_t last_timestamp = 0;
+    EncodedVideoFrameCallback encoded_cb =
+        [&](const mrsEncodedVideoFrame& frame) {
+          if ((encoded_count > 0) &&
+              (static_cast<int32_t>(frame.rtp_timestamp - last_timestamp) <=
+               0)) {
+            ++bad_frame_count;
+          }
+          last_timestamp = frame.rtp_timestamp;
+          ++encoded_count;
+        };
+    ASSERT_EQ(Result::kSuccess,
+              mrsRemoteVideoTrackRegisterEncodedFrameCallback(
+                  encoded_pair.remote_track, CB(encoded_cb)));
+
+    // The other track, with a raw frame callback only, is still decoded
+    std::atomic<uint32_t> decoded_count{0};
+    I420VideoFrameCallback frame_cb = [&](const I420AVideoFrame& frame) {
+      VideoTestUtils::CheckIsTestFrame(frame);
+      ++decoded_count;
+    };
+    mrsRemoteVideoTrackRegisterI420AFrameCallback(decoded_pair.remote_track,
+                                                  CB(frame_cb));
+    Event ev;
+    ev.WaitFor(2s);
+    ASSERT_LT(10u, encoded_count.load());
+    ASSERT_EQ(0u, bad_frame_count.load());
+    ASSERT_LT(10u, decoded_count.load());
+
+    ASSERT_EQ(Result::kSuccess,
+              mrsRemoteVideoTrackRegisterEncodedFrameCallback(
+                  encoded_pair.remote_track, nullptr, nullptr));
+    mrsRemoteVideoTrackRegisterI420AFrameCallback(decoded_pair.remote_track,
+                                                  nullptr, nullptr);
+  }
+
+  mrsExternalVideoTrackSourceShutdown(source_handle);
+  mrsRefCountedObjectRemoveRef(source_handle);
+}
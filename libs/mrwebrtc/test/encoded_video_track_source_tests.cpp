@@ -0,0 +1,191 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+#include "pch.h"
+
+#include "encoded_video_track_source_interop.h"
+#include "external_video_track_source_interop.h"
+#include "interop_api.h"
+#include "local_video_track_interop.h"
+#include "remote_video_track_interop.h"
+#include "transceiver_interop.h"
+
+#include "peer_connection_test_helpers.h"
+#include "test_utils.h"
+#include "video_test_utils.h"
+
+namespace {
+
+class EncodedVideoTrackSourceTests : public TestUtils::TestBase {};
+
+using VideoTrackAddedCallback =
+    InteropCallback<const mrsRemoteVideoTrackAddedInfo*>;
+using I420VideoFrameCallback = InteropCallback<const I420AVideoFrame&>;
+using EncodedVideoFrameCallback = InteropCallback<const mrsEncodedVideoFrame&>;
+using KeyFrameRequestedCallback = InteropCallback<>;
+
+/// Add a local video track to a new transceiver of a peer connection.
+void AddVideoTrack(mrsPeerConnectionHandle peer,
+                   mrsLocalVideoTrackHandle track) {
+  mrsTransceiverInitConfig transceiver_config{};
+  transceiver_config.name = "video";
+  transceiver_config.media_kind = mrsMediaKind::kVideo;
+  mrsTransceiverHandle transceiver{};
+  ASSERT_EQ(Result::kSuccess, mrsPeerConnectionAddTransceiver(
+                                  peer, &transceiver_config, &transceiver));
+  ASSERT_EQ(Result::kSuccess,
+            mrsTransceiverSetLocalVideoTrack(transceiver, track));
+}
+
+}  // namespace
+
+TEST_F(EncodedVideoTrackSourceTests, InvalidParameters) {
+  ASSERT_EQ(Result::kInvalidParameter,
+            mrsEncodedVideoTrackSourceCreate(nullptr, nullptr, nullptr));
+  mrsEncodedVideoFrame frame{};
+  ASSERT_EQ(Result::kInvalidNativeHandle,
+            mrsEncodedVideoTrackSourcePushFrame(nullptr, &frame, 0));
+
+  mrsEncodedVideoTrackSourceHandle source_handle{};
+  ASSERT_EQ(Result::kSuccess, mrsEncodedVideoTrackSourceCreate(
+                                  nullptr, nullptr, &source_handle));
+  ASSERT_NE(nullptr, source_handle);
+  ASSERT_EQ(Result::kInvalidParameter,
+            mrsEncodedVideoTrackSourcePushFrame(source_handle, nullptr, 0));
+  const uint8_t data[4]{};
+  frame.codec = mrsVideoCodec::kUnknown;
+  frame.data = data;
+  frame.size = sizeof(data);
+  ASSERT_EQ(Result::kInvalidParameter,
+            mrsEncodedVideoTrackSourcePushFrame(source_handle, &frame, 0));
+  // Key frames need a resolution
+  frame.codec = mrsVideoCodec::kVP8;
+  frame.is_key_frame = mrsBool::kTrue;
+  ASSERT_EQ(Result::kInvalidParameter,
+            mrsEncodedVideoTrackSourcePushFrame(source_handle, &frame, 0));
+  mrsRefCountedObjectRemoveRef(source_handle);
+}
+
+TEST_F(EncodedVideoTrackSourceTests, KeyFrameRequested) {
+  const uint8_t data[16]{};
+  mrsEncodedVideoFrame key_frame{};
+  key_frame.codec = mrsVideoCodec::kVP8;
+  key_frame.is_key_frame = mrsBool::kTrue;
+  key_frame.width = 320;
+  key_frame.height = 240;
+  key_frame.data = data;
+  key_frame.size = sizeof(data);
+  mrsEncodedVideoFrame delta_frame = key_frame;
+  delta_frame.is_key_frame = mrsBool::kFalse;
+
+  // Answer the requests by pushing a key frame from the callback itself
+  mrsEncodedVideoTrackSourceHandle source_handle{};
+  std::atomic<uint32_t> request_count{0};
+  KeyFrameRequestedCallback key_frame_requested_cb = [&]() {
+    ++request_count;
+    ASSERT_EQ(Result::kSuccess, mrsEncodedVideoTrackSourcePushFrame(
+                                    source_handle, &key_frame, 0));
+  };
+  ASSERT_EQ(Result::kSuccess,
+            mrsEncodedVideoTrackSourceCreate(CB(key_frame_requested_cb),
+                                             &source_handle));
+
+  // Delta frames before the first key frame cannot be sent
+  ASSERT_EQ(Result::kSuccess, mrsEncodedVideoTrackSourcePushFrame(
+                                  source_handle, &delta_frame, 0));
+  ASSERT_EQ(1u, request_count.load());
+
+  // The key frame pushed from the callback answered the request
+  ASSERT_EQ(Result::kSuccess, mrsEncodedVideoTrackSourcePushFrame(
+                                  source_handle, &delta_frame, 0));
+  ASSERT_EQ(1u, request_count.load());
+
+  mrsRefCountedObjectRemoveRef(source_handle);
+}
+
+TEST_F(EncodedVideoTrackSourceTests, SendEncoded) {
+  // Send the frames pushed to an encoded source from a first pair
+  mrsEncodedVideoTrackSourceHandle encoded_source{};
+  ASSERT_EQ(Result::kSuccess, mrsEncodedVideoTrackSourceCreate(
+                                  nullptr, nullptr, &encoded_source));
+  mrsLocalVideoTrackHandle encoded_track{};
+  mrsLocalVideoTrackInitSettings settings{};
+  settings.track_name = "encoded_video_track";
+  ASSERT_EQ(mrsResult::kSuccess,
+            mrsLocalVideoTrackCreateFromSource(&settings, encoded_source,
+                                               &encoded_track));
+  LocalPeerPairRaii sending_pair;
+  AddVideoTrack(sending_pair.pc1(), encoded_track);
+  mrsRemoteVideoTrackHandle sent_track{};
+  Event sent_track_added;
+  VideoTrackAddedCallback sent_track_added_cb =
+      [&](const mrsRemoteVideoTrackAddedInfo* info) {
+        sent_track = info->track_handle;
+        sent_track_added.Set();
+      };
+  mrsPeerConnectionRegisterVideoTrackAddedCallback(sending_pair.pc2(),
+                                                   CB(sent_track_added_cb));
+  sending_pair.ConnectAndWait();
+  ASSERT_TRUE(sent_track_added.WaitFor(5s));
+  std::atomic<uint32_t> decoded_count{0};
+  I420VideoFrameCallback frame_cb = [&](const I420AVideoFrame& frame) {
+    VideoTestUtils::CheckIsTestFrame(frame);
+    ++decoded_count;
+  };
+  mrsRemoteVideoTrackRegisterI420AFrameCallback(sent_track, CB(frame_cb));
+
+  // Produce the encoded frames by tapping the frames received by a second
+  // pair, from its very first key frame.
+  mrsExternalVideoTrackSourceHandle source_handle = nullptr;
+  ASSERT_EQ(mrsResult::kSuccess,
+            mrsExternalVideoTrackSourceCreateFromI420ACallback(
+                &VideoTestUtils::MakeTestFrame, nullptr, &source_handle));
+  mrsExternalVideoTrackSourceFinishCreation(source_handle);
+  mrsLocalVideoTrackHandle track_handle{};
+  settings.track_name = "raw_video_track";
+  ASSERT_EQ(mrsResult::kSuccess, mrsLocalVideoTrackCreateFromSource(
+                                     &settings, source_handle, &track_handle));
+  LocalPeerPairRaii encoding_pair;
+  AddVideoTrack(encoding_pair.pc1(), track_handle);
+  mrsRemoteVideoTrackHandle encoded_remote_track{};
+  std::atomic<uint32_t> pushed_count{0};
+  EncodedVideoFrameCallback encoded_cb =
+      [&](const mrsEncodedVideoFrame& frame) {
+        if (mrsEncodedVideoTrackSourcePushFrame(encoded_source, &frame,
+                                                frame.receive_time_ms) ==
+            Result::kSuccess) {
+          ++pushed_count;
+        }
+      };
+  Event track_added;
+  VideoTrackAddedCallback track_added_cb =
+      [&](const mrsRemoteVideoTrackAddedInfo* info) {
+        encoded_remote_track = info->track_handle;
+        ASSERT_EQ(Result::kSuccess,
+                  mrsRemoteVideoTrackRegisterEncodedFrameCallback(
+                      encoded_remote_track, CB(encoded_cb)));
+        track_added.Set();
+      };
+  mrsPeerConnectionRegisterVideoTrackAddedCallback(encoding_pair.pc2(),
+                                                   CB(track_added_cb));
+  encoding_pair.ConnectAndWait();
+  ASSERT_TRUE(track_added.WaitFor(5s));
+
+  Event ev;
+  ev.WaitFor(3s);
+  ASSERT_LT(10u, pushed_count.load()) << "Expected at least 5 FPS";
+  ASSERT_LT(10u, decoded_count.load()) << "Expected at least 5 FPS";
+
+  mrsRemoteVideoTrackRegisterEncodedFrameCallback(encoded_remote_track,
+                                                  nullptr, nullptr);
+  mrsRemoteVideoTrackRegisterI420AFrameCallback(sent_track, nullptr, nullptr);
+  mrsPeerConnectionRegisterVideoTrackAddedCallback(encoding_pair.pc2(),
+                                                   nullptr, nullptr);
+  mrsPeerConnectionRegisterVideoTrackAddedCallback(sending_pair.pc2(),
+                                                   nullptr, nullptr);
+  mrsRefCountedObjectRemoveRef(track_handle);
+  mrsExternalVideoTrackSourceShutdown(source_handle);
+  mrsRefCountedObjectRemoveRef(source_handle);
+  mrsRefCountedObjectRemoveRef(encoded_track);
+  mrsRefCountedObjectRemoveRef(encoded_source);
+}
@@ -0,0 +1,341 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+#include "pch.h"
+
+#include "event_queue_interop.h"
+#include "external_video_track_source_interop.h"
+#include "interop_api.h"
+#include "local_video_track_interop.h"
+
+#include "peer_connection_test_helpers.h"
+#include "test_utils.h"
+#include "video_test_utils.h"
+
+namespace {
+
+class EventQueueTests : public TestUtils::TestBase {
+ public:
+  void TearDown() override {
+    TestUtils::TestBase::TearDown();
+    // Restore direct delivery for the next tests
+    const mrsEventQueueConfig config{};
+    ASSERT_EQ(Result::kSuccess, mrsEventQueueSetConfig(&config));
+  }
+};
+
+/// One side of a connection, with the handles needed by its callbacks to
+/// signal the other side directly.
+struct TestPeer {
+  mrsPeerConnectionHandle self{};
+  mrsPeerConnectionHandle other{};
+  Event connected;
+};
+
+void MRS_CALL OnLocalSdpReady(void* user_data,
+                              mrsSdpMessageType type,
+                              const char* sdp_data) {
+  auto peer = static_cast<TestPeer*>(user_data);
+  Event ev;
+  ASSERT_EQ(Result::kSuccess, mrsPeerConnectionSetRemoteDescriptionAsync(
+                                  peer->other, type, sdp_data,
+                                  &TestUtils::SetEventOnCompleted, &ev));
+  ev.Wait();
+  if (type == mrsSdpMessageType::kOffer) {
+    ASSERT_EQ(Result::kSuccess, mrsPeerConnectionCreateAnswer(peer->other));
+  }
+}
+
+void MRS_CALL OnIceCandidate(void* user_data,
+                             const mrsIceCandidate* candidate) {
+  auto peer = static_cast<TestPeer*>(user_data);
+  ASSERT_EQ(Result::kSuccess,
+            mrsPeerConnectionAddIceCandidate(peer->other, candidate));
+}
+
+void MRS_CALL OnConnected(void* user_data) {
+  auto peer = static_cast<TestPeer*>(user_data);
+  peer->connected.Set();
+}
+
+void RegisterCallbacks(TestPeer& peer) {
+  mrsPeerConnectionRegisterLocalSdpReadytoSendCallback(
+      peer.self, &OnLocalSdpReady, &peer);
+  mrsPeerConnectionRegisterIceCandidateReadytoSendCallback(
+      peer.self, &OnIceCandidate, &peer);
+  mrsPeerConnectionRegisterConnectedCallback(peer.self, &OnConnected, &peer);
+}
+
+void UnregisterCallbacks(TestPeer& peer) {
+  mrsPeerConnectionRegisterLocalSdpReadytoSendCallback(peer.self, nullptr,
+                                                       nullptr);
+  mrsPeerConnectionRegisterIceCandidateReadytoSendCallback(peer.self, nullptr,
+                                                           nullptr);
+  mrsPeerConnectionRegisterConnectedCallback(peer.self, nullptr, nullptr);
+}
+
+/// Deliver a polled event to the same handlers used in dispatched mode.
+void DeliverEvent(const mrsEvent& event) {
+  auto peer = static_cast<TestPeer*>(event.user_data);
+  ASSERT_NE(nullptr, peer);
+  ASSERT_EQ(peer->self, event.object_handle);
+  switch (event.type) {
+    case mrsCallbackType::kLocalSdpReadyToSend:
+      OnLocalSdpReady(peer, static_cast<mrsSdpMessageType>(event.args[0]),
+                      static_cast<const char*>(event.data));
+      break;
+    case mrsCallbackType::kIceCandidateReadyToSend:
+      OnIceCandidate(peer, static_cast<const mrsIceCandidate*>(event.data));
+      break;
+    case mrsCallbackType::kConnected:
+      OnConnected(peer);
+      break;
+    default:
+      // Only the callbacks above are registered
+      FAIL() << "Unexpected event type " << static_cast<int>(event.type);
+  }
+}
+
+/// Frame callbacks never invoked in polled mode, only registered.
+void MRS_CALL OnI420AFrame(void*, const I420AVideoFrame&) {}
+void MRS_CALL OnArgb32Frame(void*, const Argb32VideoFrame&) {}
+
+/// External video source generating test frames, and local video track of
+/// that source.
+class TestVideoTrack {
+ public:
+  TestVideoTrack() {
+    EXPECT_EQ(Result::kSuccess,
+              mrsExternalVideoTrackSourceCreateFromI420ACallback(
+                  &VideoTestUtils::MakeTestFrame, nullptr, &source_));
+    mrsExternalVideoTrackSourceFinishCreation(source_);
+    mrsLocalVideoTrackInitSettings settings{};
+    settings.track_name = "queued_video_track";
+    EXPECT_EQ(Result::kSuccess,
+              mrsLocalVideoTrackCreateFromSource(&settings, source_, &track_));
+  }
+  ~TestVideoTrack() {
+    mrsRefCountedObjectRemoveRef(track_);
+    mrsExternalVideoTrackSourceShutdown(source_);
+    mrsRefCountedObjectRemoveRef(source_);
+  }
+  mrsLocalVideoTrackHandle track() const { return track_; }
+
+ private:
+  mrsExternalVideoTrackSourceHandle source_{};
+  mrsLocalVideoTrackHandle track_{};
+};
+
+/// Poll all pending events, checking that they all have the given type and
+/// user data. The events stay valid until the next poll.
+std::vector<mrsEvent> PollFrames(mrsCallbackType type, void* user_data) {
+  std::vector<mrsEvent> events(64);
+  uint32_t count = 0;
+  EXPECT_EQ(Result::kSuccess,
+            mrsPollEvents(events.data(), static_cast<uint32_t>(events.size()),
+                          &count));
+  events.resize(count);
+  for (auto&& event : events) {
+    EXPECT_EQ(type, event.type);
+    EXPECT_EQ(user_data, event.user_data);
+    EXPECT_NE(nullptr, event.data);
+  }
+  return events;
+}
+
+}  // namespace
+
+TEST_F(EventQueueTests, InvalidParameters) {
+  ASSERT_EQ(Result::kInvalidParameter, mrsEventQueueSetConfig(nullptr));
+  ASSERT_EQ(Result::kInvalidParameter, mrsEventQueueGetConfig(nullptr));
+  mrsEventQueueConfig config{};
+  config.mode = static_cast<mrsEventDeliveryMode>(3);
+  ASSERT_EQ(Result::kInvalidParameter, mrsEventQueueSetConfig(&config));
+  config.mode = mrsEventDeliveryMode::kDispatched;
+  config.dispatch_thread_count = 0;
+  ASSERT_EQ(Result::kInvalidParameter, mrsEventQueueSetConfig(&config));
+  config.dispatch_thread_count = 65;
+  ASSERT_EQ(Result::kInvalidParameter, mrsEventQueueSetConfig(&config));
+  config.dispatch_thread_count = 1;
+  config.max_pending_frames = 0;
+  ASSERT_EQ(Result::kInvalidParameter, mrsEventQueueSetConfig(&config));
+
+  // Polling is only valid in polled mode
+  mrsEvent events[4];
+  uint32_t count = 0;
+  ASSERT_EQ(Result::kInvalidOperation, mrsPollEvents(events, 4, &count));
+  config = mrsEventQueueConfig{};
+  config.mode = mrsEventDeliveryMode::kPolled;
+  ASSERT_EQ(Result::kSuccess, mrsEventQueueSetConfig(&config));
+  ASSERT_EQ(Result::kInvalidParameter, mrsPollEvents(events, 4, nullptr));
+  ASSERT_EQ(Result::kInvalidParameter, mrsPollEvents(nullptr, 4, &count));
+  ASSERT_EQ(Result::kSuccess, mrsPollEvents(nullptr, 0, &count));
+  ASSERT_EQ(0u, count);
+}
+
+TEST_F(EventQueueTests, SetGet) {
+  mrsEventQueueConfig config{};
+  config.mode = mrsEventDeliveryMode::kDispatched;
+  config.dispatch_thread_count = 3;
+  config.max_pending_frames = 8;
+  ASSERT_EQ(Result::kSuccess, mrsEventQueueSetConfig(&config));
+  mrsEventQueueConfig config2{};
+  ASSERT_EQ(Result::kSuccess, mrsEventQueueGetConfig(&config2));
+  ASSERT_EQ(config.mode, config2.mode);
+  ASSERT_EQ(config.dispatch_thread_count, config2.dispatch_thread_count);
+  ASSERT_EQ(config.max_pending_frames, config2.max_pending_frames);
+  ASSERT_EQ(0u, mrsEventQueueGetDroppedFrameCount());
+}
+
+TEST_F(EventQueueTests, ChangeWhileInitialized) {
+  PCRaii pc;
+  mrsEventQueueConfig config{};
+  config.mode = mrsEventDeliveryMode::kPolled;
+  ASSERT_EQ(Result::kInvalidOperation, mrsEventQueueSetConfig(&config));
+}
+
+TEST_F(EventQueueTests, PolledConnect) {
+  mrsEventQueueConfig config{};
+  config.mode = mrsEventDeliveryMode::kPolled;
+  ASSERT_EQ(Result::kSuccess, mrsEventQueueSetConfig(&config));
+
+  PCRaii pc1, pc2;
+  TestPeer peer1, peer2;
+  peer1.self = peer2.other = pc1.handle();
+  peer2.self = peer1.other = pc2.handle();
+  RegisterCallbacks(peer1);
+  RegisterCallbacks(peer2);
+
+  // All events are delivered on this thread, in batches
+  ASSERT_EQ(Result::kSuccess, mrsPeerConnectionCreateOffer(pc1.handle()));
+  const auto deadline = std::chrono::steady_clock::now() + 60s;
+  mrsEvent events[16];
+  while (!peer1.connected.IsSignaled() || !peer2.connected.IsSignaled()) {
+    ASSERT_LT(std::chrono::steady_clock::now(), deadline);
+    uint32_t count = 0;
+    ASSERT_EQ(Result::kSuccess, mrsPollEvents(events, 16, &count));
+    ASSERT_LE(count, 16u);
+    for (uint32_t i = 0; i < count; ++i) {
+      DeliverEvent(events[i]);
+    }
+    if (count == 0) {
+      std::this_thread::sleep_for(10ms);
+    }
+  }
+
+  UnregisterCallbacks(peer1);
+  UnregisterCallbacks(peer2);
+  uint32_t count = 0;
+  ASSERT_EQ(Result::kSuccess, mrsPollEvents(nullptr, 0, &count));
+}
+
+TEST_F(EventQueueTests, DispatchedConnect) {
+  mrsEventQueueConfig config{};
+  config.mode = mrsEventDeliveryMode::kDispatched;
+  config.dispatch_thread_count = 2;
+  ASSERT_EQ(Result::kSuccess, mrsEventQueueSetConfig(&config));
+
+  {
+    PCRaii pc1, pc2;
+    TestPeer peer1, peer2;
+    peer1.self = peer2.other = pc1.handle();
+    peer2.self = peer1.other = pc2.handle();
+    RegisterCallbacks(peer1);
+    RegisterCallbacks(peer2);
+
+    ASSERT_EQ(Result::kSuccess, mrsPeerConnectionCreateOffer(pc1.handle()));
+    ASSERT_TRUE(peer1.connected.WaitFor(60s));
+    ASSERT_TRUE(peer2.connected.WaitFor(60s));
+
+    // Ensure no event is still pending for the peers before destroying them
+    UnregisterCallbacks(peer1);
+    UnregisterCallbacks(peer2);
+    ASSERT_EQ(Result::kSuccess, mrsEventQueueFlush());
+  }
+}
+
+TEST_F(EventQueueTests, PolledI420AFrames) {
+  mrsEventQueueConfig config{};
+  config.mode = mrsEventDeliveryMode::kPolled;
+  config.max_pending_frames = 4;
+  ASSERT_EQ(Result::kSuccess, mrsEventQueueSetConfig(&config));
+  ASSERT_EQ(0u, mrsEventQueueGetDroppedFrameCount());
+
+  {
+    TestVideoTrack video;
+    int marker = 0;
+    mrsLocalVideoTrackRegisterI420AFrameCallback(video.track(), &OnI420AFrame,
+                                                 &marker);
+
+    // Let more frames than the queue can hold be produced
+    std::this_thread::sleep_for(500ms);
+    const std::vector<mrsEvent> events =
+        PollFrames(mrsCallbackType::kI420AVideoFrame, &marker);
+    ASSERT_EQ(config.max_pending_frames, events.size());
+    ASSERT_LT(0u, mrsEventQueueGetDroppedFrameCount());
+
+    // The planes are copied next to each other, keeping their strides
+    for (auto&& event : events) {
+      const auto& frame = *static_cast<const I420AVideoFrame*>(event.data);
+      VideoTestUtils::CheckIsTestFrame(frame);
+      const auto* const ydata = static_cast<const uint8_t*>(frame.ydata_);
+      const auto* const udata = static_cast<const uint8_t*>(frame.udata_);
+      ASSERT_EQ(ydata + frame.ystride_ * frame.height_, udata);
+      ASSERT_EQ(udata + frame.ustride_ * ((frame.height_ + 1) / 2),
+                frame.vdata_);
+      ASSERT_EQ(nullptr, frame.adata_);
+    }
+
+    // Draining the queue makes room for new frames
+    std::this_thread::sleep_for(100ms);
+    ASSERT_LT(0u,
+              PollFrames(mrsCallbackType::kI420AVideoFrame, &marker).size());
+
+    mrsLocalVideoTrackRegisterI420AFrameCallback(video.track(), nullptr,
+                                                 nullptr);
+    PollFrames(mrsCallbackType::kI420AVideoFrame, &marker);
+  }
+  uint32_t count = 0;
+  ASSERT_EQ(Result::kSuccess, mrsPollEvents(nullptr, 0, &count));
+}
+
+TEST_F(EventQueueTests, PolledArgb32Frames) {
+  mrsEventQueueConfig config{};
+  config.mode = mrsEventDeliveryMode::kPolled;
+  config.max_pending_frames = 2;
+  ASSERT_EQ(Result::kSuccess, mrsEventQueueSetConfig(&config));
+
+  {
+    TestVideoTrack video;
+    int marker = 0;
+    mrsLocalVideoTrackRegisterArgb32FrameCallback(video.track(),
+                                                  &OnArgb32Frame, &marker);
+
+    std::this_thread::sleep_for(500ms);
+    const std::vector<mrsEvent> events =
+        PollFrames(mrsCallbackType::kArgb32VideoFrame, &marker);
+    ASSERT_EQ(config.max_pending_frames, events.size());
+    ASSERT_LT(0u, mrsEventQueueGetDroppedFrameCount());
+
+    // The test frame is uniform, and so is its copy
+    for (auto&& event : events) {
+      const auto& frame = *static_cast<const Argb32VideoFrame*>(event.data);
+      ASSERT_EQ(16u, frame.width_);
+      ASSERT_EQ(16u, frame.height_);
+      ASSERT_LE(16 * 4, frame.stride_);
+      const auto* const data = static_cast<const uint8_t*>(frame.argb32_data_);
+      for (uint32_t y = 0; y < frame.height_; ++y) {
+        const uint8_t* const row = data + frame.stride_ * y;
+        for (uint32_t x = 0; x < frame.width_ * 4; ++x) {
+          ASSERT_EQ(data[x % 4], row[x]);
+        }
+      }
+    }
+
+    mrsLocalVideoTrackRegisterArgb32FrameCallback(video.track(), nullptr,
+                                                  nullptr);
+    PollFrames(mrsCallbackType::kArgb32VideoFrame, &marker);
+  }
+  uint32_t count = 0;
+  ASSERT_EQ(Result::kSuccess, mrsPollEvents(nullptr, 0, &count));
+}
@@ -0,0 +1,188 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+#include "pch.h"
+
+#include "external_video_track_source_interop.h"
+#include "interop_api.h"
+#include "local_video_track_interop.h"
+#include "remote_video_track_interop.h"
+#include "transceiver_interop.h"
+
+#include "test_utils.h"
+#include "video_test_utils.h"
+
+namespace {
+
+class FactoryShardTests : public TestUtils::TestBase {
+ public:
+  void TearDown() override {
+    TestUtils::TestBase::TearDown();
+    // Restore the default once the library is shut down
+    ASSERT_EQ(Result::kSuccess, mrsSetFactoryShardCount(1));
+  }
+};
+
+}  // namespace
+
+TEST_F(FactoryShardTests, InvalidParameters) {
+  ASSERT_EQ(Result::kInvalidParameter, mrsSetFactoryShardCount(0));
+  ASSERT_EQ(Result::kInvalidParameter, mrsSetFactoryShardCount(65));
+  ASSERT_EQ(1u, mrsGetFactoryShardCount());
+  uint32_t shard = 0;
+  ASSERT_EQ(Result::kInvalidNativeHandle,
+            mrsPeerConnectionGetFactoryShard(nullptr, &shard));
+}
+
+TEST_F(FactoryShardTests, ChangeWhileInitialized) {
+  ASSERT_EQ(Result::kSuccess, mrsSetFactoryShardCount(2));
+  ASSERT_EQ(2u, mrsGetFactoryShardCount());
+  mrsPeerConnectionConfiguration config{};
+  mrsPeerConnectionHandle handle{};
+  ASSERT_EQ(Result::kSuccess, mrsPeerConnectionCreate(&config, &handle));
+  ASSERT_NE(nullptr, handle);
+  ASSERT_EQ(Result::kInvalidOperation, mrsSetFactoryShardCount(3));
+  ASSERT_EQ(Result::kSuccess, mrsSetFactoryShardCount(2));
+  ASSERT_EQ(2u, mrsGetFactoryShardCount());
+  mrsRefCountedObjectRemoveRef(handle);
+}
+
+TEST_F(FactoryShardTests, ConnectAcrossShards) {
+  ASSERT_EQ(Result::kSuccess, mrsSetFactoryShardCount(2));
+  // Round-robin assignment places each peer on its own shard
+  mrsPeerConnectionConfiguration pc_config{};
+  pc_config.factory_shard = -1;
+  LocalPeerPairRaii pair(pc_config);
+  uint32_t shard1 = 0;
+  ASSERT_EQ(Result::kSuccess,
+            mrsPeerConnectionGetFactoryShard(pair.pc1(), &shard1));
+  uint32_t shard2 = 0;
+  ASSERT_EQ(Result::kSuccess,
+            mrsPeerConnectionGetFactoryShard(pair.pc2(), &shard2));
+  ASSERT_LT(shard1, 2u);
+  ASSERT_LT(shard2, 2u);
+  ASSERT_NE(shard1, shard2);
+  pair.ConnectAndWait();
+}
+
+namespace {
+
+// PeerConnectionVideoTrackAddedCallback
+using VideoTrackAddedCallback =
+    InteropCallback<const mrsRemoteVideoTrackAddedInfo*>;
+
+// mrsI420AVideoFrameCallback
+using I420VideoFrameCallback = InteropCallback<const I420AVideoFrame&>;
+
+/// Peer pair streaming video from the first peer to the second one.
+struct VideoPeerPair {
+  explicit VideoPeerPair(const mrsPeerConnectionConfiguration& config)
+      : pair_(config) {}
+
+  LocalPeerPairRaii pair_;
+  mrsTransceiverHandle transceiver_{};
+  mrsRemoteVideoTrackHandle remote_track_{};
+  Event track_added_;
+  VideoTrackAddedCallback track_added_cb_;
+  I420VideoFrameCallback frame_cb_;
+  std::atomic_uint32_t frame_count_{0};
+};
+
+}  // namespace
+
+// Benchmark of the media throughput with an increasing number of in-process
+// peer pairs, with and without sharding. Disabled by default due to its
+// duration; run with --gtest_also_run_disabled_tests.
+TEST_F(FactoryShardTests, DISABLED_Scaling) {
+  const uint32_t max_shard_count =
+      std::max(std::min(std::thread::hardware_concurrency() / 3, 16u), 2u);
+  const uint32_t kShardCounts[] = {1, max_shard_count};
+  const uint32_t kPairCounts[] = {1, 4, 16, 64};
+  for (uint32_t shard_count : kShardCounts) {
+    for (uint32_t pair_count : kPairCounts) {
+      ASSERT_EQ(Result::kSuccess, mrsSetFactoryShardCount(shard_count));
+
+      // Single video source shared by all pairs
+      mrsExternalVideoTrackSourceHandle source_handle = nullptr;
+      ASSERT_EQ(Result::kSuccess,
+                mrsExternalVideoTrackSourceCreateFromI420ACallback(
+                    &VideoTestUtils::MakeTestFrame, nullptr, &source_handle));
+      mrsExternalVideoTrackSourceFinishCreation(source_handle);
+      mrsLocalVideoTrackHandle track_handle{};
+      mrsLocalVideoTrackInitSettings settings{};
+      settings.track_name = "bench_track";
+      ASSERT_EQ(Result::kSuccess,
+                mrsLocalVideoTrackCreateFromSource(&settings, source_handle,
+                                                   &track_handle));
+
+      // Create and connect all pairs, placing both peers of a pair on the
+      // same shard
+      const auto connect_start = std::chrono::steady_clock::now();
+      std::vector<std::unique_ptr<VideoPeerPair>> pairs;
+      for (uint32_t i = 0; i < pair_count; ++i) {
+        mrsPeerConnectionConfiguration pc_config{};
+        pc_config.factory_shard = static_cast<int32_t>(i);
+        pairs.push_back(std::make_unique<VideoPeerPair>(pc_config));
+        VideoPeerPair& peers = *pairs.back();
+        peers.track_added_cb_ = [&peers](
+                                    const mrsRemoteVideoTrackAddedInfo* info) {
+          peers.remote_track_ = info->track_handle;
+          peers.track_added_.Set();
+        };
+        mrsPeerConnectionRegisterVideoTrackAddedCallback(
+            peers.pair_.pc2(), CB(peers.track_added_cb_));
+        mrsTransceiverInitConfig transceiver_config{};
+        transceiver_config.name = "video";
+        transceiver_config.media_kind = mrsMediaKind::kVideo;
+        ASSERT_EQ(Result::kSuccess, mrsPeerConnectionAddTransceiver(
+                                        peers.pair_.pc1(), &transceiver_config,
+                                        &peers.transceiver_));
+        ASSERT_EQ(Result::kSuccess, mrsTransceiverSetLocalVideoTrack(
+                                        peers.transceiver_, track_handle));
+        peers.pair_.ConnectAndWait();
+        ASSERT_TRUE(peers.track_added_.WaitFor(60s));
+        peers.frame_cb_ = [&peers](const I420AVideoFrame& /*frame*/) {
+          peers.frame_count_.fetch_add(1, std::memory_order_relaxed);
+        };
+        mrsRemoteVideoTrackRegisterI420AFrameCallback(peers.remote_track_,
+                                                      CB(peers.frame_cb_));
+      }
+      const auto connect_end = std::chrono::steady_clock::now();
+
+      // Measure the frame rate received by all pairs
+      for (auto&& peers : pairs) {
+        peers->frame_count_.store(0, std::memory_order_relaxed);
+      }
+      std::this_thread::sleep_for(3s);
+      uint32_t min_frames = UINT32_MAX;
+      uint64_t total_frames = 0;
+      for (auto&& peers : pairs) {
+        const uint32_t frames =
+            peers->frame_count_.load(std::memory_order_relaxed);
+        min_frames = std::min(min_frames, frames);
+        total_frames += frames;
+      }
+      const auto connect_ms =
+          std::chrono::duration_cast<std::chrono::milliseconds>(connect_end -
+                                                                connect_start)
+              .count();
+      const std::string prefix = "shards" + std::to_string(shard_count) +
+                                 "_pairs" + std::to_string(pair_count) + "_";
+      RecordProperty(prefix + "connect_ms", static_cast<int>(connect_ms));
+      RecordProperty(prefix + "avg_fps",
+                     static_cast<int>(total_frames / (3 * pair_count)));
+      RecordProperty(prefix + "min_fps", static_cast<int>(min_frames / 3));
+
+      // Clean-up
+      for (auto&& peers : pairs) {
+        mrsRemoteVideoTrackRegisterI420AFrameCallback(peers->remote_track_,
+                                                      nullptr, nullptr);
+      }
+      pairs.clear();
+      mrsRefCountedObjectRemoveRef(track_handle);
+      mrsExternalVideoTrackSourceShutdown(source_handle);
+      mrsRefCountedObjectRemoveRef(source_handle);
+      ASSERT_EQ(0u, mrsReportLiveObjects());
+    }
+  }
+}
@@ -0,0 +1,326 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+#include "pch.h"
+
+#include <thread>
+
+#include "encoded_frame_interop.h"
+#include "external_video_track_source_interop.h"
+#include "interop_api.h"
+#include "local_video_track_interop.h"
+#include "remote_video_track_interop.h"
+#include "transceiver_interop.h"
+
+#include "peer_connection_test_helpers.h"
+#include "test_utils.h"
+#include "video_test_utils.h"
+
+namespace {
+
+class KeyFrameRequestTests : public TestUtils::TestBase {};
+
+using VideoTrackAddedCallback =
+    InteropCallback<const mrsRemoteVideoTrackAddedInfo*>;
+using I420VideoFrameCallback = InteropCallback<const I420AVideoFrame&>;
+using EncodedVideoFrameCallback = InteropCallback<const mrsEncodedVideoFrame&>;
+
+/// Wait until the stats sampler of a peer connection reports at least the
+/// given number of completed key frame requests, and return its snapshot.
+mrsStatsSamplerSnapshot WaitForKeyFrames(mrsPeerConnectionHandle pc,
+                                         uint64_t completed) {
+  mrsStatsSamplerSnapshot snapshot{};
+  for (int i = 0; i < 50; ++i) {
+    EXPECT_EQ(Result::kSuccess,
+              mrsPeerConnectionGetStatsSnapshot(pc, &snapshot));
+    if (snapshot.key_frames_completed >= completed) {
+      break;
+    }
+    std::this_thread::sleep_for(100ms);
+  }
+  return snapshot;
+}
+
+}  // namespace
+
+TEST_F(KeyFrameRequestTests, InvalidParameters) {
+  ASSERT_EQ(Result::kInvalidNativeHandle,
+            mrsRemoteVideoTrackRequestKeyFrame(nullptr));
+  ASSERT_EQ(Result::kInvalidNativeHandle,
+            mrsLocalVideoTrackForceKeyFrame(nullptr));
+}
+
+TEST_F(KeyFrameRequestTests, ForceWithoutSender) {
+  mrsExternalVideoTrackSourceHandle source_handle = nullptr;
+  ASSERT_EQ(mrsResult::kSuccess,
+            mrsExternalVideoTrackSourceCreateFromI420ACallback(
+                &VideoTestUtils::MakeTestFrame, nullptr, &source_handle));
+  mrsExternalVideoTrackSourceFinishCreation(source_handle);
+  mrsLocalVideoTrackHandle track_handle{};
+  mrsLocalVideoTrackInitSettings settings{};
+  settings.track_name = "unsent_video_track";
+  ASSERT_EQ(mrsResult::kSuccess, mrsLocalVideoTrackCreateFromSource(
+                                     &settings, source_handle, &track_handle));
+
+  // No encoder would ever produce the key frame
+  ASSERT_EQ(Result::kInvalidOperation,
+            mrsLocalVideoTrackForceKeyFrame(track_handle));
+
+  mrsRefCountedObjectRemoveRef(track_handle);
+  mrsExternalVideoTrackSourceShutdown(source_handle);
+  mrsRefCountedObjectRemoveRef(source_handle);
+}
+
+TEST_F(KeyFrameRequestTests, RequestAndForce) {
+  LocalPeerPairRaii pair;
+
+  mrsExternalVideoTrackSourceHandle source_handle = nullptr;
+  ASSERT_EQ(mrsResult::kSuccess,
+            mrsExternalVideoTrackSourceCreateFromI420ACallback(
+                &VideoTestUtils::MakeTestFrame, nullptr, &source_handle));
+  mrsExternalVideoTrackSourceFinishCreation(source_handle);
+  mrsLocalVideoTrackHandle track_handle{};
+  mrsLocalVideoTrackInitSettings settings{};
+  settings.track_name = "key_frame_video_track";
+  ASSERT_EQ(mrsResult::kSuccess, mrsLocalVideoTrackCreateFromSource(
+                                     &settings, source_handle, &track_handle));
+  mrsTransceiverInitConfig transceiver_config{};
+  transceiver_config.name = "key_frame_video";
+  transceiver_config.media_kind = mrsMediaKind::kVideo;
+  mrsTransceiverHandle transceiver{};
+  ASSERT_EQ(Result::kSuccess,
+            mrsPeerConnectionAddTransceiver(pair.pc1(), &transceiver_config,
+                                            &transceiver));
+  ASSERT_EQ(Result::kSuccess,
+            mrsTransceiverSetLocalVideoTrack(transceiver, track_handle));
+
+  mrsRemoteVideoTrackHandle remote_track{};
+  Event track_added;
+  VideoTrackAddedCallback track_added_cb =
+      [&](const mrsRemoteVideoTrackAddedInfo* info) {
+        remote_track = info->track_handle;
+        track_added.Set();
+      };
+  mrsPeerConnectionRegisterVideoTrackAddedCallback(pair.pc2(),
+                                                   CB(track_added_cb));
+  pair.ConnectAndWait();
+  ASSERT_TRUE(track_added.WaitFor(5s));
+
+  std::atomic<uint32_t> decoded_count{0};
+  I420VideoFrameCallback frame_cb = [&](const I420AVideoFrame& frame) {
+    VideoTestUtils::CheckIsTestFrame(frame);
+    ++decoded_count;
+  };
+  mrsRemoteVideoTrackRegisterI420AFrameCallback(remote_track, CB(frame_cb));
+  std::atomic<uint32_t> key_frame_count{0};
+  EncodedVideoFrameCallback encoded_cb =
+      [&](const mrsEncodedVideoFrame& frame) {
+        if (frame.is_key_frame == mrsBool::kTrue) {
+          ++key_frame_count;
+        }
+      };
+  ASSERT_EQ(Result::kSuccess, mrsRemoteVideoTrackRegisterEncodedFrameCallback(
+                                  remote_track, CB(encoded_cb)));
+
+  mrsStatsSamplerConfig config{};
+  config.interval_ms = 100;
+  config.history_size = 8;
+  ASSERT_EQ(Result::kSuccess,
+            mrsPeerConnectionStartStatsSampler(pair.pc1(), &config));
+  ASSERT_EQ(Result::kSuccess,
+            mrsPeerConnectionStartStatsSampler(pair.pc2(), &config));
+  Event ev;
+  ev.WaitFor(1s);
+  ASSERT_LT(5u, decoded_count.load());
+
+  // Request a key frame from the receiver side
+  uint32_t count = key_frame_count.load();
+  ASSERT_EQ(Result::kSuccess, mrsRemoteVideoTrackRequestKeyFrame(remote_track));
+  mrsStatsSamplerSnapshot snapshot = WaitForKeyFrames(pair.pc2(), 1);
+  ASSERT_EQ(1u, snapshot.key_frames_requested);
+  ASSERT_EQ(1u, snapshot.key_frames_completed);
+  ASSERT_LT(count, key_frame_count.load());
+  // The key frame arrives at least one network round trip after the request
+  ASSERT_LT(0.0, snapshot.key_frame_delay_ms.max);
+
+  // Force a key frame from the sender side
+  count = key_frame_count.load();
+  ASSERT_EQ(Result::kSuccess, mrsLocalVideoTrackForceKeyFrame(track_handle));
+  snapshot = WaitForKeyFrames(pair.pc1(), 1);
+  ASSERT_EQ(1u, snapshot.key_frames_requested);
+  ASSERT_EQ(1u, snapshot.key_frames_completed);
+  ev.WaitFor(500ms);
+  ASSERT_LT(count, key_frame_count.load());
+
+  mrsRemoteVideoTrackRegisterEncodedFrameCallback(remote_track, nullptr,
+                                                  nullptr);
+  mrsRemoteVideoTrackRegisterI420AFrameCallback(remote_track, nullptr,
+                                                nullptr);
+  mrsPeerConnectionRegisterVideoTrackAddedCallback(pair.pc2(), nullptr,
+                                                   nullptr);
+  mrsRefCountedObjectRemoveRef(track_handle);
+  mrsExternalVideoTrackSourceShutdown(source_handle);
+  mrsRefCountedObjectRemoveRef(source_handle);
+}
+
+TEST_F(KeyFrameRequestTests, RequestFromEncodedCallback) {
+  LocalPeerPairRaii pair;
+
+  mrsExternalVideoTrackSourceHandle source_handle = nullptr;
+  ASSERT_EQ(mrsResult::kSuccess,
+            mrsExternalVideoTrackSourceCreateFromI420ACallback(
+                &VideoTestUtils::MakeTestFrame, nullptr, &source_handle));
+  mrsExternalVideoTrackSourceFinishCreation(source_handle);
+  mrsLocalVideoTrackHandle track_handle{};
+  mrsLocalVideoTrackInitSettings settings{};
+  settings.track_name = "key_frame_video_track";
+  ASSERT_EQ(mrsResult::kSuccess, mrsLocalVideoTrackCreateFromSource(
+                                     &settings, source_handle, &track_handle));
+  mrsTransceiverInitConfig transceiver_config{};
+  transceiver_config.name = "key_frame_video";
+  transceiver_config.media_kind = mrsMediaKind::kVideo;
+  mrsTransceiverHandle transceiver{};
+  ASSERT_EQ(Result::kSuccess,
+            mrsPeerConnectionAddTransceiver(pair.pc1(), &transceiver_config,
+                                            &transceiver));
+  ASSERT_EQ(Result::kSuccess,
+            mrsTransceiverSetLocalVideoTrack(transceiver, track_handle));
+
+  mrsRemoteVideoTrackHandle remote_track{};
+  Event track_added;
+  VideoTrackAddedCallback track_added_cb =
+      [&](const mrsRemoteVideoTrackAddedInfo* info) {
+        remote_track = info->track_handle;
+        track_added.Set();
+      };
+  mrsPeerConnectionRegisterVideoTrackAddedCallback(pair.pc2(),
+                                                   CB(track_added_cb));
+  pair.ConnectAndWait();
+  ASSERT_TRUE(track_added.WaitFor(5s));
+
+  // Request a key frame from the decoding thread, on the first delta frame,
+  // then wait for it on the same thread.
+  std::atomic<bool> requested{false};
+  Event key_frame_received;
+  EncodedVideoFrameCallback encoded_cb =
+      [&](const mrsEncodedVideoFrame& frame) {
+        if (frame.is_key_frame == mrsBool::kTrue) {
+          if (requested.load()) {
+            key_frame_received.Set();
+          }
+        } else if (!requested.exchange(true)) {
+          ASSERT_EQ(Result::kSuccess,
+                    mrsRemoteVideoTrackRequestKeyFrame(remote_track));
+        }
+      };
+  ASSERT_EQ(Result::kSuccess, mrsRemoteVideoTrackRegisterEncodedFrameCallback(
+                                  remote_track, CB(encoded_cb)));
+  ASSERT_TRUE(key_frame_received.WaitFor(5s));
+
+  // Unregister the callback from itself, which must not wait for the frame it
+  // is invoked for.
+  Event unregistered;
+  EncodedVideoFrameCallback unregister_cb =
+      [&](const mrsEncodedVideoFrame& /*frame*/) {
+        if (!unregistered.IsSignaled()) {
+          mrsRemoteVideoTrackRegisterEncodedFrameCallback(remote_track,
+                                                          nullptr, nullptr);
+          unregistered.Set();
+        }
+      };
+  ASSERT_EQ(Result::kSuccess, mrsRemoteVideoTrackRegisterEncodedFrameCallback(
+                                  remote_track, CB(unregister_cb)));
+  ASSERT_TRUE(unregistered.WaitFor(5s));
+
+  mrsPeerConnectionRegisterVideoTrackAddedCallback(pair.pc2(), nullptr,
+                                                   nullptr);
+  mrsRefCountedObjectRemoveRef(track_handle);
+  mrsExternalVideoTrackSourceShutdown(source_handle);
+  mrsRefCountedObjectRemoveRef(source_handle);
+}
+
+TEST_F(KeyFrameRequestTests, ForceSameSource) {
+  mrsExternalVideoTrackSourceHandle source_handle = nullptr;
+  ASSERT_EQ(mrsResult::kSuccess,
+            mrsExternalVideoTrackSourceCreateFromI420ACallback(
+                &VideoTestUtils::MakeTestFrame, nullptr, &source_handle));
+  mrsExternalVideoTrackSourceFinishCreation(source_handle);
+
+  // Two peer connections sending a track of the same source, which receive the
+  // very same frames.
+  LocalPeerPairRaii pairs[2];
+  mrsLocalVideoTrackHandle tracks[2]{};
+  mrsRemoteVideoTrackHandle remote_tracks[2]{};
+  std::atomic<uint32_t> key_frame_counts[2]{};
+  EncodedVideoFrameCallback encoded_cbs[2];
+  for (int i = 0; i < 2; ++i) {
+    mrsLocalVideoTrackInitSettings settings{};
+    settings.track_name = "shared_source_video_track";
+    ASSERT_EQ(mrsResult::kSuccess, mrsLocalVideoTrackCreateFromSource(
+                                       &settings, source_handle, &tracks[i]));
+    mrsTransceiverInitConfig transceiver_config{};
+    transceiver_config.name = "shared_source_video";
+    transceiver_config.media_kind = mrsMediaKind::kVideo;
+    mrsTransceiverHandle transceiver{};
+    ASSERT_EQ(Result::kSuccess,
+              mrsPeerConnectionAddTransceiver(
+                  pairs[i].pc1(), &transceiver_config, &transceiver));
+    ASSERT_EQ(Result::kSuccess,
+              mrsTransceiverSetLocalVideoTrack(transceiver, tracks[i]));
+
+    Event track_added;
+    VideoTrackAddedCallback track_added_cb =
+        [&](const mrsRemoteVideoTrackAddedInfo* info) {
+          remote_tracks[i] = info->track_handle;
+          track_added.Set();
+        };
+    mrsPeerConnectionRegisterVideoTrackAddedCallback(pairs[i].pc2(),
+                                                     CB(track_added_cb));
+    pairs[i].ConnectAndWait();
+    ASSERT_TRUE(track_added.WaitFor(5s));
+    mrsPeerConnectionRegisterVideoTrackAddedCallback(pairs[i].pc2(), nullptr,
+                                                     nullptr);
+
+    std::atomic<uint32_t>& key_frame_count = key_frame_counts[i];
+    encoded_cbs[i] = [&key_frame_count](const mrsEncodedVideoFrame& frame) {
+      if (frame.is_key_frame == mrsBool::kTrue) {
+        ++key_frame_count;
+      }
+    };
+    ASSERT_EQ(Result::kSuccess,
+              mrsRemoteVideoTrackRegisterEncodedFrameCallback(
+                  remote_tracks[i], CB(encoded_cbs[i])));
+  }
+
+  mrsStatsSamplerConfig config{};
+  config.interval_ms = 100;
+  config.history_size = 8;
+  ASSERT_EQ(Result::kSuccess,
+            mrsPeerConnectionStartStatsSampler(pairs[0].pc1(), &config));
+  ASSERT_EQ(Result::kSuccess,
+            mrsPeerConnectionStartStatsSampler(pairs[1].pc1(), &config));
+  Event ev;
+  ev.WaitFor(1s);
+
+  // Only the encoder of the first track produces the key frame
+  const uint32_t count0 = key_frame_counts[0].load();
+  const uint32_t count1 = key_frame_counts[1].load();
+  ASSERT_EQ(Result::kSuccess, mrsLocalVideoTrackForceKeyFrame(tracks[0]));
+  mrsStatsSamplerSnapshot snapshot = WaitForKeyFrames(pairs[0].pc1(), 1);
+  ASSERT_EQ(1u, snapshot.key_frames_requested);
+  ASSERT_EQ(1u, snapshot.key_frames_completed);
+  ev.WaitFor(500ms);
+  ASSERT_LT(count0, key_frame_counts[0].load());
+  ASSERT_EQ(count1, key_frame_counts[1].load());
+  ASSERT_EQ(Result::kSuccess,
+            mrsPeerConnectionGetStatsSnapshot(pairs[1].pc1(), &snapshot));
+  ASSERT_EQ(0u, snapshot.key_frames_requested);
+
+  for (int i = 0; i < 2; ++i) {
+    mrsRemoteVideoTrackRegisterEncodedFrameCallback(remote_tracks[i], nullptr,
+                                                    nullptr);
+    mrsRefCountedObjectRemoveRef(tracks[i]);
+  }
+  mrsExternalVideoTrackSourceShutdown(source_handle);
+  mrsRefCountedObjectRemoveRef(source_handle);
+}
@@ -5,8 +5,24 @@
 
 #include "external_video_track_source_interop.h"
 #include "interop_api.h"
+#include "peer_connection_test_helpers.h"
 #include "video_test_utils.h"
 
+namespace {
+
+struct InitContext {
+  Event completed;
+  mrsResult result{mrsResult::kUnknownError};
+};
+
+void MRS_CALL OnLibraryInitialized(void* user_data, mrsResult result) {
+  auto ctx = static_cast<InitContext*>(user_data);
+  ctx->result = result;
+  ctx->completed.Set();
+}
+
+}  // namespace
+
 TEST(LibraryTests, SetShutdownOptions) {
   ASSERT_EQ(0u, mrsReportLiveObjects());
   auto const initial_options = mrsGetShutdownOptions();
@@ -30,6 +46,33 @@ TEST(LibraryTests, ReportLiveObjects) {
   ASSERT_EQ(0u, mrsReportLiveObjects());
 }
 
+TEST(LibraryTests, ReportLiveObjectsOutOfOrder) {
+  ASSERT_EQ(0u, mrsReportLiveObjects());
+  constexpr uint32_t kCount = 40;
+  std::vector<mrsExternalVideoTrackSourceHandle> handles(kCount);
+  for (auto&& handle : handles) {
+    ASSERT_EQ(mrsResult::kSuccess,
+              mrsExternalVideoTrackSourceCreateFromI420ACallback(
+                  &VideoTestUtils::MakeTestFrame, nullptr, &handle));
+    ASSERT_NE(nullptr, handle);
+    mrsExternalVideoTrackSourceFinishCreation(handle);
+  }
+  ASSERT_EQ(kCount, mrsReportLiveObjects());
+
+  // Release every other object first, then the rest in reverse order, to
+  // remove objects from the middle and both ends of the registry lists.
+  uint32_t alive = kCount;
+  for (uint32_t i = 0; i < kCount; i += 2) {
+    mrsRefCountedObjectRemoveRef(handles[i]);
+    ASSERT_EQ(--alive, mrsReportLiveObjects());
+  }
+  for (uint32_t i = kCount; i > 0; i -= 2) {
+    mrsRefCountedObjectRemoveRef(handles[i - 1]);
+    ASSERT_EQ(--alive, mrsReportLiveObjects());
+  }
+  ASSERT_EQ(0u, alive);
+}
+
 TEST(LibraryTests, ForceShutdown) {
   // Disable kDebugBreakOnForceShutdown; debug break makes the test fail
   mrsSetShutdownOptions(mrsShutdownOptions::kNone);
@@ -44,3 +87,62 @@ TEST(LibraryTests, ForceShutdown) {
   mrsForceShutdown();
   ASSERT_EQ(0u, mrsReportLiveObjects());
 }
+
+TEST(LibraryTests, InitializeAsync) {
+  ASSERT_EQ(0u, mrsReportLiveObjects());
+  ASSERT_EQ(mrsResult::kInvalidParameter, mrsLibraryGetInitStats(nullptr));
+
+  InitContext ctx;
+  ASSERT_EQ(mrsResult::kSuccess,
+            mrsLibraryInitializeAsync(&OnLibraryInitialized, &ctx));
+  ASSERT_TRUE(ctx.completed.WaitFor(30s));
+  ASSERT_EQ(mrsResult::kSuccess, ctx.result);
+
+  // Report the start-up time of each phase in the test results
+  mrsLibraryInitStats stats{};
+  ASSERT_EQ(mrsResult::kSuccess, mrsLibraryGetInitStats(&stats));
+  ASSERT_EQ(mrsGetFactoryShardCount(), stats.shard_count);
+  ASSERT_LT(0, stats.total_us);
+  ASSERT_LE(stats.threads_us + stats.codec_factories_us +
+                stats.peer_connection_factory_us,
+            stats.total_us);
+  RecordProperty("init_threads_us", static_cast<int>(stats.threads_us));
+  RecordProperty("init_codec_factories_us",
+                 static_cast<int>(stats.codec_factories_us));
+  RecordProperty("init_pc_factory_us",
+                 static_cast<int>(stats.peer_connection_factory_us));
+  RecordProperty("init_total_us", static_cast<int>(stats.total_us));
+
+  // The library stays initialized without any object, so the shard count
+  // cannot change.
+  const uint32_t shard_count = mrsGetFactoryShardCount();
+  ASSERT_EQ(mrsResult::kInvalidOperation,
+            mrsSetFactoryShardCount(shard_count + 1));
+
+  // Once an object is created then released, the library shuts down as usual.
+  mrsExternalVideoTrackSourceHandle source_handle = nullptr;
+  ASSERT_EQ(mrsResult::kSuccess,
+            mrsExternalVideoTrackSourceCreateFromI420ACallback(
+                &VideoTestUtils::MakeTestFrame, nullptr, &source_handle));
+  ASSERT_NE(nullptr, source_handle);
+  mrsExternalVideoTrackSourceFinishCreation(source_handle);
+  mrsRefCountedObjectRemoveRef(source_handle);
+  ASSERT_EQ(0u, mrsReportLiveObjects());
+  ASSERT_EQ(mrsResult::kSuccess, mrsSetFactoryShardCount(shard_count + 1));
+  ASSERT_EQ(mrsResult::kSuccess, mrsSetFactoryShardCount(shard_count));
+}
+
+TEST(LibraryTests, InitializeAsyncForceShutdown) {
+  ASSERT_EQ(0u, mrsReportLiveObjects());
+  InitContext ctx;
+  ASSERT_EQ(mrsResult::kSuccess,
+            mrsLibraryInitializeAsync(&OnLibraryInitialized, &ctx));
+  ASSERT_TRUE(ctx.completed.WaitFor(30s));
+  ASSERT_EQ(mrsResult::kSuccess, ctx.result);
+
+  // The reference held until the first object is not reported as a leak
+  mrsForceShutdown();
+  const uint32_t shard_count = mrsGetFactoryShardCount();
+  ASSERT_EQ(mrsResult::kSuccess, mrsSetFactoryShardCount(shard_count + 1));
+  ASSERT_EQ(mrsResult::kSuccess, mrsSetFactoryShardCount(shard_count));
+}
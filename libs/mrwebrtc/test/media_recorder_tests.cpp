@@ -0,0 +1,370 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+#include "pch.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+#include "device_audio_track_source_interop.h"
+#include "external_video_track_source_interop.h"
+#include "interop_api.h"
+#include "local_audio_track_interop.h"
+#include "local_video_track_interop.h"
+#include "media_recorder_interop.h"
+#include "remote_audio_track_interop.h"
+#include "remote_video_track_interop.h"
+#include "transceiver_interop.h"
+
+#include "peer_connection_test_helpers.h"
+#include "test_utils.h"
+#include "video_test_utils.h"
+
+namespace {
+
+class MediaRecorderTests : public TestUtils::TestBase {};
+
+using VideoTrackAddedCallback =
+    InteropCallback<const mrsRemoteVideoTrackAddedInfo*>;
+
+std::string GetTempFilePath(const char* name) {
+  char dir[MAX_PATH + 1];
+  const DWORD size = GetTempPathA(MAX_PATH + 1, dir);
+  return std::string(dir, size) + name;
+}
+
+/// Read a whole file, or return an empty vector on error.
+std::vector<uint8_t> ReadFile(const std::string& path) {
+  std::vector<uint8_t> data;
+  FILE* const file = fopen(path.c_str(), "rb");
+  if (!file) {
+    return {};
+  }
+  uint8_t buffer[4096];
+  size_t size;
+  while ((size = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+    data.insert(data.end(), buffer, buffer + size);
+  }
+  fclose(file);
+  return data;
+}
+
+uint64_t ReadLE(const std::vector<uint8_t>& data, size_t pos, size_t size) {
+  uint64_t value = 0;
+  for (size_t i = size; i > 0; --i) {
+    value = (value << 8) | data[pos + i - 1];
+  }
+  return value;
+}
+
+uint64_t ReadBE(const std::vector<uint8_t>& data, size_t pos, size_t size) {
+  uint64_t value = 0;
+  for (size_t i = 0; i < size; ++i) {
+    value = (value << 8) | data[pos + i];
+  }
+  return value;
+}
+
+/// Read an EBML variable size integer, and advance past it. Element IDs keep
+/// their length marker, element sizes don't.
+bool ReadEbmlVint(const std::vector<uint8_t>& data,
+                  size_t& pos,
+                  bool is_id,
+                  uint64_t& value) {
+  if (pos >= data.size()) {
+    return false;
+  }
+  const uint8_t first = data[pos];
+  size_t length = 1;
+  while ((length <= 8) && !(first & (0x80 >> (length - 1)))) {
+    ++length;
+  }
+  if ((length > 8) || (pos + length > data.size())) {
+    return false;
+  }
+  value = (is_id ? first : (first & (0xFF >> length)));
+  for (size_t i = 1; i < length; ++i) {
+    value = (value << 8) | data[pos + i];
+  }
+  pos += length;
+  return true;
+}
+
+/// Check the frames of an IVF file against the frame count of its header and
+/// the number of frames recorded, and get the timestamp of the last frame.
+void CheckIvf(const std::vector<uint8_t>& data,
+              uint64_t frames_recorded,
+              uint64_t& last_time_ms) {
+  ASSERT_LE(32u, data.size());
+  ASSERT_EQ(frames_recorded, ReadLE(data, 24, 4));
+  uint64_t frame_count = 0;
+  size_t pos = 32;
+  while (pos < data.size()) {
+    ASSERT_LE(pos + 12, data.size());
+    const size_t size = static_cast<size_t>(ReadLE(data, pos, 4));
+    last_time_ms = ReadLE(data, pos + 4, 8);
+    pos += 12 + size;
+    ASSERT_LE(pos, data.size());
+    ++frame_count;
+  }
+  ASSERT_EQ(frames_recorded, frame_count);
+}
+
+/// Check the blocks of a WebM file against the number of frames recorded, and
+/// get the duration of its segment.
+void CheckWebM(const std::vector<uint8_t>& data,
+               uint64_t frames_recorded,
+               double& duration_ms) {
+  uint64_t block_count = 0;
+  duration_ms = -1.0;
+  size_t pos = 0;
+  while (pos < data.size()) {
+    uint64_t id = 0;
+    uint64_t size = 0;
+    ASSERT_TRUE(ReadEbmlVint(data, pos, true, id));
+    ASSERT_TRUE(ReadEbmlVint(data, pos, false, size));
+    if ((id == 0x18538067) || (id == 0x1549A966) || (id == 0x1F43B675)) {
+      // Segment, Info and Cluster; parse their children
+      continue;
+    }
+    ASSERT_LE(size, data.size() - pos);
+    if (id == 0x4489) {  // Duration
+      ASSERT_EQ(8u, size);
+      const uint64_t bits = ReadBE(data, pos, 8);
+      memcpy(&duration_ms, &bits, sizeof(bits));
+    } else if (id == 0xA3) {  // SimpleBlock
+      ++block_count;
+    }
+    pos += static_cast<size_t>(size);
+  }
+  ASSERT_EQ(frames_recorded, block_count);
+}
+
+void RecordVideo(mrsVideoContainer container,
+                 const std::string& path,
+                 const std::vector<uint8_t>& magic) {
+  LocalPeerPairRaii pair;
+
+  mrsExternalVideoTrackSourceHandle source_handle = nullptr;
+  ASSERT_EQ(mrsResult::kSuccess,
+            mrsExternalVideoTrackSourceCreateFromI420ACallback(
+                &VideoTestUtils::MakeTestFrame, nullptr, &source_handle));
+  mrsExternalVideoTrackSourceFinishCreation(source_handle);
+  mrsLocalVideoTrackHandle track_handle{};
+  mrsLocalVideoTrackInitSettings settings{};
+  settings.track_name = "recorded_video_track";
+  ASSERT_EQ(mrsResult::kSuccess, mrsLocalVideoTrackCreateFromSource(
+                                     &settings, source_handle, &track_handle));
+  mrsTransceiverInitConfig transceiver_config{};
+  transceiver_config.name = "recorded_video";
+  transceiver_config.media_kind = mrsMediaKind::kVideo;
+  mrsTransceiverHandle transceiver{};
+  ASSERT_EQ(Result::kSuccess,
+            mrsPeerConnectionAddTransceiver(pair.pc1(), &transceiver_config,
+                                            &transceiver));
+  ASSERT_EQ(Result::kSuccess,
+            mrsTransceiverSetLocalVideoTrack(transceiver, track_handle));
+
+  mrsRemoteVideoTrackHandle remote_track{};
+  Event track_added;
+  VideoTrackAddedCallback track_added_cb =
+      [&](const mrsRemoteVideoTrackAddedInfo* info) {
+        remote_track = info->track_handle;
+        track_added.Set();
+      };
+  mrsPeerConnectionRegisterVideoTrackAddedCallback(pair.pc2(),
+                                                   CB(track_added_cb));
+  pair.ConnectAndWait();
+  ASSERT_TRUE(track_added.WaitFor(5s));
+
+  // Use a small buffer to exercise the writes during the recording
+  mrsMediaRecorderConfig config{};
+  config.write_buffer_size = 16 * 1024;
+  config.sync_interval_ms = 500;
+  mrsMediaRecorderHandle recorder{};
+  const auto start_time = std::chrono::steady_clock::now();
+  ASSERT_EQ(Result::kSuccess, mrsMediaRecorderCreate(&config, &recorder));
+  ASSERT_EQ(Result::kSuccess, mrsMediaRecorderAddVideoTrack(
+                                  recorder, remote_track, path.c_str(),
+                                  container));
+  Event ev;
+  ev.WaitFor(3s);
+  ASSERT_EQ(Result::kSuccess, mrsMediaRecorderStop(recorder));
+  const int64_t recording_ms =
+      std::chrono::duration_cast<std::chrono::milliseconds>(
+          std::chrono::steady_clock::now() - start_time)
+          .count();
+
+  mrsMediaRecorderStats stats{};
+  ASSERT_EQ(Result::kSuccess, mrsMediaRecorderGetStats(recorder, &stats));
+  ASSERT_LT(10u, stats.video_frames_recorded);
+  ASSERT_LT(0u, stats.bytes_written);
+  ASSERT_EQ(0u, stats.write_errors);
+  const std::vector<uint8_t> data = ReadFile(path);
+  ASSERT_LE(magic.size(), data.size());
+  ASSERT_TRUE(std::equal(magic.begin(), magic.end(), data.begin()));
+
+  // The sizes patched when stopping match the frames recorded, and the last
+  // frame is timestamped about the recording length, minus the wait for the
+  // first key frame.
+  int64_t length_ms = 0;
+  if (container == mrsVideoContainer::kIvf) {
+    uint64_t last_time_ms = 0;
+    CheckIvf(data, stats.video_frames_recorded, last_time_ms);
+    length_ms = static_cast<int64_t>(last_time_ms);
+  } else {
+    double duration_ms = 0.0;
+    CheckWebM(data, stats.video_frames_recorded, duration_ms);
+    length_ms = static_cast<int64_t>(duration_ms);
+  }
+  ASSERT_LE(recording_ms - 1000, length_ms);
+  ASSERT_GE(recording_ms, length_ms);
+
+  // Stopped recorders cannot record anymore
+  ASSERT_EQ(Result::kInvalidOperation,
+            mrsMediaRecorderAddVideoTrack(recorder, remote_track, path.c_str(),
+                                          container));
+
+  mrsRefCountedObjectRemoveRef(recorder);
+  mrsPeerConnectionRegisterVideoTrackAddedCallback(pair.pc2(), nullptr,
+                                                   nullptr);
+  mrsRefCountedObjectRemoveRef(track_handle);
+  mrsExternalVideoTrackSourceShutdown(source_handle);
+  mrsRefCountedObjectRemoveRef(source_handle);
+  remove(path.c_str());
+}
+
+}  // namespace
+
+TEST_F(MediaRecorderTests, InvalidParameters) {
+  mrsMediaRecorderConfig config{};
+  mrsMediaRecorderHandle recorder{};
+  ASSERT_EQ(Result::kInvalidParameter,
+            mrsMediaRecorderCreate(nullptr, &recorder));
+  ASSERT_EQ(Result::kInvalidParameter,
+            mrsMediaRecorderCreate(&config, nullptr));
+  ASSERT_EQ(Result::kInvalidNativeHandle,
+            mrsMediaRecorderAddVideoTrack(nullptr, nullptr, "a.ivf",
+                                          mrsVideoContainer::kIvf));
+  ASSERT_EQ(Result::kInvalidNativeHandle,
+            mrsMediaRecorderAddAudioTrack(nullptr, nullptr, "a.wav"));
+  ASSERT_EQ(Result::kInvalidNativeHandle, mrsMediaRecorderStop(nullptr));
+  mrsMediaRecorderStats stats{};
+  ASSERT_EQ(Result::kInvalidNativeHandle,
+            mrsMediaRecorderGetStats(nullptr, &stats));
+
+  ASSERT_EQ(Result::kSuccess, mrsMediaRecorderCreate(&config, &recorder));
+  ASSERT_EQ(Result::kInvalidParameter,
+            mrsMediaRecorderAddVideoTrack(recorder, nullptr, nullptr,
+                                          mrsVideoContainer::kIvf));
+  ASSERT_EQ(Result::kInvalidParameter,
+            mrsMediaRecorderGetStats(recorder, nullptr));
+  ASSERT_EQ(Result::kSuccess, mrsMediaRecorderGetStats(recorder, &stats));
+  ASSERT_EQ(0u, stats.bytes_written);
+  ASSERT_EQ(Result::kSuccess, mrsMediaRecorderStop(recorder));
+  ASSERT_EQ(Result::kSuccess, mrsMediaRecorderStop(recorder));
+  mrsRefCountedObjectRemoveRef(recorder);
+}
+
+TEST_F(MediaRecorderTests, RecordIvf) {
+  RecordVideo(mrsVideoContainer::kIvf, GetTempFilePath("mrs_recorder.ivf"),
+              {'D', 'K', 'I', 'F'});
+}
+
+TEST_F(MediaRecorderTests, RecordWebM) {
+  RecordVideo(mrsVideoContainer::kWebM, GetTempFilePath("mrs_recorder.webm"),
+              {0x1A, 0x45, 0xDF, 0xA3});
+}
+
+#if !defined(MRSW_EXCLUDE_DEVICE_TESTS)
+
+TEST_F(MediaRecorderTests, RecordWav) {
+  LocalPeerPairRaii pair;
+
+  // The tree has no external audio source, so send the microphone instead
+  mrsLocalAudioDeviceInitConfig device_config{};
+  mrsDeviceAudioTrackSourceHandle audio_source{};
+  ASSERT_EQ(Result::kSuccess,
+            mrsDeviceAudioTrackSourceCreate(&device_config, &audio_source));
+  mrsLocalAudioTrackInitSettings init_settings{};
+  init_settings.track_name = "recorded_audio_track";
+  mrsLocalAudioTrackHandle local_track{};
+  ASSERT_EQ(Result::kSuccess,
+            mrsLocalAudioTrackCreateFromSource(&init_settings, audio_source,
+                                               &local_track));
+  mrsTransceiverInitConfig transceiver_config{};
+  transceiver_config.name = "recorded_audio";
+  transceiver_config.media_kind = mrsMediaKind::kAudio;
+  mrsTransceiverHandle transceiver{};
+  ASSERT_EQ(Result::kSuccess,
+            mrsPeerConnectionAddTransceiver(pair.pc1(), &transceiver_config,
+                                            &transceiver));
+  ASSERT_EQ(Result::kSuccess,
+            mrsTransceiverSetLocalAudioTrack(transceiver, local_track));
+
+  mrsRemoteAudioTrackHandle remote_track{};
+  Event track_added;
+  InteropCallback<const mrsRemoteAudioTrackAddedInfo*> track_added_cb =
+      [&](const mrsRemoteAudioTrackAddedInfo* info) {
+        remote_track = info->track_handle;
+        track_added.Set();
+      };
+  mrsPeerConnectionRegisterAudioTrackAddedCallback(pair.pc2(),
+                                                   CB(track_added_cb));
+  pair.ConnectAndWait();
+  ASSERT_TRUE(track_added.WaitFor(5s));
+  mrsPeerConnectionRegisterAudioTrackAddedCallback(pair.pc2(), nullptr,
+                                                   nullptr);
+
+  const std::string path = GetTempFilePath("mrs_recorder.wav");
+  mrsMediaRecorderConfig config{};
+  config.write_buffer_size = 16 * 1024;
+  mrsMediaRecorderHandle recorder{};
+  const auto start_time = std::chrono::steady_clock::now();
+  ASSERT_EQ(Result::kSuccess, mrsMediaRecorderCreate(&config, &recorder));
+  ASSERT_EQ(Result::kSuccess, mrsMediaRecorderAddAudioTrack(
+                                  recorder, remote_track, path.c_str()));
+  Event ev;
+  ev.WaitFor(3s);
+  ASSERT_EQ(Result::kSuccess, mrsMediaRecorderStop(recorder));
+  const int64_t recording_ms =
+      std::chrono::duration_cast<std::chrono::milliseconds>(
+          std::chrono::steady_clock::now() - start_time)
+          .count();
+
+  mrsMediaRecorderStats stats{};
+  ASSERT_EQ(Result::kSuccess, mrsMediaRecorderGetStats(recorder, &stats));
+  ASSERT_LT(0u, stats.audio_samples_recorded);
+  ASSERT_EQ(0u, stats.write_errors);
+  mrsRefCountedObjectRemoveRef(recorder);
+
+  // The sizes patched when stopping match the samples recorded, which span the
+  // recording from its start, including the leading silence.
+  const std::vector<uint8_t> data = ReadFile(path);
+  ASSERT_LE(44u, data.size());
+  ASSERT_EQ(0, memcmp(data.data(), "RIFF", 4));
+  ASSERT_EQ(0, memcmp(data.data() + 8, "WAVEfmt ", 8));
+  ASSERT_EQ(0, memcmp(data.data() + 36, "data", 4));
+  ASSERT_EQ(1u, ReadLE(data, 20, 2));   // PCM
+  ASSERT_EQ(16u, ReadLE(data, 34, 2));  // bits per sample
+  const uint64_t channel_count = ReadLE(data, 22, 2);
+  const uint64_t sample_rate = ReadLE(data, 24, 4);
+  ASSERT_LT(0u, channel_count);
+  ASSERT_LT(0u, sample_rate);
+  ASSERT_EQ(data.size() - 8, ReadLE(data, 4, 4));
+  ASSERT_EQ(data.size() - 44, ReadLE(data, 40, 4));
+  ASSERT_EQ(stats.audio_samples_recorded * channel_count * 2,
+            data.size() - 44);
+  const int64_t length_ms =
+      static_cast<int64_t>(stats.audio_samples_recorded * 1000 / sample_rate);
+  ASSERT_LE(recording_ms - 500, length_ms);
+  ASSERT_GE(recording_ms, length_ms);
+
+  mrsRefCountedObjectRemoveRef(local_track);
+  mrsRefCountedObjectRemoveRef(audio_source);
+  remove(path.c_str());
+}
+
+#endif  // !defined(MRSW_EXCLUDE_DEVICE_TESTS)
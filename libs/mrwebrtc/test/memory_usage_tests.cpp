@@ -0,0 +1,385 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+#include "pch.h"
+
+#include "data_channel_interop.h"
+#include "device_audio_track_source_interop.h"
+#include "event_queue_interop.h"
+#include "external_video_track_source_interop.h"
+#include "interop_api.h"
+#include "local_audio_track_interop.h"
+#include "local_video_track_interop.h"
+#include "memory_usage_interop.h"
+#include "remote_audio_track_interop.h"
+#include "remote_video_track_interop.h"
+#include "transceiver_interop.h"
+
+#include "peer_connection_test_helpers.h"
+#include "test_utils.h"
+#include "video_test_utils.h"
+
+namespace {
+
+class MemoryUsageTests : public TestUtils::TestBase {
+ public:
+  void TearDown() override {
+    TestUtils::TestBase::TearDown();
+    ASSERT_EQ(Result::kSuccess, mrsSetMemoryBudget(0, nullptr, nullptr));
+    const mrsEventQueueConfig config{};
+    ASSERT_EQ(Result::kSuccess, mrsEventQueueSetConfig(&config));
+  }
+};
+
+struct BudgetState {
+  mrsPeerConnectionHandle peer_handle{};
+  uint64_t total_bytes{};
+  /// Usage of the exceeded account when the callback was invoked.
+  mrsMemoryUsage usage{};
+  /// Disable the budget from the callback.
+  bool disable_budget{false};
+  Event exceeded;
+};
+
+void MRS_CALL OnBudgetExceeded(void* user_data,
+                               mrsPeerConnectionHandle peer_handle,
+                               uint64_t total_bytes) {
+  auto state = static_cast<BudgetState*>(user_data);
+  if (state->exceeded.IsSignaled()) {
+    return;
+  }
+  state->peer_handle = peer_handle;
+  state->total_bytes = total_bytes;
+  if (peer_handle) {
+    mrsPeerConnectionGetMemoryUsage(peer_handle, &state->usage);
+  } else {
+    mrsGetMemoryUsage(&state->usage);
+  }
+  if (state->disable_budget) {
+    if (peer_handle) {
+      mrsPeerConnectionSetMemoryBudget(peer_handle, 0, nullptr, nullptr);
+    } else {
+      mrsSetMemoryBudget(0, nullptr, nullptr);
+    }
+  }
+  state->exceeded.Set();
+}
+
+void MRS_CALL OnLocalSdpReady(void* /*user_data*/,
+                              mrsSdpMessageType /*type*/,
+                              const char* /*sdp_data*/) {}
+
+using VideoTrackAddedCallback =
+    InteropCallback<const mrsRemoteVideoTrackAddedInfo*>;
+using AudioTrackAddedCallback =
+    InteropCallback<const mrsRemoteAudioTrackAddedInfo*>;
+using Argb32VideoFrameCallback = InteropCallback<const mrsArgb32VideoFrame&>;
+using DataMessageCallback = InteropCallback<const void*, const uint64_t>;
+using DataStateCallback = InteropCallback<mrsDataChannelState, int32_t>;
+
+}  // namespace
+
+TEST_F(MemoryUsageTests, InvalidParameters) {
+  ASSERT_EQ(Result::kInvalidParameter, mrsGetMemoryUsage(nullptr));
+  mrsMemoryUsage usage{};
+  ASSERT_EQ(Result::kInvalidNativeHandle,
+            mrsPeerConnectionGetMemoryUsage(nullptr, &usage));
+  ASSERT_EQ(Result::kInvalidNativeHandle,
+            mrsPeerConnectionSetMemoryBudget(nullptr, 1024, &OnBudgetExceeded,
+                                             nullptr));
+  PCRaii pc;
+  ASSERT_EQ(Result::kInvalidParameter,
+            mrsPeerConnectionGetMemoryUsage(pc.handle(), nullptr));
+}
+
+TEST_F(MemoryUsageTests, PeerConnectionUsage) {
+  PCRaii pc;
+  mrsMemoryUsage usage{};
+  ASSERT_EQ(Result::kSuccess,
+            mrsPeerConnectionGetMemoryUsage(pc.handle(), &usage));
+  // A new peer connection has no remote track nor data channel yet
+  ASSERT_EQ(0u, usage.total_bytes);
+  ASSERT_EQ(Result::kSuccess, mrsPeerConnectionSetMemoryBudget(
+                                  pc.handle(), 1024, &OnBudgetExceeded,
+                                  nullptr));
+  ASSERT_EQ(Result::kSuccess,
+            mrsPeerConnectionSetMemoryBudget(pc.handle(), 0, nullptr, nullptr));
+}
+
+TEST_F(MemoryUsageTests, EventQueueBudget) {
+  mrsEventQueueConfig config{};
+  config.mode = mrsEventDeliveryMode::kPolled;
+  ASSERT_EQ(Result::kSuccess, mrsEventQueueSetConfig(&config));
+
+  // Any queued event exceeds the process-wide budget
+  mrsMemoryUsage usage{};
+  ASSERT_EQ(Result::kSuccess, mrsGetMemoryUsage(&usage));
+  const uint64_t event_queue_bytes = usage.event_queue_bytes;
+  BudgetState state;
+  ASSERT_EQ(Result::kSuccess,
+            mrsSetMemoryBudget(std::max<uint64_t>(usage.total_bytes, 1),
+                               &OnBudgetExceeded, &state));
+
+  PCRaii pc;
+  mrsPeerConnectionRegisterLocalSdpReadytoSendCallback(
+      pc.handle(), &OnLocalSdpReady, nullptr);
+  ASSERT_EQ(Result::kSuccess, mrsPeerConnectionCreateOffer(pc.handle()));
+  ASSERT_TRUE(state.exceeded.WaitFor(60s));
+  ASSERT_EQ(nullptr, state.peer_handle);
+  ASSERT_LT(usage.total_bytes, state.total_bytes);
+
+  // The offer is charged while pending, and released once polled
+  ASSERT_EQ(Result::kSuccess, mrsGetMemoryUsage(&usage));
+  ASSERT_LT(event_queue_bytes, usage.event_queue_bytes);
+  mrsPeerConnectionRegisterLocalSdpReadytoSendCallback(pc.handle(), nullptr,
+                                                       nullptr);
+  mrsEvent events[16];
+  uint32_t count = 0;
+  do {
+    ASSERT_EQ(Result::kSuccess, mrsPollEvents(events, 16, &count));
+  } while (count > 0);
+  ASSERT_EQ(Result::kSuccess, mrsPollEvents(nullptr, 0, &count));
+  ASSERT_EQ(Result::kSuccess, mrsGetMemoryUsage(&usage));
+  ASSERT_EQ(event_queue_bytes, usage.event_queue_bytes);
+}
+
+TEST_F(MemoryUsageTests, ConnectedPeerUsage) {
+  LocalPeerPairRaii pair;
+
+  // Send the frames of an external source from #1 to #2
+  mrsExternalVideoTrackSourceHandle source_handle{};
+  ASSERT_EQ(Result::kSuccess,
+            mrsExternalVideoTrackSourceCreateFromI420ACallback(
+                &VideoTestUtils::MakeTestFrame, nullptr, &source_handle));
+  mrsExternalVideoTrackSourceFinishCreation(source_handle);
+  mrsLocalVideoTrackInitSettings settings{};
+  settings.track_name = "memory_video_track";
+  mrsLocalVideoTrackHandle track_handle{};
+  ASSERT_EQ(Result::kSuccess, mrsLocalVideoTrackCreateFromSource(
+                                  &settings, source_handle, &track_handle));
+  mrsTransceiverInitConfig transceiver_config{};
+  transceiver_config.name = "memory_video";
+  transceiver_config.media_kind = mrsMediaKind::kVideo;
+  mrsTransceiverHandle transceiver{};
+  ASSERT_EQ(Result::kSuccess,
+            mrsPeerConnectionAddTransceiver(pair.pc1(), &transceiver_config,
+                                            &transceiver));
+  ASSERT_EQ(Result::kSuccess,
+            mrsTransceiverSetLocalVideoTrack(transceiver, track_handle));
+
+  mrsRemoteVideoTrackHandle remote_track{};
+  Event track_added;
+  VideoTrackAddedCallback track_added_cb =
+      [&](const mrsRemoteVideoTrackAddedInfo* info) {
+        remote_track = info->track_handle;
+        track_added.Set();
+      };
+  mrsPeerConnectionRegisterVideoTrackAddedCallback(pair.pc2(),
+                                                   CB(track_added_cb));
+  pair.ConnectAndWait();
+  ASSERT_TRUE(track_added.WaitFor(5s));
+  mrsPeerConnectionRegisterVideoTrackAddedCallback(pair.pc2(), nullptr,
+                                                   nullptr);
+
+  // Converting the received frames to ARGB32 needs a scratch buffer
+  Event frame_received;
+  Argb32VideoFrameCallback argb_cb = [&](const mrsArgb32VideoFrame&) {
+    frame_received.Set();
+  };
+  mrsRemoteVideoTrackRegisterArgb32FrameCallback(remote_track, CB(argb_cb));
+  ASSERT_TRUE(frame_received.WaitFor(5s));
+
+  // The scratch buffer of the remote track is charged to its peer connection
+  mrsMemoryUsage usage2{};
+  ASSERT_EQ(Result::kSuccess,
+            mrsPeerConnectionGetMemoryUsage(pair.pc2(), &usage2));
+  ASSERT_LE(16u * 16u * 4u, usage2.video_frame_bytes);
+  ASSERT_EQ(0u, usage2.external_source_bytes);
+  ASSERT_EQ(0u, usage2.data_channel_bytes);
+  ASSERT_LE(usage2.video_frame_bytes, usage2.total_bytes);
+
+  // The external source is not owned by any peer connection, so its buffer
+  // pool is only charged to the process.
+  mrsMemoryUsage usage1{};
+  ASSERT_EQ(Result::kSuccess,
+            mrsPeerConnectionGetMemoryUsage(pair.pc1(), &usage1));
+  ASSERT_EQ(0u, usage1.video_frame_bytes);
+  ASSERT_EQ(0u, usage1.external_source_bytes);
+  mrsMemoryUsage usage{};
+  ASSERT_EQ(Result::kSuccess, mrsGetMemoryUsage(&usage));
+  ASSERT_LT(0u, usage.external_source_bytes);
+  ASSERT_LE(usage2.video_frame_bytes, usage.video_frame_bytes);
+  ASSERT_LE(usage1.total_bytes + usage2.total_bytes, usage.total_bytes);
+
+  mrsRemoteVideoTrackRegisterArgb32FrameCallback(remote_track, nullptr,
+                                                 nullptr);
+  mrsRefCountedObjectRemoveRef(track_handle);
+  mrsExternalVideoTrackSourceShutdown(source_handle);
+  mrsRefCountedObjectRemoveRef(source_handle);
+}
+
+TEST_F(MemoryUsageTests, DataChannelBudget) {
+  LocalPeerPairRaii pair;
+
+  Event ev_open1, ev_open2;
+  DataStateCallback state1_cb = [&](mrsDataChannelState state, int32_t) {
+    if (state == mrsDataChannelState::kOpen) {
+      ev_open1.Set();
+    }
+  };
+  DataStateCallback state2_cb = [&](mrsDataChannelState state, int32_t) {
+    if (state == mrsDataChannelState::kOpen) {
+      ev_open2.Set();
+    }
+  };
+  constexpr int kMessageCount = 400;
+  std::atomic_int received_count{0};
+  Event all_received;
+  DataMessageCallback message2_cb = [&](const void*, const uint64_t) {
+    if (++received_count == kMessageCount) {
+      all_received.Set();
+    }
+  };
+  mrsDataChannelCallbacks callbacks1{};
+  callbacks1.state_callback = &DataStateCallback::StaticExec;
+  callbacks1.state_user_data = &state1_cb;
+  mrsDataChannelCallbacks callbacks2{};
+  callbacks2.message_callback = &DataMessageCallback::StaticExec;
+  callbacks2.message_user_data = &message2_cb;
+  callbacks2.state_callback = &DataStateCallback::StaticExec;
+  callbacks2.state_user_data = &state2_cb;
+
+  mrsDataChannelConfig config{};
+  config.id = 42;
+  config.label = "memory";
+  config.flags = mrsDataChannelConfigFlags::kOrdered |
+                 mrsDataChannelConfigFlags::kReliable;
+  mrsDataChannelHandle handle1{};
+  ASSERT_EQ(Result::kSuccess,
+            mrsPeerConnectionAddDataChannel(pair.pc1(), &config, &handle1));
+  mrsDataChannelRegisterCallbacks(handle1, &callbacks1);
+  mrsDataChannelHandle handle2{};
+  ASSERT_EQ(Result::kSuccess,
+            mrsPeerConnectionAddDataChannel(pair.pc2(), &config, &handle2));
+  mrsDataChannelRegisterCallbacks(handle2, &callbacks2);
+  pair.ConnectAndWait();
+  ASSERT_TRUE(ev_open1.WaitFor(60s));
+  ASSERT_TRUE(ev_open2.WaitFor(60s));
+
+  // Any data queued for sending exceeds the budget of #1. The callback is not
+  // invoked under the lock of the budget nor of the data channel, so it can
+  // disable the budget.
+  BudgetState state;
+  state.disable_budget = true;
+  ASSERT_EQ(Result::kSuccess, mrsPeerConnectionSetMemoryBudget(
+                                  pair.pc1(), 1, &OnBudgetExceeded, &state));
+
+  // Send faster than the SCTP transport drains, so that messages are queued
+  std::vector<uint8_t> message(16 * 1024);
+  for (int i = 0; i < kMessageCount; ++i) {
+    ASSERT_EQ(Result::kSuccess, mrsDataChannelSendMessage(
+                                    handle1, message.data(), message.size()));
+  }
+  ASSERT_TRUE(state.exceeded.WaitFor(10s));
+  ASSERT_EQ(pair.pc1(), state.peer_handle);
+  ASSERT_LT(0u, state.total_bytes);
+  ASSERT_LT(0u, state.usage.data_channel_bytes);
+  ASSERT_EQ(0u, state.usage.video_frame_bytes);
+
+  // The queued data is released once sent
+  ASSERT_TRUE(all_received.WaitFor(60s));
+  mrsMemoryUsage usage{};
+  for (int i = 0; i < 50; ++i) {
+    ASSERT_EQ(Result::kSuccess,
+              mrsPeerConnectionGetMemoryUsage(pair.pc1(), &usage));
+    if (usage.data_channel_bytes == 0) {
+      break;
+    }
+    std::this_thread::sleep_for(100ms);
+  }
+  ASSERT_EQ(0u, usage.data_channel_bytes);
+
+  ASSERT_EQ(Result::kSuccess, mrsPeerConnectionSetMemoryBudget(
+                                  pair.pc1(), 0, nullptr, nullptr));
+  const mrsDataChannelCallbacks no_callbacks{};
+  mrsDataChannelRegisterCallbacks(handle1, &no_callbacks);
+  mrsDataChannelRegisterCallbacks(handle2, &no_callbacks);
+}
+
+#if !defined(MRSW_EXCLUDE_DEVICE_TESTS)
+
+TEST_F(MemoryUsageTests, AudioReadBufferUsage) {
+  LocalPeerPairRaii pair;
+
+  mrsLocalAudioDeviceInitConfig device_config{};
+  mrsDeviceAudioTrackSourceHandle audio_source{};
+  ASSERT_EQ(Result::kSuccess,
+            mrsDeviceAudioTrackSourceCreate(&device_config, &audio_source));
+  mrsLocalAudioTrackInitSettings init_settings{};
+  init_settings.track_name = "memory_audio_track";
+  mrsLocalAudioTrackHandle local_track{};
+  ASSERT_EQ(Result::kSuccess,
+            mrsLocalAudioTrackCreateFromSource(&init_settings, audio_source,
+                                               &local_track));
+  mrsTransceiverInitConfig transceiver_config{};
+  transceiver_config.name = "memory_audio";
+  transceiver_config.media_kind = mrsMediaKind::kAudio;
+  mrsTransceiverHandle transceiver{};
+  ASSERT_EQ(Result::kSuccess,
+            mrsPeerConnectionAddTransceiver(pair.pc1(), &transceiver_config,
+                                            &transceiver));
+  ASSERT_EQ(Result::kSuccess,
+            mrsTransceiverSetLocalAudioTrack(transceiver, local_track));
+
+  mrsRemoteAudioTrackHandle remote_track{};
+  Event track_added;
+  AudioTrackAddedCallback track_added_cb =
+      [&](const mrsRemoteAudioTrackAddedInfo* info) {
+        remote_track = info->track_handle;
+        track_added.Set();
+      };
+  mrsPeerConnectionRegisterAudioTrackAddedCallback(pair.pc2(),
+                                                   CB(track_added_cb));
+  pair.ConnectAndWait();
+  ASSERT_TRUE(track_added.WaitFor(5s));
+  mrsPeerConnectionRegisterAudioTrackAddedCallback(pair.pc2(), nullptr,
+                                                   nullptr);
+
+  mrsMemoryUsage before{};
+  ASSERT_EQ(Result::kSuccess,
+            mrsPeerConnectionGetMemoryUsage(pair.pc2(), &before));
+
+  // The read buffer of the remote track is charged to its peer connection
+  mrsAudioTrackReadBufferHandle read_buffer{};
+  ASSERT_EQ(Result::kSuccess,
+            mrsRemoteAudioTrackCreateReadBuffer(remote_track, &read_buffer));
+  std::this_thread::sleep_for(200ms);
+  std::vector<float> samples(480 * 2);
+  int num_read = 0;
+  mrsBool has_overrun = mrsBool::kFalse;
+  ASSERT_EQ(Result::kSuccess,
+            mrsAudioTrackReadBufferRead(
+                read_buffer, 48000, 2,
+                mrsAudioTrackReadBufferPadBehavior::kPadWithZero,
+                samples.data(), static_cast<int>(samples.size()), &num_read,
+                &has_overrun));
+  mrsMemoryUsage usage2{};
+  ASSERT_EQ(Result::kSuccess,
+            mrsPeerConnectionGetMemoryUsage(pair.pc2(), &usage2));
+  ASSERT_LT(before.audio_buffer_bytes, usage2.audio_buffer_bytes);
+  mrsMemoryUsage usage1{};
+  ASSERT_EQ(Result::kSuccess,
+            mrsPeerConnectionGetMemoryUsage(pair.pc1(), &usage1));
+  ASSERT_EQ(0u, usage1.audio_buffer_bytes);
+
+  // Destroying the read buffer releases its charge
+  mrsAudioTrackReadBufferDestroy(read_buffer);
+  ASSERT_EQ(Result::kSuccess,
+            mrsPeerConnectionGetMemoryUsage(pair.pc2(), &usage2));
+  ASSERT_EQ(before.audio_buffer_bytes, usage2.audio_buffer_bytes);
+
+  mrsRefCountedObjectRemoveRef(local_track);
+  mrsRefCountedObjectRemoveRef(audio_source);
+}
+
+#endif  // !defined(MRSW_EXCLUDE_DEVICE_TESTS)
@@ -5,15 +5,46 @@
 
 #include "audio_frame.h"
 #include "audio_track_source_interop.h"
+#include "external_video_track_source_interop.h"
 #include "interop_api.h"
+#include "local_video_track_interop.h"
 #include "object_interop.h"
+#include "remote_video_track_interop.h"
+#include "transceiver_interop.h"
 
 #include "test_utils.h"
+#include "video_test_utils.h"
 
 namespace {
 
 class ObjectTests : public TestUtils::TestBase {};
 
+using VideoTrackAddedCallback =
+    InteropCallback<const mrsRemoteVideoTrackAddedInfo*>;
+using I420VideoFrameCallback = InteropCallback<const I420AVideoFrame&>;
+
+mrsObjectMetrics GetMetrics(mrsObjectHandle handle) {
+  mrsObjectMetrics metrics{};
+  EXPECT_EQ(mrsResult::kSuccess, mrsObjectGetMetrics(handle, &metrics));
+  return metrics;
+}
+
+/// Check that the frame counters of an object increased between two
+/// snapshots, and that the callbacks were counted if it invokes any.
+void CheckMetricsIncrease(const mrsObjectMetrics& before,
+                          const mrsObjectMetrics& after,
+                          bool has_callback) {
+  ASSERT_LT(before.frames_in, after.frames_in);
+  ASSERT_LT(before.frames_out, after.frames_out);
+  ASSERT_LE(before.frames_dropped, after.frames_dropped);
+  if (has_callback) {
+    ASSERT_LT(before.callback_count, after.callback_count);
+    ASSERT_LE(before.callback_time_us, after.callback_time_us);
+  } else {
+    ASSERT_EQ(0u, after.callback_count);
+  }
+}
+
 }  // namespace
 
 TEST_F(ObjectTests, Name) {
@@ -96,3 +127,98 @@ TEST_F(ObjectTests, UserData) {
 
   mrsRefCountedObjectRemoveRef(handle);
 }
+
+TEST_F(ObjectTests, Metrics) {
+  // Use a peer connection object as a placeholder for any object.
+  mrsPeerConnectionConfiguration config{};
+  mrsPeerConnectionHandle handle{};
+  ASSERT_EQ(mrsResult::kSuccess, mrsPeerConnectionCreate(&config, &handle));
+  ASSERT_NE(nullptr, handle);
+
+  // A peer connection doesn't update any counter
+  mrsObjectMetrics metrics;
+  memset(&metrics, 0xFF, sizeof(metrics));
+  ASSERT_EQ(mrsResult::kSuccess, mrsObjectGetMetrics(handle, &metrics));
+  ASSERT_EQ(0u, metrics.frames_in);
+  ASSERT_EQ(0u, metrics.frames_out);
+  ASSERT_EQ(0u, metrics.frames_dropped);
+  ASSERT_EQ(0u, metrics.callback_count);
+
+  ASSERT_EQ(mrsResult::kInvalidParameter,
+            mrsObjectGetMetrics(handle, nullptr));
+  ASSERT_EQ(mrsResult::kInvalidNativeHandle,
+            mrsObjectGetMetrics(nullptr, &metrics));
+
+  mrsRefCountedObjectRemoveRef(handle);
+}
+
+TEST_F(ObjectTests, MetricsOfVideoObjects) {
+  LocalPeerPairRaii pair;
+
+  // Send the frames of an external source from #1 to #2
+  mrsExternalVideoTrackSourceHandle source_handle = nullptr;
+  ASSERT_EQ(mrsResult::kSuccess,
+            mrsExternalVideoTrackSourceCreateFromI420ACallback(
+                &VideoTestUtils::MakeTestFrame, nullptr, &source_handle));
+  mrsExternalVideoTrackSourceFinishCreation(source_handle);
+  mrsLocalVideoTrackHandle local_track{};
+  mrsLocalVideoTrackInitSettings settings{};
+  settings.track_name = "metrics_video_track";
+  ASSERT_EQ(mrsResult::kSuccess, mrsLocalVideoTrackCreateFromSource(
+                                     &settings, source_handle, &local_track));
+  mrsTransceiverInitConfig transceiver_config{};
+  transceiver_config.name = "metrics_video";
+  transceiver_config.media_kind = mrsMediaKind::kVideo;
+  mrsTransceiverHandle transceiver{};
+  ASSERT_EQ(Result::kSuccess,
+            mrsPeerConnectionAddTransceiver(pair.pc1(), &transceiver_config,
+                                            &transceiver));
+  ASSERT_EQ(Result::kSuccess,
+            mrsTransceiverSetLocalVideoTrack(transceiver, local_track));
+  mrsRemoteVideoTrackHandle remote_track{};
+  Event track_added;
+  VideoTrackAddedCallback track_added_cb =
+      [&](const mrsRemoteVideoTrackAddedInfo* info) {
+        remote_track = info->track_handle;
+        track_added.Set();
+      };
+  mrsPeerConnectionRegisterVideoTrackAddedCallback(pair.pc2(),
+                                                   CB(track_added_cb));
+  pair.ConnectAndWait();
+  ASSERT_TRUE(track_added.WaitFor(5s));
+
+  // Count the frames delivered on both ends
+  Semaphore local_frames;
+  I420VideoFrameCallback local_cb = [&](const I420AVideoFrame& frame) {
+    VideoTestUtils::CheckIsTestFrame(frame);
+    local_frames.Release();
+  };
+  mrsLocalVideoTrackRegisterI420AFrameCallback(local_track, CB(local_cb));
+  Semaphore remote_frames;
+  I420VideoFrameCallback remote_cb = [&](const I420AVideoFrame& frame) {
+    VideoTestUtils::CheckIsTestFrame(frame);
+    remote_frames.Release();
+  };
+  mrsRemoteVideoTrackRegisterI420AFrameCallback(remote_track, CB(remote_cb));
+
+  // The counters of every object on the path increase as frames flow
+  ASSERT_TRUE(local_frames.TryAcquireFor(5s, 10));
+  ASSERT_TRUE(remote_frames.TryAcquireFor(5s, 10));
+  const mrsObjectMetrics source_before = GetMetrics(source_handle);
+  const mrsObjectMetrics local_before = GetMetrics(local_track);
+  const mrsObjectMetrics remote_before = GetMetrics(remote_track);
+  ASSERT_TRUE(local_frames.TryAcquireFor(5s, 10));
+  ASSERT_TRUE(remote_frames.TryAcquireFor(5s, 10));
+  mrsLocalVideoTrackRegisterI420AFrameCallback(local_track, nullptr, nullptr);
+  mrsRemoteVideoTrackRegisterI420AFrameCallback(remote_track, nullptr,
+                                                nullptr);
+  CheckMetricsIncrease(source_before, GetMetrics(source_handle), false);
+  CheckMetricsIncrease(local_before, GetMetrics(local_track), true);
+  CheckMetricsIncrease(remote_before, GetMetrics(remote_track), true);
+
+  mrsPeerConnectionRegisterVideoTrackAddedCallback(pair.pc2(), nullptr,
+                                                   nullptr);
+  mrsRefCountedObjectRemoveRef(local_track);
+  mrsExternalVideoTrackSourceShutdown(source_handle);
+  mrsRefCountedObjectRemoveRef(source_handle);
+}
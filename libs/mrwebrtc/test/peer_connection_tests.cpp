@@ -13,6 +13,35 @@ class PeerConnectionTests : public TestUtils::TestBase,
                             public testing::WithParamInterface<mrsSdpSemantic> {
 };
 
+class PeerConnectionCloseTests : public TestUtils::TestBase {
+ public:
+  void TearDown() override {
+    TestUtils::TestBase::TearDown();
+    // Restore the default once the library is shut down
+    ASSERT_EQ(Result::kSuccess, mrsSetFactoryShardCount(1));
+  }
+};
+
+void MRS_CALL SetEventOnClosed(void* user_data) {
+  static_cast<Event*>(user_data)->Set();
+}
+
+/// Create and connect |count| local pairs of peer connections, and append the
+/// handles of all peers to |handles|.
+void ConnectPairs(uint32_t count,
+                  std::vector<std::unique_ptr<LocalPeerPairRaii>>& pairs,
+                  std::vector<mrsPeerConnectionHandle>& handles) {
+  mrsPeerConnectionConfiguration pc_config{};
+  pc_config.factory_shard = -1;  // round-robin
+  for (uint32_t i = 0; i < count; ++i) {
+    auto pair = std::make_unique<LocalPeerPairRaii>(pc_config);
+    pair->ConnectAndWait();
+    handles.push_back(pair->pc1());
+    handles.push_back(pair->pc2());
+    pairs.push_back(std::move(pair));
+  }
+}
+
 }  // namespace
 
 INSTANTIATE_TEST_CASE_P(,
@@ -89,3 +118,80 @@ TEST_P(PeerConnectionTests, LocalIce) {
                                                              nullptr, nullptr);
   }
 }
+
+TEST_F(PeerConnectionCloseTests, CloseManyInvalidParameters) {
+  ASSERT_EQ(Result::kInvalidParameter,
+            mrsPeerConnectionCloseMany(nullptr, 1, nullptr, nullptr));
+  mrsPeerConnectionHandle handles[2]{};
+  ASSERT_EQ(Result::kInvalidNativeHandle,
+            mrsPeerConnectionCloseMany(handles, 2, nullptr, nullptr));
+
+  // Nothing to close completes immediately
+  Event ev;
+  ASSERT_EQ(Result::kSuccess,
+            mrsPeerConnectionCloseMany(nullptr, 0, &SetEventOnClosed, &ev));
+  ASSERT_TRUE(ev.IsSignaled());
+}
+
+TEST_F(PeerConnectionCloseTests, CloseMany) {
+  ASSERT_EQ(Result::kSuccess, mrsSetFactoryShardCount(2));
+  std::vector<std::unique_ptr<LocalPeerPairRaii>> pairs;
+  std::vector<mrsPeerConnectionHandle> handles;
+  ConnectPairs(3, pairs, handles);
+
+  Event ev;
+  ASSERT_EQ(Result::kSuccess,
+            mrsPeerConnectionCloseMany(handles.data(),
+                                       static_cast<uint32_t>(handles.size()),
+                                       &SetEventOnClosed, &ev));
+  ASSERT_TRUE(ev.WaitFor(30s));
+  for (mrsPeerConnectionHandle handle : handles) {
+    ASSERT_EQ(Result::kUnknownError, mrsPeerConnectionCreateOffer(handle));
+  }
+  pairs.clear();
+}
+
+TEST_F(PeerConnectionCloseTests, DISABLED_CloseManyBenchmark) {
+  // Compare closing sessions one by one and in bulk, over 2 shards as a
+  // server would use.
+  ASSERT_EQ(Result::kSuccess, mrsSetFactoryShardCount(2));
+  for (uint32_t session_count : {1u, 8u, 32u}) {
+    for (bool bulk : {false, true}) {
+      std::vector<std::unique_ptr<LocalPeerPairRaii>> pairs;
+      std::vector<mrsPeerConnectionHandle> handles;
+      ConnectPairs(session_count, pairs, handles);
+
+      const auto close_start = std::chrono::steady_clock::now();
+      if (bulk) {
+        Event ev;
+        ASSERT_EQ(Result::kSuccess, mrsPeerConnectionCloseMany(
+                                        handles.data(),
+                                        static_cast<uint32_t>(handles.size()),
+                                        &SetEventOnClosed, &ev));
+        ASSERT_TRUE(ev.WaitFor(60s));
+      } else {
+        for (mrsPeerConnectionHandle handle : handles) {
+          ASSERT_EQ(Result::kSuccess, mrsPeerConnectionClose(handle));
+        }
+      }
+      const auto close_end = std::chrono::steady_clock::now();
+
+      // Releasing the last peer shuts the library down and joins its threads
+      pairs.clear();
+      ASSERT_EQ(0u, mrsReportLiveObjects());
+      const auto shutdown_end = std::chrono::steady_clock::now();
+      const auto close_ms =
+          std::chrono::duration_cast<std::chrono::milliseconds>(close_end -
+                                                                close_start)
+              .count();
+      const auto shutdown_ms =
+          std::chrono::duration_cast<std::chrono::milliseconds>(shutdown_end -
+                                                                close_end)
+              .count();
+      const std::string prefix = "sessions" + std::to_string(session_count) +
+                                 (bulk ? "_bulk_" : "_single_");
+      RecordProperty(prefix + "close_ms", static_cast<int>(close_ms));
+      RecordProperty(prefix + "shutdown_ms", static_cast<int>(shutdown_ms));
+    }
+  }
+}
@@ -0,0 +1,203 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+#include "pch.h"
+
+#include "external_video_track_source_interop.h"
+#include "interop_api.h"
+#include "local_video_track_interop.h"
+#include "remote_video_track_interop.h"
+#include "transceiver_interop.h"
+
+#include "peer_connection_test_helpers.h"
+#include "test_utils.h"
+#include "video_test_utils.h"
+
+namespace {
+
+class RemoteVideoDecodeTests : public TestUtils::TestBase {};
+
+using VideoTrackAddedCallback =
+    InteropCallback<const mrsRemoteVideoTrackAddedInfo*>;
+using I420VideoFrameCallback = InteropCallback<const I420AVideoFrame&>;
+
+/// Get the number of frames decoded by the video receiver of a peer
+/// connection, from a new stats report.
+uint32_t GetFramesDecoded(mrsPeerConnectionHandle pc) {
+  Event ev;
+  uint32_t frames_decoded = 0;
+  InteropCallback<mrsStatsReportHandle> cb([&](mrsStatsReportHandle report) {
+    const void* objects = nullptr;
+    uint64_t count = 0;
+    EXPECT_EQ(Result::kSuccess,
+              mrsStatsReportGetSimpleStats(report, mrsStatsType::kVideoReceiver,
+                                           &objects, &count));
+    EXPECT_EQ(1u, count);
+    if (count > 0) {
+      frames_decoded =
+          static_cast<const mrsVideoReceiverStats*>(objects)->frames_decoded;
+    }
+    mrsStatsReportRemoveRef(report);
+    ev.Set();
+  });
+  EXPECT_EQ(Result::kSuccess, mrsPeerConnectionGetSimpleStats(pc, CB(cb)));
+  EXPECT_TRUE(ev.WaitFor(5s));
+  return frames_decoded;
+}
+
+/// Pair of connected peers sending a test video track from the first peer to
+/// the second one.
+struct VideoPair {
+  LocalPeerPairRaii pair;
+  mrsExternalVideoTrackSourceHandle source_handle{};
+  mrsLocalVideoTrackHandle track_handle{};
+  mrsRemoteVideoTrackHandle remote_track{};
+  Event track_added;
+  VideoTrackAddedCallback track_added_cb;
+
+  void Connect() {
+    ASSERT_EQ(mrsResult::kSuccess,
+              mrsExternalVideoTrackSourceCreateFromI420ACallback(
+                  &VideoTestUtils::MakeTestFrame, nullptr, &source_handle));
+    mrsExternalVideoTrackSourceFinishCreation(source_handle);
+    mrsLocalVideoTrackInitSettings settings{};
+    settings.track_name = "decoded_video_track";
+    ASSERT_EQ(mrsResult::kSuccess,
+              mrsLocalVideoTrackCreateFromSource(&settings, source_handle,
+                                                 &track_handle));
+    mrsTransceiverInitConfig transceiver_config{};
+    transceiver_config.name = "decoded_video";
+    transceiver_config.media_kind = mrsMediaKind::kVideo;
+    mrsTransceiverHandle transceiver{};
+    ASSERT_EQ(Result::kSuccess,
+              mrsPeerConnectionAddTransceiver(pair.pc1(), &transceiver_config,
+                                              &transceiver));
+    ASSERT_EQ(Result::kSuccess,
+              mrsTransceiverSetLocalVideoTrack(transceiver, track_handle));
+    track_added_cb = [&](const mrsRemoteVideoTrackAddedInfo* info) {
+      remote_track = info->track_handle;
+      track_added.Set();
+    };
+    mrsPeerConnectionRegisterVideoTrackAddedCallback(pair.pc2(),
+                                                     CB(track_added_cb));
+    pair.ConnectAndWait();
+    ASSERT_TRUE(track_added.WaitFor(5s));
+  }
+
+  ~VideoPair() {
+    mrsPeerConnectionRegisterVideoTrackAddedCallback(pair.pc2(), nullptr,
+                                                     nullptr);
+    if (track_handle) {
+      mrsRefCountedObjectRemoveRef(track_handle);
+    }
+    if (source_handle) {
+      mrsExternalVideoTrackSourceShutdown(source_handle);
+      mrsRefCountedObjectRemoveRef(source_handle);
+    }
+  }
+};
+
+}  // namespace
+
+TEST_F(RemoteVideoDecodeTests, InvalidParameters) {
+  ASSERT_EQ(Result::kInvalidNativeHandle,
+            mrsRemoteVideoTrackSetDecodeEnabled(nullptr, mrsBool::kTrue));
+  ASSERT_EQ(Result::kInvalidNativeHandle,
+            mrsRemoteVideoTrackSetAutoDecode(nullptr, mrsBool::kTrue));
+}
+
+TEST_F(RemoteVideoDecodeTests, DecodeEnabled) {
+  VideoPair video;
+  video.Connect();
+
+  std::atomic<uint32_t> decoded_count{0};
+  I420VideoFrameCallback frame_cb = [&](const I420AVideoFrame& frame) {
+    VideoTestUtils::CheckIsTestFrame(frame);
+    ++decoded_count;
+  };
+  mrsRemoteVideoTrackRegisterI420AFrameCallback(video.remote_track,
+                                                CB(frame_cb));
+  Event ev;
+  ev.WaitFor(1s);
+  ASSERT_LT(5u, decoded_count.load());
+
+  // No frame is decoded while decoding is disabled
+  ASSERT_EQ(Result::kSuccess, mrsRemoteVideoTrackSetDecodeEnabled(
+                                  video.remote_track, mrsBool::kFalse));
+  ev.WaitFor(200ms);
+  const uint32_t count = decoded_count.load();
+  ev.WaitFor(1s);
+  ASSERT_EQ(count, decoded_count.load());
+
+  // Decoding resumes on the key frame requested once enabled again
+  ASSERT_EQ(Result::kSuccess, mrsRemoteVideoTrackSetDecodeEnabled(
+                                  video.remote_track, mrsBool::kTrue));
+  ev.WaitFor(2s);
+  ASSERT_LT(count + 5, decoded_count.load());
+
+  mrsRemoteVideoTrackRegisterI420AFrameCallback(video.remote_track, nullptr,
+                                                nullptr);
+}
+
+TEST_F(RemoteVideoDecodeTests, AutoDecode) {
+  VideoPair video;
+  video.Connect();
+  ASSERT_EQ(Result::kSuccess, mrsRemoteVideoTrackSetAutoDecode(
+                                  video.remote_track, mrsBool::kTrue));
+
+  // Decoding runs while a raw frame callback is registered, and resumes on a
+  // key frame after pausing without it.
+  for (int i = 0; i < 2; ++i) {
+    std::atomic<uint32_t> decoded_count{0};
+    I420VideoFrameCallback frame_cb = [&](const I420AVideoFrame& frame) {
+      VideoTestUtils::CheckIsTestFrame(frame);
+      ++decoded_count;
+    };
+    mrsRemoteVideoTrackRegisterI420AFrameCallback(video.remote_track,
+                                                  CB(frame_cb));
+    Event ev;
+    ev.WaitFor(2s);
+    ASSERT_LT(5u, decoded_count.load());
+    mrsRemoteVideoTrackRegisterI420AFrameCallback(video.remote_track, nullptr,
+                                                  nullptr);
+
+    // The decoder stops once the frames in flight are decoded
+    ev.WaitFor(300ms);
+    const uint32_t frames_decoded = GetFramesDecoded(video.pair.pc2());
+    ev.WaitFor(1s);
+    ASSERT_EQ(frames_decoded, GetFramesDecoded(video.pair.pc2()));
+  }
+}
+
+TEST_F(RemoteVideoDecodeTests, SameTrackName) {
+  // The remote tracks of both pairs have the same ID, which is usually the ID
+  // of the SDP stream their decoder is created for.
+  VideoPair hidden_video;
+  hidden_video.Connect();
+  VideoPair visible_video;
+  visible_video.Connect();
+
+  std::atomic<uint32_t> decoded_count{0};
+  I420VideoFrameCallback frame_cb = [&](const I420AVideoFrame& frame) {
+    VideoTestUtils::CheckIsTestFrame(frame);
+    ++decoded_count;
+  };
+  mrsRemoteVideoTrackRegisterI420AFrameCallback(visible_video.remote_track,
+                                                CB(frame_cb));
+
+  // Pausing the decoding of one track does not affect the other one
+  ASSERT_EQ(Result::kSuccess, mrsRemoteVideoTrackSetDecodeEnabled(
+                                  hidden_video.remote_track, mrsBool::kFalse));
+  ASSERT_EQ(Result::kSuccess, mrsRemoteVideoTrackSetAutoDecode(
+                                  hidden_video.remote_track, mrsBool::kTrue));
+  Event ev;
+  ev.WaitFor(300ms);
+  const uint32_t count = decoded_count.load();
+  const uint32_t frames_decoded = GetFramesDecoded(hidden_video.pair.pc2());
+  ev.WaitFor(1s);
+  ASSERT_LT(count + 5, decoded_count.load());
+  ASSERT_EQ(frames_decoded, GetFramesDecoded(hidden_video.pair.pc2()));
+
+  mrsRemoteVideoTrackRegisterI420AFrameCallback(visible_video.remote_track,
+                                                nullptr, nullptr);
+}
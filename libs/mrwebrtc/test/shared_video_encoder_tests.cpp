@@ -0,0 +1,193 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+#include "pch.h"
+
+#include "external_video_track_source_interop.h"
+#include "interop_api.h"
+#include "local_video_track_interop.h"
+#include "remote_video_track_interop.h"
+#include "shared_video_encoder_interop.h"
+#include "transceiver_interop.h"
+
+#include "peer_connection_test_helpers.h"
+#include "test_utils.h"
+#include "video_test_utils.h"
+
+namespace {
+
+class SharedVideoEncoderTests : public TestUtils::TestBase {
+ public:
+  void TearDown() override {
+    ASSERT_EQ(Result::kSuccess, mrsSetSharedVideoEncoding(mrsBool::kFalse));
+    TestUtils::TestBase::TearDown();
+  }
+};
+
+using VideoTrackAddedCallback =
+    InteropCallback<const mrsRemoteVideoTrackAddedInfo*>;
+using I420VideoFrameCallback = InteropCallback<const I420AVideoFrame&>;
+
+/// Pair of peer connections sending a local video track from the first one to
+/// the second one, and counting the frames received. The bitrate of the sender
+/// is pinned, so that the tier of its shared encoder is known.
+struct SendingPair {
+  LocalPeerPairRaii pair;
+  mrsRemoteVideoTrackHandle remote_track{};
+  Event track_added;
+  VideoTrackAddedCallback track_added_cb;
+  std::atomic<uint32_t> frame_count{0};
+  I420VideoFrameCallback frame_cb;
+
+  void Start(mrsLocalVideoTrackHandle local_track,
+             int min_bitrate_bps,
+             int max_bitrate_bps) {
+    track_added_cb = [this](const mrsRemoteVideoTrackAddedInfo* info) {
+      remote_track = info->track_handle;
+      track_added.Set();
+    };
+    mrsPeerConnectionRegisterVideoTrackAddedCallback(pair.pc2(),
+                                                     CB(track_added_cb));
+    mrsTransceiverInitConfig transceiver_config{};
+    transceiver_config.name = "shared_video";
+    transceiver_config.media_kind = mrsMediaKind::kVideo;
+    mrsTransceiverHandle transceiver{};
+    ASSERT_EQ(Result::kSuccess,
+              mrsPeerConnectionAddTransceiver(pair.pc1(), &transceiver_config,
+                                              &transceiver));
+    ASSERT_EQ(Result::kSuccess,
+              mrsTransceiverSetLocalVideoTrack(transceiver, local_track));
+    pair.ConnectAndWait();
+    ASSERT_TRUE(track_added.WaitFor(5s));
+    ASSERT_EQ(Result::kSuccess,
+              mrsPeerConnectionSetBitrate(pair.pc1(), min_bitrate_bps,
+                                          max_bitrate_bps, max_bitrate_bps));
+    frame_cb = [this](const I420AVideoFrame& frame) {
+      VideoTestUtils::CheckIsTestFrame(frame);
+      ++frame_count;
+    };
+    mrsRemoteVideoTrackRegisterI420AFrameCallback(remote_track, CB(frame_cb));
+  }
+
+  void Stop() {
+    mrsRemoteVideoTrackRegisterI420AFrameCallback(remote_track, nullptr,
+                                                  nullptr);
+    mrsPeerConnectionRegisterVideoTrackAddedCallback(pair.pc2(), nullptr,
+                                                     nullptr);
+  }
+};
+
+}  // namespace
+
+TEST_F(SharedVideoEncoderTests, InvalidParameters) {
+  ASSERT_EQ(Result::kInvalidParameter, mrsGetSharedVideoEncoderStats(nullptr));
+}
+
+TEST_F(SharedVideoEncoderTests, EncodeOnce) {
+  ASSERT_EQ(Result::kSuccess, mrsSetSharedVideoEncoding(mrsBool::kTrue));
+  mrsSharedVideoEncoderStats stats_before{};
+  ASSERT_EQ(Result::kSuccess, mrsGetSharedVideoEncoderStats(&stats_before));
+  ASSERT_EQ(0u, stats_before.encoder_count);
+
+  mrsExternalVideoTrackSourceHandle source_handle = nullptr;
+  ASSERT_EQ(mrsResult::kSuccess,
+            mrsExternalVideoTrackSourceCreateFromI420ACallback(
+                &VideoTestUtils::MakeTestFrame, nullptr, &source_handle));
+  mrsExternalVideoTrackSourceFinishCreation(source_handle);
+  mrsLocalVideoTrackHandle track_handle{};
+  mrsLocalVideoTrackInitSettings settings{};
+  settings.track_name = "shared_video_track";
+  ASSERT_EQ(mrsResult::kSuccess, mrsLocalVideoTrackCreateFromSource(
+                                     &settings, source_handle, &track_handle));
+
+  // Send the same track to two peer connections
+  {
+    SendingPair pair1, pair2;
+    pair1.Start(track_handle, 300000, 300000);
+    pair2.Start(track_handle, 300000, 300000);
+    Event ev;
+    ev.WaitFor(3s);
+    ASSERT_LT(10u, pair1.frame_count.load()) << "Expected at least 5 FPS";
+    ASSERT_LT(10u, pair2.frame_count.load()) << "Expected at least 5 FPS";
+
+    // Both senders are fed by a single encoder
+    mrsSharedVideoEncoderStats stats{};
+    ASSERT_EQ(Result::kSuccess, mrsGetSharedVideoEncoderStats(&stats));
+    ASSERT_EQ(1u, stats.encoder_count);
+    ASSERT_EQ(2u, stats.sender_count);
+    const uint64_t frames_encoded =
+        stats.frames_encoded - stats_before.frames_encoded;
+    const uint64_t frames_delivered =
+        stats.frames_delivered - stats_before.frames_delivered;
+    ASSERT_LT(0u, frames_encoded);
+    ASSERT_LT(frames_encoded, frames_delivered);
+    ASSERT_LE(stats.key_frames_encoded - stats_before.key_frames_encoded,
+              frames_encoded);
+
+    pair1.Stop();
+    pair2.Stop();
+  }
+
+  // Encoders are released with their senders
+  mrsSharedVideoEncoderStats stats{};
+  ASSERT_EQ(Result::kSuccess, mrsGetSharedVideoEncoderStats(&stats));
+  ASSERT_EQ(0u, stats.encoder_count);
+  ASSERT_EQ(0u, stats.sender_count);
+
+  mrsRefCountedObjectRemoveRef(track_handle);
+  mrsExternalVideoTrackSourceShutdown(source_handle);
+  mrsRefCountedObjectRemoveRef(source_handle);
+}
+
+TEST_F(SharedVideoEncoderTests, BitrateTiers) {
+  ASSERT_EQ(Result::kSuccess, mrsSetSharedVideoEncoding(mrsBool::kTrue));
+  mrsSharedVideoEncoderStats stats_before{};
+  ASSERT_EQ(Result::kSuccess, mrsGetSharedVideoEncoderStats(&stats_before));
+
+  mrsExternalVideoTrackSourceHandle source_handle = nullptr;
+  ASSERT_EQ(mrsResult::kSuccess,
+            mrsExternalVideoTrackSourceCreateFromI420ACallback(
+                &VideoTestUtils::MakeTestFrame, nullptr, &source_handle));
+  mrsExternalVideoTrackSourceFinishCreation(source_handle);
+  mrsLocalVideoTrackHandle track_handle{};
+  mrsLocalVideoTrackInitSettings settings{};
+  settings.track_name = "shared_video_track";
+  ASSERT_EQ(mrsResult::kSuccess, mrsLocalVideoTrackCreateFromSource(
+                                     &settings, source_handle, &track_handle));
+
+  // Send the same track to a constrained and an unconstrained connection
+  {
+    SendingPair pair1, pair2;
+    pair1.Start(track_handle, 30000, 100000);
+    pair2.Start(track_handle, 800000, 800000);
+    Event ev;
+    ev.WaitFor(3s);
+    ASSERT_LT(10u, pair1.frame_count.load()) << "Expected at least 5 FPS";
+    ASSERT_LT(10u, pair2.frame_count.load()) << "Expected at least 5 FPS";
+
+    // The bitrates are in different tiers, so each sender has its own encoder
+    // instead of both being encoded at the lowest bitrate.
+    mrsSharedVideoEncoderStats stats{};
+    ASSERT_EQ(Result::kSuccess, mrsGetSharedVideoEncoderStats(&stats));
+    ASSERT_EQ(2u, stats.encoder_count);
+    ASSERT_EQ(2u, stats.sender_count);
+    const uint64_t frames_encoded =
+        stats.frames_encoded - stats_before.frames_encoded;
+    const uint64_t frames_delivered =
+        stats.frames_delivered - stats_before.frames_delivered;
+    ASSERT_LT(0u, frames_encoded);
+    ASSERT_LE(frames_encoded, frames_delivered);
+
+    pair1.Stop();
+    pair2.Stop();
+  }
+
+  mrsSharedVideoEncoderStats stats{};
+  ASSERT_EQ(Result::kSuccess, mrsGetSharedVideoEncoderStats(&stats));
+  ASSERT_EQ(0u, stats.encoder_count);
+  ASSERT_EQ(0u, stats.sender_count);
+
+  mrsRefCountedObjectRemoveRef(track_handle);
+  mrsExternalVideoTrackSourceShutdown(source_handle);
+  mrsRefCountedObjectRemoveRef(source_handle);
+}
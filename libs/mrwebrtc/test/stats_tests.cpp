@@ -0,0 +1,663 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+#include "pch.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <thread>
+
+#include "data_channel_interop.h"
+#include "device_audio_track_source_interop.h"
+#include "external_video_track_source_interop.h"
+#include "interop_api.h"
+#include "local_audio_track_interop.h"
+#include "local_video_track_interop.h"
+#include "transceiver_interop.h"
+
+#include "test_utils.h"
+#include "video_test_utils.h"
+
+namespace {
+
+class StatsTests : public TestUtils::TestBase,
+                   public testing::WithParamInterface<mrsSdpSemantic> {};
+
+/// Get a stats report for the given peer connection, blocking until it is
+/// delivered. The caller must release the returned report.
+mrsStatsReportHandle GetStatsAndWait(mrsPeerConnectionHandle pc) {
+  Event ev;
+  mrsStatsReportHandle report = nullptr;
+  InteropCallback<mrsStatsReportHandle> cb(
+      [&ev, &report](mrsStatsReportHandle r) {
+        report = r;
+        ev.Set();
+      });
+  EXPECT_EQ(Result::kSuccess, mrsPeerConnectionGetSimpleStats(pc, CB(cb)));
+  EXPECT_TRUE(ev.WaitFor(5s));
+  return report;
+}
+
+/// Wait until the stats snapshot of the given peer connection satisfies a
+/// predicate, and return it.
+mrsStatsSamplerSnapshot WaitForSnapshot(
+    mrsPeerConnectionHandle pc,
+    const std::function<bool(const mrsStatsSamplerSnapshot&)>& predicate) {
+  mrsStatsSamplerSnapshot snapshot{};
+  const auto deadline = std::chrono::steady_clock::now() + 5s;
+  do {
+    EXPECT_EQ(Result::kSuccess,
+              mrsPeerConnectionGetStatsSnapshot(pc, &snapshot));
+    if (predicate(snapshot)) {
+      return snapshot;
+    }
+    std::this_thread::sleep_for(5ms);
+  } while (std::chrono::steady_clock::now() < deadline);
+  ADD_FAILURE() << "Timed out waiting for a stats snapshot.";
+  return snapshot;
+}
+
+void MRS_CALL AppendDataChannelStats(void* user_data,
+                                     const void* stats_object) noexcept {
+  auto vec = static_cast<std::vector<mrsDataChannelStats>*>(user_data);
+  vec->push_back(*static_cast<const mrsDataChannelStats*>(stats_object));
+}
+
+/// Copy the simple stats objects of a given type out of a report. The strings
+/// they reference remain owned by the report.
+template <class T>
+std::vector<T> GetStatsArray(mrsStatsReportHandle report, mrsStatsType type) {
+  const void* objects = nullptr;
+  uint64_t count = 0;
+  EXPECT_EQ(Result::kSuccess,
+            mrsStatsReportGetSimpleStats(report, type, &objects, &count));
+  const T* const begin = static_cast<const T*>(objects);
+  return std::vector<T>(begin, begin + count);
+}
+
+/// Wait until the receiver stats of the given type satisfy a predicate, so
+/// that media has flowed through both the track and the RTP stream.
+template <class T>
+bool WaitForReceiverStats(mrsPeerConnectionHandle pc,
+                          mrsStatsType type,
+                          const std::function<bool(const T&)>& predicate) {
+  for (int i = 0; i < 50; ++i) {
+    mrsStatsReportHandle report = GetStatsAndWait(pc);
+    if (!report) {
+      return false;
+    }
+    const std::vector<T> receivers = GetStatsArray<T>(report, type);
+    const bool ready = (receivers.size() == 1) && predicate(receivers[0]);
+    mrsStatsReportRemoveRef(report);
+    if (ready) {
+      return true;
+    }
+    std::this_thread::sleep_for(100ms);
+  }
+  return false;
+}
+
+using DataStateCallback = InteropCallback<mrsDataChannelState, int32_t>;
+
+/// Thread sending messages on a data channel at a constant rate until
+/// destroyed, catching up after each sleep so that the rate does not depend on
+/// the timer resolution.
+class DataSender {
+ public:
+  DataSender(mrsDataChannelHandle handle,
+             size_t message_size,
+             double bytes_per_sec)
+      : thread_([this, handle, message_size, bytes_per_sec]() {
+          const std::vector<uint8_t> message(message_size);
+          const auto start = std::chrono::steady_clock::now();
+          double bytes_sent = 0.0;
+          while (running_.load()) {
+            const std::chrono::duration<double> elapsed =
+                std::chrono::steady_clock::now() - start;
+            while (bytes_sent < elapsed.count() * bytes_per_sec) {
+              mrsDataChannelSendMessage(handle, message.data(),
+                                        message.size());
+              bytes_sent += message_size;
+            }
+            std::this_thread::sleep_for(5ms);
+          }
+        }) {}
+  ~DataSender() {
+    running_.store(false);
+    thread_.join();
+  }
+
+ private:
+  std::atomic_bool running_{true};
+  std::thread thread_;
+};
+
+}  // namespace
+
+INSTANTIATE_TEST_CASE_P(,
+                        StatsTests,
+                        testing::ValuesIn(TestUtils::TestSemantics),
+                        TestUtils::SdpSemanticToString);
+
+TEST_P(StatsTests, GetSimpleStats) {
+  mrsPeerConnectionConfiguration pc_config{};
+  pc_config.sdp_semantic = GetParam();
+  LocalPeerPairRaii pair(pc_config);
+
+  // Add a negotiated data channel on both peers so that the report contains
+  // some data channel stats.
+  mrsDataChannelConfig dc_config{};
+  dc_config.id = 42;
+  dc_config.label = "stats";
+  mrsDataChannelHandle dc1{}, dc2{};
+  ASSERT_EQ(Result::kSuccess,
+            mrsPeerConnectionAddDataChannel(pair.pc1(), &dc_config, &dc1));
+  ASSERT_EQ(Result::kSuccess,
+            mrsPeerConnectionAddDataChannel(pair.pc2(), &dc_config, &dc2));
+  pair.ConnectAndWait();
+
+  mrsStatsReportHandle report = GetStatsAndWait(pair.pc1());
+  ASSERT_NE(nullptr, report);
+
+  // Contiguous array query
+  const void* objects = nullptr;
+  uint64_t count = 0;
+  ASSERT_EQ(Result::kSuccess,
+            mrsStatsReportGetSimpleStats(report, mrsStatsType::kDataChannel,
+                                         &objects, &count));
+  ASSERT_EQ(1u, count);
+  ASSERT_NE(nullptr, objects);
+  const auto* dc_stats = static_cast<const mrsDataChannelStats*>(objects);
+  ASSERT_EQ(42, dc_stats[0].data_channel_identifier);
+
+  // Querying again returns the same cached array
+  const void* objects2 = nullptr;
+  uint64_t count2 = 0;
+  ASSERT_EQ(Result::kSuccess,
+            mrsStatsReportGetSimpleStats(report, mrsStatsType::kDataChannel,
+                                         &objects2, &count2));
+  ASSERT_EQ(objects, objects2);
+  ASSERT_EQ(count, count2);
+
+  // The per-object callback API returns the same objects
+  std::vector<mrsDataChannelStats> dc_stats_list;
+  ASSERT_EQ(Result::kSuccess,
+            mrsStatsReportGetObjects(report, "DataChannelStats",
+                                     &AppendDataChannelStats, &dc_stats_list));
+  ASSERT_EQ(count, dc_stats_list.size());
+  ASSERT_EQ(0, memcmp(dc_stats, dc_stats_list.data(),
+                      sizeof(mrsDataChannelStats) * dc_stats_list.size()));
+
+  // Connected peers have at least one transport
+  ASSERT_EQ(Result::kSuccess,
+            mrsStatsReportGetSimpleStats(report, mrsStatsType::kTransport,
+                                         &objects, &count));
+  ASSERT_LE(1u, count);
+
+  // Invalid parameters
+  ASSERT_EQ(Result::kInvalidParameter,
+            mrsStatsReportGetSimpleStats(report, (mrsStatsType)-1, &objects,
+                                         &count));
+  ASSERT_EQ(Result::kInvalidParameter,
+            mrsStatsReportGetSimpleStats(report, mrsStatsType::kTransport,
+                                         nullptr, &count));
+  ASSERT_EQ(Result::kInvalidParameter,
+            mrsStatsReportGetSimpleStats(report, mrsStatsType::kTransport,
+                                         &objects, nullptr));
+
+  ASSERT_EQ(Result::kSuccess, mrsStatsReportRemoveRef(report));
+}
+
+TEST_P(StatsTests, ToJson) {
+  mrsPeerConnectionConfiguration pc_config{};
+  pc_config.sdp_semantic = GetParam();
+  LocalPeerPairRaii pair(pc_config);
+  pair.ConnectAndWait();
+
+  mrsStatsReportHandle report = GetStatsAndWait(pair.pc1());
+  ASSERT_NE(nullptr, report);
+
+  // Query the required size
+  uint64_t size = 0;
+  ASSERT_EQ(Result::kBufferTooSmall,
+            mrsStatsReportToJson(report, nullptr, nullptr, &size));
+  ASSERT_LT(2u, size);
+  std::vector<char> buffer(size);
+  uint64_t size2 = size;
+  ASSERT_EQ(Result::kSuccess,
+            mrsStatsReportToJson(report, nullptr, buffer.data(), &size2));
+  ASSERT_EQ(size, size2);
+  ASSERT_EQ('\0', buffer[size - 1]);
+  ASSERT_EQ(size - 1, strlen(buffer.data()));
+  ASSERT_EQ('[', buffer.front());
+  ASSERT_EQ(']', buffer[size - 2]);
+  ASSERT_NE(nullptr, strstr(buffer.data(), "\"type\":\"transport\""));
+  ASSERT_NE(nullptr, strstr(buffer.data(), "\"type\":\"candidate-pair\""));
+
+  // Filtered by type
+  size = buffer.size();
+  ASSERT_EQ(Result::kSuccess, mrsStatsReportToJson(report, "transport",
+                                                   buffer.data(), &size));
+  ASSERT_NE(nullptr, strstr(buffer.data(), "\"type\":\"transport\""));
+  ASSERT_EQ(nullptr, strstr(buffer.data(), "\"type\":\"candidate-pair\""));
+  size = buffer.size();
+  ASSERT_EQ(Result::kSuccess,
+            mrsStatsReportToJson(report, "candidate-pair,,transport",
+                                 buffer.data(), &size));
+  ASSERT_NE(nullptr, strstr(buffer.data(), "\"type\":\"transport\""));
+  ASSERT_NE(nullptr, strstr(buffer.data(), "\"type\":\"candidate-pair\""));
+  size = buffer.size();
+  ASSERT_EQ(Result::kSuccess, mrsStatsReportToJson(report, "not-a-type",
+                                                   buffer.data(), &size));
+  ASSERT_EQ(3u, size);
+  ASSERT_STREQ("[]", buffer.data());
+
+  // Invalid parameters
+  ASSERT_EQ(Result::kInvalidParameter,
+            mrsStatsReportToJson(report, nullptr, buffer.data(), nullptr));
+  size = 4;
+  ASSERT_EQ(Result::kInvalidParameter,
+            mrsStatsReportToJson(report, nullptr, nullptr, &size));
+
+  ASSERT_EQ(Result::kSuccess, mrsStatsReportRemoveRef(report));
+}
+
+TEST_F(StatsTests, InvalidHandle) {
+  const void* objects = nullptr;
+  uint64_t count = 0;
+  ASSERT_EQ(Result::kInvalidNativeHandle,
+            mrsStatsReportGetSimpleStats(nullptr, mrsStatsType::kDataChannel,
+                                         &objects, &count));
+  uint64_t size = 0;
+  ASSERT_EQ(Result::kInvalidNativeHandle,
+            mrsStatsReportToJson(nullptr, nullptr, nullptr, &size));
+  ASSERT_EQ(Result::kInvalidNativeHandle, mrsStatsReportRemoveRef(nullptr));
+}
+
+TEST_P(StatsTests, Sampler) {
+  mrsPeerConnectionConfiguration pc_config{};
+  pc_config.sdp_semantic = GetParam();
+  LocalPeerPairRaii pair(pc_config);
+  mrsDataChannelConfig dc_config{};
+  dc_config.id = 42;
+  dc_config.label = "stats";
+  mrsDataChannelHandle dc1{}, dc2{};
+  ASSERT_EQ(Result::kSuccess,
+            mrsPeerConnectionAddDataChannel(pair.pc1(), &dc_config, &dc1));
+  ASSERT_EQ(Result::kSuccess,
+            mrsPeerConnectionAddDataChannel(pair.pc2(), &dc_config, &dc2));
+  Event dc_open;
+  DataStateCallback dc_state_cb = [&](mrsDataChannelState state, int32_t) {
+    if (state == mrsDataChannelState::kOpen) {
+      dc_open.Set();
+    }
+  };
+  mrsDataChannelCallbacks dc_callbacks{};
+  dc_callbacks.state_callback = &DataStateCallback::StaticExec;
+  dc_callbacks.state_user_data = &dc_state_cb;
+  mrsDataChannelRegisterCallbacks(dc1, &dc_callbacks);
+
+  // Send video from #1 to #2, which is the only source of RTP packets
+  mrsExternalVideoTrackSourceHandle source_handle = nullptr;
+  ASSERT_EQ(mrsResult::kSuccess,
+            mrsExternalVideoTrackSourceCreateFromI420ACallback(
+                &VideoTestUtils::MakeTestFrame, nullptr, &source_handle));
+  mrsExternalVideoTrackSourceFinishCreation(source_handle);
+  mrsLocalVideoTrackHandle track_handle{};
+  mrsLocalVideoTrackInitSettings settings{};
+  settings.track_name = "stats_video_track";
+  ASSERT_EQ(mrsResult::kSuccess, mrsLocalVideoTrackCreateFromSource(
+                                     &settings, source_handle, &track_handle));
+  mrsTransceiverInitConfig transceiver_config{};
+  transceiver_config.name = "stats_video";
+  transceiver_config.media_kind = mrsMediaKind::kVideo;
+  mrsTransceiverHandle transceiver{};
+  ASSERT_EQ(Result::kSuccess,
+            mrsPeerConnectionAddTransceiver(pair.pc1(), &transceiver_config,
+                                            &transceiver));
+  ASSERT_EQ(Result::kSuccess,
+            mrsTransceiverSetLocalVideoTrack(transceiver, track_handle));
+  pair.ConnectAndWait();
+  ASSERT_TRUE(dc_open.WaitFor(60s));
+  ASSERT_TRUE(WaitForReceiverStats<mrsVideoReceiverStats>(
+      pair.pc2(), mrsStatsType::kVideoReceiver,
+      [](const mrsVideoReceiverStats& stats) {
+        return (stats.frames_decoded > 0);
+      }));
+
+  // Send data from #1 to #2 at a known rate in the background
+  constexpr double kDataBytesPerSec = 200.0 * 1024;
+  std::unique_ptr<DataSender> sender =
+      std::make_unique<DataSender>(dc1, 1024, kDataBytesPerSec);
+
+  // Not started yet
+  mrsStatsSamplerSnapshot snapshot{};
+  ASSERT_EQ(Result::kInvalidOperation,
+            mrsPeerConnectionGetStatsSnapshot(pair.pc1(), &snapshot));
+
+  // Invalid config
+  mrsStatsSamplerConfig config{};
+  config.interval_ms = 0;
+  ASSERT_EQ(Result::kInvalidParameter,
+            mrsPeerConnectionStartStatsSampler(pair.pc1(), &config));
+
+  constexpr int kHistorySize = 4;
+  config.interval_ms = 50;
+  config.history_size = kHistorySize;
+  ASSERT_EQ(Result::kSuccess,
+            mrsPeerConnectionStartStatsSampler(pair.pc1(), &config));
+  ASSERT_EQ(Result::kSuccess,
+            mrsPeerConnectionStartStatsSampler(pair.pc2(), &config));
+
+  // Each new snapshot adds a sample; wait for the history to fill up, and for
+  // a few more samples to check it wraps around.
+  for (int i = 0; i < kHistorySize + 2; ++i) {
+    const int64_t last_timestamp_us = snapshot.timestamp_us;
+    snapshot = WaitForSnapshot(
+        pair.pc1(),
+        [last_timestamp_us](const mrsStatsSamplerSnapshot& s) {
+          return (s.timestamp_us > last_timestamp_us);
+        });
+    ASSERT_EQ(static_cast<uint32_t>(std::min(i + 1, kHistorySize)),
+              snapshot.sample_count);
+  }
+  ASSERT_LT(0, snapshot.timestamp_us);
+
+  // The rates cover at least the data sent, with some slack for the timing of
+  // the sender, and are bounded by what a loopback connection can carry. Each
+  // packet carries at least one byte.
+  const mrsStatsSamplerSnapshot snapshot2 = WaitForSnapshot(
+      pair.pc2(),
+      [](const mrsStatsSamplerSnapshot& s) { return (s.sample_count > 0); });
+  sender.reset();
+  constexpr double kMaxBytesPerSec = 100.0 * 1024 * 1024;
+  ASSERT_LE(kDataBytesPerSec / 2, snapshot.bytes_sent_per_sec);
+  ASSERT_GE(kMaxBytesPerSec, snapshot.bytes_sent_per_sec);
+  ASSERT_LT(0.0, snapshot.packets_sent_per_sec);
+  ASSERT_GE(snapshot.bytes_sent_per_sec, snapshot.packets_sent_per_sec);
+  ASSERT_LE(kDataBytesPerSec / 2, snapshot2.bytes_received_per_sec);
+  ASSERT_GE(kMaxBytesPerSec, snapshot2.bytes_received_per_sec);
+  ASSERT_LT(0.0, snapshot2.packets_received_per_sec);
+  ASSERT_GE(snapshot2.bytes_received_per_sec,
+            snapshot2.packets_received_per_sec);
+
+  for (auto&& summary :
+       {snapshot.jitter_ms, snapshot.rtt_ms, snapshot.video_frames_sent_per_sec,
+        snapshot.video_frames_received_per_sec}) {
+    ASSERT_LE(summary.min, summary.p50);
+    ASSERT_LE(summary.p50, summary.p95);
+    ASSERT_LE(summary.p95, summary.max);
+    ASSERT_LE(summary.min, summary.last);
+    ASSERT_LE(summary.last, summary.max);
+  }
+  ASSERT_LE(0.0, snapshot.packet_loss_rate);
+  ASSERT_GE(1.0, snapshot.packet_loss_rate);
+
+  // Stopping keeps the last snapshot available
+  ASSERT_EQ(Result::kSuccess, mrsPeerConnectionStopStatsSampler(pair.pc1()));
+  mrsStatsSamplerSnapshot last_snapshot{};
+  ASSERT_EQ(Result::kSuccess,
+            mrsPeerConnectionGetStatsSnapshot(pair.pc1(), &last_snapshot));
+  // A collection the sampler had in flight is coalesced with this one, so is
+  // delivered, and discarded by the sampler, once this one completes.
+  mrsStatsReportHandle report = GetStatsAndWait(pair.pc1());
+  ASSERT_NE(nullptr, report);
+  ASSERT_EQ(Result::kSuccess, mrsStatsReportRemoveRef(report));
+  ASSERT_EQ(Result::kSuccess,
+            mrsPeerConnectionGetStatsSnapshot(pair.pc1(), &snapshot));
+  ASSERT_EQ(last_snapshot.timestamp_us, snapshot.timestamp_us);
+
+  // Restart, and let the sampler be stopped by closing the connection
+  ASSERT_EQ(Result::kSuccess,
+            mrsPeerConnectionStartStatsSampler(pair.pc1(), &config));
+
+  const mrsDataChannelCallbacks no_callbacks{};
+  mrsDataChannelRegisterCallbacks(dc1, &no_callbacks);
+  mrsRefCountedObjectRemoveRef(track_handle);
+  mrsExternalVideoTrackSourceShutdown(source_handle);
+  mrsRefCountedObjectRemoveRef(source_handle);
+}
+
+namespace {
+
+/// Get the timestamp of the first transport stats of a report.
+int64_t GetTransportTimestamp(mrsStatsReportHandle report) {
+  const void* objects = nullptr;
+  uint64_t count = 0;
+  EXPECT_EQ(Result::kSuccess,
+            mrsStatsReportGetSimpleStats(report, mrsStatsType::kTransport,
+                                         &objects, &count));
+  EXPECT_LE(1u, count);
+  return (count > 0 ? static_cast<const mrsTransportStats*>(objects)->timestamp_us
+                    : 0);
+}
+
+}  // namespace
+
+TEST_P(StatsTests, MaxAge) {
+  mrsPeerConnectionConfiguration pc_config{};
+  pc_config.sdp_semantic = GetParam();
+  LocalPeerPairRaii pair(pc_config);
+  pair.ConnectAndWait();
+
+  ASSERT_EQ(Result::kInvalidParameter,
+            mrsPeerConnectionSetStatsMaxAge(pair.pc1(), -1));
+
+  // Without caching, reports far enough apart are different.
+  int64_t t0, t1;
+  {
+    mrsStatsReportHandle report0 = GetStatsAndWait(pair.pc1());
+    ASSERT_NE(nullptr, report0);
+    t0 = GetTransportTimestamp(report0);
+    ASSERT_EQ(Result::kSuccess, mrsStatsReportRemoveRef(report0));
+    std::this_thread::sleep_for(200ms);
+    mrsStatsReportHandle report1 = GetStatsAndWait(pair.pc1());
+    ASSERT_NE(nullptr, report1);
+    t1 = GetTransportTimestamp(report1);
+    ASSERT_EQ(Result::kSuccess, mrsStatsReportRemoveRef(report1));
+    ASSERT_LT(t0, t1);
+  }
+
+  // With caching, requests within the max age reuse the last report.
+  ASSERT_EQ(Result::kSuccess,
+            mrsPeerConnectionSetStatsMaxAge(pair.pc1(), 60000));
+  {
+    mrsStatsReportHandle report0 = GetStatsAndWait(pair.pc1());
+    ASSERT_NE(nullptr, report0);
+    t0 = GetTransportTimestamp(report0);
+    ASSERT_EQ(Result::kSuccess, mrsStatsReportRemoveRef(report0));
+    std::this_thread::sleep_for(200ms);
+    mrsStatsReportHandle report1 = GetStatsAndWait(pair.pc1());
+    ASSERT_NE(nullptr, report1);
+    t1 = GetTransportTimestamp(report1);
+    ASSERT_EQ(Result::kSuccess, mrsStatsReportRemoveRef(report1));
+    ASSERT_EQ(t0, t1);
+  }
+
+  // Concurrent requests all complete.
+  {
+    constexpr int kNumRequests = 8;
+    Semaphore sem;
+    InteropCallback<mrsStatsReportHandle> cb([&sem](mrsStatsReportHandle r) {
+      mrsStatsReportRemoveRef(r);
+      sem.Release();
+    });
+    ASSERT_EQ(Result::kSuccess,
+              mrsPeerConnectionSetStatsMaxAge(pair.pc1(), 0));
+    for (int i = 0; i < kNumRequests; ++i) {
+      ASSERT_EQ(Result::kSuccess,
+                mrsPeerConnectionGetSimpleStats(pair.pc1(), CB(cb)));
+    }
+    ASSERT_TRUE(sem.TryAcquireFor(5s, kNumRequests));
+  }
+}
+
+TEST_P(StatsTests, SamplerSharesCollector) {
+  mrsPeerConnectionConfiguration pc_config{};
+  pc_config.sdp_semantic = GetParam();
+  LocalPeerPairRaii pair(pc_config);
+  pair.ConnectAndWait();
+
+  // Cache the reports for longer than the sampling interval, so that the
+  // sampler and the requests made right after a sample share a report.
+  ASSERT_EQ(Result::kSuccess, mrsPeerConnectionSetStatsMaxAge(pair.pc1(), 500));
+  mrsStatsSamplerConfig config{};
+  config.interval_ms = 50;
+  config.history_size = 4;
+  ASSERT_EQ(Result::kSuccess,
+            mrsPeerConnectionStartStatsSampler(pair.pc1(), &config));
+  const mrsStatsSamplerSnapshot snapshot = WaitForSnapshot(
+      pair.pc1(),
+      [](const mrsStatsSamplerSnapshot& s) { return (s.timestamp_us > 0); });
+  mrsStatsReportHandle report = GetStatsAndWait(pair.pc1());
+  ASSERT_NE(nullptr, report);
+  const int64_t timestamp_us = GetTransportTimestamp(report);
+  ASSERT_EQ(Result::kSuccess, mrsStatsReportRemoveRef(report));
+  ASSERT_EQ(snapshot.timestamp_us, timestamp_us);
+  ASSERT_EQ(Result::kSuccess, mrsPeerConnectionStopStatsSampler(pair.pc1()));
+}
+
+TEST_P(StatsTests, VideoSenderReceiverPairing) {
+  mrsPeerConnectionConfiguration pc_config{};
+  pc_config.sdp_semantic = GetParam();
+  LocalPeerPairRaii pair(pc_config);
+
+  mrsExternalVideoTrackSourceHandle source_handle = nullptr;
+  ASSERT_EQ(mrsResult::kSuccess,
+            mrsExternalVideoTrackSourceCreateFromI420ACallback(
+                &VideoTestUtils::MakeTestFrame, nullptr, &source_handle));
+  mrsExternalVideoTrackSourceFinishCreation(source_handle);
+  mrsLocalVideoTrackHandle track_handle{};
+  mrsLocalVideoTrackInitSettings settings{};
+  settings.track_name = "stats_video_track";
+  ASSERT_EQ(mrsResult::kSuccess, mrsLocalVideoTrackCreateFromSource(
+                                     &settings, source_handle, &track_handle));
+  mrsTransceiverInitConfig transceiver_config{};
+  transceiver_config.name = "stats_video";
+  transceiver_config.media_kind = mrsMediaKind::kVideo;
+  mrsTransceiverHandle transceiver{};
+  ASSERT_EQ(Result::kSuccess,
+            mrsPeerConnectionAddTransceiver(pair.pc1(), &transceiver_config,
+                                            &transceiver));
+  ASSERT_EQ(Result::kSuccess,
+            mrsTransceiverSetLocalVideoTrack(transceiver, track_handle));
+  pair.ConnectAndWait();
+  ASSERT_TRUE(WaitForReceiverStats<mrsVideoReceiverStats>(
+      pair.pc2(), mrsStatsType::kVideoReceiver,
+      [](const mrsVideoReceiverStats& stats) {
+        return (stats.frames_decoded > 0);
+      }));
+
+  // The track stats and the RTP stats of each side are merged into a single
+  // object, whichever comes first in the report.
+  {
+    mrsStatsReportHandle report = GetStatsAndWait(pair.pc1());
+    ASSERT_NE(nullptr, report);
+    const std::vector<mrsVideoSenderStats> senders =
+        GetStatsArray<mrsVideoSenderStats>(report, mrsStatsType::kVideoSender);
+    ASSERT_EQ(1u, senders.size());
+    const mrsVideoSenderStats& sender = senders[0];
+    ASSERT_LT(0, sender.track_stats_timestamp_us);
+    ASSERT_STREQ("stats_video_track", sender.track_identifier);
+    ASSERT_LT(0u, sender.frames_sent);
+    ASSERT_LT(0, sender.rtp_stats_timestamp_us);
+    ASSERT_LT(0u, sender.packets_sent);
+    ASSERT_LT(0u, sender.bytes_sent);
+    ASSERT_LT(0u, sender.frames_encoded);
+    ASSERT_EQ(Result::kSuccess, mrsStatsReportRemoveRef(report));
+  }
+  {
+    mrsStatsReportHandle report = GetStatsAndWait(pair.pc2());
+    ASSERT_NE(nullptr, report);
+    const std::vector<mrsVideoReceiverStats> receivers =
+        GetStatsArray<mrsVideoReceiverStats>(report,
+                                             mrsStatsType::kVideoReceiver);
+    ASSERT_EQ(1u, receivers.size());
+    const mrsVideoReceiverStats& receiver = receivers[0];
+    ASSERT_LT(0, receiver.track_stats_timestamp_us);
+    ASSERT_NE(nullptr, receiver.track_identifier);
+    ASSERT_LT(0u, receiver.frames_received);
+    ASSERT_LT(0, receiver.rtp_stats_timestamp_us);
+    ASSERT_LT(0u, receiver.packets_received);
+    ASSERT_LT(0u, receiver.bytes_received);
+    ASSERT_LT(0u, receiver.frames_decoded);
+    ASSERT_EQ(Result::kSuccess, mrsStatsReportRemoveRef(report));
+  }
+
+  mrsRefCountedObjectRemoveRef(track_handle);
+  mrsExternalVideoTrackSourceShutdown(source_handle);
+  mrsRefCountedObjectRemoveRef(source_handle);
+}
+
+#if !defined(MRSW_EXCLUDE_DEVICE_TESTS)
+
+TEST_P(StatsTests, AudioSenderReceiverPairing) {
+  mrsPeerConnectionConfiguration pc_config{};
+  pc_config.sdp_semantic = GetParam();
+  LocalPeerPairRaii pair(pc_config);
+
+  // The tree has no external audio source, so send the microphone instead
+  mrsLocalAudioDeviceInitConfig device_config{};
+  mrsDeviceAudioTrackSourceHandle audio_source{};
+  ASSERT_EQ(Result::kSuccess,
+            mrsDeviceAudioTrackSourceCreate(&device_config, &audio_source));
+  mrsLocalAudioTrackInitSettings init_settings{};
+  init_settings.track_name = "stats_audio_track";
+  mrsLocalAudioTrackHandle track_handle{};
+  ASSERT_EQ(Result::kSuccess,
+            mrsLocalAudioTrackCreateFromSource(&init_settings, audio_source,
+                                               &track_handle));
+  mrsTransceiverInitConfig transceiver_config{};
+  transceiver_config.name = "stats_audio";
+  transceiver_config.media_kind = mrsMediaKind::kAudio;
+  mrsTransceiverHandle transceiver{};
+  ASSERT_EQ(Result::kSuccess,
+            mrsPeerConnectionAddTransceiver(pair.pc1(), &transceiver_config,
+                                            &transceiver));
+  ASSERT_EQ(Result::kSuccess,
+            mrsTransceiverSetLocalAudioTrack(transceiver, track_handle));
+  pair.ConnectAndWait();
+  ASSERT_TRUE(WaitForReceiverStats<mrsAudioReceiverStats>(
+      pair.pc2(), mrsStatsType::kAudioReceiver,
+      [](const mrsAudioReceiverStats& stats) {
+        return (stats.packets_received > 0);
+      }));
+
+  {
+    mrsStatsReportHandle report = GetStatsAndWait(pair.pc1());
+    ASSERT_NE(nullptr, report);
+    const std::vector<mrsAudioSenderStats> senders =
+        GetStatsArray<mrsAudioSenderStats>(report, mrsStatsType::kAudioSender);
+    ASSERT_EQ(1u, senders.size());
+    const mrsAudioSenderStats& sender = senders[0];
+    ASSERT_LT(0, sender.track_stats_timestamp_us);
+    ASSERT_STREQ("stats_audio_track", sender.track_identifier);
+    ASSERT_LT(0, sender.rtp_stats_timestamp_us);
+    ASSERT_LT(0u, sender.packets_sent);
+    ASSERT_LT(0u, sender.bytes_sent);
+    ASSERT_EQ(Result::kSuccess, mrsStatsReportRemoveRef(report));
+  }
+  {
+    mrsStatsReportHandle report = GetStatsAndWait(pair.pc2());
+    ASSERT_NE(nullptr, report);
+    const std::vector<mrsAudioReceiverStats> receivers =
+        GetStatsArray<mrsAudioReceiverStats>(report,
+                                             mrsStatsType::kAudioReceiver);
+    ASSERT_EQ(1u, receivers.size());
+    const mrsAudioReceiverStats& receiver = receivers[0];
+    ASSERT_LT(0, receiver.track_stats_timestamp_us);
+    ASSERT_NE(nullptr, receiver.track_identifier);
+    ASSERT_LT(0, receiver.rtp_stats_timestamp_us);
+    ASSERT_LT(0u, receiver.packets_received);
+    ASSERT_LT(0u, receiver.bytes_received);
+    ASSERT_EQ(Result::kSuccess, mrsStatsReportRemoveRef(report));
+  }
+
+  mrsRefCountedObjectRemoveRef(track_handle);
+  mrsRefCountedObjectRemoveRef(audio_source);
+}
+
+#endif  // !defined(MRSW_EXCLUDE_DEVICE_TESTS)
@@ -0,0 +1,108 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+#include "pch.h"
+
+#include "interop_api.h"
+#include "thread_config_interop.h"
+
+#include "test_utils.h"
+
+namespace {
+
+const mrsThreadRole kAllRoles[] = {mrsThreadRole::kNetwork,
+                                   mrsThreadRole::kWorker,
+                                   mrsThreadRole::kSignaling,
+                                   mrsThreadRole::kCapture};
+
+class ThreadConfigTests : public TestUtils::TestBase {
+ public:
+  void TearDown() override {
+    TestUtils::TestBase::TearDown();
+    // Restore the default scheduling for the next tests
+    const mrsThreadConfig config{};
+    for (mrsThreadRole role : kAllRoles) {
+      ASSERT_EQ(Result::kSuccess, mrsThreadConfigSet(role, &config));
+    }
+  }
+};
+
+}  // namespace
+
+TEST_F(ThreadConfigTests, InvalidParameters) {
+  mrsThreadConfig config{};
+  ASSERT_EQ(Result::kInvalidParameter,
+            mrsThreadConfigSet(mrsThreadRole::kWorker, nullptr));
+  ASSERT_EQ(Result::kInvalidParameter,
+            mrsThreadConfigGet(mrsThreadRole::kWorker, nullptr));
+  ASSERT_EQ(Result::kInvalidParameter,
+            mrsThreadConfigGetApplied(mrsThreadRole::kWorker, nullptr));
+  ASSERT_EQ(Result::kInvalidParameter,
+            mrsThreadConfigSet(static_cast<mrsThreadRole>(4), &config));
+  config.nice = -21;
+  ASSERT_EQ(Result::kInvalidParameter,
+            mrsThreadConfigSet(mrsThreadRole::kWorker, &config));
+  config.nice = 20;
+  ASSERT_EQ(Result::kInvalidParameter,
+            mrsThreadConfigSet(mrsThreadRole::kWorker, &config));
+  config.nice = 0;
+  config.realtime_priority = 100;
+  ASSERT_EQ(Result::kInvalidParameter,
+            mrsThreadConfigSet(mrsThreadRole::kWorker, &config));
+}
+
+TEST_F(ThreadConfigTests, SetGet) {
+  mrsThreadConfig config{};
+  config.affinity_mask = 0x3;
+  config.nice = -10;
+  config.realtime_priority = 20;
+  ASSERT_EQ(Result::kSuccess,
+            mrsThreadConfigSet(mrsThreadRole::kSignaling, &config));
+  mrsThreadConfig read{};
+  ASSERT_EQ(Result::kSuccess,
+            mrsThreadConfigGet(mrsThreadRole::kSignaling, &read));
+  ASSERT_EQ(config.affinity_mask, read.affinity_mask);
+  ASSERT_EQ(config.nice, read.nice);
+  ASSERT_EQ(config.realtime_priority, read.realtime_priority);
+
+  // Other roles are not affected
+  ASSERT_EQ(Result::kSuccess,
+            mrsThreadConfigGet(mrsThreadRole::kWorker, &read));
+  ASSERT_EQ(0u, read.affinity_mask);
+  ASSERT_EQ(0, read.nice);
+  ASSERT_EQ(0, read.realtime_priority);
+}
+
+TEST_F(ThreadConfigTests, AppliedOnInit) {
+  // Use settings which don't require elevated privileges: pinning to the first
+  // processor, and lowering the priority.
+  mrsThreadConfig config{};
+  config.affinity_mask = 0x1;
+  config.nice = 5;
+  ASSERT_EQ(Result::kSuccess,
+            mrsThreadConfigSet(mrsThreadRole::kWorker, &config));
+
+  mrsPeerConnectionConfiguration pc_config{};
+  mrsPeerConnectionHandle handle{};
+  ASSERT_EQ(Result::kSuccess, mrsPeerConnectionCreate(&pc_config, &handle));
+  ASSERT_NE(nullptr, handle);
+
+  mrsAppliedThreadConfig applied{};
+  ASSERT_EQ(Result::kSuccess,
+            mrsThreadConfigGetApplied(mrsThreadRole::kWorker, &applied));
+  ASSERT_EQ(Result::kSuccess, applied.result);
+  ASSERT_STREQ("WebRTC worker thread", applied.name);
+  ASSERT_NE(0u, applied.thread_id);
+  ASSERT_EQ(0x1u, applied.affinity_mask);
+  ASSERT_EQ(5, applied.nice);
+  ASSERT_EQ(0, applied.realtime_priority);
+
+  // The default configuration leaves the default scheduling
+  ASSERT_EQ(Result::kSuccess,
+            mrsThreadConfigGetApplied(mrsThreadRole::kNetwork, &applied));
+  ASSERT_EQ(Result::kSuccess, applied.result);
+  ASSERT_EQ(0, applied.nice);
+  ASSERT_EQ(0, applied.realtime_priority);
+
+  mrsRefCountedObjectRemoveRef(handle);
+}
@@ -0,0 +1,105 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+#include "pch.h"
+
+#include "interop_api.h"
+#include "thread_monitor_interop.h"
+#include "tracing_interop.h"
+
+#include "test_utils.h"
+
+namespace {
+
+class ThreadMonitorTests : public TestUtils::TestBase {};
+
+/// Get the statistics of all monitored threads.
+std::vector<mrsThreadStats> GetThreadStats() {
+  uint32_t count = 0;
+  mrsResult res = mrsThreadMonitorGetStats(nullptr, &count);
+  EXPECT_TRUE((res == Result::kSuccess) || (res == Result::kBufferTooSmall));
+  std::vector<mrsThreadStats> stats(count);
+  EXPECT_EQ(Result::kSuccess, mrsThreadMonitorGetStats(stats.data(), &count));
+  stats.resize(count);
+  return stats;
+}
+
+}  // namespace
+
+TEST_F(ThreadMonitorTests, Sample) {
+  // Keep the library initialized, so that its threads stay registered
+  mrsPeerConnectionConfiguration config{};
+  mrsPeerConnectionHandle handle{};
+  ASSERT_EQ(Result::kSuccess, mrsPeerConnectionCreate(&config, &handle));
+  ASSERT_NE(nullptr, handle);
+
+  ASSERT_EQ(Result::kSuccess, mrsTracingStart());
+  ASSERT_EQ(Result::kSuccess, mrsThreadMonitorStart(10));
+  std::this_thread::sleep_for(200ms);
+  ASSERT_EQ(Result::kSuccess, mrsThreadMonitorStop());
+  ASSERT_EQ(Result::kSuccess, mrsTracingStop());
+
+  const std::vector<mrsThreadStats> stats = GetThreadStats();
+  ASSERT_LE(3u, stats.size());
+  bool found = false;
+  for (auto&& thread : stats) {
+    ASSERT_NE('\0', thread.name[0]);
+    if (strcmp(thread.name, "WebRTC signaling thread") != 0) {
+      continue;
+    }
+    found = true;
+    ASSERT_LT(0u, thread.probe_count);
+    ASSERT_NE(0u, thread.thread_id);
+    ASSERT_LE(thread.last_latency_us, thread.max_latency_us);
+    ASSERT_LE(thread.max_latency_us, thread.total_latency_us);
+  }
+  ASSERT_TRUE(found);
+
+  // Probes are exported to the trace
+  uint64_t size = 0;
+  ASSERT_EQ(Result::kBufferTooSmall, mrsTracingGetJson(nullptr, &size));
+  std::string json(static_cast<size_t>(size), '\0');
+  ASSERT_EQ(Result::kSuccess, mrsTracingGetJson(&json[0], &size));
+  ASSERT_NE(std::string::npos, json.find("\"name\":\"ThreadMonitor::Probe\""));
+  ASSERT_NE(std::string::npos, json.find("\"name\":\"Thread queue depth\""));
+  ASSERT_NE(std::string::npos, json.find("\"ph\":\"C\""));
+
+  mrsRefCountedObjectRemoveRef(handle);
+}
+
+TEST_F(ThreadMonitorTests, RunAcrossShutdown) {
+  ASSERT_EQ(Result::kSuccess, mrsThreadMonitorStart(10));
+
+  // Shutting down the library unregisters its threads, without stopping the
+  // monitor started by the application.
+  mrsPeerConnectionConfiguration config{};
+  mrsPeerConnectionHandle handle{};
+  ASSERT_EQ(Result::kSuccess, mrsPeerConnectionCreate(&config, &handle));
+  mrsRefCountedObjectRemoveRef(handle);
+  ASSERT_EQ(0u, mrsReportLiveObjects());
+  ASSERT_TRUE(GetThreadStats().empty());
+
+  // The threads of the next initialization are sampled
+  ASSERT_EQ(Result::kSuccess, mrsPeerConnectionCreate(&config, &handle));
+  std::this_thread::sleep_for(200ms);
+  bool found = false;
+  for (auto&& thread : GetThreadStats()) {
+    if (strcmp(thread.name, "WebRTC signaling thread") == 0) {
+      found = true;
+      ASSERT_LT(0u, thread.probe_count);
+    }
+  }
+  ASSERT_TRUE(found);
+  ASSERT_EQ(Result::kSuccess, mrsThreadMonitorStop());
+  mrsRefCountedObjectRemoveRef(handle);
+}
+
+TEST_F(ThreadMonitorTests, InvalidParameters) {
+  ASSERT_EQ(Result::kInvalidParameter, mrsThreadMonitorStart(0));
+  ASSERT_EQ(Result::kInvalidParameter, mrsThreadMonitorStart(-5));
+  ASSERT_EQ(Result::kInvalidParameter,
+            mrsThreadMonitorGetStats(nullptr, nullptr));
+  uint32_t count = 4;
+  ASSERT_EQ(Result::kInvalidParameter,
+            mrsThreadMonitorGetStats(nullptr, &count));
+}
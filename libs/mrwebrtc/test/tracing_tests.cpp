@@ -0,0 +1,77 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+#include "pch.h"
+
+#include "interop_api.h"
+#include "tracing_interop.h"
+
+#include "test_utils.h"
+
+namespace {
+
+class TracingTests : public TestUtils::TestBase {};
+
+/// Get the JSON serialization of the last capture.
+std::string GetTraceJson() {
+  uint64_t size = 0;
+  EXPECT_EQ(Result::kBufferTooSmall, mrsTracingGetJson(nullptr, &size));
+  std::string json(static_cast<size_t>(size), '\0');
+  EXPECT_EQ(Result::kSuccess, mrsTracingGetJson(&json[0], &size));
+  EXPECT_EQ(json.size(), size);
+  json.resize(static_cast<size_t>(size - 1));  // null terminator
+  return json;
+}
+
+}  // namespace
+
+TEST_F(TracingTests, Capture) {
+  ASSERT_EQ(Result::kSuccess, mrsTracingStart());
+
+  // Cannot serialize while capturing
+  uint64_t size = 0;
+  ASSERT_EQ(Result::kInvalidOperation, mrsTracingGetJson(nullptr, &size));
+
+  // Extract some stats, which records a span on this thread
+  {
+    mrsPeerConnectionConfiguration pc_config{};
+    LocalPeerPairRaii pair(pc_config);
+    Event ev;
+    mrsStatsReportHandle report = nullptr;
+    InteropCallback<mrsStatsReportHandle> cb(
+        [&ev, &report](mrsStatsReportHandle r) {
+          report = r;
+          ev.Set();
+        });
+    ASSERT_EQ(Result::kSuccess,
+              mrsPeerConnectionGetSimpleStats(pair.pc1(), CB(cb)));
+    ASSERT_TRUE(ev.WaitFor(5s));
+    ASSERT_NE(nullptr, report);
+    const void* objects = nullptr;
+    uint64_t count = 0;
+    ASSERT_EQ(Result::kSuccess,
+              mrsStatsReportGetSimpleStats(report, mrsStatsType::kTransport,
+                                           &objects, &count));
+    ASSERT_EQ(Result::kSuccess, mrsStatsReportRemoveRef(report));
+  }
+
+  ASSERT_EQ(Result::kSuccess, mrsTracingStop());
+  const std::string json = GetTraceJson();
+  ASSERT_EQ(0u, json.find("{\"displayTimeUnit\":\"ms\",\"traceEvents\":["));
+  ASSERT_EQ(json.size() - 2, json.rfind("]}"));
+  ASSERT_NE(std::string::npos, json.find("\"name\":\"SimpleStats::Extract\""));
+  ASSERT_NE(std::string::npos, json.find("\"ph\":\"X\""));
+
+  // The capture is kept until the next one starts
+  ASSERT_EQ(json, GetTraceJson());
+  ASSERT_EQ(Result::kSuccess, mrsTracingStart());
+  ASSERT_EQ(Result::kSuccess, mrsTracingStop());
+  ASSERT_EQ(std::string::npos,
+            GetTraceJson().find("\"name\":\"SimpleStats::Extract\""));
+}
+
+TEST_F(TracingTests, InvalidParameters) {
+  ASSERT_EQ(Result::kInvalidParameter, mrsTracingGetJson(nullptr, nullptr));
+  uint64_t size = 16;
+  ASSERT_EQ(Result::kInvalidParameter, mrsTracingGetJson(nullptr, &size));
+}
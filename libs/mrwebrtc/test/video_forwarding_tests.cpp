@@ -0,0 +1,207 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+#include "pch.h"
+
+#include "external_video_track_source_interop.h"
+#include "interop_api.h"
+#include "local_video_track_interop.h"
+#include "remote_video_track_interop.h"
+#include "transceiver_interop.h"
+#include "video_forwarding_interop.h"
+
+#include "peer_connection_test_helpers.h"
+#include "test_utils.h"
+#include "video_test_utils.h"
+
+namespace {
+
+class VideoForwardingTests : public TestUtils::TestBase {};
+
+using VideoTrackAddedCallback =
+    InteropCallback<const mrsRemoteVideoTrackAddedInfo*>;
+using I420VideoFrameCallback = InteropCallback<const I420AVideoFrame&>;
+
+/// Pair of peer connections sending a local video track from the first one to
+/// the second one, and counting the frames received.
+struct SendingPair {
+  LocalPeerPairRaii pair;
+  mrsRemoteVideoTrackHandle remote_track{};
+  Event track_added;
+  VideoTrackAddedCallback track_added_cb;
+  std::atomic<uint32_t> frame_count{0};
+  I420VideoFrameCallback frame_cb;
+
+  void Start(mrsLocalVideoTrackHandle local_track) {
+    track_added_cb = [this](const mrsRemoteVideoTrackAddedInfo* info) {
+      remote_track = info->track_handle;
+      track_added.Set();
+    };
+    mrsPeerConnectionRegisterVideoTrackAddedCallback(pair.pc2(),
+                                                     CB(track_added_cb));
+    mrsTransceiverInitConfig transceiver_config{};
+    transceiver_config.name = "forwarded_video";
+    transceiver_config.media_kind = mrsMediaKind::kVideo;
+    mrsTransceiverHandle transceiver{};
+    ASSERT_EQ(Result::kSuccess,
+              mrsPeerConnectionAddTransceiver(pair.pc1(), &transceiver_config,
+                                              &transceiver));
+    ASSERT_EQ(Result::kSuccess,
+              mrsTransceiverSetLocalVideoTrack(transceiver, local_track));
+    pair.ConnectAndWait();
+    ASSERT_TRUE(track_added.WaitFor(5s));
+    frame_cb = [this](const I420AVideoFrame& frame) {
+      VideoTestUtils::CheckIsTestFrame(frame);
+      ++frame_count;
+    };
+    mrsRemoteVideoTrackRegisterI420AFrameCallback(remote_track, CB(frame_cb));
+  }
+
+  void Stop() {
+    mrsRemoteVideoTrackRegisterI420AFrameCallback(remote_track, nullptr,
+                                                  nullptr);
+    mrsPeerConnectionRegisterVideoTrackAddedCallback(pair.pc2(), nullptr,
+                                                     nullptr);
+  }
+};
+
+}  // namespace
+
+TEST_F(VideoForwardingTests, InvalidParameters) {
+  mrsVideoForwardingConfig config{};
+  mrsForwardedVideoTrackSourceHandle source_handle{};
+  ASSERT_EQ(Result::kInvalidParameter,
+            mrsForwardedVideoTrackSourceCreate(nullptr, nullptr,
+                                               &source_handle));
+  ASSERT_EQ(Result::kInvalidParameter,
+            mrsForwardedVideoTrackSourceCreate(nullptr, &config, nullptr));
+  ASSERT_EQ(Result::kInvalidNativeHandle,
+            mrsForwardedVideoTrackSourceCreate(nullptr, &config,
+                                               &source_handle));
+  ASSERT_EQ(nullptr, source_handle);
+  ASSERT_EQ(Result::kInvalidNativeHandle,
+            mrsForwardedVideoTrackSourceSetMaxTemporalLayer(nullptr, 0));
+  mrsVideoForwardingStats stats{};
+  ASSERT_EQ(Result::kInvalidNativeHandle,
+            mrsForwardedVideoTrackSourceGetStats(nullptr, &stats));
+  ASSERT_EQ(Result::kInvalidParameter,
+            mrsForwardedVideoTrackSourceGetStats(nullptr, nullptr));
+}
+
+TEST_F(VideoForwardingTests, Forward) {
+  mrsExternalVideoTrackSourceHandle source_handle = nullptr;
+  ASSERT_EQ(mrsResult::kSuccess,
+            mrsExternalVideoTrackSourceCreateFromI420ACallback(
+                &VideoTestUtils::MakeTestFrame, nullptr, &source_handle));
+  mrsExternalVideoTrackSourceFinishCreation(source_handle);
+  mrsLocalVideoTrackHandle track_handle{};
+  mrsLocalVideoTrackInitSettings settings{};
+  settings.track_name = "source_video_track";
+  ASSERT_EQ(mrsResult::kSuccess, mrsLocalVideoTrackCreateFromSource(
+                                     &settings, source_handle, &track_handle));
+
+  {
+    // Receive the video track on a first pair
+    SendingPair source_pair;
+    source_pair.Start(track_handle);
+
+    // Forward it without decoding to a second pair
+    mrsVideoForwardingConfig config{};
+    mrsForwardedVideoTrackSourceHandle forwarded_handle{};
+    ASSERT_EQ(Result::kSuccess,
+              mrsForwardedVideoTrackSourceCreate(source_pair.remote_track,
+                                                 &config, &forwarded_handle));
+    ASSERT_NE(nullptr, forwarded_handle);
+    mrsLocalVideoTrackHandle forwarded_track{};
+    settings.track_name = "forwarded_video_track";
+    ASSERT_EQ(mrsResult::kSuccess,
+              mrsLocalVideoTrackCreateFromSource(&settings, forwarded_handle,
+                                                 &forwarded_track));
+    SendingPair forwarding_pair;
+    forwarding_pair.Start(forwarded_track);
+
+    Event ev;
+    ev.WaitFor(3s);
+    ASSERT_LT(10u, forwarding_pair.frame_count.load())
+        << "Expected at least 5 FPS";
+
+    // The frames of the first pair are not decoded anymore
+    const uint32_t decoded_count = source_pair.frame_count.load();
+    ev.WaitFor(500ms);
+    ASSERT_EQ(decoded_count, source_pair.frame_count.load());
+
+    mrsVideoForwardingStats stats{};
+    ASSERT_EQ(Result::kSuccess,
+              mrsForwardedVideoTrackSourceGetStats(forwarded_handle, &stats));
+    ASSERT_LT(0u, stats.frames_received);
+    ASSERT_LT(0u, stats.frames_sent);
+    ASSERT_LE(stats.frames_sent, stats.frames_received);
+
+    forwarding_pair.Stop();
+    source_pair.Stop();
+    mrsRefCountedObjectRemoveRef(forwarded_track);
+    mrsRefCountedObjectRemoveRef(forwarded_handle);
+  }
+
+  mrsRefCountedObjectRemoveRef(track_handle);
+  mrsExternalVideoTrackSourceShutdown(source_handle);
+  mrsRefCountedObjectRemoveRef(source_handle);
+}
+
+TEST_F(VideoForwardingTests, SameTrackName) {
+  mrsExternalVideoTrackSourceHandle source_handle = nullptr;
+  ASSERT_EQ(mrsResult::kSuccess,
+            mrsExternalVideoTrackSourceCreateFromI420ACallback(
+                &VideoTestUtils::MakeTestFrame, nullptr, &source_handle));
+  mrsExternalVideoTrackSourceFinishCreation(source_handle);
+
+  // The remote tracks of both pairs have the same ID, which is usually the ID
+  // of the SDP stream their decoder is created for.
+  mrsLocalVideoTrackHandle track_handles[2]{};
+  mrsLocalVideoTrackInitSettings settings{};
+  settings.track_name = "camera";
+  for (auto&& track_handle : track_handles) {
+    ASSERT_EQ(mrsResult::kSuccess,
+              mrsLocalVideoTrackCreateFromSource(&settings, source_handle,
+                                                 &track_handle));
+  }
+
+  {
+    SendingPair forwarded_pair;
+    forwarded_pair.Start(track_handles[0]);
+    SendingPair other_pair;
+    other_pair.Start(track_handles[1]);
+
+    // Forward the track of the first pair without decoding it
+    mrsVideoForwardingConfig config{};
+    config.decode_locally = mrsBool::kFalse;
+    mrsForwardedVideoTrackSourceHandle forwarded_handle{};
+    ASSERT_EQ(Result::kSuccess,
+              mrsForwardedVideoTrackSourceCreate(forwarded_pair.remote_track,
+                                                 &config, &forwarded_handle));
+    Event ev;
+    ev.WaitFor(500ms);
+
+    // Only the track of the first pair stops being decoded
+    const uint32_t forwarded_count = forwarded_pair.frame_count.load();
+    const uint32_t other_count = other_pair.frame_count.load();
+    ev.WaitFor(1s);
+    ASSERT_EQ(forwarded_count, forwarded_pair.frame_count.load());
+    ASSERT_LT(other_count + 5, other_pair.frame_count.load());
+
+    mrsVideoForwardingStats stats{};
+    ASSERT_EQ(Result::kSuccess,
+              mrsForwardedVideoTrackSourceGetStats(forwarded_handle, &stats));
+    ASSERT_LT(0u, stats.frames_received);
+
+    other_pair.Stop();
+    forwarded_pair.Stop();
+    mrsRefCountedObjectRemoveRef(forwarded_handle);
+  }
+
+  for (auto&& track_handle : track_handles) {
+    mrsRefCountedObjectRemoveRef(track_handle);
+  }
+  mrsExternalVideoTrackSourceShutdown(source_handle);
+  mrsRefCountedObjectRemoveRef(source_handle);
+}
@@ -539,21 +539,61 @@ TEST_P(VideoTrackTests, ExternalI420) {
   ASSERT_NE(nullptr, transceiver_handle2);
 
   // Register a frame callback for the remote video of #2
-  uint32_t frame_count = 0;
-  I420VideoFrameCallback i420cb = [&frame_count](const I420AVideoFrame& frame) {
+  // The counters are updated on the decoder thread.
+  std::atomic<uint32_t> frame_count{0};
+  std::atomic<uint32_t> timed_frame_count{0};
+  I420VideoFrameCallback i420cb = [&frame_count, &timed_frame_count](
+                                      const I420AVideoFrame& frame) {
     VideoTestUtils::CheckIsTestFrame(frame);
     ++frame_count;
+    // Remote frames always have an RTP timestamp, and have a capture time once
+    // the first RTCP sender reports are received.
+    ASSERT_NE(0u, frame.rtp_timestamp_);
+    ASSERT_LT(0, frame.receive_time_ntp_ms_);
+    if (frame.capture_time_ntp_ms_ > 0) {
+      ASSERT_LE(frame.capture_time_ntp_ms_, frame.receive_time_ntp_ms_);
+      ++timed_frame_count;
+    }
   };
   mrsRemoteVideoTrackRegisterI420AFrameCallback(track_handle2, CB(i420cb));
 
   Event ev;
   ev.WaitFor(3s);
-  ASSERT_LT(30u, frame_count) << "Expected at least 10 FPS";
-
-  ASSERT_TRUE(pair.WaitExchangeCompletedFor(5s));
 
+  // Stop counting before reading the histogram, which keeps recording the
+  // frames received, so that all the frames counted are in the histogram.
   mrsRemoteVideoTrackRegisterI420AFrameCallback(track_handle2, nullptr,
                                                 nullptr);
+  ASSERT_LT(30u, frame_count.load()) << "Expected at least 10 FPS";
+
+  // Check the capture-to-render latency histogram
+  {
+    mrsVideoLatencyHistogram histogram{};
+    ASSERT_EQ(Result::kSuccess, mrsRemoteVideoTrackGetLatencyHistogram(
+                                    track_handle2, mrsBool::kTrue, &histogram));
+    ASSERT_LT(0u, timed_frame_count.load());
+    ASSERT_LE(timed_frame_count.load(), histogram.count_);
+    ASSERT_LE(histogram.min_ms_, histogram.max_ms_);
+    ASSERT_LE(histogram.min_ms_ * (int64_t)histogram.count_, histogram.sum_ms_);
+    ASSERT_GE(histogram.max_ms_ * (int64_t)histogram.count_, histogram.sum_ms_);
+    uint64_t bucket_total = 0;
+    for (uint32_t bucket : histogram.buckets_) {
+      bucket_total += bucket;
+    }
+    ASSERT_EQ(histogram.count_, bucket_total);
+
+    // The histogram was reset
+    ASSERT_EQ(Result::kSuccess,
+              mrsRemoteVideoTrackGetLatencyHistogram(
+                  track_handle2, mrsBool::kFalse, &histogram));
+    ASSERT_GT(timed_frame_count.load(), histogram.count_);
+    ASSERT_EQ(Result::kInvalidParameter,
+              mrsRemoteVideoTrackGetLatencyHistogram(
+                  track_handle2, mrsBool::kFalse, nullptr));
+  }
+
+  ASSERT_TRUE(pair.WaitExchangeCompletedFor(5s));
+
   mrsRefCountedObjectRemoveRef(track_handle1);
   mrsExternalVideoTrackSourceShutdown(source_handle1);
   mrsRefCountedObjectRemoveRef(source_handle1);